@@ -20,6 +20,8 @@
 #ifndef __BOOT_SERIAL_H__
 #define __BOOT_SERIAL_H__
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -31,10 +33,14 @@ extern "C" {
  *  set if newline is the last character.
  * write takes as it's arguments pointer to data to write, and the count
  *  of bytes.
+ * set_baud, which is optional, changes the baud rate of the uart once the
+ *  data written so far has been sent and returns 0 on success. A baud of 0
+ *  restores the rate the uart was configured with at boot.
  */
 struct boot_uart_funcs {
     int (*read)(char *str, int cnt, int *newline);
     void (*write)(const char *ptr, int cnt);
+    int (*set_baud)(uint32_t baud);
 };
 
 /**
@@ -52,6 +58,20 @@ void boot_serial_start(const struct boot_uart_funcs *f);
  */
 void boot_serial_check_start(const struct boot_uart_funcs *f, int timeout_in_ms);
 
+struct boot_rsp;
+
+/**
+ * Boots an image uploaded to RAM and validated by serial recovery, with
+ * MCUBOOT_SERIAL_RAM_UPLOAD. Provided by the port, called on a reset
+ * request once the response has been sent.
+ *
+ * @param rsp       Describes the image, as boot_go() would; br_hdr points
+ *                  to its header in RAM.
+ *
+ * Does not return.
+ */
+void boot_serial_ram_boot(struct boot_rsp *rsp);
+
 #ifdef __cplusplus
 }
 #endif
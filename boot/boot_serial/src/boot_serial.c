@@ -73,6 +73,15 @@
 #include "boot_serial/boot_serial_encryption.h"
 #endif
 
+#if defined(MCUBOOT_SERIAL_UPLOAD_HASH) || defined(MCUBOOT_SERIAL_UPLOAD_RESUME) || \
+    defined(MCUBOOT_SERIAL_RAM_UPLOAD)
+#include "bootutil/crypto/sha.h"
+#endif
+
+#ifdef MCUBOOT_SERIAL_RAM_UPLOAD
+#include "bootutil/ramload.h"
+#endif
+
 #include "bootutil/boot_hooks.h"
 
 BOOT_LOG_MODULE_DECLARE(mcuboot);
@@ -96,6 +105,62 @@ BOOT_LOG_MODULE_DECLARE(mcuboot);
 #define MCUBOOT_SERIAL_MAX_RECEIVE_SIZE 512
 #endif
 
+#if defined(MCUBOOT_SERIAL_ERASE_AHEAD) && !defined(MCUBOOT_ERASE_PROGRESSIVELY)
+#error "MCUBOOT_SERIAL_ERASE_AHEAD requires MCUBOOT_ERASE_PROGRESSIVELY"
+#endif
+
+#if defined(MCUBOOT_SERIAL_UPLOAD_RESUME) && !defined(MCUBOOT_ERASE_PROGRESSIVELY)
+#error "MCUBOOT_SERIAL_UPLOAD_RESUME requires MCUBOOT_ERASE_PROGRESSIVELY"
+#endif
+
+#ifdef MCUBOOT_SERIAL_UPLOAD_RESUME
+/* Minimum amount of data uploaded between two progress records. */
+#ifndef MCUBOOT_SERIAL_UPLOAD_RESUME_INTERVAL
+#define MCUBOOT_SERIAL_UPLOAD_RESUME_INTERVAL 0x4000
+#endif
+#endif
+
+#ifdef MCUBOOT_SERIAL_DECOMPRESS
+#if !defined(MCUBOOT_DECOMPRESS_IMAGES)
+#error "MCUBOOT_SERIAL_DECOMPRESS requires MCUBOOT_DECOMPRESS_IMAGES"
+#endif
+#if defined(MCUBOOT_SERIAL_DIRECT_IMAGE_UPLOAD)
+#error "MCUBOOT_SERIAL_DECOMPRESS is not compatible with MCUBOOT_SERIAL_DIRECT_IMAGE_UPLOAD"
+#endif
+#endif
+
+#if defined(MCUBOOT_SERIAL_ASYNC_WRITE) && !defined(MCUBOOT_FLASH_AREA_WRITE_ASYNC)
+#error "MCUBOOT_SERIAL_ASYNC_WRITE requires MCUBOOT_FLASH_AREA_WRITE_ASYNC"
+#endif
+
+#ifdef MCUBOOT_SERIAL_BACKGROUND_ERASE
+/* Number of flash areas that can be erased, or kept the status of, at once. */
+#ifndef MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS
+#define MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS 2
+#endif
+#endif
+
+#ifdef MCUBOOT_SERIAL_RAM_UPLOAD
+#ifndef MCUBOOT_RAM_LOAD
+#error "MCUBOOT_SERIAL_RAM_UPLOAD requires MCUBOOT_RAM_LOAD"
+#endif
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+#error "MCUBOOT_SERIAL_RAM_UPLOAD is not compatible with MCUBOOT_RAM_LOAD_SEGMENTS"
+#endif
+/* Uploads to the image number following the last image go to RAM. */
+#define BS_RAM_UPLOAD_IMAGE BOOT_IMAGE_NUMBER
+#endif
+
+#ifdef MCUBOOT_SERIAL_BAUD_SWITCH
+#ifndef MCUBOOT_UPTIME_MS
+#error "MCUBOOT_SERIAL_BAUD_SWITCH requires MCUBOOT_UPTIME_MS"
+#endif
+/* Time the host has to send a valid frame at the new baud rate. */
+#ifndef MCUBOOT_SERIAL_BAUD_TIMEOUT_MS
+#define MCUBOOT_SERIAL_BAUD_TIMEOUT_MS 1000
+#endif
+#endif
+
 #ifdef MCUBOOT_SERIAL_IMG_GRP_IMAGE_STATE
 #define BOOT_SERIAL_IMAGE_STATE_SIZE_MAX 48
 #else
@@ -154,22 +219,64 @@ BOOT_LOG_MODULE_DECLARE(mcuboot);
 #define IMAGES_ITER(x)
 #endif
 
-static char in_buf[MCUBOOT_SERIAL_MAX_RECEIVE_SIZE + 1];
-static char dec_buf[MCUBOOT_SERIAL_MAX_RECEIVE_SIZE + 1];
+BS_STATIC char in_buf[MCUBOOT_SERIAL_MAX_RECEIVE_SIZE + 1];
+#if defined(MCUBOOT_SERIAL_UNALIGNED_BUFFER_SIZE) && MCUBOOT_SERIAL_UNALIGNED_BUFFER_SIZE > 0
+/* Packets are decoded bs_dec_shift bytes into the decode buffer, chosen
+ * from where the data of the previous upload chunk was so that the data of
+ * the next one, which hosts place the same way, can be written to flash
+ * straight from the buffer instead of through wbs_aligned.
+ */
+#define BS_DEC_SLACK    BOOT_MAX_ALIGN
+#define BS_DEC_BUF_SZ   ((MCUBOOT_SERIAL_MAX_RECEIVE_SIZE + 1 + BS_DEC_SLACK + \
+                          BOOT_MAX_ALIGN - 1) / BOOT_MAX_ALIGN * BOOT_MAX_ALIGN)
+#define BS_DEC_PKT      (dec_buf + bs_dec_shift)
+BS_STATIC uint8_t bs_dec_shift;
+#else
+#define BS_DEC_BUF_SZ   (MCUBOOT_SERIAL_MAX_RECEIVE_SIZE + 1)
+#define BS_DEC_PKT      dec_buf
+#endif
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+/* An upload chunk is programmed from one of these buffers while the next
+ * command is received and decoded into the other one.
+ */
+BS_STATIC char dec_bufs[2][BS_DEC_BUF_SZ] __attribute__((aligned(BOOT_MAX_ALIGN)));
+BS_STATIC uint8_t dec_buf_idx;                    /* Buffer commands are decoded to */
+#define dec_buf (dec_bufs[dec_buf_idx])
+BS_STATIC const struct flash_area *bs_write_fap;  /* Area being written, if any */
+BS_STATIC bool bs_write_close;                    /* Area to be closed once written */
+BS_STATIC const char *bs_write_buf;               /* Buffer being written from */
+BS_STATIC int bs_write_rc;                        /* Status of the last write */
+#else
+BS_STATIC char dec_buf[BS_DEC_BUF_SZ] __attribute__((aligned(BOOT_MAX_ALIGN)));
+#endif
+#if !defined(__BOOTSIM__)
 const struct boot_uart_funcs *boot_uf;
-static struct nmgr_hdr *bs_hdr;
-static bool bs_entry;
+#else
+__thread const struct boot_uart_funcs *boot_uf;
+#endif
+BS_STATIC struct nmgr_hdr *bs_hdr;
+BS_STATIC struct nmgr_hdr bs_hdr_buf;  /* The packet may not be aligned */
+BS_STATIC bool bs_entry;
+
+BS_STATIC char bs_obuf[BOOT_SERIAL_OUT_MAX];
+
+#ifdef MCUBOOT_SERIAL_RAW_FRAMING
+BS_STATIC bool bs_raw;              /* Current request uses raw framing */
+#endif
 
-static char bs_obuf[BOOT_SERIAL_OUT_MAX];
+#ifdef MCUBOOT_SERIAL_BAUD_SWITCH
+BS_STATIC bool bs_baud_pending;       /* New baud rate not confirmed yet */
+BS_STATIC uint32_t bs_baud_deadline;  /* Uptime at which it is given up */
+#endif
 
 static void boot_serial_output(void);
 
-#ifdef MCUBOOT_SERIAL_IMG_GRP_HASH
+#if defined(MCUBOOT_SERIAL_IMG_GRP_HASH) || defined(MCUBOOT_SERIAL_UPLOAD_HASH)
 static int boot_serial_get_hash(const struct image_header *hdr,
                                 const struct flash_area *fap, uint8_t *hash);
 #endif
 
-static zcbor_state_t cbor_state[2];
+BS_STATIC zcbor_state_t cbor_state[2];
 
 void reset_cbor_state(void)
 {
@@ -234,6 +341,8 @@ bs_list_img_ver(char *dst, int maxlen, struct image_version *ver)
 {
     int off;
 
+    (void)maxlen;
+
     off = u32toa(dst, ver->iv_major);
     dst[off++] = '.';
     off += u32toa(dst + off, ver->iv_minor);
@@ -263,6 +372,226 @@ bs_list_img_ver(char *dst, int maxlen, struct image_version *ver)
 }
 #endif /* !MCUBOOT_USE_SNPRINTF */
 
+#ifdef MCUBOOT_SERIAL_UPLOAD_HASH
+/*
+ * Hash of the last uploaded image, computed from its chunks as they are
+ * written so that listing it does not take another pass over the slot.
+ */
+BS_STATIC struct {
+    bootutil_sha_context sha;
+    bool active;                    /* Chunks are being hashed */
+    bool valid;                     /* hash matches the image hash TLV */
+    int area_id;                    /* Flash area the image is uploaded to */
+    uint32_t hash_len;              /* Size of the hashed part of the image */
+    struct image_header hdr;
+    uint8_t hash[IMAGE_HASH_SIZE];
+} bs_upload_hash;
+
+static void
+bs_upload_hash_abort(void)
+{
+    if (bs_upload_hash.active) {
+        bootutil_sha_drop(&bs_upload_hash.sha);
+        bs_upload_hash.active = false;
+    }
+    bs_upload_hash.valid = false;
+}
+
+/*
+ * Starts hashing an upload from its first chunk. Images whose hash can not
+ * be computed from the uploaded data (encrypted or chunk-hashed ones) are
+ * not hashed.
+ */
+static void
+bs_upload_hash_start(const struct flash_area *fap, const uint8_t *chunk,
+                     size_t chunk_len, size_t img_size)
+{
+    struct image_header *hdr = &bs_upload_hash.hdr;
+    uint32_t hash_len;
+
+    bs_upload_hash_abort();
+
+    if (chunk_len < sizeof(*hdr)) {
+        return;
+    }
+
+    memcpy(hdr, chunk, sizeof(*hdr));
+    if (hdr->ih_magic != IMAGE_MAGIC || IS_ENCRYPTED(hdr) ||
+        (hdr->ih_flags & IMAGE_F_HASH_CHUNKED)) {
+        return;
+    }
+
+    hash_len = (uint32_t)hdr->ih_hdr_size + hdr->ih_protect_tlv_size;
+    if (hdr->ih_img_size > img_size || hash_len > img_size - hdr->ih_img_size) {
+        return;
+    }
+
+    bs_upload_hash.hash_len = hash_len + hdr->ih_img_size;
+    bs_upload_hash.area_id = flash_area_get_id(fap);
+    bootutil_sha_init(&bs_upload_hash.sha);
+    bs_upload_hash.active = true;
+}
+
+/*
+ * Hashes a chunk about to be written at off, chunks being written in order.
+ */
+static void
+bs_upload_hash_update(const struct flash_area *fap, uint32_t off,
+                      const uint8_t *chunk, size_t chunk_len)
+{
+    if (!bs_upload_hash.active || off >= bs_upload_hash.hash_len ||
+        bs_upload_hash.area_id != flash_area_get_id(fap)) {
+        return;
+    }
+
+    if (chunk_len > bs_upload_hash.hash_len - off) {
+        chunk_len = bs_upload_hash.hash_len - off;
+    }
+    bootutil_sha_update(&bs_upload_hash.sha, chunk, chunk_len);
+}
+
+/*
+ * Completes the hash once the whole image is written, and keeps it if it
+ * matches the hash TLV of the image.
+ */
+static void
+bs_upload_hash_finish(const struct flash_area *fap)
+{
+    uint8_t tlv_hash[IMAGE_HASH_SIZE];
+
+    if (!bs_upload_hash.active ||
+        bs_upload_hash.area_id != flash_area_get_id(fap)) {
+        return;
+    }
+
+    bootutil_sha_finish(&bs_upload_hash.sha, bs_upload_hash.hash);
+    bootutil_sha_drop(&bs_upload_hash.sha);
+    bs_upload_hash.active = false;
+
+    if (boot_serial_get_hash(&bs_upload_hash.hdr, fap, tlv_hash) == 0 &&
+        memcmp(tlv_hash, bs_upload_hash.hash, sizeof(tlv_hash)) == 0) {
+        bs_upload_hash.valid = true;
+    } else {
+        BOOT_LOG_WRN("Uploaded image does not match its hash");
+    }
+}
+#endif /* MCUBOOT_SERIAL_UPLOAD_HASH */
+
+/*
+ * Validates the image in a slot. The hash of the last uploaded image is
+ * reused if the slot still holds it, leaving only its TLVs to check.
+ */
+static fih_ret
+bs_validate_image(struct image_header *hdr, const struct flash_area *fap,
+                  uint8_t *tmpbuf, uint32_t tmpbuf_sz)
+{
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+#ifdef MCUBOOT_SERIAL_UPLOAD_HASH
+    if (bs_upload_hash.valid &&
+        bs_upload_hash.area_id == flash_area_get_id(fap) &&
+        memcmp(&bs_upload_hash.hdr, hdr, sizeof(*hdr)) == 0) {
+        FIH_CALL(bootutil_img_validate_digest, fih_rc, 0, hdr, fap, tmpbuf,
+                 tmpbuf_sz, bs_upload_hash.hash);
+        FIH_RET(fih_rc);
+    }
+#endif
+
+    FIH_CALL(bootutil_img_validate, fih_rc, NULL, 0, hdr, fap, tmpbuf,
+             tmpbuf_sz, NULL, 0, NULL);
+    FIH_RET(fih_rc);
+}
+
+#ifdef MCUBOOT_SERIAL_SLOT_CACHE
+/*
+ * Result of the check of the image in each slot for the image list, kept
+ * until a request which may write the slots, so that hosts polling the list
+ * do not have the images validated and hashed again. An entry is only used
+ * if the slot still starts with the header it was filled from.
+ */
+BS_STATIC struct bs_slot_cache_entry {
+    bool valid;
+    struct image_header hdr;        /* Header as read from the slot */
+    fih_ret fih_rc;                 /* Result of the image check */
+#ifdef MCUBOOT_SERIAL_IMG_GRP_HASH
+    int hash_rc;
+    uint8_t hash[IMAGE_HASH_SIZE];
+#endif
+} bs_slot_cache[BOOT_IMAGE_NUMBER][BOOT_NUM_SLOTS];
+
+static void
+bs_slot_cache_invalidate(void)
+{
+    memset(bs_slot_cache, 0, sizeof(bs_slot_cache));
+}
+#endif
+
+/*
+ * Checks the image in a slot for the image list and, with
+ * MCUBOOT_SERIAL_IMG_GRP_HASH, gets its hash. The header may be updated.
+ */
+static fih_ret
+bs_list_check(uint8_t image_index, uint32_t slot, const struct flash_area *fap,
+              struct image_header *hdr, uint8_t *hash, int *hash_rc)
+{
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+    uint8_t tmpbuf[64];
+
+    /* Only used by the hooks. */
+    (void)image_index;
+    (void)slot;
+
+    if (hdr->ih_magic == IMAGE_MAGIC)
+    {
+        BOOT_HOOK_CALL_FIH(boot_image_check_hook,
+                           FIH_BOOT_HOOK_REGULAR,
+                           fih_rc, image_index, slot);
+        if (FIH_EQ(fih_rc, FIH_BOOT_HOOK_REGULAR))
+        {
+#if defined(MCUBOOT_ENC_IMAGES)
+#if !defined(MCUBOOT_SINGLE_APPLICATION_SLOT)
+            if (IS_ENCRYPTED(hdr) && MUST_DECRYPT(fap, image_index, hdr)) {
+                FIH_CALL(boot_image_validate_encrypted, fih_rc, fap,
+                         hdr, tmpbuf, sizeof(tmpbuf));
+            } else {
+#endif
+                if (IS_ENCRYPTED(hdr)) {
+                    /*
+                     * There is an image present which has an encrypted flag set but is
+                     * not encrypted, therefore remove the flag from the header and run a
+                     * normal image validation on it.
+                     */
+                    hdr->ih_flags &= ~ENCRYPTIONFLAGS;
+                }
+#endif
+
+                FIH_CALL(bs_validate_image, fih_rc, hdr, fap, tmpbuf,
+                         sizeof(tmpbuf));
+#if defined(MCUBOOT_ENC_IMAGES) && !defined(MCUBOOT_SINGLE_APPLICATION_SLOT)
+            }
+#endif
+        }
+    }
+
+#ifdef MCUBOOT_SERIAL_IMG_GRP_HASH
+    if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+        /* Retrieve hash of image for identification */
+        *hash_rc = boot_serial_get_hash(hdr, fap, hash);
+    }
+#else
+    (void)hash;
+    (void)hash_rc;
+#endif
+
+    FIH_RET(fih_rc);
+}
+
+#ifdef MCUBOOT_SERIAL_IMG_GRP_HASH
+#define BS_LIST_HASH hash
+#else
+#define BS_LIST_HASH NULL
+#endif
+
 /*
  * List images.
  */
@@ -277,6 +606,9 @@ bs_list(char *buf, int len)
     uint8_t hash[IMAGE_HASH_SIZE];
 #endif
 
+    (void)buf;
+    (void)len;
+
     zcbor_map_start_encode(cbor_state, 1);
     zcbor_tstr_put_lit_cast(cbor_state, "images");
     zcbor_list_start_encode(cbor_state, 5);
@@ -289,6 +621,9 @@ bs_list(char *buf, int len)
         for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
             FIH_DECLARE(fih_rc, FIH_FAILURE);
             uint8_t tmpbuf[64];
+#ifdef MCUBOOT_SERIAL_SLOT_CACHE
+            struct bs_slot_cache_entry *entry = &bs_slot_cache[image_index][slot];
+#endif
 
 #ifdef MCUBOOT_SERIAL_IMG_GRP_IMAGE_STATE
             bool active = false;
@@ -309,48 +644,34 @@ bs_list(char *buf, int len)
                 flash_area_read(fap, 0, &hdr, sizeof(hdr));
             }
 
-            if (hdr.ih_magic == IMAGE_MAGIC)
-            {
-                BOOT_HOOK_CALL_FIH(boot_image_check_hook,
-                                   FIH_BOOT_HOOK_REGULAR,
-                                   fih_rc, image_index, slot);
-                if (FIH_EQ(fih_rc, FIH_BOOT_HOOK_REGULAR))
-                {
-#if defined(MCUBOOT_ENC_IMAGES)
-#if !defined(MCUBOOT_SINGLE_APPLICATION_SLOT)
-                    if (IS_ENCRYPTED(&hdr) && MUST_DECRYPT(fap, image_index, &hdr)) {
-                        FIH_CALL(boot_image_validate_encrypted, fih_rc, fap,
-                                 &hdr, tmpbuf, sizeof(tmpbuf));
-                    } else {
-#endif
-                        if (IS_ENCRYPTED(&hdr)) {
-                            /*
-                             * There is an image present which has an encrypted flag set but is
-                             * not encrypted, therefore remove the flag from the header and run a
-                             * normal image validation on it.
-                             */
-                            hdr.ih_flags &= ~ENCRYPTIONFLAGS;
-                        }
+#ifdef MCUBOOT_SERIAL_SLOT_CACHE
+            if (entry->valid && memcmp(&entry->hdr, &hdr, sizeof(hdr)) == 0) {
+                fih_rc = entry->fih_rc;
+#ifdef MCUBOOT_SERIAL_IMG_GRP_HASH
+                rc = entry->hash_rc;
+                memcpy(hash, entry->hash, sizeof(hash));
 #endif
-
-                        FIH_CALL(bootutil_img_validate, fih_rc, NULL, 0, &hdr,
-                                 fap, tmpbuf, sizeof(tmpbuf), NULL, 0, NULL);
-#if defined(MCUBOOT_ENC_IMAGES) && !defined(MCUBOOT_SINGLE_APPLICATION_SLOT)
-                    }
+            } else {
+                memcpy(&entry->hdr, &hdr, sizeof(hdr));
+                FIH_CALL(bs_list_check, fih_rc, image_index, slot, fap, &hdr,
+                         BS_LIST_HASH, &rc);
+                entry->fih_rc = fih_rc;
+#ifdef MCUBOOT_SERIAL_IMG_GRP_HASH
+                entry->hash_rc = rc;
+                memcpy(entry->hash, hash, sizeof(hash));
 #endif
-                }
+                entry->valid = true;
             }
+#else
+            FIH_CALL(bs_list_check, fih_rc, image_index, slot, fap, &hdr,
+                     BS_LIST_HASH, &rc);
+#endif
 
             if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
                 flash_area_close(fap);
                 continue;
             }
 
-#ifdef MCUBOOT_SERIAL_IMG_GRP_HASH
-            /* Retrieve hash of image for identification */
-            rc = boot_serial_get_hash(&hdr, fap, hash);
-#endif
-
             flash_area_close(fap);
             zcbor_map_start_encode(cbor_state, 20);
 
@@ -522,8 +843,8 @@ bs_set(char *buf, int len)
                                  &hdr, tmpbuf, sizeof(tmpbuf));
                     } else {
 #endif
-                        FIH_CALL(bootutil_img_validate, fih_rc, NULL, 0, &hdr,
-                                 fap, tmpbuf, sizeof(tmpbuf), NULL, 0, NULL);
+                        FIH_CALL(bs_validate_image, fih_rc, &hdr, fap, tmpbuf,
+                                 sizeof(tmpbuf));
 #ifdef MCUBOOT_ENC_IMAGES
                     }
 #endif
@@ -732,6 +1053,19 @@ finish:
 }
 #endif
 
+/*
+ * Drops the TLV indexes built by the image checks before a slot is erased or
+ * written, so that the next check does not use the TLV layout of the image
+ * it held before.
+ */
+static void
+bs_tlv_index_invalidate(void)
+{
+#ifdef MCUBOOT_TLV_INDEX
+    bootutil_tlv_index_invalidate(NULL);
+#endif
+}
+
 #ifdef MCUBOOT_ERASE_PROGRESSIVELY
 /** Erases range of flash, aligned to sector size
  *
@@ -770,6 +1104,7 @@ static off_t erase_range(const struct flash_area *fap, off_t start, off_t end)
     BOOT_LOG_DBG("Erasing range 0x%jx:0x%jx", (intmax_t)start,
 		 (intmax_t)(start + size - 1));
 
+    bs_tlv_index_invalidate();
     rc = flash_area_erase(fap, start, size);
     if (rc != 0) {
         BOOT_LOG_ERR("Error %d while erasing range", rc);
@@ -780,93 +1115,1086 @@ static off_t erase_range(const struct flash_area *fap, off_t start, off_t end)
 }
 #endif
 
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
 /*
- * Image upload request.
+ * Waits for the upload chunk being programmed, if any. A failure is kept
+ * until it is reported by the next upload request.
  */
 static void
-bs_upload(char *buf, int len)
+bs_upload_wait(void)
 {
-    static size_t img_size;             /* Total image size, held for duration of upload */
-    static uint32_t curr_off;           /* Expected current offset */
-    const uint8_t *img_chunk = NULL;    /* Pointer to buffer with received image chunk */
-    size_t img_chunk_len = 0;           /* Length of received image chunk */
-    size_t img_chunk_off = SIZE_MAX;    /* Offset of image chunk within image  */
-    size_t rem_bytes;                   /* Reminder bytes after aligning chunk write to
-                                         * to flash alignment */
-    uint32_t img_num_tmp = UINT_MAX;    /* Temp variable for image number */
-    static uint32_t img_num = 0;
-    size_t img_size_tmp = SIZE_MAX;     /* Temp variable for image size */
-    const struct flash_area *fap = NULL;
     int rc;
-    struct zcbor_string img_chunk_data;
-    size_t decoded = 0;
-    bool ok;
-#ifdef MCUBOOT_ERASE_PROGRESSIVELY
-    static off_t not_yet_erased = 0;    /* Offset of next byte to erase; writes to flash
-                                         * are done in consecutive manner and erases are done
-                                         * to allow currently received chunk to be written;
-                                         * this state variable holds information where last
-                                         * erase has stopped to let us know whether erase
-                                         * is needed to be able to write current chunk.
-                                         */
-    static struct flash_sector status_sector;
-#endif
-
-    zcbor_state_t zsd[4];
-    zcbor_new_state(zsd, sizeof(zsd) / sizeof(zcbor_state_t), (uint8_t *)buf, len, 1, NULL, 0);
 
-    struct zcbor_map_decode_key_val image_upload_decode[] = {
-        ZCBOR_MAP_DECODE_KEY_DECODER("image", zcbor_uint32_decode, &img_num_tmp),
-        ZCBOR_MAP_DECODE_KEY_DECODER("data", zcbor_bstr_decode, &img_chunk_data),
-        ZCBOR_MAP_DECODE_KEY_DECODER("len", zcbor_size_decode, &img_size_tmp),
-        ZCBOR_MAP_DECODE_KEY_DECODER("off", zcbor_size_decode, &img_chunk_off),
-    };
+    if (bs_write_fap == NULL) {
+        return;
+    }
 
-    ok = zcbor_map_decode_bulk(zsd, image_upload_decode, ARRAY_SIZE(image_upload_decode),
-                               &decoded) == 0;
+    rc = flash_area_write_wait(bs_write_fap);
+    if (rc != 0) {
+        BOOT_LOG_ERR("Error %d while writing upload chunk", rc);
+        bs_write_rc = rc;
+    }
 
-    if (!ok) {
-        goto out_invalid_data;
+    if (bs_write_close) {
+        flash_area_close(bs_write_fap);
+        bs_write_close = false;
     }
+    bs_write_fap = NULL;
+    bs_write_buf = NULL;
+}
 
-    img_chunk = img_chunk_data.value;
-    img_chunk_len = img_chunk_data.len;
+/*
+ * Switches to the decode buffer the last upload chunk is not written from.
+ */
+static void
+bs_swap_dec_buf(void)
+{
+    dec_buf_idx ^= 1;
+    if (dec_buf == bs_write_buf) {
+        bs_upload_wait();
+    }
+}
+#endif
 
-    /*
-     * Expected data format.
-     * {
-     *   "image":<image number in a multi-image set (OPTIONAL)>
-     *   "data":<image data>
-     *   "len":<image len>
-     *   "off":<current offset of image data>
-     * }
-     */
+/*
+ * Writes an aligned upload chunk. With MCUBOOT_SERIAL_ASYNC_WRITE this only
+ * starts the write, which is waited for before the flash or the decode
+ * buffer holding the chunk are used again.
+ */
+static int
+bs_upload_write(const struct flash_area *fap, uint32_t off,
+                const uint8_t *chunk, size_t len)
+{
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+    int rc;
 
-    if (img_chunk_off == SIZE_MAX || img_chunk == NULL) {
-        /*
-         * Offset must be set in every block.
-         */
-        goto out_invalid_data;
+    bs_tlv_index_invalidate();
+    if (len == 0) {
+        return 0;
     }
 
-    /* Use image number only from packet with offset == 0. */
-    if (img_chunk_off == 0) {
-        if (img_num_tmp != UINT_MAX) {
-            img_num = img_num_tmp;
-        } else {
-            img_num = 0;
-        }
+    rc = flash_area_write_async(fap, off, chunk, len);
+    if (rc == 0) {
+        bs_write_fap = fap;
+        bs_write_buf = dec_buf;
     }
 
-#if !defined(MCUBOOT_SERIAL_DIRECT_IMAGE_UPLOAD)
-    rc = flash_area_open(flash_area_id_from_multi_image_slot(img_num, 0), &fap);
+    return rc;
 #else
-    rc = flash_area_open(flash_area_id_from_direct_image(img_num), &fap);
+    bs_tlv_index_invalidate();
+    return flash_area_write(fap, off, chunk, len);
+#endif
+}
+
+#ifdef MCUBOOT_SERIAL_DECOMPRESS
+/*
+ * A compressed image is uploaded to the secondary slot of the image, and
+ * decompressed into its primary slot once all of it is received.
+ */
+static bool
+bs_upload_is_compressed(const uint8_t *chunk, size_t len)
+{
+    struct image_header hdr;
+
+    if (len < sizeof(hdr)) {
+        return false;
+    }
+    memcpy(&hdr, chunk, sizeof(hdr));
+
+    return hdr.ih_magic == IMAGE_MAGIC && IS_COMPRESSED(&hdr);
+}
+
+/*
+ * Decompresses the image uploaded to fap into the primary slot of img_num,
+ * then erases its header from fap.
+ */
+static int
+bs_upload_decompress(uint32_t img_num, const struct flash_area *fap)
+{
+    const struct flash_area *fap_dst = NULL;
+    struct image_header hdr;
+    struct flash_sector sect;
+    uint32_t align;
+    uint32_t size;
+    int rc;
+
+    rc = boot_image_load_header(fap, &hdr);
+    if (rc != 0) {
+        return rc;
+    }
+
+    /* Image keys are not available here. */
+    if (IS_ENCRYPTED(&hdr)) {
+        BOOT_LOG_ERR("Encrypted compressed images can not be uploaded");
+        return BOOT_EBADIMAGE;
+    }
+
+    rc = flash_area_open(flash_area_id_from_multi_image_slot(img_num, 0),
+                         &fap_dst);
+    if (rc != 0) {
+        return rc;
+    }
+
+    align = flash_area_align(fap_dst);
+    if (!boot_check_compressed_header(img_num, &hdr, fap, fap_dst, align) ||
+        boot_decompressed_image_size(&hdr, fap, &size) != 0) {
+        rc = BOOT_EBADIMAGE;
+        goto out;
+    }
+
+#ifdef MCUBOOT_ERASE_PROGRESSIVELY
+    /* Only the part taken by the image, and the trailer. */
+    if (erase_range(fap_dst, 0, size - 1) < 0 ||
+        flash_area_get_sector(fap_dst, boot_status_off(fap_dst), &sect) != 0 ||
+        erase_range(fap_dst, flash_sector_get_off(&sect),
+                    flash_sector_get_off(&sect)) < 0) {
+        rc = BOOT_EFLASH;
+        goto out;
+    }
+#else
+    bs_tlv_index_invalidate();
+    rc = flash_area_erase(fap_dst, 0, flash_area_get_size(fap_dst));
+    if (rc != 0) {
+        goto out;
+    }
+#endif
+
+    rc = boot_decompress_image(img_num, &hdr, fap, fap_dst, align, NULL);
+    if (rc != 0) {
+        goto out;
+    }
+
+    /* The compressed image is not an upgrade candidate. */
+    rc = flash_area_get_sector(fap, 0, &sect);
+    if (rc == 0) {
+        bs_tlv_index_invalidate();
+        rc = flash_area_erase(fap, 0, flash_sector_get_size(&sect));
+    }
+
+out:
+    flash_area_close(fap_dst);
+    return rc;
+}
+#endif /* MCUBOOT_SERIAL_DECOMPRESS */
+
+#ifdef MCUBOOT_SERIAL_UPLOAD_RESUME
+/*
+ * Progress records are written, in the status area of the slot trailer,
+ * every interval bytes of the upload, which must not reach the sector of
+ * that area. The records are erased with that sector once the upload
+ * completes. A record always holds the offset of a sector: data written
+ * after it in the sector may be partial, so the sector is erased again
+ * when the upload is resumed from the record.
+ */
+BS_STATIC struct {
+    bool enabled;               /* Records are written for this upload */
+    int area_id;                /* Flash area the upload is written to */
+    uint32_t idx;               /* Index of the next record */
+    uint32_t next_off;          /* Offset at which the next record is due */
+    uint32_t interval;
+} bs_resume;
+
+static uint32_t
+bs_resume_rec_sz(const struct flash_area *fap)
+{
+    uint32_t align = flash_area_align(fap);
+
+    return (sizeof(struct bs_resume_record) + align - 1) / align * align;
+}
+
+static uint32_t
+bs_resume_rec_cnt(const struct flash_area *fap)
+{
+    return boot_status_sz(flash_area_align(fap)) / bs_resume_rec_sz(fap);
+}
+
+/*
+ * Reads the last valid progress record of the slot. Returns 0 if there is
+ * one, with the index of the next free record in next_idx.
+ */
+static int
+bs_resume_read(const struct flash_area *fap, struct bs_resume_record *last,
+               uint32_t *next_idx)
+{
+    struct bs_resume_record rec;
+    uint32_t cnt = bs_resume_rec_cnt(fap);
+    uint32_t off = boot_status_off(fap);
+    uint32_t idx;
+    int rc = -1;
+
+    for (idx = 0; idx < cnt; idx++) {
+        if (flash_area_read(fap, off + idx * bs_resume_rec_sz(fap), &rec,
+                            sizeof(rec)) != 0 ||
+            rec.magic != BOOT_SERIAL_RESUME_MAGIC) {
+            break;
+        }
+        if (rec.check == ~(rec.img_size ^ rec.off) && rec.off < rec.img_size) {
+            *last = rec;
+            rc = 0;
+        }
+    }
+
+    *next_idx = idx;
+    return rc;
+}
+
+/*
+ * Prepares writing progress records for an upload of img_size bytes, the
+ * first record being idx; status_sector is the sector holding the records.
+ */
+static void
+bs_resume_start(const struct flash_area *fap, size_t img_size, uint32_t idx,
+                const struct flash_sector *status_sector)
+{
+    uint32_t cnt = bs_resume_rec_cnt(fap);
+
+    bs_resume.enabled = (img_size <= flash_sector_get_off(status_sector) &&
+                         cnt > 0);
+    bs_resume.area_id = flash_area_get_id(fap);
+    bs_resume.idx = idx;
+    bs_resume.interval = MAX(MCUBOOT_SERIAL_UPLOAD_RESUME_INTERVAL,
+                             img_size / (cnt + 1) + 1);
+    bs_resume.next_off = bs_resume.interval;
+}
+
+/*
+ * Records that the image has been written up to the start of the sector
+ * holding curr_off, if a record is due.
+ */
+static void
+bs_resume_checkpoint(const struct flash_area *fap, uint32_t curr_off,
+                     size_t img_size)
+{
+    struct bs_resume_record rec;
+    struct flash_sector sect;
+    uint8_t buf[(sizeof(rec) + BOOT_MAX_ALIGN - 1) / BOOT_MAX_ALIGN * BOOT_MAX_ALIGN];
+    uint32_t rec_sz = bs_resume_rec_sz(fap);
+    uint32_t off;
+
+    if (!bs_resume.enabled || bs_resume.area_id != flash_area_get_id(fap) ||
+        curr_off < bs_resume.next_off ||
+        curr_off >= img_size || bs_resume.idx >= bs_resume_rec_cnt(fap) ||
+        rec_sz > sizeof(buf) ||
+        flash_area_get_sector(fap, curr_off, &sect) != 0) {
+        return;
+    }
+
+    off = flash_sector_get_off(&sect);
+    if (off < bs_resume.next_off) {
+        return;
+    }
+
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+    /* Only data that is written can be recorded. */
+    bs_upload_wait();
+    if (bs_write_rc != 0) {
+        return;
+    }
+#endif
+
+    rec.magic = BOOT_SERIAL_RESUME_MAGIC;
+    rec.img_size = img_size;
+    rec.off = off;
+    rec.check = ~(rec.img_size ^ rec.off);
+
+    memset(buf, flash_area_erased_val(fap), sizeof(buf));
+    memcpy(buf, &rec, sizeof(rec));
+    if (flash_area_write(fap, boot_status_off(fap) + bs_resume.idx * rec_sz,
+                         buf, rec_sz) != 0) {
+        /* Possibly torn, no more records can follow it. */
+        bs_resume.enabled = false;
+        return;
+    }
+
+    bs_resume.idx++;
+    bs_resume.next_off = off + bs_resume.interval;
+}
+
+/*
+ * Upload resume query.
+ *
+ * Reports the offset an interrupted upload, even across a reset, can be
+ * continued from, the size of the image and the hash of the part of it
+ * already written, which the host checks against its own image.
+ */
+static void
+bs_upload_resume(char *buf, int len)
+{
+    struct bs_resume_record rec = { 0 };
+    const struct flash_area *fap = NULL;
+    bootutil_sha_context sha;
+    uint8_t hash[IMAGE_HASH_SIZE];
+    uint8_t tmpbuf[256];
+    uint32_t img_num = 0;
+    uint32_t next_idx;
+    uint32_t off;
+    uint32_t blk_sz;
+    size_t decoded = 0;
+    int rc;
+
+    zcbor_state_t zsd[4];
+    zcbor_new_state(zsd, sizeof(zsd) / sizeof(zcbor_state_t), (uint8_t *)buf, len, 1, NULL, 0);
+
+    struct zcbor_map_decode_key_val image_resume_decode[] = {
+        ZCBOR_MAP_DECODE_KEY_DECODER("image", zcbor_uint32_decode, &img_num),
+    };
+
+    if (len > 0 && zcbor_map_decode_bulk(zsd, image_resume_decode,
+                                         ARRAY_SIZE(image_resume_decode),
+                                         &decoded) != 0) {
+        rc = MGMT_ERR_EINVAL;
+        goto out;
+    }
+
+#if !defined(MCUBOOT_SERIAL_DIRECT_IMAGE_UPLOAD)
+    rc = flash_area_open(flash_area_id_from_multi_image_slot(img_num, 0), &fap);
+#else
+    rc = flash_area_open(flash_area_id_from_direct_image(img_num), &fap);
+#endif
+    if (rc) {
+        rc = MGMT_ERR_EINVAL;
+        goto out;
+    }
+
+    if (bs_resume_read(fap, &rec, &next_idx) != 0) {
+        rec.off = 0;
+        rec.img_size = 0;
+    }
+
+    bootutil_sha_init(&sha);
+    for (off = 0; off < rec.off; off += blk_sz) {
+        blk_sz = MIN(sizeof(tmpbuf), rec.off - off);
+        boot_watchdog_feed(blk_sz);
+        rc = flash_area_read(fap, off, tmpbuf, blk_sz);
+        if (rc) {
+            break;
+        }
+        bootutil_sha_update(&sha, tmpbuf, blk_sz);
+    }
+    bootutil_sha_finish(&sha, hash);
+    bootutil_sha_drop(&sha);
+    if (rc) {
+        rc = MGMT_ERR_EUNKNOWN;
+    }
+
+out:
+    zcbor_map_start_encode(cbor_state, 10);
+    zcbor_tstr_put_lit_cast(cbor_state, "rc");
+    zcbor_int32_put(cbor_state, rc);
+    if (rc == 0) {
+        zcbor_tstr_put_lit_cast(cbor_state, "off");
+        zcbor_uint32_put(cbor_state, rec.off);
+        zcbor_tstr_put_lit_cast(cbor_state, "len");
+        zcbor_uint32_put(cbor_state, rec.img_size);
+        zcbor_tstr_put_lit_cast(cbor_state, "sha");
+        zcbor_bstr_encode_ptr(cbor_state, (const char *)hash, sizeof(hash));
+    }
+    zcbor_map_end_encode(cbor_state, 10);
+
+    boot_serial_output();
+
+    flash_area_close(fap);
+}
+#endif /* MCUBOOT_SERIAL_UPLOAD_RESUME */
+
+#ifdef MCUBOOT_SERIAL_UPLOAD_SESSIONS
+#if defined(MCUBOOT_SERIAL_DIRECT_IMAGE_UPLOAD)
+#define BS_UPLOAD_SESSIONS (BOOT_IMAGE_NUMBER * BOOT_NUM_SLOTS)
+#else
+#define BS_UPLOAD_SESSIONS BOOT_IMAGE_NUMBER
+#endif
+#else
+#define BS_UPLOAD_SESSIONS 1
+#endif
+
+/*
+ * State of an upload, held for its duration. With MCUBOOT_SERIAL_UPLOAD_SESSIONS
+ * there is one per image number, so that the chunks of several images can be
+ * interleaved.
+ */
+struct bs_upload_session {
+    size_t img_size;                    /* Total image size */
+    uint32_t curr_off;                  /* Expected current offset */
+#ifdef MCUBOOT_ERASE_PROGRESSIVELY
+    off_t not_yet_erased;               /* Offset of next byte to erase; writes to flash
+                                         * are done in consecutive manner and erases are done
+                                         * to allow currently received chunk to be written;
+                                         * this state variable holds information where last
+                                         * erase has stopped to let us know whether erase
+                                         * is needed to be able to write current chunk.
+                                         */
+    struct flash_sector status_sector;
+#endif
+#ifdef MCUBOOT_SERIAL_DECOMPRESS
+    bool decomp;                        /* Compressed image, staged in the
+                                         * secondary slot */
+#endif
+#ifdef MCUBOOT_SERIAL_ERASE_AHEAD
+    int area_id;                        /* Flash area the image is written to */
+#endif
+};
+
+BS_STATIC struct bs_upload_session bs_sessions[BS_UPLOAD_SESSIONS];
+
+#ifdef MCUBOOT_SERIAL_ERASE_AHEAD
+/*
+ * Erases the next sector of an upload in progress which has fewer than
+ * MCUBOOT_SERIAL_ERASE_AHEAD sectors erased past its current offset.
+ * Called while no command is pending, so that the chunks that follow find
+ * their sectors erased and the host is not kept waiting by bs_upload().
+ * Returns true if a sector has been erased.
+ */
+static bool
+bs_erase_ahead(void)
+{
+    const struct flash_area *fap;
+    struct bs_upload_session *ses;
+    struct flash_sector sect;
+    off_t limit;
+    off_t erased;
+    int i;
+    int n;
+
+    for (i = 0; i < BS_UPLOAD_SESSIONS; i++) {
+        ses = &bs_sessions[i];
+        if (ses->curr_off >= ses->img_size ||
+            ses->not_yet_erased >= (off_t)ses->img_size) {
+            continue;
+        }
+
+        if (flash_area_open(ses->area_id, &fap) != 0) {
+            continue;
+        }
+
+        limit = ses->curr_off;
+        for (n = 0; n < MCUBOOT_SERIAL_ERASE_AHEAD && limit < ses->img_size;
+             n++) {
+            if (flash_area_get_sector(fap, limit, &sect) != 0) {
+                break;
+            }
+            limit = flash_sector_get_off(&sect) + flash_sector_get_size(&sect);
+        }
+
+        if (ses->not_yet_erased >= limit) {
+            flash_area_close(fap);
+            continue;
+        }
+
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+        /* Flash can not be erased while it is programmed. */
+        bs_upload_wait();
+#endif
+        erased = erase_range(fap, ses->not_yet_erased, ses->not_yet_erased);
+        flash_area_close(fap);
+        if (erased < 0) {
+            /* Left to bs_upload(), which reports the failure. */
+            continue;
+        }
+        ses->not_yet_erased = erased;
+
+        return true;
+    }
+
+    return false;
+}
+#endif
+
+#ifdef MCUBOOT_SERIAL_BACKGROUND_ERASE
+/*
+ * Erase of a flash area, done a sector at a time while no command is
+ * pending. A job is kept once done, or failed, until it is reused, so that
+ * the host can query its result.
+ */
+struct bs_erase_job {
+    int area_id;                        /* -1 if the job is free */
+    uint32_t off;                       /* Erased up to this offset */
+    uint32_t size;                      /* Size of the flash area */
+    int rc;                             /* MGMT_ERR_* result */
+};
+
+BS_STATIC struct bs_erase_job bs_erase_jobs[MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS] = {
+    [0 ... MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS - 1] = { .area_id = -1 },
+};
+BS_STATIC int bs_erase_next;            /* Job to step first, round robin */
+
+static bool
+bs_erase_pending(const struct bs_erase_job *job)
+{
+    return job->area_id >= 0 && job->rc == MGMT_ERR_OK && job->off < job->size;
+}
+
+static struct bs_erase_job *
+bs_erase_find(int area_id)
+{
+    int i;
+
+    for (i = 0; i < MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS; i++) {
+        if (bs_erase_jobs[i].area_id == area_id) {
+            return &bs_erase_jobs[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Erases the next sector of a job.
+ */
+static void
+bs_erase_job_step(struct bs_erase_job *job)
+{
+    const struct flash_area *fap;
+    struct flash_sector sect;
+    int rc;
+
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+    /* Flash can not be erased while it is programmed. */
+    bs_upload_wait();
+#endif
+
+    rc = flash_area_open(job->area_id, &fap);
+    if (rc == 0) {
+        rc = flash_area_get_sector(fap, job->off, &sect);
+        if (rc == 0) {
+            bs_tlv_index_invalidate();
+            rc = flash_area_erase(fap, flash_sector_get_off(&sect),
+                                  flash_sector_get_size(&sect));
+        }
+        if (rc == 0) {
+            job->off = flash_sector_get_off(&sect) + flash_sector_get_size(&sect);
+        }
+        flash_area_close(fap);
+    }
+
+    if (rc != 0) {
+        BOOT_LOG_ERR("Error %d while erasing area %d at 0x%x", rc,
+                     job->area_id, (unsigned int)job->off);
+        job->rc = MGMT_ERR_EUNKNOWN;
+    }
+
+    if (!bs_erase_pending(job)) {
+#ifdef MCUBOOT_SERIAL_SLOT_CACHE
+        bs_slot_cache_invalidate();
+#endif
+        BOOT_LOG_DBG("Erase of area %d done", job->area_id);
+    }
+}
+
+/*
+ * Erases a sector of one of the pending jobs, taking turns between them.
+ * Called while no command is pending. Returns true if a sector has been
+ * erased.
+ */
+static bool
+bs_erase_step(void)
+{
+    struct bs_erase_job *job;
+    int i;
+
+    for (i = 0; i < MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS; i++) {
+        job = &bs_erase_jobs[(bs_erase_next + i) % MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS];
+        if (bs_erase_pending(job)) {
+            bs_erase_job_step(job);
+            bs_erase_next = (job - bs_erase_jobs + 1) % MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Completes the pending erase of a flash area, or of all of them if
+ * area_id is negative, before it is used by a command.
+ */
+static void
+bs_erase_finish(int area_id)
+{
+    struct bs_erase_job *job;
+    int i;
+
+    for (i = 0; i < MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS; i++) {
+        job = &bs_erase_jobs[i];
+        if (area_id >= 0 && job->area_id != area_id) {
+            continue;
+        }
+        while (bs_erase_pending(job)) {
+            MCUBOOT_WATCHDOG_FEED();
+            bs_erase_job_step(job);
+        }
+    }
+}
+
+int
+bs_erase_start(int area_id)
+{
+    const struct flash_area *fap;
+    struct bs_erase_job *job;
+    int i;
+
+    job = bs_erase_find(area_id);
+    for (i = 0; job == NULL && i < MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS; i++) {
+        if (!bs_erase_pending(&bs_erase_jobs[i])) {
+            job = &bs_erase_jobs[i];
+        }
+    }
+    if (job == NULL) {
+        return MGMT_ERR_EBUSY;
+    }
+
+    if (flash_area_open(area_id, &fap) != 0) {
+        return MGMT_ERR_EINVAL;
+    }
+    job->size = flash_area_get_size(fap);
+    flash_area_close(fap);
+
+    /* Starts over if the area is already being erased. */
+    job->area_id = area_id;
+    job->off = 0;
+    job->rc = MGMT_ERR_OK;
+
+#ifdef MCUBOOT_SERIAL_SLOT_CACHE
+    bs_slot_cache_invalidate();
+#endif
+
+    return MGMT_ERR_OK;
+}
+
+int
+bs_erase_status(int area_id, uint32_t *off, uint32_t *size)
+{
+    const struct bs_erase_job *job = bs_erase_find(area_id);
+
+    if (job == NULL) {
+        return MGMT_ERR_ENOENT;
+    }
+
+    *off = job->off;
+    *size = job->size;
+
+    return job->rc;
+}
+
+/*
+ * Slot erase request, of group MGMT_GROUP_ID_BOOT_SERIAL. A write queues
+ * the erase of the slot and returns at once, a read reports its progress.
+ */
+static void
+bs_erase_slot(uint8_t op, char *buf, int len)
+{
+    uint32_t image_index = 0;
+    uint32_t slot = 1;
+    uint32_t off = 0;
+    uint32_t size = 0;
+    size_t decoded = 0;
+    int area_id;
+    int rc;
+
+    zcbor_state_t zsd[4];
+    zcbor_new_state(zsd, sizeof(zsd) / sizeof(zcbor_state_t), (uint8_t *)buf, len, 1, NULL, 0);
+
+    struct zcbor_map_decode_key_val erase_decode[] = {
+        ZCBOR_MAP_DECODE_KEY_DECODER("image", zcbor_uint32_decode, &image_index),
+        ZCBOR_MAP_DECODE_KEY_DECODER("slot", zcbor_uint32_decode, &slot),
+    };
+
+    if (len > 0 && zcbor_map_decode_bulk(zsd, erase_decode, ARRAY_SIZE(erase_decode),
+                                         &decoded) != 0) {
+        bs_rc_rsp(MGMT_ERR_EINVAL);
+        return;
+    }
+
+    if (image_index >= BOOT_IMAGE_NUMBER || slot >= BOOT_NUM_SLOTS) {
+        bs_rc_rsp(MGMT_ERR_EINVAL);
+        return;
+    }
+    area_id = flash_area_id_from_multi_image_slot(image_index, slot);
+
+    if (op == NMGR_OP_WRITE) {
+        bs_rc_rsp(bs_erase_start(area_id));
+        return;
+    }
+
+    rc = bs_erase_status(area_id, &off, &size);
+    if (rc == MGMT_ERR_ENOENT) {
+        bs_rc_rsp(rc);
+        return;
+    }
+
+    zcbor_map_start_encode(cbor_state, 10);
+    zcbor_tstr_put_lit_cast(cbor_state, "rc");
+    zcbor_int32_put(cbor_state, rc);
+    zcbor_tstr_put_lit_cast(cbor_state, "off");
+    zcbor_uint32_put(cbor_state, off);
+    zcbor_tstr_put_lit_cast(cbor_state, "len");
+    zcbor_uint32_put(cbor_state, size);
+    zcbor_map_end_encode(cbor_state, 10);
+
+    boot_serial_output();
+}
+#endif
+
+#ifdef MCUBOOT_SERIAL_RAM_UPLOAD
+/*
+ * Upload written straight to the executable RAM region, at the load address
+ * of the image, and hashed as it is received. Once the last chunk is in, the
+ * image is validated from RAM and booted on the next reset request, without
+ * any flash being written.
+ */
+BS_STATIC struct {
+    bootutil_sha_context sha;
+    bool active;                    /* Chunks are uploaded to RAM */
+    bool hashing;                   /* sha holds a hash in progress */
+    bool ready;                     /* The image in RAM is valid */
+    uint32_t curr_off;
+    uint32_t img_size;
+    uint32_t hash_len;              /* Size of the hashed part of the image */
+    uint8_t *dst;
+    struct image_header hdr;
+} bs_ram;
+
+static void
+bs_ram_abort(void)
+{
+    if (bs_ram.hashing) {
+        bootutil_sha_drop(&bs_ram.sha);
+        bs_ram.hashing = false;
+    }
+    bs_ram.ready = false;
+    bs_ram.curr_off = 0;
+}
+
+/*
+ * Checks the header in the first chunk of an upload to RAM, and that the
+ * whole image fits in the executable RAM region at its load address.
+ */
+static int
+bs_ram_start(const uint8_t *chunk, size_t chunk_len, size_t img_size)
+{
+    struct image_header *hdr = &bs_ram.hdr;
+    uint32_t ram_start;
+    uint32_t ram_size;
+    uint32_t hash_len;
+
+    bs_ram_abort();
+
+    if (chunk_len < sizeof(*hdr)) {
+        return MGMT_ERR_EINVAL;
+    }
+
+    memcpy(hdr, chunk, sizeof(*hdr));
+    if (hdr->ih_magic != IMAGE_MAGIC || IS_ENCRYPTED(hdr) ||
+        (hdr->ih_flags & IMAGE_F_HASH_CHUNKED)) {
+        BOOT_LOG_ERR("Image can not be uploaded to RAM");
+        return MGMT_ERR_EINVAL;
+    }
+
+    hash_len = (uint32_t)hdr->ih_hdr_size + hdr->ih_protect_tlv_size;
+    if (hdr->ih_img_size > img_size || hash_len > img_size - hdr->ih_img_size) {
+        return MGMT_ERR_EINVAL;
+    }
+
+#ifdef MULTIPLE_EXECUTABLE_RAM_REGIONS
+    if (boot_get_image_exec_ram_info(0, &ram_start, &ram_size) != 0) {
+        return MGMT_ERR_EUNKNOWN;
+    }
+#else
+    ram_start = IMAGE_EXECUTABLE_RAM_START;
+    ram_size = IMAGE_EXECUTABLE_RAM_SIZE;
+#endif
+    if (hdr->ih_load_addr < ram_start ||
+        hdr->ih_load_addr - ram_start > ram_size ||
+        img_size > ram_size - (hdr->ih_load_addr - ram_start)) {
+        BOOT_LOG_ERR("Image does not fit in the executable RAM region");
+        return MGMT_ERR_EINVAL;
+    }
+
+    bs_ram.dst = (uint8_t *)(IMAGE_RAM_BASE + hdr->ih_load_addr);
+    bs_ram.img_size = (uint32_t)img_size;
+    bs_ram.hash_len = hash_len + hdr->ih_img_size;
+    bootutil_sha_init(&bs_ram.sha);
+    bs_ram.hashing = true;
+
+    return 0;
+}
+
+/*
+ * Validates the image in RAM against the hash of the uploaded data. The TLVs
+ * are read from RAM, as for any RAM-loaded image.
+ */
+static int
+bs_ram_finish(void)
+{
+    const struct flash_area *fap;
+    uint8_t hash[IMAGE_HASH_SIZE];
+    uint8_t tmpbuf[64];
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    bootutil_sha_finish(&bs_ram.sha, hash);
+    bootutil_sha_drop(&bs_ram.sha);
+    bs_ram.hashing = false;
+
+    /* The image must still have the header it was checked with. */
+    if (memcmp(bs_ram.dst, &bs_ram.hdr, sizeof(bs_ram.hdr)) != 0) {
+        return MGMT_ERR_EINVAL;
+    }
+
+    if (flash_area_open(flash_area_id_from_multi_image_slot(0, 0), &fap)) {
+        return MGMT_ERR_EUNKNOWN;
+    }
+    FIH_CALL(bootutil_img_validate_digest, fih_rc, 0, &bs_ram.hdr, fap, tmpbuf,
+             sizeof(tmpbuf), hash);
+    flash_area_close(fap);
+
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        BOOT_LOG_ERR("Image uploaded to RAM is not valid");
+        return MGMT_ERR_EINVAL;
+    }
+
+    BOOT_LOG_INF("Image uploaded to RAM at 0x%x", bs_ram.hdr.ih_load_addr);
+    bs_ram.ready = true;
+
+    return 0;
+}
+
+static void
+bs_upload_ram(const uint8_t *chunk, size_t chunk_len, size_t off,
+              size_t img_size)
+{
+    int rc = 0;
+
+    if (off == 0) {
+        rc = bs_ram_start(chunk, chunk_len, img_size);
+    } else if (!bs_ram.hashing || off != bs_ram.curr_off) {
+        /* Request the expected offset, as for uploads to flash. */
+        goto out;
+    }
+
+    if (rc == 0 && chunk_len > bs_ram.img_size - bs_ram.curr_off) {
+        rc = MGMT_ERR_EINVAL;
+    }
+
+    if (rc == 0) {
+        memcpy(bs_ram.dst + bs_ram.curr_off, chunk, chunk_len);
+        if (bs_ram.curr_off < bs_ram.hash_len) {
+            bootutil_sha_update(&bs_ram.sha, chunk,
+                                (bs_ram.hash_len - bs_ram.curr_off < chunk_len) ?
+                                bs_ram.hash_len - bs_ram.curr_off : chunk_len);
+        }
+        bs_ram.curr_off += chunk_len;
+
+        if (bs_ram.curr_off == bs_ram.img_size) {
+            rc = bs_ram_finish();
+        }
+    }
+
+    if (rc != 0) {
+        bs_ram_abort();
+    }
+
+out:
+    BOOT_LOG_DBG("RX: 0x%x", rc);
+    zcbor_map_start_encode(cbor_state, 10);
+    zcbor_tstr_put_lit_cast(cbor_state, "rc");
+    zcbor_int32_put(cbor_state, rc);
+    if (rc == 0) {
+        zcbor_tstr_put_lit_cast(cbor_state, "off");
+        zcbor_uint32_put(cbor_state, bs_ram.curr_off);
+    }
+    zcbor_map_end_encode(cbor_state, 10);
+
+    boot_serial_output();
+}
+
+/*
+ * Boots the image uploaded to RAM, if it is valid.
+ */
+static void
+bs_ram_boot(void)
+{
+    static struct boot_rsp rsp;
+
+    if (!bs_ram.ready) {
+        return;
+    }
+
+    memset(&rsp, 0, sizeof(rsp));
+    rsp.br_hdr = (struct image_header *)bs_ram.dst;
+    rsp.br_flash_dev_id = flash_area_id_from_multi_image_slot(0, 0);
+
+    boot_serial_ram_boot(&rsp);
+}
+#endif /* MCUBOOT_SERIAL_RAM_UPLOAD */
+
+/*
+ * Image upload request.
+ */
+static void
+bs_upload(char *buf, int len)
+{
+    struct bs_upload_session *ses = &bs_sessions[0];
+    const uint8_t *img_chunk = NULL;    /* Pointer to buffer with received image chunk */
+    size_t img_chunk_len = 0;           /* Length of received image chunk */
+    size_t img_chunk_off = SIZE_MAX;    /* Offset of image chunk within image  */
+    size_t rem_bytes;                   /* Reminder bytes after aligning chunk write to
+                                         * to flash alignment */
+    uint32_t img_num_tmp = UINT_MAX;    /* Temp variable for image number */
+    BS_STATIC uint32_t img_num = 0;
+    size_t img_size_tmp = SIZE_MAX;     /* Temp variable for image size */
+    const struct flash_area *fap = NULL;
+    int rc;
+    struct zcbor_string img_chunk_data;
+    size_t decoded = 0;
+    bool ok;
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+    int i;
+#endif
+
+    zcbor_state_t zsd[4];
+    zcbor_new_state(zsd, sizeof(zsd) / sizeof(zcbor_state_t), (uint8_t *)buf, len, 1, NULL, 0);
+
+    struct zcbor_map_decode_key_val image_upload_decode[] = {
+        ZCBOR_MAP_DECODE_KEY_DECODER("image", zcbor_uint32_decode, &img_num_tmp),
+        ZCBOR_MAP_DECODE_KEY_DECODER("data", zcbor_bstr_decode, &img_chunk_data),
+        ZCBOR_MAP_DECODE_KEY_DECODER("len", zcbor_size_decode, &img_size_tmp),
+        ZCBOR_MAP_DECODE_KEY_DECODER("off", zcbor_size_decode, &img_chunk_off),
+    };
+
+    ok = zcbor_map_decode_bulk(zsd, image_upload_decode, ARRAY_SIZE(image_upload_decode),
+                               &decoded) == 0;
+
+    if (!ok) {
+        goto out_invalid_data;
+    }
+
+    img_chunk = img_chunk_data.value;
+    img_chunk_len = img_chunk_data.len;
+
+    /*
+     * Expected data format.
+     * {
+     *   "image":<image number in a multi-image set (OPTIONAL)>
+     *   "data":<image data>
+     *   "len":<image len>
+     *   "off":<current offset of image data>
+     * }
+     */
+
+    if (img_chunk_off == SIZE_MAX || img_chunk == NULL) {
+        /*
+         * Offset must be set in every block.
+         */
+        goto out_invalid_data;
+    }
+
+#ifdef MCUBOOT_SERIAL_RAM_UPLOAD
+    if (img_chunk_off == 0 || img_num_tmp != UINT_MAX) {
+        bs_ram.active = (img_num_tmp == BS_RAM_UPLOAD_IMAGE);
+    }
+    if (bs_ram.active) {
+        bs_upload_ram(img_chunk, img_chunk_len, img_chunk_off, img_size_tmp);
+        return;
+    }
+#endif
+
+#ifdef MCUBOOT_SERIAL_UPLOAD_SESSIONS
+    /* Any chunk may tell the upload it belongs to, the one of the previous
+     * chunk otherwise.
+     */
+    if (img_num_tmp != UINT_MAX) {
+        img_num = img_num_tmp;
+    } else if (img_chunk_off == 0) {
+        img_num = 0;
+    }
+
+    if (img_num >= BS_UPLOAD_SESSIONS) {
+        goto out_invalid_data;
+    }
+    ses = &bs_sessions[img_num];
+#else
+    /* Use image number only from packet with offset == 0, or from the one
+     * resuming an upload after a reset.
+     */
+#ifdef MCUBOOT_SERIAL_UPLOAD_RESUME
+    if (img_chunk_off == 0 || ses->img_size == 0) {
+#else
+    if (img_chunk_off == 0) {
+#endif
+        if (img_num_tmp != UINT_MAX) {
+            img_num = img_num_tmp;
+        } else {
+            img_num = 0;
+        }
+    }
+#endif
+
+#if defined(MCUBOOT_SERIAL_DECOMPRESS)
+    if (img_chunk_off == 0) {
+        ses->decomp = bs_upload_is_compressed(img_chunk, img_chunk_len);
+    }
+    rc = flash_area_open(flash_area_id_from_multi_image_slot(img_num,
+                                                             ses->decomp ? 1 : 0),
+                         &fap);
+#elif !defined(MCUBOOT_SERIAL_DIRECT_IMAGE_UPLOAD)
+    rc = flash_area_open(flash_area_id_from_multi_image_slot(img_num, 0), &fap);
+#else
+    rc = flash_area_open(flash_area_id_from_direct_image(img_num), &fap);
 #endif
     if (rc) {
         rc = MGMT_ERR_EINVAL;
         goto out;
     }
+#ifdef MCUBOOT_SERIAL_ERASE_AHEAD
+    ses->area_id = flash_area_get_id(fap);
+#endif
+#ifdef MCUBOOT_SERIAL_BACKGROUND_ERASE
+    /* The upload must not be erased behind it. */
+    bs_erase_finish(flash_area_get_id(fap));
+#ifdef MCUBOOT_SERIAL_DECOMPRESS
+    if (ses->decomp) {
+        bs_erase_finish(flash_area_id_from_multi_image_slot(img_num, 0));
+    }
+#endif
+#endif
+
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+    /* The previous chunk must be written before the flash is used again. */
+    bs_upload_wait();
+    if (bs_write_rc != 0) {
+        /* The flash contents are unknown, make the host start over; the
+         * failed write may be of any upload.
+         */
+        bs_write_rc = 0;
+        for (i = 0; i < BS_UPLOAD_SESSIONS; i++) {
+            bs_sessions[i].curr_off = 0;
+        }
+        rc = MGMT_ERR_EUNKNOWN;
+        goto out;
+    }
+#endif
+
+#ifdef MCUBOOT_SERIAL_UPLOAD_RESUME
+    if (img_chunk_off != 0 && ses->img_size == 0) {
+        /* First chunk since the reset, continue the upload if it has been
+         * recorded up to the offset of this chunk.
+         */
+        struct bs_resume_record rec;
+        uint32_t next_idx;
+
+        if (bs_resume_read(fap, &rec, &next_idx) == 0 &&
+            rec.off == img_chunk_off &&
+            flash_area_get_sector(fap, boot_status_off(fap),
+                                  &ses->status_sector) == 0) {
+            BOOT_LOG_INF("Resuming upload at 0x%x", rec.off);
+            ses->img_size = rec.img_size;
+            ses->curr_off = rec.off;
+            /* The sector at the recorded offset may be partially written. */
+            ses->not_yet_erased = rec.off;
+            bs_resume_start(fap, ses->img_size, next_idx, &ses->status_sector);
+            bs_resume.next_off = ses->curr_off + bs_resume.interval;
+        }
+    }
+#endif
 
     if (img_chunk_off == 0) {
         /* Receiving chunk with 0 offset resets the upload state; this basically
@@ -874,14 +2202,14 @@ bs_upload(char *buf, int len)
          */
         const size_t area_size = flash_area_get_size(fap);
 
-        curr_off = 0;
+        ses->curr_off = 0;
 #ifdef MCUBOOT_ERASE_PROGRESSIVELY
         /* Get trailer sector information; this is done early because inability to get
          * that sector information means that upload will not work anyway.
          * TODO: This is single occurrence issue, it should get detected during tests
          * and fixed otherwise you are deploying broken mcuboot.
          */
-        if (flash_area_get_sector(fap, boot_status_off(fap), &status_sector)) {
+        if (flash_area_get_sector(fap, boot_status_off(fap), &ses->status_sector)) {
             rc = MGMT_ERR_EUNKNOWN;
             BOOT_LOG_ERR("Unable to determine flash sector of the image trailer");
             goto out;
@@ -889,10 +2217,11 @@ bs_upload(char *buf, int len)
 #endif
 
 #if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE)
-        /* We are using swap state at end of flash area to store validation
-         * result. Make sure the user cannot write it from an image to skip validation.
+        /* We are using the trailer at end of flash area to store the
+         * validation result and record. Make sure the user cannot write them
+         * from an image to skip validation.
          */
-        if (img_size_tmp > (area_size - BOOT_MAGIC_SZ)) {
+        if (img_size_tmp > boot_status_off(fap)) {
             goto out_invalid_data;
         }
 #else
@@ -906,23 +2235,36 @@ bs_upload(char *buf, int len)
         /* Non-progressive erase erases entire image slot when first chunk of
          * an image is received.
          */
+        bs_tlv_index_invalidate();
         rc = flash_area_erase(fap, 0, area_size);
         if (rc) {
             goto out_invalid_data;
         }
 #else
-        not_yet_erased = 0;
+        ses->not_yet_erased = 0;
 #endif
 
-        img_size = img_size_tmp;
-    } else if (img_chunk_off != curr_off) {
+        ses->img_size = img_size_tmp;
+#ifdef MCUBOOT_SERIAL_UPLOAD_HASH
+        bs_upload_hash_start(fap, img_chunk, img_chunk_len, ses->img_size);
+#endif
+#ifdef MCUBOOT_SERIAL_UPLOAD_RESUME
+        /* Drop the records of a previous upload. */
+        if (erase_range(fap, flash_sector_get_off(&ses->status_sector),
+                        flash_sector_get_off(&ses->status_sector)) < 0) {
+            rc = MGMT_ERR_EUNKNOWN;
+            goto out;
+        }
+        bs_resume_start(fap, ses->img_size, 0, &ses->status_sector);
+#endif
+    } else if (img_chunk_off != ses->curr_off) {
         /* If received chunk offset does not match expected one jump, pretend
          * success and jump to out; out will respond to client with success
          * and request the expected offset, held by curr_off.
          */
         rc = 0;
         goto out;
-    } else if (curr_off + img_chunk_len > img_size) {
+    } else if (ses->curr_off + img_chunk_len > ses->img_size) {
         rc = MGMT_ERR_EINVAL;
         goto out;
     }
@@ -931,10 +2273,10 @@ bs_upload(char *buf, int len)
     /* Progressive erase will erase enough flash, aligned to sector size,
      * as needed for the current chunk to be written.
      */
-    not_yet_erased = erase_range(fap, not_yet_erased,
-                                 curr_off + img_chunk_len - 1);
+    ses->not_yet_erased = erase_range(fap, ses->not_yet_erased,
+                                      ses->curr_off + img_chunk_len - 1);
 
-    if (not_yet_erased < 0) {
+    if (ses->not_yet_erased < 0) {
         rc = MGMT_ERR_EINVAL;
         goto out;
     }
@@ -948,11 +2290,25 @@ bs_upload(char *buf, int len)
     rem_bytes = img_chunk_len % flash_area_align(fap);
     img_chunk_len -= rem_bytes;
 
-    if (curr_off + img_chunk_len + rem_bytes < img_size) {
+#ifdef BS_DEC_SLACK
+    /* Moves the next packet so that its data is aligned like this one
+     * would have needed to be.
+     */
+    bs_dec_shift = (bs_dec_shift - ((uintptr_t)img_chunk &
+                                    (flash_area_align(fap) - 1))) &
+                   (flash_area_align(fap) - 1);
+#endif
+
+    if (ses->curr_off + img_chunk_len + rem_bytes < ses->img_size) {
         rem_bytes = 0;
     }
 
-    BOOT_LOG_DBG("Writing at 0x%x until 0x%x", curr_off, curr_off + (uint32_t)img_chunk_len);
+#ifdef MCUBOOT_SERIAL_UPLOAD_HASH
+    bs_upload_hash_update(fap, ses->curr_off, img_chunk,
+                          img_chunk_len + rem_bytes);
+#endif
+
+    BOOT_LOG_DBG("Writing at 0x%x until 0x%x", ses->curr_off, ses->curr_off + (uint32_t)img_chunk_len);
     /* Write flash aligned chunk, note that img_chunk_len now holds aligned length */
 #if defined(MCUBOOT_SERIAL_UNALIGNED_BUFFER_SIZE) && MCUBOOT_SERIAL_UNALIGNED_BUFFER_SIZE > 0
     if (flash_area_align(fap) > 1 &&
@@ -969,21 +2325,21 @@ bs_upload(char *buf, int len)
             memset(wbs_aligned, flash_area_erased_val(fap), sizeof(wbs_aligned));
             memcpy(wbs_aligned, img_chunk, write_size);
 
-            rc = flash_area_write(fap, curr_off, wbs_aligned, write_size);
+            rc = flash_area_write(fap, ses->curr_off, wbs_aligned, write_size);
 
             if (rc != 0) {
                 goto out;
             }
 
-            curr_off += write_size;
+            ses->curr_off += write_size;
             img_chunk += write_size;
             img_chunk_len -= write_size;
         }
     } else {
-        rc = flash_area_write(fap, curr_off, img_chunk, img_chunk_len);
+        rc = bs_upload_write(fap, ses->curr_off, img_chunk, img_chunk_len);
     }
 #else
-    rc = flash_area_write(fap, curr_off, img_chunk, img_chunk_len);
+    rc = bs_upload_write(fap, ses->curr_off, img_chunk, img_chunk_len);
 #endif
 
     if (rc == 0 && rem_bytes) {
@@ -993,28 +2349,67 @@ bs_upload(char *buf, int len)
          */
         uint8_t wbs_aligned[BOOT_MAX_ALIGN];
 
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+        bs_upload_wait();
+        rc = bs_write_rc;
+        bs_write_rc = 0;
+#endif
+
         memset(wbs_aligned, flash_area_erased_val(fap), sizeof(wbs_aligned));
         memcpy(wbs_aligned, img_chunk + img_chunk_len, rem_bytes);
 
-        rc = flash_area_write(fap, curr_off + img_chunk_len, wbs_aligned,
-                              flash_area_align(fap));
+        if (rc == 0) {
+            rc = flash_area_write(fap, ses->curr_off + img_chunk_len, wbs_aligned,
+                                  flash_area_align(fap));
+        }
     }
 
     if (rc == 0) {
-        curr_off += img_chunk_len + rem_bytes;
-        if (curr_off == img_size) {
+        ses->curr_off += img_chunk_len + rem_bytes;
+#ifdef MCUBOOT_SERIAL_UPLOAD_RESUME
+        bs_resume_checkpoint(fap, ses->curr_off, ses->img_size);
+#endif
+        if (ses->curr_off == ses->img_size) {
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+            /* The whole image must be written before it is handed over. */
+            bs_upload_wait();
+            if (bs_write_rc != 0) {
+                bs_write_rc = 0;
+                ses->curr_off = 0;
+                rc = MGMT_ERR_EUNKNOWN;
+                goto out;
+            }
+#endif
 #ifdef MCUBOOT_ERASE_PROGRESSIVELY
             /* Assure that sector for image trailer was erased. */
             /* Check whether it was erased during previous upload. */
-            off_t start = flash_sector_get_off(&status_sector);
+            off_t start = flash_sector_get_off(&ses->status_sector);
 
             if (erase_range(fap, start, start) < 0) {
                 rc = MGMT_ERR_EUNKNOWN;
                 goto out;
             }
+#endif
+#ifdef MCUBOOT_SERIAL_UPLOAD_HASH
+            bs_upload_hash_finish(fap);
+#endif
+#ifdef MCUBOOT_SERIAL_DECOMPRESS
+            if (ses->decomp) {
+#ifdef MCUBOOT_SERIAL_UPLOAD_HASH
+                /* The staged image is erased. */
+                bs_upload_hash_abort();
+#endif
+                rc = bs_upload_decompress(img_num, fap);
+                if (rc) {
+                    BOOT_LOG_ERR("Error %d decompressing image", rc);
+                    ses->curr_off = 0;
+                    rc = MGMT_ERR_EUNKNOWN;
+                    goto out;
+                }
+            }
 #endif
             rc = BOOT_HOOK_CALL(boot_serial_uploaded_hook, 0, img_num, fap,
-                                img_size);
+                                ses->img_size);
             if (rc) {
                 BOOT_LOG_ERR("Error %d post upload hook", rc);
                 goto out;
@@ -1026,33 +2421,47 @@ bs_upload(char *buf, int len)
     }
 
 out:
+#ifdef MCUBOOT_SERIAL_UPLOAD_HASH
+    if (rc != 0) {
+        /* The slot may not hold what was hashed. */
+        bs_upload_hash_abort();
+    }
+#endif
     BOOT_LOG_DBG("RX: 0x%x", rc);
     zcbor_map_start_encode(cbor_state, 10);
     zcbor_tstr_put_lit_cast(cbor_state, "rc");
     zcbor_int32_put(cbor_state, rc);
     if (rc == 0) {
         zcbor_tstr_put_lit_cast(cbor_state, "off");
-        zcbor_uint32_put(cbor_state, curr_off);
+        zcbor_uint32_put(cbor_state, ses->curr_off);
     }
     zcbor_map_end_encode(cbor_state, 10);
 
     boot_serial_output();
 
-#ifdef MCUBOOT_ENC_IMAGES
-    /* Check if this upload was for the primary slot */
+#if defined(MCUBOOT_ENC_IMAGES) && !defined(MCUBOOT_ENC_XIP)
+    /* Check if this upload was for the primary slot; with MCUBOOT_ENC_XIP
+     * images are executed from flash still encrypted. */
 #if !defined(MCUBOOT_SERIAL_DIRECT_IMAGE_UPLOAD)
     if (flash_area_id_from_multi_image_slot(img_num, 0) == FLASH_AREA_IMAGE_PRIMARY(0))
 #else
     if (flash_area_id_from_direct_image(img_num) == FLASH_AREA_IMAGE_PRIMARY(0))
 #endif
     {
-        if (curr_off == img_size) {
+        if (ses->curr_off == ses->img_size) {
             /* Last sector received, now start a decryption on the image if it is encrypted */
             rc = boot_handle_enc_fw(fap);
         }
     }
 #endif
 
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+    if (fap != NULL && fap == bs_write_fap) {
+        /* Closed by bs_upload_wait() once the chunk is written. */
+        bs_write_close = true;
+        return;
+    }
+#endif
     flash_area_close(fap);
 }
 
@@ -1104,6 +2513,100 @@ out:
 }
 #endif
 
+#if defined(MCUBOOT_SERIAL_UPLOAD_WINDOW) && MCUBOOT_SERIAL_UPLOAD_WINDOW > 0
+/*
+ * MCUmgr parameters request. Reports the number of commands, of up to the
+ * maximum receive size, that the host may send without waiting for their
+ * responses. For image uploads, each response carries the offset up to which
+ * the image has been written; chunks received after a missing one are
+ * answered with that same offset and have to be sent again.
+ */
+static void
+bs_mcumgr_params(char *buf, int len)
+{
+    (void)buf;
+    (void)len;
+
+    zcbor_map_start_encode(cbor_state, 10);
+    zcbor_tstr_put_lit_cast(cbor_state, "rc");
+    zcbor_int32_put(cbor_state, 0);
+    zcbor_tstr_put_lit_cast(cbor_state, "buf_size");
+    zcbor_uint32_put(cbor_state, MCUBOOT_SERIAL_MAX_RECEIVE_SIZE);
+    zcbor_tstr_put_lit_cast(cbor_state, "buf_count");
+    zcbor_uint32_put(cbor_state, MCUBOOT_SERIAL_UPLOAD_WINDOW);
+    zcbor_map_end_encode(cbor_state, 10);
+
+    boot_serial_output();
+}
+#endif
+
+#ifdef MCUBOOT_SERIAL_BAUD_SWITCH
+/*
+ * Baud rate switch request. The response is sent at the current rate, then
+ * the uart is switched to the requested one. The host must send a valid
+ * frame at the new rate within MCUBOOT_SERIAL_BAUD_TIMEOUT_MS, otherwise the
+ * rate the uart was configured with at boot is restored.
+ */
+static void
+bs_baud(char *buf, int len)
+{
+    uint32_t baud = 0;
+    size_t decoded = 0;
+    int rc = 0;
+
+    zcbor_state_t zsd[4];
+    zcbor_new_state(zsd, sizeof(zsd) / sizeof(zcbor_state_t), (uint8_t *)buf, len, 1, NULL, 0);
+
+    struct zcbor_map_decode_key_val baud_decode[] = {
+        ZCBOR_MAP_DECODE_KEY_DECODER("baud", zcbor_uint32_decode, &baud),
+    };
+
+    if (zcbor_map_decode_bulk(zsd, baud_decode, ARRAY_SIZE(baud_decode), &decoded) != 0 ||
+        baud == 0) {
+        rc = MGMT_ERR_EINVAL;
+    }
+#ifdef MCUBOOT_SERIAL_BAUD_MAX
+    else if (baud > MCUBOOT_SERIAL_BAUD_MAX) {
+        rc = MGMT_ERR_EINVAL;
+    }
+#endif
+    else if (boot_uf->set_baud == NULL) {
+        rc = MGMT_ERR_ENOTSUP;
+    }
+
+    bs_rc_rsp(rc);
+    if (rc != 0) {
+        return;
+    }
+
+    if (boot_uf->set_baud(baud) != 0) {
+        BOOT_LOG_WRN("Failed to switch to %u baud", (unsigned int)baud);
+        /* The port may be left in any state, go back to the rate it had. */
+        boot_uf->set_baud(0);
+        bs_baud_pending = false;
+        return;
+    }
+
+    bs_baud_pending = true;
+    bs_baud_deadline = MCUBOOT_UPTIME_MS() + MCUBOOT_SERIAL_BAUD_TIMEOUT_MS;
+}
+
+/*
+ * Restores the boot baud rate if the host did not talk at the new one in
+ * time.
+ */
+static void
+bs_baud_check(void)
+{
+    if (bs_baud_pending &&
+        (int32_t)(MCUBOOT_UPTIME_MS() - bs_baud_deadline) >= 0) {
+        BOOT_LOG_WRN("No request at the new baud rate, switching back");
+        boot_uf->set_baud(0);
+        bs_baud_pending = false;
+    }
+}
+#endif
+
 /*
  * Reset, and (presumably) boot to newly uploaded image. Flush console
  * before restarting.
@@ -1112,6 +2615,9 @@ static void
 bs_reset(char *buf, int len)
 {
     int rc = BOOT_HOOK_CALL(boot_reset_request_hook, 0, false);
+
+    (void)buf;
+    (void)len;
     if (rc == BOOT_RESET_REQUEST_HOOK_BUSY) {
 	rc = MGMT_ERR_EBUSY;
     } else {
@@ -1124,18 +2630,33 @@ bs_reset(char *buf, int len)
     bs_rc_rsp(rc);
 
     if (rc == 0) {
+#ifdef MCUBOOT_BOOT_PROFILE
+        /* Serial recovery does not return, report it before resetting. */
+        boot_phase_stop(BOOT_PHASE_SERIAL);
+        boot_profile_log();
+#endif
 #ifdef __ZEPHYR__
 #ifdef CONFIG_MULTITHREADING
         k_sleep(K_MSEC(250));
 #else
         k_busy_wait(250000);
+#endif
+#ifdef MCUBOOT_SERIAL_RAM_UPLOAD
+        /* Does not return if an image was uploaded to RAM. */
+        bs_ram_boot();
 #endif
         sys_reboot(SYS_REBOOT_COLD);
 #elif __ESPRESSIF__
         esp_rom_delay_us(250000);
+#ifdef MCUBOOT_SERIAL_RAM_UPLOAD
+        bs_ram_boot();
+#endif
         bootloader_reset();
 #else
         os_cputime_delay_usecs(250000);
+#ifdef MCUBOOT_SERIAL_RAM_UPLOAD
+        bs_ram_boot();
+#endif
         hal_system_reset();
 #endif
     }
@@ -1148,11 +2669,13 @@ bs_reset(char *buf, int len)
 void
 boot_serial_input(char *buf, int len)
 {
-    struct nmgr_hdr *hdr;
+    struct nmgr_hdr *hdr = &bs_hdr_buf;
 
-    hdr = (struct nmgr_hdr *)buf;
-    if (len < sizeof(*hdr) ||
-      (hdr->nh_op != NMGR_OP_READ && hdr->nh_op != NMGR_OP_WRITE) ||
+    if (len < (int)sizeof(*hdr)) {
+        return;
+    }
+    memcpy(hdr, buf, sizeof(*hdr));
+    if ((hdr->nh_op != NMGR_OP_READ && hdr->nh_op != NMGR_OP_WRITE) ||
       (ntohs(hdr->nh_len) < len - sizeof(*hdr))) {
         return;
     }
@@ -1164,15 +2687,38 @@ boot_serial_input(char *buf, int len)
 
     reset_cbor_state();
 
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+    if (hdr->nh_group != MGMT_GROUP_ID_IMAGE ||
+        hdr->nh_id != IMGMGR_NMGR_ID_UPLOAD) {
+        /* Other commands only see the flash once the upload is written. */
+        bs_upload_wait();
+    }
+#endif
+
     /*
      * Limited support for commands.
      */
     if (hdr->nh_group == MGMT_GROUP_ID_IMAGE) {
         switch (hdr->nh_id) {
         case IMGMGR_NMGR_ID_STATE:
+#ifdef MCUBOOT_SERIAL_BACKGROUND_ERASE
+            if (hdr->nh_op == NMGR_OP_WRITE) {
+                /* The image state is written to the slot trailers. */
+                bs_erase_finish(-1);
+            }
+#endif
             bs_list_set(hdr->nh_op, buf, len);
             break;
         case IMGMGR_NMGR_ID_UPLOAD:
+#ifdef MCUBOOT_SERIAL_UPLOAD_RESUME
+            if (hdr->nh_op == NMGR_OP_READ) {
+                bs_upload_resume(buf, len);
+                break;
+            }
+#endif
+#ifdef MCUBOOT_SERIAL_SLOT_CACHE
+            bs_slot_cache_invalidate();
+#endif
             bs_upload(buf, len);
             break;
 #ifdef MCUBOOT_SERIAL_IMG_GRP_SLOT_INFO
@@ -1195,13 +2741,50 @@ boot_serial_input(char *buf, int len)
             bs_rc_rsp(0);
             break;
         case NMGR_ID_RESET:
+#ifdef MCUBOOT_SERIAL_BACKGROUND_ERASE
+            /* Erases requested before the reset are completed. */
+            bs_erase_finish(-1);
+#endif
             bs_reset(buf, len);
             break;
+#if defined(MCUBOOT_SERIAL_UPLOAD_WINDOW) && MCUBOOT_SERIAL_UPLOAD_WINDOW > 0
+        case NMGR_ID_MCUMGR_PARAMS:
+            bs_mcumgr_params(buf, len);
+            break;
+#endif
+        default:
+            bs_rc_rsp(MGMT_ERR_ENOTSUP);
+            break;
+        }
+    }
+#if defined(MCUBOOT_SERIAL_BAUD_SWITCH) || defined(MCUBOOT_SERIAL_BACKGROUND_ERASE)
+    else if (hdr->nh_group == MGMT_GROUP_ID_BOOT_SERIAL) {
+        switch (hdr->nh_id) {
+#ifdef MCUBOOT_SERIAL_BAUD_SWITCH
+        case BOOT_SERIAL_ID_BAUD:
+            if (hdr->nh_op == NMGR_OP_WRITE) {
+                bs_baud(buf, len);
+            } else {
+                bs_rc_rsp(MGMT_ERR_ENOTSUP);
+            }
+            break;
+#endif
+#ifdef MCUBOOT_SERIAL_BACKGROUND_ERASE
+        case BOOT_SERIAL_ID_ERASE:
+            bs_erase_slot(hdr->nh_op, buf, len);
+            break;
+#endif
         default:
             bs_rc_rsp(MGMT_ERR_ENOTSUP);
             break;
         }
-    } else if (MCUBOOT_PERUSER_MGMT_GROUP_ENABLED == 1) {
+    }
+#endif
+    else if (MCUBOOT_PERUSER_MGMT_GROUP_ENABLED == 1) {
+#ifdef MCUBOOT_SERIAL_SLOT_CACHE
+        /* The commands of the group may write the slots. */
+        bs_slot_cache_invalidate();
+#endif
         if (bs_peruser_system_specific(hdr, buf, len, cbor_state) == 0) {
             boot_serial_output();
         }
@@ -1213,6 +2796,111 @@ boot_serial_input(char *buf, int len)
 #endif
 }
 
+#ifdef MCUBOOT_SERIAL_RAW_FRAMING
+/*
+ * COBS encodes len bytes of in into out, XORing every output byte with the
+ * line delimiter so that it never appears in the output. Returns the encoded
+ * length, which is at most len + 1 + len / 254.
+ */
+static int
+boot_serial_raw_enc(const uint8_t *in, int len, uint8_t *out)
+{
+    int code_off = 0;
+    int out_off = 1;
+    uint8_t code = 1;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        if (in[i] != 0) {
+            out[out_off++] = in[i] ^ BOOT_SERIAL_RAW_DELIM;
+            code++;
+        }
+        if (in[i] == 0 || code == 0xff) {
+            out[code_off] = code ^ BOOT_SERIAL_RAW_DELIM;
+            code_off = out_off++;
+            code = 1;
+        }
+    }
+    out[code_off] = code ^ BOOT_SERIAL_RAW_DELIM;
+
+    return out_off;
+}
+
+/*
+ * Decodes the output of boot_serial_raw_enc(). Returns the decoded length,
+ * or -1 if the input is malformed or does not fit in maxout bytes.
+ */
+static int
+boot_serial_raw_dec(const uint8_t *in, int inlen, uint8_t *out, int maxout)
+{
+    int in_off = 0;
+    int out_off = 0;
+    uint8_t code;
+    uint8_t i;
+
+    while (in_off < inlen) {
+        code = in[in_off++] ^ BOOT_SERIAL_RAW_DELIM;
+        if (code == 0) {
+            return -1;
+        }
+        for (i = 1; i < code; i++) {
+            if (in_off >= inlen || out_off >= maxout) {
+                return -1;
+            }
+            out[out_off++] = in[in_off++] ^ BOOT_SERIAL_RAW_DELIM;
+        }
+        if (code != 0xff && in_off < inlen) {
+            if (out_off >= maxout) {
+                return -1;
+            }
+            out[out_off++] = 0;
+        }
+    }
+
+    return out_off;
+}
+
+/*
+ * Sends the response with raw framing: the length, header and data, split
+ * into COBS encoded lines.
+ */
+static void
+boot_serial_output_raw(const char *data, int len)
+{
+    char pkt_cont[2] = { BOOT_SERIAL_RAW_DATA_START1, BOOT_SERIAL_RAW_DATA_START2 };
+    char pkt_start[2] = { BOOT_SERIAL_RAW_PKT_START1, BOOT_SERIAL_RAW_PKT_START2 };
+    uint8_t buf[BOOT_SERIAL_OUT_MAX + sizeof(*bs_hdr) + sizeof(uint16_t)];
+    uint8_t encoded_buf[BOOT_SERIAL_FRAME_MTU];
+    uint16_t totlen;
+    int frag_len;
+    int enc_len;
+    int out;
+
+    totlen = htons(len + sizeof(*bs_hdr));
+    memcpy(buf, &totlen, sizeof(totlen));
+    memcpy(&buf[sizeof(totlen)], bs_hdr, sizeof(*bs_hdr));
+    memcpy(&buf[sizeof(totlen) + sizeof(*bs_hdr)], data, len);
+    totlen = sizeof(totlen) + sizeof(*bs_hdr) + len;
+
+    for (out = 0; out < totlen; out += frag_len) {
+        if (out == 0) {
+            boot_uf->write(pkt_start, sizeof(pkt_start));
+        } else {
+            boot_uf->write(pkt_cont, sizeof(pkt_cont));
+        }
+
+        /* Fragments are shorter than 254 bytes, so one byte of overhead. */
+        frag_len = MIN(BOOT_SERIAL_FRAME_MTU - 1, totlen - out);
+        enc_len = boot_serial_raw_enc(&buf[out], frag_len, encoded_buf);
+        boot_uf->write((const char *)encoded_buf, enc_len);
+
+        boot_uf->write("\n", 1);
+    }
+
+    BOOT_LOG_DBG("TX");
+}
+#endif /* MCUBOOT_SERIAL_RAW_FRAMING */
+
 static void
 boot_serial_output(void)
 {
@@ -1233,7 +2921,17 @@ boot_serial_output(void)
     bs_hdr->nh_len = htons(len);
     bs_hdr->nh_group = htons(bs_hdr->nh_group);
 
-#ifdef __ZEPHYR__
+#ifdef MCUBOOT_SERIAL_RAW_FRAMING
+    if (bs_raw) {
+        boot_serial_output_raw(data, len);
+        return;
+    }
+#endif
+
+#if defined(MCUBOOT_SERIAL_FAST_FRAMING)
+    crc = boot_serial_crc16(CRC16_INITIAL_CRC, bs_hdr, sizeof(*bs_hdr));
+    crc = boot_serial_crc16(crc, data, len);
+#elif defined(__ZEPHYR__)
     crc =  crc16_itu_t(CRC16_INITIAL_CRC, (uint8_t *)bs_hdr, sizeof(*bs_hdr));
     crc =  crc16_itu_t(crc, data, len);
 #elif __ESPRESSIF__
@@ -1257,7 +2955,12 @@ boot_serial_output(void)
     totlen += len;
     memcpy(&buf[totlen], &crc, sizeof(crc));
     totlen += sizeof(crc);
-#ifdef __ZEPHYR__
+#if defined(MCUBOOT_SERIAL_FAST_FRAMING)
+    size_t enc_len;
+    boot_serial_base64_encode(encoded_buf, sizeof(encoded_buf), &enc_len,
+                              (uint8_t *)buf, totlen);
+    totlen = enc_len;
+#elif defined(__ZEPHYR__)
     size_t enc_len;
     base64_encode(encoded_buf, sizeof(encoded_buf), &enc_len, buf, totlen);
     totlen = enc_len;
@@ -1298,7 +3001,12 @@ boot_serial_in_dec(char *in, int inlen, char *out, int *out_off, int maxout)
     uint16_t crc;
     uint16_t len;
 
-#ifdef __ZEPHYR__
+#if defined(MCUBOOT_SERIAL_FAST_FRAMING)
+    if (boot_serial_base64_decode((uint8_t *)&out[*out_off], maxout - *out_off,
+                                  &rc, in, inlen) != 0) {
+        return -1;
+    }
+#elif defined(__ZEPHYR__)
     int err;
     err = base64_decode( &out[*out_off], maxout - *out_off, &rc, in, inlen - 2);
     if (err) {
@@ -1321,17 +3029,20 @@ boot_serial_in_dec(char *in, int inlen, char *out, int *out_off, int maxout)
 #endif
 
     *out_off += rc;
-    if (*out_off <= sizeof(uint16_t)) {
+    if (*out_off <= (int)sizeof(uint16_t)) {
         return 0;
     }
 
-    len = ntohs(*(uint16_t *)out);
+    memcpy(&len, out, sizeof(len));
+    len = ntohs(len);
     if (len != *out_off - sizeof(uint16_t)) {
         return 0;
     }
 
     out += sizeof(uint16_t);
-#ifdef __ZEPHYR__
+#if defined(MCUBOOT_SERIAL_FAST_FRAMING)
+    crc = boot_serial_crc16(CRC16_INITIAL_CRC, out, len);
+#elif defined(__ZEPHYR__)
     crc = crc16_itu_t(CRC16_INITIAL_CRC, out, len);
 #elif __ESPRESSIF__
     crc = ~esp_crc16_be(~CRC16_INITIAL_CRC, (uint8_t *)out, len);
@@ -1347,6 +3058,47 @@ boot_serial_in_dec(char *in, int inlen, char *out, int *out_off, int maxout)
     return 1;
 }
 
+#ifdef MCUBOOT_SERIAL_RAW_FRAMING
+/*
+ * Appends the packet data of a raw framed line to out. Returns 1 once the
+ * whole packet is received, 0 if more lines are expected and -1 on error.
+ */
+static int
+boot_serial_in_raw(char *in, int inlen, char *out, int *out_off, int maxout)
+{
+    const char *end;
+    uint16_t len;
+    int rc;
+
+    /* The delimiter is not part of the encoded data. */
+    end = memchr(in, BOOT_SERIAL_RAW_DELIM, inlen);
+    if (end != NULL) {
+        inlen = end - in;
+    }
+
+    /* Keeps room for the terminating NUL. */
+    rc = boot_serial_raw_dec((uint8_t *)in, inlen, (uint8_t *)&out[*out_off],
+                             maxout - 1 - *out_off);
+    if (rc < 0) {
+        return -1;
+    }
+
+    *out_off += rc;
+    if (*out_off <= (int)sizeof(uint16_t)) {
+        return 0;
+    }
+
+    memcpy(&len, out, sizeof(len));
+    len = ntohs(len);
+    if (len != *out_off - sizeof(uint16_t)) {
+        return 0;
+    }
+    out[*out_off] = '\0';
+
+    return 1;
+}
+#endif
+
 /*
  * Task which waits reading console, expecting to get image over
  * serial port.
@@ -1389,6 +3141,21 @@ boot_serial_read_console(const struct boot_uart_funcs *f,int timeout_in_ms)
         if (rc <= 0 && !full_line) {
 #ifndef MCUBOOT_SERIAL_WAIT_FOR_DFU
             allow_idle = true;
+#endif
+#ifdef MCUBOOT_SERIAL_ERASE_AHEAD
+            /* Nothing to process, prepare the flash for the next chunks. */
+            if (bs_erase_ahead()) {
+#ifndef MCUBOOT_SERIAL_WAIT_FOR_DFU
+                allow_idle = false;
+#endif
+            }
+#endif
+#ifdef MCUBOOT_SERIAL_BACKGROUND_ERASE
+            if (bs_erase_step()) {
+#ifndef MCUBOOT_SERIAL_WAIT_FOR_DFU
+                allow_idle = false;
+#endif
+            }
 #endif
             goto check_timeout;
         }
@@ -1405,18 +3172,45 @@ boot_serial_read_console(const struct boot_uart_funcs *f,int timeout_in_ms)
         if (in_buf[0] == SHELL_NLIP_PKT_START1 &&
           in_buf[1] == SHELL_NLIP_PKT_START2) {
             dec_off = 0;
-            rc = boot_serial_in_dec(&in_buf[2], off - 2, dec_buf, &dec_off, max_input);
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+            bs_swap_dec_buf();
+#endif
+            rc = boot_serial_in_dec(&in_buf[2], off - 2, BS_DEC_PKT, &dec_off, max_input);
+#ifdef MCUBOOT_SERIAL_RAW_FRAMING
+            bs_raw = false;
+#endif
         } else if (in_buf[0] == SHELL_NLIP_DATA_START1 &&
           in_buf[1] == SHELL_NLIP_DATA_START2) {
-            rc = boot_serial_in_dec(&in_buf[2], off - 2, dec_buf, &dec_off, max_input);
+            rc = boot_serial_in_dec(&in_buf[2], off - 2, BS_DEC_PKT, &dec_off, max_input);
+        }
+#ifdef MCUBOOT_SERIAL_RAW_FRAMING
+        else if (in_buf[0] == BOOT_SERIAL_RAW_PKT_START1 &&
+          in_buf[1] == BOOT_SERIAL_RAW_PKT_START2) {
+            dec_off = 0;
+#ifdef MCUBOOT_SERIAL_ASYNC_WRITE
+            bs_swap_dec_buf();
+#endif
+            rc = boot_serial_in_raw(&in_buf[2], off - 2, BS_DEC_PKT, &dec_off, max_input);
+            bs_raw = true;
+        } else if (in_buf[0] == BOOT_SERIAL_RAW_DATA_START1 &&
+          in_buf[1] == BOOT_SERIAL_RAW_DATA_START2) {
+            rc = boot_serial_in_raw(&in_buf[2], off - 2, BS_DEC_PKT, &dec_off, max_input);
         }
+#endif
 
         /* serve errors: out of decode memory, or bad encoding */
         if (rc == 1) {
-            boot_serial_input(&dec_buf[2], dec_off - 2);
+#ifdef MCUBOOT_SERIAL_BAUD_SWITCH
+            /* A valid frame confirms the baud rate it was received at. */
+            bs_baud_pending = false;
+#endif
+            boot_serial_input(&BS_DEC_PKT[2], dec_off - 2);
         }
         off = 0;
 check_timeout:
+#ifdef MCUBOOT_SERIAL_BAUD_SWITCH
+        bs_baud_check();
+#endif
         /* Subtract elapsed time */
 #ifdef MCUBOOT_SERIAL_WAIT_FOR_DFU
         elapsed_in_ms = (k_uptime_get_32() - start);
@@ -1450,7 +3244,7 @@ boot_serial_check_start(const struct boot_uart_funcs *f, int timeout_in_ms)
 }
 #endif
 
-#ifdef MCUBOOT_SERIAL_IMG_GRP_HASH
+#if defined(MCUBOOT_SERIAL_IMG_GRP_HASH) || defined(MCUBOOT_SERIAL_UPLOAD_HASH)
 /* Function to find the hash of an image, returns 0 on success. */
 static int boot_serial_get_hash(const struct image_header *hdr,
                                 const struct flash_area *fap, uint8_t *hash)
@@ -31,16 +31,25 @@ boot_image_validate_encrypted(const struct flash_area *fa_p,
     struct boot_status _bs;
     struct boot_status *bs = &_bs;
     uint8_t image_index;
+    int slot = BOOT_SECONDARY_SLOT;
     int rc;
 
     memset(&boot_data, 0, sizeof(struct boot_loader_state));
     image_index = BOOT_CURR_IMG(state);
     if(IS_ENCRYPTED(hdr)) {
-        rc = boot_enc_load(BOOT_CURR_ENC(state), 1, hdr, fa_p, bs);
+#ifdef MCUBOOT_ENC_XIP
+        /* The image may be in either slot. */
+        slot = flash_area_id_to_multi_image_slot(image_index,
+                                                 flash_area_get_id(fa_p));
+        if (slot < 0) {
+            FIH_RET(fih_rc);
+        }
+#endif
+        rc = boot_enc_load(BOOT_CURR_ENC(state), slot, hdr, fa_p, bs);
         if (rc < 0) {
             FIH_RET(fih_rc);
         }
-        rc = boot_enc_set_key(BOOT_CURR_ENC(state), 1, bs);
+        rc = boot_enc_set_key(BOOT_CURR_ENC(state), slot, bs);
         if (rc < 0) {
             FIH_RET(fih_rc);
         }
@@ -186,7 +195,7 @@ decrypt_region_inplace(struct boot_loader_state *state,
 
         bytes_copied += chunk_sz;
 
-        MCUBOOT_WATCHDOG_FEED();
+        boot_watchdog_feed(chunk_sz);
     }
 
     return 0;
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef MCUBOOT_SERIAL_FAST_FRAMING
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "boot_serial_priv.h"
+
+/*
+ * CRC16 and base64 of the SMP serial framing, done a byte or a quantum at a
+ * time with lookup tables instead of bit by bit, so that decoding a line
+ * keeps up with UARTs running at a few Mbaud.
+ */
+
+#ifndef MCUBOOT_SERIAL_CRC16
+/* CRC-CCITT (XMODEM), polynomial 0x1021, most significant bit first. */
+static const uint16_t bs_crc16_tab[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
+uint16_t
+boot_serial_crc16(uint16_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    while (len-- > 0) {
+        crc = (uint16_t)(crc << 8) ^ bs_crc16_tab[((crc >> 8) ^ *p++) & 0xff];
+    }
+
+    return crc;
+}
+#endif /* !MCUBOOT_SERIAL_CRC16 */
+
+static const char bs_b64_enc[64] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Value of each base64 character, 0xff for the other ones. */
+static const uint8_t bs_b64_dec[256] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+int
+boot_serial_base64_decode(uint8_t *out, size_t maxout, size_t *outlen,
+                          const char *in, size_t inlen)
+{
+    const uint8_t *p = (const uint8_t *)in;
+    uint32_t a, b, c, d;
+    size_t pad = 0;
+    size_t full;
+    size_t n;
+    size_t i;
+
+    /* The line may still hold its terminator. */
+    while (inlen > 0 && (p[inlen - 1] == '\n' || p[inlen - 1] == '\r' ||
+                         p[inlen - 1] == '\0')) {
+        inlen--;
+    }
+    if ((inlen & 3) != 0) {
+        return -1;
+    }
+    if (inlen > 0 && p[inlen - 1] == '=') {
+        pad = (p[inlen - 2] == '=') ? 2 : 1;
+    }
+
+    n = inlen / 4 * 3 - pad;
+    if (n > maxout) {
+        return -1;
+    }
+
+    /* The quanta without padding, each checked with a single test. */
+    full = (pad != 0) ? inlen - 4 : inlen;
+    for (i = 0; i < full; i += 4) {
+        a = bs_b64_dec[p[i]];
+        b = bs_b64_dec[p[i + 1]];
+        c = bs_b64_dec[p[i + 2]];
+        d = bs_b64_dec[p[i + 3]];
+        if ((a | b | c | d) & 0x80) {
+            return -1;
+        }
+        a = (a << 18) | (b << 12) | (c << 6) | d;
+        *out++ = (uint8_t)(a >> 16);
+        *out++ = (uint8_t)(a >> 8);
+        *out++ = (uint8_t)a;
+    }
+
+    if (pad != 0) {
+        a = bs_b64_dec[p[i]];
+        b = bs_b64_dec[p[i + 1]];
+        c = (pad == 1) ? bs_b64_dec[p[i + 2]] : 0;
+        if ((a | b | c) & 0x80) {
+            return -1;
+        }
+        a = (a << 18) | (b << 12) | (c << 6);
+        *out++ = (uint8_t)(a >> 16);
+        if (pad == 1) {
+            *out++ = (uint8_t)(a >> 8);
+        }
+    }
+
+    *outlen = n;
+
+    return 0;
+}
+
+int
+boot_serial_base64_encode(char *out, size_t maxout, size_t *outlen,
+                          const uint8_t *in, size_t inlen)
+{
+    size_t n = (inlen + 2) / 3 * 4;
+    uint32_t v;
+    size_t i;
+
+    if (n >= maxout) {
+        return -1;
+    }
+
+    for (i = 0; i + 3 <= inlen; i += 3) {
+        v = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+        *out++ = bs_b64_enc[v >> 18];
+        *out++ = bs_b64_enc[(v >> 12) & 0x3f];
+        *out++ = bs_b64_enc[(v >> 6) & 0x3f];
+        *out++ = bs_b64_enc[v & 0x3f];
+    }
+
+    if (i < inlen) {
+        v = (uint32_t)in[i] << 16;
+        if (i + 1 < inlen) {
+            v |= (uint32_t)in[i + 1] << 8;
+        }
+        *out++ = bs_b64_enc[v >> 18];
+        *out++ = bs_b64_enc[(v >> 12) & 0x3f];
+        *out++ = (i + 1 < inlen) ? bs_b64_enc[(v >> 6) & 0x3f] : '=';
+        *out++ = '=';
+    }
+
+    *out = '\0';
+    *outlen = n;
+
+    return 0;
+}
+
+#endif /* MCUBOOT_SERIAL_FAST_FRAMING */
@@ -33,6 +33,18 @@ extern "C" {
 #define SHELL_NLIP_DATA_START1  4
 #define SHELL_NLIP_DATA_START2  20
 
+/*
+ * Raw framing, lines have the same structure as the NLIP ones but the packet
+ * is COBS encoded, to keep the delimiter out of it, and has no CRC.
+ */
+#define BOOT_SERIAL_RAW_PKT_START1  6
+#define BOOT_SERIAL_RAW_PKT_START2  11
+
+#define BOOT_SERIAL_RAW_DATA_START1 4
+#define BOOT_SERIAL_RAW_DATA_START2 11
+
+#define BOOT_SERIAL_RAW_DELIM       '\n'
+
 /*
  * From newtmgr.h
  */
@@ -51,9 +63,21 @@ extern "C" {
 #define MGMT_GROUP_ID_IMAGE     1
 #define MGMT_GROUP_ID_PERUSER  64
 
+/*
+ * MCUboot specific group, used by MCUBOOT_SERIAL_BAUD_SWITCH and
+ * MCUBOOT_SERIAL_BACKGROUND_ERASE.
+ */
+#ifndef MGMT_GROUP_ID_BOOT_SERIAL
+#define MGMT_GROUP_ID_BOOT_SERIAL  (MGMT_GROUP_ID_PERUSER + 1)
+#endif
+
+#define BOOT_SERIAL_ID_BAUD     0
+#define BOOT_SERIAL_ID_ERASE    1
+
 #define NMGR_ID_ECHO            0
 #define NMGR_ID_CONS_ECHO_CTRL  1
 #define NMGR_ID_RESET           5
+#define NMGR_ID_MCUMGR_PARAMS   6
 
 #ifndef __packed
 #define __packed __attribute__((__packed__))
@@ -83,8 +107,90 @@ struct nmgr_hdr {
 #define IMGMGR_NMGR_ID_UPLOAD           1
 #define IMGMGR_NMGR_ID_SLOT_INFO        6
 
+/*
+ * Upload progress record, appended to the status area of the trailer of the
+ * slot being uploaded to (MCUBOOT_SERIAL_UPLOAD_RESUME).
+ */
+#define BOOT_SERIAL_RESUME_MAGIC        0x52534d31 /* "RSM1" */
+
+struct bs_resume_record {
+    uint32_t magic;
+    uint32_t img_size;          /* Size of the image being uploaded */
+    uint32_t off;               /* Size of its part written so far */
+    uint32_t check;             /* ~(img_size ^ off) */
+};
+
+/*
+ * Storage class of the state of serial recovery. The simulator runs it from
+ * several threads at once, so each of them gets its own copy.
+ */
+#if !defined(__BOOTSIM__)
+#define BS_STATIC static
+#else
+#define BS_STATIC static __thread
+#endif
+
 void boot_serial_input(char *buf, int len);
+#if !defined(__BOOTSIM__)
 extern const struct boot_uart_funcs *boot_uf;
+#else
+extern __thread const struct boot_uart_funcs *boot_uf;
+#endif
+
+#ifdef MCUBOOT_SERIAL_FAST_FRAMING
+/*
+ * Table driven CRC16 and base64 of the SMP serial framing, used instead of
+ * the ones of the platform. A port with a CRC peripheral can route the CRC
+ * to it by defining MCUBOOT_SERIAL_CRC16(crc, data, len), which must compute
+ * the same CRC-CCITT (XMODEM) as boot_serial_crc16().
+ */
+#ifdef MCUBOOT_SERIAL_CRC16
+#define boot_serial_crc16(_crc, _data, _len) MCUBOOT_SERIAL_CRC16(_crc, _data, _len)
+#else
+uint16_t boot_serial_crc16(uint16_t crc, const void *data, size_t len);
+#endif
+
+/**
+ * Decodes a base64 encoded line, which may still end with its terminator.
+ *
+ * @return 0 on success; -1 if the line is not valid base64 or if the
+ *         decoded data does not fit in maxout bytes.
+ */
+int boot_serial_base64_decode(uint8_t *out, size_t maxout, size_t *outlen,
+                              const char *in, size_t inlen);
+
+/**
+ * Encodes data to a null-terminated base64 string, *outlen is set to its
+ * length without the terminator.
+ *
+ * @return 0 on success; -1 if the string does not fit in maxout bytes.
+ */
+int boot_serial_base64_encode(char *out, size_t maxout, size_t *outlen,
+                              const uint8_t *in, size_t inlen);
+#endif
+
+#ifdef MCUBOOT_SERIAL_BACKGROUND_ERASE
+/**
+ * Queues the erase of a flash area, which is then erased a sector at a time
+ * while serial recovery waits for commands. Queuing an area that is already
+ * being erased starts its erase over.
+ *
+ * @return MGMT_ERR_OK on success; MGMT_ERR_EBUSY if
+ *         MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS erases are in progress;
+ *         MGMT_ERR_EINVAL if the flash area can not be opened.
+ */
+int bs_erase_start(int area_id);
+
+/**
+ * Reports the progress of the last erase of a flash area, which is done
+ * once *off reaches *size.
+ *
+ * @return MGMT_ERR_OK if the erase is in progress or done;
+ *         MGMT_ERR_ENOENT if no erase of the area is known; another
+ *         MGMT_ERR_* value if the erase failed.
+ */
+int bs_erase_status(int area_id, uint32_t *off, uint32_t *size);
+#endif
 
 /**
  * @brief Selects direct image to upload according to the "image"
@@ -26,15 +26,22 @@ int zcbor_map_decode_bulk(zcbor_state_t *zsd, struct zcbor_map_decode_key_val *m
         struct zcbor_string key;
         bool found = false;
         size_t map_count = 0;
+        uint32_t sig = 0;
 
         ok = zcbor_tstr_decode(zsd, &key);
+        if (ok && key.len > 0) {
+            sig = ZCBOR_MAP_KEY_SIG_PARTS(key.len, key.value[0],
+                                          key.value[key.len - 1]);
+        }
 
         while (ok && map_count < map_size) {
             if (dptr >= (map + map_size)) {
                 dptr = map;
             }
 
-            if (key.len == dptr->key.len        &&
+            /* Only keys with the same signature are compared. */
+            if ((dptr->sig == 0 || dptr->sig == sig) &&
+                key.len == dptr->key.len        &&
                 memcmp(key.value, dptr->key.value, key.len) == 0) {
 
                 if (dptr->found) {
@@ -22,11 +22,23 @@ extern "C" {
 
 struct zcbor_map_decode_key_val {
     struct zcbor_string key;     /* Map key string */
+    uint32_t sig;                /* ZCBOR_MAP_KEY_SIG() of the key, or 0 */
     zcbor_decoder_t *decoder;    /* Key corresponding decoder */
     void *value_ptr;
     bool found;
 };
 
+/* Signature of a key, made of its length and of its first and last
+ * characters, so that decoded keys are only compared with the entries
+ * whose key has the same signature. It is never 0 for a non-empty key.
+ */
+#define ZCBOR_MAP_KEY_SIG_PARTS(len, first, last) \
+    (((uint32_t)(len) << 16) | ((uint32_t)(uint8_t)(first) << 8) | (uint8_t)(last))
+
+#define ZCBOR_MAP_KEY_SIG(k)                                    \
+    ZCBOR_MAP_KEY_SIG_PARTS(sizeof(k) - 1, (k)[0],              \
+                            (k)[(sizeof(k) > 1) ? sizeof(k) - 2 : 0])
+
 /** @brief Define single key-decoder mapping
  *
  * The macro creates a single zcbor_map_decode_key_val type object.
@@ -44,6 +56,7 @@ struct zcbor_map_decode_key_val {
             .value = (uint8_t *)k,               \
             .len = sizeof(k) - 1,                \
         },                                       \
+        .sig = ZCBOR_MAP_KEY_SIG(k),             \
         .decoder = (zcbor_decoder_t *)dec,       \
         .value_ptr = vp,                         \
     }
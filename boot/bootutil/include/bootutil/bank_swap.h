@@ -0,0 +1,43 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2026, NOWATCH BV
+ */
+
+#ifndef H_BOOTUTIL_BANK_SWAP_
+#define H_BOOTUTIL_BANK_SWAP_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef MCUBOOT_SWAP_USING_BANK
+/**
+ * Swaps the flash banks holding the primary and secondary slots of an image,
+ * so that the bank which was mapped as the secondary slot is mapped at the
+ * address of the primary slot and the other way around. This is provided by
+ * the port, for instance by toggling the BFB2 or SWAP_BANK option of the
+ * flash controller.
+ *
+ * The swap must be atomic: after a reset, either the old or the new mapping
+ * is in effect. The flash map backend must address the slots as they are
+ * mapped, so that the primary slot is always the bank the image runs from.
+ *
+ * If the new mapping only takes effect after a reset, as with option bytes
+ * loaded at reset, this function resets the device and does not return.
+ *
+ * @param image_index   Index of the image whose slots are swapped.
+ *
+ * @return              0 once the new mapping is in effect; nonzero if the
+ *                      banks could not be swapped.
+ */
+int boot_bank_swap(uint8_t image_index);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_BOOTUTIL_BANK_SWAP_ */
@@ -19,17 +19,29 @@
 #ifndef H_BOOTUTIL_BENCH_H__
 #define H_BOOTUTIL_BENCH_H__
 
+#include <stddef.h>
+#include <stdint.h>
 #include "ignore.h"
 
-#ifdef MCUBOOT_USE_BENCH
-
+#if defined(MCUBOOT_USE_BENCH) || defined(MCUBOOT_BOOT_PROFILE)
 /* The platform-specific benchmark code should define a
  * `bench_state_t` type that holds the information needed for the
  * benchmark.  This is generally something small, such as an integer
  * holding the state.  This should also define plat_bench_start and
  * plat_bench_end, which likely have to be macros so that log messages
- * come from the right place in the code. */
+ * come from the right place in the code.  The boot-phase profiler
+ * additionally needs plat_bench_cycles(), returning a free-running
+ * 32-bit cycle counter, and with MCUBOOT_BOOT_PROFILE_STACK
+ * plat_bench_stack_start() and plat_bench_stack_size(), returning the
+ * lowest address and the size of the stack the bootloader runs on. */
 #include <platform-bench.h>
+#endif
+
+#if defined(MCUBOOT_BOOT_PROFILE_STACK) && !defined(MCUBOOT_BOOT_PROFILE)
+#error "MCUBOOT_BOOT_PROFILE_STACK requires MCUBOOT_BOOT_PROFILE"
+#endif
+
+#ifdef MCUBOOT_USE_BENCH
 
 /*
  * These are simple barrier-type benchmarks.  If a platform has
@@ -50,9 +62,11 @@
 
 #else /* not MCUBOOT_USE_BENCH */
 
+#ifndef MCUBOOT_BOOT_PROFILE
 /* The type needs to take space.  As long as it remains unused, the C
  * compiler should eliminate this value entirely. */
 typedef int bench_state_t;
+#endif
 
 /* Without benchmarking enabled, these are just empty. */
 #define boot_bench_start(_state) do { \
@@ -65,4 +79,141 @@ typedef int bench_state_t;
 
 #endif /* not MCUBOOT_USE_BENCH */
 
+#ifdef MCUBOOT_BOOT_PROFILE
+
+/*
+ * Boot phases timed by the profiler.  The numbering is part of the
+ * table exported through the shared data area, new phases must be
+ * added at the end.
+ */
+enum boot_phase {
+    BOOT_PHASE_TOTAL,           /* boot_go() */
+    BOOT_PHASE_HDR_READ,        /* Reading an image header */
+    BOOT_PHASE_VALIDATE,        /* Validating an image in a slot */
+    BOOT_PHASE_HASH,            /* Hashing an image */
+    BOOT_PHASE_SIG,             /* Verifying a signature */
+    BOOT_PHASE_KEY,             /* Decrypting an image encryption key */
+    BOOT_PHASE_SWAP,            /* Swapping the slots of an image */
+    BOOT_PHASE_SWAP_STEP,       /* Swapping or moving one sector */
+    BOOT_PHASE_COPY,            /* Copying an image in overwrite mode */
+    BOOT_PHASE_JUMP,            /* From boot_go() return to the jump */
+    BOOT_PHASE_SERIAL,          /* Serial recovery */
+    BOOT_PHASE_COUNT,
+};
+
+/* Parent of a phase that was not started inside another one. */
+#define BOOT_PHASE_NONE 0xff
+
+/*
+ * Per-phase entry of the profile table, indexed by `enum boot_phase`.
+ * Phases which were never run have a zero count.
+ */
+struct boot_phase_entry {
+    /* Cycles spent in the phase, summed over all of its runs. */
+    uint32_t cycles;
+    /* Number of runs of the phase, saturating. */
+    uint16_t count;
+    /* Phase which was running when this one was first started. */
+    uint8_t parent;
+    uint8_t reserved;
+};
+
+/*
+ * Phases can be nested, the time of an inner phase is included in the
+ * time of the phases around it.  Starting a phase which is already
+ * running only nests the matching stop, it is not timed twice.
+ */
+void boot_phase_start(enum boot_phase phase);
+void boot_phase_stop(enum boot_phase phase);
+
+/**
+ * Returns the profile table, holding BOOT_PHASE_COUNT entries.
+ */
+const struct boot_phase_entry *boot_profile_table(void);
+
+/**
+ * Logs the number of runs and the cycles of each phase which was run, along
+ * with its stack high-water mark and the use of the arenas with
+ * MCUBOOT_BOOT_PROFILE_STACK.
+ */
+void boot_profile_log(void);
+
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+
+/*
+ * Static RAM areas whose use is measured.  The numbering is part of the
+ * table exported through the shared data area.
+ */
+enum boot_arena {
+    BOOT_ARENA_WORK,            /* MCUBOOT_WORK_ARENA */
+    BOOT_ARENA_CRYPTO,          /* MCUBOOT_CRYPTO_ARENA */
+    BOOT_ARENA_HEAP,            /* Heap of the crypto library */
+    BOOT_ARENA_COUNT,
+};
+
+/*
+ * Entry of the arena table, indexed by `enum boot_arena`.  Arenas which
+ * were not painted have a zero size.
+ */
+struct boot_arena_entry {
+    /* Size of the arena, in bytes. */
+    uint32_t size;
+    /* Bytes from the start of the arena to the last one written. */
+    uint32_t used;
+};
+
+/*
+ * The stack, assumed to grow down, is painted below the frame of the
+ * caller when each phase is started, and scanned for the deepest word
+ * written when phases are started and stopped.  The peak is then charged
+ * to every phase which was running, so the mark of a phase covers the
+ * phases nested in it.  The frames of the profiler itself are included.
+ */
+
+/**
+ * Returns the stack table, holding the high-water mark of each phase, in
+ * bytes from the top of the stack, for BOOT_PHASE_COUNT phases.
+ */
+const uint32_t *boot_profile_stack_table(void);
+
+/**
+ * Paints an arena, whose use is taken to grow from its start, so that the
+ * bytes written afterwards can be told apart.  Must be called before the
+ * arena is used, a value written that matches the paint is missed when it
+ * lies at the end of the used part.
+ *
+ * @param arena             Arena to paint.
+ * @param buf               Start of the arena.
+ * @param size              Size of the arena, in bytes.
+ */
+void boot_profile_arena_paint(enum boot_arena arena, void *buf, size_t size);
+
+/**
+ * Returns the arena table, holding BOOT_ARENA_COUNT entries, which are
+ * updated by the call.
+ */
+const struct boot_arena_entry *boot_profile_arena_table(void);
+
+#endif /* MCUBOOT_BOOT_PROFILE_STACK */
+
+#ifdef MCUBOOT_DATA_SHARING
+/**
+ * Adds the profile table to the shared data area, as a single
+ * TLV_MAJOR_BOOT_PROFILE / BOOT_PROFILE_TABLE entry, followed with
+ * MCUBOOT_BOOT_PROFILE_STACK by the BOOT_PROFILE_STACK and
+ * BOOT_PROFILE_ARENAS entries.  Should be called right before jumping to
+ * the application.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int boot_profile_save_shared_data(void);
+#endif
+
+#else /* not MCUBOOT_BOOT_PROFILE */
+
+#define boot_phase_start(_phase) do { } while (0)
+#define boot_phase_stop(_phase) do { } while (0)
+
+#endif /* not MCUBOOT_BOOT_PROFILE */
+
 #endif /* not H_BOOTUTIL_BENCH_H__ */
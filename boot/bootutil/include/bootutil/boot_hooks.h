@@ -84,6 +84,53 @@ int boot_read_image_header_hook(int img_index, int slot,
  */
 fih_ret boot_image_check_hook(int img_index, int slot);
 
+#ifdef MCUBOOT_IMAGE_VERDICT_HOOKS
+/** Hook for look up a verdict on an image held by the platform
+ *
+ * This Hook lets the platform, e.g. a secure element or a TF-M partition,
+ * return the result of a previous validation of the image in a slot, so that
+ * its hash and signature are not checked again. It is called after
+ * boot_image_check_hook() returned FIH_BOOT_HOOK_REGULAR.
+ *
+ * A verdict is bound to the slot and to the digests of the image. It may only
+ * be returned if the platform knows that the slot has not been written since
+ * the verdict was stored with boot_image_verdict_store_hook(): matching
+ * digests alone do not prove that the image data is unchanged. The verdict
+ * must be returned as a hardened FIH value, never derived from a single
+ * flag or memory comparison. With MCUBOOT_HW_ROLLBACK_PROT, the security
+ * counter of a valid image is checked again by MCUboot.
+ *
+ * @param img_index the index of the image pair
+ * @param slot slot number
+ * @param hdr_digest digest of the image header, IMAGE_HASH_SIZE bytes
+ * @param img_hash value of the image hash TLV, IMAGE_HASH_SIZE bytes
+ *
+ * @retval FIH_SUCCESS: image is valid, skip direct validation
+ *         FIH_FAILURE: image is invalid, skip direct validation
+ *         FIH_BOOT_HOOK_REGULAR: no verdict, follow the normal execution path.
+ */
+fih_ret boot_image_verdict_lookup_hook(int img_index, int slot,
+                                       const uint8_t *hdr_digest,
+                                       const uint8_t *img_hash);
+
+/** Hook for store the verdict on an image just validated
+ *
+ * This Hook is called after every full validation of the image in a slot
+ * whose digests could be computed, whether it passed or not. The platform
+ * may keep the verdict for boot_image_verdict_lookup_hook(), as long as it
+ * drops it as soon as the slot is written.
+ *
+ * @param img_index the index of the image pair
+ * @param slot slot number
+ * @param hdr_digest digest of the image header, IMAGE_HASH_SIZE bytes
+ * @param img_hash value of the image hash TLV, IMAGE_HASH_SIZE bytes
+ * @param fih_rc result of the validation, FIH_SUCCESS if the image is valid
+ */
+void boot_image_verdict_store_hook(int img_index, int slot,
+                                   const uint8_t *hdr_digest,
+                                   const uint8_t *img_hash, fih_ret fih_rc);
+#endif
+
 /** Hook for implement image update
  *
  * This hook is for for implementing an alternative mechanism of image update or
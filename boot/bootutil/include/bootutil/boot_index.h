@@ -0,0 +1,89 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __BOOT_INDEX_H__
+#define __BOOT_INDEX_H__
+
+/**
+ * @file boot_index.h
+ *
+ * Platform interface used by MCUBOOT_BOOT_INDEX to select the slot to boot
+ * in the direct-xip and ram-load modes without reading the image header of
+ * every slot of every image on each boot.
+ *
+ * The index holds, for each slot, whether it contains an image with a valid
+ * header and the version of that image. It is kept by the platform, e.g. in
+ * retained RAM or in a dedicated flash record, and read in one go. The entry
+ * of a slot is only trusted if the platform's erase generation counter of
+ * the slot is unchanged, which requires this counter to be incremented by
+ * every agent (bootloader, application, debugger flash algorithm, ...) each
+ * time the slot is erased or written, trailer included. If this can not be
+ * guaranteed, the index must not be enabled.
+ *
+ * The index only steers the slot selection: the header of the selected slot
+ * is still read, and the image validated, before it is booted.
+ */
+
+#include <stdint.h>
+#include "bootutil/bootutil.h"
+#include "bootutil/image.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOT_INDEX_MAGIC     0x42494431 /* "BID1" */
+#define BOOT_INDEX_NUM_SLOTS 2
+
+struct boot_index_slot {
+    /* Erase generation of the slot when it was indexed. */
+    uint32_t generation;
+    /* Nonzero if the slot holds an image with a valid header. */
+    uint32_t available;
+    /* Version of that image. */
+    struct image_version ver;
+};
+
+struct boot_index {
+    uint32_t magic;
+    struct boot_index_slot slots[BOOT_IMAGE_NUMBER][BOOT_INDEX_NUM_SLOTS];
+};
+
+/**
+ * Reads the current erase generation counter of a slot.
+ *
+ * @param image_index       Index of the image (from 0).
+ * @param slot              Slot of the image (from 0).
+ * @param generation        Pointer to store the generation value.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int boot_index_generation(uint32_t image_index, uint32_t slot,
+                          uint32_t *generation);
+
+/**
+ * Reads the stored boot index.
+ *
+ * @param idx               Index to be populated.
+ *
+ * @return                  0 on success; nonzero if there is no index.
+ */
+int boot_index_read(struct boot_index *idx);
+
+/**
+ * Stores the boot index, replacing any previous one.
+ *
+ * @param idx               Index to be stored.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int boot_index_write(const struct boot_index *idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOT_INDEX_H__ */
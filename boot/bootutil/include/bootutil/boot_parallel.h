@@ -0,0 +1,57 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __BOOT_PARALLEL_H__
+#define __BOOT_PARALLEL_H__
+
+/**
+ * @file boot_parallel.h
+ *
+ * Platform interface used by MCUBOOT_PARALLEL_VALIDATION to hash images on
+ * a secondary core of a multi-core SoC while the boot core validates the
+ * first image.
+ *
+ * The job handed to the platform only reads flash and computes hashes, the
+ * signature of every image is still checked on the boot core. The secondary
+ * core must therefore be as trusted as the boot core, and both the flash
+ * driver and the hash implementation must be usable from both cores at the
+ * same time.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Job run on a secondary core. */
+typedef void (*boot_parallel_job_t)(void *arg);
+
+/**
+ * Starts a job on a secondary core and returns without waiting for it.
+ * Only one job is started at a time.
+ *
+ * @param job               Job to run.
+ * @param arg               Argument passed to the job.
+ *
+ * @return                  0 if the job was started; nonzero otherwise, in
+ *                              which case the images are hashed by the boot
+ *                              core when they are validated.
+ */
+int boot_parallel_start(boot_parallel_job_t job, void *arg);
+
+/**
+ * Waits for the job started by boot_parallel_start() to return. Once this
+ * returns, everything written by the job must be visible to the boot core.
+ *
+ * @return                  0 if the job ran to completion; nonzero
+ *                              otherwise.
+ */
+int boot_parallel_join(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOT_PARALLEL_H__ */
@@ -0,0 +1,52 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Boot-time performance profile hooks
+ *
+ * With MCUBOOT_PERF_HOOKS, the port is asked to switch to its fastest
+ * settings (CPU clock, flash wait states, quad or octal SPI mode, ...) while
+ * the images are validated and updated, and to restore the reset defaults
+ * the application expects before it is started.
+ */
+
+#ifndef H_BOOTUTIL_PERF_HOOKS
+#define H_BOOTUTIL_PERF_HOOKS
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef MCUBOOT_PERF_HOOKS
+
+/**
+ * Raises the CPU clock and the flash performance settings. Called by
+ * boot_go() before the image trailers and headers are read. Anything MCUboot
+ * keeps using, such as the flash drivers, the console and the timer of the
+ * watchdog feeding, must keep working with the new settings.
+ */
+void boot_perf_raise(void);
+
+/**
+ * Restores the settings changed by boot_perf_raise() to their reset
+ * defaults. Called by boot_go() before it returns, whether an image was
+ * found or not, so before the port jumps to the application.
+ */
+void boot_perf_restore(void);
+
+#else
+
+#define boot_perf_raise() do { } while (0)
+#define boot_perf_restore() do { } while (0)
+
+#endif /* MCUBOOT_PERF_HOOKS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_BOOTUTIL_PERF_HOOKS */
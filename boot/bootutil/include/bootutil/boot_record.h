@@ -66,6 +66,24 @@ int boot_save_boot_status(uint8_t sw_module,
                           const struct image_header *hdr,
                           const struct flash_area *fap);
 
+/**
+ * Same as boot_save_boot_status(), but taking the measurement value from
+ * the hash computed when the image was validated instead of reading its
+ * hash TLV. Only the boot record TLV is then read from the flash.
+ *
+ * @param[in]  sw_module  Identifier of the SW component.
+ * @param[in]  hdr        Pointer to the image header stored in RAM.
+ * @param[in]  fap        Pointer to the flash area where image is stored.
+ * @param[in]  hash       Hash of the validated image, of IMAGE_HASH_SIZE
+ *                        bytes, or NULL to read it from the image TLVs.
+ *
+ * @return                0 on success; nonzero on failure.
+ */
+int boot_save_boot_status_hash(uint8_t sw_module,
+                               const struct image_header *hdr,
+                               const struct flash_area *fap,
+                               const uint8_t *hash);
+
 /**
  * Add application specific data to the shared memory area between the
  * bootloader and runtime SW.
@@ -86,6 +86,7 @@ extern "C" {
  */
 #define TLV_MAJOR_IAS      0x1
 #define TLV_MAJOR_BLINFO   0x2
+#define TLV_MAJOR_BOOT_PROFILE 0x3
 
 /* Initial attestation: Claim per SW components / SW modules */
 /* Bits: 0-2 */
@@ -120,6 +121,13 @@ extern "C" {
 #define BLINFO_MAX_APPLICATION_SIZE_IMAGE_3 0x08
 #define BLINFO_MAX_APPLICATION_SIZE_IMAGE_4 0x09
 
+/* Boot-phase profile: table of `struct boot_phase_entry` from bench.h */
+#define BOOT_PROFILE_TABLE          0x00
+/* Stack high-water mark of each phase, uint32_t bytes, same order */
+#define BOOT_PROFILE_STACK          0x01
+/* Arena table: `struct boot_arena_entry` from bench.h */
+#define BOOT_PROFILE_ARENAS         0x02
+
 enum mcuboot_mode {
     MCUBOOT_MODE_SINGLE_SLOT,
     MCUBOOT_MODE_SWAP_USING_SCRATCH,
@@ -130,6 +138,8 @@ enum mcuboot_mode {
     MCUBOOT_MODE_RAM_LOAD,
     MCUBOOT_MODE_FIRMWARE_LOADER,
     MCUBOOT_MODE_SINGLE_SLOT_RAM_LOAD,
+    MCUBOOT_MODE_SWAP_USING_OFFSET,
+    MCUBOOT_MODE_SWAP_USING_BANK,
 };
 
 enum mcuboot_signature_type {
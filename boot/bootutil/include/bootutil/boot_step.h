@@ -0,0 +1,73 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Step-wise boot_go()
+ *
+ * With MCUBOOT_BOOT_STEP, bootutil calls boot_step_point() each time it has
+ * finished a bounded unit of work: a chunk of an image hashed or copied,
+ * whose size is set by MCUBOOT_WATCHDOG_FEED_BYTES, or a signature verified.
+ * A port running boot_go() in a context of its own uses this to hand control
+ * back to the caller of boot_go_step(), which can then do other init work
+ * and feed the watchdog before letting the boot go on.
+ */
+
+#ifndef H_BOOTUTIL_BOOT_STEP
+#define H_BOOTUTIL_BOOT_STEP
+
+#include "bootutil/bootutil.h"
+#include "bootutil/fault_injection_hardening.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef MCUBOOT_BOOT_STEP
+
+/** Units of work after which boot_step_point() is called. */
+enum boot_step_kind {
+    /* A chunk of an image was hashed, copied or swapped. */
+    BOOT_STEP_DATA,
+    /* A signature was verified. */
+    BOOT_STEP_VERIFY,
+};
+
+/** Returned by boot_go_step() while boot_go() has not returned yet. */
+#define BOOT_STEP_MORE  1
+/** Returned by boot_go_step() once boot_go() has returned. */
+#define BOOT_STEP_DONE  0
+
+/**
+ * Called by bootutil after each unit of work, from the context running
+ * boot_go(). Provided by the port, which may switch back to the caller of
+ * boot_go_step() and only return once it is called again.
+ *
+ * @param kind  The unit of work just finished.
+ */
+void boot_step_point(enum boot_step_kind kind);
+
+/**
+ * Runs boot_go() up to its next step point, starting it on the first call.
+ * Provided by the port, as this needs boot_go() to run in its own context.
+ *
+ * @param rsp       Passed to boot_go(), valid once BOOT_STEP_DONE is
+ *                  returned. Must be the same for every call.
+ * @param fih_rc    Set to the value returned by boot_go() once
+ *                  BOOT_STEP_DONE is returned.
+ *
+ * @return          BOOT_STEP_MORE if boot_go() has more work to do;
+ *                  BOOT_STEP_DONE once it has returned.
+ */
+int boot_go_step(struct boot_rsp *rsp, fih_ret *fih_rc);
+
+#endif /* MCUBOOT_BOOT_STEP */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_BOOTUTIL_BOOT_STEP */
@@ -85,6 +85,9 @@ struct image_max_size {
 /* you must have pre-allocated all the entries within this structure */
 fih_ret boot_go(struct boot_rsp *rsp);
 fih_ret boot_go_for_image_id(struct boot_rsp *rsp, uint32_t image_id);
+#ifdef MCUBOOT_LAZY_VALIDATION
+fih_ret boot_validate_deferred_image(uint32_t image_id);
+#endif
 
 struct boot_loader_state;
 void boot_state_clear(struct boot_loader_state *state);
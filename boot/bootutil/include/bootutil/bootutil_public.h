@@ -85,7 +85,8 @@ extern "C" {
 
 #ifdef MCUBOOT_BOOT_MAX_ALIGN
 
-#if defined(MCUBOOT_SWAP_USING_MOVE) || defined(MCUBOOT_SWAP_USING_SCRATCH)
+#if defined(MCUBOOT_SWAP_USING_MOVE) || defined(MCUBOOT_SWAP_USING_SCRATCH) || \
+    defined(MCUBOOT_SWAP_USING_OFFSET) || defined(MCUBOOT_SWAP_USING_BANK)
 _Static_assert(MCUBOOT_BOOT_MAX_ALIGN >= 8 && MCUBOOT_BOOT_MAX_ALIGN <= 32,
                "Unsupported value for MCUBOOT_BOOT_MAX_ALIGN for SWAP upgrade modes");
 #endif
@@ -309,6 +310,55 @@ int
 boot_image_load_header(const struct flash_area *fa_p,
                        struct image_header *hdr);
 
+#ifdef MCUBOOT_RAM_LOAD_STAGED
+/**
+ * Gets the end of the first stage of a staged RAM-load image, i.e. of the
+ * start of its payload that the bootloader loads and checks before booting
+ * it. It is given by the IMAGE_TLV_RAM_LOAD_STAGE TLV, rounded up to the
+ * chunks of the IMAGE_TLV_HASH_CHUNKS table. For images that are not staged,
+ * it is the end of the payload.
+ *
+ * @param image pointer to the header of the image in RAM, followed by its
+ *        payload and TLVs;
+ * @param end where the payload offset of the end of the stage is written.
+ *
+ * @return 0 on success; BOOT_EBADIMAGE if the TLVs are malformed.
+ */
+int
+boot_ram_load_stage_end(const uint8_t *image, uint32_t *end);
+
+/**
+ * Loads part of the payload of a staged RAM-load image from flash, and checks
+ * it against the chunk table of the image in RAM, which the bootloader has
+ * authenticated. Whole chunks are loaded, from the one holding payload
+ * offset @p off to the one holding offset @p off + @p size - 1.
+ *
+ * @param fa pointer to the flash area the image was loaded from;
+ * @param image pointer to the header of the image in RAM;
+ * @param off payload offset of the data to load;
+ * @param size size of the data to load.
+ *
+ * @return 0 on success; BOOT_EBADIMAGE if a chunk does not match the table,
+ *         in which case it is zeroed and the image must not be used further;
+ *         non-zero error code otherwise.
+ */
+int
+boot_ram_load_range(const struct flash_area *fa, uint8_t *image,
+                    uint32_t off, uint32_t size);
+
+/**
+ * Loads and checks the part of the payload of a staged RAM-load image that
+ * follows its first stage, see boot_ram_load_range().
+ *
+ * @param fa pointer to the flash area the image was loaded from;
+ * @param image pointer to the header of the image in RAM.
+ *
+ * @return 0 on success; non-zero error code on failure.
+ */
+int
+boot_ram_load_finish(const struct flash_area *fa, uint8_t *image);
+#endif /* MCUBOOT_RAM_LOAD_STAGED */
+
 #ifdef __cplusplus
 }
 #endif
@@ -53,6 +53,10 @@ uint32_t bootutil_get_caps(void);
 #define BOOTUTIL_CAP_DIRECT_XIP             (1<<17)
 #define BOOTUTIL_CAP_HW_ROLLBACK_PROT       (1<<18)
 #define BOOTUTIL_CAP_ECDSA_P384             (1<<19)
+#define BOOTUTIL_CAP_SWAP_USING_OFFSET      (1<<20)
+#define BOOTUTIL_CAP_SWAP_USING_BANK        (1<<21)
+#define BOOTUTIL_CAP_SWAP_PERM_DISCARD      (1<<22)
+#define BOOTUTIL_CAP_OVERWRITE_VERIFY_COPY  (1<<23)
 
 /*
  * Query the number of images this bootloader is configured for.  This
@@ -2,9 +2,11 @@
  * This module provides a thin abstraction over some of the crypto
  * primitives to make it easier to swap out the used crypto library.
  *
- * At this point, there are two choices: MCUBOOT_USE_MBED_TLS, or
- * MCUBOOT_USE_TINYCRYPT.  It is a compile error there is not exactly
- * one of these defined.
+ * At this point, the choices are: MCUBOOT_USE_MBED_TLS, MCUBOOT_USE_TINYCRYPT
+ * or MCUBOOT_USE_PSA_CRYPTO.  It is a compile error there is not exactly
+ * one of MCUBOOT_USE_MBED_TLS and MCUBOOT_USE_TINYCRYPT defined, except that
+ * MCUBOOT_USE_PSA_CRYPTO may be defined with MCUBOOT_USE_MBED_TLS, in which
+ * case it takes precedence.
  */
 
 #ifndef __BOOTUTIL_CRYPTO_AES_CTR_H_
@@ -14,12 +16,21 @@
 
 #include "mcuboot_config/mcuboot_config.h"
 
-#if (defined(MCUBOOT_USE_MBED_TLS) + \
+#if defined(MCUBOOT_USE_PSA_CRYPTO) || defined(MCUBOOT_USE_MBED_TLS)
+#define MCUBOOT_USE_PSA_OR_MBED_TLS
+#endif /* MCUBOOT_USE_PSA_CRYPTO || MCUBOOT_USE_MBED_TLS */
+
+#if (defined(MCUBOOT_USE_PSA_OR_MBED_TLS) + \
      defined(MCUBOOT_USE_TINYCRYPT)) != 1
-    #error "One crypto backend must be defined: either MBED_TLS or TINYCRYPT"
+    #error "One crypto backend must be defined: either MBED_TLS/PSA_CRYPTO or TINYCRYPT"
 #endif
 
-#if defined(MCUBOOT_USE_MBED_TLS)
+#if defined(MCUBOOT_USE_PSA_CRYPTO)
+    #include <psa/crypto.h>
+    #include "bootutil/enc_key_public.h"
+    #define BOOTUTIL_CRYPTO_AES_CTR_KEY_SIZE BOOT_ENC_KEY_SIZE
+    #define BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE (16)
+#elif defined(MCUBOOT_USE_MBED_TLS)
     #include <mbedtls/aes.h>
     #include "bootutil/enc_key_public.h"
     #define BOOTUTIL_CRYPTO_AES_CTR_KEY_SIZE BOOT_ENC_KEY_SIZE
@@ -44,7 +55,154 @@
 extern "C" {
 #endif
 
-#if defined(MCUBOOT_USE_MBED_TLS)
+#if defined(MCUBOOT_USE_PSA_CRYPTO)
+/*
+ * The key is imported once per image, and the multipart operation that
+ * generates the keystream is kept open between calls: as long as a call
+ * continues from the counter block the previous one stopped at, which is
+ * the case when a sector is copied or hashed chunk by chunk, its blocks are
+ * processed by the same operation, without setting it up again. This lets
+ * an accelerator keep the key and counter loaded and stream the data with
+ * DMA.
+ */
+typedef struct {
+    psa_key_id_t key_id;
+    psa_cipher_operation_t op;
+    uint8_t active;
+    uint8_t counter[BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE];
+} bootutil_aes_ctr_context;
+
+static inline void bootutil_aes_ctr_init(bootutil_aes_ctr_context *ctx)
+{
+    ctx->key_id = PSA_KEY_ID_NULL;
+    ctx->op = psa_cipher_operation_init();
+    ctx->active = 0;
+}
+
+static inline void bootutil_aes_ctr_drop(bootutil_aes_ctr_context *ctx)
+{
+    if (ctx->active) {
+        (void)psa_cipher_abort(&ctx->op);
+        ctx->active = 0;
+    }
+    if (ctx->key_id != PSA_KEY_ID_NULL) {
+        (void)psa_destroy_key(ctx->key_id);
+        ctx->key_id = PSA_KEY_ID_NULL;
+    }
+}
+
+static inline int bootutil_aes_ctr_set_key(bootutil_aes_ctr_context *ctx, const uint8_t *k)
+{
+    psa_key_attributes_t key_attributes = psa_key_attributes_init();
+    psa_status_t status;
+
+    bootutil_aes_ctr_drop(ctx);
+
+    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_ENCRYPT);
+    psa_set_key_algorithm(&key_attributes, PSA_ALG_CTR);
+    psa_set_key_type(&key_attributes, PSA_KEY_TYPE_AES);
+    psa_set_key_bits(&key_attributes, BOOTUTIL_CRYPTO_AES_CTR_KEY_SIZE * 8);
+
+    status = psa_import_key(&key_attributes, k, BOOTUTIL_CRYPTO_AES_CTR_KEY_SIZE,
+                            &ctx->key_id);
+    psa_reset_key_attributes(&key_attributes);
+    if (status != PSA_SUCCESS) {
+        ctx->key_id = PSA_KEY_ID_NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Adds `blocks' to the 128-bit big endian `counter'. */
+static inline void _bootutil_aes_ctr_add(uint8_t *counter, uint32_t blocks)
+{
+    int i;
+
+    for (i = BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE - 1; i >= 0 && blocks > 0; i--) {
+        blocks += counter[i];
+        counter[i] = (uint8_t)blocks;
+        blocks >>= 8;
+    }
+}
+
+static inline int _bootutil_aes_ctr_crypt(bootutil_aes_ctr_context *ctx, uint8_t *counter, const uint8_t *in, uint32_t inlen, uint32_t blk_off, uint8_t *out)
+{
+    psa_cipher_operation_t op = psa_cipher_operation_init();
+    uint8_t skip[BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE];
+    psa_status_t status;
+    size_t olen;
+
+    status = psa_cipher_encrypt_setup(&op, ctx->key_id, PSA_ALG_CTR);
+    if (status == PSA_SUCCESS) {
+        status = psa_cipher_set_iv(&op, counter, BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE);
+    }
+    if (status == PSA_SUCCESS && blk_off > 0) {
+        memset(skip, 0, blk_off);
+        status = psa_cipher_update(&op, skip, blk_off, skip, sizeof(skip), &olen);
+    }
+    if (status == PSA_SUCCESS) {
+        status = psa_cipher_update(&op, in, inlen, out, inlen, &olen);
+    }
+    (void)psa_cipher_abort(&op);
+    if (status != PSA_SUCCESS) {
+        return -1;
+    }
+    _bootutil_aes_ctr_add(counter, (blk_off + inlen) / BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE);
+    return 0;
+}
+
+static inline int bootutil_aes_ctr_encrypt(bootutil_aes_ctr_context *ctx, uint8_t *counter, const uint8_t *m, uint32_t mlen, uint32_t blk_off, uint8_t *c)
+{
+    return _bootutil_aes_ctr_crypt(ctx, counter, m, mlen, blk_off, c);
+}
+
+static inline int bootutil_aes_ctr_decrypt(bootutil_aes_ctr_context *ctx, uint8_t *counter, const uint8_t *c, uint32_t clen, uint32_t blk_off, uint8_t *m)
+{
+    return _bootutil_aes_ctr_crypt(ctx, counter, c, clen, blk_off, m);
+}
+
+/*
+ * Writes the keystream of `blocks' consecutive counter blocks to `ks' and
+ * advances the counter past them. The open operation is continued when
+ * `counter' is where it stopped, and set up again from `counter' otherwise.
+ */
+static inline int bootutil_aes_ctr_keystream(bootutil_aes_ctr_context *ctx, uint8_t *counter, uint8_t *ks, uint32_t blocks)
+{
+    uint32_t len = blocks * BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE;
+    psa_status_t status = PSA_SUCCESS;
+    size_t olen;
+
+    if (ctx->active &&
+        memcmp(ctx->counter, counter, BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE) != 0) {
+        (void)psa_cipher_abort(&ctx->op);
+        ctx->active = 0;
+    }
+    if (!ctx->active) {
+        status = psa_cipher_encrypt_setup(&ctx->op, ctx->key_id, PSA_ALG_CTR);
+        if (status == PSA_SUCCESS) {
+            status = psa_cipher_set_iv(&ctx->op, counter,
+                                       BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE);
+        }
+        if (status != PSA_SUCCESS) {
+            (void)psa_cipher_abort(&ctx->op);
+            return -1;
+        }
+        ctx->active = 1;
+    }
+
+    memset(ks, 0, len);
+    status = psa_cipher_update(&ctx->op, ks, len, ks, len, &olen);
+    if (status != PSA_SUCCESS || olen != len) {
+        (void)psa_cipher_abort(&ctx->op);
+        ctx->active = 0;
+        return -1;
+    }
+
+    _bootutil_aes_ctr_add(counter, blocks);
+    memcpy(ctx->counter, counter, BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE);
+    return 0;
+}
+#elif defined(MCUBOOT_USE_MBED_TLS)
 typedef mbedtls_aes_context bootutil_aes_ctr_context;
 static inline void bootutil_aes_ctr_init(bootutil_aes_ctr_context *ctx)
 {
@@ -72,6 +230,21 @@ static inline int bootutil_aes_ctr_decrypt(bootutil_aes_ctr_context *ctx, uint8_
     uint8_t stream_block[BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE];
     return mbedtls_aes_crypt_ctr(ctx, clen, &blk_off, counter, stream_block, c, m);
 }
+
+/*
+ * Writes the keystream of `blocks' consecutive counter blocks to `ks' and
+ * advances the counter past them. A single call lets an accelerated CTR
+ * implementation process all the blocks at once.
+ */
+static inline int bootutil_aes_ctr_keystream(bootutil_aes_ctr_context *ctx, uint8_t *counter, uint8_t *ks, uint32_t blocks)
+{
+    uint8_t stream_block[BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE];
+    size_t nc_off = 0;
+
+    memset(ks, 0, blocks * BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE);
+    return mbedtls_aes_crypt_ctr(ctx, blocks * BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE,
+                                 &nc_off, counter, stream_block, ks, ks);
+}
 #endif /* MCUBOOT_USE_MBED_TLS */
 
 #if defined(MCUBOOT_USE_TINYCRYPT)
@@ -115,6 +288,31 @@ static inline int bootutil_aes_ctr_decrypt(bootutil_aes_ctr_context *ctx, uint8_
 {
     return _bootutil_aes_ctr_crypt(ctx, counter, c, clen, blk_off, m);
 }
+
+/*
+ * Writes the keystream of `blocks' consecutive counter blocks to `ks' and
+ * advances the counter past them; as tc_ctr_mode() does, only its last 4
+ * bytes are incremented.
+ */
+static inline int bootutil_aes_ctr_keystream(bootutil_aes_ctr_context *ctx, uint8_t *counter, uint8_t *ks, uint32_t blocks)
+{
+    uint32_t block_num;
+
+    block_num = ((uint32_t)counter[12] << 24) | ((uint32_t)counter[13] << 16) |
+                ((uint32_t)counter[14] << 8) | counter[15];
+    while (blocks-- > 0) {
+        if (tc_aes_encrypt(ks, counter, ctx) != TC_CRYPTO_SUCCESS) {
+            return -1;
+        }
+        ks += TC_AES_BLOCK_SIZE;
+        block_num++;
+        counter[12] = (uint8_t)(block_num >> 24);
+        counter[13] = (uint8_t)(block_num >> 16);
+        counter[14] = (uint8_t)(block_num >> 8);
+        counter[15] = (uint8_t)block_num;
+    }
+    return 0;
+}
 #endif /* MCUBOOT_USE_TINYCRYPT */
 
 #ifdef __cplusplus
@@ -2,9 +2,9 @@
  * This module provides a thin abstraction over some of the crypto
  * primitives to make it easier to swap out the used crypto library.
  *
- * At this point, there are two choices: MCUBOOT_USE_MBED_TLS, or
- * MCUBOOT_USE_TINYCRYPT.  It is a compile error there is not exactly
- * one of these defined.
+ * At this point, the choices are: MCUBOOT_USE_PSA_CRYPTO,
+ * MCUBOOT_USE_MBED_TLS, or MCUBOOT_USE_TINYCRYPT.  It is a compile error
+ * there is not exactly one of these defined.
  */
 
 #ifndef __BOOTUTIL_CRYPTO_ECDH_P256_H_
@@ -12,11 +12,18 @@
 
 #include "mcuboot_config/mcuboot_config.h"
 
-#if (defined(MCUBOOT_USE_MBED_TLS) + \
+#if (defined(MCUBOOT_USE_PSA_CRYPTO) + \
+     defined(MCUBOOT_USE_MBED_TLS) + \
      defined(MCUBOOT_USE_TINYCRYPT)) != 1
-    #error "One crypto backend must be defined: either MBED_TLS or TINYCRYPT"
+    #error "One crypto backend must be defined: either PSA_CRYPTO, MBED_TLS or TINYCRYPT"
 #endif
 
+#if defined(MCUBOOT_USE_PSA_CRYPTO)
+    #include <psa/crypto.h>
+    #define EC256_PUBK_LEN (65)
+    #define NUM_ECC_BYTES (32)
+#endif /* MCUBOOT_USE_PSA_CRYPTO */
+
 #if defined(MCUBOOT_USE_MBED_TLS)
     #include <mbedtls/ecp.h>
     #include <mbedtls/ecdh.h>
@@ -67,6 +74,57 @@ static inline int bootutil_ecdh_p256_shared_secret(bootutil_ecdh_p256_context *c
 }
 #endif /* MCUBOOT_USE_TINYCRYPT */
 
+#if defined(MCUBOOT_USE_PSA_CRYPTO)
+/*
+ * The key agreement is done by the PSA Crypto implementation, and thus by
+ * its accelerator driver when there is one. The private key is imported as
+ * a volatile key for the duration of the call only.
+ */
+typedef uintptr_t bootutil_ecdh_p256_context;
+static inline void bootutil_ecdh_p256_init(bootutil_ecdh_p256_context *ctx)
+{
+    (void)ctx;
+}
+
+static inline void bootutil_ecdh_p256_drop(bootutil_ecdh_p256_context *ctx)
+{
+    (void)ctx;
+}
+
+static inline int bootutil_ecdh_p256_shared_secret(bootutil_ecdh_p256_context *ctx, const uint8_t *pk, const uint8_t *sk, uint8_t *z)
+{
+    psa_key_attributes_t key_attributes = psa_key_attributes_init();
+    psa_key_id_t key_id;
+    psa_status_t status;
+    size_t z_len;
+    (void)ctx;
+
+    if (pk[0] != 0x04) {
+        return -1;
+    }
+
+    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_DERIVE);
+    psa_set_key_algorithm(&key_attributes, PSA_ALG_ECDH);
+    psa_set_key_type(&key_attributes, PSA_KEY_TYPE_ECC_KEY_PAIR(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(&key_attributes, NUM_ECC_BYTES * 8);
+
+    status = psa_import_key(&key_attributes, sk, NUM_ECC_BYTES, &key_id);
+    psa_reset_key_attributes(&key_attributes);
+    if (status != PSA_SUCCESS) {
+        return -1;
+    }
+
+    /* The peer key is validated by the key agreement. */
+    status = psa_raw_key_agreement(PSA_ALG_ECDH, key_id, pk, EC256_PUBK_LEN,
+                                   z, NUM_ECC_BYTES, &z_len);
+    (void)psa_destroy_key(key_id);
+    if (status != PSA_SUCCESS || z_len != NUM_ECC_BYTES) {
+        return -1;
+    }
+    return 0;
+}
+#endif /* MCUBOOT_USE_PSA_CRYPTO */
+
 #if defined(MCUBOOT_USE_MBED_TLS)
 #define NUM_ECC_BYTES 32
 
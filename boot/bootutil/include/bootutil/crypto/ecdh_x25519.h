@@ -12,9 +12,14 @@
 
 #include "mcuboot_config/mcuboot_config.h"
 
-#if (defined(MCUBOOT_USE_MBED_TLS) + \
+#if (defined(MCUBOOT_USE_PSA_CRYPTO) + \
+     defined(MCUBOOT_USE_MBED_TLS) + \
      defined(MCUBOOT_USE_TINYCRYPT)) != 1
-    #error "One crypto backend must be defined: either MBED_TLS or TINYCRYPT"
+    #error "One crypto backend must be defined: either PSA_CRYPTO, MBED_TLS or TINYCRYPT"
+#endif
+
+#if defined(MCUBOOT_USE_PSA_CRYPTO)
+    #include <psa/crypto.h>
 #endif
 
 #ifdef __cplusplus
@@ -50,6 +55,47 @@ static inline int bootutil_ecdh_x25519_shared_secret(bootutil_ecdh_x25519_contex
 }
 #endif /* MCUBOOT_USE_TINYCRYPT */
 
+#if defined(MCUBOOT_USE_PSA_CRYPTO)
+/* See bootutil_ecdh_p256_shared_secret(). */
+typedef uintptr_t bootutil_ecdh_x25519_context;
+static inline void bootutil_ecdh_x25519_init(bootutil_ecdh_x25519_context *ctx)
+{
+    (void)ctx;
+}
+
+static inline void bootutil_ecdh_x25519_drop(bootutil_ecdh_x25519_context *ctx)
+{
+    (void)ctx;
+}
+
+static inline int bootutil_ecdh_x25519_shared_secret(bootutil_ecdh_x25519_context *ctx, const uint8_t *pk, const uint8_t *sk, uint8_t *z)
+{
+    psa_key_attributes_t key_attributes = psa_key_attributes_init();
+    psa_key_id_t key_id;
+    psa_status_t status;
+    size_t z_len;
+    (void)ctx;
+
+    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_DERIVE);
+    psa_set_key_algorithm(&key_attributes, PSA_ALG_ECDH);
+    psa_set_key_type(&key_attributes, PSA_KEY_TYPE_ECC_KEY_PAIR(PSA_ECC_FAMILY_MONTGOMERY));
+    psa_set_key_bits(&key_attributes, 255);
+
+    status = psa_import_key(&key_attributes, sk, 32, &key_id);
+    psa_reset_key_attributes(&key_attributes);
+    if (status != PSA_SUCCESS) {
+        return -1;
+    }
+
+    status = psa_raw_key_agreement(PSA_ALG_ECDH, key_id, pk, 32, z, 32, &z_len);
+    (void)psa_destroy_key(key_id);
+    if (status != PSA_SUCCESS || z_len != 32) {
+        return -1;
+    }
+    return 0;
+}
+#endif /* MCUBOOT_USE_PSA_CRYPTO */
+
 #ifdef __cplusplus
 }
 #endif
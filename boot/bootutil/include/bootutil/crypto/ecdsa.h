@@ -15,6 +15,10 @@
  * reason, it's allowed to have both of them defined, and for crypto modules
  * that support both abstractions, the MCUBOOT_USE_PSA_CRYPTO will take
  * precedence.
+ *
+ * MCUBOOT_EC384_HW verifies ECDSA P-384 signatures, with PSA Crypto, on the
+ * accelerator reached through the platform provided <ec384_hw_glue.h>
+ * instead of through psa_verify_hash().
  */
 
 #ifndef __BOOTUTIL_CRYPTO_ECDSA_H_
@@ -32,6 +36,11 @@
     #error "P384 requires PSA_CRYPTO to be defined"
 #endif
 
+#if defined(MCUBOOT_EC384_HW) && \
+    (!defined(MCUBOOT_SIGN_EC384) || defined(MCUBOOT_BUILTIN_KEY))
+    #error "MCUBOOT_EC384_HW requires P384 and is not supported with MCUBOOT_BUILTIN_KEY"
+#endif
+
 #if (defined(MCUBOOT_USE_TINYCRYPT) + \
      defined(MCUBOOT_USE_CC310) + \
      defined(MCUBOOT_USE_PSA_OR_MBED_TLS)) != 1
@@ -50,6 +59,9 @@
 #if defined(MCUBOOT_USE_PSA_CRYPTO)
     #include <psa/crypto.h>
     #include <string.h>
+#if defined(MCUBOOT_EC384_HW)
+    #include <ec384_hw_glue.h>
+#endif /* MCUBOOT_EC384_HW */
 #elif defined(MCUBOOT_USE_MBED_TLS)
     #include <mbedtls/ecdsa.h>
     /* Indicate to the caller that the verify function needs the raw ASN.1
@@ -392,11 +404,10 @@ static inline void bootutil_ecdsa_init(bootutil_ecdsa_context *ctx)
     ctx->required_algorithm = 0;
 
 #else /* !MCUBOOT_BUILTIN_KEY */
-    /* The incoming key ID is equal to the image index. The key ID value must be
-     * shifted (by one in this case) because zero is reserved (PSA_KEY_ID_NULL)
-     * and considered invalid.
+    /* The incoming key ID is equal to the image index, map it to the ID of
+     * the builtin key.
      */
-    ctx->key_id++; /* Make sure it is not equal to 0. */
+    ctx->key_id = MCUBOOT_BUILTIN_KEY_ID(ctx->key_id);
 #if defined(MCUBOOT_SIGN_EC256)
     ctx->curve_byte_count = 32;
     ctx->required_algorithm = PSA_ALG_SHA_256;
@@ -410,9 +421,14 @@ static inline void bootutil_ecdsa_init(bootutil_ecdsa_context *ctx)
 
 static inline void bootutil_ecdsa_drop(bootutil_ecdsa_context *ctx)
 {
+#if !defined(MCUBOOT_BUILTIN_KEY)
     if (ctx->key_id != PSA_KEY_ID_NULL) {
         (void)psa_destroy_key(ctx->key_id);
     }
+#else
+    /* Builtin keys are owned by the key store and must outlive the boot. */
+    (void)ctx;
+#endif
 }
 
 #if !defined(MCUBOOT_BUILTIN_KEY)
@@ -453,6 +469,15 @@ static int bootutil_ecdsa_parse_public_key(bootutil_ecdsa_context *ctx,
     }
 
     get_public_key_from_rfc5280_encoding(cp, &key_size);
+#if defined(MCUBOOT_EC384_HW)
+    /* The accelerator takes the uncompressed point, left in place. */
+    if (ctx->curve_byte_count == 48) {
+        if (key_size != 1 + 2 * 48 || (*cp)[0] != 0x04) {
+            return (int)PSA_ERROR_INVALID_ARGUMENT;
+        }
+        return 0;
+    }
+#endif /* MCUBOOT_EC384_HW */
     /* Set attributes and import key */
     psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_VERIFY_HASH);
     psa_set_key_algorithm(&key_attributes, PSA_ALG_ECDSA(ctx->required_algorithm));
@@ -477,6 +502,16 @@ static inline int bootutil_ecdsa_verify(bootutil_ecdsa_context *ctx,
     uint8_t reformatted_signature[96] = {0}; /* Enough for P-384 signature sizes */
     parse_signature_from_rfc5480_encoding(sig, ctx->curve_byte_count,reformatted_signature);
 
+#if defined(MCUBOOT_EC384_HW)
+    if (ctx->curve_byte_count == 48) {
+        if (pk == NULL || pk_len != 1 + 2 * 48 || pk[0] != 0x04 || hlen != 48) {
+            return (int)PSA_ERROR_INVALID_ARGUMENT;
+        }
+        return ec384_hw_ecdsa_verify_secp384r1(hash, pk + 1,
+                                               reformatted_signature);
+    }
+#endif /* MCUBOOT_EC384_HW */
+
     return (int) psa_verify_hash(ctx->key_id, PSA_ALG_ECDSA(ctx->required_algorithm),
                                  hash, hlen, reformatted_signature, 2*ctx->curve_byte_count);
 }
@@ -2,9 +2,9 @@
  * This module provides a thin abstraction over some of the crypto
  * primitives to make it easier to swap out the used crypto library.
  *
- * At this point, there are two choices: MCUBOOT_USE_MBED_TLS, or
- * MCUBOOT_USE_TINYCRYPT.  It is a compile error there is not exactly
- * one of these defined.
+ * At this point, the choices are: MCUBOOT_USE_PSA_CRYPTO,
+ * MCUBOOT_USE_MBED_TLS, or MCUBOOT_USE_TINYCRYPT.  It is a compile error
+ * there is not exactly one of these defined.
  */
 
 #ifndef __BOOTUTIL_CRYPTO_HMAC_SHA256_H_
@@ -12,11 +12,17 @@
 
 #include "mcuboot_config/mcuboot_config.h"
 
-#if (defined(MCUBOOT_USE_MBED_TLS) + \
+#if (defined(MCUBOOT_USE_PSA_CRYPTO) + \
+     defined(MCUBOOT_USE_MBED_TLS) + \
      defined(MCUBOOT_USE_TINYCRYPT)) != 1
-    #error "One crypto backend must be defined: either MBED_TLS or TINYCRYPT"
+    #error "One crypto backend must be defined: either PSA_CRYPTO, MBED_TLS or TINYCRYPT"
 #endif
 
+#if defined(MCUBOOT_USE_PSA_CRYPTO)
+    #include <stddef.h>
+    #include <psa/crypto.h>
+#endif /* MCUBOOT_USE_PSA_CRYPTO */
+
 #if defined(MCUBOOT_USE_MBED_TLS)
     #include <stdint.h>
     #include <stddef.h>
@@ -84,6 +90,74 @@ static inline int bootutil_hmac_sha256_finish(bootutil_hmac_sha256_context *ctx,
 }
 #endif /* MCUBOOT_USE_TINYCRYPT */
 
+#if defined(MCUBOOT_USE_PSA_CRYPTO)
+typedef struct {
+    psa_key_id_t key_id;
+    psa_mac_operation_t op;
+} bootutil_hmac_sha256_context;
+
+static inline void bootutil_hmac_sha256_init(bootutil_hmac_sha256_context *ctx)
+{
+    ctx->key_id = PSA_KEY_ID_NULL;
+    ctx->op = psa_mac_operation_init();
+}
+
+static inline void bootutil_hmac_sha256_drop(bootutil_hmac_sha256_context *ctx)
+{
+    (void)psa_mac_abort(&ctx->op);
+    if (ctx->key_id != PSA_KEY_ID_NULL) {
+        (void)psa_destroy_key(ctx->key_id);
+        ctx->key_id = PSA_KEY_ID_NULL;
+    }
+}
+
+static inline int bootutil_hmac_sha256_set_key(bootutil_hmac_sha256_context *ctx, const uint8_t *key, unsigned int key_size)
+{
+    psa_key_attributes_t key_attributes = psa_key_attributes_init();
+    psa_status_t status;
+
+    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_SIGN_MESSAGE);
+    psa_set_key_algorithm(&key_attributes, PSA_ALG_HMAC(PSA_ALG_SHA_256));
+    psa_set_key_type(&key_attributes, PSA_KEY_TYPE_HMAC);
+
+    status = psa_import_key(&key_attributes, key, key_size, &ctx->key_id);
+    psa_reset_key_attributes(&key_attributes);
+    if (status != PSA_SUCCESS) {
+        ctx->key_id = PSA_KEY_ID_NULL;
+        return -1;
+    }
+
+    status = psa_mac_sign_setup(&ctx->op, ctx->key_id, PSA_ALG_HMAC(PSA_ALG_SHA_256));
+    if (status != PSA_SUCCESS) {
+        return -1;
+    }
+    return 0;
+}
+
+static inline int bootutil_hmac_sha256_update(bootutil_hmac_sha256_context *ctx, const void *data, unsigned int data_length)
+{
+    psa_status_t status;
+
+    status = psa_mac_update(&ctx->op, data, data_length);
+    if (status != PSA_SUCCESS) {
+        return -1;
+    }
+    return 0;
+}
+
+static inline int bootutil_hmac_sha256_finish(bootutil_hmac_sha256_context *ctx, uint8_t *tag, unsigned int taglen)
+{
+    psa_status_t status;
+    size_t tag_len;
+
+    status = psa_mac_sign_finish(&ctx->op, tag, taglen, &tag_len);
+    if (status != PSA_SUCCESS || tag_len != taglen) {
+        return -1;
+    }
+    return 0;
+}
+#endif /* MCUBOOT_USE_PSA_CRYPTO */
+
 #if defined(MCUBOOT_USE_MBED_TLS)
 /**
  * The generic message-digest context.
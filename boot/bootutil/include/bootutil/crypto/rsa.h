@@ -133,6 +133,7 @@ bootutil_rsa_parse_private_key(bootutil_rsa_context *ctx, uint8_t **p, uint8_t *
 #endif /* BOOTUTIL_CRYPTO_RSA_CRYPT_ENABLED */
 
 #if defined(BOOTUTIL_CRYPTO_RSA_SIGN_ENABLED)
+#if !defined(MCUBOOT_BUILTIN_KEY)
 /*
  * Parse a RSA public key with format specified in RFC3447 A.1.1
  *
@@ -163,6 +164,7 @@ static size_t bootutil_rsa_get_len(const bootutil_rsa_context *ctx)
     }
     return PSA_BITS_TO_BYTES(psa_get_key_bits(&key_attributes));
 }
+#endif /* !MCUBOOT_BUILTIN_KEY */
 
 /* PSA Crypto has a dedicated API for RSASSA-PSS verification */
 static inline int bootutil_rsassa_pss_verify(const bootutil_rsa_context *ctx,
@@ -16,6 +16,13 @@
  * that MCUBOOT_USE_MBED_TLS supports. For this reason, it's allowed to have
  * both of them defined, and for crypto modules that support both abstractions,
  * the MCUBOOT_USE_PSA_CRYPTO will take precedence.
+ *
+ * MCUBOOT_SHA256_FAST replaces the SHA-256 of any of these backends with the
+ * implementation from bootutil/sha256_fast.h.
+ *
+ * MCUBOOT_EC384_HW replaces the SHA-384 of PSA Crypto, used with ECDSA P-384
+ * signatures, with the hashing engine reached through the platform provided
+ * <ec384_hw_glue.h>.
  */
 
 #ifndef __BOOTUTIL_CRYPTO_SHA_H_
@@ -45,6 +52,17 @@
     #define EXPECTED_HASH_TLV IMAGE_TLV_SHA256
 #endif /* MCUBOOT_SIGN */
 
+#if defined(MCUBOOT_SHA256_FAST) && \
+    (defined(MCUBOOT_SHA512) || defined(MCUBOOT_SIGN_EC384))
+    #error "MCUBOOT_SHA256_FAST only provides SHA-256"
+#endif
+
+#if defined(MCUBOOT_EC384_HW) && \
+    (!defined(MCUBOOT_SIGN_EC384) || defined(MCUBOOT_SHA512) || \
+     !defined(MCUBOOT_USE_PSA_CRYPTO))
+    #error "MCUBOOT_EC384_HW requires ECDSA P-384 signatures, SHA-384 and PSA_CRYPTO"
+#endif
+
 /* Universal defines for SHA-256 */
 #define BOOTUTIL_CRYPTO_SHA256_BLOCK_SIZE  (64)
 #define BOOTUTIL_CRYPTO_SHA256_DIGEST_SIZE (32)
@@ -77,13 +95,79 @@
     #include <cc310_glue.h>
 #endif /* MCUBOOT_USE_CC310 */
 
+#if defined(MCUBOOT_SHA256_FAST)
+    #include "bootutil/sha256_fast.h"
+#endif /* MCUBOOT_SHA256_FAST */
+
+#if defined(MCUBOOT_EC384_HW)
+    #include <ec384_hw_glue.h>
+#endif /* MCUBOOT_EC384_HW */
+
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#if defined(MCUBOOT_USE_PSA_CRYPTO)
+#if defined(MCUBOOT_SHA256_FAST)
+
+typedef struct bootutil_sha256_context bootutil_sha_context;
+
+static inline int bootutil_sha_init(bootutil_sha_context *ctx)
+{
+    bootutil_sha256_fast_init(ctx);
+    return 0;
+}
+
+static inline int bootutil_sha_drop(bootutil_sha_context *ctx)
+{
+    (void)ctx;
+    return 0;
+}
+
+static inline int bootutil_sha_update(bootutil_sha_context *ctx,
+                                      const void *data,
+                                      uint32_t data_len)
+{
+    bootutil_sha256_fast_update(ctx, data, data_len);
+    return 0;
+}
+
+static inline int bootutil_sha_finish(bootutil_sha_context *ctx,
+                                      uint8_t *output)
+{
+    bootutil_sha256_fast_finish(ctx, output);
+    return 0;
+}
+
+#elif defined(MCUBOOT_EC384_HW)
+
+typedef ec384_hw_sha384_context bootutil_sha_context;
+
+static inline int bootutil_sha_init(bootutil_sha_context *ctx)
+{
+    return ec384_hw_sha384_init(ctx);
+}
+
+static inline int bootutil_sha_drop(bootutil_sha_context *ctx)
+{
+    return ec384_hw_sha384_drop(ctx);
+}
+
+static inline int bootutil_sha_update(bootutil_sha_context *ctx,
+                                      const void *data,
+                                      uint32_t data_len)
+{
+    return ec384_hw_sha384_update(ctx, data, data_len);
+}
+
+static inline int bootutil_sha_finish(bootutil_sha_context *ctx,
+                                      uint8_t *output)
+{
+    return ec384_hw_sha384_finish(ctx, output);
+}
+
+#elif defined(MCUBOOT_USE_PSA_CRYPTO)
 
 typedef psa_hash_operation_t bootutil_sha_context;
 
@@ -191,7 +275,7 @@ static inline int bootutil_sha_finish(bootutil_sha_context *ctx,
 
 #endif /* MCUBOOT_USE_MBED_TLS */
 
-#if defined(MCUBOOT_USE_TINYCRYPT)
+#if defined(MCUBOOT_USE_TINYCRYPT) && !defined(MCUBOOT_SHA256_FAST)
 typedef struct tc_sha256_state_struct bootutil_sha_context;
 
 static inline int bootutil_sha_init(bootutil_sha_context *ctx)
@@ -218,9 +302,9 @@ static inline int bootutil_sha_finish(bootutil_sha_context *ctx,
 {
     return tc_sha256_final(output, ctx);
 }
-#endif /* MCUBOOT_USE_TINYCRYPT */
+#endif /* MCUBOOT_USE_TINYCRYPT && !MCUBOOT_SHA256_FAST */
 
-#if defined(MCUBOOT_USE_CC310)
+#if defined(MCUBOOT_USE_CC310) && !defined(MCUBOOT_SHA256_FAST)
 static inline int bootutil_sha_init(bootutil_sha_context *ctx)
 {
     cc310_sha256_init(ctx);
@@ -248,7 +332,7 @@ static inline int bootutil_sha_finish(bootutil_sha_context *ctx,
     cc310_sha256_finalize(ctx, output);
     return 0;
 }
-#endif /* MCUBOOT_USE_CC310 */
+#endif /* MCUBOOT_USE_CC310 && !MCUBOOT_SHA256_FAST */
 
 #ifdef __cplusplus
 }
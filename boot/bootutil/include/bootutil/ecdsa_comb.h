@@ -0,0 +1,54 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __BOOTUTIL_ECDSA_COMB_H__
+#define __BOOTUTIL_ECDSA_COMB_H__
+
+/**
+ * @file ecdsa_comb.h
+ *
+ * Precomputed comb tables used by MCUBOOT_ECDSA_P256_COMB to verify ECDSA
+ * P-256 signatures with keys that are built into the bootloader.
+ *
+ * The table of a point P holds the 15 affine points
+ * sum(b_j * 2^(64 * j) * P), j = 0..3, where b_j is bit j of the entry index
+ * plus one. Tables are generated with "imgtool getpub -e lang-c-comb".
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOTUTIL_ECDSA_COMB_TEETH   4
+#define BOOTUTIL_ECDSA_COMB_SPACING 64
+#define BOOTUTIL_ECDSA_COMB_POINTS  ((1 << BOOTUTIL_ECDSA_COMB_TEETH) - 1)
+
+struct bootutil_ecdsa_comb {
+    /* x then y of each point, as 32-bit words, least significant first. */
+    uint32_t points[BOOTUTIL_ECDSA_COMB_POINTS][16];
+};
+
+/**
+ * Verifies an ECDSA P-256 signature using the comb tables of the generator
+ * and of the public key.
+ *
+ * @param comb          Comb table of the public key.
+ * @param hash          Message hash, 32 bytes.
+ * @param sig           Signature as r followed by s, 32 bytes each, big
+ *                      endian.
+ *
+ * @return              0 if the signature is valid; nonzero otherwise.
+ */
+int bootutil_ecdsa_p256_comb_verify(const struct bootutil_ecdsa_comb *comb,
+                                    const uint8_t *hash, const uint8_t *sig);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOTUTIL_ECDSA_COMB_H__ */
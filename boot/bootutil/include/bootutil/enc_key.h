@@ -34,6 +34,7 @@
 #include "bootutil/image.h"
 #include "bootutil/sign_key.h"
 #include "bootutil/enc_key_public.h"
+#include "bootutil/fault_injection_hardening.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,6 +47,21 @@ struct enc_key_data {
     bootutil_aes_ctr_context aes_ctr;
 };
 
+#ifdef MCUBOOT_ENC_GCM
+/*
+ * State of the GCM tag computation over the encrypted payload of an image:
+ * the multiples of the hash key for 4-bit table lookups, the running GHASH
+ * and the encrypted initial counter block the tag is masked with.
+ */
+struct boot_enc_gcm {
+    uint64_t hl[16];
+    uint64_t hh[16];
+    uint8_t y[16];
+    uint8_t ek0[16];
+    uint32_t len;
+};
+#endif
+
 /**
  * Retrieve the private key for image encryption.
  *
@@ -57,6 +73,56 @@ struct enc_key_data {
  */
 int boot_enc_retrieve_private_key(struct bootutil_key **private_key);
 
+#ifdef MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY
+/**
+ * Wrap an image key, before it is saved in the swap status, under a key
+ * that does not leave the device, such as a hardware unique key.
+ *
+ * @param[in]   key          the BOOT_ENC_KEY_SIZE bytes AES key.
+ * @param[out]  wrapped      buffer of BOOT_ENC_WRAPPED_KEY_SIZE bytes to
+ *                           store the wrapped key.
+ *
+ * @return                   0 on success; nonzero on failure.
+ */
+int boot_enc_wrap_key(const uint8_t *key, uint8_t *wrapped);
+
+/**
+ * Unwrap an image key saved in the swap status by boot_enc_wrap_key().
+ *
+ * @param[in]   wrapped      the BOOT_ENC_WRAPPED_KEY_SIZE bytes wrapped key.
+ * @param[out]  key          buffer of BOOT_ENC_KEY_SIZE bytes to store the
+ *                           AES key.
+ *
+ * @return                   0 on success; nonzero if the wrapped key does
+ *                           not authenticate or on failure.
+ */
+int boot_enc_unwrap_key(const uint8_t *wrapped, uint8_t *key);
+#endif
+
+#ifdef MCUBOOT_ENC_XIP
+/**
+ * Program the inline decryption engine of the platform (e.g. OTFDEC) so that
+ * the payload of the encrypted image in the given flash area is decrypted as
+ * it is executed in place. Called once the image has been validated, before
+ * it is booted.
+ *
+ * The payload is the ih_img_size bytes following the ih_hdr_size bytes of the
+ * header, which, like the TLVs, is not encrypted. It is encrypted with
+ * AES-CTR, the counter block being the big-endian index of the 16 bytes
+ * block from the start of the payload.
+ *
+ * @param[in]   image_index  index of the image (from 0).
+ * @param[in]   fap          flash area of the slot the image is booted from.
+ * @param[in]   hdr          header of the image.
+ * @param[in]   key          the BOOT_ENC_KEY_SIZE bytes AES key.
+ *
+ * @return                   0 on success; nonzero on failure.
+ */
+int boot_enc_xip_configure(int image_index, const struct flash_area *fap,
+                           const struct image_header *hdr,
+                           const uint8_t *key);
+#endif
+
 struct boot_status;
 
 /* Decrypt random, symmetric encryption key */
@@ -76,6 +142,15 @@ void boot_enc_decrypt(struct enc_key_data *enc_state, int slot,
         uint32_t off, uint32_t sz, uint32_t blk_off, uint8_t *buf);
 void boot_enc_zeroize(struct enc_key_data *enc_state);
 
+#ifdef MCUBOOT_ENC_GCM
+int boot_enc_gcm_start(struct enc_key_data *enc_state, int slot,
+        struct boot_enc_gcm *gcm);
+void boot_enc_gcm_update(struct boot_enc_gcm *gcm, const uint8_t *buf,
+        uint32_t len);
+fih_ret boot_enc_gcm_verify(struct boot_enc_gcm *gcm,
+        const struct image_header *hdr, const struct flash_area *fap);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
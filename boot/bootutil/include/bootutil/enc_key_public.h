@@ -44,6 +44,17 @@ extern "C" {
 
 #define BOOT_ENC_KEY_ALIGN_SIZE ALIGN_UP(BOOT_ENC_KEY_SIZE, BOOT_MAX_ALIGN)
 
+/* Size of an image key wrapped by boot_enc_wrap_key(), by default that of
+ * an AES key wrap (RFC 3394) of the key.
+ */
+#ifdef MCUBOOT_SWAP_WRAPPED_ENCKEY_SIZE
+#define BOOT_ENC_WRAPPED_KEY_SIZE MCUBOOT_SWAP_WRAPPED_ENCKEY_SIZE
+#else
+#define BOOT_ENC_WRAPPED_KEY_SIZE (BOOT_ENC_KEY_SIZE + 8)
+#endif
+#define BOOT_ENC_WRAPPED_KEY_ALIGN_SIZE \
+    ALIGN_UP(BOOT_ENC_WRAPPED_KEY_SIZE, BOOT_MAX_ALIGN)
+
 #define TLV_ENC_RSA_SZ    256
 #define TLV_ENC_KW_SZ     (BOOT_ENC_KEY_SIZE + 8)
 #define TLV_ENC_EC256_SZ  (65 + 32 + BOOT_ENC_KEY_SIZE)
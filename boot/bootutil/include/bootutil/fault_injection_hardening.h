@@ -38,8 +38,10 @@
  *
  * FIH_ENABLE_DELAY causes random delays. This makes it hard to cause faults
  * precisely. It requires an RNG. An mbedtls integration is provided in
- * fault_injection_hardening_delay_mbedtls.h, but any RNG that has an entropy
- * source can be used by implementing the fih_delay_random_uchar function.
+ * fault_injection_hardening_delay_rng_mbedtls.c, but any RNG that has an
+ * entropy source, such as a hardware TRNG, can be used by defining
+ * MCUBOOT_FIH_DELAY_RNG_PLATFORM and implementing the fih_delay_init and
+ * fih_delay_random_uchar functions.
  *
  * The basic call pattern is:
  *
@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef H_BOOTUTIL_FLASH_STATS_H__
+#define H_BOOTUTIL_FLASH_STATS_H__
+
+/**
+ * @file flash_stats.h
+ *
+ * Flash operation statistics collected by the flash map backend when
+ * MCUBOOT_FLASH_STATS is enabled.  The backend times each
+ * flash_area_read(), flash_area_write() and flash_area_erase() and passes
+ * its outcome to flash_stats_record(), which keeps, for each flash area,
+ * the number of operations, bytes and errors and a histogram of the
+ * operation latencies.
+ */
+
+#include <stdint.h>
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MCUBOOT_FLASH_STATS_AREAS
+#define MCUBOOT_FLASH_STATS_AREAS 8
+#endif
+
+enum flash_stats_op {
+    FLASH_STATS_READ,
+    FLASH_STATS_WRITE,
+    FLASH_STATS_ERASE,
+    FLASH_STATS_OP_COUNT,
+};
+
+/*
+ * Latency buckets, bucket n counts the operations which took less than
+ * 16 << (2 * n) microseconds, the last one all slower operations:
+ * < 16us, < 64us, < 256us, < 1ms, < 4ms, < 16ms, < 65ms, longer.
+ */
+#define FLASH_STATS_BUCKETS 8
+
+struct flash_stats_counters {
+    uint32_t ops;
+    uint32_t bytes;
+    uint32_t errors;
+    /* Saturating latency histogram. */
+    uint16_t latency[FLASH_STATS_BUCKETS];
+};
+
+struct flash_stats_area {
+    uint8_t fa_id;
+    struct flash_stats_counters op[FLASH_STATS_OP_COUNT];
+};
+
+/**
+ * Records a flash operation, called by the flash map backend.  Operations
+ * on more than MCUBOOT_FLASH_STATS_AREAS different areas are dropped.
+ *
+ * @param fa_id             Id of the flash area.
+ * @param op                Kind of operation.
+ * @param len               Number of bytes of the operation.
+ * @param usecs             Duration of the operation, in microseconds.
+ * @param rc                Return code of the operation.
+ */
+void flash_stats_record(uint8_t fa_id, enum flash_stats_op op, uint32_t len,
+                        uint32_t usecs, int rc);
+
+/**
+ * Returns the statistics of the idx-th flash area that was accessed, or
+ * NULL past the last one.
+ */
+const struct flash_stats_area *flash_stats_get(int idx);
+
+/**
+ * Clears all statistics.
+ */
+void flash_stats_reset(void);
+
+/**
+ * Logs all statistics at the info level.
+ */
+void flash_stats_log(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_BOOTUTIL_FLASH_STATS_H__ */
@@ -80,6 +80,39 @@ struct flash_area;
 #define IMAGE_F_COMPRESSED_LZMA2         0x00000400
 #define IMAGE_F_COMPRESSED_ARM_THUMB_FLT 0x00000800
 
+/*
+ * Indicates that the image hash only covers the header and the protected
+ * TLVs, and that the payload is covered by the IMAGE_TLV_HASH_CHUNKS table
+ * of per-chunk digests held in the protected TLV area.
+ */
+#define IMAGE_F_HASH_CHUNKED             0x00001000
+
+/*
+ * Indicates that the payload is a patch which, applied to the image in the
+ * primary slot, gives the new image; see IMAGE_TLV_DELTA_BASE.
+ */
+#define IMAGE_F_DELTA                    0x00002000
+
+/*
+ * Indicates that the image data is a single LZ4 block, which may be used
+ * with IMAGE_F_COMPRESSED_ARM_THUMB_FLT instead of one of the LZMA flags.
+ */
+#define IMAGE_F_COMPRESSED_LZ4           0x00004000
+
+/*
+ * Indicates that the payload is encrypted with AES-GCM instead of AES-CTR,
+ * the tag being held in the IMAGE_TLV_ENC_GCM_TAG TLV. Used together with
+ * IMAGE_F_ENCRYPTED_AES128 or IMAGE_F_ENCRYPTED_AES256.
+ */
+#define IMAGE_F_ENCRYPTED_GCM            0x00008000
+
+/*
+ * Indicates that the payload is made of segments that are each loaded to
+ * their own RAM address, given by the IMAGE_TLV_RAM_LOAD_SEGMENTS table; the
+ * header and the TLVs are not loaded.
+ */
+#define IMAGE_F_RAM_LOAD_SEGMENTS        0x00010000
+
 /*
  * ECSDA224 is with NIST P-224
  * ECSDA256 is with NIST P-256
@@ -99,6 +132,19 @@ struct flash_area;
 #define IMAGE_TLV_SHA256            0x10   /* SHA256 of image hdr and body */
 #define IMAGE_TLV_SHA384            0x11   /* SHA384 of image hdr and body */
 #define IMAGE_TLV_SHA512            0x12   /* SHA512 of image hdr and body */
+#define IMAGE_TLV_HASH_CHUNKS       0x14   /* Chunk size followed by the
+                                            * digests of each payload chunk
+                                            */
+#define IMAGE_TLV_RAM_LOAD_STAGE    0x15   /* Size of the start of the
+                                            * payload loaded before boot
+                                            */
+#define IMAGE_TLV_RAM_LOAD_SEGMENTS 0x16   /* Load address and size of
+                                            * each payload segment
+                                            */
+#define IMAGE_TLV_SECTOR_DIGESTS    0x17   /* Sector size followed by the
+                                            * digests of the payload held
+                                            * by each sector of the slot
+                                            */
 #define IMAGE_TLV_RSA2048_PSS       0x20   /* RSA2048 of hash output */
 #define IMAGE_TLV_ECDSA224          0x21   /* ECDSA of hash output - Not supported anymore */
 #define IMAGE_TLV_ECDSA_SIG         0x22   /* ECDSA of hash output */
@@ -111,6 +157,7 @@ struct flash_area;
 #define IMAGE_TLV_ENC_KW            0x31   /* Key encrypted with AES-KW 128 or 256*/
 #define IMAGE_TLV_ENC_EC256         0x32   /* Key encrypted with ECIES-EC256 */
 #define IMAGE_TLV_ENC_X25519        0x33   /* Key encrypted with ECIES-X25519 */
+#define IMAGE_TLV_ENC_GCM_TAG       0x34   /* AES-GCM tag of the payload */
 #define IMAGE_TLV_DEPENDENCY        0x40   /* Image depends on other image */
 #define IMAGE_TLV_SEC_CNT           0x50   /* security counter */
 #define IMAGE_TLV_BOOT_RECORD       0x60   /* measured boot record */
@@ -126,6 +173,10 @@ struct flash_area;
                                             * the format and size of the raw slot (compressed)
                                             * signature
                                             */
+#define IMAGE_TLV_DELTA_BASE        0x73   /*
+                                            * Hash TLV value of the image the
+                                            * delta image applies to
+                                            */
 					   /*
 					    * vendor reserved TLVs at xxA0-xxFF,
 					    * where xx denotes the upper byte
@@ -155,6 +206,15 @@ struct image_dependency {
                                              */
 };
 
+/**
+ * Entry of the IMAGE_TLV_RAM_LOAD_SEGMENTS table. The segments follow each
+ * other in the payload, in the order of the table.
+ */
+struct image_ram_load_segment {
+    uint32_t load_addr;
+    uint32_t size;
+};
+
 /** Image header.  All fields are in little endian byte order. */
 STRUCT_PACKED image_header {
     uint32_t ih_magic;
@@ -182,10 +242,17 @@ STRUCT_PACKED image_tlv {
 #define ENCRYPTIONFLAGS (IMAGE_F_ENCRYPTED_AES128 | IMAGE_F_ENCRYPTED_AES256)
 #define IS_ENCRYPTED(hdr) (((hdr)->ih_flags & IMAGE_F_ENCRYPTED_AES128) \
                         || ((hdr)->ih_flags & IMAGE_F_ENCRYPTED_AES256))
+#ifdef MCUBOOT_ENC_XIP
+/* Encrypted images stay encrypted in both slots, and are decrypted by the
+ * inline decryption engine of the platform as they are executed. */
+#define MUST_DECRYPT(fap, idx, hdr) IS_ENCRYPTED(hdr)
+#else
 #define MUST_DECRYPT(fap, idx, hdr) \
     (flash_area_get_id(fap) == FLASH_AREA_IMAGE_SECONDARY(idx) && IS_ENCRYPTED(hdr))
+#endif
 
 #define COMPRESSIONFLAGS (IMAGE_F_COMPRESSED_LZMA1 | IMAGE_F_COMPRESSED_LZMA2 \
+                          | IMAGE_F_COMPRESSED_LZ4 \
                           | IMAGE_F_COMPRESSED_ARM_THUMB_FLT)
 #define IS_COMPRESSED(hdr) ((hdr)->ih_flags & COMPRESSIONFLAGS)
 #define MUST_DECOMPRESS(fap, idx, hdr) \
@@ -195,11 +262,26 @@ _Static_assert(sizeof(struct image_header) == IMAGE_HEADER_SIZE,
                "struct image_header not required size");
 
 struct enc_key_data;
+int bootutil_img_hash(struct enc_key_data *enc_state, int image_index,
+                      struct image_header *hdr, const struct flash_area *fap,
+                      uint8_t *tmp_buf, uint32_t tmp_buf_sz,
+                      uint8_t *hash_result, uint8_t *seed, int seed_len);
 fih_ret bootutil_img_validate(struct enc_key_data *enc_state, int image_index,
                               struct image_header *hdr,
                               const struct flash_area *fap,
                               uint8_t *tmp_buf, uint32_t tmp_buf_sz,
                               uint8_t *seed, int seed_len, uint8_t *out_hash);
+fih_ret bootutil_img_validate_digest(int image_index,
+                                     struct image_header *hdr,
+                                     const struct flash_area *fap,
+                                     uint8_t *tmp_buf, uint32_t tmp_buf_sz,
+                                     uint8_t *hash);
+fih_ret bootutil_img_validate_tlvs(int image_index,
+                                   struct image_header *hdr,
+                                   const struct flash_area *fap,
+                                   uint8_t *tmp_buf, uint32_t tmp_buf_sz);
+
+struct bootutil_tlv_index;
 
 struct image_tlv_iter {
     const struct image_header *hdr;
@@ -209,6 +291,9 @@ struct image_tlv_iter {
     uint32_t prot_end;
     uint32_t tlv_off;
     uint32_t tlv_end;
+    /* TLV index of the image and position in it, with MCUBOOT_TLV_INDEX. */
+    const struct bootutil_tlv_index *index;
+    uint16_t index_pos;
 };
 
 int bootutil_tlv_iter_begin(struct image_tlv_iter *it,
@@ -219,6 +304,13 @@ int bootutil_tlv_iter_next(struct image_tlv_iter *it, uint32_t *off,
                            uint16_t *len, uint16_t *type);
 int bootutil_tlv_iter_is_prot(struct image_tlv_iter *it, uint32_t off);
 
+#ifdef MCUBOOT_SECTOR_DIGESTS
+int bootutil_tlv_sector_digest(const struct image_header *hdr,
+                               const struct flash_area *fap, uint32_t off,
+                               uint8_t *digest, uint16_t digest_len,
+                               uint32_t *start, uint32_t *len);
+#endif
+
 int32_t bootutil_get_img_security_cnt(struct image_header *hdr,
                                       const struct flash_area *fap,
                                       uint32_t *security_cnt);
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __IMAGE_SOURCE_H__
+#define __IMAGE_SOURCE_H__
+
+/**
+ * @file image_source.h
+ *
+ * Platform interface used by MCUBOOT_IMAGE_SOURCE to install upgrades
+ * straight from a source which is not flash written by the application,
+ * such as a file on an SD card or a buffer filled from the network, instead
+ * of from a secondary slot in flash.
+ *
+ * The flash map backend still provides the secondary slot of each image,
+ * but only reads it, from the source: bootutil never writes to it nor
+ * erases it, and does not look for a trailer in it. Whether an upgrade is
+ * available is told by boot_image_source_pending() instead. The sectors of
+ * the secondary slot should be those of the primary slot.
+ *
+ * The image is read from the source in sequence, a chunk after the other,
+ * when it is validated and again when it is copied to the primary slot, so
+ * the backend can read ahead. With MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY, it is
+ * only read while it is copied, apart from its header. In any case, the
+ * copy in the primary slot is hashed while it is written and is checked
+ * against its own TLVs, so that an image changed in the source between two
+ * reads is never booted.
+ */
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Tells whether the source has an upgrade for an image. This must keep
+ * returning true, on this boot and the next ones, until
+ * boot_image_source_done() is called for the image, so that an upgrade
+ * interrupted by a reset is installed again from its start.
+ *
+ * @param image_index       Index of the image (from 0).
+ *
+ * @return                  true if the secondary slot of the image is to be
+ *                          installed; false otherwise.
+ */
+bool boot_image_source_pending(int image_index);
+
+/**
+ * Tells the source that the upgrade of an image has been dealt with, so
+ * that it is no longer pending.
+ *
+ * @param image_index       Index of the image (from 0).
+ * @param installed         true if the upgrade was installed in the primary
+ *                          slot; false if it was rejected.
+ */
+void boot_image_source_done(int image_index, bool installed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IMAGE_SOURCE_H__ */
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __IMAGE_WRITER_H__
+#define __IMAGE_WRITER_H__
+
+/**
+ * @file image_writer.h
+ *
+ * Library used by applications, with MCUBOOT_IMAGE_WRITER, to write an
+ * upgrade to the secondary slot of an image while it is being received.
+ *
+ * Data of any size and alignment is gathered into writes of
+ * MCUBOOT_IMAGE_WRITER_BUF_SIZE bytes, and each sector of the slot is erased
+ * right before the first write to it, so that the slot is written at the
+ * speed of the flash without being erased as a whole up front. The sectors
+ * holding the magic and flags of the slot trailer are erased when writing
+ * starts, so that no request or confirmation left by a previous image is
+ * taken for one of the new image.
+ *
+ * The image is hashed as it is written and, once complete, the hash is
+ * checked against the hash TLV of the image, so that only the TLVs of the
+ * image are read back. With MCUBOOT_PENDING_DIGEST, the hash is then
+ * handed over to the bootloader by boot_image_writer_set_pending().
+ * Encrypted and chunk-hashed images are written but not hashed.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bootutil/image.h"
+#include "bootutil/crypto/sha.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MCUBOOT_IMAGE_WRITER_BUF_SIZE
+#define MCUBOOT_IMAGE_WRITER_BUF_SIZE 512
+#endif
+
+struct flash_area;
+
+struct boot_image_writer {
+    const struct flash_area *fap;
+    int image_index;
+    /* Size of the image, TLVs included. */
+    uint32_t img_size;
+    /* Offset in the slot of the first byte held in buf. */
+    uint32_t off;
+    uint32_t buf_len;
+    /* The slot is erased from here up to trailer_off. */
+    uint32_t erased_off;
+    /* Offset of the first sector holding the trailer magic and flags. */
+    uint32_t trailer_off;
+    /* Size of the hashed part of the image; 0 if it is not hashed. */
+    uint32_t hash_len;
+    bool hashing;
+    bool digest_valid;
+    struct image_header hdr;
+    bootutil_sha_context sha;
+    uint8_t digest[IMAGE_HASH_SIZE];
+    uint8_t buf[MCUBOOT_IMAGE_WRITER_BUF_SIZE];
+};
+
+/**
+ * Starts writing an image to the secondary slot, erasing the sectors
+ * holding the magic and flags of its trailer.
+ *
+ * @param w                 Writer to be initialised.
+ * @param image_index       Index of the image (from 0).
+ * @param img_size          Size of the image, TLVs included.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int boot_image_writer_open(struct boot_image_writer *w, int image_index,
+                           uint32_t img_size);
+
+/**
+ * Writes the next part of the image, of any size and alignment. The data
+ * is copied, and the buffer can be reused as soon as this returns.
+ *
+ * @param w                 Writer.
+ * @param data              Next part of the image.
+ * @param len               Size of data.
+ *
+ * @return                  0 on success; nonzero on failure, after which the
+ *                          writer must be closed.
+ */
+int boot_image_writer_write(struct boot_image_writer *w, const void *data,
+                            size_t len);
+
+/**
+ * Writes what is left of the image once all of it has been passed to
+ * boot_image_writer_write(), and checks its hash against its hash TLV.
+ *
+ * @param w                 Writer.
+ *
+ * @return                  0 if the image is complete and, unless it is
+ *                          encrypted or chunk-hashed, matches its hash TLV;
+ *                          nonzero otherwise.
+ */
+int boot_image_writer_finish(struct boot_image_writer *w);
+
+/**
+ * Marks the image written as pending, like boot_set_pending_multi(). With
+ * MCUBOOT_PENDING_DIGEST, the hash checked by boot_image_writer_finish() is
+ * handed over as by boot_set_pending_digest_multi().
+ *
+ * @param w                 Writer, after a successful
+ *                          boot_image_writer_finish().
+ * @param permanent         Whether the image should be used permanently or
+ *                          only tested once:
+ *                               0=run image once, then confirm or revert.
+ *                               1=run image forever.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int boot_image_writer_set_pending(struct boot_image_writer *w, int permanent);
+
+/**
+ * Releases the writer, whether the image was finished or not.
+ *
+ * @param w                 Writer.
+ */
+void boot_image_writer_close(struct boot_image_writer *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IMAGE_WRITER_H__ */
@@ -7,6 +7,8 @@
 #ifndef H_MCUBOOT_STATUS_
 #define H_MCUBOOT_STATUS_
 
+#include <stdint.h>
+
 /* Enumeration representing the states that MCUboot can be in */
 typedef enum
 {
@@ -27,4 +29,29 @@ extern void mcuboot_status_change(mcuboot_status_type_t status);
 #define mcuboot_status_change(_status) do {} while (0)
 #endif
 
+/* Progress of an image upgrade, while in MCUBOOT_STATUS_UPGRADING */
+struct mcuboot_progress {
+	/* Index of the image being upgraded */
+	uint8_t image;
+	/* Steps (sectors swapped or copied) done and total */
+	uint32_t done;
+	uint32_t total;
+	/* Bytes moved by the steps done since the last reset */
+	uint32_t bytes;
+	/* Throughput and estimated time left, 0 while unknown */
+	uint32_t bytes_per_sec;
+	uint32_t eta_ms;
+};
+
+#if defined(MCUBOOT_UPGRADE_PROGRESS)
+/*
+ * Called once when an upgrade of an image starts, with the steps already
+ * done before a reset, then after each step.  Throughput and time left
+ * need the port to define MCUBOOT_UPTIME_MS().
+ */
+extern void mcuboot_status_progress(const struct mcuboot_progress *progress);
+#else
+#define mcuboot_status_progress(_progress) do {} while (0)
+#endif
+
 #endif /* H_MCUBOOT_STATUS_ */
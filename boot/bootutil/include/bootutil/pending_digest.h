@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __PENDING_DIGEST_H__
+#define __PENDING_DIGEST_H__
+
+/**
+ * @file pending_digest.h
+ *
+ * Interface used by MCUBOOT_PENDING_DIGEST to hand the digest of an upgrade
+ * computed by the application over to the bootloader, so that the image in
+ * the secondary slot does not need to be hashed again before it is installed.
+ *
+ * The application stores a record holding the digest right after the TLVs of
+ * the image in the secondary slot, together with a MAC over the image header
+ * and the digest computed by the platform. The bootloader only uses the
+ * digest if the MAC matches, and then still checks it against the image hash
+ * TLV and verifies the signature over it. The MAC key must only be usable by
+ * trusted code (e.g. a device key held by a secure element or a key slot
+ * locked to the bootloader and to the update agent), and nothing but the
+ * update agent must be able to write the secondary slot between the time the
+ * record is stored and the next boot: the image payload is not read again
+ * by the bootloader. If this can not be guaranteed, the option must not be
+ * enabled.
+ */
+
+#include <stdint.h>
+#include "bootutil/image.h"
+#include "bootutil/crypto/sha.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOT_PENDING_DIGEST_MAGIC  0x50444731 /* "PDG1" */
+#define BOOT_PENDING_DIGEST_MAC_SZ 32
+
+struct boot_pending_digest {
+    uint32_t magic;
+    /* Digest of the image, as stored in its hash TLV. */
+    uint8_t digest[IMAGE_HASH_SIZE];
+    /* MAC over the image header and the digest. */
+    uint8_t mac[BOOT_PENDING_DIGEST_MAC_SZ];
+};
+
+/**
+ * Computes the MAC binding a digest to an image header, with a key that is
+ * only available to trusted code. Implemented by the platform, it must give
+ * the same result in the application and in the bootloader.
+ *
+ * @param image_index       Index of the image (from 0).
+ * @param hdr               Header of the image.
+ * @param digest            Digest of the image, IMAGE_HASH_SIZE bytes.
+ * @param mac               Buffer for the MAC, BOOT_PENDING_DIGEST_MAC_SZ
+ *                          bytes.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int boot_pending_digest_mac(uint32_t image_index,
+                            const struct image_header *hdr,
+                            const uint8_t *digest, uint8_t *mac);
+
+/**
+ * Marks the image with the given index in the secondary slot as pending,
+ * like boot_set_pending_multi(), after storing the digest of the image
+ * computed by the application while it was received, so that the bootloader
+ * does not hash it again. The digest is not checked here.
+ *
+ * @param image_index       Image pair index.
+ * @param permanent         Whether the image should be used permanently or
+ *                          only tested once:
+ *                               0=run image once, then confirm or revert.
+ *                               1=run image forever.
+ * @param digest            Digest of the image, IMAGE_HASH_SIZE bytes.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int boot_set_pending_digest_multi(int image_index, int permanent,
+                                  const uint8_t *digest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PENDING_DIGEST_H__ */
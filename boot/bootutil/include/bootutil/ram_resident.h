@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __RAM_RESIDENT_H__
+#define __RAM_RESIDENT_H__
+
+/**
+ * @file ram_resident.h
+ *
+ * Platform interface used by MCUBOOT_RAM_LOAD_RESIDENT to skip copying an
+ * image to RAM, and validating it, when the copy made on a previous boot has
+ * survived the reset.
+ *
+ * A record describing the image last validated in RAM is kept by the
+ * platform, e.g. in retained RAM. The copy in RAM is only used if the record
+ * matches the slot selected for the image, if the header and TLVs in RAM are
+ * those of the slot and if the copy in RAM still hashes to the image hash
+ * TLV. The signature is not checked again, so the platform must make sure
+ * that only the bootloader can produce a record boot_ram_resident_read()
+ * accepts: by authenticating it, e.g. with a MAC under a device key that the
+ * application can not use, or by keeping it in memory locked against writes
+ * before the application starts. A record the application can forge lets it
+ * boot an unsigned image written to the slot with a matching hash TLV.
+ */
+
+#include <stdint.h>
+#include "bootutil/crypto/sha.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOT_RAM_RESIDENT_MAGIC 0x52525331 /* "RRS1" */
+
+struct boot_ram_resident_record {
+    uint32_t magic;
+    /* Slot the image was loaded from. */
+    uint32_t slot;
+    /* Load address and size of the image in RAM. */
+    uint32_t img_dst;
+    uint32_t img_sz;
+    /* Value of the image hash TLV. */
+    uint8_t img_hash[IMAGE_HASH_SIZE];
+};
+
+/**
+ * Reads the record of the image last validated in RAM, once checked to
+ * have been stored by the bootloader.
+ *
+ * @param image_index       Index of the image (from 0).
+ * @param rec               Record to be populated.
+ *
+ * @return                  0 on success; nonzero if there is no record or
+ *                          if it could not be authenticated.
+ */
+int boot_ram_resident_read(uint32_t image_index,
+                           struct boot_ram_resident_record *rec);
+
+/**
+ * Stores the record of the image just validated in RAM, replacing any
+ * previous one.
+ *
+ * @param image_index       Index of the image (from 0).
+ * @param rec               Record to be stored.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int boot_ram_resident_write(uint32_t image_index,
+                            const struct boot_ram_resident_record *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RAM_RESIDENT_H__ */
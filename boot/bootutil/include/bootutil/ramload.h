@@ -28,6 +28,35 @@ int boot_get_image_exec_ram_info(uint32_t image_id,
                                  uint32_t *exec_ram_size);
 #endif
 
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+/**
+ * Provides information about the RAM regions the segments of a given image
+ * may be loaded to, when it is scatter loaded (IMAGE_F_RAM_LOAD_SEGMENTS);
+ * each segment has to fit in one of them.
+ *
+ * @param image_id  Index of the image (from 0).
+ * @param region    Index of the region (from 0).
+ * @param start     Pointer to store the start address of the region
+ * @param size      Pointer to store the size of the region
+ *
+ * @return          0 on success; nonzero if there is no such region.
+ */
+int boot_get_image_ram_load_region(uint32_t image_id, uint32_t region,
+                                   uint32_t *start, uint32_t *size);
+#endif
+
+#ifdef MCUBOOT_RAM_CLEAR
+/**
+ * Sets a region of RAM to 0, e.g. with word stores or a DMA memset, to
+ * remove an image from RAM. Provided by the port. It may be called with
+ * interrupts locked, so a DMA transfer has to be polled for completion.
+ *
+ * @param dst   Start of the region.
+ * @param size  Size of the region, in bytes.
+ */
+void boot_ram_clear(void *dst, uint32_t size);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
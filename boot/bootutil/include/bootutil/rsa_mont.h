@@ -0,0 +1,57 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __BOOTUTIL_RSA_MONT_H__
+#define __BOOTUTIL_RSA_MONT_H__
+
+/**
+ * @file rsa_mont.h
+ *
+ * Precomputed Montgomery constants used by MCUBOOT_RSA_MONT to apply RSA
+ * public keys that are built into the bootloader.
+ *
+ * With a modulus N of BOOTUTIL_RSA_MONT_WORDS 32-bit words and
+ * R = 2^(32 * BOOTUTIL_RSA_MONT_WORDS), the constants are N, R^2 mod N and
+ * -N^-1 mod 2^32. They are generated with "imgtool getpub -e lang-c-mont"
+ * and only valid for keys whose public exponent is 65537.
+ */
+
+#include <stdint.h>
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOTUTIL_RSA_MONT_WORDS (MCUBOOT_SIGN_RSA_LEN / 32)
+
+struct bootutil_rsa_mont {
+    /* Words of N and of R^2 mod N, least significant first. */
+    uint32_t n[BOOTUTIL_RSA_MONT_WORDS];
+    uint32_t rr[BOOTUTIL_RSA_MONT_WORDS];
+    uint32_t n0inv;
+};
+
+/**
+ * Computes sig^65537 mod N, the RSAVP1 primitive for the key.
+ *
+ * @param key           Montgomery constants of the public key.
+ * @param sig           Signature, MCUBOOT_SIGN_RSA_LEN / 8 bytes, big
+ *                      endian.
+ * @param em            Buffer of MCUBOOT_SIGN_RSA_LEN / 8 bytes receiving
+ *                      the result, big endian.
+ *
+ * @return              0 on success; nonzero if the signature is not
+ *                      smaller than N.
+ */
+int bootutil_rsa_mont_public(const struct bootutil_rsa_mont *key,
+                             const uint8_t *sig, uint8_t *em);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOTUTIL_RSA_MONT_H__ */
@@ -26,6 +26,7 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "bootutil/fault_injection_hardening.h"
 
 #ifdef __cplusplus
@@ -63,6 +64,21 @@ fih_ret boot_nv_security_counter_get(uint32_t image_id, fih_int *security_cnt);
 int32_t boot_nv_security_counter_update(uint32_t image_id,
                                         uint32_t img_security_cnt);
 
+/**
+ * Updates the stored values of several security counters in one operation,
+ * e.g. a single OTP programming sequence or secure element transaction.
+ * Optional, used with MCUBOOT_HW_ROLLBACK_PROT_CACHE.
+ * @param img_security_cnt  New security counter value of each image, with
+ *                          the same constraints as for
+ *                          boot_nv_security_counter_update().
+ * @param update            Whether the counter of each image is updated.
+ * @param count             Number of entries in both arrays.
+ * @return                  0 on success; nonzero on failure.
+ */
+int32_t boot_nv_security_counter_update_batch(const uint32_t *img_security_cnt,
+                                              const bool *update,
+                                              uint32_t count);
+
 #ifdef __cplusplus
 }
 #endif
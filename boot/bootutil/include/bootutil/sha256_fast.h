@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __BOOTUTIL_SHA256_FAST_H__
+#define __BOOTUTIL_SHA256_FAST_H__
+
+/**
+ * @file sha256_fast.h
+ *
+ * SHA-256 implementation used by MCUBOOT_SHA256_FAST in place of the one of
+ * the crypto library, for targets without hashing hardware.
+ *
+ * Whole blocks are hashed straight from the caller's buffer, and the
+ * compression function is unrolled so that the working variables stay in
+ * registers, which suits cores with a barrel shifter such as the Armv7-M
+ * ones.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct bootutil_sha256_context {
+    uint32_t state[8];
+    /* Number of bytes hashed so far. */
+    uint64_t len;
+    uint8_t buf[64];
+    uint32_t buf_len;
+};
+
+/**
+ * Starts a new SHA-256 computation.
+ *
+ * @param ctx           Context to initialise.
+ */
+void bootutil_sha256_fast_init(struct bootutil_sha256_context *ctx);
+
+/**
+ * Hashes data.
+ *
+ * @param ctx           Context of the computation.
+ * @param data          Data to hash.
+ * @param len           Number of bytes at data.
+ */
+void bootutil_sha256_fast_update(struct bootutil_sha256_context *ctx,
+                                 const void *data, uint32_t len);
+
+/**
+ * Ends the computation and writes the digest.
+ *
+ * @param ctx           Context of the computation.
+ * @param digest        Buffer of 32 bytes receiving the digest.
+ */
+void bootutil_sha256_fast_finish(struct bootutil_sha256_context *ctx,
+                                 uint8_t *digest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOTUTIL_SHA256_FAST_H__ */
@@ -33,9 +33,24 @@ extern "C" {
 #endif
 
 #ifndef MCUBOOT_HW_KEY
+#ifdef MCUBOOT_ECDSA_P256_COMB
+struct bootutil_ecdsa_comb;
+#endif
+#ifdef MCUBOOT_RSA_MONT
+struct bootutil_rsa_mont;
+#endif
+
 struct bootutil_key {
     const uint8_t *key;
     const unsigned int *len;
+#ifdef MCUBOOT_ECDSA_P256_COMB
+    /* Optional precomputed comb table of the key, see ecdsa_comb.h. */
+    const struct bootutil_ecdsa_comb *comb;
+#endif
+#ifdef MCUBOOT_RSA_MONT
+    /* Optional precomputed Montgomery constants of the key, see rsa_mont.h. */
+    const struct bootutil_rsa_mont *mont;
+#endif
 };
 
 extern const struct bootutil_key bootutil_keys[];
@@ -62,6 +77,17 @@ int boot_retrieve_public_key_hash(uint8_t image_index,
                                   size_t *key_hash_size);
 #endif /* !MCUBOOT_HW_KEY */
 
+#ifdef MCUBOOT_BUILTIN_KEY
+/*
+ * Maps the index of an image to the ID of the builtin (e.g. persistent, or
+ * stored in a secure element) key verifying its signature. The default
+ * skips PSA_KEY_ID_NULL, which is reserved.
+ */
+#ifndef MCUBOOT_BUILTIN_KEY_ID
+#define MCUBOOT_BUILTIN_KEY_ID(image_index) ((image_index) + 1)
+#endif
+#endif /* MCUBOOT_BUILTIN_KEY */
+
 extern const int bootutil_key_cnt;
 
 #ifdef __cplusplus
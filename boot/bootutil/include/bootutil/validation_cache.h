@@ -0,0 +1,90 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __VALIDATION_CACHE_H__
+#define __VALIDATION_CACHE_H__
+
+/**
+ * @file validation_cache.h
+ *
+ * Platform interface used by MCUBOOT_VALIDATION_CACHE to skip the full
+ * hash/signature check of the image in the primary slot when it has already
+ * been validated on a previous boot.
+ *
+ * A record describing the last successfully validated image is kept by the
+ * platform, e.g. in retained RAM or in a dedicated flash record. The record
+ * is only trusted if the platform's erase generation counter of the primary
+ * slot is unchanged, which requires this counter to be incremented by every
+ * agent (bootloader, application, debugger flash algorithm, ...) each time
+ * the slot is erased or written. If this can not be guaranteed, the cache
+ * must not be enabled.
+ *
+ * A record binds the result to the header and hash TLV of the image, not to
+ * its payload, and a matching record skips the signature check. The records
+ * and the generation counter must therefore be out of reach of the
+ * application: authenticated with a key only the bootloader can use, or kept
+ * in memory locked against writes before the application starts. Memory the
+ * application can write, such as a Zephyr retention partition, is not
+ * suitable.
+ */
+
+#include <stdint.h>
+#include "bootutil/crypto/sha.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOT_VALIDATION_RECORD_MAGIC 0x56434831 /* "VCH1" */
+
+struct boot_validation_record {
+    uint32_t magic;
+    /* Erase generation of the primary slot when the image was validated. */
+    uint32_t generation;
+    /* Digest of the image header. */
+    uint8_t hdr_digest[IMAGE_HASH_SIZE];
+    /* Value of the image hash TLV. */
+    uint8_t img_hash[IMAGE_HASH_SIZE];
+};
+
+/**
+ * Reads the current erase generation counter of an image's primary slot.
+ *
+ * @param image_index       Index of the image (from 0).
+ * @param generation        Pointer to store the generation value.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int boot_validation_cache_generation(uint32_t image_index,
+                                     uint32_t *generation);
+
+/**
+ * Reads the stored validation record of an image.
+ *
+ * @param image_index       Index of the image (from 0).
+ * @param rec               Record to be populated.
+ *
+ * @return                  0 on success; nonzero if there is no record.
+ */
+int boot_validation_cache_read(uint32_t image_index,
+                               struct boot_validation_record *rec);
+
+/**
+ * Stores the validation record of an image, replacing any previous one.
+ *
+ * @param image_index       Index of the image (from 0).
+ * @param rec               Record to be stored.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int boot_validation_cache_write(uint32_t image_index,
+                                const struct boot_validation_record *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VALIDATION_CACHE_H__ */
@@ -0,0 +1,269 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef MCUBOOT_BOOT_PROFILE
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bootutil/bench.h"
+#include "bootutil/bootutil_log.h"
+
+#ifdef MCUBOOT_DATA_SHARING
+#include "bootutil/boot_record.h"
+#include "bootutil/boot_status.h"
+#endif
+
+BOOT_LOG_MODULE_DECLARE(mcuboot);
+
+static struct boot_phase_entry boot_profile[BOOT_PHASE_COUNT];
+
+/* Cycle counter when the outermost run of each phase was started. */
+static uint32_t phase_start[BOOT_PHASE_COUNT];
+/* Nesting depth of each phase, only the outermost run is timed. */
+static uint8_t phase_depth[BOOT_PHASE_COUNT];
+/* Phase running when each phase was started, restored on stop. */
+static uint8_t phase_outer[BOOT_PHASE_COUNT];
+static uint8_t phase_current = BOOT_PHASE_NONE;
+
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+#define BOOT_PROFILE_PAINT      0xa5a5a5a5u
+/* Bytes below the frame of the painter left alone, for its own spills and
+ * for the red zone of the ABIs which have one. */
+#define BOOT_PROFILE_PAINT_GAP  256
+
+static uint32_t boot_profile_stack[BOOT_PHASE_COUNT];
+static struct boot_arena_entry boot_profile_arenas[BOOT_ARENA_COUNT];
+static uint8_t *arena_base[BOOT_ARENA_COUNT];
+
+/* Returns the stack used since it was last painted, in bytes. */
+static uint32_t
+boot_profile_stack_peak(void)
+{
+    uintptr_t start = ((uintptr_t)plat_bench_stack_start() + 3) & ~(uintptr_t)3;
+    uintptr_t top = (uintptr_t)plat_bench_stack_start() + plat_bench_stack_size();
+    const volatile uint32_t *p = (const volatile uint32_t *)start;
+
+    while ((uintptr_t)p < top && *p == BOOT_PROFILE_PAINT) {
+        p++;
+    }
+
+    return (uint32_t)(top - (uintptr_t)p);
+}
+
+/* Paints the free part of the stack, below the frame of the caller. */
+static void
+boot_profile_stack_paint(void)
+{
+    uintptr_t start = ((uintptr_t)plat_bench_stack_start() + 3) & ~(uintptr_t)3;
+    volatile uint32_t marker = 0;
+    uintptr_t end = (uintptr_t)&marker;
+    volatile uint32_t *p;
+
+    if (end < start + BOOT_PROFILE_PAINT_GAP) {
+        return;
+    }
+    end -= BOOT_PROFILE_PAINT_GAP;
+
+    for (p = (volatile uint32_t *)start; (uintptr_t)p < end; p++) {
+        *p = BOOT_PROFILE_PAINT;
+    }
+}
+
+/* Charges the current peak to the running phases. */
+static void
+boot_profile_stack_charge(void)
+{
+    uint32_t peak = boot_profile_stack_peak();
+    int i;
+
+    for (i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (phase_depth[i] != 0 && boot_profile_stack[i] < peak) {
+            boot_profile_stack[i] = peak;
+        }
+    }
+}
+#else
+#define boot_profile_stack_charge() do { } while (0)
+#define boot_profile_stack_paint() do { } while (0)
+#endif /* MCUBOOT_BOOT_PROFILE_STACK */
+
+void
+boot_phase_start(enum boot_phase phase)
+{
+    if (phase >= BOOT_PHASE_COUNT) {
+        return;
+    }
+
+    boot_profile_stack_charge();
+    boot_profile_stack_paint();
+
+    if (phase_depth[phase]++ != 0) {
+        return;
+    }
+
+    if (boot_profile[phase].count == 0) {
+        boot_profile[phase].parent = phase_current;
+    }
+    phase_outer[phase] = phase_current;
+    phase_current = phase;
+    phase_start[phase] = plat_bench_cycles();
+}
+
+void
+boot_phase_stop(enum boot_phase phase)
+{
+    struct boot_phase_entry *entry;
+    uint32_t now;
+
+    now = plat_bench_cycles();
+
+    if (phase >= BOOT_PHASE_COUNT || phase_depth[phase] == 0) {
+        return;
+    }
+
+    boot_profile_stack_charge();
+
+    if (--phase_depth[phase] != 0) {
+        return;
+    }
+
+    entry = &boot_profile[phase];
+    entry->cycles += now - phase_start[phase];
+    if (entry->count < UINT16_MAX) {
+        entry->count++;
+    }
+    phase_current = phase_outer[phase];
+}
+
+const struct boot_phase_entry *
+boot_profile_table(void)
+{
+    return boot_profile;
+}
+
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+const uint32_t *
+boot_profile_stack_table(void)
+{
+    return boot_profile_stack;
+}
+
+void
+boot_profile_arena_paint(enum boot_arena arena, void *buf, size_t size)
+{
+    uint8_t *p = buf;
+    size_t i;
+
+    if (arena >= BOOT_ARENA_COUNT) {
+        return;
+    }
+
+    for (i = 0; i < size; i++) {
+        p[i] = (uint8_t)BOOT_PROFILE_PAINT;
+    }
+
+    arena_base[arena] = p;
+    boot_profile_arenas[arena].size = size;
+    boot_profile_arenas[arena].used = 0;
+}
+
+const struct boot_arena_entry *
+boot_profile_arena_table(void)
+{
+    uint32_t used;
+    int i;
+
+    for (i = 0; i < BOOT_ARENA_COUNT; i++) {
+        used = boot_profile_arenas[i].size;
+        while (used > 0 && arena_base[i][used - 1] == (uint8_t)BOOT_PROFILE_PAINT) {
+            used--;
+        }
+        boot_profile_arenas[i].used = used;
+    }
+
+    return boot_profile_arenas;
+}
+#endif /* MCUBOOT_BOOT_PROFILE_STACK */
+
+void
+boot_profile_log(void)
+{
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+    const struct boot_arena_entry *arenas = boot_profile_arena_table();
+#endif
+    int i;
+
+    for (i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (boot_profile[i].count == 0) {
+            continue;
+        }
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+        BOOT_LOG_INF("Phase %d: %u runs, %lu cycles, %lu stack bytes", i,
+                     (unsigned int)boot_profile[i].count,
+                     (unsigned long)boot_profile[i].cycles,
+                     (unsigned long)boot_profile_stack[i]);
+#else
+        BOOT_LOG_INF("Phase %d: %u runs, %lu cycles", i,
+                     (unsigned int)boot_profile[i].count,
+                     (unsigned long)boot_profile[i].cycles);
+#endif
+    }
+
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+    for (i = 0; i < BOOT_ARENA_COUNT; i++) {
+        if (arenas[i].size != 0) {
+            BOOT_LOG_INF("Arena %d: %lu of %lu bytes used", i,
+                         (unsigned long)arenas[i].used,
+                         (unsigned long)arenas[i].size);
+        }
+    }
+#endif
+}
+
+#ifdef MCUBOOT_DATA_SHARING
+int
+boot_profile_save_shared_data(void)
+{
+    int rc;
+
+    rc = boot_add_data_to_shared_area(TLV_MAJOR_BOOT_PROFILE,
+                                      BOOT_PROFILE_TABLE,
+                                      sizeof(boot_profile),
+                                      (const uint8_t *)boot_profile);
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+    if (rc == 0) {
+        rc = boot_add_data_to_shared_area(TLV_MAJOR_BOOT_PROFILE,
+                                          BOOT_PROFILE_STACK,
+                                          sizeof(boot_profile_stack),
+                                          (const uint8_t *)boot_profile_stack);
+    }
+    if (rc == 0) {
+        rc = boot_add_data_to_shared_area(TLV_MAJOR_BOOT_PROFILE,
+                                          BOOT_PROFILE_ARENAS,
+                                          sizeof(boot_profile_arenas),
+                                          (const uint8_t *)boot_profile_arena_table());
+    }
+#endif
+
+    return rc;
+}
+#endif
+
+#endif /* MCUBOOT_BOOT_PROFILE */
@@ -45,6 +45,22 @@ static bool saved_bootinfo = false;
  */
 static bool shared_memory_init_done;
 
+/**
+ * @var shared_memory_types
+ *
+ * @brief One bit per hash of the types of the TLV entries added so far.
+ *
+ * An entry whose bit is clear can not be in the shared memory area yet, so
+ * it is appended without scanning the entries already there.
+ */
+static uint32_t shared_memory_types;
+
+static uint32_t
+shared_memory_type_bit(uint16_t tlv_type)
+{
+    return (uint32_t)1 << (((uint32_t)tlv_type * 0x9e37u) >> 11 & 31u);
+}
+
 /* See in boot_record.h */
 int
 boot_add_data_to_shared_area(uint8_t        major_type,
@@ -56,6 +72,7 @@ boot_add_data_to_shared_area(uint8_t        major_type,
     struct shared_boot_data *boot_data;
     uint16_t boot_data_size;
     uintptr_t tlv_end, offset;
+    uint32_t type_bit;
 
     if (data == NULL) {
         return SHARED_MEMORY_GEN_ERROR;
@@ -70,6 +87,7 @@ boot_add_data_to_shared_area(uint8_t        major_type,
         memset((void *)MCUBOOT_SHARED_DATA_BASE, 0, MCUBOOT_SHARED_DATA_SIZE);
         boot_data->header.tlv_magic   = SHARED_DATA_TLV_INFO_MAGIC;
         boot_data->header.tlv_tot_len = SHARED_DATA_HEADER_SIZE;
+        shared_memory_types = 0;
         shared_memory_init_done = true;
     }
 
@@ -80,9 +98,11 @@ boot_add_data_to_shared_area(uint8_t        major_type,
     offset  = MCUBOOT_SHARED_DATA_BASE + SHARED_DATA_HEADER_SIZE;
 
     /* Iterates over the TLV section looks for the same entry if found then
-     * returns with error: SHARED_MEMORY_OVERWRITE
+     * returns with error: SHARED_MEMORY_OVERWRITE. This is only needed if an
+     * entry of a type hashing to the same bit has already been added.
      */
-    while (offset < tlv_end) {
+    type_bit = shared_memory_type_bit(SET_TLV_TYPE(major_type, minor_type));
+    while ((shared_memory_types & type_bit) && offset < tlv_end) {
         /* Create local copy to avoid unaligned access */
         memcpy(&tlv_entry, (const void *)offset, SHARED_DATA_ENTRY_HEADER_SIZE);
         if (GET_MAJOR(tlv_entry.tlv_type) == major_type &&
@@ -114,6 +134,7 @@ boot_add_data_to_shared_area(uint8_t        major_type,
     memcpy((void *)offset, data, size);
 
     boot_data->header.tlv_tot_len += SHARED_DATA_ENTRY_SIZE(size);
+    shared_memory_types |= type_bit;
 
     return SHARED_MEMORY_OK;
 }
@@ -127,6 +148,16 @@ boot_save_boot_status(uint8_t sw_module,
                       const struct image_header *hdr,
                       const struct flash_area *fap)
 {
+    return boot_save_boot_status_hash(sw_module, hdr, fap, NULL);
+}
+
+/* See in boot_record.h */
+int
+boot_save_boot_status_hash(uint8_t sw_module,
+                           const struct image_header *hdr,
+                           const struct flash_area *fap,
+                           const uint8_t *hash)
+{
 
     struct image_tlv_iter it;
     uint32_t offset;
@@ -144,11 +175,19 @@ boot_save_boot_status(uint8_t sw_module,
      * It is encoded in TLV format.
      */
 
-    rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_ANY, false);
+    /* With the hash already known, only the boot record TLV is looked for. */
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap,
+                                 hash ? IMAGE_TLV_BOOT_RECORD : IMAGE_TLV_ANY,
+                                 false);
     if (rc) {
         return -1;
     }
 
+    if (hash != NULL) {
+        memcpy(image_hash, hash, sizeof(image_hash));
+        hash_found = true;
+    }
+
     /* Traverse through the TLV area to find the boot record
      * and image hash TLVs.
      */
@@ -171,6 +210,9 @@ boot_save_boot_status(uint8_t sw_module,
 
             record_len = len;
             boot_record_found = true;
+            if (hash_found) {
+                break;
+            }
 
         } else if (type == EXPECTED_HASH_TLV) {
             /* Get the image's hash value from the manifest section. */
@@ -249,6 +291,10 @@ int boot_save_shared_data(const struct image_header *hdr, const struct flash_are
     uint8_t mode = MCUBOOT_MODE_UPGRADE_ONLY;
 #elif defined(MCUBOOT_SWAP_USING_MOVE)
     uint8_t mode = MCUBOOT_MODE_SWAP_USING_MOVE;
+#elif defined(MCUBOOT_SWAP_USING_OFFSET)
+    uint8_t mode = MCUBOOT_MODE_SWAP_USING_OFFSET;
+#elif defined(MCUBOOT_SWAP_USING_BANK)
+    uint8_t mode = MCUBOOT_MODE_SWAP_USING_BANK;
 #elif defined(MCUBOOT_DIRECT_XIP)
 #if defined(MCUBOOT_DIRECT_XIP_REVERT)
     uint8_t mode = MCUBOOT_MODE_DIRECT_XIP_WITH_REVERT;
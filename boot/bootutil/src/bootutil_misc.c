@@ -38,15 +38,29 @@
 #include "bootutil_misc.h"
 #include "bootutil/bootutil_log.h"
 #include "bootutil/fault_injection_hardening.h"
+#include "bootutil/mcuboot_status.h"
+#include "bootutil/crypto/sha.h"
 #ifdef MCUBOOT_ENC_IMAGES
 #include "bootutil/enc_key.h"
 #endif
+#ifdef MCUBOOT_HW_ROLLBACK_PROT_CACHE
+#include "bootutil/security_cnt.h"
+#endif
 
 BOOT_LOG_MODULE_DECLARE(mcuboot);
 
 /* Currently only used by imgmgr */
 int boot_current_slot;
 
+#if defined(MCUBOOT_WATCHDOG_FEED_BYTES) && (MCUBOOT_WATCHDOG_FEED_BYTES > 0)
+/* Bytes processed since the watchdog was last fed, see boot_watchdog_feed(). */
+#if !defined(__BOOTSIM__)
+uint32_t boot_watchdog_bytes;
+#else
+__thread uint32_t boot_watchdog_bytes;
+#endif
+#endif
+
 /**
  * @brief Determine if the data at two memory addresses is equal
  *
@@ -55,10 +69,12 @@ int boot_current_slot;
  * @param n     The amount of bytes to compare.
  *
  * @note        This function does not comply with the specification of memcmp,
- *              so should not be considered a drop-in replacement. It has no
- *              constant time execution. The point is to make sure that all the
- *              bytes are compared and detect if loop was abused and some cycles
- *              was skipped due to fault injection.
+ *              so should not be considered a drop-in replacement. The regions
+ *              are compared a word at a time, without exiting early, so the
+ *              execution time does not depend on their contents. They are
+ *              compared twice, forwards then backwards, and both results must
+ *              agree, so that skipping or faulting a single loop cannot make
+ *              different regions compare equal.
  *
  * @return      FIH_SUCCESS if memory regions are equal, otherwise FIH_FAILURE
  */
@@ -71,21 +87,46 @@ fih_ret boot_fih_memequal(const void *s1, const void *s2, size_t n)
 #else
 fih_ret boot_fih_memequal(const void *s1, const void *s2, size_t n)
 {
+    const uint8_t *s1_p = (const uint8_t *)s1;
+    const uint8_t *s2_p = (const uint8_t *)s2;
+    volatile uint32_t diff_fwd;
+    volatile uint32_t diff_rev;
+    uint32_t diff;
+    uint32_t w1;
+    uint32_t w2;
     size_t i;
-    uint8_t *s1_p = (uint8_t*) s1;
-    uint8_t *s2_p = (uint8_t*) s2;
+    size_t j;
     FIH_DECLARE(ret, FIH_FAILURE);
 
-    for (i = 0; i < n; i++) {
-        if (s1_p[i] != s2_p[i]) {
-            goto out;
-        }
+    /* The words are read with memcpy() as the regions need not be aligned;
+     * this compiles to plain loads where the target allows unaligned ones.
+     */
+    diff = 0;
+    for (i = 0; i + sizeof(w1) <= n; i += sizeof(w1)) {
+        memcpy(&w1, &s1_p[i], sizeof(w1));
+        memcpy(&w2, &s2_p[i], sizeof(w2));
+        diff |= w1 ^ w2;
     }
-    if (i == n) {
+    for (; i < n; i++) {
+        diff |= s1_p[i] ^ s2_p[i];
+    }
+    diff_fwd = diff;
+
+    diff = 0;
+    for (j = n; j >= sizeof(w1); j -= sizeof(w1)) {
+        memcpy(&w1, &s1_p[j - sizeof(w1)], sizeof(w1));
+        memcpy(&w2, &s2_p[j - sizeof(w2)], sizeof(w2));
+        diff |= w1 ^ w2;
+    }
+    for (; j > 0; j--) {
+        diff |= s1_p[j - 1] ^ s2_p[j - 1];
+    }
+    diff_rev = diff;
+
+    if (i == n && j == 0 && FIH_EQ(diff_fwd, 0U) && FIH_EQ(diff_rev, 0U)) {
         ret = FIH_SUCCESS;
     }
 
-out:
     FIH_RET(ret);
 }
 #endif
@@ -103,6 +144,8 @@ boot_trailer_info_sz(void)
            /* encryption keys */
 #  if MCUBOOT_SWAP_SAVE_ENCTLV
            BOOT_ENC_TLV_ALIGN_SIZE * 2            +
+#  elif defined(MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY)
+           BOOT_ENC_WRAPPED_KEY_ALIGN_SIZE * 2    +
 #  else
            BOOT_ENC_KEY_ALIGN_SIZE * 2            +
 #  endif
@@ -120,19 +163,36 @@ boot_trailer_info_sz(void)
 static inline uint32_t
 boot_status_entry_sz(uint32_t min_write_sz)
 {
+#ifdef MCUBOOT_SWAP_STATUS_PACKED
+    return ALIGN_UP(BOOT_STATUS_STATE_COUNT, min_write_sz);
+#else
     return BOOT_STATUS_STATE_COUNT * min_write_sz;
+#endif
 }
 
 uint32_t
 boot_status_sz(uint32_t min_write_sz)
 {
+#ifdef MCUBOOT_SWAP_STATUS_PACKED
+    return ALIGN_UP(BOOT_STATUS_MAX_ENTRIES * BOOT_STATUS_STATE_COUNT,
+                    min_write_sz);
+#else
     return BOOT_STATUS_MAX_ENTRIES * boot_status_entry_sz(min_write_sz);
+#endif
 }
 
 uint32_t
 boot_trailer_sz(uint32_t min_write_sz)
 {
+#if defined(MCUBOOT_SWAP_STATUS_PARTITION) || defined(MCUBOOT_SWAP_USING_BANK)
+    /* The status log is kept in the swap status partition, or there is none
+     * when the banks are swapped by the flash controller.
+     */
+    (void)min_write_sz;
+    return boot_trailer_info_sz();
+#else
     return boot_status_sz(min_write_sz) + boot_trailer_info_sz();
+#endif
 }
 
 #if MCUBOOT_SWAP_USING_SCRATCH
@@ -192,6 +252,9 @@ boot_enc_key_off(const struct flash_area *fap, uint8_t slot)
 {
 #if MCUBOOT_SWAP_SAVE_ENCTLV
     return boot_swap_size_off(fap) - ((slot + 1) * BOOT_ENC_TLV_ALIGN_SIZE);
+#elif defined(MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY)
+    return boot_swap_size_off(fap) -
+           ((slot + 1) * BOOT_ENC_WRAPPED_KEY_ALIGN_SIZE);
 #else
     return boot_swap_size_off(fap) - ((slot + 1) * BOOT_ENC_KEY_ALIGN_SIZE);
 #endif
@@ -269,6 +332,9 @@ boot_read_enc_key(const struct flash_area *fap, uint8_t slot, struct boot_status
     uint32_t off;
 #if MCUBOOT_SWAP_SAVE_ENCTLV
     uint32_t i;
+#elif defined(MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY)
+    uint8_t wrapped[BOOT_ENC_WRAPPED_KEY_ALIGN_SIZE];
+    uint32_t i;
 #endif
     int rc;
 
@@ -286,6 +352,21 @@ boot_read_enc_key(const struct flash_area *fap, uint8_t slot, struct boot_status
             rc = boot_decrypt_key(bs->enctlv[slot], bs->enckey[slot]);
         }
     }
+#elif defined(MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY)
+    rc = flash_area_read(fap, off, wrapped, BOOT_ENC_WRAPPED_KEY_ALIGN_SIZE);
+    if (rc == 0) {
+        for (i = 0; i < BOOT_ENC_WRAPPED_KEY_SIZE; i++) {
+            if (wrapped[i] != 0xff) {
+                break;
+            }
+        }
+        /* An erased key stays erased, so that no key is set for the slot */
+        if (i != BOOT_ENC_WRAPPED_KEY_SIZE) {
+            rc = boot_enc_unwrap_key(wrapped, bs->enckey[slot]);
+        } else {
+            memset(bs->enckey[slot], 0xff, BOOT_ENC_KEY_ALIGN_SIZE);
+        }
+    }
 #else
     rc = flash_area_read(fap, off, bs->enckey[slot], BOOT_ENC_KEY_ALIGN_SIZE);
 #endif
@@ -312,6 +393,9 @@ boot_write_enc_key(const struct flash_area *fap, uint8_t slot,
         const struct boot_status *bs)
 {
     uint32_t off;
+#ifdef MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY
+    uint8_t wrapped[BOOT_ENC_WRAPPED_KEY_ALIGN_SIZE];
+#endif
     int rc;
 
     off = boot_enc_key_off(fap, slot);
@@ -320,6 +404,12 @@ boot_write_enc_key(const struct flash_area *fap, uint8_t slot,
                  (unsigned long)flash_area_get_off(fap) + off);
 #if MCUBOOT_SWAP_SAVE_ENCTLV
     rc = flash_area_write(fap, off, bs->enctlv[slot], BOOT_ENC_TLV_ALIGN_SIZE);
+#elif defined(MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY)
+    memset(wrapped, 0xff, sizeof(wrapped));
+    rc = boot_enc_wrap_key(bs->enckey[slot], wrapped);
+    if (rc == 0) {
+        rc = flash_area_write(fap, off, wrapped, sizeof(wrapped));
+    }
 #else
     rc = flash_area_write(fap, off, bs->enckey[slot], BOOT_ENC_KEY_ALIGN_SIZE);
 #endif
@@ -331,12 +421,102 @@ boot_write_enc_key(const struct flash_area *fap, uint8_t slot,
 }
 #endif
 
+/* Size of the encryption keys written along with the other fields by
+ * boot_write_swap_fields(). Encryption TLVs are written on their own, as
+ * they are too large to be put on the stack.
+ */
+#if defined(MCUBOOT_ENC_IMAGES) && defined(MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY)
+#define BOOT_SWAP_FIELDS_KEYS_SZ (BOOT_NUM_SLOTS * BOOT_ENC_WRAPPED_KEY_ALIGN_SIZE)
+#elif defined(MCUBOOT_ENC_IMAGES) && !MCUBOOT_SWAP_SAVE_ENCTLV
+#define BOOT_SWAP_FIELDS_KEYS_SZ (BOOT_NUM_SLOTS * BOOT_ENC_KEY_ALIGN_SIZE)
+#else
+#define BOOT_SWAP_FIELDS_KEYS_SZ 0
+#endif
+
+/**
+ * Writes the fields of a trailer being initialized that come before its
+ * copy_done flag: the encryption keys, the swap_size and, unless swap_type is
+ * BOOT_SWAP_TYPE_NONE, the swap_info. As these fields are next to each other,
+ * they are assembled in RAM and written with a single program instead of one
+ * per field.
+ *
+ * @returns 0 on success, != 0 on error.
+ */
+int
+boot_write_swap_fields(const struct flash_area *fap, uint8_t swap_type,
+                       uint8_t image_num, const struct boot_status *bs)
+{
+    uint8_t buf[BOOT_SWAP_FIELDS_KEYS_SZ + 2 * BOOT_MAX_ALIGN];
+    uint32_t off;
+    uint32_t len;
+    uint8_t swap_info;
+#if BOOT_SWAP_FIELDS_KEYS_SZ > 0
+    uint8_t slot;
+#endif
+    int rc;
+
+#if defined(MCUBOOT_ENC_IMAGES) && BOOT_SWAP_FIELDS_KEYS_SZ == 0
+    rc = boot_write_enc_key(fap, 0, bs);
+    if (rc == 0) {
+        rc = boot_write_enc_key(fap, 1, bs);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+#endif
+
+    off = boot_swap_size_off(fap) - BOOT_SWAP_FIELDS_KEYS_SZ;
+    len = BOOT_SWAP_FIELDS_KEYS_SZ + BOOT_MAX_ALIGN;
+    if (swap_type != BOOT_SWAP_TYPE_NONE) {
+        len += BOOT_MAX_ALIGN;
+    }
+
+    memset(buf, flash_area_erased_val(fap), sizeof(buf));
+
+#if BOOT_SWAP_FIELDS_KEYS_SZ > 0
+    for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
+#ifdef MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY
+        uint8_t *wrapped = &buf[boot_enc_key_off(fap, slot) - off];
+
+        memset(wrapped, 0xff, BOOT_ENC_WRAPPED_KEY_ALIGN_SIZE);
+        rc = boot_enc_wrap_key(bs->enckey[slot], wrapped);
+        if (rc != 0) {
+            return BOOT_EFLASH;
+        }
+#else
+        memcpy(&buf[boot_enc_key_off(fap, slot) - off], bs->enckey[slot],
+               BOOT_ENC_KEY_ALIGN_SIZE);
+#endif
+    }
+#endif
+
+    memcpy(&buf[boot_swap_size_off(fap) - off], &bs->swap_size,
+           sizeof(bs->swap_size));
+
+    if (swap_type != BOOT_SWAP_TYPE_NONE) {
+        BOOT_SET_SWAP_INFO(swap_info, image_num, swap_type);
+        buf[boot_swap_info_off(fap) - off] = swap_info;
+    }
+
+    BOOT_LOG_DBG("writing swap fields; fa_id=%d off=0x%lx (0x%lx) len=%lu",
+                 flash_area_get_id(fap), (unsigned long)off,
+                 (unsigned long)flash_area_get_off(fap) + off,
+                 (unsigned long)len);
+    rc = flash_area_write(fap, off, buf, len);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    return 0;
+}
+
 uint32_t bootutil_max_image_size(const struct flash_area *fap)
 {
 #if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SINGLE_APPLICATION_SLOT) || \
     defined(MCUBOOT_FIRMWARE_LOADER) || defined(MCUBOOT_SINGLE_APPLICATION_SLOT_RAM_LOAD)
     return boot_status_off(fap);
-#elif defined(MCUBOOT_SWAP_USING_MOVE)
+#elif defined(MCUBOOT_SWAP_USING_MOVE) || defined(MCUBOOT_SWAP_USING_OFFSET) || \
+      defined(MCUBOOT_SWAP_USING_BANK)
     struct flash_sector sector;
     /* get the last sector offset */
     int rc = flash_area_get_sector(fap, boot_status_off(fap), &sector);
@@ -360,33 +540,22 @@ uint32_t bootutil_max_image_size(const struct flash_area *fap)
  * Compute the total size of the given image.  Includes the size of
  * the TLVs.
  */
-#if !defined(MCUBOOT_DIRECT_XIP) && \
-    (!defined(MCUBOOT_OVERWRITE_ONLY) || \
-    defined(MCUBOOT_OVERWRITE_ONLY_FAST))
+#if !defined(MCUBOOT_DIRECT_XIP)
 int
 boot_read_image_size(struct boot_loader_state *state, int slot, uint32_t *size)
 {
     const struct flash_area *fap;
     struct image_tlv_info info;
     uint32_t off;
+    uint32_t start_off;
     uint32_t protect_tlv_size;
-    int area_id;
     int rc;
 
-#if (BOOT_IMAGE_NUMBER == 1)
-    (void)state;
-#endif
-
-    area_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), slot);
-    rc = flash_area_open(area_id, &fap);
-    if (rc != 0) {
-        rc = BOOT_EFLASH;
-        goto done;
-    }
-
+    fap = BOOT_IMG_AREA(state, slot);
+    start_off = BOOT_IMG_START_OFF(fap);
     off = BOOT_TLV_OFF(boot_img_hdr(state, slot));
 
-    if (flash_area_read(fap, off, &info, sizeof(info))) {
+    if (flash_area_read(fap, start_off + off, &info, sizeof(info))) {
         rc = BOOT_EFLASH;
         goto done;
     }
@@ -398,7 +567,8 @@ boot_read_image_size(struct boot_loader_state *state, int slot, uint32_t *size)
             goto done;
         }
 
-        if (flash_area_read(fap, off + info.it_tlv_tot, &info, sizeof(info))) {
+        if (flash_area_read(fap, start_off + off + info.it_tlv_tot,
+                            &info, sizeof(info))) {
             rc = BOOT_EFLASH;
             goto done;
         }
@@ -416,7 +586,330 @@ boot_read_image_size(struct boot_loader_state *state, int slot, uint32_t *size)
     rc = 0;
 
 done:
-    flash_area_close(fap);
     return rc;
 }
-#endif /* !MCUBOOT_OVERWRITE_ONLY */
+#endif /* !MCUBOOT_DIRECT_XIP */
+
+#ifdef MCUBOOT_UPGRADE_PROGRESS
+static struct mcuboot_progress boot_progress;
+static uint32_t boot_progress_steps;
+#ifdef MCUBOOT_UPTIME_MS
+static uint32_t boot_progress_start_ms;
+#endif
+
+void
+boot_progress_start(const struct boot_loader_state *state, uint32_t total,
+                    uint32_t done)
+{
+    memset(&boot_progress, 0, sizeof(boot_progress));
+    boot_progress.image = BOOT_CURR_IMG(state);
+    boot_progress.total = total;
+    boot_progress.done = (done < total) ? done : total;
+    boot_progress_steps = 0;
+#ifdef MCUBOOT_UPTIME_MS
+    boot_progress_start_ms = MCUBOOT_UPTIME_MS();
+#endif
+
+    mcuboot_status_progress(&boot_progress);
+}
+
+void
+boot_progress_step(uint32_t bytes)
+{
+#ifdef MCUBOOT_UPTIME_MS
+    uint32_t elapsed;
+#endif
+
+    if (boot_progress.done < boot_progress.total) {
+        boot_progress.done++;
+    }
+    boot_progress.bytes += bytes;
+    boot_progress_steps++;
+
+#ifdef MCUBOOT_UPTIME_MS
+    /* The estimates only use the steps done since the last reset. */
+    elapsed = MCUBOOT_UPTIME_MS() - boot_progress_start_ms;
+    if (elapsed > 0) {
+        boot_progress.bytes_per_sec =
+            (uint32_t)(((uint64_t)boot_progress.bytes * 1000) / elapsed);
+        boot_progress.eta_ms =
+            (uint32_t)(((uint64_t)elapsed *
+                        (boot_progress.total - boot_progress.done)) /
+                       boot_progress_steps);
+    }
+#endif
+
+    mcuboot_status_progress(&boot_progress);
+}
+#endif /* MCUBOOT_UPGRADE_PROGRESS */
+
+#if defined(MCUBOOT_VALIDATION_CACHE) || defined(MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE) || \
+    defined(MCUBOOT_IMAGE_VERDICT_HOOKS)
+int
+boot_image_digests(const struct image_header *hdr,
+                   const struct flash_area *fap, uint8_t *hdr_digest,
+                   uint8_t *img_hash)
+{
+    bootutil_sha_context sha_ctx;
+    struct image_tlv_iter it;
+    uint32_t off;
+    uint16_t len;
+    int rc;
+
+    bootutil_sha_init(&sha_ctx);
+    bootutil_sha_update(&sha_ctx, hdr, sizeof(*hdr));
+    bootutil_sha_finish(&sha_ctx, hdr_digest);
+    bootutil_sha_drop(&sha_ctx);
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, EXPECTED_HASH_TLV, false);
+    if (rc != 0) {
+        return rc;
+    }
+
+    rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+    if (rc != 0 || len != IMAGE_HASH_SIZE) {
+        return -1;
+    }
+
+    return flash_area_read(fap, off, img_hash, len);
+}
+#endif
+
+#if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE)
+/* Buffers too large for the stack of targets, stack allocated by the
+ * simulator which runs boots from several threads at once.
+ */
+#if !defined(__BOOTSIM__)
+#define TARGET_STATIC static
+#else
+#define TARGET_STATIC
+#endif
+
+/* The record is written padded to the write alignment of the slot. */
+#define BOOT_VALIDATED_RECORD_BUF_SZ \
+    ALIGN_UP(sizeof(struct boot_validated_record), BOOT_MAX_ALIGN)
+
+fih_ret
+boot_image_validate_once(const struct flash_area *fap,
+                         struct image_header *hdr)
+{
+    TARGET_STATIC uint8_t tmpbuf[BOOT_TMPBUF_SZ];
+    TARGET_STATIC struct boot_swap_state state;
+    struct boot_validated_record cur;
+    uint8_t buf[BOOT_VALIDATED_RECORD_BUF_SZ];
+    uint32_t align;
+    uint32_t off;
+    uint32_t len;
+    bool can_store;
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    memset(&state, 0, sizeof(struct boot_swap_state));
+    rc = boot_read_swap_state(fap, &state);
+    if (rc != 0) {
+        FIH_RET(FIH_FAILURE);
+    }
+
+    /* An image without a hash TLV would not pass the validation anyway. */
+    memset(&cur, 0, sizeof(cur));
+    cur.magic = BOOT_VALIDATED_RECORD_MAGIC;
+    rc = boot_image_digests(hdr, fap, cur.hdr_digest, cur.img_hash);
+    if (rc != 0) {
+        FIH_RET(FIH_FAILURE);
+    }
+
+    align = flash_area_align(fap);
+    len = ALIGN_UP(sizeof(cur), align);
+    off = boot_status_off(fap);
+    can_store = len <= sizeof(buf) && len <= boot_status_sz(align);
+    if (can_store) {
+        rc = flash_area_read(fap, off, buf, len);
+        if (rc != 0) {
+            FIH_RET(FIH_FAILURE);
+        }
+
+        if (state.magic == BOOT_MAGIC_GOOD &&
+            state.image_ok == BOOT_FLAG_SET) {
+            FIH_CALL(boot_fih_memequal, fih_rc, buf, &cur, sizeof(cur));
+            if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+                FIH_RET(fih_rc);
+            }
+        }
+
+        /* A stale record is never overwritten, that would corrupt it. */
+        can_store = bootutil_buffer_is_erased(fap, buf, len);
+    }
+
+    if (IS_ENCRYPTED(hdr)) {
+        /* Clear the encrypted flag, no key is supplied. The flag could be
+         * left set if the image was decrypted in place; if it is still
+         * encrypted, the validation fails.
+         */
+        hdr->ih_flags &= ~(ENCRYPTIONFLAGS);
+    }
+
+    /* The enc_state pointer may only be NULL because the encrypted flags
+     * are cleared above.
+     */
+    FIH_CALL(bootutil_img_validate, fih_rc, NULL, 0, hdr, fap, tmpbuf,
+             BOOT_TMPBUF_SZ, NULL, 0, NULL);
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        FIH_RET(FIH_FAILURE);
+    }
+
+    if (can_store) {
+        memcpy(buf, &cur, sizeof(cur));
+        memset(&buf[sizeof(cur)], flash_area_erased_val(fap),
+               len - sizeof(cur));
+        can_store = flash_area_write(fap, off, buf, len) == 0;
+    }
+    if (!can_store) {
+        BOOT_LOG_WRN("Unable to store the validated record, the image will "
+                     "be validated again on the next boot");
+    }
+
+    if (state.magic != BOOT_MAGIC_GOOD) {
+        rc = boot_write_magic(fap);
+        if (rc != 0) {
+            FIH_RET(FIH_FAILURE);
+        }
+    }
+    if (state.image_ok != BOOT_FLAG_SET) {
+        rc = boot_write_image_ok(fap);
+        if (rc != 0) {
+            FIH_RET(FIH_FAILURE);
+        }
+    }
+
+    FIH_RET(FIH_SUCCESS);
+}
+#endif /* MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE */
+
+#ifdef MCUBOOT_HW_ROLLBACK_PROT_CACHE
+#ifndef MCUBOOT_HW_ROLLBACK_PROT
+#error "MCUBOOT_HW_ROLLBACK_PROT_CACHE requires MCUBOOT_HW_ROLLBACK_PROT"
+#endif
+
+/*
+ * Security counter of each image: the stored value once it has been read,
+ * and the value it is to be updated to, if any.
+ */
+struct boot_security_counter {
+    bool loaded;
+    bool pending;
+    fih_int stored;
+    uint32_t update;
+};
+
+#if !defined(__BOOTSIM__)
+static struct boot_security_counter boot_security_counters[BOOT_IMAGE_NUMBER];
+#else
+static __thread struct boot_security_counter boot_security_counters[BOOT_IMAGE_NUMBER];
+#endif
+
+void
+boot_security_counter_reset(void)
+{
+    memset(boot_security_counters, 0, sizeof(boot_security_counters));
+}
+
+fih_ret
+boot_security_counter_get(uint32_t image_id, fih_int *security_cnt)
+{
+    struct boot_security_counter *cnt;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    if (image_id >= BOOT_IMAGE_NUMBER) {
+        FIH_RET(FIH_FAILURE);
+    }
+
+    cnt = &boot_security_counters[image_id];
+    if (!cnt->loaded) {
+        FIH_CALL(boot_nv_security_counter_get, fih_rc, image_id, &cnt->stored);
+        if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+            FIH_RET(FIH_FAILURE);
+        }
+        cnt->loaded = true;
+    }
+
+    /* A pending update is seen as if it had already been written. */
+    if (cnt->pending && cnt->update > (uint32_t)fih_int_decode(cnt->stored)) {
+        *security_cnt = fih_int_encode(cnt->update);
+    } else {
+        *security_cnt = cnt->stored;
+    }
+
+    FIH_RET(FIH_SUCCESS);
+}
+
+int32_t
+boot_security_counter_update(uint32_t image_id, uint32_t img_security_cnt)
+{
+    struct boot_security_counter *cnt;
+
+    if (image_id >= BOOT_IMAGE_NUMBER) {
+        return -1;
+    }
+
+    cnt = &boot_security_counters[image_id];
+    if (!cnt->pending || img_security_cnt > cnt->update) {
+        cnt->update = img_security_cnt;
+    }
+    cnt->pending = true;
+
+    return 0;
+}
+
+int32_t
+boot_security_counter_commit(void)
+{
+    struct boot_security_counter *cnt;
+    uint32_t image_id;
+    int32_t rc;
+#ifdef MCUBOOT_HW_ROLLBACK_PROT_BATCH
+    uint32_t values[BOOT_IMAGE_NUMBER];
+    bool update[BOOT_IMAGE_NUMBER];
+#endif
+
+    /* Counters already holding the value they are updated to are left
+     * alone, which spares an OTP or secure element write on most boots.
+     */
+    for (image_id = 0; image_id < BOOT_IMAGE_NUMBER; image_id++) {
+        cnt = &boot_security_counters[image_id];
+        if (cnt->pending && cnt->loaded &&
+            cnt->update <= (uint32_t)fih_int_decode(cnt->stored)) {
+            cnt->pending = false;
+        }
+    }
+
+#ifdef MCUBOOT_HW_ROLLBACK_PROT_BATCH
+    for (image_id = 0; image_id < BOOT_IMAGE_NUMBER; image_id++) {
+        values[image_id] = boot_security_counters[image_id].update;
+        update[image_id] = boot_security_counters[image_id].pending;
+    }
+    rc = boot_nv_security_counter_update_batch(values, update,
+                                               BOOT_IMAGE_NUMBER);
+    if (rc != 0) {
+        return rc;
+    }
+#endif
+
+    for (image_id = 0; image_id < BOOT_IMAGE_NUMBER; image_id++) {
+        cnt = &boot_security_counters[image_id];
+        if (!cnt->pending) {
+            continue;
+        }
+#ifndef MCUBOOT_HW_ROLLBACK_PROT_BATCH
+        rc = boot_nv_security_counter_update(image_id, cnt->update);
+        if (rc != 0) {
+            return rc;
+        }
+#endif
+        cnt->stored = fih_int_encode(cnt->update);
+        cnt->loaded = true;
+        cnt->pending = false;
+    }
+
+    return 0;
+}
+#endif /* MCUBOOT_HW_ROLLBACK_PROT_CACHE */
@@ -38,11 +38,32 @@
 #include "bootutil/image.h"
 #include "bootutil/fault_injection_hardening.h"
 #include "mcuboot_config/mcuboot_config.h"
+#include "bootutil/bench.h"
 
 #ifdef MCUBOOT_ENC_IMAGES
 #include "bootutil/enc_key.h"
 #endif
 
+#if defined(MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY) || \
+    defined(MCUBOOT_BOOTSTRAP_VERIFY_COPY) || defined(MCUBOOT_IMAGE_SOURCE) || \
+    defined(MCUBOOT_RAM_LOAD_HASH_COPY) || defined(MCUBOOT_RAM_LOAD_SEGMENTS) || \
+    defined(MCUBOOT_PARALLEL_VALIDATION) || \
+    defined(MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE) || \
+    defined(MCUBOOT_MEASURED_BOOT) || defined(MCUBOOT_RAM_LOAD_RESIDENT)
+#include "bootutil/crypto/sha.h"
+#endif
+
+#ifdef MCUBOOT_VALIDATION_CACHE_UPGRADE
+#include "bootutil/validation_cache.h"
+#endif
+
+#ifdef MCUBOOT_BOOT_STEP
+#include "bootutil/boot_step.h"
+#define BOOT_STEP_POINT(kind) boot_step_point(kind)
+#else
+#define BOOT_STEP_POINT(kind) do { } while (0)
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -51,6 +72,26 @@ struct flash_area;
 
 #define BOOT_TMPBUF_SZ  256
 
+/*
+ * Storage class of data cached for the whole boot, such as key material.
+ * The simulator runs boots from several threads at once, so each of them
+ * gets its own copy.
+ */
+#if !defined(__BOOTSIM__)
+#define BOOT_CACHE_STATIC static
+#else
+#define BOOT_CACHE_STATIC static __thread
+#endif
+
+#if defined(MCUBOOT_KEY_CONTEXT_CACHE)
+#if defined(MCUBOOT_HW_KEY) || defined(MCUBOOT_BUILTIN_KEY)
+#error "MCUBOOT_KEY_CONTEXT_CACHE requires keys built into the bootloader"
+#endif
+#ifndef MCUBOOT_KEY_CONTEXT_CACHE_SIZE
+#define MCUBOOT_KEY_CONTEXT_CACHE_SIZE 2
+#endif
+#endif
+
 #define NO_ACTIVE_SLOT UINT32_MAX
 
 /** Number of image slots in flash; currently limited to two. */
@@ -58,11 +99,152 @@ struct flash_area;
 
 #if (defined(MCUBOOT_OVERWRITE_ONLY) + \
      defined(MCUBOOT_SWAP_USING_MOVE) + \
+     defined(MCUBOOT_SWAP_USING_OFFSET) + \
+     defined(MCUBOOT_SWAP_USING_BANK) + \
      defined(MCUBOOT_DIRECT_XIP) + \
      defined(MCUBOOT_RAM_LOAD) + \
      defined(MCUBOOT_FIRMWARE_LOADER) + \
      defined(MCUBOOT_SWAP_USING_SCRATCH)) > 1
-#error "Please enable only one of MCUBOOT_OVERWRITE_ONLY, MCUBOOT_SWAP_USING_MOVE, MCUBOOT_DIRECT_XIP, MCUBOOT_RAM_LOAD or MCUBOOT_FIRMWARE_LOADER"
+#error "Please enable only one of MCUBOOT_OVERWRITE_ONLY, MCUBOOT_SWAP_USING_MOVE, MCUBOOT_SWAP_USING_OFFSET, MCUBOOT_SWAP_USING_BANK, MCUBOOT_DIRECT_XIP, MCUBOOT_RAM_LOAD or MCUBOOT_FIRMWARE_LOADER"
+#endif
+
+#if defined(MCUBOOT_RAM_LOAD_HASH_COPY) && !defined(MCUBOOT_RAM_LOAD)
+#error "MCUBOOT_RAM_LOAD_HASH_COPY requires MCUBOOT_RAM_LOAD"
+#endif
+
+#ifdef MCUBOOT_RAM_LOAD_PARALLEL
+#if !defined(MCUBOOT_RAM_LOAD_HASH_COPY) || !defined(MCUBOOT_FLASH_AREA_READ_ASYNC)
+#error "MCUBOOT_RAM_LOAD_PARALLEL requires MCUBOOT_RAM_LOAD_HASH_COPY and MCUBOOT_FLASH_AREA_READ_ASYNC"
+#endif
+#if defined(MCUBOOT_RAM_LOAD_SEGMENTS) || (BOOT_IMAGE_NUMBER < 2)
+#error "MCUBOOT_RAM_LOAD_PARALLEL requires more than one image and cannot be used with MCUBOOT_RAM_LOAD_SEGMENTS"
+#endif
+#endif
+
+#ifdef MCUBOOT_RAM_LOAD_RESIDENT
+#ifndef MCUBOOT_RAM_LOAD
+#error "MCUBOOT_RAM_LOAD_RESIDENT requires MCUBOOT_RAM_LOAD"
+#endif
+#ifdef MCUBOOT_RAM_LOAD_PARALLEL
+#error "MCUBOOT_RAM_LOAD_RESIDENT cannot be used with MCUBOOT_RAM_LOAD_PARALLEL"
+#endif
+#endif
+
+#if defined(MCUBOOT_BOOT_INDEX) && \
+    !defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)
+#error "MCUBOOT_BOOT_INDEX requires MCUBOOT_DIRECT_XIP or MCUBOOT_RAM_LOAD"
+#endif
+
+#if defined(MCUBOOT_RAM_LOAD_SEGMENTS) && !defined(MCUBOOT_RAM_LOAD)
+#error "MCUBOOT_RAM_LOAD_SEGMENTS requires MCUBOOT_RAM_LOAD"
+#endif
+
+#ifdef MCUBOOT_VALIDATION_CACHE_UPGRADE
+#ifndef MCUBOOT_VALIDATION_CACHE
+#error "MCUBOOT_VALIDATION_CACHE_UPGRADE requires MCUBOOT_VALIDATION_CACHE"
+#endif
+#ifdef MCUBOOT_DIRECT_XIP
+#error "MCUBOOT_VALIDATION_CACHE_UPGRADE is not supported with MCUBOOT_DIRECT_XIP"
+#endif
+#endif
+
+#if defined(MCUBOOT_SWAP_PERM_DISCARD) && \
+    !defined(MCUBOOT_SWAP_USING_SCRATCH) && !defined(MCUBOOT_SWAP_USING_MOVE)
+#error "MCUBOOT_SWAP_PERM_DISCARD requires MCUBOOT_SWAP_USING_SCRATCH or MCUBOOT_SWAP_USING_MOVE"
+#endif
+
+#ifdef MCUBOOT_LAZY_SECTORS
+#if defined(MCUBOOT_DIRECT_XIP) || defined(MCUBOOT_RAM_LOAD)
+#error "MCUBOOT_LAZY_SECTORS requires an upgrade mode using a secondary slot"
+#endif
+#ifdef MCUBOOT_DATA_SHARING
+#error "MCUBOOT_LAZY_SECTORS is not supported with MCUBOOT_DATA_SHARING"
+#endif
+#ifdef MCUBOOT_BOOTSTRAP
+#error "MCUBOOT_LAZY_SECTORS is not supported with MCUBOOT_BOOTSTRAP"
+#endif
+#endif
+
+#ifdef MCUBOOT_BOOTSTRAP_VERIFY_COPY
+#if !defined(MCUBOOT_BOOTSTRAP) || defined(MCUBOOT_OVERWRITE_ONLY)
+#error "MCUBOOT_BOOTSTRAP_VERIFY_COPY requires MCUBOOT_BOOTSTRAP with a swap upgrade mode"
+#endif
+#ifndef MCUBOOT_VALIDATE_PRIMARY_SLOT
+#error "MCUBOOT_BOOTSTRAP_VERIFY_COPY requires MCUBOOT_VALIDATE_PRIMARY_SLOT"
+#endif
+#endif
+
+#ifdef MCUBOOT_IMAGE_SOURCE
+#ifndef MCUBOOT_OVERWRITE_ONLY
+#error "MCUBOOT_IMAGE_SOURCE requires MCUBOOT_OVERWRITE_ONLY"
+#endif
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME) || \
+    defined(MCUBOOT_OVERWRITE_ONLY_TOMBSTONE) || \
+    defined(MCUBOOT_OVERWRITE_ONLY_KEEP_BACKUP) || \
+    defined(MCUBOOT_BOOTSTRAP) || defined(MCUBOOT_DELTA_IMAGES)
+#error "MCUBOOT_IMAGE_SOURCE can not be used with features writing to the secondary slot"
+#endif
+#endif
+
+#if defined(MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY) || \
+    defined(MCUBOOT_BOOTSTRAP_VERIFY_COPY) || defined(MCUBOOT_IMAGE_SOURCE)
+/* Images are hashed while they are copied to the primary slot. */
+#define BOOT_VERIFY_COPY
+#endif
+
+#if defined(MCUBOOT_OVERWRITE_ONLY_TOMBSTONE) && !defined(MCUBOOT_OVERWRITE_ONLY)
+#error "MCUBOOT_OVERWRITE_ONLY_TOMBSTONE requires MCUBOOT_OVERWRITE_ONLY"
+#endif
+
+#ifdef MCUBOOT_PENDING_DIGEST
+#if defined(MCUBOOT_DIRECT_XIP) || defined(MCUBOOT_RAM_LOAD) || \
+    defined(MCUBOOT_SINGLE_APPLICATION_SLOT)
+#error "MCUBOOT_PENDING_DIGEST requires an upgrade mode using a secondary slot"
+#endif
+#ifdef MCUBOOT_SWAP_USING_OFFSET
+#error "MCUBOOT_PENDING_DIGEST is not supported with MCUBOOT_SWAP_USING_OFFSET"
+#endif
+#ifdef MCUBOOT_OVERWRITE_ONLY_RESUME
+#error "MCUBOOT_PENDING_DIGEST is not supported with MCUBOOT_OVERWRITE_ONLY_RESUME"
+#endif
+#endif
+
+#if defined(MCUBOOT_SWAP_SKIP_UNCHANGED) && \
+    !defined(MCUBOOT_SWAP_USING_MOVE) && !defined(MCUBOOT_SWAP_USING_SCRATCH)
+#error "MCUBOOT_SWAP_SKIP_UNCHANGED requires MCUBOOT_SWAP_USING_MOVE or MCUBOOT_SWAP_USING_SCRATCH"
+#endif
+
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+#if defined(MCUBOOT_RAM_LOAD)
+#error "MCUBOOT_PARALLEL_VALIDATION is not supported with MCUBOOT_RAM_LOAD"
+#endif
+#if !defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_VALIDATE_PRIMARY_SLOT)
+#error "MCUBOOT_PARALLEL_VALIDATION requires MCUBOOT_DIRECT_XIP or MCUBOOT_VALIDATE_PRIMARY_SLOT"
+#endif
+#if BOOT_IMAGE_NUMBER < 2
+#error "MCUBOOT_PARALLEL_VALIDATION requires more than one image"
+#endif
+#if defined(MCUBOOT_HASH_PIPELINE)
+#error "MCUBOOT_PARALLEL_VALIDATION cannot be used with MCUBOOT_HASH_PIPELINE"
+#endif
+#endif
+
+#ifdef MCUBOOT_LAZY_VALIDATION
+#if defined(MCUBOOT_DIRECT_XIP) || defined(MCUBOOT_RAM_LOAD) || \
+    defined(MCUBOOT_FIRMWARE_LOADER)
+#error "MCUBOOT_LAZY_VALIDATION requires an upgrade mode using a secondary slot"
+#endif
+#if !defined(MCUBOOT_VALIDATE_PRIMARY_SLOT)
+#error "MCUBOOT_LAZY_VALIDATION requires MCUBOOT_VALIDATE_PRIMARY_SLOT"
+#endif
+#if BOOT_IMAGE_NUMBER < 2
+#error "MCUBOOT_LAZY_VALIDATION requires more than one image"
+#endif
+#endif
+
+#if defined(MCUBOOT_RAM_LOAD_SEGMENTS) && \
+    !defined(MCUBOOT_RAM_LOAD_MAX_SEGMENTS)
+#define MCUBOOT_RAM_LOAD_MAX_SEGMENTS 4
 #endif
 
 #if !defined(MCUBOOT_DIRECT_XIP) && \
@@ -70,8 +252,30 @@ struct flash_area;
 #error "MCUBOOT_DIRECT_XIP_REVERT cannot be enabled unless MCUBOOT_DIRECT_XIP is used"
 #endif
 
+#if defined(MCUBOOT_DIRECT_XIP_REVERT_FAST) && \
+    !defined(MCUBOOT_DIRECT_XIP_REVERT)
+#error "MCUBOOT_DIRECT_XIP_REVERT_FAST requires MCUBOOT_DIRECT_XIP_REVERT"
+#endif
+
+#if defined(MCUBOOT_ENC_GCM) && !defined(MCUBOOT_ENC_IMAGES)
+#error "MCUBOOT_ENC_GCM requires MCUBOOT_ENC_IMAGES"
+#endif
+
+#if defined(MCUBOOT_ENC_XIP) && \
+    (!defined(MCUBOOT_ENC_IMAGES) || !defined(MCUBOOT_DIRECT_XIP) || \
+     defined(MCUBOOT_ENC_GCM))
+#error "MCUBOOT_ENC_XIP requires MCUBOOT_ENC_IMAGES and MCUBOOT_DIRECT_XIP, and cannot be used with MCUBOOT_ENC_GCM"
+#endif
+
+#if defined(MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY) && \
+    (!defined(MCUBOOT_ENC_IMAGES) || MCUBOOT_SWAP_SAVE_ENCTLV)
+#error "MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY requires MCUBOOT_ENC_IMAGES and cannot be used with MCUBOOT_SWAP_SAVE_ENCTLV"
+#endif
+
 #if !defined(MCUBOOT_OVERWRITE_ONLY) && \
     !defined(MCUBOOT_SWAP_USING_MOVE) && \
+    !defined(MCUBOOT_SWAP_USING_OFFSET) && \
+    !defined(MCUBOOT_SWAP_USING_BANK) && \
     !defined(MCUBOOT_DIRECT_XIP) && \
     !defined(MCUBOOT_RAM_LOAD) && \
     !defined(MCUBOOT_SINGLE_APPLICATION_SLOT) && \
@@ -79,6 +283,25 @@ struct flash_area;
 #define MCUBOOT_SWAP_USING_SCRATCH 1
 #endif
 
+#if defined(MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE) && (MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE > 0) && \
+    !defined(MCUBOOT_SWAP_USING_SCRATCH)
+#error "MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE requires the swap using scratch upgrade mode"
+#endif
+
+#if defined(MCUBOOT_SWAP_STATUS_MAX_ENTRIES) && !defined(MCUBOOT_SWAP_USING_SCRATCH)
+#error "MCUBOOT_SWAP_STATUS_MAX_ENTRIES requires the swap using scratch upgrade mode"
+#endif
+
+/*
+ * With MCUBOOT_SWAP_STATUS_PARTITION, the space right in front of the trailer
+ * of the slots is no longer reserved, so nothing else can be stored there.
+ */
+#if defined(MCUBOOT_SWAP_STATUS_PARTITION) && \
+    ((!defined(MCUBOOT_SWAP_USING_MOVE) && !defined(MCUBOOT_SWAP_USING_OFFSET)) || \
+     defined(MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE) || defined(MCUBOOT_SERIAL_UPLOAD_RESUME))
+#error "MCUBOOT_SWAP_STATUS_PARTITION requires the swap using move or swap using offset upgrade mode, and cannot be used with MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE or MCUBOOT_SERIAL_UPLOAD_RESUME"
+#endif
+
 #define BOOT_STATUS_OP_MOVE     1
 #define BOOT_STATUS_OP_SWAP     2
 
@@ -177,13 +400,46 @@ _Static_assert(sizeof(boot_img_magic) == BOOT_MAGIC_SZ, "Invalid size for image
 #else
 #define ARE_SLOTS_EQUIVALENT()    1
 
-#if defined(MCUBOOT_DIRECT_XIP) && defined(MCUBOOT_ENC_IMAGES)
-#error "Image encryption (MCUBOOT_ENC_IMAGES) is not supported when MCUBOOT_DIRECT_XIP is selected."
-#endif /* MCUBOOT_DIRECT_XIP && MCUBOOT_ENC_IMAGES */
+#if defined(MCUBOOT_DIRECT_XIP) && defined(MCUBOOT_ENC_IMAGES) && \
+    !defined(MCUBOOT_ENC_XIP)
+#error "Image encryption (MCUBOOT_ENC_IMAGES) is not supported when MCUBOOT_DIRECT_XIP is selected, unless MCUBOOT_ENC_XIP is."
+#endif /* MCUBOOT_DIRECT_XIP && MCUBOOT_ENC_IMAGES && !MCUBOOT_ENC_XIP */
 #endif /* MCUBOOT_DIRECT_XIP || MCUBOOT_RAM_LOAD */
 
+#ifdef MCUBOOT_SWAP_USING_OFFSET
+#if defined(MCUBOOT_ENC_IMAGES)
+#error "Image encryption (MCUBOOT_ENC_IMAGES) is not supported when MCUBOOT_SWAP_USING_OFFSET is selected."
+#endif
+#if defined(MCUBOOT_BOOTSTRAP)
+#error "MCUBOOT_BOOTSTRAP is not supported when MCUBOOT_SWAP_USING_OFFSET is selected."
+#endif
+#endif /* MCUBOOT_SWAP_USING_OFFSET */
+
+/*
+ * With swap using bank, the image in the secondary slot is mapped as it is at
+ * the address of the primary slot, so it can not be transformed on the way.
+ */
+#ifdef MCUBOOT_SWAP_USING_BANK
+#if defined(MCUBOOT_ENC_IMAGES) || defined(MCUBOOT_DECOMPRESS_IMAGES) || \
+    defined(MCUBOOT_DELTA_IMAGES)
+#error "Encrypted, compressed and delta images are not supported when MCUBOOT_SWAP_USING_BANK is selected."
+#endif
+#if defined(MCUBOOT_BOOTSTRAP)
+#error "MCUBOOT_BOOTSTRAP is not supported when MCUBOOT_SWAP_USING_BANK is selected."
+#endif
+#endif /* MCUBOOT_SWAP_USING_BANK */
+
 #define BOOT_MAX_IMG_SECTORS       MCUBOOT_MAX_IMG_SECTORS
 
+#ifdef MCUBOOT_SECTOR_RUNS
+#ifndef MCUBOOT_USE_FLASH_AREA_GET_SECTORS
+#error "MCUBOOT_SECTOR_RUNS requires MCUBOOT_USE_FLASH_AREA_GET_SECTORS"
+#endif
+#ifndef MCUBOOT_MAX_SECTOR_RUNS
+#define MCUBOOT_MAX_SECTOR_RUNS    4
+#endif
+#endif
+
 #define BOOT_LOG_IMAGE_INFO(slot, hdr)                                    \
     BOOT_LOG_INF("%-9s slot: version=%u.%u.%u+%u",                        \
                  ((slot) == BOOT_PRIMARY_SLOT) ? "Primary" : "Secondary", \
@@ -196,12 +452,41 @@ _Static_assert(sizeof(boot_img_magic) == BOOT_MAGIC_SZ, "Invalid size for image
 #define BOOT_STATUS_MOVE_STATE_COUNT    1
 #define BOOT_STATUS_SWAP_STATE_COUNT    2
 #define BOOT_STATUS_STATE_COUNT         (BOOT_STATUS_MOVE_STATE_COUNT + BOOT_STATUS_SWAP_STATE_COUNT)
+#elif MCUBOOT_SWAP_USING_OFFSET
+/* The "move" region records the backward swap, the "swap" region the forward one. */
+#define BOOT_STATUS_MOVE_STATE_COUNT    2
+#define BOOT_STATUS_SWAP_STATE_COUNT    2
+#define BOOT_STATUS_STATE_COUNT         (BOOT_STATUS_MOVE_STATE_COUNT + BOOT_STATUS_SWAP_STATE_COUNT)
 #else
 #define BOOT_STATUS_STATE_COUNT         3
 #endif
 
-/** Maximum number of image sectors supported by the bootloader. */
+/**
+ * Maximum number of swap steps recorded in the swap status area. Each step
+ * moves at least one sector, so this defaults to the maximum number of image
+ * sectors supported by the bootloader.
+ */
+#ifdef MCUBOOT_SWAP_STATUS_MAX_ENTRIES
+#define BOOT_STATUS_MAX_ENTRIES         MCUBOOT_SWAP_STATUS_MAX_ENTRIES
+#else
 #define BOOT_STATUS_MAX_ENTRIES         BOOT_MAX_IMG_SECTORS
+#endif
+
+/*
+ * Space taken by each entry of the swap status log. With
+ * MCUBOOT_SWAP_STATUS_PACKED, entries are single bytes sharing write units,
+ * which are programmed again as the following entries are added; the flash
+ * must allow that, so this is not usable on flash with ECC.
+ */
+#if defined(MCUBOOT_SWAP_STATUS_PACKED)
+#if !defined(MCUBOOT_SWAP_USING_SCRATCH) && !defined(MCUBOOT_SWAP_USING_MOVE) && \
+    !defined(MCUBOOT_SWAP_USING_OFFSET)
+#error "MCUBOOT_SWAP_STATUS_PACKED requires one of the swap upgrade modes using a status log"
+#endif
+#define BOOT_STATUS_ELEM_SZ(state)      1
+#else
+#define BOOT_STATUS_ELEM_SZ(state)      BOOT_WRITE_SZ(state)
+#endif
 
 #define BOOT_PRIMARY_SLOT               0
 #define BOOT_SECONDARY_SLOT             1
@@ -221,19 +506,45 @@ typedef struct flash_sector boot_sector_t;
 typedef struct flash_area boot_sector_t;
 #endif
 
+#ifdef MCUBOOT_SECTOR_RUNS
+/**
+ * Consecutive sectors of the same size, the first one starting at the given
+ * offset from the beginning of the flash area.
+ */
+struct boot_sector_run {
+    uint32_t off;
+    uint32_t size;
+    uint32_t count;
+};
+
+/** Sector layout of a flash area, in as few runs as its sectors allow. */
+struct boot_sector_runs {
+    struct boot_sector_run runs[MCUBOOT_MAX_SECTOR_RUNS];
+    uint32_t num_runs;
+};
+#endif
+
 /** Private state maintained during boot. */
 struct boot_loader_state {
     struct {
         struct image_header hdr;
         const struct flash_area *area;
+#ifdef MCUBOOT_SECTOR_RUNS
+        struct boot_sector_runs sectors;
+#else
         boot_sector_t *sectors;
+#endif
         uint32_t num_sectors;
     } imgs[BOOT_IMAGE_NUMBER][BOOT_NUM_SLOTS];
 
 #if MCUBOOT_SWAP_USING_SCRATCH
     struct {
         const struct flash_area *area;
+#ifdef MCUBOOT_SECTOR_RUNS
+        struct boot_sector_runs sectors;
+#else
         boot_sector_t *sectors;
+#endif
         uint32_t num_sectors;
     } scratch;
 #endif
@@ -248,6 +559,75 @@ struct boot_loader_state {
 #if (BOOT_IMAGE_NUMBER > 1)
     uint8_t curr_img_idx;
     bool img_mask[BOOT_IMAGE_NUMBER];
+#ifdef MCUBOOT_LAZY_VALIDATION
+    /* Images upgraded by boot_go_for_image_id() whose primary slot is only
+     * validated later, by boot_validate_deferred_image().
+     */
+    bool img_deferred[BOOT_IMAGE_NUMBER];
+#endif
+
+    /* Dependency TLVs of each slot, read once. Several TLVs on the same
+     * image are merged into the highest minimum version they require.
+     */
+    struct {
+        bool loaded;
+        int rc;
+        bool on[BOOT_IMAGE_NUMBER];
+        struct image_version min_ver[BOOT_IMAGE_NUMBER];
+    } deps[BOOT_IMAGE_NUMBER][BOOT_NUM_SLOTS];
+#endif
+
+#if defined(MCUBOOT_MEASURED_BOOT)
+    /* Hash computed the last time the image in each slot was validated,
+     * used as its measurement instead of reading its hash TLV again.
+     */
+    struct {
+        bool valid;
+        uint8_t hash[IMAGE_HASH_SIZE];
+    } measured[BOOT_IMAGE_NUMBER][BOOT_NUM_SLOTS];
+#endif
+
+#if defined(MCUBOOT_ERASE_AHEAD)
+    /* Number of bytes at the start of the primary slot of each image whose
+     * erase has been started ahead of its copy.
+     */
+    uint32_t erase_ahead[BOOT_IMAGE_NUMBER];
+#endif
+
+#if defined(BOOT_VERIFY_COPY)
+    /* Hash context fed by boot_copy_region() and the number of bytes from
+     * the start of the source area to be hashed.
+     */
+    bootutil_sha_context *copy_sha;
+    uint32_t copy_sha_sz;
+#endif
+
+#if defined(MCUBOOT_BOOTSTRAP_VERIFY_COPY)
+    /* Whether the secondary slot of each image is about to be bootstrapped
+     * to its empty or invalid primary slot, its hash and signature being
+     * checked while it is copied.
+     */
+    bool bootstrap_copy[BOOT_IMAGE_NUMBER];
+#endif
+
+#ifdef MCUBOOT_VALIDATION_CACHE_UPGRADE
+    /* Validation record of the image last validated in the secondary slot,
+     * and whether that image has been installed in the primary slot during
+     * this boot.
+     */
+    struct boot_validation_record upgrade_rec[BOOT_IMAGE_NUMBER];
+    bool upgrade_installed[BOOT_IMAGE_NUMBER];
+#endif
+
+#if defined(MCUBOOT_PARALLEL_VALIDATION) && !defined(MCUBOOT_DIRECT_XIP)
+    /* Hash of the primary slot of every image computed on another core, if
+     * valid, while the primary slots are validated before booting.
+     */
+    struct {
+        bool pending;
+        bool valid;
+        uint8_t hash[IMAGE_HASH_SIZE];
+    } primary_hash[BOOT_IMAGE_NUMBER];
 #endif
 
 #if defined(MCUBOOT_DIRECT_XIP) || defined(MCUBOOT_RAM_LOAD)
@@ -255,13 +635,48 @@ struct boot_loader_state {
         /* Index of the slot chosen to be loaded */
         uint32_t active_slot;
         bool slot_available[BOOT_NUM_SLOTS];
+#ifdef MCUBOOT_BOOT_INDEX
+        /* Only the versions of the image headers are known, from the boot
+         * index; see boot_index.h. */
+        bool hdr_from_index;
+#endif
 #if defined(MCUBOOT_RAM_LOAD)
         /* Image destination and size for the active slot */
         uint32_t img_dst;
         uint32_t img_sz;
+#if defined(MCUBOOT_RAM_LOAD_HASH_COPY) || defined(MCUBOOT_RAM_LOAD_SEGMENTS)
+        /* Hash computed while the image was copied to RAM, if valid */
+        bool img_hash_valid;
+        uint8_t img_hash[IMAGE_HASH_SIZE];
+#endif
+#ifdef MCUBOOT_RAM_LOAD_PARALLEL
+        /* Slot already copied to img_dst, and hashed, if any */
+        uint32_t preload_slot;
+#endif
+#ifdef MCUBOOT_RAM_LOAD_RESIDENT
+        /* FIH_SUCCESS if the copy of the active slot left in RAM by a
+         * previous boot was found intact and was not copied again */
+        fih_ret resident_rc;
+#endif
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+        /* Segments of the active slot, if it is scatter loaded */
+        uint32_t seg_cnt;
+        struct image_ram_load_segment segs[MCUBOOT_RAM_LOAD_MAX_SEGMENTS];
+#endif
 #elif defined(MCUBOOT_DIRECT_XIP_REVERT)
         /* Swap status for the active slot */
         struct boot_swap_state swap_state;
+#endif
+#ifdef MCUBOOT_ENC_XIP
+        /* Keys of the encrypted images of the slots, kept until the
+         * decryption engine is programmed for the active one */
+        uint8_t enc_key[BOOT_NUM_SLOTS][BOOT_ENC_KEY_SIZE];
+#endif
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+        /* Hash of the img_hash_slot slot computed on another core, if valid */
+        uint32_t img_hash_slot;
+        bool img_hash_valid;
+        uint8_t img_hash[IMAGE_HASH_SIZE];
 #endif
     } slot_usage[BOOT_IMAGE_NUMBER];
 #endif /* MCUBOOT_DIRECT_XIP || MCUBOOT_RAM_LOAD */
@@ -289,6 +704,8 @@ int boot_write_image_ok(const struct flash_area *fap);
 int boot_write_swap_info(const struct flash_area *fap, uint8_t swap_type,
                          uint8_t image_num);
 int boot_write_swap_size(const struct flash_area *fap, uint32_t swap_size);
+int boot_write_swap_fields(const struct flash_area *fap, uint8_t swap_type,
+                           uint8_t image_num, const struct boot_status *bs);
 int boot_write_trailer(const struct flash_area *fap, uint32_t off,
                        const uint8_t *inbuf, uint8_t inlen);
 int boot_write_trailer_flag(const struct flash_area *fap, uint32_t off,
@@ -298,13 +715,120 @@ int boot_slots_compatible(struct boot_loader_state *state);
 uint32_t boot_status_internal_off(const struct boot_status *bs, int elem_sz);
 int boot_read_image_header(struct boot_loader_state *state, int slot,
                            struct image_header *out_hdr, struct boot_status *bs);
+/*
+ * Reads the image header at off in the flash area, from the CPU address space
+ * when MCUBOOT_HASH_MMAP_FLASH is enabled and the area is mapped, or else
+ * with flash_area_read(), whose return value is given.
+ */
+int boot_read_hdr(const struct flash_area *fap, uint32_t off,
+                  struct image_header *hdr);
 int boot_copy_region(struct boot_loader_state *state,
                      const struct flash_area *fap_src,
                      const struct flash_area *fap_dst,
                      uint32_t off_src, uint32_t off_dst, uint32_t sz);
+int boot_erase_copy_region(struct boot_loader_state *state,
+                           const struct flash_area *fap_src,
+                           const struct flash_area *fap_dst,
+                           uint32_t off_src, uint32_t off_dst,
+                           uint32_t erase_sz, uint32_t copy_sz);
 int boot_erase_region(const struct flash_area *fap, uint32_t off, uint32_t sz);
 bool boot_status_is_reset(const struct boot_status *bs);
 
+#ifdef MCUBOOT_HW_ROLLBACK_PROT_CACHE
+/*
+ * Security counters read once per boot. boot_security_counter_get() returns
+ * the stored value of a counter, or the value a pending update sets it to.
+ * boot_security_counter_update() only records the update:
+ * boot_security_counter_commit() writes all the pending updates together
+ * before the images are booted, and boot_security_counter_reset() drops the
+ * values read and the pending updates.
+ */
+void boot_security_counter_reset(void);
+fih_ret boot_security_counter_get(uint32_t image_id, fih_int *security_cnt);
+int32_t boot_security_counter_update(uint32_t image_id,
+                                     uint32_t img_security_cnt);
+int32_t boot_security_counter_commit(void);
+#else
+#define boot_security_counter_get    boot_nv_security_counter_get
+#define boot_security_counter_update boot_nv_security_counter_update
+#endif
+
+#ifdef MCUBOOT_TLV_INDEX
+/* Drops the TLV indexes of the images of `fap`, or of every area if NULL. */
+void bootutil_tlv_index_invalidate(const struct flash_area *fap);
+#endif
+
+#ifdef MCUBOOT_UPGRADE_PROGRESS
+/*
+ * Reports the progress of the upgrade of the current image through
+ * mcuboot_status_progress(): `boot_progress_start()` when it starts, with
+ * the number of steps of the whole upgrade and of those already done
+ * before a reset, then `boot_progress_step()` after each step.
+ */
+void boot_progress_start(const struct boot_loader_state *state,
+                         uint32_t total, uint32_t done);
+void boot_progress_step(uint32_t bytes);
+#else
+#define boot_progress_start(_state, _total, _done) do { } while (0)
+#define boot_progress_step(_bytes) do { } while (0)
+#endif
+
+#ifdef MCUBOOT_DELTA_IMAGES
+/*
+ * Replaces a delta image in the secondary slot by the image it rebuilds from
+ * the primary slot, and re-reads the header of the secondary slot. Returns 0
+ * when there is no delta image.
+ */
+int boot_delta_apply(struct boot_loader_state *state, struct boot_status *bs);
+#endif
+
+#ifdef MCUBOOT_DECOMPRESS_IMAGES
+/*
+ * Checks the flags and TLVs of a compressed image, and that the image it
+ * decompresses to fits the primary slot.
+ */
+bool boot_is_compressed_header_valid(const struct image_header *hdr,
+                                     const struct flash_area *fap,
+                                     struct boot_loader_state *state);
+
+/*
+ * Returns the full size, TLVs included, of the image a compressed image
+ * decompresses to.
+ */
+int boot_decompressed_image_size(const struct image_header *hdr,
+                                 const struct flash_area *fap, uint32_t *size);
+
+/*
+ * Checks the flags and TLVs of a compressed image in any area, and that the
+ * image it decompresses to fits fap_dst written with the given alignment.
+ */
+bool boot_check_compressed_header(int image_index,
+                                  const struct image_header *hdr,
+                                  const struct flash_area *fap,
+                                  const struct flash_area *fap_dst,
+                                  uint32_t align);
+
+struct enc_key_data;
+
+/*
+ * Writes the image the compressed image in fap_src decompresses to into the
+ * erased fap_dst, and checks its IMAGE_TLV_DECOMP_SHA. The payload of an
+ * encrypted image is decrypted with enc.
+ */
+int boot_decompress_image(int image_index, const struct image_header *hdr,
+                          const struct flash_area *fap_src,
+                          const struct flash_area *fap_dst, uint32_t align,
+                          struct enc_key_data *enc);
+
+/*
+ * Writes the image the compressed image in the secondary slot decompresses
+ * to into the erased primary slot, and checks its IMAGE_TLV_DECOMP_SHA.
+ */
+int boot_copy_region_decompress(struct boot_loader_state *state,
+                                const struct flash_area *fap_src,
+                                const struct flash_area *fap_dst);
+#endif
+
 #ifdef MCUBOOT_ENC_IMAGES
 int boot_write_enc_key(const struct flash_area *fap, uint8_t slot,
                        const struct boot_status *bs);
@@ -312,6 +836,59 @@ int boot_read_enc_key(const struct flash_area *fap, uint8_t slot,
                       struct boot_status *bs);
 #endif
 
+#if defined(MCUBOOT_VALIDATION_CACHE) || defined(MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE) || \
+    defined(MCUBOOT_IMAGE_VERDICT_HOOKS)
+/**
+ * Computes the digests binding a validation result to an image: a digest of
+ * its header, and the value of its image hash TLV.
+ *
+ * @param hdr           Header of the image.
+ * @param fap           Flash area containing the image.
+ * @param hdr_digest    Buffer of IMAGE_HASH_SIZE bytes for the header digest.
+ * @param img_hash      Buffer of IMAGE_HASH_SIZE bytes for the hash TLV.
+ *
+ * @returns 0 on success; nonzero if the hash TLV is missing or unreadable.
+ */
+int boot_image_digests(const struct image_header *hdr,
+                       const struct flash_area *fap, uint8_t *hdr_digest,
+                       uint8_t *img_hash);
+#endif
+
+#if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE)
+#define BOOT_VALIDATED_RECORD_MAGIC 0x56414c31 /* "VAL1" */
+
+/*
+ * Record of the image validated by boot_image_validate_once(), stored at the
+ * start of the swap status area of its slot.
+ */
+struct boot_validated_record {
+    uint32_t magic;
+    uint8_t hdr_digest[IMAGE_HASH_SIZE];
+    uint8_t img_hash[IMAGE_HASH_SIZE];
+};
+
+/**
+ * Validates the image of a slot which is never swapped, such as the slot of
+ * a single application slot or firmware loader configuration, only once.
+ *
+ * The image is fully validated unless the slot has a good magic, image_ok
+ * set, and a validated record matching the header digest and hash TLV of
+ * the image. After a successful full validation the record is stored, if
+ * its location is still erased, and the magic and image_ok are set.
+ *
+ * As the record is only bound to the image header and hash TLV, a payload
+ * modified after the validation is not detected; see design.md.
+ *
+ * @param fap           Flash area of the slot.
+ * @param hdr           Header of the image; the encryption flags are
+ *                      cleared, the image is expected to be decrypted.
+ *
+ * @returns FIH_SUCCESS if the image is valid; FIH_FAILURE otherwise.
+ */
+fih_ret boot_image_validate_once(const struct flash_area *fap,
+                                 struct image_header *hdr);
+#endif
+
 /**
  * Checks that a buffer is erased according to what the erase value for the
  * flash device provided in `flash_area` is.
@@ -322,6 +899,63 @@ int boot_read_enc_key(const struct flash_area *fap, uint8_t slot,
 bool bootutil_buffer_is_erased(const struct flash_area *area,
                                const void *buffer, size_t len);
 
+/* Size of the stack buffer used to scan flash which is not memory mapped. */
+#ifndef BOOT_ERASED_SCAN_BUF_SZ
+#define BOOT_ERASED_SCAN_BUF_SZ 64
+#endif
+
+/* Amount of memory-mapped flash checked before looking for an early exit. */
+#ifndef BOOT_ERASED_SCAN_MMAP_BLK_SZ
+#define BOOT_ERASED_SCAN_MMAP_BLK_SZ 1024
+#endif
+
+/**
+ * Checks that a region of a flash area is erased. The flash_area_is_erased()
+ * backend hook is used first if MCUBOOT_FLASH_AREA_IS_ERASED is enabled.
+ * Otherwise the region is read, through memory-mapped accesses if
+ * MCUBOOT_HASH_MMAP_FLASH is enabled and the area is mapped, and the scan
+ * stops at the first block which is not erased.
+ *
+ * @param fap           Flash area containing the region.
+ * @param off           Offset of the region within the flash area.
+ * @param len           Length of the region; an empty region is erased.
+ * @param erased        Set to true if the whole region is erased.
+ *
+ * @returns 0 on success; BOOT_EBADARGS if the region is outside the flash
+ * area, BOOT_EFLASH if it could not be read.
+ */
+int bootutil_area_is_erased(const struct flash_area *fap, uint32_t off,
+                            uint32_t len, bool *erased);
+
+#if defined(MCUBOOT_WATCHDOG_FEED_BYTES) && (MCUBOOT_WATCHDOG_FEED_BYTES > 0)
+#if !defined(__BOOTSIM__)
+extern uint32_t boot_watchdog_bytes;
+#else
+extern __thread uint32_t boot_watchdog_bytes;
+#endif
+#endif
+
+/**
+ * Feeds the watchdog from a loop which has just processed len bytes. With
+ * MCUBOOT_WATCHDOG_FEED_BYTES, MCUBOOT_WATCHDOG_FEED() is only called once
+ * at least that many bytes have been processed, by any loop, since the last
+ * time it was. This is also a step point of MCUBOOT_BOOT_STEP.
+ */
+static inline void boot_watchdog_feed(uint32_t len)
+{
+#if defined(MCUBOOT_WATCHDOG_FEED_BYTES) && (MCUBOOT_WATCHDOG_FEED_BYTES > 0)
+    boot_watchdog_bytes += len;
+    if (boot_watchdog_bytes < MCUBOOT_WATCHDOG_FEED_BYTES) {
+        return;
+    }
+    boot_watchdog_bytes = 0;
+#else
+    (void)len;
+#endif
+    MCUBOOT_WATCHDOG_FEED();
+    BOOT_STEP_POINT(BOOT_STEP_DATA);
+}
+
 /**
  * Safe (non-overflowing) uint32_t addition.  Returns true, and stores
  * the result in *dest if it can be done without overflow.  Otherwise,
@@ -404,7 +1038,45 @@ boot_img_slot_off(struct boot_loader_state *state, size_t slot)
     return flash_area_get_off(BOOT_IMG(state, slot).area);
 }
 
-#ifndef MCUBOOT_USE_FLASH_AREA_GET_SECTORS
+#if defined(MCUBOOT_SECTOR_RUNS)
+
+/*
+ * Returns the run holding a sector of a slot, and turns the index of the
+ * sector into an index within that run.
+ */
+static inline const struct boot_sector_run *
+boot_img_sector_run(const struct boot_loader_state *state, size_t slot,
+                    size_t *sector)
+{
+    const struct boot_sector_runs *sectors = &BOOT_IMG(state, slot).sectors;
+    uint32_t i;
+
+    for (i = 0; i + 1 < sectors->num_runs &&
+                *sector >= sectors->runs[i].count; i++) {
+        *sector -= sectors->runs[i].count;
+    }
+
+    return &sectors->runs[i];
+}
+
+static inline size_t
+boot_img_sector_size(const struct boot_loader_state *state,
+                     size_t slot, size_t sector)
+{
+    return boot_img_sector_run(state, slot, &sector)->size;
+}
+
+static inline uint32_t
+boot_img_sector_off(const struct boot_loader_state *state, size_t slot,
+                    size_t sector)
+{
+    const struct boot_sector_run *run;
+
+    run = boot_img_sector_run(state, slot, &sector);
+    return run->off + sector * run->size;
+}
+
+#elif !defined(MCUBOOT_USE_FLASH_AREA_GET_SECTORS)
 
 static inline size_t
 boot_img_sector_size(const struct boot_loader_state *state,
@@ -442,7 +1114,7 @@ boot_img_sector_off(const struct boot_loader_state *state, size_t slot,
            flash_sector_get_off(&BOOT_IMG(state, slot).sectors[0]);
 }
 
-#endif  /* !defined(MCUBOOT_USE_FLASH_AREA_GET_SECTORS) */
+#endif  /* MCUBOOT_SECTOR_RUNS / !MCUBOOT_USE_FLASH_AREA_GET_SECTORS */
 
 #ifdef MCUBOOT_RAM_LOAD
 #   ifdef __BOOTSIM__
@@ -466,11 +1138,26 @@ struct bootsim_ram_info *bootsim_get_ram_info(void);
 #       define IMAGE_RAM_BASE ((uintptr_t)0)
 #   endif
 
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+/* The header and the TLVs of scatter-loaded images stay in flash. */
+#define LOAD_IMAGE_DATA(hdr, fap, start, output, size)       \
+    (((hdr)->ih_flags & IMAGE_F_RAM_LOAD_SEGMENTS) ?          \
+    flash_area_read((fap), (start), (output), (size)) :       \
+    (memcpy((output),(void*)(IMAGE_RAM_BASE + (hdr)->ih_load_addr + (start)), \
+    (size)), 0))
+#else
 #define LOAD_IMAGE_DATA(hdr, fap, start, output, size)       \
     (memcpy((output),(void*)(IMAGE_RAM_BASE + (hdr)->ih_load_addr + (start)), \
     (size)), 0)
+#endif
 
 int boot_load_image_to_sram(struct boot_loader_state *state);
+#ifdef MCUBOOT_RAM_LOAD_PARALLEL
+void boot_preload_images_to_sram(struct boot_loader_state *state);
+#endif
+#ifdef MCUBOOT_RAM_LOAD_RESIDENT
+void boot_ram_resident_note(struct boot_loader_state *state, int slot);
+#endif
 int boot_remove_image_from_sram(struct boot_loader_state *state);
 int boot_remove_image_from_flash(struct boot_loader_state *state,
                                  uint32_t slot);
@@ -482,11 +1169,120 @@ int boot_remove_image_from_flash(struct boot_loader_state *state,
 
 #endif /* MCUBOOT_RAM_LOAD */
 
+#ifdef MCUBOOT_FLASH_AREA_READ_ASYNC
+/*
+ * Optional flash map backend extension used to pipeline image hashing. The
+ * backend starts reading len bytes at off into dst (e.g. using DMA) and returns
+ * without waiting for the transfer to finish. flash_area_read_wait() blocks
+ * until the outstanding read on fap has completed and returns its status. At
+ * most one read is outstanding per flash area at any time.
+ */
+int flash_area_read_async(const struct flash_area *fap, uint32_t off,
+                          void *dst, uint32_t len);
+int flash_area_read_wait(const struct flash_area *fap);
+#endif
+
+#ifdef MCUBOOT_FLASH_AREA_WRITE_ASYNC
+/*
+ * Optional flash map backend extension used to pipeline flash copies. The
+ * backend starts programming len bytes from src at off and returns without
+ * waiting; src stays valid until flash_area_write_wait() has returned. At
+ * most one write is outstanding per flash area at any time.
+ */
+int flash_area_write_async(const struct flash_area *fap, uint32_t off,
+                           const void *src, uint32_t len);
+int flash_area_write_wait(const struct flash_area *fap);
+#endif
+
+#ifdef MCUBOOT_FLASH_AREA_ERASE_ASYNC
+/*
+ * Optional flash map backend extension used to erase the primary slot of an
+ * image while another image is being copied. The backend starts erasing len
+ * bytes at off and returns without waiting; flash_area_erase_wait() blocks
+ * until the erase has completed and returns its status. At most one erase is
+ * outstanding per flash area and nothing else is done on the area meanwhile.
+ */
+int flash_area_erase_async(const struct flash_area *fap, uint32_t off,
+                           uint32_t len);
+int flash_area_erase_wait(const struct flash_area *fap);
+#endif
+
+#ifdef MCUBOOT_HASH_MMAP_FLASH
+/*
+ * Optional flash map backend extension: if the whole flash area can be read
+ * through the CPU address space, stores the address of its first byte in
+ * addr and returns 0. Returns non-zero if the area is not memory mapped, in
+ * which case it is accessed through flash_area_read().
+ */
+int flash_area_get_mapped_addr(const struct flash_area *fap, uintptr_t *addr);
+#endif
+
+#ifdef MCUBOOT_FLASH_AREA_MMAP
+/*
+ * Optional flash map backend extension for flash that can only be read
+ * through the CPU address space a window at a time, e.g. through an MMU with
+ * few entries: maps len bytes at off, stores the address of the first one in
+ * ptr and returns 0. Returns non-zero if the region can not be mapped, in
+ * which case it is accessed through flash_area_read(). At most one region is
+ * mapped at any time, until flash_area_munmap() is called with its address.
+ */
+int flash_area_mmap(const struct flash_area *fap, uint32_t off, uint32_t len,
+                    const void **ptr);
+void flash_area_munmap(const struct flash_area *fap, const void *ptr);
+#endif
+
+#ifdef MCUBOOT_FLASH_AREA_IS_ERASED
+/*
+ * Optional flash map backend extension for devices with a blank-check
+ * command: checks whether len bytes at off are all erased, sets erased
+ * accordingly and returns 0. Returns non-zero if the check can not be done
+ * in hardware for this region, in which case the region is read back.
+ */
+int flash_area_is_erased(const struct flash_area *fap, uint32_t off,
+                         uint32_t len, bool *erased);
+#endif
+
+#ifdef MCUBOOT_FLASH_AREA_COPY
+/*
+ * Optional flash map backend extension for devices which can copy between
+ * flash areas without the CPU, e.g. using DMA: copies len bytes at off_src in
+ * fap_src to the erased region at off_dst in fap_dst. Returns 0 on success, a
+ * negative value on a flash error, or a positive value if the backend does not
+ * handle this pair of areas and has not written anything, in which case the
+ * region is copied through RAM.
+ */
+int flash_area_copy(const struct flash_area *fap_src, uint32_t off_src,
+                    const struct flash_area *fap_dst, uint32_t off_dst,
+                    uint32_t len);
+#endif
+
 uint32_t bootutil_max_image_size(const struct flash_area *fap);
 
+#ifdef MCUBOOT_SWAP_USING_OFFSET
+/*
+ * Returns the offset of the image within the given flash area. With
+ * swap-using-offset an image in the secondary slot is either stored from its
+ * second sector (new upgrade) or from its start (image swapped out of the
+ * primary slot); this is 0 for any other flash area.
+ */
+uint32_t boot_img_start_off(const struct flash_area *fap);
+#define BOOT_IMG_START_OFF(fap) boot_img_start_off(fap)
+#else
+#define BOOT_IMG_START_OFF(fap) 0
+#endif
+
 int boot_read_image_size(struct boot_loader_state *state, int slot,
                          uint32_t *size);
 
+#ifdef MCUBOOT_PENDING_DIGEST
+/*
+ * Returns the offset of the pending digest record of the image with the
+ * given header, which is stored right after the image TLVs.
+ */
+int boot_pending_digest_off(const struct flash_area *fap,
+                            const struct image_header *hdr, uint32_t *off);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -51,6 +51,14 @@
 #include "bootutil_priv.h"
 #include "bootutil_misc.h"
 
+#ifdef MCUBOOT_RAM_LOAD_STAGED
+#include "bootutil/crypto/sha.h"
+#endif
+
+#ifdef MCUBOOT_PENDING_DIGEST
+#include "bootutil/pending_digest.h"
+#endif
+
 #ifdef CONFIG_MCUBOOT
 BOOT_LOG_MODULE_DECLARE(mcuboot);
 #else
@@ -173,8 +181,10 @@ boot_magic_compatible_check(uint8_t tbl_val, uint8_t val)
 bool bootutil_buffer_is_erased(const struct flash_area *area,
                                const void *buffer, size_t len)
 {
-    size_t i;
-    uint8_t *u8b;
+    const uint8_t *u8b;
+    const uint32_t *u32b;
+    uint32_t erased_word;
+    uint32_t diff;
     uint8_t erased_val;
 
     if (buffer == NULL || len == 0) {
@@ -182,13 +192,99 @@ bool bootutil_buffer_is_erased(const struct flash_area *area,
     }
 
     erased_val = flash_area_erased_val(area);
-    for (i = 0, u8b = (uint8_t *)buffer; i < len; i++) {
-        if (u8b[i] != erased_val) {
-            return false;
+    erased_word = 0x01010101U * erased_val;
+    diff = 0;
+    u8b = (const uint8_t *)buffer;
+
+    /* The whole buffer is always scanned, so that the time taken only
+     * depends on its length and not on its content.
+     */
+    while (len > 0 && ((uintptr_t)u8b & (sizeof(uint32_t) - 1)) != 0) {
+        diff |= *u8b++ ^ erased_val;
+        len--;
+    }
+
+    u32b = (const uint32_t *)u8b;
+    while (len >= 4 * sizeof(uint32_t)) {
+        diff |= (u32b[0] ^ erased_word) | (u32b[1] ^ erased_word) |
+                (u32b[2] ^ erased_word) | (u32b[3] ^ erased_word);
+        u32b += 4;
+        len -= 4 * sizeof(uint32_t);
+    }
+    while (len >= sizeof(uint32_t)) {
+        diff |= *u32b++ ^ erased_word;
+        len -= sizeof(uint32_t);
+    }
+
+    u8b = (const uint8_t *)u32b;
+    while (len > 0) {
+        diff |= *u8b++ ^ erased_val;
+        len--;
+    }
+
+    return diff == 0;
+}
+
+int
+bootutil_area_is_erased(const struct flash_area *fap, uint32_t off,
+                        uint32_t len, bool *erased)
+{
+    uint32_t buf[BOOT_ERASED_SCAN_BUF_SZ / sizeof(uint32_t)];
+    const void *chunk;
+    uint32_t chunk_sz;
+    uint32_t chunk_max;
+    uintptr_t addr = 0;
+    bool mapped = false;
+    int rc;
+
+    if (off > flash_area_get_size(fap) ||
+        len > flash_area_get_size(fap) - off) {
+        return BOOT_EBADARGS;
+    }
+
+#ifdef MCUBOOT_FLASH_AREA_IS_ERASED
+    if (len > 0 && flash_area_is_erased(fap, off, len, erased) == 0) {
+        return 0;
+    }
+#endif
+
+#ifdef MCUBOOT_HASH_MMAP_FLASH
+    mapped = flash_area_get_mapped_addr(fap, &addr) == 0;
+#endif
+    chunk_max = mapped ? BOOT_ERASED_SCAN_MMAP_BLK_SZ : sizeof(buf);
+
+    *erased = true;
+    while (len > 0) {
+        chunk_sz = len < chunk_max ? len : chunk_max;
+        if (mapped) {
+            chunk = (const void *)(addr + off);
+        } else {
+            rc = flash_area_read(fap, off, buf, chunk_sz);
+            if (rc != 0) {
+                return BOOT_EFLASH;
+            }
+            chunk = buf;
+        }
+
+        if (!bootutil_buffer_is_erased(fap, chunk, chunk_sz)) {
+            *erased = false;
+            break;
         }
+
+        off += chunk_sz;
+        len -= chunk_sz;
     }
 
-    return true;
+    return 0;
+}
+
+static uint8_t
+boot_flag_parse(const struct flash_area *fap, uint8_t flag)
+{
+    if (bootutil_buffer_is_erased(fap, &flag, sizeof flag)) {
+        return BOOT_FLAG_UNSET;
+    }
+    return boot_flag_decode(flag);
 }
 
 static int
@@ -200,47 +296,47 @@ boot_read_flag(const struct flash_area *fap, uint8_t *flag, uint32_t off)
     if (rc < 0) {
         return BOOT_EFLASH;
     }
-    if (bootutil_buffer_is_erased(fap, flag, sizeof *flag)) {
-        *flag = BOOT_FLAG_UNSET;
-    } else {
-        *flag = boot_flag_decode(*flag);
-    }
+    *flag = boot_flag_parse(fap, *flag);
 
     return 0;
 }
 
-static inline int
-boot_read_copy_done(const struct flash_area *fap, uint8_t *copy_done)
-{
-    return boot_read_flag(fap, copy_done, boot_copy_done_off(fap));
-}
-
-
+/*
+ * Reads the swap info, copy done, image ok and magic fields of a trailer
+ * with a single flash read, from the swap info up to the end of the area.
+ * With the padding of each field to BOOT_MAX_ALIGN, this is at most
+ * BOOT_MAGIC_SZ + 4 * BOOT_MAX_ALIGN bytes.
+ */
 int
 boot_read_swap_state(const struct flash_area *fap,
                      struct boot_swap_state *state)
 {
-    uint8_t magic[BOOT_MAGIC_SZ];
-    uint32_t off;
+    uint8_t trailer[BOOT_MAGIC_SZ + 4 * BOOT_MAX_ALIGN];
+    const uint8_t *magic;
+    uint32_t base;
+    uint32_t len;
     uint8_t swap_info;
     int rc;
 
-    off = boot_magic_off(fap);
-    rc = flash_area_read(fap, off, magic, BOOT_MAGIC_SZ);
+    base = boot_swap_info_off(fap);
+    len = flash_area_get_size(fap) - base;
+    if (len > sizeof(trailer)) {
+        return BOOT_EBADARGS;
+    }
+
+    rc = flash_area_read(fap, base, trailer, len);
     if (rc < 0) {
         return BOOT_EFLASH;
     }
+
+    magic = &trailer[boot_magic_off(fap) - base];
     if (bootutil_buffer_is_erased(fap, magic, BOOT_MAGIC_SZ)) {
         state->magic = BOOT_MAGIC_UNSET;
     } else {
         state->magic = boot_magic_decode(magic);
     }
 
-    off = boot_swap_info_off(fap);
-    rc = flash_area_read(fap, off, &swap_info, sizeof swap_info);
-    if (rc < 0) {
-        return BOOT_EFLASH;
-    }
+    swap_info = trailer[0];
 
     /* Extract the swap type and image number */
     state->swap_type = BOOT_GET_SWAP_TYPE(swap_info);
@@ -252,12 +348,10 @@ boot_read_swap_state(const struct flash_area *fap,
         state->image_num = 0;
     }
 
-    rc = boot_read_copy_done(fap, &state->copy_done);
-    if (rc) {
-        return BOOT_EFLASH;
-    }
+    state->copy_done = boot_flag_parse(fap, trailer[boot_copy_done_off(fap) - base]);
+    state->image_ok = boot_flag_parse(fap, trailer[boot_image_ok_off(fap) - base]);
 
-    return boot_read_image_ok(fap, &state->image_ok);
+    return 0;
 }
 
 int
@@ -688,6 +782,128 @@ boot_set_pending(int permanent)
     return boot_set_pending_multi(0, permanent);
 }
 
+#ifdef MCUBOOT_PENDING_DIGEST
+#define BOOT_PENDING_DIGEST_REC_SZ \
+    ALIGN_UP(sizeof(struct boot_pending_digest), BOOT_MAX_ALIGN)
+
+int
+boot_pending_digest_off(const struct flash_area *fap,
+                        const struct image_header *hdr, uint32_t *off)
+{
+    struct image_tlv_info info;
+    uint32_t tlv_off;
+
+    tlv_off = BOOT_TLV_OFF(hdr);
+    if (flash_area_read(fap, tlv_off, &info, sizeof(info)) != 0) {
+        return BOOT_EFLASH;
+    }
+
+    if (info.it_magic == IMAGE_TLV_PROT_INFO_MAGIC) {
+        if (hdr->ih_protect_tlv_size != info.it_tlv_tot) {
+            return BOOT_EBADIMAGE;
+        }
+        tlv_off += info.it_tlv_tot;
+        if (flash_area_read(fap, tlv_off, &info, sizeof(info)) != 0) {
+            return BOOT_EFLASH;
+        }
+    } else if (hdr->ih_protect_tlv_size != 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    if (info.it_magic != IMAGE_TLV_INFO_MAGIC) {
+        return BOOT_EBADIMAGE;
+    }
+
+    *off = ALIGN_UP(tlv_off + info.it_tlv_tot, BOOT_MAX_ALIGN);
+    return 0;
+}
+
+/**
+ * Marks the image with the given index in the secondary slot as pending,
+ * after storing the digest of the image computed by the application and its
+ * MAC right after the image TLVs. The record is only written to erased
+ * flash, in front of the image trailer.
+ *
+ * @param image_index       Image pair index.
+ * @param permanent         Whether the image should be used permanently or
+ *                          only tested once:
+ *                               0=run image once, then confirm or revert.
+ *                               1=run image forever.
+ * @param digest            Digest of the image, IMAGE_HASH_SIZE bytes.
+ *
+ * @return                  0 on success; nonzero on failure.
+ */
+int
+boot_set_pending_digest_multi(int image_index, int permanent,
+                              const uint8_t *digest)
+{
+    const struct flash_area *fap;
+    struct image_header hdr;
+    union {
+        struct boot_pending_digest rec;
+        uint8_t buf[BOOT_PENDING_DIGEST_REC_SZ];
+    } u;
+    uint32_t off;
+    bool erased;
+    int rc;
+
+    rc = flash_area_open(FLASH_AREA_IMAGE_SECONDARY(image_index), &fap);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    rc = flash_area_read(fap, 0, &hdr, sizeof(hdr));
+    if (rc != 0) {
+        rc = BOOT_EFLASH;
+        goto out;
+    }
+
+    if (hdr.ih_magic != IMAGE_MAGIC) {
+        rc = BOOT_EBADIMAGE;
+        goto out;
+    }
+
+    rc = boot_pending_digest_off(fap, &hdr, &off);
+    if (rc != 0) {
+        goto out;
+    }
+
+    if (off > boot_swap_info_off(fap) ||
+        boot_swap_info_off(fap) - off < BOOT_PENDING_DIGEST_REC_SZ) {
+        rc = BOOT_ENOMEM;
+        goto out;
+    }
+
+    rc = bootutil_area_is_erased(fap, off, BOOT_PENDING_DIGEST_REC_SZ,
+                                 &erased);
+    if (rc != 0 || !erased) {
+        rc = BOOT_EFLASH;
+        goto out;
+    }
+
+    memset(u.buf, flash_area_erased_val(fap), sizeof(u.buf));
+    u.rec.magic = BOOT_PENDING_DIGEST_MAGIC;
+    memcpy(u.rec.digest, digest, IMAGE_HASH_SIZE);
+    rc = boot_pending_digest_mac(image_index, &hdr, u.rec.digest, u.rec.mac);
+    if (rc != 0) {
+        rc = BOOT_EBADARGS;
+        goto out;
+    }
+
+    rc = flash_area_write(fap, off, u.buf, sizeof(u.buf));
+    if (rc != 0) {
+        rc = BOOT_EFLASH;
+        goto out;
+    }
+
+    rc = boot_set_next(fap, false, !(permanent == 0));
+
+out:
+    flash_area_close(fap);
+    return rc;
+}
+#endif /* MCUBOOT_PENDING_DIGEST */
+
 /**
  * Marks the image with the given index in the primary slot as confirmed.  The
  * system will continue booting into the image in the primary slot until told to
@@ -728,12 +944,49 @@ boot_set_confirmed(void)
     return boot_set_confirmed_multi(0);
 }
 
+int
+boot_read_hdr(const struct flash_area *fap, uint32_t off,
+              struct image_header *hdr)
+{
+#ifdef MCUBOOT_HASH_MMAP_FLASH
+    const volatile uint32_t *words;
+    uint32_t copy[IMAGE_HEADER_SIZE / sizeof(uint32_t)];
+    uintptr_t addr;
+    size_t i;
+
+    /* The header is copied word by word straight from the mapping, which
+     * must then be aligned, without a call to the flash driver.
+     */
+    if (off <= flash_area_get_size(fap) &&
+        flash_area_get_size(fap) - off >= sizeof(*hdr) &&
+        flash_area_get_mapped_addr(fap, &addr) == 0 &&
+        ((addr + off) & (sizeof(uint32_t) - 1)) == 0) {
+        words = (const volatile uint32_t *)(addr + off);
+        for (i = 0; i < sizeof(copy) / sizeof(copy[0]); i++) {
+            copy[i] = words[i];
+        }
+#ifdef FIH_ENABLE_DOUBLE_VARS
+        /* Read it again, so that a glitched load is not taken for it. */
+        for (i = 0; i < sizeof(copy) / sizeof(copy[0]); i++) {
+            if (copy[i] != words[i]) {
+                return BOOT_EFLASH;
+            }
+        }
+#endif
+        memcpy(hdr, copy, sizeof(*hdr));
+        return 0;
+    }
+#endif
+
+    return flash_area_read(fap, off, hdr, sizeof(*hdr));
+}
+
 int
 boot_image_load_header(const struct flash_area *fa_p,
                        struct image_header *hdr)
 {
     uint32_t size;
-    int rc = flash_area_read(fa_p, 0, hdr, sizeof *hdr);
+    int rc = boot_read_hdr(fa_p, 0, hdr);
 
     if (rc != 0) {
         rc = BOOT_EFLASH;
@@ -760,3 +1013,193 @@ boot_image_load_header(const struct flash_area *fa_p,
 
     return 0;
 }
+
+#ifdef MCUBOOT_RAM_LOAD_STAGED
+/*
+ * Finds a protected TLV of an image in RAM; returns a pointer to its data, or
+ * NULL if there is none or the protected TLV area is malformed.
+ */
+static const uint8_t *
+boot_ram_load_find_tlv(const uint8_t *image, uint16_t type, uint16_t *len)
+{
+    const struct image_header *hdr = (const struct image_header *)image;
+    struct image_tlv_info info;
+    struct image_tlv tlv;
+    uint32_t off;
+    uint32_t end;
+
+    off = (uint32_t)hdr->ih_hdr_size + hdr->ih_img_size;
+    memcpy(&info, image + off, sizeof(info));
+    if (info.it_magic != IMAGE_TLV_PROT_INFO_MAGIC ||
+        info.it_tlv_tot != hdr->ih_protect_tlv_size) {
+        return NULL;
+    }
+
+    end = off + info.it_tlv_tot;
+    off += sizeof(info);
+    while (off + sizeof(tlv) <= end) {
+        memcpy(&tlv, image + off, sizeof(tlv));
+        off += sizeof(tlv);
+        if (tlv.it_len > end - off) {
+            return NULL;
+        }
+        if (tlv.it_type == type) {
+            *len = tlv.it_len;
+            return image + off;
+        }
+        off += tlv.it_len;
+    }
+
+    return NULL;
+}
+
+/*
+ * Gets the chunk size and the digest table of a chunked image in RAM.
+ */
+static int
+boot_ram_load_chunk_table(const uint8_t *image, uint32_t *chunk_sz,
+                          const uint8_t **table)
+{
+    const struct image_header *hdr = (const struct image_header *)image;
+    const uint8_t *data;
+    uint32_t chunk_cnt;
+    uint16_t len;
+
+    if (!(hdr->ih_flags & IMAGE_F_HASH_CHUNKED)) {
+        return BOOT_EBADIMAGE;
+    }
+
+    data = boot_ram_load_find_tlv(image, IMAGE_TLV_HASH_CHUNKS, &len);
+    if (data == NULL || len < sizeof(*chunk_sz)) {
+        return BOOT_EBADIMAGE;
+    }
+    memcpy(chunk_sz, data, sizeof(*chunk_sz));
+    if (*chunk_sz == 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    chunk_cnt = hdr->ih_img_size / *chunk_sz +
+                ((hdr->ih_img_size % *chunk_sz) != 0);
+    if ((len - sizeof(*chunk_sz)) != chunk_cnt * IMAGE_HASH_SIZE) {
+        return BOOT_EBADIMAGE;
+    }
+    *table = data + sizeof(*chunk_sz);
+
+    return 0;
+}
+
+int
+boot_ram_load_stage_end(const uint8_t *image, uint32_t *end)
+{
+    const struct image_header *hdr = (const struct image_header *)image;
+    const uint8_t *table;
+    const uint8_t *data;
+    uint32_t chunk_sz;
+    uint32_t stage_sz;
+    uint16_t len;
+
+    *end = hdr->ih_img_size;
+    if (!(hdr->ih_flags & IMAGE_F_HASH_CHUNKED)) {
+        return 0;
+    }
+
+    data = boot_ram_load_find_tlv(image, IMAGE_TLV_RAM_LOAD_STAGE, &len);
+    if (data == NULL) {
+        return 0;
+    }
+    if (len != sizeof(stage_sz) ||
+        boot_ram_load_chunk_table(image, &chunk_sz, &table) != 0) {
+        return BOOT_EBADIMAGE;
+    }
+    memcpy(&stage_sz, data, sizeof(stage_sz));
+    if (stage_sz > hdr->ih_img_size) {
+        return BOOT_EBADIMAGE;
+    }
+
+    stage_sz = (stage_sz / chunk_sz + ((stage_sz % chunk_sz) != 0)) * chunk_sz;
+    if (stage_sz > hdr->ih_img_size) {
+        stage_sz = hdr->ih_img_size;
+    }
+    *end = stage_sz;
+
+    return 0;
+}
+
+int
+boot_ram_load_range(const struct flash_area *fa, uint8_t *image,
+                    uint32_t off, uint32_t size)
+{
+    const struct image_header *hdr = (const struct image_header *)image;
+    bootutil_sha_context sha_ctx;
+    uint8_t digest[IMAGE_HASH_SIZE];
+    const uint8_t *table;
+    uint32_t chunk_sz;
+    uint32_t chunk_off;
+    uint32_t blk_sz;
+    uint32_t end;
+    uint32_t i;
+    uint8_t *dst;
+    int rc;
+
+    rc = boot_ram_load_chunk_table(image, &chunk_sz, &table);
+    if (rc != 0) {
+        return rc;
+    }
+    if (off > hdr->ih_img_size || size > hdr->ih_img_size - off) {
+        return BOOT_EBADARGS;
+    }
+
+    end = off + size;
+    for (i = off / chunk_sz; i < hdr->ih_img_size / chunk_sz +
+             ((hdr->ih_img_size % chunk_sz) != 0); i++) {
+        chunk_off = i * chunk_sz;
+        if (chunk_off >= end) {
+            break;
+        }
+        blk_sz = hdr->ih_img_size - chunk_off;
+        if (blk_sz > chunk_sz) {
+            blk_sz = chunk_sz;
+        }
+
+        dst = image + hdr->ih_hdr_size + chunk_off;
+        rc = flash_area_read(fa, hdr->ih_hdr_size + chunk_off, dst, blk_sz);
+        if (rc != 0) {
+            return BOOT_EFLASH;
+        }
+
+        bootutil_sha_init(&sha_ctx);
+        bootutil_sha_update(&sha_ctx, dst, blk_sz);
+        bootutil_sha_finish(&sha_ctx, digest);
+        bootutil_sha_drop(&sha_ctx);
+
+        if (memcmp(digest, table + i * IMAGE_HASH_SIZE, IMAGE_HASH_SIZE) != 0) {
+            BOOT_LOG_ERR("RAM load: chunk %lu does not match",
+                         (unsigned long)i);
+            memset(dst, 0, blk_sz);
+            return BOOT_EBADIMAGE;
+        }
+    }
+
+    return 0;
+}
+
+int
+boot_ram_load_finish(const struct flash_area *fa, uint8_t *image)
+{
+    const struct image_header *hdr = (const struct image_header *)image;
+    uint32_t end;
+    int rc;
+
+    rc = boot_ram_load_stage_end(image, &end);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (end == hdr->ih_img_size) {
+        /* Not a staged image, it has been loaded in full. */
+        return 0;
+    }
+
+    return boot_ram_load_range(fa, image, end, hdr->ih_img_size - end);
+}
+#endif /* MCUBOOT_RAM_LOAD_STAGED */
@@ -45,6 +45,10 @@ uint32_t bootutil_get_caps(void)
     res |= BOOTUTIL_CAP_OVERWRITE_UPGRADE;
 #elif defined(MCUBOOT_SWAP_USING_MOVE)
     res |= BOOTUTIL_CAP_SWAP_USING_MOVE;
+#elif defined(MCUBOOT_SWAP_USING_OFFSET)
+    res |= BOOTUTIL_CAP_SWAP_USING_OFFSET;
+#elif defined(MCUBOOT_SWAP_USING_BANK)
+    res |= BOOTUTIL_CAP_SWAP_USING_BANK;
 #else
     res |= BOOTUTIL_CAP_SWAP_USING_SCRATCH;
 #endif
@@ -81,6 +85,12 @@ uint32_t bootutil_get_caps(void)
 #if defined(MCUBOOT_HW_ROLLBACK_PROT)
     res |= BOOTUTIL_CAP_HW_ROLLBACK_PROT;
 #endif
+#if defined(MCUBOOT_SWAP_PERM_DISCARD)
+    res |= BOOTUTIL_CAP_SWAP_PERM_DISCARD;
+#endif
+#if defined(MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY)
+    res |= BOOTUTIL_CAP_OVERWRITE_VERIFY_COPY;
+#endif
 
     return res;
 }
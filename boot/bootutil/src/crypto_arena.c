@@ -0,0 +1,80 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef MCUBOOT_CRYPTO_ARENA
+
+#include <string.h>
+
+#include "bootutil/crypto/sha.h"
+#if defined(MCUBOOT_SIGN_RSA) || defined(MCUBOOT_ENCRYPT_RSA)
+#include "bootutil/crypto/rsa.h"
+#endif
+#if defined(MCUBOOT_SIGN_EC256) || defined(MCUBOOT_SIGN_EC384)
+#include "bootutil/crypto/ecdsa.h"
+#endif
+#if defined(MCUBOOT_ENCRYPT_EC256)
+#include "bootutil/crypto/ecdh_p256.h"
+#endif
+#if defined(MCUBOOT_ENCRYPT_X25519)
+#include "bootutil/crypto/ecdh_x25519.h"
+#endif
+#if defined(MCUBOOT_ENCRYPT_EC256) || defined(MCUBOOT_ENCRYPT_X25519)
+#include "bootutil/crypto/hmac_sha256.h"
+#include "bootutil/crypto/aes_ctr.h"
+#endif
+
+#include "crypto_arena.h"
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+#include "bootutil/bench.h"
+#endif
+
+union boot_crypto_arena {
+    /* bootutil_img_hash() */
+    bootutil_sha_context img_hash;
+
+    /* bootutil_verify_sig() */
+#if defined(MCUBOOT_SIGN_RSA) && !defined(MCUBOOT_BUILTIN_KEY)
+    bootutil_rsa_context rsa_sig;
+#endif
+#if (defined(MCUBOOT_SIGN_EC256) || defined(MCUBOOT_SIGN_EC384)) && \
+    !defined(MCUBOOT_BUILTIN_KEY)
+    bootutil_ecdsa_context ecdsa_sig;
+#endif
+
+    /* boot_decrypt_key(), whose contexts are used one after the other */
+#if defined(MCUBOOT_ENCRYPT_RSA)
+    bootutil_rsa_context rsa_enc;
+#endif
+#if defined(MCUBOOT_ENCRYPT_EC256)
+    bootutil_ecdh_p256_context ecdh_p256;
+#endif
+#if defined(MCUBOOT_ENCRYPT_X25519)
+    bootutil_ecdh_x25519_context ecdh_x25519;
+#endif
+#if defined(MCUBOOT_ENCRYPT_EC256) || defined(MCUBOOT_ENCRYPT_X25519)
+    bootutil_hmac_sha256_context hmac;
+    bootutil_aes_ctr_context aes_ctr;
+#endif
+};
+
+#if !defined(__BOOTSIM__)
+union boot_crypto_arena boot_crypto_arena;
+#else
+__thread union boot_crypto_arena boot_crypto_arena;
+#endif
+
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+void
+boot_crypto_arena_paint(void)
+{
+    boot_profile_arena_paint(BOOT_ARENA_CRYPTO, &boot_crypto_arena,
+                             sizeof(boot_crypto_arena));
+}
+#endif
+
+#endif /* MCUBOOT_CRYPTO_ARENA */
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef H_CRYPTO_ARENA_
+#define H_CRYPTO_ARENA_
+
+#include "mcuboot_config/mcuboot_config.h"
+
+/*
+ * With MCUBOOT_CRYPTO_ARENA, the crypto contexts of the image hash, of the
+ * signature check and of the encryption key decryption are taken from a
+ * single static arena instead of the stack of the function using them.
+ * These phases never overlap, so the arena is sized by the largest of them
+ * and its size is known at link time, instead of each one adding to the
+ * worst-case stack depth the boot stack must be sized for.
+ */
+#if defined(MCUBOOT_CRYPTO_ARENA)
+
+#if defined(MCUBOOT_PARALLEL_VALIDATION)
+#error "MCUBOOT_CRYPTO_ARENA is not supported with MCUBOOT_PARALLEL_VALIDATION"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The arena is defined in crypto_arena.c as a union of every context taken
+ * from it, so any new user must be listed there. The simulator runs boots
+ * from several threads at once, each of them with its own arena.
+ */
+#if !defined(__BOOTSIM__)
+extern union boot_crypto_arena boot_crypto_arena;
+#else
+extern __thread union boot_crypto_arena boot_crypto_arena;
+#endif
+
+/* Declares name as a pointer to a context of the given type. */
+#define BOOT_CRYPTO_CTX(type, name) \
+    type *const name = (type *)&boot_crypto_arena
+
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+/* Paints the arena for the boot profiler, see bootutil/bench.h. */
+void boot_crypto_arena_paint(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#else /* MCUBOOT_CRYPTO_ARENA */
+
+#define BOOT_CRYPTO_CTX(type, name) \
+    type name##_buf;                \
+    type *const name = &name##_buf
+
+#endif /* MCUBOOT_CRYPTO_ARENA */
+
+#endif /* H_CRYPTO_ARENA_ */
@@ -0,0 +1,1437 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compressed images: the payload of the image in the secondary slot is a
+ * raw LZMA2 stream or a single LZ4 block, optionally of a payload run through
+ * the ARM thumb BCJ filter, which is decompressed while it is copied to the
+ * primary slot by an overwrite-only upgrade.
+ *
+ * The decompressed image is the image imgtool signed before compressing
+ * it. Its header is the header of the compressed image without the
+ * compression flags and with the sizes of the decompressed payload and
+ * TLVs. Its protected TLVs are those of the compressed image without the
+ * IMAGE_TLV_DECOMP_* ones, and its unprotected TLVs are those of the
+ * compressed image with the hash and the signature replaced by
+ * IMAGE_TLV_DECOMP_SHA and IMAGE_TLV_DECOMP_SIGNATURE. The header, payload
+ * and protected TLVs are hashed as they are written and the result checked
+ * against IMAGE_TLV_DECOMP_SHA, which the signature of the compressed image
+ * covers.
+ *
+ * Only a bounded amount of RAM is used: the LZMA dictionary or LZ4 window is
+ * the payload already written to the primary slot, which is read back for
+ * matches, and only the write buffer of MCUBOOT_DECOMPRESSION_BUFFER_SIZE
+ * bytes, small read buffers and, for LZMA2, the probability model are kept
+ * in RAM. The BCJ filter converts some 4 byte instructions of the payload:
+ * as the matches refer to the filtered bytes, data read back from the
+ * primary slot is filtered again, which works since the filter leaves the
+ * bits it decides on untouched.
+ *
+ * Encrypted compressed images hold the encrypted compressed payload. It is
+ * decrypted in place as it is read into the input buffer, so that one pass
+ * over the secondary slot decrypts, decompresses, hashes and programs the
+ * image with a single set of buffers. The image is written decrypted, as
+ * upgrades of encrypted images do, and keeps its encryption flags.
+ *
+ * LZ4 trades compression ratio for speed and RAM: it has no entropy coder
+ * and no model to keep, so MCUBOOT_DECOMPRESS_LZ4 alone needs a few hundred
+ * bytes of state besides the write buffer.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include "bootutil/bootutil.h"
+#include "bootutil/image.h"
+#include "bootutil/crypto/sha.h"
+#include "bootutil/enc_key.h"
+#include "bootutil/fault_injection_hardening.h"
+#include "bootutil_priv.h"
+#include "bootutil/bootutil_log.h"
+
+#include "mcuboot_config/mcuboot_config.h"
+
+BOOT_LOG_MODULE_DECLARE(mcuboot);
+
+#ifdef MCUBOOT_DECOMPRESS_IMAGES
+
+#if !defined(MCUBOOT_OVERWRITE_ONLY)
+#error "MCUBOOT_DECOMPRESS_IMAGES requires MCUBOOT_OVERWRITE_ONLY"
+#endif
+
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME) || \
+    defined(MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY)
+#error "MCUBOOT_DECOMPRESS_IMAGES does not support resumed or verified copies"
+#endif
+
+#if !defined(MCUBOOT_DECOMPRESS_LZMA2) && !defined(MCUBOOT_DECOMPRESS_LZ4)
+#define MCUBOOT_DECOMPRESS_LZMA2
+#endif
+
+#ifndef MCUBOOT_DECOMPRESSION_BUFFER_SIZE
+#define MCUBOOT_DECOMPRESSION_BUFFER_SIZE 4096
+#endif
+
+#if MCUBOOT_DECOMPRESSION_BUFFER_SIZE < BOOT_MAX_ALIGN
+#error "MCUBOOT_DECOMPRESSION_BUFFER_SIZE must hold at least BOOT_MAX_ALIGN bytes"
+#endif
+
+/* Compressed data read at once from the secondary slot. */
+#define BOOT_DECOMP_IN_SZ       256
+
+/* Dictionary data read at once from the primary slot. */
+#define BOOT_DECOMP_CACHE_SZ    128
+
+#if !defined(__BOOTSIM__)
+#define TARGET_STATIC static
+#else
+#define TARGET_STATIC
+#endif
+
+#define LZ4_MIN_MATCH           4
+
+#define LZMA_PROB_BITS          11
+#define LZMA_PROB_INIT          (1u << (LZMA_PROB_BITS - 1))
+#define LZMA_MOVE_BITS          5
+#define LZMA_RC_TOP             (1u << 24)
+
+#define LZMA_STATES             12
+#define LZMA_LIT_STATES         7
+#define LZMA_POS_STATES_MAX     16
+#define LZMA_LCLP_MAX           4
+#define LZMA_LIT_SIZE           0x300
+#define LZMA_LEN_LOW_BITS       3
+#define LZMA_LEN_MID_BITS       3
+#define LZMA_LEN_HIGH_BITS      8
+#define LZMA_MATCH_LEN_MIN      2
+#define LZMA_DIST_STATES        4
+#define LZMA_DIST_SLOT_BITS     6
+#define LZMA_DIST_MODEL_START   4
+#define LZMA_DIST_MODEL_END     14
+#define LZMA_FULL_DISTANCES     (1u << (LZMA_DIST_MODEL_END / 2))
+#define LZMA_ALIGN_BITS         4
+
+/* Matches the first half of a Thumb BL instruction pair. */
+#define BCJ_IS_BL(b)            ((((b)[1] & 0xf8) == 0xf0) && \
+                                 (((b)[3] & 0xf8) == 0xf8))
+
+#ifdef MCUBOOT_DECOMPRESS_LZMA2
+struct lzma_len_probs {
+    uint16_t choice;
+    uint16_t choice2;
+    uint16_t low[LZMA_POS_STATES_MAX][1 << LZMA_LEN_LOW_BITS];
+    uint16_t mid[LZMA_POS_STATES_MAX][1 << LZMA_LEN_MID_BITS];
+    uint16_t high[1 << LZMA_LEN_HIGH_BITS];
+};
+
+struct lzma_probs {
+    uint16_t is_match[LZMA_STATES][LZMA_POS_STATES_MAX];
+    uint16_t is_rep[LZMA_STATES];
+    uint16_t is_rep0[LZMA_STATES];
+    uint16_t is_rep1[LZMA_STATES];
+    uint16_t is_rep2[LZMA_STATES];
+    uint16_t is_rep0_long[LZMA_STATES][LZMA_POS_STATES_MAX];
+    uint16_t dist_slot[LZMA_DIST_STATES][1 << LZMA_DIST_SLOT_BITS];
+    uint16_t dist_special[1 + LZMA_FULL_DISTANCES - LZMA_DIST_MODEL_END];
+    uint16_t dist_align[1 << LZMA_ALIGN_BITS];
+    struct lzma_len_probs match_len;
+    struct lzma_len_probs rep_len;
+    /* Must be last, only the part used by lc and lp is reset. */
+    uint16_t literal[LZMA_LIT_SIZE << LZMA_LCLP_MAX];
+};
+#endif
+
+struct boot_decomp {
+    const struct flash_area *fap_src;
+    const struct flash_area *fap_dst;
+    bootutil_sha_context sha;
+#ifdef MCUBOOT_ENC_IMAGES
+    struct enc_key_data *enc;
+#endif
+    bool err;
+
+    /* Compressed data, read from the secondary slot. */
+    uint32_t in_off;
+    uint32_t in_end;
+    uint32_t in_used;
+    uint16_t in_pos;
+    uint16_t in_len;
+
+    /* Range decoder and LZMA state. */
+    uint32_t range;
+    uint32_t code;
+    uint32_t rep[4];
+    uint8_t state;
+    uint8_t lc;
+    uint8_t lp;
+    uint8_t pb;
+
+    /* Payload bytes output by the LZMA decoder, which are still filtered
+     * when the BCJ filter is used, and the position of the last dictionary
+     * reset.
+     */
+    uint32_t out_pos;
+    uint32_t dict_start;
+    uint8_t prev;
+
+    /* BCJ filter: bytes from bcj_pos on are not unfiltered yet. */
+    bool bcj;
+    uint32_t bcj_pos;
+    uint8_t bcj_buf[4];
+    uint8_t bcj_len;
+
+    /* The primary slot holds `flushed' bytes of the decompressed image, the
+     * following `wlen' are in the write buffer; the first `hash_end' are
+     * hashed.
+     */
+    uint32_t hdr_size;
+    uint32_t align;
+    uint32_t flushed;
+    uint32_t wlen;
+    uint32_t hash_end;
+
+    /* Filtered payload bytes from cache_pos on, read back for matches. */
+    uint32_t cache_pos;
+    uint32_t cache_len;
+
+    /* Not cleared before use, from here on. */
+    uint8_t cache[BOOT_DECOMP_CACHE_SZ + 8];
+    uint8_t in[BOOT_DECOMP_IN_SZ];
+#ifdef MCUBOOT_DECOMPRESS_LZMA2
+    struct lzma_probs probs;
+#endif
+    uint8_t wbuf[MCUBOOT_DECOMPRESSION_BUFFER_SIZE + BOOT_MAX_ALIGN]
+        __attribute__((aligned(4)));
+};
+
+/* Layout of the TLVs of a compressed image and of its decompressed image. */
+struct boot_decomp_tlvs {
+    uint32_t img_size;
+    uint32_t sha_off;
+    uint32_t sig_off;
+    uint16_t sig_len;
+    uint16_t prot_size;
+    uint16_t unprot_size;
+};
+
+static bool
+boot_decomp_is_sig_tlv(uint16_t type)
+{
+    switch (type) {
+    case IMAGE_TLV_RSA2048_PSS:
+    case IMAGE_TLV_ECDSA224:
+    case IMAGE_TLV_ECDSA_SIG:
+    case IMAGE_TLV_RSA3072_PSS:
+    case IMAGE_TLV_ED25519:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool
+boot_decomp_is_decomp_tlv(uint16_t type)
+{
+    return type == IMAGE_TLV_DECOMP_SIZE || type == IMAGE_TLV_DECOMP_SHA ||
+           type == IMAGE_TLV_DECOMP_SIGNATURE;
+}
+
+/*
+ * Reads the IMAGE_TLV_DECOMP_* TLVs of a compressed image and computes the
+ * TLV sizes of the decompressed image.
+ */
+static int
+boot_decomp_read_tlvs(const struct image_header *hdr,
+                      const struct flash_area *fap, struct boot_decomp_tlvs *t)
+{
+    struct image_tlv_iter it;
+    uint32_t prot = 0;
+    uint32_t unprot = sizeof(struct image_tlv_info);
+    bool has_size = false;
+    bool has_sha = false;
+    bool has_sig = false;
+    uint32_t off;
+    uint16_t len;
+    uint16_t type;
+    int rc;
+
+    memset(t, 0, sizeof(*t));
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_ANY, false);
+    if (rc != 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    while ((rc = bootutil_tlv_iter_next(&it, &off, &len, &type)) == 0) {
+        if (bootutil_tlv_iter_is_prot(&it, off)) {
+            if (type == IMAGE_TLV_DECOMP_SIZE) {
+                if (len != sizeof(t->img_size) ||
+                    flash_area_read(fap, off, &t->img_size, len) != 0) {
+                    return BOOT_EBADIMAGE;
+                }
+                has_size = true;
+            } else if (type == IMAGE_TLV_DECOMP_SHA) {
+                if (len != IMAGE_HASH_SIZE) {
+                    return BOOT_EBADIMAGE;
+                }
+                t->sha_off = off;
+                has_sha = true;
+            } else if (type == IMAGE_TLV_DECOMP_SIGNATURE) {
+                if (len == 0) {
+                    return BOOT_EBADIMAGE;
+                }
+                t->sig_off = off;
+                t->sig_len = len;
+            } else {
+                prot += sizeof(struct image_tlv) + len;
+            }
+        } else {
+            /* The signature of the decompressed image replaces the one of
+             * the compressed image, the hash has the same size.
+             */
+            if (boot_decomp_is_sig_tlv(type)) {
+                if (has_sig || t->sig_len == 0) {
+                    return BOOT_EBADIMAGE;
+                }
+                len = t->sig_len;
+                has_sig = true;
+            }
+            unprot += sizeof(struct image_tlv) + len;
+        }
+    }
+
+    if (rc < 0 || !has_size || !has_sha || has_sig != (t->sig_len != 0)) {
+        return BOOT_EBADIMAGE;
+    }
+
+    if (prot > 0) {
+        prot += sizeof(struct image_tlv_info);
+    }
+    if (prot > UINT16_MAX || unprot > UINT16_MAX) {
+        return BOOT_EBADIMAGE;
+    }
+    t->prot_size = prot;
+    t->unprot_size = unprot;
+
+    return 0;
+}
+
+static int
+boot_decomp_image_size(const struct image_header *hdr,
+                       const struct boot_decomp_tlvs *t, uint32_t *size)
+{
+    if (!boot_u32_safe_add(size, hdr->ih_hdr_size, t->img_size) ||
+        !boot_u32_safe_add(size, *size, t->prot_size) ||
+        !boot_u32_safe_add(size, *size, t->unprot_size)) {
+        return BOOT_EBADIMAGE;
+    }
+
+    return 0;
+}
+
+int
+boot_decompressed_image_size(const struct image_header *hdr,
+                             const struct flash_area *fap, uint32_t *size)
+{
+    struct boot_decomp_tlvs t;
+    int rc;
+
+    rc = boot_decomp_read_tlvs(hdr, fap, &t);
+    if (rc == 0) {
+        rc = boot_decomp_image_size(hdr, &t, size);
+    }
+
+    return rc;
+}
+
+bool
+boot_check_compressed_header(int image_index, const struct image_header *hdr,
+                             const struct flash_area *fap,
+                             const struct flash_area *fap_dst, uint32_t align)
+{
+    struct boot_decomp_tlvs t;
+    uint32_t trailer_sz;
+    uint32_t size;
+
+    switch (hdr->ih_flags & (IMAGE_F_COMPRESSED_LZMA1 |
+                             IMAGE_F_COMPRESSED_LZMA2 |
+                             IMAGE_F_COMPRESSED_LZ4)) {
+#ifdef MCUBOOT_DECOMPRESS_LZMA2
+    case IMAGE_F_COMPRESSED_LZMA2:
+        /* Properties header and end of stream. */
+        if (hdr->ih_img_size < 3) {
+            return false;
+        }
+        break;
+#endif
+#ifdef MCUBOOT_DECOMPRESS_LZ4
+    case IMAGE_F_COMPRESSED_LZ4:
+        if (hdr->ih_img_size < 1) {
+            return false;
+        }
+        break;
+#endif
+    default:
+        BOOT_LOG_ERR("Image %d: unsupported compression", image_index);
+        return false;
+    }
+
+    /* The hash chunk table covers the compressed payload only. */
+    if ((hdr->ih_flags & IMAGE_F_HASH_CHUNKED) ||
+        hdr->ih_hdr_size < sizeof(struct image_header)) {
+        return false;
+    }
+
+    if (boot_decomp_read_tlvs(hdr, fap, &t) != 0 ||
+        boot_decomp_image_size(hdr, &t, &size) != 0) {
+        return false;
+    }
+
+    trailer_sz = boot_trailer_sz(align);
+    if (fap_dst == NULL || flash_area_get_size(fap_dst) < trailer_sz ||
+        size > flash_area_get_size(fap_dst) - trailer_sz) {
+        BOOT_LOG_ERR("Image %d: decompressed image does not fit the primary"
+                     " slot", image_index);
+        return false;
+    }
+
+    return true;
+}
+
+bool
+boot_is_compressed_header_valid(const struct image_header *hdr,
+                                const struct flash_area *fap,
+                                struct boot_loader_state *state)
+{
+    return boot_check_compressed_header(BOOT_CURR_IMG(state), hdr, fap,
+                                        BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT),
+                                        BOOT_WRITE_SZ(state));
+}
+
+/*
+ * Writes the buffered data to the primary slot; all of it, padded to the
+ * write alignment, if `last' is set, otherwise only the aligned part.
+ */
+static int
+boot_decomp_flush(struct boot_decomp *d, bool last)
+{
+    uint32_t len = d->wlen;
+    uint32_t hash_len;
+
+    if (last) {
+        while (len % d->align != 0) {
+            d->wbuf[len++] = flash_area_erased_val(d->fap_dst);
+        }
+    } else {
+        len -= len % d->align;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    if (d->flushed < d->hash_end) {
+        hash_len = d->hash_end - d->flushed;
+        bootutil_sha_update(&d->sha, d->wbuf,
+                            (hash_len < len) ? hash_len : len);
+    }
+
+    if (flash_area_write(d->fap_dst, d->flushed, d->wbuf, len) != 0) {
+        return BOOT_EFLASH;
+    }
+    d->flushed += len;
+
+    if (len < d->wlen) {
+        d->wlen -= len;
+        memmove(d->wbuf, d->wbuf + len, d->wlen);
+    } else {
+        d->wlen = 0;
+    }
+
+    return 0;
+}
+
+static int
+boot_decomp_write(struct boot_decomp *d, const uint8_t *buf, uint32_t len)
+{
+    uint32_t n;
+    int rc;
+
+    while (len > 0) {
+        n = MCUBOOT_DECOMPRESSION_BUFFER_SIZE - d->wlen;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(d->wbuf + d->wlen, buf, n);
+        d->wlen += n;
+        buf += n;
+        len -= n;
+
+        if (d->wlen == MCUBOOT_DECOMPRESSION_BUFFER_SIZE) {
+            rc = boot_decomp_flush(d, false);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Copies `len' bytes at offset `off' of the secondary slot to the image.
+ */
+static int
+boot_decomp_write_from(struct boot_decomp *d, uint32_t off, uint32_t len)
+{
+    uint32_t n;
+    int rc;
+
+    /* Only used once the payload is done, the cache is free. */
+    d->cache_len = 0;
+    while (len > 0) {
+        n = (len > sizeof(d->cache)) ? sizeof(d->cache) : len;
+        if (flash_area_read(d->fap_src, off, d->cache, n) != 0) {
+            return BOOT_EFLASH;
+        }
+        rc = boot_decomp_write(d, d->cache, n);
+        if (rc != 0) {
+            return rc;
+        }
+        off += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static int
+boot_decomp_write_tlv(struct boot_decomp *d, uint16_t type, uint16_t len,
+                      uint32_t off)
+{
+    struct image_tlv tlv;
+    int rc;
+
+    tlv.it_type = type;
+    tlv.it_len = len;
+    rc = boot_decomp_write(d, (const uint8_t *)&tlv, sizeof(tlv));
+    if (rc == 0) {
+        rc = boot_decomp_write_from(d, off, len);
+    }
+
+    return rc;
+}
+
+/*
+ * Reads back `len' bytes of the decompressed image at offset `off', from the
+ * primary slot or the write buffer.
+ */
+static int
+boot_decomp_read_back(struct boot_decomp *d, uint32_t off, uint8_t *buf,
+                      uint32_t len)
+{
+    uint32_t n;
+
+    if (off < d->flushed) {
+        n = d->flushed - off;
+        if (n > len) {
+            n = len;
+        }
+        if (flash_area_read(d->fap_dst, off, buf, n) != 0) {
+            return BOOT_EFLASH;
+        }
+        off += n;
+        buf += n;
+        len -= n;
+    }
+    memcpy(buf, d->wbuf + (off - d->flushed), len);
+
+    return 0;
+}
+
+/*
+ * Converts the instruction at payload position `pos', from a relative to an
+ * absolute branch target if `encode' is set, the other way round otherwise.
+ */
+static void
+boot_decomp_bcj_convert(uint8_t *b, uint32_t pos, bool encode)
+{
+    uint32_t addr;
+
+    addr = (((uint32_t)b[1] & 7) << 19) | ((uint32_t)b[0] << 11) |
+           (((uint32_t)b[3] & 7) << 8) | b[2];
+    addr <<= 1;
+    if (encode) {
+        addr += pos + 4;
+    } else {
+        addr -= pos + 4;
+    }
+    addr >>= 1;
+
+    b[1] = 0xf0 | ((addr >> 19) & 7);
+    b[0] = addr >> 11;
+    b[3] = 0xf8 | ((addr >> 8) & 7);
+    b[2] = addr;
+}
+
+/*
+ * Tells whether the even payload position `pos' is the second half of an
+ * instruction converted by the filter. The filter goes through the payload
+ * by 2 bytes and skips the second half of what it converts, so this is the
+ * case when an odd number of instructions it matches end right before.
+ */
+static int
+boot_decomp_bcj_skipped(struct boot_decomp *d, uint32_t pos, bool *skipped)
+{
+    uint8_t blk[34];
+    uint32_t lo;
+    uint32_t i;
+    int rc;
+
+    *skipped = false;
+    while (pos >= 2) {
+        lo = (pos > sizeof(blk) - 2) ? pos - (sizeof(blk) - 2) : 0;
+        rc = boot_decomp_read_back(d, d->hdr_size + lo, blk, pos + 2 - lo);
+        if (rc != 0) {
+            return rc;
+        }
+        for (i = pos - 2; ; i -= 2) {
+            if (!BCJ_IS_BL(&blk[i - lo])) {
+                return 0;
+            }
+            *skipped = !*skipped;
+            if (i == lo) {
+                break;
+            }
+        }
+        pos = lo;
+    }
+
+    return 0;
+}
+
+/*
+ * Fills the cache with the filtered payload from position `pos' on.
+ */
+static int
+boot_decomp_fill(struct boot_decomp *d, uint32_t pos)
+{
+    uint32_t end = d->bcj ? d->bcj_pos : d->out_pos;
+    uint32_t start;
+    uint32_t len;
+    uint32_t i;
+    bool skipped;
+    int rc;
+
+    d->cache_len = 0;
+    len = end - pos;
+    if (len > BOOT_DECOMP_CACHE_SZ) {
+        len = BOOT_DECOMP_CACHE_SZ;
+    }
+
+    if (!d->bcj) {
+        rc = boot_decomp_read_back(d, d->hdr_size + pos, d->cache, len);
+        if (rc == 0) {
+            d->cache_pos = pos;
+            d->cache_len = len;
+        }
+        return rc;
+    }
+
+    /* Converted instructions overlapping the cached bytes start at most 3
+     * bytes before and end at most 3 bytes after them.
+     */
+    start = (pos >= 2) ? ((pos - 2) & ~1u) : 0;
+    len += pos - start;
+    i = (end - start - len > 3) ? len + 3 : end - start;
+    rc = boot_decomp_read_back(d, d->hdr_size + start, d->cache, i);
+    if (rc == 0) {
+        rc = boot_decomp_bcj_skipped(d, start, &skipped);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    end = start + i;
+    i = start + (skipped ? 2 : 0);
+    while (i + 4 <= end) {
+        if (BCJ_IS_BL(&d->cache[i - start])) {
+            boot_decomp_bcj_convert(&d->cache[i - start], i, true);
+            i += 4;
+        } else {
+            i += 2;
+        }
+    }
+
+    /* The second half of an instruction converted before is not. */
+    if (skipped) {
+        memmove(d->cache, d->cache + 2, len - 2);
+        start += 2;
+        len -= 2;
+    }
+    d->cache_pos = start;
+    d->cache_len = len;
+
+    return 0;
+}
+
+/*
+ * Returns the filtered payload byte `dist' bytes back.
+ */
+static uint8_t
+boot_decomp_dict_get(struct boot_decomp *d, uint32_t dist)
+{
+    uint32_t pos = d->out_pos - dist;
+
+    if (d->bcj) {
+        if (pos >= d->bcj_pos) {
+            return d->bcj_buf[pos - d->bcj_pos];
+        }
+    } else if (d->hdr_size + pos >= d->flushed) {
+        return d->wbuf[d->hdr_size + pos - d->flushed];
+    }
+
+    if (pos - d->cache_pos >= d->cache_len &&
+        boot_decomp_fill(d, pos) != 0) {
+        d->err = true;
+        return 0;
+    }
+
+    return d->cache[pos - d->cache_pos];
+}
+
+/*
+ * Outputs a byte of the LZMA decoder, unfiltering it if needed.
+ */
+static int
+boot_decomp_put(struct boot_decomp *d, uint8_t b)
+{
+    int rc;
+
+    d->out_pos++;
+    d->prev = b;
+    if (!d->bcj) {
+        return boot_decomp_write(d, &b, 1);
+    }
+
+    d->bcj_buf[d->bcj_len++] = b;
+    if (d->bcj_len < 4) {
+        return 0;
+    }
+
+    if (BCJ_IS_BL(d->bcj_buf)) {
+        boot_decomp_bcj_convert(d->bcj_buf, d->bcj_pos, false);
+        rc = boot_decomp_write(d, d->bcj_buf, 4);
+        d->bcj_pos += 4;
+        d->bcj_len = 0;
+    } else {
+        rc = boot_decomp_write(d, d->bcj_buf, 2);
+        d->bcj_pos += 2;
+        d->bcj_buf[0] = d->bcj_buf[2];
+        d->bcj_buf[1] = d->bcj_buf[3];
+        d->bcj_len = 2;
+    }
+
+    return rc;
+}
+
+static uint8_t
+boot_decomp_in_byte(struct boot_decomp *d)
+{
+    uint32_t len;
+
+    if (d->in_pos == d->in_len) {
+        len = d->in_end - d->in_off;
+        if (len > sizeof(d->in)) {
+            len = sizeof(d->in);
+        }
+        if (len == 0 || flash_area_read(d->fap_src, d->in_off, d->in,
+                                        len) != 0) {
+            d->err = true;
+            return 0;
+        }
+#ifdef MCUBOOT_ENC_IMAGES
+        if (d->enc != NULL) {
+            boot_enc_decrypt(d->enc, BOOT_SECONDARY_SLOT,
+                             d->in_off - d->hdr_size, len,
+                             (d->in_off - d->hdr_size) & 0xf, d->in);
+        }
+#endif
+        d->in_off += len;
+        d->in_len = len;
+        d->in_pos = 0;
+    }
+    d->in_used++;
+
+    return d->in[d->in_pos++];
+}
+
+#ifdef MCUBOOT_DECOMPRESS_LZ4
+/*
+ * Reads the bytes which extend an LZ4 length of 15, saturating at `max'.
+ */
+static uint32_t
+lz4_len(struct boot_decomp *d, uint32_t len, uint32_t max)
+{
+    uint8_t b;
+
+    do {
+        b = boot_decomp_in_byte(d);
+        len += b;
+    } while (b == 255 && len <= max && !d->err);
+
+    return len;
+}
+
+/*
+ * Decodes the LZ4 block of the payload, `size' bytes once decompressed.
+ */
+static int
+boot_decomp_lz4(struct boot_decomp *d, uint32_t size)
+{
+    uint32_t dist;
+    uint32_t len;
+    uint8_t token;
+    int rc = 0;
+
+    for (;;) {
+        token = boot_decomp_in_byte(d);
+        len = token >> 4;
+        if (len == 15) {
+            len = lz4_len(d, len, size);
+        }
+        if (d->err || len > size - d->out_pos) {
+            return BOOT_EBADIMAGE;
+        }
+        while (len-- > 0 && rc == 0 && !d->err) {
+            rc = boot_decomp_put(d, boot_decomp_in_byte(d));
+        }
+        if (rc != 0) {
+            return rc;
+        }
+        if (d->err) {
+            return BOOT_EBADIMAGE;
+        }
+
+        /* The last sequence has no match; what may follow it, like the
+         * padding of encrypted payloads, is not part of the block.
+         */
+        if (d->out_pos == size) {
+            break;
+        }
+
+        dist = boot_decomp_in_byte(d);
+        dist |= (uint32_t)boot_decomp_in_byte(d) << 8;
+        len = token & 15;
+        if (len == 15) {
+            len = lz4_len(d, len, size);
+        }
+        len += LZ4_MIN_MATCH;
+        if (d->err || dist == 0 || dist > d->out_pos ||
+            len > size - d->out_pos) {
+            return BOOT_EBADIMAGE;
+        }
+        while (len-- > 0 && rc == 0) {
+            rc = boot_decomp_put(d, boot_decomp_dict_get(d, dist));
+        }
+        if (rc != 0) {
+            return rc;
+        }
+        if (d->err) {
+            return BOOT_EBADIMAGE;
+        }
+    }
+
+    return 0;
+}
+#endif /* MCUBOOT_DECOMPRESS_LZ4 */
+
+#ifdef MCUBOOT_DECOMPRESS_LZMA2
+static inline void
+lzma_rc_normalize(struct boot_decomp *d)
+{
+    if (d->range < LZMA_RC_TOP) {
+        d->range <<= 8;
+        d->code = (d->code << 8) | boot_decomp_in_byte(d);
+    }
+}
+
+static unsigned int
+lzma_rc_bit(struct boot_decomp *d, uint16_t *prob)
+{
+    uint32_t bound;
+
+    lzma_rc_normalize(d);
+    bound = (d->range >> LZMA_PROB_BITS) * *prob;
+    if (d->code < bound) {
+        d->range = bound;
+        *prob += ((1u << LZMA_PROB_BITS) - *prob) >> LZMA_MOVE_BITS;
+        return 0;
+    }
+
+    d->range -= bound;
+    d->code -= bound;
+    *prob -= *prob >> LZMA_MOVE_BITS;
+    return 1;
+}
+
+static uint32_t
+lzma_rc_direct(struct boot_decomp *d, unsigned int count)
+{
+    uint32_t res = 0;
+    uint32_t mask;
+
+    while (count-- > 0) {
+        lzma_rc_normalize(d);
+        d->range >>= 1;
+        d->code -= d->range;
+        mask = 0 - (d->code >> 31);
+        d->code += d->range & mask;
+        res = (res << 1) + (mask + 1);
+    }
+
+    return res;
+}
+
+static unsigned int
+lzma_rc_tree(struct boot_decomp *d, uint16_t *probs, unsigned int bits)
+{
+    unsigned int m = 1;
+    unsigned int i;
+
+    for (i = 0; i < bits; i++) {
+        m = (m << 1) + lzma_rc_bit(d, &probs[m]);
+    }
+
+    return m - (1u << bits);
+}
+
+static unsigned int
+lzma_rc_tree_rev(struct boot_decomp *d, uint16_t *probs, unsigned int bits)
+{
+    unsigned int m = 1;
+    unsigned int sym = 0;
+    unsigned int bit;
+    unsigned int i;
+
+    for (i = 0; i < bits; i++) {
+        bit = lzma_rc_bit(d, &probs[m]);
+        m = (m << 1) + bit;
+        sym |= bit << i;
+    }
+
+    return sym;
+}
+
+static unsigned int
+lzma_len(struct boot_decomp *d, struct lzma_len_probs *l,
+         unsigned int pos_state)
+{
+    if (!lzma_rc_bit(d, &l->choice)) {
+        return lzma_rc_tree(d, l->low[pos_state], LZMA_LEN_LOW_BITS);
+    }
+    if (!lzma_rc_bit(d, &l->choice2)) {
+        return (1 << LZMA_LEN_LOW_BITS) +
+               lzma_rc_tree(d, l->mid[pos_state], LZMA_LEN_MID_BITS);
+    }
+    return (1 << LZMA_LEN_LOW_BITS) + (1 << LZMA_LEN_MID_BITS) +
+           lzma_rc_tree(d, l->high, LZMA_LEN_HIGH_BITS);
+}
+
+static uint32_t
+lzma_dist(struct boot_decomp *d, unsigned int len)
+{
+    struct lzma_probs *p = &d->probs;
+    unsigned int slot;
+    unsigned int bits;
+    uint32_t dist;
+
+    slot = lzma_rc_tree(d, p->dist_slot[(len < LZMA_DIST_STATES) ?
+                                        len : LZMA_DIST_STATES - 1],
+                        LZMA_DIST_SLOT_BITS);
+    if (slot < LZMA_DIST_MODEL_START) {
+        return slot;
+    }
+
+    bits = (slot >> 1) - 1;
+    dist = (2 | (slot & 1)) << bits;
+    if (slot < LZMA_DIST_MODEL_END) {
+        return dist + lzma_rc_tree_rev(d, p->dist_special + dist - slot, bits);
+    }
+
+    dist += lzma_rc_direct(d, bits - LZMA_ALIGN_BITS) << LZMA_ALIGN_BITS;
+    return dist + lzma_rc_tree_rev(d, p->dist_align, LZMA_ALIGN_BITS);
+}
+
+static void
+lzma_reset_state(struct boot_decomp *d)
+{
+    uint16_t *prob = (uint16_t *)&d->probs;
+    size_t count;
+    size_t i;
+
+    count = offsetof(struct lzma_probs, literal) / sizeof(uint16_t) +
+            (LZMA_LIT_SIZE << (d->lc + d->lp));
+    for (i = 0; i < count; i++) {
+        prob[i] = LZMA_PROB_INIT;
+    }
+
+    memset(d->rep, 0, sizeof(d->rep));
+    d->state = 0;
+}
+
+static int
+lzma_literal(struct boot_decomp *d)
+{
+    uint32_t lz_pos = d->out_pos - d->dict_start;
+    uint16_t *probs;
+    unsigned int sym = 1;
+    unsigned int match_byte;
+    unsigned int match_bit;
+    unsigned int bit;
+
+    probs = &d->probs.literal[LZMA_LIT_SIZE *
+                              (((lz_pos & ((1u << d->lp) - 1)) << d->lc) +
+                               (d->prev >> (8 - d->lc)))];
+
+    if (d->state >= LZMA_LIT_STATES) {
+        match_byte = boot_decomp_dict_get(d, d->rep[0] + 1);
+        do {
+            match_bit = (match_byte >> 7) & 1;
+            match_byte <<= 1;
+            bit = lzma_rc_bit(d, &probs[((1 + match_bit) << 8) + sym]);
+            sym = (sym << 1) | bit;
+        } while (match_bit == bit && sym < 0x100);
+    }
+    while (sym < 0x100) {
+        sym = (sym << 1) | lzma_rc_bit(d, &probs[sym]);
+    }
+
+    if (d->state < 4) {
+        d->state = 0;
+    } else if (d->state < 10) {
+        d->state -= 3;
+    } else {
+        d->state -= 6;
+    }
+
+    return boot_decomp_put(d, sym - 0x100);
+}
+
+/*
+ * Decodes an LZMA chunk of `packed' bytes giving `unpacked' bytes.
+ */
+static int
+lzma_chunk(struct boot_decomp *d, uint32_t unpacked, uint32_t packed)
+{
+    struct lzma_probs *p = &d->probs;
+    uint32_t start = d->in_used;
+    uint32_t lz_pos;
+    uint32_t dist;
+    unsigned int pos_state;
+    unsigned int len;
+    unsigned int i;
+    int rc = 0;
+
+    if (boot_decomp_in_byte(d) != 0) {
+        return BOOT_EBADIMAGE;
+    }
+    d->range = UINT32_MAX;
+    d->code = 0;
+    for (i = 0; i < 4; i++) {
+        d->code = (d->code << 8) | boot_decomp_in_byte(d);
+    }
+
+    while (unpacked > 0 && rc == 0 && !d->err) {
+        lz_pos = d->out_pos - d->dict_start;
+        pos_state = lz_pos & ((1u << d->pb) - 1);
+
+        if (!lzma_rc_bit(d, &p->is_match[d->state][pos_state])) {
+            rc = lzma_literal(d);
+            unpacked--;
+            continue;
+        }
+
+        if (lzma_rc_bit(d, &p->is_rep[d->state])) {
+            if (d->rep[0] >= lz_pos) {
+                return BOOT_EBADIMAGE;
+            }
+            if (!lzma_rc_bit(d, &p->is_rep0[d->state])) {
+                if (!lzma_rc_bit(d, &p->is_rep0_long[d->state][pos_state])) {
+                    /* Single byte at the last distance. */
+                    d->state = (d->state < LZMA_LIT_STATES) ? 9 : 11;
+                    rc = boot_decomp_put(d,
+                                         boot_decomp_dict_get(d, d->rep[0] + 1));
+                    unpacked--;
+                    continue;
+                }
+            } else {
+                if (!lzma_rc_bit(d, &p->is_rep1[d->state])) {
+                    dist = d->rep[1];
+                } else {
+                    if (!lzma_rc_bit(d, &p->is_rep2[d->state])) {
+                        dist = d->rep[2];
+                    } else {
+                        dist = d->rep[3];
+                        d->rep[3] = d->rep[2];
+                    }
+                    d->rep[2] = d->rep[1];
+                }
+                d->rep[1] = d->rep[0];
+                d->rep[0] = dist;
+            }
+            len = lzma_len(d, &p->rep_len, pos_state);
+            d->state = (d->state < LZMA_LIT_STATES) ? 8 : 11;
+        } else {
+            d->rep[3] = d->rep[2];
+            d->rep[2] = d->rep[1];
+            d->rep[1] = d->rep[0];
+            len = lzma_len(d, &p->match_len, pos_state);
+            d->state = (d->state < LZMA_LIT_STATES) ? 7 : 10;
+            d->rep[0] = lzma_dist(d, len);
+        }
+
+        /* This also rejects the end marker, which LZMA2 does not use. */
+        len += LZMA_MATCH_LEN_MIN;
+        if (d->rep[0] >= lz_pos || len > unpacked) {
+            return BOOT_EBADIMAGE;
+        }
+
+        unpacked -= len;
+        while (len-- > 0 && rc == 0) {
+            rc = boot_decomp_put(d, boot_decomp_dict_get(d, d->rep[0] + 1));
+        }
+    }
+
+    if (rc != 0) {
+        return rc;
+    }
+
+    /* The encoder flushes the range coder as if it was normalized. */
+    lzma_rc_normalize(d);
+    if (d->err || d->in_used - start != packed || d->code != 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    return 0;
+}
+
+/*
+ * Decodes the LZMA2 stream of the payload, `size' bytes once decompressed.
+ */
+static int
+boot_decomp_lzma2(struct boot_decomp *d, uint32_t size)
+{
+    bool need_dict_reset = true;
+    bool need_props = true;
+    uint32_t unpacked;
+    uint32_t packed;
+    uint8_t control;
+    uint8_t props;
+    int rc;
+
+    for (;;) {
+        control = boot_decomp_in_byte(d);
+        if (d->err) {
+            return BOOT_EBADIMAGE;
+        }
+        if (control == 0x00) {
+            break;
+        }
+
+        if (control >= 0xe0 || control == 0x01) {
+            need_props = true;
+            need_dict_reset = false;
+            d->dict_start = d->out_pos;
+            d->prev = 0;
+        } else if (need_dict_reset) {
+            return BOOT_EBADIMAGE;
+        }
+
+        if (control >= 0x80) {
+            unpacked = ((uint32_t)(control & 0x1f) << 16) + 1;
+            unpacked += (uint32_t)boot_decomp_in_byte(d) << 8;
+            unpacked += boot_decomp_in_byte(d);
+            packed = (uint32_t)boot_decomp_in_byte(d) << 8;
+            packed += boot_decomp_in_byte(d) + 1;
+
+            if (control >= 0xc0) {
+                props = boot_decomp_in_byte(d);
+                if (props >= 9 * 5 * 5) {
+                    return BOOT_EBADIMAGE;
+                }
+                d->lc = props % 9;
+                props /= 9;
+                d->lp = props % 5;
+                d->pb = props / 5;
+                if (d->lc + d->lp > LZMA_LCLP_MAX) {
+                    return BOOT_EBADIMAGE;
+                }
+                need_props = false;
+            } else if (need_props) {
+                return BOOT_EBADIMAGE;
+            }
+            if (control >= 0xa0) {
+                lzma_reset_state(d);
+            }
+
+            if (d->err || unpacked > size - d->out_pos) {
+                return BOOT_EBADIMAGE;
+            }
+            rc = lzma_chunk(d, unpacked, packed);
+        } else {
+            if (control > 0x02) {
+                return BOOT_EBADIMAGE;
+            }
+            unpacked = (uint32_t)boot_decomp_in_byte(d) << 8;
+            unpacked += boot_decomp_in_byte(d) + 1;
+            if (d->err || unpacked > size - d->out_pos) {
+                return BOOT_EBADIMAGE;
+            }
+            rc = 0;
+            while (unpacked-- > 0 && rc == 0 && !d->err) {
+                rc = boot_decomp_put(d, boot_decomp_in_byte(d));
+            }
+        }
+        if (rc != 0) {
+            return rc;
+        }
+        if (d->err) {
+            return BOOT_EBADIMAGE;
+        }
+    }
+
+    return (d->out_pos == size) ? 0 : BOOT_EBADIMAGE;
+}
+#endif /* MCUBOOT_DECOMPRESS_LZMA2 */
+
+/*
+ * Decodes the payload, `size' bytes once decompressed.
+ */
+static int
+boot_decomp_payload(struct boot_decomp *d, const struct image_header *hdr,
+                    uint32_t size)
+{
+    int rc = BOOT_EBADIMAGE;
+
+#ifdef MCUBOOT_DECOMPRESS_LZ4
+    if (hdr->ih_flags & IMAGE_F_COMPRESSED_LZ4) {
+        rc = boot_decomp_lz4(d, size);
+    }
+#endif
+#ifdef MCUBOOT_DECOMPRESS_LZMA2
+    if (hdr->ih_flags & IMAGE_F_COMPRESSED_LZMA2) {
+        /* The two bytes in front of the LZMA2 stream give the dictionary
+         * size and properties, the chunks of the stream hold the properties
+         * anyway and the dictionary is the whole payload.
+         */
+        d->in_off += 2;
+        rc = boot_decomp_lzma2(d, size);
+    }
+#endif
+    if (rc != 0) {
+        return rc;
+    }
+
+    /* The filter leaves the last bytes which can not hold an instruction. */
+    if (d->bcj) {
+        rc = boot_decomp_write(d, d->bcj_buf, d->bcj_len);
+        d->bcj_pos += d->bcj_len;
+        d->bcj_len = 0;
+    }
+
+    return rc;
+}
+
+/*
+ * Writes the TLVs of the decompressed image.
+ */
+static int
+boot_decomp_write_tlvs(struct boot_decomp *d, const struct image_header *hdr,
+                       const struct boot_decomp_tlvs *t)
+{
+    struct image_tlv_iter it;
+    struct image_tlv_info info;
+    uint32_t off;
+    uint16_t len;
+    uint16_t type;
+    int rc;
+
+    if (t->prot_size > 0) {
+        info.it_magic = IMAGE_TLV_PROT_INFO_MAGIC;
+        info.it_tlv_tot = t->prot_size;
+        rc = boot_decomp_write(d, (const uint8_t *)&info, sizeof(info));
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, d->fap_src, IMAGE_TLV_ANY, true);
+    if (rc != 0) {
+        return BOOT_EBADIMAGE;
+    }
+    while ((rc = bootutil_tlv_iter_next(&it, &off, &len, &type)) == 0) {
+        if (!boot_decomp_is_decomp_tlv(type)) {
+            rc = boot_decomp_write_tlv(d, type, len, off);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+    }
+    if (rc < 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    info.it_magic = IMAGE_TLV_INFO_MAGIC;
+    info.it_tlv_tot = t->unprot_size;
+    rc = boot_decomp_write(d, (const uint8_t *)&info, sizeof(info));
+    if (rc != 0) {
+        return rc;
+    }
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, d->fap_src, IMAGE_TLV_ANY, false);
+    if (rc != 0) {
+        return BOOT_EBADIMAGE;
+    }
+    while ((rc = bootutil_tlv_iter_next(&it, &off, &len, &type)) == 0) {
+        if (bootutil_tlv_iter_is_prot(&it, off)) {
+            continue;
+        }
+        if (type == EXPECTED_HASH_TLV) {
+            off = t->sha_off;
+        } else if (boot_decomp_is_sig_tlv(type)) {
+            off = t->sig_off;
+            len = t->sig_len;
+        }
+        rc = boot_decomp_write_tlv(d, type, len, off);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    return (rc < 0) ? BOOT_EBADIMAGE : 0;
+}
+
+int
+boot_decompress_image(int image_index, const struct image_header *hdr,
+                      const struct flash_area *fap_src,
+                      const struct flash_area *fap_dst, uint32_t align,
+                      struct enc_key_data *enc)
+{
+    TARGET_STATIC struct boot_decomp d;
+    struct boot_decomp_tlvs t;
+    struct image_header dhdr;
+    uint8_t expected[IMAGE_HASH_SIZE];
+    uint8_t hash[IMAGE_HASH_SIZE];
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    rc = boot_decomp_read_tlvs(hdr, fap_src, &t);
+    if (rc != 0) {
+        return rc;
+    }
+    if (flash_area_read(fap_src, t.sha_off, expected, sizeof(expected)) != 0) {
+        return BOOT_EFLASH;
+    }
+
+    memset(&d, 0, offsetof(struct boot_decomp, cache));
+    d.fap_src = fap_src;
+    d.fap_dst = fap_dst;
+    d.hdr_size = hdr->ih_hdr_size;
+    d.align = align;
+    d.hash_end = hdr->ih_hdr_size + t.img_size + t.prot_size;
+    d.bcj = (hdr->ih_flags & IMAGE_F_COMPRESSED_ARM_THUMB_FLT) != 0;
+#ifdef MCUBOOT_ENC_IMAGES
+    if (IS_ENCRYPTED(hdr)) {
+        if (enc == NULL) {
+            return BOOT_EBADIMAGE;
+        }
+        d.enc = enc;
+    }
+#else
+    (void)enc;
+#endif
+
+    d.in_off = hdr->ih_hdr_size;
+    d.in_end = hdr->ih_hdr_size + hdr->ih_img_size;
+
+    memcpy(&dhdr, hdr, sizeof(dhdr));
+    dhdr.ih_flags &= ~COMPRESSIONFLAGS;
+    dhdr.ih_img_size = t.img_size;
+    dhdr.ih_protect_tlv_size = t.prot_size;
+
+    bootutil_sha_init(&d.sha);
+
+    BOOT_LOG_INF("Image %d: decompressing %" PRIu32 " bytes to %" PRIu32
+                 " bytes", image_index, hdr->ih_img_size,
+                 t.img_size);
+
+    rc = boot_decomp_write(&d, (const uint8_t *)&dhdr, sizeof(dhdr));
+    if (rc == 0) {
+        rc = boot_decomp_write_from(&d, sizeof(dhdr),
+                                    hdr->ih_hdr_size - sizeof(dhdr));
+    }
+    if (rc == 0) {
+        rc = boot_decomp_payload(&d, hdr, t.img_size);
+    }
+    if (rc == 0) {
+        rc = boot_decomp_write_tlvs(&d, hdr, &t);
+    }
+    if (rc == 0) {
+        rc = boot_decomp_flush(&d, true);
+    }
+    if (rc == 0) {
+        bootutil_sha_finish(&d.sha, hash);
+    }
+    bootutil_sha_drop(&d.sha);
+
+    if (rc != 0) {
+        BOOT_LOG_ERR("Image %d: decompression failed", image_index);
+        return rc;
+    }
+
+    FIH_CALL(boot_fih_memequal, fih_rc, hash, expected, sizeof(hash));
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        BOOT_LOG_ERR("Image %d: decompressed image hash mismatch",
+                     image_index);
+        return BOOT_EBADIMAGE;
+    }
+
+    return 0;
+}
+
+int
+boot_copy_region_decompress(struct boot_loader_state *state,
+                            const struct flash_area *fap_src,
+                            const struct flash_area *fap_dst)
+{
+    const struct image_header *hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
+    struct enc_key_data *enc = NULL;
+
+#ifdef MCUBOOT_ENC_IMAGES
+    /* The key was loaded by boot_copy_image(). */
+    if (IS_ENCRYPTED(hdr)) {
+        enc = BOOT_CURR_ENC(state);
+    }
+#endif
+
+    return boot_decompress_image(BOOT_CURR_IMG(state), hdr, fap_src, fap_dst,
+                                 BOOT_WRITE_SZ(state), enc);
+}
+
+#endif /* MCUBOOT_DECOMPRESS_IMAGES */
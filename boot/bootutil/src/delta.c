@@ -0,0 +1,518 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Delta images: the image in the secondary slot is a signed patch which,
+ * applied to the image in the primary slot, gives the new signed image.
+ *
+ * The patch payload is a list of operations, each starting with a 32-bit
+ * little endian word holding the number of bytes it produces, with
+ * BOOT_DELTA_OP_INSERT set for literal data:
+ *
+ *   COPY:   len, base offset      copies len bytes from the primary slot
+ *   INSERT: len | INSERT, data    copies the len bytes following the word
+ *
+ * With MCUBOOT_DELTA_ARM_THUMB, a COPY with BOOT_DELTA_OP_THUMB set also
+ * moves the Thumb BL instructions it copies: the offset of every BL pair
+ * found by the scan of the ARM Thumb BCJ filter, started at the base offset,
+ * is adjusted so that it branches to the same address from its new place.
+ * Code moved by an added or removed function then still copies from the base
+ * image, instead of every call across it becoming literal data.
+ *
+ * The output of all operations, written from the start of the secondary
+ * slot, is the complete new image (header, payload and TLVs) which then goes
+ * through the normal validation and upgrade.
+ *
+ * To keep the primary slot untouched until the upgrade itself, the patch is
+ * first copied to the end of the secondary slot, just below the trailer
+ * sectors, and the image is rebuilt in front of it. Once the start of the
+ * slot is erased the patch is only found in that staging area; rebuilding
+ * only depends on the primary slot and the staged patch, so it is simply
+ * redone from scratch if interrupted. The staged patch is erased once the
+ * image is rebuilt, its header first.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include "bootutil/bootutil.h"
+#include "bootutil/image.h"
+#include "bootutil/crypto/sha.h"
+#include "bootutil/fault_injection_hardening.h"
+#include "bootutil_priv.h"
+#include "bootutil/bootutil_log.h"
+
+#include "mcuboot_config/mcuboot_config.h"
+
+BOOT_LOG_MODULE_DECLARE(mcuboot);
+
+#ifdef MCUBOOT_DELTA_IMAGES
+
+#if defined(MCUBOOT_DIRECT_XIP) || defined(MCUBOOT_RAM_LOAD) || \
+    defined(MCUBOOT_SWAP_USING_OFFSET)
+#error "MCUBOOT_DELTA_IMAGES requires overwrite-only, swap-scratch or swap-move"
+#endif
+
+#ifdef MCUBOOT_ENC_IMAGES
+#error "MCUBOOT_DELTA_IMAGES is not supported with encrypted images"
+#endif
+
+#define BOOT_DELTA_OP_INSERT 0x80000000
+#ifdef MCUBOOT_DELTA_ARM_THUMB
+#define BOOT_DELTA_OP_THUMB  0x40000000
+#define BOOT_DELTA_OP_LEN    0x3fffffff
+#else
+/* A BOOT_DELTA_OP_THUMB copy is then too large to be valid. */
+#define BOOT_DELTA_OP_LEN    0x7fffffff
+#endif
+
+#if BOOT_MAX_ALIGN > 256
+#define BOOT_DELTA_BUF_SZ    BOOT_MAX_ALIGN
+#else
+#define BOOT_DELTA_BUF_SZ    256
+#endif
+
+#if !defined(__BOOTSIM__)
+#define TARGET_STATIC static
+#else
+#define TARGET_STATIC
+#endif
+
+/*
+ * Returns the full size, TLVs included, of the image whose header is at
+ * offset `off' of the flash area, rounded up to the write alignment.
+ */
+static int
+boot_delta_image_size(const struct flash_area *fap, uint32_t off,
+                      const struct image_header *hdr, uint32_t *size)
+{
+    struct image_tlv_info info;
+    uint32_t tlv_off;
+
+    if (!boot_u32_safe_add(&tlv_off, hdr->ih_hdr_size, hdr->ih_img_size) ||
+        !boot_u32_safe_add(&tlv_off, tlv_off, off) ||
+        tlv_off >= flash_area_get_size(fap)) {
+        return BOOT_EBADIMAGE;
+    }
+    if (hdr->ih_protect_tlv_size != 0) {
+        if (flash_area_read(fap, tlv_off, &info, sizeof(info)) != 0) {
+            return BOOT_EFLASH;
+        }
+        if (info.it_magic != IMAGE_TLV_PROT_INFO_MAGIC ||
+            info.it_tlv_tot != hdr->ih_protect_tlv_size) {
+            return BOOT_EBADIMAGE;
+        }
+        tlv_off += info.it_tlv_tot;
+    }
+
+    if (flash_area_read(fap, tlv_off, &info, sizeof(info)) != 0) {
+        return BOOT_EFLASH;
+    }
+    if (info.it_magic != IMAGE_TLV_INFO_MAGIC) {
+        return BOOT_EBADIMAGE;
+    }
+
+    *size = ALIGN_UP(tlv_off + info.it_tlv_tot - off, flash_area_align(fap));
+    return 0;
+}
+
+/*
+ * Returns the offset of the first trailer sector of the secondary slot, the
+ * patch is staged right below it.
+ */
+static uint32_t
+boot_delta_limit(struct boot_loader_state *state)
+{
+    const struct flash_area *fap = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    size_t i = boot_img_num_sectors(state, BOOT_SECONDARY_SLOT);
+    uint32_t trailer_off;
+
+    trailer_off = flash_area_get_size(fap) -
+                  boot_trailer_sz(BOOT_WRITE_SZ(state));
+    while (i > 0 &&
+           boot_img_sector_off(state, BOOT_SECONDARY_SLOT, i - 1) +
+           boot_img_sector_size(state, BOOT_SECONDARY_SLOT, i - 1) >
+           trailer_off) {
+        i--;
+    }
+
+    return (i > 0) ? boot_img_sector_off(state, BOOT_SECONDARY_SLOT, i) : 0;
+}
+
+/*
+ * Returns the sector aligned offset where a patch of `size' bytes is staged,
+ * or 0 if it does not fit.
+ */
+static uint32_t
+boot_delta_stage_off(struct boot_loader_state *state, uint32_t size)
+{
+    uint32_t limit = boot_delta_limit(state);
+    size_t i;
+
+    if (size >= limit) {
+        return 0;
+    }
+
+    for (i = boot_img_num_sectors(state, BOOT_SECONDARY_SLOT); i > 0; i--) {
+        if (boot_img_sector_off(state, BOOT_SECONDARY_SLOT, i - 1) <=
+            limit - size) {
+            return boot_img_sector_off(state, BOOT_SECONDARY_SLOT, i - 1);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Checks that the patch applies to the image in the primary slot: its
+ * IMAGE_TLV_DELTA_BASE must match the hash TLV of that image.
+ */
+static fih_ret
+boot_delta_check_base(struct boot_loader_state *state)
+{
+    struct image_tlv_iter it;
+    uint8_t base[IMAGE_HASH_SIZE];
+    uint8_t hash[IMAGE_HASH_SIZE];
+    uint32_t off;
+    uint16_t len;
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    rc = bootutil_tlv_iter_begin(&it, boot_img_hdr(state, BOOT_SECONDARY_SLOT),
+                                 BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT),
+                                 IMAGE_TLV_DELTA_BASE, true);
+    if (rc != 0) {
+        FIH_RET(fih_rc);
+    }
+    rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+    if (rc != 0 || len != sizeof(base) ||
+        flash_area_read(BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT), off,
+                        base, sizeof(base)) != 0) {
+        FIH_RET(fih_rc);
+    }
+
+    rc = bootutil_tlv_iter_begin(&it, boot_img_hdr(state, BOOT_PRIMARY_SLOT),
+                                 BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT),
+                                 EXPECTED_HASH_TLV, false);
+    if (rc != 0) {
+        FIH_RET(fih_rc);
+    }
+    rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+    if (rc != 0 || len != sizeof(hash) ||
+        flash_area_read(BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT), off,
+                        hash, sizeof(hash)) != 0) {
+        FIH_RET(fih_rc);
+    }
+
+    FIH_CALL(boot_fih_memequal, fih_rc, base, hash, sizeof(hash));
+    FIH_RET(fih_rc);
+}
+
+/*
+ * Looks for a patch staged by a previous, interrupted, boot.
+ */
+static int
+boot_delta_find_staged(struct boot_loader_state *state, uint32_t *stage_off,
+                       struct image_header *hdr)
+{
+    const struct flash_area *fap = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    uint32_t limit = boot_delta_limit(state);
+    uint32_t size;
+    uint32_t off;
+    size_t i;
+
+    for (i = boot_img_num_sectors(state, BOOT_SECONDARY_SLOT); i > 1; i--) {
+        off = boot_img_sector_off(state, BOOT_SECONDARY_SLOT, i - 1);
+        if (off >= limit) {
+            continue;
+        }
+        if (flash_area_read(fap, off, hdr, sizeof(*hdr)) != 0) {
+            return BOOT_EFLASH;
+        }
+        if (hdr->ih_magic != IMAGE_MAGIC || !(hdr->ih_flags & IMAGE_F_DELTA)) {
+            continue;
+        }
+        if (boot_delta_image_size(fap, off, hdr, &size) == 0 &&
+            boot_delta_stage_off(state, size) == off) {
+            *stage_off = off;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+#ifdef MCUBOOT_DELTA_ARM_THUMB
+/*
+ * Copies `len' bytes from offset `base_off' of the primary slot to offset
+ * `dst' of the secondary slot, adjusting the Thumb BL instructions among
+ * them by the distance they are moved.
+ */
+static int
+boot_delta_copy_thumb(const struct flash_area *fap_pri,
+                      const struct flash_area *fap_sec, uint32_t base_off,
+                      uint32_t dst, uint32_t len)
+{
+    /* Room for the rest of a BL pair starting at the end of the buffer. */
+    TARGET_STATIC uint8_t buf[BOOT_DELTA_BUF_SZ + 3];
+    uint8_t carry[3];
+    uint32_t ncarry = 0;
+    uint32_t scan = 0;
+    uint32_t pos;
+    uint32_t adj;
+    uint32_t bl;
+    uint32_t rd;
+    uint32_t n;
+    uint32_t i;
+
+    if (((base_off ^ dst) & 1) != 0) {
+        return BOOT_EBADIMAGE;
+    }
+    /* Distance in half-words, modulo the 22-bit BL offset. */
+    adj = (base_off - dst) >> 1;
+
+    for (pos = 0; pos < len; pos += n) {
+        n = (len - pos < BOOT_DELTA_BUF_SZ) ? len - pos : BOOT_DELTA_BUF_SZ;
+        rd = (len - pos < n + 3) ? len - pos : n + 3;
+        if (flash_area_read(fap_pri, base_off + pos, buf, rd) != 0) {
+            return BOOT_EFLASH;
+        }
+        /* The start of the buffer may belong to a BL pair already adjusted
+         * at the end of the previous one.
+         */
+        memcpy(buf, carry, ncarry);
+
+        while (scan < pos + n && scan + 4 <= pos + rd) {
+            i = scan - pos;
+            if ((buf[i + 1] & 0xf8) == 0xf0 && (buf[i + 3] & 0xf8) == 0xf8) {
+                bl = ((uint32_t)(buf[i + 1] & 7) << 19) |
+                     ((uint32_t)buf[i] << 11) |
+                     ((uint32_t)(buf[i + 3] & 7) << 8) | buf[i + 2];
+                bl = (bl + adj) & 0x3fffff;
+                buf[i + 1] = 0xf0 | ((bl >> 19) & 7);
+                buf[i] = (bl >> 11) & 0xff;
+                buf[i + 3] = 0xf8 | ((bl >> 8) & 7);
+                buf[i + 2] = bl & 0xff;
+                scan += 4;
+            } else {
+                scan += 2;
+            }
+        }
+
+        ncarry = (scan > pos + n) ? scan - (pos + n) : 0;
+        memcpy(carry, &buf[n], ncarry);
+
+        if (flash_area_write(fap_sec, dst + pos, buf, n) != 0) {
+            return BOOT_EFLASH;
+        }
+    }
+
+    return 0;
+}
+#endif /* MCUBOOT_DELTA_ARM_THUMB */
+
+/*
+ * Rebuilds the new image at the start of the secondary slot from the image
+ * in the primary slot and the patch staged at `stage_off'.
+ */
+static int
+boot_delta_rebuild(struct boot_loader_state *state, uint32_t stage_off,
+                   const struct image_header *hdr)
+{
+    const struct flash_area *fap_pri = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
+    const struct flash_area *fap_sec = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    uint32_t align = flash_area_align(fap_sec);
+    uint32_t off = stage_off + hdr->ih_hdr_size;
+    uint32_t end = off + hdr->ih_img_size;
+    uint32_t dst = 0;
+    uint32_t base_off;
+    uint32_t op;
+    uint32_t len;
+    int rc;
+
+    rc = boot_erase_region(fap_sec, 0, stage_off);
+    if (rc != 0) {
+        return rc;
+    }
+
+    while (off < end) {
+        if (end - off < sizeof(op) ||
+            flash_area_read(fap_sec, off, &op, sizeof(op)) != 0) {
+            return BOOT_EBADIMAGE;
+        }
+        off += sizeof(op);
+
+        len = op & BOOT_DELTA_OP_LEN;
+        if (len == 0 || len % align != 0 || len > stage_off - dst) {
+            return BOOT_EBADIMAGE;
+        }
+
+        if (op & BOOT_DELTA_OP_INSERT) {
+            if (len > end - off) {
+                return BOOT_EBADIMAGE;
+            }
+            rc = boot_copy_region(state, fap_sec, fap_sec, off, dst, len);
+            off += len;
+        } else {
+            if (end - off < sizeof(base_off) ||
+                flash_area_read(fap_sec, off, &base_off,
+                                sizeof(base_off)) != 0) {
+                return BOOT_EBADIMAGE;
+            }
+            off += sizeof(base_off);
+            if (base_off > flash_area_get_size(fap_pri) ||
+                len > flash_area_get_size(fap_pri) - base_off) {
+                return BOOT_EBADIMAGE;
+            }
+#ifdef MCUBOOT_DELTA_ARM_THUMB
+            if (op & BOOT_DELTA_OP_THUMB) {
+                rc = boot_delta_copy_thumb(fap_pri, fap_sec, base_off, dst,
+                                           len);
+            } else
+#endif
+            {
+                rc = boot_copy_region(state, fap_pri, fap_sec, base_off, dst,
+                                      len);
+            }
+        }
+        if (rc != 0) {
+            return rc;
+        }
+        dst += len;
+    }
+
+    return 0;
+}
+
+/*
+ * Erases the staged patch, its header first so that it is not found again
+ * if this is interrupted.
+ */
+static int
+boot_delta_unstage(struct boot_loader_state *state, uint32_t stage_off)
+{
+    const struct flash_area *fap = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    uint32_t limit = boot_delta_limit(state);
+    struct flash_sector sector;
+    int rc;
+
+    rc = flash_area_get_sector(fap, stage_off, &sector);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    rc = boot_erase_region(fap, stage_off, flash_sector_get_size(&sector));
+    if (rc == 0 && stage_off + flash_sector_get_size(&sector) < limit) {
+        rc = boot_erase_region(fap,
+                               stage_off + flash_sector_get_size(&sector),
+                               limit - stage_off -
+                               flash_sector_get_size(&sector));
+    }
+
+    return rc;
+}
+
+int
+boot_delta_apply(struct boot_loader_state *state, struct boot_status *bs)
+{
+    const struct flash_area *fap = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    struct image_header *hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
+    TARGET_STATIC uint8_t tmpbuf[BOOT_TMPBUF_SZ];
+    struct image_header staged;
+    uint32_t stage_off = 0;
+    uint32_t size;
+    bool is_delta;
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    is_delta = (hdr->ih_magic == IMAGE_MAGIC && (hdr->ih_flags & IMAGE_F_DELTA));
+    if (is_delta) {
+        /* This may also be the header of a partially rebuilt image, whose
+         * flags are not written yet; only a valid patch is staged.
+         */
+        FIH_CALL(bootutil_img_validate, fih_rc, NULL, BOOT_CURR_IMG(state),
+                 hdr, fap, tmpbuf, BOOT_TMPBUF_SZ, NULL, 0, NULL);
+    }
+
+    if (is_delta && FIH_EQ(fih_rc, FIH_SUCCESS)) {
+        FIH_CALL(boot_delta_check_base, fih_rc, state);
+        if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+            BOOT_LOG_ERR("Image %d: delta image does not apply to the primary"
+                         " slot", BOOT_CURR_IMG(state));
+            return BOOT_EBADIMAGE;
+        }
+
+        rc = boot_delta_image_size(fap, 0, hdr, &size);
+        if (rc == 0) {
+            stage_off = boot_delta_stage_off(state, size);
+            if (stage_off < size) {
+                BOOT_LOG_ERR("Image %d: no room to stage the delta image",
+                             BOOT_CURR_IMG(state));
+                rc = BOOT_ENOMEM;
+            }
+        }
+        if (rc == 0) {
+            rc = boot_erase_region(fap, stage_off,
+                                   boot_delta_limit(state) - stage_off);
+        }
+        if (rc == 0) {
+            rc = boot_copy_region(state, fap, fap, 0, stage_off, size);
+        }
+        if (rc != 0) {
+            return rc;
+        }
+        memcpy(&staged, hdr, sizeof(staged));
+    } else {
+        rc = boot_delta_find_staged(state, &stage_off, &staged);
+        if (rc != 0) {
+            if (is_delta) {
+                BOOT_LOG_ERR("Image %d: delta image is not valid",
+                             BOOT_CURR_IMG(state));
+                return BOOT_EBADIMAGE;
+            }
+            /* Not a delta image, nothing to do. */
+            return (rc > 0) ? 0 : rc;
+        }
+        BOOT_LOG_INF("Image %d: resuming interrupted delta upgrade",
+                     BOOT_CURR_IMG(state));
+    }
+
+    BOOT_LOG_INF("Image %d: applying delta image to the primary slot",
+                 BOOT_CURR_IMG(state));
+
+    rc = boot_delta_rebuild(state, stage_off, &staged);
+    if (rc == 0) {
+        rc = boot_delta_unstage(state, stage_off);
+    }
+    if (rc != 0) {
+        BOOT_LOG_ERR("Image %d: failed to apply delta image, rc=%d",
+                     BOOT_CURR_IMG(state), rc);
+    }
+
+    /* The secondary slot now holds the rebuilt image, or whatever is left of
+     * it; either way it goes through the normal validation next.
+     */
+    if (boot_read_image_header(state, BOOT_SECONDARY_SLOT, hdr, bs) != 0) {
+        return BOOT_EFLASH;
+    }
+
+    return rc;
+}
+
+#endif /* MCUBOOT_DELTA_IMAGES */
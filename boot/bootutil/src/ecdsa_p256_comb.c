@@ -0,0 +1,238 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * ECDSA P-256 signature verification with precomputed comb tables, on top of
+ * the TinyCrypt field and point arithmetic.
+ *
+ * u1 * G + u2 * Q is computed with the fixed-base comb method: both scalars
+ * are split into 4 blocks of 64 bits and, for each of the 64 bit positions,
+ * the accumulator is doubled once and the table entries selected by the bits
+ * at that position in every block are added. Compared to the generic
+ * Shamir's trick in uECC_verify() this needs 64 instead of 255 doublings.
+ */
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef MCUBOOT_ECDSA_P256_COMB
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <tinycrypt/ecc.h>
+
+#include "bootutil/ecdsa_comb.h"
+
+/* Comb table of the generator, generated by scripts/imgtool/ecdsa_comb.py. */
+static const struct bootutil_ecdsa_comb comb_g = {
+    .points = {
+        {
+            0xd898c296, 0xf4a13945, 0x2deb33a0, 0x77037d81,
+            0x63a440f2, 0xf8bce6e5, 0xe12c4247, 0x6b17d1f2,
+            0x37bf51f5, 0xcbb64068, 0x6b315ece, 0x2bce3357,
+            0x7c0f9e16, 0x8ee7eb4a, 0xfe1a7f9b, 0x4fe342e2,
+        },
+        {
+            0x8e14db63, 0x90e75cb4, 0xad651f7e, 0x29493baa,
+            0x326e25de, 0x8492592e, 0x2811aaa5, 0x0fa822bc,
+            0x5f462ee7, 0xe4112454, 0x50fe82f5, 0x34b1a650,
+            0xb3df188b, 0x6f4ad4bc, 0xf5dba80d, 0xbff44ae8,
+        },
+        {
+            0x097992af, 0x93391ce2, 0x0d35f1fa, 0xe96c98fd,
+            0x95e02789, 0xb257c0de, 0x89d6726f, 0x300a4bbc,
+            0xc08127a0, 0xaa54a291, 0xa9d806a5, 0x5bb1eead,
+            0xff1e3c6f, 0x7f1ddb25, 0xd09b4644, 0x72aac7e0,
+        },
+        {
+            0xd789bd85, 0x57c84fc9, 0xc297eac3, 0xfc35ff7d,
+            0x88c6766e, 0xfb982fd5, 0xeedb5e67, 0x447d739b,
+            0x72e25b32, 0x0c7e33c9, 0xa7fae500, 0x3d349b95,
+            0x3a4aaff7, 0xe12e9d95, 0x834131ee, 0x2d4825ab,
+        },
+        {
+            0x2a1d367f, 0x13949c93, 0x1a0a11b7, 0xef7fbd2b,
+            0xb91dfc60, 0xddc6068b, 0x8a9c72ff, 0xef951932,
+            0x7376d8a8, 0x196035a7, 0x95ca1740, 0x23183b08,
+            0x022c219c, 0xc1ee9807, 0x7dbb2c9b, 0x611e9fc3,
+        },
+        {
+            0x0b57f4bc, 0xcae2b192, 0xc6c9bc36, 0x2936df5e,
+            0xe11238bf, 0x7dea6482, 0x7b51f5d8, 0x55066379,
+            0x348a964c, 0x44ffe216, 0xdbdefbe1, 0x9fb3d576,
+            0x8d9d50e5, 0x0afa4001, 0x8aecb851, 0x15716484,
+        },
+        {
+            0xfc5cde01, 0xe48ecaff, 0x0d715f26, 0x7ccd84e7,
+            0xf43e4391, 0xa2e8f483, 0xb21141ea, 0xeb5d7745,
+            0x731a3479, 0xcac917e2, 0x2844b645, 0x85f22cfe,
+            0x58006cee, 0x0990e6a1, 0xdbecc17b, 0xeafd72eb,
+        },
+        {
+            0x313728be, 0x6cf20ffb, 0xa3c6b94a, 0x96439591,
+            0x44315fc5, 0x2736ff83, 0xa7849276, 0xa6d39677,
+            0xc357f5f4, 0xf2bab833, 0x2284059b, 0x824a920c,
+            0x2d27ecdf, 0x66b8babd, 0x9b0b8816, 0x674f8474,
+        },
+        {
+            0x677c8a3e, 0x2df48c04, 0x0203a56b, 0x74e02f08,
+            0xb8c7fedb, 0x31855f7d, 0x72c9ddad, 0x4e769e76,
+            0xb824bbb0, 0xa4c36165, 0x3b9122a5, 0xfb9ae16f,
+            0x06947281, 0x1ec00572, 0xde830663, 0x42b99082,
+        },
+        {
+            0xdda868b9, 0x6ef95150, 0x9c0ce131, 0xd1f89e79,
+            0x08a1c478, 0x7fdc1ca0, 0x1c6ce04d, 0x78878ef6,
+            0x1fe0d976, 0x9c62b912, 0xbde08d4f, 0x6ace570e,
+            0x12309def, 0xde53142c, 0x7b72c321, 0xb6cb3f5d,
+        },
+        {
+            0xc31a3573, 0x7f991ed2, 0xd54fb496, 0x5b82dd5b,
+            0x812ffcae, 0x595c5220, 0x716b1287, 0x0c88bc4d,
+            0x5f48aca8, 0x3a57bf63, 0xdf2564f3, 0x7c8181f4,
+            0x9c04e6aa, 0x18d1b5b3, 0xf3901dc6, 0xdd5ddea3,
+        },
+        {
+            0x3e72ad0c, 0xe96a79fb, 0x42ba792f, 0x43a0a28c,
+            0x083e49f3, 0xefe0a423, 0x6b317466, 0x68f344af,
+            0x3fb24d4a, 0xcdfe17db, 0x71f5c626, 0x668bfc22,
+            0x24d67ff3, 0x604ed93c, 0xf8540a20, 0x31b9c405,
+        },
+        {
+            0xa2582e7f, 0xd36b4789, 0x4ec39c28, 0x0d1a1014,
+            0xedbad7a0, 0x663c62c3, 0x6f461db9, 0x4052bf4b,
+            0x188d25eb, 0x235a27c3, 0x99bfcc5b, 0xe724f339,
+            0x71d70cc8, 0x862be6bd, 0x90b0fc61, 0xfecf4d51,
+        },
+        {
+            0xa1d4cfac, 0x74346c10, 0x8526a7a4, 0xafdf5cc0,
+            0xf62bff7a, 0x123202a8, 0xc802e41a, 0x1eddbae2,
+            0xd603f844, 0x8fa0af2d, 0x4c701917, 0x36e06b7e,
+            0x73db33a0, 0x0c45f452, 0x560ebcfc, 0x43104d86,
+        },
+        {
+            0x0d1d78e5, 0x9615b511, 0x25c4744b, 0x66b0de32,
+            0x6aaf363a, 0x0a4a46fb, 0x84f7a21c, 0xb48e26b4,
+            0x21a01b2d, 0x06ebb0f6, 0x8b7b0f98, 0xc004e404,
+            0xfed6f668, 0x64131bcd, 0x4d4d3dab, 0xfac01540,
+        },
+    },
+};
+
+/*
+ * Returns the table index selected by bit i of each 64 bit block of u.
+ */
+static unsigned int
+comb_index(const uECC_word_t *u, unsigned int i)
+{
+    unsigned int idx = 0;
+    unsigned int j;
+
+    for (j = 0; j < BOOTUTIL_ECDSA_COMB_TEETH; j++) {
+        if (uECC_vli_testBit(u, j * BOOTUTIL_ECDSA_COMB_SPACING + i)) {
+            idx |= 1 << j;
+        }
+    }
+
+    return idx;
+}
+
+/*
+ * Adds an affine table point to the Jacobian point (rx, ry, z), or loads it
+ * if the accumulator is still the point at infinity.
+ */
+static void
+comb_add(uECC_word_t *rx, uECC_word_t *ry, uECC_word_t *z, bool *started,
+         const uint32_t *point, uECC_Curve curve)
+{
+    uECC_word_t tx[NUM_ECC_WORDS];
+    uECC_word_t ty[NUM_ECC_WORDS];
+    uECC_word_t tz[NUM_ECC_WORDS];
+
+    if (!*started) {
+        uECC_vli_set(rx, (const uECC_word_t *)point, NUM_ECC_WORDS);
+        uECC_vli_set(ry, (const uECC_word_t *)point + NUM_ECC_WORDS,
+                     NUM_ECC_WORDS);
+        uECC_vli_clear(z, NUM_ECC_WORDS);
+        z[0] = 1;
+        *started = true;
+        return;
+    }
+
+    uECC_vli_set(tx, (const uECC_word_t *)point, NUM_ECC_WORDS);
+    uECC_vli_set(ty, (const uECC_word_t *)point + NUM_ECC_WORDS,
+                 NUM_ECC_WORDS);
+    apply_z(tx, ty, z, curve);
+    uECC_vli_modSub(tz, rx, tx, curve->p, NUM_ECC_WORDS); /* Z = x2 - x1 */
+    XYcZ_add(tx, ty, rx, ry, curve);
+    uECC_vli_modMult_fast(z, z, tz, curve);
+}
+
+int
+bootutil_ecdsa_p256_comb_verify(const struct bootutil_ecdsa_comb *comb,
+                                const uint8_t *hash, const uint8_t *sig)
+{
+    uECC_Curve curve = uECC_secp256r1();
+    uECC_word_t r[NUM_ECC_WORDS];
+    uECC_word_t s[NUM_ECC_WORDS];
+    uECC_word_t u1[NUM_ECC_WORDS];
+    uECC_word_t u2[NUM_ECC_WORDS];
+    uECC_word_t z[NUM_ECC_WORDS];
+    uECC_word_t rx[NUM_ECC_WORDS];
+    uECC_word_t ry[NUM_ECC_WORDS];
+    bool started = false;
+    unsigned int idx;
+    int i;
+
+    uECC_vli_bytesToNative(r, sig, NUM_ECC_BYTES);
+    uECC_vli_bytesToNative(s, sig + NUM_ECC_BYTES, NUM_ECC_BYTES);
+
+    /* r, s must not be 0. */
+    if (uECC_vli_isZero(r, NUM_ECC_WORDS) || uECC_vli_isZero(s, NUM_ECC_WORDS)) {
+        return -1;
+    }
+
+    /* r, s must be < n. */
+    if (uECC_vli_cmp_unsafe(curve->n, r, NUM_ECC_WORDS) != 1 ||
+        uECC_vli_cmp_unsafe(curve->n, s, NUM_ECC_WORDS) != 1) {
+        return -1;
+    }
+
+    /* u1 = e / s, u2 = r / s */
+    uECC_vli_modInv(z, s, curve->n, NUM_ECC_WORDS);
+    uECC_vli_bytesToNative(u1, hash, NUM_ECC_BYTES);
+    uECC_vli_modMult(u1, u1, z, curve->n, NUM_ECC_WORDS);
+    uECC_vli_modMult(u2, r, z, curve->n, NUM_ECC_WORDS);
+
+    for (i = BOOTUTIL_ECDSA_COMB_SPACING - 1; i >= 0; i--) {
+        if (started) {
+            curve->double_jacobian(rx, ry, z, curve);
+        }
+
+        idx = comb_index(u1, i);
+        if (idx != 0) {
+            comb_add(rx, ry, z, &started, comb_g.points[idx - 1], curve);
+        }
+
+        idx = comb_index(u2, i);
+        if (idx != 0) {
+            comb_add(rx, ry, z, &started, comb->points[idx - 1], curve);
+        }
+    }
+
+    /* u2 is not zero, so at least one point has been added. */
+    uECC_vli_modInv(z, z, curve->p, NUM_ECC_WORDS);
+    apply_z(rx, ry, z, curve);
+
+    /* v = x1 (mod n) */
+    if (uECC_vli_cmp_unsafe(curve->n, rx, NUM_ECC_WORDS) != 1) {
+        uECC_vli_sub(rx, rx, curve->n, NUM_ECC_WORDS);
+    }
+
+    /* Accept only if v == r. */
+    return uECC_vli_equal(rx, r, NUM_ECC_WORDS) != 0;
+}
+
+#endif /* MCUBOOT_ECDSA_P256_COMB */
@@ -32,9 +32,11 @@
 #if defined(MCUBOOT_ENCRYPT_EC256) || defined(MCUBOOT_ENCRYPT_X25519)
 #include "bootutil/crypto/sha.h"
 #include "bootutil/crypto/hmac_sha256.h"
+#if defined(MCUBOOT_ENCRYPT_EC256) || !defined(MCUBOOT_CURVE25519_FIXED_DER)
 #include "mbedtls/oid.h"
 #include "mbedtls/asn1.h"
 #endif
+#endif
 
 #include "bootutil/image.h"
 #include "bootutil/enc_key.h"
@@ -42,6 +44,16 @@
 #include "bootutil/crypto/common.h"
 
 #include "bootutil_priv.h"
+#include "crypto_arena.h"
+
+/* Counter blocks encrypted at once by boot_enc_encrypt/boot_enc_decrypt. */
+#ifndef MCUBOOT_ENC_KEYSTREAM_BLOCKS
+#define MCUBOOT_ENC_KEYSTREAM_BLOCKS 8
+#endif
+
+#if MCUBOOT_ENC_KEYSTREAM_BLOCKS < 1
+#error "MCUBOOT_ENC_KEYSTREAM_BLOCKS must be at least 1"
+#endif
 
 #if defined(MCUBOOT_ENCRYPT_EC256) || defined(MCUBOOT_ENCRYPT_X25519)
 #if defined(_compare)
@@ -170,13 +182,39 @@ parse_ec256_enckey(uint8_t **p, uint8_t *end, uint8_t *private_key)
 #endif /* defined(MCUBOOT_ENCRYPT_EC256) */
 
 #if defined(MCUBOOT_ENCRYPT_X25519)
+#define SHARED_KEY_LEN 32
+#define PRIV_KEY_LEN   32
+
+#if defined(MCUBOOT_CURVE25519_FIXED_DER)
+/*
+ * DER encoding of an X25519 PKCS#8 private key (RFC 8410), up to the key
+ * itself. Its length is fixed, so a key is matched against it instead of
+ * being parsed.
+ */
+static const uint8_t x25519_privkey_prefix[] = {
+    0x30, 0x2e, 0x02, 0x01, 0x00, 0x30, 0x05, 0x06,
+    0x03, 0x2b, 0x65, 0x6e, 0x04, 0x22, 0x04, 0x20,
+};
+
+static int
+parse_x25519_enckey(uint8_t **p, uint8_t *end, uint8_t *private_key)
+{
+    if (end - *p != sizeof(x25519_privkey_prefix) + PRIV_KEY_LEN) {
+        return -1;
+    }
+
+    if (memcmp(*p, x25519_privkey_prefix, sizeof(x25519_privkey_prefix))) {
+        return -2;
+    }
+
+    memcpy(private_key, *p + sizeof(x25519_privkey_prefix), PRIV_KEY_LEN);
+    return 0;
+}
+#else
 #define X25519_OID "\x6e"
 static const uint8_t ec_pubkey_oid[] = MBEDTLS_OID_ISO_IDENTIFIED_ORG \
                                        MBEDTLS_OID_ORG_GOV X25519_OID;
 
-#define SHARED_KEY_LEN 32
-#define PRIV_KEY_LEN   32
-
 static int
 parse_x25519_enckey(uint8_t **p, uint8_t *end, uint8_t *private_key)
 {
@@ -223,6 +261,7 @@ parse_x25519_enckey(uint8_t **p, uint8_t *end, uint8_t *private_key)
     memcpy(private_key, *p, PRIV_KEY_LEN);
     return 0;
 }
+#endif /* MCUBOOT_CURVE25519_FIXED_DER */
 #endif /* defined(MCUBOOT_ENCRYPT_X25519) */
 
 #if defined(MCUBOOT_ENCRYPT_EC256) || defined(MCUBOOT_ENCRYPT_X25519)
@@ -433,20 +472,20 @@ int
 boot_decrypt_key(const uint8_t *buf, uint8_t *enckey)
 {
 #if defined(MCUBOOT_ENCRYPT_RSA)
-    bootutil_rsa_context rsa;
+    BOOT_CRYPTO_CTX(bootutil_rsa_context, rsa);
     uint8_t *cp;
     uint8_t *cpend;
     size_t olen;
 #endif
 #if defined(MCUBOOT_ENCRYPT_EC256)
-    bootutil_ecdh_p256_context ecdh_p256;
+    BOOT_CRYPTO_CTX(bootutil_ecdh_p256_context, ecdh_p256);
 #endif
 #if defined(MCUBOOT_ENCRYPT_X25519)
-    bootutil_ecdh_x25519_context ecdh_x25519;
+    BOOT_CRYPTO_CTX(bootutil_ecdh_x25519_context, ecdh_x25519);
 #endif
 #if defined(MCUBOOT_ENCRYPT_EC256) || defined(MCUBOOT_ENCRYPT_X25519)
-    bootutil_hmac_sha256_context hmac;
-    bootutil_aes_ctr_context aes_ctr;
+    BOOT_CRYPTO_CTX(bootutil_hmac_sha256_context, hmac);
+    BOOT_CRYPTO_CTX(bootutil_aes_ctr_context, aes_ctr);
     uint8_t tag[BOOTUTIL_CRYPTO_SHA256_DIGEST_SIZE];
     uint8_t shared[SHARED_KEY_LEN];
     uint8_t derived_key[BOOTUTIL_CRYPTO_AES_CTR_KEY_SIZE + BOOTUTIL_CRYPTO_SHA256_DIGEST_SIZE];
@@ -470,19 +509,19 @@ boot_decrypt_key(const uint8_t *buf, uint8_t *enckey)
 
 #if defined(MCUBOOT_ENCRYPT_RSA)
 
-    bootutil_rsa_init(&rsa);
+    bootutil_rsa_init(rsa);
     cp = (uint8_t *)bootutil_enc_key->key;
     cpend = cp + *bootutil_enc_key->len;
 
     /* The enckey is encrypted through RSA so for decryption we need the private key */
-    rc = bootutil_rsa_parse_private_key(&rsa, &cp, cpend);
+    rc = bootutil_rsa_parse_private_key(rsa, &cp, cpend);
     if (rc) {
-        bootutil_rsa_drop(&rsa);
+        bootutil_rsa_drop(rsa);
         return rc;
     }
 
-    rc = bootutil_rsa_oaep_decrypt(&rsa, &olen, buf, enckey, BOOT_ENC_KEY_SIZE);
-    bootutil_rsa_drop(&rsa);
+    rc = bootutil_rsa_oaep_decrypt(rsa, &olen, buf, enckey, BOOT_ENC_KEY_SIZE);
+    bootutil_rsa_drop(rsa);
     if (rc) {
         return rc;
     }
@@ -513,10 +552,10 @@ boot_decrypt_key(const uint8_t *buf, uint8_t *enckey)
     /*
      * First "element" in the TLV is the curve point (public key)
      */
-    bootutil_ecdh_p256_init(&ecdh_p256);
+    bootutil_ecdh_p256_init(ecdh_p256);
 
-    rc = bootutil_ecdh_p256_shared_secret(&ecdh_p256, &buf[EC_PUBK_INDEX], private_key, shared);
-    bootutil_ecdh_p256_drop(&ecdh_p256);
+    rc = bootutil_ecdh_p256_shared_secret(ecdh_p256, &buf[EC_PUBK_INDEX], private_key, shared);
+    bootutil_ecdh_p256_drop(ecdh_p256);
     if (rc != 0) {
         return -1;
     }
@@ -541,10 +580,10 @@ boot_decrypt_key(const uint8_t *buf, uint8_t *enckey)
      * First "element" in the TLV is the curve point (public key)
      */
 
-    bootutil_ecdh_x25519_init(&ecdh_x25519);
+    bootutil_ecdh_x25519_init(ecdh_x25519);
 
-    rc = bootutil_ecdh_x25519_shared_secret(&ecdh_x25519, &buf[EC_PUBK_INDEX], private_key, shared);
-    bootutil_ecdh_x25519_drop(&ecdh_x25519);
+    rc = bootutil_ecdh_x25519_shared_secret(ecdh_x25519, &buf[EC_PUBK_INDEX], private_key, shared);
+    bootutil_ecdh_x25519_drop(ecdh_x25519);
     if (!rc) {
         return -1;
     }
@@ -568,58 +607,58 @@ boot_decrypt_key(const uint8_t *buf, uint8_t *enckey)
      * HMAC the key and check that our received MAC matches the generated tag
      */
 
-    bootutil_hmac_sha256_init(&hmac);
+    bootutil_hmac_sha256_init(hmac);
 
-    rc = bootutil_hmac_sha256_set_key(&hmac, &derived_key[BOOT_ENC_KEY_SIZE], 32);
+    rc = bootutil_hmac_sha256_set_key(hmac, &derived_key[BOOT_ENC_KEY_SIZE], 32);
     if (rc != 0) {
-        (void)bootutil_hmac_sha256_drop(&hmac);
+        (void)bootutil_hmac_sha256_drop(hmac);
         return -1;
     }
 
-    rc = bootutil_hmac_sha256_update(&hmac, &buf[EC_CIPHERKEY_INDEX], BOOT_ENC_KEY_SIZE);
+    rc = bootutil_hmac_sha256_update(hmac, &buf[EC_CIPHERKEY_INDEX], BOOT_ENC_KEY_SIZE);
     if (rc != 0) {
-        (void)bootutil_hmac_sha256_drop(&hmac);
+        (void)bootutil_hmac_sha256_drop(hmac);
         return -1;
     }
 
     /* Assumes the tag buffer is at least sizeof(hmac_tag_size(state)) bytes */
-    rc = bootutil_hmac_sha256_finish(&hmac, tag, BOOTUTIL_CRYPTO_SHA256_DIGEST_SIZE);
+    rc = bootutil_hmac_sha256_finish(hmac, tag, BOOTUTIL_CRYPTO_SHA256_DIGEST_SIZE);
     if (rc != 0) {
-        (void)bootutil_hmac_sha256_drop(&hmac);
+        (void)bootutil_hmac_sha256_drop(hmac);
         return -1;
     }
 
     if (bootutil_constant_time_compare(tag, &buf[EC_TAG_INDEX], 32) != 0) {
-        (void)bootutil_hmac_sha256_drop(&hmac);
+        (void)bootutil_hmac_sha256_drop(hmac);
         return -1;
     }
 
-    bootutil_hmac_sha256_drop(&hmac);
+    bootutil_hmac_sha256_drop(hmac);
 
     /*
      * Finally decrypt the received ciphered key
      */
 
-    bootutil_aes_ctr_init(&aes_ctr);
+    bootutil_aes_ctr_init(aes_ctr);
     if (rc != 0) {
-        bootutil_aes_ctr_drop(&aes_ctr);
+        bootutil_aes_ctr_drop(aes_ctr);
         return -1;
     }
 
-    rc = bootutil_aes_ctr_set_key(&aes_ctr, derived_key);
+    rc = bootutil_aes_ctr_set_key(aes_ctr, derived_key);
     if (rc != 0) {
-        bootutil_aes_ctr_drop(&aes_ctr);
+        bootutil_aes_ctr_drop(aes_ctr);
         return -1;
     }
 
     memset(counter, 0, BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE);
-    rc = bootutil_aes_ctr_decrypt(&aes_ctr, counter, &buf[EC_CIPHERKEY_INDEX], BOOTUTIL_CRYPTO_AES_CTR_KEY_SIZE, 0, enckey);
+    rc = bootutil_aes_ctr_decrypt(aes_ctr, counter, &buf[EC_CIPHERKEY_INDEX], BOOTUTIL_CRYPTO_AES_CTR_KEY_SIZE, 0, enckey);
     if (rc != 0) {
-        bootutil_aes_ctr_drop(&aes_ctr);
+        bootutil_aes_ctr_drop(aes_ctr);
         return -1;
     }
 
-    bootutil_aes_ctr_drop(&aes_ctr);
+    bootutil_aes_ctr_drop(aes_ctr);
 
     rc = 0;
 
@@ -678,7 +717,11 @@ boot_enc_load(struct enc_key_data *enc_state, int slot,
         return -1;
     }
 
-    return boot_decrypt_key(buf, bs->enckey[slot]);
+    boot_phase_start(BOOT_PHASE_KEY);
+    rc = boot_decrypt_key(buf, bs->enckey[slot]);
+    boot_phase_stop(BOOT_PHASE_KEY);
+
+    return rc;
 }
 
 bool
@@ -687,51 +730,301 @@ boot_enc_valid(struct enc_key_data *enc_state, int slot)
     return enc_state[slot].valid;
 }
 
-void
-boot_enc_encrypt(struct enc_key_data *enc_state, int slot, uint32_t off,
-             uint32_t sz, uint32_t blk_off, uint8_t *buf)
+/*
+ * XORs `len' bytes of keystream into `buf', a word at a time.
+ */
+static void
+boot_enc_xor(uint8_t *buf, const uint8_t *ks, uint32_t len)
+{
+    uint32_t a;
+    uint32_t b;
+
+    while (len >= sizeof(a)) {
+        memcpy(&a, buf, sizeof(a));
+        memcpy(&b, ks, sizeof(b));
+        a ^= b;
+        memcpy(buf, &a, sizeof(a));
+        buf += sizeof(a);
+        ks += sizeof(a);
+        len -= sizeof(a);
+    }
+    while (len-- > 0) {
+        *buf++ ^= *ks++;
+    }
+}
+
+/*
+ * Encrypts or decrypts, which is the same in CTR mode, `sz' bytes at offset
+ * `off' of the payload. The keystream is generated MCUBOOT_ENC_KEYSTREAM_BLOCKS
+ * counter blocks at a time; `blk_off' bytes of the first block are skipped.
+ */
+static void
+boot_enc_crypt(struct enc_key_data *enc, uint32_t off, uint32_t sz,
+               uint32_t blk_off, uint8_t *buf)
 {
-    struct enc_key_data *enc = &enc_state[slot];
-    uint8_t nonce[16];
+    uint8_t ks[MCUBOOT_ENC_KEYSTREAM_BLOCKS * BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE]
+        __attribute__((aligned(4)));
+    uint8_t counter[BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE];
+    uint32_t blocks;
+    uint32_t len;
+    int rc;
 
     /* Nothing to do with size == 0 */
     if (sz == 0) {
        return;
     }
 
-    memset(nonce, 0, 12);
+    memset(counter, 0, 12);
     off >>= 4;
-    nonce[12] = (uint8_t)(off >> 24);
-    nonce[13] = (uint8_t)(off >> 16);
-    nonce[14] = (uint8_t)(off >> 8);
-    nonce[15] = (uint8_t)off;
+#ifdef MCUBOOT_ENC_GCM
+    /* GCM encrypts the payload from counter block 2 on, block 1 being used
+     * for the tag.
+     */
+    off += 2;
+#endif
+    counter[12] = (uint8_t)(off >> 24);
+    counter[13] = (uint8_t)(off >> 16);
+    counter[14] = (uint8_t)(off >> 8);
+    counter[15] = (uint8_t)off;
 
     assert(enc->valid == 1);
-    bootutil_aes_ctr_encrypt(&enc->aes_ctr, nonce, buf, sz, blk_off, buf);
+    while (sz > 0) {
+        blocks = (blk_off + sz + BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE - 1) /
+                 BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE;
+        if (blocks > MCUBOOT_ENC_KEYSTREAM_BLOCKS) {
+            blocks = MCUBOOT_ENC_KEYSTREAM_BLOCKS;
+        }
+        rc = bootutil_aes_ctr_keystream(&enc->aes_ctr, counter, ks, blocks);
+        assert(rc == 0);
+        (void)rc;
+
+        len = blocks * BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE - blk_off;
+        if (len > sz) {
+            len = sz;
+        }
+        boot_enc_xor(buf, ks + blk_off, len);
+        buf += len;
+        sz -= len;
+        blk_off = 0;
+    }
+
+    memset(ks, 0, sizeof(ks));
+}
+
+void
+boot_enc_encrypt(struct enc_key_data *enc_state, int slot, uint32_t off,
+             uint32_t sz, uint32_t blk_off, uint8_t *buf)
+{
+    boot_enc_crypt(&enc_state[slot], off, sz, blk_off, buf);
 }
 
 void
 boot_enc_decrypt(struct enc_key_data *enc_state, int slot, uint32_t off,
              uint32_t sz, uint32_t blk_off, uint8_t *buf)
 {
-    struct enc_key_data *enc = &enc_state[slot];
-    uint8_t nonce[16];
+    boot_enc_crypt(&enc_state[slot], off, sz, blk_off, buf);
+}
 
-    /* Nothing to do with size == 0 */
-    if (sz == 0) {
-       return;
+#ifdef MCUBOOT_ENC_GCM
+/*
+ * Reduction of the 4 bits shifted out of the GHASH state, for 4-bit table
+ * multiplication in GF(2^128) (Shoup's method, as in the GCM specification).
+ */
+static const uint16_t boot_enc_gcm_last4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+};
+
+static uint64_t
+boot_enc_gcm_get_be64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        v = (v << 8) | p[i];
     }
+    return v;
+}
 
-    memset(nonce, 0, 12);
-    off >>= 4;
-    nonce[12] = (uint8_t)(off >> 24);
-    nonce[13] = (uint8_t)(off >> 16);
-    nonce[14] = (uint8_t)(off >> 8);
-    nonce[15] = (uint8_t)off;
+static void
+boot_enc_gcm_put_be64(uint8_t *p, uint64_t v)
+{
+    int i;
 
-    assert(enc->valid == 1);
-    bootutil_aes_ctr_decrypt(&enc->aes_ctr, nonce, buf, sz, blk_off, buf);
+    for (i = 7; i >= 0; i--) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+/*
+ * Fills the tables of the products of the hash key `h' by all 4-bit values.
+ */
+static void
+boot_enc_gcm_table(struct boot_enc_gcm *gcm, const uint8_t *h)
+{
+    uint64_t vh;
+    uint64_t vl;
+    uint32_t t;
+    int i;
+    int j;
+
+    vh = boot_enc_gcm_get_be64(h);
+    vl = boot_enc_gcm_get_be64(h + 8);
+
+    gcm->hh[0] = 0;
+    gcm->hl[0] = 0;
+    gcm->hh[8] = vh;
+    gcm->hl[8] = vl;
+    for (i = 4; i > 0; i >>= 1) {
+        t = (uint32_t)(vl & 1) * 0xe1000000U;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ ((uint64_t)t << 32);
+        gcm->hh[i] = vh;
+        gcm->hl[i] = vl;
+    }
+    for (i = 2; i <= 8; i *= 2) {
+        for (j = 1; j < i; j++) {
+            gcm->hh[i + j] = gcm->hh[i] ^ gcm->hh[j];
+            gcm->hl[i + j] = gcm->hl[i] ^ gcm->hl[j];
+        }
+    }
+}
+
+/*
+ * Multiplies the GHASH state by the hash key.
+ */
+static void
+boot_enc_gcm_mult(struct boot_enc_gcm *gcm)
+{
+    uint64_t zh;
+    uint64_t zl;
+    uint8_t lo;
+    uint8_t hi;
+    uint8_t rem;
+    int i;
+
+    lo = gcm->y[15] & 0xf;
+    zh = gcm->hh[lo];
+    zl = gcm->hl[lo];
+    for (i = 15; i >= 0; i--) {
+        lo = gcm->y[i] & 0xf;
+        hi = gcm->y[i] >> 4;
+        if (i != 15) {
+            rem = (uint8_t)(zl & 0xf);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ ((uint64_t)boot_enc_gcm_last4[rem] << 48);
+            zh ^= gcm->hh[lo];
+            zl ^= gcm->hl[lo];
+        }
+        rem = (uint8_t)(zl & 0xf);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ ((uint64_t)boot_enc_gcm_last4[rem] << 48);
+        zh ^= gcm->hh[hi];
+        zl ^= gcm->hl[hi];
+    }
+    boot_enc_gcm_put_be64(gcm->y, zh);
+    boot_enc_gcm_put_be64(gcm->y + 8, zl);
+}
+
+/*
+ * Starts the computation of the GCM tag of the payload encrypted with the key
+ * of `slot'. The IV is all zeroes, like the nonce of AES-CTR payloads: image
+ * keys are random and never used for another image.
+ */
+int
+boot_enc_gcm_start(struct enc_key_data *enc_state, int slot,
+                   struct boot_enc_gcm *gcm)
+{
+    uint8_t counter[BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE];
+    uint8_t h[BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE];
+    int rc;
+
+    assert(enc_state[slot].valid == 1);
+    memset(gcm, 0, sizeof(*gcm));
+
+    /* The hash key is the encryption of the zero block, and the tag is
+     * masked with that of the following one, the initial counter block J0.
+     */
+    memset(counter, 0, sizeof(counter));
+    rc = bootutil_aes_ctr_keystream(&enc_state[slot].aes_ctr, counter, h, 1);
+    if (rc == 0) {
+        rc = bootutil_aes_ctr_keystream(&enc_state[slot].aes_ctr, counter,
+                                        gcm->ek0, 1);
+    }
+    if (rc == 0) {
+        boot_enc_gcm_table(gcm, h);
+    }
+    memset(h, 0, sizeof(h));
+
+    return rc;
+}
+
+/*
+ * Feeds `len' bytes of encrypted payload into the tag computation.
+ */
+void
+boot_enc_gcm_update(struct boot_enc_gcm *gcm, const uint8_t *buf, uint32_t len)
+{
+    uint32_t pos;
+
+    pos = gcm->len & 0xf;
+    gcm->len += len;
+    while (len-- > 0) {
+        gcm->y[pos++] ^= *buf++;
+        if (pos == sizeof(gcm->y)) {
+            boot_enc_gcm_mult(gcm);
+            pos = 0;
+        }
+    }
+}
+
+/*
+ * Completes the tag computation and compares the tag with that of the
+ * IMAGE_TLV_ENC_GCM_TAG TLV. The state is cleared in any case.
+ */
+fih_ret
+boot_enc_gcm_verify(struct boot_enc_gcm *gcm, const struct image_header *hdr,
+                    const struct flash_area *fap)
+{
+    struct image_tlv_iter it;
+    uint8_t tag[sizeof(gcm->y)];
+    uint32_t off;
+    uint16_t len;
+    int rc;
+    int i;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    if (gcm->len & 0xf) {
+        boot_enc_gcm_mult(gcm);
+    }
+
+    /* Length block: no additional data, then the payload size in bits. */
+    boot_enc_gcm_put_be64(tag, (uint64_t)gcm->len * 8);
+    for (i = 0; i < 8; i++) {
+        gcm->y[8 + i] ^= tag[i];
+    }
+    boot_enc_gcm_mult(gcm);
+    for (i = 0; i < (int)sizeof(gcm->y); i++) {
+        gcm->y[i] ^= gcm->ek0[i];
+    }
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_ENC_GCM_TAG, false);
+    if (rc == 0) {
+        rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+    }
+    if (rc == 0 && len == sizeof(tag)) {
+        rc = LOAD_IMAGE_DATA(hdr, fap, off, tag, sizeof(tag));
+        if (rc == 0) {
+            FIH_CALL(boot_fih_memequal, fih_rc, gcm->y, tag, sizeof(tag));
+        }
+    }
+
+    memset(gcm, 0, sizeof(*gcm));
+    FIH_RET(fih_rc);
 }
+#endif /* MCUBOOT_ENC_GCM */
 
 /**
  * Clears encrypted state after use.
@@ -6,7 +6,7 @@
 
 #include "bootutil/fault_injection_hardening.h"
 
-#ifdef FIH_ENABLE_DELAY
+#if defined(FIH_ENABLE_DELAY) && !defined(MCUBOOT_FIH_DELAY_RNG_PLATFORM)
 
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/entropy.h"
@@ -21,9 +21,20 @@
 #error "FIH_ENABLE_DELAY requires an entropy source"
 #endif /* MBEDTLS_NO_DEFAULT_ENTROPY_SOURCES */
 
+/* Number of delays drawn from the DRBG at once. Each DRBG call ends with an
+ * update of its state, which costs more AES operations than generating a
+ * block, so the delays are not requested one byte at a time.
+ */
+#ifndef MCUBOOT_FIH_DELAY_POOL_SIZE
+#define MCUBOOT_FIH_DELAY_POOL_SIZE 64
+#endif
+
 mbedtls_entropy_context fih_entropy_ctx;
 mbedtls_ctr_drbg_context fih_drbg_ctx;
 
+static unsigned char fih_delay_pool[MCUBOOT_FIH_DELAY_POOL_SIZE];
+static size_t fih_delay_pool_used = MCUBOOT_FIH_DELAY_POOL_SIZE;
+
 int fih_delay_init(void)
 {
     mbedtls_entropy_init(&fih_entropy_ctx);
@@ -36,12 +47,15 @@ int fih_delay_init(void)
 
 unsigned char fih_delay_random_uchar(void)
 {
-    unsigned char delay;
-
-    mbedtls_ctr_drbg_random(&fih_drbg_ctx,(unsigned char*) &delay,
-                            sizeof(delay));
-
-    return delay;
+    if (fih_delay_pool_used >= sizeof(fih_delay_pool)) {
+        if (mbedtls_ctr_drbg_random(&fih_drbg_ctx, fih_delay_pool,
+                                    sizeof(fih_delay_pool)) != 0) {
+            FIH_PANIC;
+        }
+        fih_delay_pool_used = 0;
+    }
+
+    return fih_delay_pool[fih_delay_pool_used++];
 }
 
-#endif /* FIH_ENABLE_DELAY */
+#endif /* FIH_ENABLE_DELAY && !MCUBOOT_FIH_DELAY_RNG_PLATFORM */
@@ -0,0 +1,135 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef MCUBOOT_FLASH_STATS
+
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include "bootutil/flash_stats.h"
+#include "bootutil/bootutil_log.h"
+
+BOOT_LOG_MODULE_DECLARE(mcuboot);
+
+static struct flash_stats_area flash_stats[MCUBOOT_FLASH_STATS_AREAS];
+static int flash_stats_cnt;
+
+static struct flash_stats_area *
+flash_stats_find(uint8_t fa_id)
+{
+    int i;
+
+    for (i = 0; i < flash_stats_cnt; i++) {
+        if (flash_stats[i].fa_id == fa_id) {
+            return &flash_stats[i];
+        }
+    }
+
+    if (flash_stats_cnt == MCUBOOT_FLASH_STATS_AREAS) {
+        return NULL;
+    }
+
+    flash_stats[flash_stats_cnt].fa_id = fa_id;
+    return &flash_stats[flash_stats_cnt++];
+}
+
+void
+flash_stats_record(uint8_t fa_id, enum flash_stats_op op, uint32_t len,
+                   uint32_t usecs, int rc)
+{
+    struct flash_stats_area *area;
+    struct flash_stats_counters *cnt;
+    uint32_t limit;
+    int bucket;
+
+    area = flash_stats_find(fa_id);
+    if (area == NULL || op >= FLASH_STATS_OP_COUNT) {
+        return;
+    }
+
+    cnt = &area->op[op];
+    cnt->ops++;
+    if (rc != 0) {
+        cnt->errors++;
+        return;
+    }
+    cnt->bytes += len;
+
+    limit = 16;
+    for (bucket = 0; bucket < FLASH_STATS_BUCKETS - 1; bucket++) {
+        if (usecs < limit) {
+            break;
+        }
+        limit <<= 2;
+    }
+
+    if (cnt->latency[bucket] < UINT16_MAX) {
+        cnt->latency[bucket]++;
+    }
+}
+
+const struct flash_stats_area *
+flash_stats_get(int idx)
+{
+    if (idx < 0 || idx >= flash_stats_cnt) {
+        return NULL;
+    }
+
+    return &flash_stats[idx];
+}
+
+void
+flash_stats_reset(void)
+{
+    memset(flash_stats, 0, sizeof(flash_stats));
+    flash_stats_cnt = 0;
+}
+
+void
+flash_stats_log(void)
+{
+    static const char *const op_names[FLASH_STATS_OP_COUNT] = {
+        "read", "write", "erase",
+    };
+    const struct flash_stats_counters *cnt;
+    int i;
+    int op;
+
+    for (i = 0; i < flash_stats_cnt; i++) {
+        for (op = 0; op < FLASH_STATS_OP_COUNT; op++) {
+            cnt = &flash_stats[i].op[op];
+            if (cnt->ops == 0) {
+                continue;
+            }
+
+            BOOT_LOG_INF("Flash area %d %s: %" PRIu32 " ops, %" PRIu32
+                         " bytes, %" PRIu32 " errors, latency %u/%u/%u/%u/"
+                         "%u/%u/%u/%u", flash_stats[i].fa_id, op_names[op],
+                         cnt->ops, cnt->bytes, cnt->errors,
+                         cnt->latency[0], cnt->latency[1], cnt->latency[2],
+                         cnt->latency[3], cnt->latency[4], cnt->latency[5],
+                         cnt->latency[6], cnt->latency[7]);
+        }
+    }
+}
+
+#endif /* MCUBOOT_FLASH_STATS */
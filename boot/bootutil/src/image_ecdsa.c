@@ -34,35 +34,133 @@
 #include "bootutil_priv.h"
 #include "bootutil/fault_injection_hardening.h"
 #include "bootutil/crypto/ecdsa.h"
+#include "crypto_arena.h"
+
+#ifdef MCUBOOT_ECDSA_P256_COMB
+#if !defined(MCUBOOT_USE_TINYCRYPT) || !defined(MCUBOOT_SIGN_EC256) || \
+    defined(MCUBOOT_BUILTIN_KEY) || defined(MCUBOOT_HW_KEY)
+#error "MCUBOOT_ECDSA_P256_COMB requires TinyCrypt, P-256 and built-in keys"
+#endif
+#include "bootutil/ecdsa_comb.h"
+
+/*
+ * Verify a signature using the precomputed comb table of a key.
+ */
+static fih_ret
+bootutil_verify_sig_comb(uint8_t *hash, uint32_t hlen, uint8_t *sig,
+                         size_t slen, const struct bootutil_ecdsa_comb *comb)
+{
+    uint8_t signature[2 * NUM_ECC_BYTES];
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    if (hlen != BOOTUTIL_CRYPTO_ECDSA_P256_HASH_SIZE) {
+        FIH_RET(fih_rc);
+    }
+
+    rc = bootutil_decode_sig(signature, sig, sig + slen);
+    if (rc) {
+        FIH_RET(fih_rc);
+    }
+
+    rc = bootutil_ecdsa_p256_comb_verify(comb, hash, signature);
+    fih_rc = fih_ret_encode_zero_equality(rc);
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        FIH_SET(fih_rc, FIH_FAILURE);
+    }
+
+    FIH_RET(fih_rc);
+}
+#endif /* MCUBOOT_ECDSA_P256_COMB */
 
 #if !defined(MCUBOOT_BUILTIN_KEY)
+#ifdef MCUBOOT_KEY_CONTEXT_CACHE
+/* Parsed (or imported) keys, kept until the end of the boot. */
+BOOT_CACHE_STATIC struct {
+    bool valid;
+    bootutil_ecdsa_context ctx;
+    uint8_t *pubkey;
+} key_ctx_cache[MCUBOOT_KEY_CONTEXT_CACHE_SIZE];
+
+static fih_ret
+bootutil_verify_sig_cached(uint8_t *hash, uint32_t hlen, uint8_t *sig,
+                           size_t slen, uint8_t key_id)
+{
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+    uint8_t *pubkey;
+    uint8_t *end;
+
+    end = (uint8_t *)bootutil_keys[key_id].key + *bootutil_keys[key_id].len;
+
+    if (!key_ctx_cache[key_id].valid) {
+        pubkey = (uint8_t *)bootutil_keys[key_id].key;
+        bootutil_ecdsa_init(&key_ctx_cache[key_id].ctx);
+        rc = bootutil_ecdsa_parse_public_key(&key_ctx_cache[key_id].ctx,
+                                             &pubkey, end);
+        if (rc) {
+            bootutil_ecdsa_drop(&key_ctx_cache[key_id].ctx);
+            FIH_RET(fih_rc);
+        }
+        key_ctx_cache[key_id].pubkey = pubkey;
+        key_ctx_cache[key_id].valid = true;
+    }
+
+    pubkey = key_ctx_cache[key_id].pubkey;
+    rc = bootutil_ecdsa_verify(&key_ctx_cache[key_id].ctx, pubkey,
+                               end - pubkey, hash, hlen, sig, slen);
+    fih_rc = fih_ret_encode_zero_equality(rc);
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        FIH_SET(fih_rc, FIH_FAILURE);
+    }
+
+    FIH_RET(fih_rc);
+}
+#endif /* MCUBOOT_KEY_CONTEXT_CACHE */
+
 fih_ret
 bootutil_verify_sig(uint8_t *hash, uint32_t hlen, uint8_t *sig, size_t slen,
                     uint8_t key_id)
 {
     int rc;
-    bootutil_ecdsa_context ctx;
+    BOOT_CRYPTO_CTX(bootutil_ecdsa_context, ctx);
     FIH_DECLARE(fih_rc, FIH_FAILURE);
     uint8_t *pubkey;
     uint8_t *end;
 
+#ifdef MCUBOOT_ECDSA_P256_COMB
+    if (bootutil_keys[key_id].comb != NULL) {
+        FIH_CALL(bootutil_verify_sig_comb, fih_rc, hash, hlen, sig, slen,
+                 bootutil_keys[key_id].comb);
+        FIH_RET(fih_rc);
+    }
+#endif
+
+#ifdef MCUBOOT_KEY_CONTEXT_CACHE
+    if (key_id < MCUBOOT_KEY_CONTEXT_CACHE_SIZE) {
+        FIH_CALL(bootutil_verify_sig_cached, fih_rc, hash, hlen, sig, slen,
+                 key_id);
+        FIH_RET(fih_rc);
+    }
+#endif
+
     pubkey = (uint8_t *)bootutil_keys[key_id].key;
     end = pubkey + *bootutil_keys[key_id].len;
-    bootutil_ecdsa_init(&ctx);
+    bootutil_ecdsa_init(ctx);
 
-    rc = bootutil_ecdsa_parse_public_key(&ctx, &pubkey, end);
+    rc = bootutil_ecdsa_parse_public_key(ctx, &pubkey, end);
     if (rc) {
         goto out;
     }
 
-    rc = bootutil_ecdsa_verify(&ctx, pubkey, end-pubkey, hash, hlen, sig, slen);
+    rc = bootutil_ecdsa_verify(ctx, pubkey, end-pubkey, hash, hlen, sig, slen);
     fih_rc = fih_ret_encode_zero_equality(rc);
     if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
         FIH_SET(fih_rc, FIH_FAILURE);
     }
 
 out:
-    bootutil_ecdsa_drop(&ctx);
+    bootutil_ecdsa_drop(ctx);
 
     FIH_RET(fih_rc);
 }
@@ -12,20 +12,62 @@
 #ifdef MCUBOOT_SIGN_ED25519
 #include "bootutil/sign_key.h"
 
+#ifndef MCUBOOT_CURVE25519_FIXED_DER
 #include "mbedtls/oid.h"
 #include "mbedtls/asn1.h"
+#endif
 
 #include "bootutil_priv.h"
 #include "bootutil/crypto/common.h"
 #include "bootutil/crypto/sha.h"
 
-static const uint8_t ed25519_pubkey_oid[] = MBEDTLS_OID_ISO_IDENTIFIED_ORG "\x65\x70";
 #define NUM_ED25519_BYTES 32
 
 extern int ED25519_verify(const uint8_t *message, size_t message_len,
                           const uint8_t signature[64],
                           const uint8_t public_key[32]);
 
+#ifdef MCUBOOT_KEY_CONTEXT_CACHE
+/* Size, in 32-bit words, of a public key decoded into a curve point. */
+#define ED25519_DECODED_KEY_WORDS 48
+
+extern int ED25519_decode_public_key(uint32_t decoded[ED25519_DECODED_KEY_WORDS],
+                                     const uint8_t public_key[32]);
+extern int ED25519_verify_decoded(const uint8_t *message, size_t message_len,
+                                  const uint8_t signature[64],
+                                  const uint32_t decoded[ED25519_DECODED_KEY_WORDS]);
+#endif
+
+#ifdef MCUBOOT_CURVE25519_FIXED_DER
+/*
+ * DER encoding of an Ed25519 SubjectPublicKeyInfo (RFC 8410), up to the key
+ * itself. Its length is fixed, so a key is matched against it instead of
+ * being parsed.
+ */
+static const uint8_t ed25519_pubkey_prefix[] = {
+    0x30, 0x2a, 0x30, 0x05, 0x06, 0x03, 0x2b, 0x65,
+    0x70, 0x03, 0x21, 0x00,
+};
+
+/*
+ * Check the public key used for signing.
+ */
+static int
+bootutil_import_key(uint8_t **cp, uint8_t *end)
+{
+    if (end - *cp != sizeof(ed25519_pubkey_prefix) + NUM_ED25519_BYTES) {
+        return -1;
+    }
+    if (memcmp(*cp, ed25519_pubkey_prefix, sizeof(ed25519_pubkey_prefix))) {
+        return -2;
+    }
+    *cp += sizeof(ed25519_pubkey_prefix);
+
+    return 0;
+}
+#else
+static const uint8_t ed25519_pubkey_oid[] = MBEDTLS_OID_ISO_IDENTIFIED_ORG "\x65\x70";
+
 /*
  * Parse the public key used for signing.
  */
@@ -64,6 +106,18 @@ bootutil_import_key(uint8_t **cp, uint8_t *end)
 
     return 0;
 }
+#endif /* MCUBOOT_CURVE25519_FIXED_DER */
+
+#ifdef MCUBOOT_KEY_CONTEXT_CACHE
+/* Public keys decoded into curve points, kept until the end of the boot, so
+ * that the point decompression (a field exponentiation) is done once per key
+ * rather than once per signature.
+ */
+BOOT_CACHE_STATIC struct {
+    bool valid;
+    uint32_t decoded[ED25519_DECODED_KEY_WORDS];
+} key_ctx_cache[MCUBOOT_KEY_CONTEXT_CACHE_SIZE];
+#endif
 
 fih_ret
 bootutil_verify_sig(uint8_t *hash, uint32_t hlen, uint8_t *sig, size_t slen,
@@ -79,17 +133,35 @@ bootutil_verify_sig(uint8_t *hash, uint32_t hlen, uint8_t *sig, size_t slen,
         goto out;
     }
 
-    pubkey = (uint8_t *)bootutil_keys[key_id].key;
-    end = pubkey + *bootutil_keys[key_id].len;
-
-    rc = bootutil_import_key(&pubkey, end);
-    if (rc) {
-        FIH_SET(fih_rc, FIH_FAILURE);
-        goto out;
+#ifdef MCUBOOT_KEY_CONTEXT_CACHE
+    if (key_id < MCUBOOT_KEY_CONTEXT_CACHE_SIZE &&
+        key_ctx_cache[key_id].valid) {
+        rc = ED25519_verify_decoded(hash, IMAGE_HASH_SIZE, sig,
+                                    key_ctx_cache[key_id].decoded);
+    } else
+#endif
+    {
+        pubkey = (uint8_t *)bootutil_keys[key_id].key;
+        end = pubkey + *bootutil_keys[key_id].len;
+
+        rc = bootutil_import_key(&pubkey, end);
+        if (rc) {
+            FIH_SET(fih_rc, FIH_FAILURE);
+            goto out;
+        }
+#ifdef MCUBOOT_KEY_CONTEXT_CACHE
+        if (key_id < MCUBOOT_KEY_CONTEXT_CACHE_SIZE &&
+            ED25519_decode_public_key(key_ctx_cache[key_id].decoded, pubkey)) {
+            key_ctx_cache[key_id].valid = true;
+            rc = ED25519_verify_decoded(hash, IMAGE_HASH_SIZE, sig,
+                                        key_ctx_cache[key_id].decoded);
+        } else
+#endif
+        {
+            rc = ED25519_verify(hash, IMAGE_HASH_SIZE, sig, pubkey);
+        }
     }
 
-    rc = ED25519_verify(hash, IMAGE_HASH_SIZE, sig, pubkey);
-
     if (rc == 0) {
         /* if verify returns 0, there was an error. */
         FIH_SET(fih_rc, FIH_FAILURE);
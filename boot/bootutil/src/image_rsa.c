@@ -36,6 +36,19 @@
 
 #define BOOTUTIL_CRYPTO_RSA_SIGN_ENABLED
 #include "bootutil/crypto/rsa.h"
+#include "crypto_arena.h"
+
+#if defined(MCUBOOT_BUILTIN_KEY) && !defined(MCUBOOT_USE_PSA_CRYPTO)
+#error "MCUBOOT_BUILTIN_KEY requires PSA Crypto for RSA signatures"
+#endif
+
+#ifdef MCUBOOT_RSA_MONT
+#if defined(MCUBOOT_USE_PSA_CRYPTO) || defined(MCUBOOT_HW_KEY) || \
+    defined(MCUBOOT_BUILTIN_KEY)
+#error "MCUBOOT_RSA_MONT requires Mbed TLS and built-in keys"
+#endif
+#include "bootutil/rsa_mont.h"
+#endif
 
 /* PSA Crypto APIs provide an integrated API to perform the verification
  * while for other crypto backends we need to implement each step at this
@@ -113,36 +126,19 @@ pss_mgf1(uint8_t *mask, const uint8_t *hash)
 }
 
 /*
- * Validate an RSA signature, using RSA-PSS, as described in PKCS #1
- * v2.2, section 9.1.2, with many parameters required to have fixed
- * values. RSASSA-PSS-VERIFY RFC8017 section 8.1.2
+ * Check the encoded message em = sig^E mod N of an RSA-PSS signature, as
+ * described in PKCS #1 v2.2, section 9.1.2, with many parameters required
+ * to have fixed values.
  */
 static fih_ret
-bootutil_cmp_rsasig(bootutil_rsa_context *ctx, uint8_t *hash, uint32_t hlen,
-  uint8_t *sig, size_t slen)
+bootutil_cmp_pss_em(const uint8_t *em, uint8_t *hash)
 {
     bootutil_sha_context shactx;
-    uint8_t em[MBEDTLS_MPI_MAX_SIZE];
     uint8_t db_mask[PSS_MASK_LEN];
     uint8_t h2[PSS_HLEN];
     int i;
     FIH_DECLARE(fih_rc, FIH_FAILURE);
 
-    /* The caller has already verified that slen == bootutil_rsa_get_len(ctx) */
-    if (slen != PSS_EMLEN ||
-        PSS_EMLEN > MBEDTLS_MPI_MAX_SIZE) {
-        goto out;
-    }
-
-    if (hlen != PSS_HLEN) {
-        goto out;
-    }
-
-    /* Apply RSAVP1 to produce em = sig^E mod N using the public key */
-    if (bootutil_rsa_public(ctx, sig, em)) {
-        goto out;
-    }
-
     /*
      * PKCS #1 v2.2, 9.1.2 EMSA-PSS-Verify
      *
@@ -157,8 +153,8 @@ bootutil_cmp_rsasig(bootutil_rsa_context *ctx, uint8_t *hash, uint32_t hlen,
      * SHA-256.
      */
 
-    /* Step 2.  mHash is passed in as 'hash', with hLen the hlen
-     * argument. */
+    /* Step 2.  mHash is passed in as 'hash', the caller has checked
+     * that hLen is PSS_HLEN. */
 
     /* Step 3.  if emLen < hLen + sLen + 2, inconsistent and stop.
      * The salt length is not known at this point.
@@ -236,6 +232,66 @@ out:
     FIH_RET(fih_rc);
 }
 
+/*
+ * Validate an RSA signature, using RSA-PSS, as described in PKCS #1
+ * v2.2, section 9.1.2, with many parameters required to have fixed
+ * values. RSASSA-PSS-VERIFY RFC8017 section 8.1.2
+ */
+static fih_ret
+bootutil_cmp_rsasig(bootutil_rsa_context *ctx, uint8_t *hash, uint32_t hlen,
+  uint8_t *sig, size_t slen)
+{
+    uint8_t em[MBEDTLS_MPI_MAX_SIZE];
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    /* The caller has already verified that slen == bootutil_rsa_get_len(ctx) */
+    if (slen != PSS_EMLEN ||
+        PSS_EMLEN > MBEDTLS_MPI_MAX_SIZE) {
+        goto out;
+    }
+
+    if (hlen != PSS_HLEN) {
+        goto out;
+    }
+
+    /* Apply RSAVP1 to produce em = sig^E mod N using the public key */
+    if (bootutil_rsa_public(ctx, sig, em)) {
+        goto out;
+    }
+
+    FIH_CALL(bootutil_cmp_pss_em, fih_rc, em, hash);
+
+out:
+    FIH_RET(fih_rc);
+}
+
+#ifdef MCUBOOT_RSA_MONT
+/*
+ * Validate an RSA-PSS signature using the precomputed Montgomery constants
+ * of a key, which leave the key unparsed and E fixed to 65537.
+ */
+static fih_ret
+bootutil_cmp_rsasig_mont(const struct bootutil_rsa_mont *mont, uint8_t *hash,
+                         uint32_t hlen, uint8_t *sig, size_t slen)
+{
+    uint8_t em[PSS_EMLEN];
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    if (slen != PSS_EMLEN || hlen != PSS_HLEN) {
+        goto out;
+    }
+
+    if (bootutil_rsa_mont_public(mont, sig, em)) {
+        goto out;
+    }
+
+    FIH_CALL(bootutil_cmp_pss_em, fih_rc, em, hash);
+
+out:
+    FIH_RET(fih_rc);
+}
+#endif /* MCUBOOT_RSA_MONT */
+
 #else /* MCUBOOT_USE_PSA_CRYPTO */
 
 static fih_ret
@@ -258,31 +314,105 @@ bootutil_cmp_rsasig(bootutil_rsa_context *ctx, uint8_t *hash, uint32_t hlen,
 
 #endif /* MCUBOOT_USE_PSA_CRYPTO */
 
+#if !defined(MCUBOOT_BUILTIN_KEY)
+#ifdef MCUBOOT_KEY_CONTEXT_CACHE
+/* Parsed keys, kept until the end of the boot. */
+BOOT_CACHE_STATIC struct {
+    bool valid;
+    bootutil_rsa_context ctx;
+} key_ctx_cache[MCUBOOT_KEY_CONTEXT_CACHE_SIZE];
+
+static fih_ret
+bootutil_verify_sig_cached(uint8_t *hash, uint32_t hlen, uint8_t *sig,
+                           size_t slen, uint8_t key_id)
+{
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+    uint8_t *cp;
+    uint8_t *end;
+
+    if (!key_ctx_cache[key_id].valid) {
+        cp = (uint8_t *)bootutil_keys[key_id].key;
+        end = cp + *bootutil_keys[key_id].len;
+        bootutil_rsa_init(&key_ctx_cache[key_id].ctx);
+        rc = bootutil_rsa_parse_public_key(&key_ctx_cache[key_id].ctx,
+                                           &cp, end);
+        if (rc) {
+            bootutil_rsa_drop(&key_ctx_cache[key_id].ctx);
+            FIH_RET(fih_rc);
+        }
+        key_ctx_cache[key_id].valid = true;
+    }
+
+    if (slen != bootutil_rsa_get_len(&key_ctx_cache[key_id].ctx)) {
+        FIH_RET(fih_rc);
+    }
+    FIH_CALL(bootutil_cmp_rsasig, fih_rc, &key_ctx_cache[key_id].ctx, hash,
+             hlen, sig, slen);
+
+    FIH_RET(fih_rc);
+}
+#endif /* MCUBOOT_KEY_CONTEXT_CACHE */
+
 fih_ret
 bootutil_verify_sig(uint8_t *hash, uint32_t hlen, uint8_t *sig, size_t slen,
   uint8_t key_id)
 {
-    bootutil_rsa_context ctx;
+    BOOT_CRYPTO_CTX(bootutil_rsa_context, ctx);
     int rc;
     FIH_DECLARE(fih_rc, FIH_FAILURE);
     uint8_t *cp;
     uint8_t *end;
 
-    bootutil_rsa_init(&ctx);
+#ifdef MCUBOOT_RSA_MONT
+    if (bootutil_keys[key_id].mont != NULL) {
+        FIH_CALL(bootutil_cmp_rsasig_mont, fih_rc, bootutil_keys[key_id].mont,
+                 hash, hlen, sig, slen);
+        FIH_RET(fih_rc);
+    }
+#endif
+
+#ifdef MCUBOOT_KEY_CONTEXT_CACHE
+    if (key_id < MCUBOOT_KEY_CONTEXT_CACHE_SIZE) {
+        FIH_CALL(bootutil_verify_sig_cached, fih_rc, hash, hlen, sig, slen,
+                 key_id);
+        FIH_RET(fih_rc);
+    }
+#endif
+
+    bootutil_rsa_init(ctx);
 
     cp = (uint8_t *)bootutil_keys[key_id].key;
     end = cp + *bootutil_keys[key_id].len;
 
     /* The key used for signature verification is a public RSA key */
-    rc = bootutil_rsa_parse_public_key(&ctx, &cp, end);
-    if (rc || slen != bootutil_rsa_get_len(&ctx)) {
+    rc = bootutil_rsa_parse_public_key(ctx, &cp, end);
+    if (rc || slen != bootutil_rsa_get_len(ctx)) {
         goto out;
     }
-    FIH_CALL(bootutil_cmp_rsasig, fih_rc, &ctx, hash, hlen, sig, slen);
+    FIH_CALL(bootutil_cmp_rsasig, fih_rc, ctx, hash, hlen, sig, slen);
 
 out:
-    bootutil_rsa_drop(&ctx);
+    bootutil_rsa_drop(ctx);
+
+    FIH_RET(fih_rc);
+}
+#else /* !MCUBOOT_BUILTIN_KEY */
+fih_ret
+bootutil_verify_sig(uint8_t *hash, uint32_t hlen, uint8_t *sig, size_t slen,
+  uint8_t key_id)
+{
+    bootutil_rsa_context ctx;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    /* Use the builtin key for image verification, no key import is
+     * required. The key is owned by the key store, so it is not destroyed
+     * afterwards, and the crypto library checks slen against its size.
+     */
+    ctx.key_id = MCUBOOT_BUILTIN_KEY_ID(key_id);
+    FIH_CALL(bootutil_cmp_rsasig, fih_rc, &ctx, hash, hlen, sig, slen);
 
     FIH_RET(fih_rc);
 }
+#endif /* MCUBOOT_BUILTIN_KEY */
 #endif /* MCUBOOT_SIGN_RSA */
@@ -55,19 +55,280 @@
 #endif
 
 #include "bootutil_priv.h"
+#include "crypto_arena.h"
+
+#if (defined(MCUBOOT_HASH_MMAP_FLASH) || defined(MCUBOOT_FLASH_AREA_MMAP)) && \
+    !defined(MCUBOOT_RAM_LOAD)
+/* Largest amount of memory-mapped flash passed in a single hash update. */
+#ifndef MCUBOOT_HASH_MMAP_BLK_SZ
+#define MCUBOOT_HASH_MMAP_BLK_SZ 0x10000
+#endif
+#endif
+
+#if defined(MCUBOOT_HASH_PIPELINE) && !defined(MCUBOOT_RAM_LOAD)
+#ifndef MCUBOOT_HASH_PIPELINE_BUF_SIZE
+#define MCUBOOT_HASH_PIPELINE_BUF_SIZE 1024
+#endif
+
+#if !defined(__BOOTSIM__)
+#define HASH_PIPELINE_STATIC static
+#else
+#define HASH_PIPELINE_STATIC
+#endif
+
+/*
+ * Size of the next block to be hashed, starting at off. When encrypted images
+ * are supported a block never straddles the header/payload or payload/TLV
+ * boundaries, as only the payload needs decrypting.
+ */
+static uint32_t
+bootutil_img_hash_blk_sz(uint32_t off, uint32_t size, uint32_t buf_sz,
+                         uint32_t hdr_size, uint32_t tlv_off)
+{
+    uint32_t blk_sz;
+
+    blk_sz = size - off;
+    if (blk_sz > buf_sz) {
+        blk_sz = buf_sz;
+    }
+#ifdef MCUBOOT_ENC_IMAGES
+    if ((off < hdr_size) && ((off + blk_sz) > hdr_size)) {
+        blk_sz = hdr_size - off;
+    }
+    if ((off < tlv_off) && ((off + blk_sz) > tlv_off)) {
+        blk_sz = tlv_off - off;
+    }
+#else
+    (void)hdr_size;
+    (void)tlv_off;
+#endif
+
+    return blk_sz;
+}
+
+/*
+ * Start reading a block into dst. Without an asynchronous flash backend the
+ * read completes before this returns, and the pipeline degrades to the plain
+ * sequential read-then-hash loop.
+ */
+static inline int
+bootutil_img_hash_read_start(const struct flash_area *fap, uint32_t off,
+                             void *dst, uint32_t len)
+{
+#ifdef MCUBOOT_FLASH_AREA_READ_ASYNC
+    return flash_area_read_async(fap, off, dst, len);
+#else
+    return flash_area_read(fap, off, dst, len);
+#endif
+}
+
+static inline int
+bootutil_img_hash_read_wait(const struct flash_area *fap)
+{
+#ifdef MCUBOOT_FLASH_AREA_READ_ASYNC
+    return flash_area_read_wait(fap);
+#else
+    (void)fap;
+    return 0;
+#endif
+}
+#endif /* MCUBOOT_HASH_PIPELINE && !MCUBOOT_RAM_LOAD */
+
+#ifdef MCUBOOT_HASH_CHUNKS
+/*
+ * Feed size bytes of the image starting at off into the hash context.
+ */
+static int
+bootutil_img_hash_region(bootutil_sha_context *sha_ctx,
+                         struct image_header *hdr,
+                         const struct flash_area *fap, uint32_t off,
+                         uint32_t size, uint8_t *tmp_buf, uint32_t tmp_buf_sz)
+{
+#ifdef MCUBOOT_RAM_LOAD
+    (void)fap;
+    (void)tmp_buf;
+    (void)tmp_buf_sz;
+
+    bootutil_sha_update(sha_ctx,
+                        (void*)(IMAGE_RAM_BASE + hdr->ih_load_addr + off),
+                        size);
+#else
+    uint32_t start_off = BOOT_IMG_START_OFF(fap);
+    uint32_t end = off + size;
+    uint32_t blk_sz;
+    int rc;
+
+    (void)hdr;
+
+    for (; off < end; off += blk_sz) {
+        blk_sz = end - off;
+        if (blk_sz > tmp_buf_sz) {
+            blk_sz = tmp_buf_sz;
+        }
+        rc = flash_area_read(fap, start_off + off, tmp_buf, blk_sz);
+        if (rc) {
+            return rc;
+        }
+        bootutil_sha_update(sha_ctx, tmp_buf, blk_sz);
+        boot_watchdog_feed(blk_sz);
+    }
+#endif
+
+    return 0;
+}
+
+/*
+ * Compute the hash of an image using a chunk table: only the header and the
+ * protected TLVs are hashed, the payload being covered by the chunk digests
+ * held in the protected IMAGE_TLV_HASH_CHUNKS TLV.
+ */
+static int
+bootutil_img_hash_chunked(struct image_header *hdr,
+                          const struct flash_area *fap, uint8_t *tmp_buf,
+                          uint32_t tmp_buf_sz, uint8_t *hash_result,
+                          uint8_t *seed, int seed_len)
+{
+    bootutil_sha_context sha_ctx;
+    int rc;
+
+    /* Chunk digests are computed over the plain payload. */
+    if (IS_ENCRYPTED(hdr)) {
+        return -1;
+    }
+
+    bootutil_sha_init(&sha_ctx);
+
+    if (seed && (seed_len > 0)) {
+        bootutil_sha_update(&sha_ctx, seed, seed_len);
+    }
+
+    rc = bootutil_img_hash_region(&sha_ctx, hdr, fap, 0, hdr->ih_hdr_size,
+                                  tmp_buf, tmp_buf_sz);
+    if (rc == 0) {
+        rc = bootutil_img_hash_region(&sha_ctx, hdr, fap,
+                                      hdr->ih_hdr_size + hdr->ih_img_size,
+                                      hdr->ih_protect_tlv_size,
+                                      tmp_buf, tmp_buf_sz);
+    }
+    if (rc) {
+        bootutil_sha_drop(&sha_ctx);
+        return rc;
+    }
+
+    bootutil_sha_finish(&sha_ctx, hash_result);
+    bootutil_sha_drop(&sha_ctx);
+
+    return 0;
+}
+
+/*
+ * Check every payload chunk against its digest in the chunk table. The table
+ * is part of the protected TLVs, so this must only be relied upon once the
+ * image hash and signature have been verified.
+ */
+static fih_ret
+bootutil_img_check_chunks(struct image_header *hdr,
+                          const struct flash_area *fap, uint8_t *tmp_buf,
+                          uint32_t tmp_buf_sz)
+{
+    bootutil_sha_context sha_ctx;
+    struct image_tlv_iter it;
+    uint8_t digest[IMAGE_HASH_SIZE];
+    uint8_t expected[IMAGE_HASH_SIZE];
+    uint32_t chunk_sz;
+    uint32_t chunk_cnt;
+    uint32_t blk_sz;
+    uint32_t off;
+    uint32_t i;
+    uint16_t len;
+    int rc;
+#ifdef MCUBOOT_RAM_LOAD_STAGED
+    uint32_t stage_end;
+#endif
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_HASH_CHUNKS, true);
+    if (rc) {
+        FIH_RET(fih_rc);
+    }
+
+    rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+    if (rc != 0 || len < sizeof(chunk_sz)) {
+        FIH_RET(fih_rc);
+    }
+
+    rc = LOAD_IMAGE_DATA(hdr, fap, off, &chunk_sz, sizeof(chunk_sz));
+    if (rc || chunk_sz == 0) {
+        FIH_RET(fih_rc);
+    }
+
+    chunk_cnt = hdr->ih_img_size / chunk_sz +
+                ((hdr->ih_img_size % chunk_sz) != 0);
+    if ((len - sizeof(chunk_sz)) / IMAGE_HASH_SIZE != chunk_cnt ||
+        (len - sizeof(chunk_sz)) % IMAGE_HASH_SIZE != 0) {
+        FIH_RET(fih_rc);
+    }
+    off += sizeof(chunk_sz);
+
+#ifdef MCUBOOT_RAM_LOAD_STAGED
+    /* Only the chunks of the first stage have been loaded to RAM, the
+     * following ones are checked by boot_ram_load_range() when the
+     * application loads them.
+     */
+    rc = boot_ram_load_stage_end((const uint8_t *)(IMAGE_RAM_BASE +
+                                                   hdr->ih_load_addr),
+                                 &stage_end);
+    if (rc != 0) {
+        FIH_RET(fih_rc);
+    }
+    chunk_cnt = stage_end / chunk_sz + ((stage_end % chunk_sz) != 0);
+#endif
+
+    for (i = 0; i < chunk_cnt; i++) {
+        blk_sz = hdr->ih_img_size - i * chunk_sz;
+        if (blk_sz > chunk_sz) {
+            blk_sz = chunk_sz;
+        }
+
+        bootutil_sha_init(&sha_ctx);
+        rc = bootutil_img_hash_region(&sha_ctx, hdr, fap,
+                                      hdr->ih_hdr_size + i * chunk_sz, blk_sz,
+                                      tmp_buf, tmp_buf_sz);
+        if (rc) {
+            bootutil_sha_drop(&sha_ctx);
+            FIH_RET(FIH_FAILURE);
+        }
+        bootutil_sha_finish(&sha_ctx, digest);
+        bootutil_sha_drop(&sha_ctx);
+
+        rc = LOAD_IMAGE_DATA(hdr, fap, off + i * IMAGE_HASH_SIZE, expected,
+                             IMAGE_HASH_SIZE);
+        if (rc) {
+            FIH_RET(FIH_FAILURE);
+        }
+
+        FIH_CALL(boot_fih_memequal, fih_rc, digest, expected, IMAGE_HASH_SIZE);
+        if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+            FIH_RET(FIH_FAILURE);
+        }
+    }
+
+    FIH_RET(fih_rc);
+}
+#endif /* MCUBOOT_HASH_CHUNKS */
 
 /*
  * Compute SHA hash over the image.
  * (SHA384 if ECDSA-P384 is being used,
  *  SHA256 otherwise).
  */
-static int
+int
 bootutil_img_hash(struct enc_key_data *enc_state, int image_index,
                   struct image_header *hdr, const struct flash_area *fap,
                   uint8_t *tmp_buf, uint32_t tmp_buf_sz, uint8_t *hash_result,
                   uint8_t *seed, int seed_len)
 {
-    bootutil_sha_context sha_ctx;
+    BOOT_CRYPTO_CTX(bootutil_sha_context, sha_ctx);
     uint32_t blk_sz;
     uint32_t size;
     uint16_t hdr_size;
@@ -75,6 +336,24 @@ bootutil_img_hash(struct enc_key_data *enc_state, int image_index,
     int rc;
     uint32_t blk_off;
     uint32_t tlv_off;
+#ifndef MCUBOOT_RAM_LOAD
+    uint32_t start_off;
+#endif
+#if defined(MCUBOOT_ENC_GCM) && !defined(MCUBOOT_RAM_LOAD)
+    struct boot_enc_gcm gcm;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+#endif
+#if defined(MCUBOOT_HASH_PIPELINE) && !defined(MCUBOOT_RAM_LOAD)
+    HASH_PIPELINE_STATIC uint8_t pipe_buf[2][MCUBOOT_HASH_PIPELINE_BUF_SIZE]
+        __attribute__((aligned(4)));
+    uint32_t next_off;
+    uint32_t next_sz;
+    uint8_t *cur_buf;
+    int cur;
+
+    (void)tmp_buf;
+    (void)tmp_buf_sz;
+#endif
 
 #if (BOOT_IMAGE_NUMBER == 1) || !defined(MCUBOOT_ENC_IMAGES) || \
     defined(MCUBOOT_RAM_LOAD)
@@ -93,20 +372,39 @@ bootutil_img_hash(struct enc_key_data *enc_state, int image_index,
 #endif
 #endif
 
+#ifdef MCUBOOT_HASH_CHUNKS
+    if (hdr->ih_flags & IMAGE_F_HASH_CHUNKED) {
+        return bootutil_img_hash_chunked(hdr, fap, tmp_buf, tmp_buf_sz,
+                                         hash_result, seed, seed_len);
+    }
+#endif
+
 #ifdef MCUBOOT_ENC_IMAGES
-    /* Encrypted images only exist in the secondary slot */
+    /* Encrypted images only exist in the secondary slot, unless they are
+     * executed in place (MCUBOOT_ENC_XIP) */
+    if (MUST_DECRYPT(fap, image_index, hdr) &&
+            !boot_enc_valid(enc_state,
+                            flash_area_id_to_multi_image_slot(image_index,
+                                flash_area_get_id(fap)))) {
+        return -1;
+    }
+#if defined(MCUBOOT_ENC_GCM) && !defined(MCUBOOT_RAM_LOAD)
+    /* The tag is computed over the encrypted payload as it is read for
+     * decryption, and checked before the hash is used.
+     */
     if (MUST_DECRYPT(fap, image_index, hdr) &&
-            !boot_enc_valid(enc_state, 1)) {
+            boot_enc_gcm_start(enc_state, 1, &gcm) != 0) {
         return -1;
     }
+#endif
 #endif
 
-    bootutil_sha_init(&sha_ctx);
+    bootutil_sha_init(sha_ctx);
 
     /* in some cases (split image) the hash is seeded with data from
      * the loader image */
     if (seed && (seed_len > 0)) {
-        bootutil_sha_update(&sha_ctx, seed, seed_len);
+        bootutil_sha_update(sha_ctx, seed, seed_len);
     }
 
     /* Hash is computed over image header and image itself. */
@@ -117,10 +415,134 @@ bootutil_img_hash(struct enc_key_data *enc_state, int image_index,
     /* If protected TLVs are present they are also hashed. */
     size += hdr->ih_protect_tlv_size;
 
+#ifndef MCUBOOT_RAM_LOAD
+    /* Offset of the image within the flash area. */
+    start_off = BOOT_IMG_START_OFF(fap);
+#endif
+
+#if defined(MCUBOOT_HASH_MMAP_FLASH) && !defined(MCUBOOT_RAM_LOAD)
+    /* Feed memory-mapped flash straight to the hash engine, without going
+     * through a RAM buffer; encrypted payloads still need to be decrypted.
+     */
+#ifdef MCUBOOT_ENC_IMAGES
+    if (!MUST_DECRYPT(fap, image_index, hdr))
+#endif
+    {
+        uintptr_t addr;
+
+        if (flash_area_get_mapped_addr(fap, &addr) == 0) {
+            for (off = 0; off < size; off += blk_sz) {
+                blk_sz = size - off;
+                if (blk_sz > MCUBOOT_HASH_MMAP_BLK_SZ) {
+                    blk_sz = MCUBOOT_HASH_MMAP_BLK_SZ;
+                }
+                bootutil_sha_update(sha_ctx,
+                                    (const void *)(addr + start_off + off),
+                                    blk_sz);
+                boot_watchdog_feed(blk_sz);
+            }
+            goto finish;
+        }
+    }
+#endif
+
+#if defined(MCUBOOT_FLASH_AREA_MMAP) && !defined(MCUBOOT_RAM_LOAD)
+    /* Same as above for flash that is mapped a window at a time. */
+#ifdef MCUBOOT_ENC_IMAGES
+    if (!MUST_DECRYPT(fap, image_index, hdr))
+#endif
+    {
+        const void *ptr;
+
+        for (off = 0; off < size; off += blk_sz) {
+            blk_sz = size - off;
+            if (blk_sz > MCUBOOT_HASH_MMAP_BLK_SZ) {
+                blk_sz = MCUBOOT_HASH_MMAP_BLK_SZ;
+            }
+            if (flash_area_mmap(fap, start_off + off, blk_sz, &ptr) != 0) {
+                break;
+            }
+            bootutil_sha_update(sha_ctx, ptr, blk_sz);
+            flash_area_munmap(fap, ptr);
+            boot_watchdog_feed(blk_sz);
+        }
+        if (off >= size) {
+            goto finish;
+        }
+        if (off > 0) {
+            /* The start of the image was already hashed. */
+            bootutil_sha_drop(sha_ctx);
+            return -1;
+        }
+    }
+#endif
+
 #ifdef MCUBOOT_RAM_LOAD
-    bootutil_sha_update(&sha_ctx,
+    bootutil_sha_update(sha_ctx,
                         (void*)(IMAGE_RAM_BASE + hdr->ih_load_addr),
                         size);
+#elif defined(MCUBOOT_HASH_PIPELINE)
+    /* Two buffers are used in turn: while one block is being decrypted and
+     * hashed, the read of the following block is already in progress.
+     */
+    cur = 0;
+    off = 0;
+    blk_sz = 0;
+    rc = 0;
+    if (size > 0) {
+        blk_sz = bootutil_img_hash_blk_sz(off, size,
+                                          MCUBOOT_HASH_PIPELINE_BUF_SIZE,
+                                          hdr_size, tlv_off);
+        rc = bootutil_img_hash_read_start(fap, start_off + off, pipe_buf[cur],
+                                          blk_sz);
+    }
+    while (rc == 0 && off < size) {
+        rc = bootutil_img_hash_read_wait(fap);
+        if (rc) {
+            break;
+        }
+
+        cur_buf = pipe_buf[cur];
+        next_off = off + blk_sz;
+        next_sz = 0;
+        if (next_off < size) {
+            next_sz = bootutil_img_hash_blk_sz(next_off, size,
+                                               MCUBOOT_HASH_PIPELINE_BUF_SIZE,
+                                               hdr_size, tlv_off);
+            rc = bootutil_img_hash_read_start(fap, start_off + next_off,
+                                              pipe_buf[cur ^ 1], next_sz);
+            if (rc) {
+                break;
+            }
+        }
+
+#ifdef MCUBOOT_ENC_IMAGES
+        if (MUST_DECRYPT(fap, image_index, hdr)) {
+            /* Only payload is encrypted (area between header and TLVs) */
+            int slot = flash_area_id_to_multi_image_slot(image_index,
+                            flash_area_get_id(fap));
+
+            if (off >= hdr_size && off < tlv_off) {
+                blk_off = (off - hdr_size) & 0xf;
+#ifdef MCUBOOT_ENC_GCM
+                boot_enc_gcm_update(&gcm, cur_buf, blk_sz);
+#endif
+                boot_enc_decrypt(enc_state, slot, off - hdr_size,
+                                 blk_sz, blk_off, cur_buf);
+            }
+        }
+#endif
+        bootutil_sha_update(sha_ctx, cur_buf, blk_sz);
+        boot_watchdog_feed(blk_sz);
+
+        off = next_off;
+        blk_sz = next_sz;
+        cur ^= 1;
+    }
+    if (rc) {
+        bootutil_sha_drop(sha_ctx);
+        return rc;
+    }
 #else
     for (off = 0; off < size; off += blk_sz) {
         blk_sz = size - off;
@@ -140,9 +562,9 @@ bootutil_img_hash(struct enc_key_data *enc_state, int image_index,
             blk_sz = tlv_off - off;
         }
 #endif
-        rc = flash_area_read(fap, off, tmp_buf, blk_sz);
+        rc = flash_area_read(fap, start_off + off, tmp_buf, blk_sz);
         if (rc) {
-            bootutil_sha_drop(&sha_ctx);
+            bootutil_sha_drop(sha_ctx);
             return rc;
         }
 #ifdef MCUBOOT_ENC_IMAGES
@@ -153,16 +575,33 @@ bootutil_img_hash(struct enc_key_data *enc_state, int image_index,
 
             if (off >= hdr_size && off < tlv_off) {
                 blk_off = (off - hdr_size) & 0xf;
+#ifdef MCUBOOT_ENC_GCM
+                boot_enc_gcm_update(&gcm, tmp_buf, blk_sz);
+#endif
                 boot_enc_decrypt(enc_state, slot, off - hdr_size,
                                  blk_sz, blk_off, tmp_buf);
             }
         }
 #endif
-        bootutil_sha_update(&sha_ctx, tmp_buf, blk_sz);
+        bootutil_sha_update(sha_ctx, tmp_buf, blk_sz);
+        boot_watchdog_feed(blk_sz);
     }
 #endif /* MCUBOOT_RAM_LOAD */
-    bootutil_sha_finish(&sha_ctx, hash_result);
-    bootutil_sha_drop(&sha_ctx);
+#if defined(MCUBOOT_ENC_GCM) && !defined(MCUBOOT_RAM_LOAD)
+    if (MUST_DECRYPT(fap, image_index, hdr)) {
+        FIH_CALL(boot_enc_gcm_verify, fih_rc, &gcm, hdr, fap);
+        if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+            bootutil_sha_drop(sha_ctx);
+            return -1;
+        }
+    }
+#endif
+#if (defined(MCUBOOT_HASH_MMAP_FLASH) || defined(MCUBOOT_FLASH_AREA_MMAP)) && \
+    !defined(MCUBOOT_RAM_LOAD)
+finish:
+#endif
+    bootutil_sha_finish(sha_ctx, hash_result);
+    bootutil_sha_drop(sha_ctx);
 
     return 0;
 }
@@ -226,12 +665,34 @@ bootutil_img_hash(struct enc_key_data *enc_state, int image_index,
 #endif /* !MCUBOOT_HW_KEY */
 
 #if !defined(MCUBOOT_HW_KEY)
+#ifdef MCUBOOT_KEY_HASH_CACHE
+#ifndef MCUBOOT_KEY_HASH_CACHE_SIZE
+#define MCUBOOT_KEY_HASH_CACHE_SIZE 4
+#endif
+
+/* Digests of the first built-in keys. They are computed on first use and
+ * then shared by all the images validated by the bootloader.
+ */
+BOOT_CACHE_STATIC uint8_t
+key_hash_cache[MCUBOOT_KEY_HASH_CACHE_SIZE][IMAGE_HASH_SIZE];
+BOOT_CACHE_STATIC int key_hash_cache_cnt;
+#endif /* MCUBOOT_KEY_HASH_CACHE */
+
+static void
+bootutil_key_hash(const struct bootutil_key *key, uint8_t *hash)
+{
+    bootutil_sha_context sha_ctx;
+
+    bootutil_sha_init(&sha_ctx);
+    bootutil_sha_update(&sha_ctx, key->key, *key->len);
+    bootutil_sha_finish(&sha_ctx, hash);
+    bootutil_sha_drop(&sha_ctx);
+}
+
 static int
 bootutil_find_key(uint8_t *keyhash, uint8_t keyhash_len)
 {
-    bootutil_sha_context sha_ctx;
     int i;
-    const struct bootutil_key *key;
     uint8_t hash[IMAGE_HASH_SIZE];
 
     if (keyhash_len > IMAGE_HASH_SIZE) {
@@ -239,16 +700,23 @@ bootutil_find_key(uint8_t *keyhash, uint8_t keyhash_len)
     }
 
     for (i = 0; i < bootutil_key_cnt; i++) {
-        key = &bootutil_keys[i];
-        bootutil_sha_init(&sha_ctx);
-        bootutil_sha_update(&sha_ctx, key->key, *key->len);
-        bootutil_sha_finish(&sha_ctx, hash);
+#ifdef MCUBOOT_KEY_HASH_CACHE
+        if (i < MCUBOOT_KEY_HASH_CACHE_SIZE) {
+            if (i >= key_hash_cache_cnt) {
+                bootutil_key_hash(&bootutil_keys[i], key_hash_cache[i]);
+                key_hash_cache_cnt = i + 1;
+            }
+            if (!memcmp(key_hash_cache[i], keyhash, keyhash_len)) {
+                return i;
+            }
+            continue;
+        }
+#endif
+        bootutil_key_hash(&bootutil_keys[i], hash);
         if (!memcmp(hash, keyhash, keyhash_len)) {
-            bootutil_sha_drop(&sha_ctx);
             return i;
         }
     }
-    bootutil_sha_drop(&sha_ctx);
     return -1;
 }
 #else /* !MCUBOOT_HW_KEY */
@@ -378,14 +846,14 @@ static const uint16_t allowed_unprot_tlvs[] = {
 #endif
 
 /*
- * Verify the integrity of the image.
+ * Verify the TLVs of an image against an already computed image hash: the
+ * hash TLV, the signature and optionally the security counter.
  * Return non-zero if image could not be validated/does not validate.
  */
 fih_ret
-bootutil_img_validate(struct enc_key_data *enc_state, int image_index,
-                      struct image_header *hdr, const struct flash_area *fap,
-                      uint8_t *tmp_buf, uint32_t tmp_buf_sz, uint8_t *seed,
-                      int seed_len, uint8_t *out_hash)
+bootutil_img_validate_digest(int image_index, struct image_header *hdr,
+                             const struct flash_area *fap, uint8_t *tmp_buf,
+                             uint32_t tmp_buf_sz, uint8_t *hash)
 {
     uint32_t off;
     uint16_t len;
@@ -407,7 +875,6 @@ bootutil_img_validate(struct enc_key_data *enc_state, int image_index,
 #endif /* EXPECTED_SIG_TLV */
     struct image_tlv_iter it;
     uint8_t buf[SIG_BUF_SIZE];
-    uint8_t hash[IMAGE_HASH_SIZE];
     int rc = 0;
     FIH_DECLARE(fih_rc, FIH_FAILURE);
 #ifdef MCUBOOT_HW_ROLLBACK_PROT
@@ -416,15 +883,12 @@ bootutil_img_validate(struct enc_key_data *enc_state, int image_index,
     FIH_DECLARE(security_counter_valid, FIH_FAILURE);
 #endif
 
-    rc = bootutil_img_hash(enc_state, image_index, hdr, fap, tmp_buf,
-            tmp_buf_sz, hash, seed, seed_len);
-    if (rc) {
-        goto out;
-    }
-
-    if (out_hash) {
-        memcpy(out_hash, hash, IMAGE_HASH_SIZE);
-    }
+    /* Only used for the key and the security counter of some configurations. */
+    (void)image_index;
+#ifndef MCUBOOT_HASH_CHUNKS
+    (void)tmp_buf;
+    (void)tmp_buf_sz;
+#endif
 
     rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_ANY, false);
     if (rc) {
@@ -471,16 +935,16 @@ bootutil_img_validate(struct enc_key_data *enc_state, int image_index,
 
         if (type == EXPECTED_HASH_TLV) {
             /* Verify the image hash. This must always be present. */
-            if (len != sizeof(hash)) {
+            if (len != IMAGE_HASH_SIZE) {
                 rc = -1;
                 goto out;
             }
-            rc = LOAD_IMAGE_DATA(hdr, fap, off, buf, sizeof(hash));
+            rc = LOAD_IMAGE_DATA(hdr, fap, off, buf, IMAGE_HASH_SIZE);
             if (rc) {
                 goto out;
             }
 
-            FIH_CALL(boot_fih_memequal, fih_rc, hash, buf, sizeof(hash));
+            FIH_CALL(boot_fih_memequal, fih_rc, hash, buf, IMAGE_HASH_SIZE);
             if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
                 FIH_SET(fih_rc, FIH_FAILURE);
                 goto out;
@@ -529,10 +993,20 @@ bootutil_img_validate(struct enc_key_data *enc_state, int image_index,
             if (rc) {
                 goto out;
             }
-            FIH_CALL(bootutil_verify_sig, valid_signature, hash, sizeof(hash),
-                                                           buf, len, key_id);
+            boot_phase_start(BOOT_PHASE_SIG);
+            FIH_CALL(bootutil_verify_sig, valid_signature, hash,
+                                          IMAGE_HASH_SIZE, buf, len, key_id);
+            boot_phase_stop(BOOT_PHASE_SIG);
+            BOOT_STEP_POINT(BOOT_STEP_VERIFY);
             key_id = -1;
 #endif /* EXPECTED_SIG_TLV */
+        } else if (type == IMAGE_TLV_SIG_PURE) {
+            /*
+             * Signatures are only verified over the image hash, so an image
+             * whose signature covers the image itself is refused.
+             */
+            rc = -1;
+            goto out;
 #ifdef MCUBOOT_HW_ROLLBACK_PROT
         } else if (type == IMAGE_TLV_SEC_CNT) {
             /*
@@ -550,8 +1024,8 @@ bootutil_img_validate(struct enc_key_data *enc_state, int image_index,
                 goto out;
             }
 
-            FIH_CALL(boot_nv_security_counter_get, fih_rc, image_index,
-                                                           &security_cnt);
+            FIH_CALL(boot_security_counter_get, fih_rc, image_index,
+                                                        &security_cnt);
             if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
                 FIH_SET(fih_rc, FIH_FAILURE);
                 goto out;
@@ -577,6 +1051,16 @@ bootutil_img_validate(struct enc_key_data *enc_state, int image_index,
     if (rc) {
         goto out;
     }
+#ifdef MCUBOOT_HASH_CHUNKS
+    if (hdr->ih_flags & IMAGE_F_HASH_CHUNKED) {
+        FIH_CALL(bootutil_img_check_chunks, fih_rc, hdr, fap, tmp_buf,
+                 tmp_buf_sz);
+        if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+            rc = -1;
+            goto out;
+        }
+    }
+#endif
 #ifdef EXPECTED_SIG_TLV
     FIH_SET(fih_rc, valid_signature);
 #endif
@@ -594,3 +1078,66 @@ out:
 
     FIH_RET(fih_rc);
 }
+
+/*
+ * Verify the TLVs of an image against the hash TLV they hold, without
+ * hashing the image: the bounds of the TLVs, the signature and optionally
+ * the security counter. The caller must still check that the image hashes
+ * to the value of the hash TLV.
+ * Return non-zero if the TLVs could not be validated/do not validate.
+ */
+fih_ret
+bootutil_img_validate_tlvs(int image_index, struct image_header *hdr,
+                           const struct flash_area *fap, uint8_t *tmp_buf,
+                           uint32_t tmp_buf_sz)
+{
+    struct image_tlv_iter it;
+    uint8_t hash[IMAGE_HASH_SIZE];
+    uint32_t off;
+    uint16_t len;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    if (bootutil_tlv_iter_begin(&it, hdr, fap, EXPECTED_HASH_TLV, false) ||
+        bootutil_tlv_iter_next(&it, &off, &len, NULL) != 0 ||
+        len != IMAGE_HASH_SIZE ||
+        LOAD_IMAGE_DATA(hdr, fap, off, hash, IMAGE_HASH_SIZE)) {
+        FIH_RET(fih_rc);
+    }
+
+    FIH_CALL(bootutil_img_validate_digest, fih_rc, image_index, hdr, fap,
+             tmp_buf, tmp_buf_sz, hash);
+
+    FIH_RET(fih_rc);
+}
+
+/*
+ * Verify the integrity of the image.
+ * Return non-zero if image could not be validated/does not validate.
+ */
+fih_ret
+bootutil_img_validate(struct enc_key_data *enc_state, int image_index,
+                      struct image_header *hdr, const struct flash_area *fap,
+                      uint8_t *tmp_buf, uint32_t tmp_buf_sz, uint8_t *seed,
+                      int seed_len, uint8_t *out_hash)
+{
+    uint8_t hash[IMAGE_HASH_SIZE];
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    boot_phase_start(BOOT_PHASE_HASH);
+    rc = bootutil_img_hash(enc_state, image_index, hdr, fap, tmp_buf,
+            tmp_buf_sz, hash, seed, seed_len);
+    boot_phase_stop(BOOT_PHASE_HASH);
+    if (rc) {
+        FIH_RET(fih_rc);
+    }
+
+    if (out_hash) {
+        memcpy(out_hash, hash, IMAGE_HASH_SIZE);
+    }
+
+    FIH_CALL(bootutil_img_validate_digest, fih_rc, image_index, hdr, fap,
+             tmp_buf, tmp_buf_sz, hash);
+
+    FIH_RET(fih_rc);
+}
@@ -0,0 +1,373 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Streaming writer of the secondary slot, for applications. See
+ * bootutil/image_writer.h.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef MCUBOOT_IMAGE_WRITER
+
+#include "sysflash/sysflash.h"
+#include "flash_map_backend/flash_map_backend.h"
+
+#include "bootutil/image.h"
+#include "bootutil/bootutil_public.h"
+#include "bootutil/bootutil_log.h"
+#include "bootutil/image_writer.h"
+#include "bootutil_priv.h"
+
+#ifdef MCUBOOT_PENDING_DIGEST
+#include "bootutil/pending_digest.h"
+#endif
+
+#if (MCUBOOT_IMAGE_WRITER_BUF_SIZE % BOOT_MAX_ALIGN) != 0
+#error "MCUBOOT_IMAGE_WRITER_BUF_SIZE must be a multiple of BOOT_MAX_ALIGN"
+#endif
+
+#ifdef CONFIG_MCUBOOT
+BOOT_LOG_MODULE_DECLARE(mcuboot);
+#else
+BOOT_LOG_MODULE_DECLARE(mcuboot_util);
+#endif
+
+#ifdef MCUBOOT_PENDING_DIGEST
+/* The pending digest record is stored right after the image TLVs. */
+#define BOOT_IMAGE_WRITER_TAIL \
+    (BOOT_MAX_ALIGN + ALIGN_UP(sizeof(struct boot_pending_digest), BOOT_MAX_ALIGN))
+#else
+#define BOOT_IMAGE_WRITER_TAIL 0
+#endif
+
+/*
+ * Erases the sectors of the slot up to the one holding end - 1, unless they
+ * hold the trailer, which is erased when writing starts.
+ */
+static int
+boot_image_writer_erase_to(struct boot_image_writer *w, uint32_t end)
+{
+    struct flash_sector sector;
+    uint32_t sector_off;
+    uint32_t sector_sz;
+
+    while (w->erased_off < end && w->erased_off < w->trailer_off) {
+        if (flash_area_get_sector(w->fap, w->erased_off, &sector) != 0) {
+            return BOOT_EFLASH;
+        }
+
+        sector_off = flash_sector_get_off(&sector);
+        sector_sz = flash_sector_get_size(&sector);
+        if (flash_area_erase(w->fap, sector_off, sector_sz) != 0) {
+            return BOOT_EFLASH;
+        }
+        w->erased_off = sector_off + sector_sz;
+    }
+
+    return 0;
+}
+
+/*
+ * Starts hashing the image from its header, unless its hash can not be
+ * computed from the data written.
+ */
+static int
+boot_image_writer_start_hash(struct boot_image_writer *w)
+{
+    struct image_header *hdr = &w->hdr;
+    uint32_t hash_len;
+
+    if (w->buf_len < sizeof(*hdr)) {
+        return BOOT_EBADIMAGE;
+    }
+
+    memcpy(hdr, w->buf, sizeof(*hdr));
+    if (hdr->ih_magic != IMAGE_MAGIC) {
+        return BOOT_EBADIMAGE;
+    }
+
+    hash_len = (uint32_t)hdr->ih_hdr_size + hdr->ih_protect_tlv_size;
+    if (hdr->ih_img_size > w->img_size ||
+        hash_len > w->img_size - hdr->ih_img_size) {
+        return BOOT_EBADIMAGE;
+    }
+
+    if (IS_ENCRYPTED(hdr) || (hdr->ih_flags & IMAGE_F_HASH_CHUNKED)) {
+        return 0;
+    }
+
+    w->hash_len = hash_len + hdr->ih_img_size;
+    bootutil_sha_init(&w->sha);
+    w->hashing = true;
+
+    return 0;
+}
+
+/*
+ * Hashes and writes the first len bytes of the buffer, padded to the write
+ * alignment of the flash.
+ */
+static int
+boot_image_writer_flush(struct boot_image_writer *w, uint32_t len)
+{
+    uint32_t align;
+    uint32_t write_len;
+    int rc;
+
+    if (w->off == 0) {
+        rc = boot_image_writer_start_hash(w);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    if (w->hashing && w->off < w->hash_len) {
+        bootutil_sha_update(&w->sha, w->buf,
+                            (w->hash_len - w->off < len) ?
+                            w->hash_len - w->off : len);
+    }
+
+    align = flash_area_align(w->fap);
+    write_len = ALIGN_UP(len, align);
+    memset(w->buf + len, flash_area_erased_val(w->fap), write_len - len);
+
+#ifdef MCUBOOT_TLV_INDEX
+    /* The image being written may have the header of the previous one. */
+    bootutil_tlv_index_invalidate(w->fap);
+#endif
+
+    rc = boot_image_writer_erase_to(w, w->off + write_len);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (flash_area_write(w->fap, w->off, w->buf, write_len) != 0) {
+        return BOOT_EFLASH;
+    }
+
+    w->off += len;
+    w->buf_len = 0;
+
+    return 0;
+}
+
+/*
+ * Reads the value of the hash TLV of the image just written.
+ */
+static int
+boot_image_writer_hash_tlv(struct boot_image_writer *w, uint8_t *hash)
+{
+    struct image_tlv_info info;
+    struct image_tlv tlv;
+    uint32_t off;
+    uint32_t end;
+
+    off = BOOT_TLV_OFF(&w->hdr);
+    if (flash_area_read(w->fap, off, &info, sizeof(info)) != 0) {
+        return BOOT_EFLASH;
+    }
+
+    if (info.it_magic == IMAGE_TLV_PROT_INFO_MAGIC) {
+        off += info.it_tlv_tot;
+        if (flash_area_read(w->fap, off, &info, sizeof(info)) != 0) {
+            return BOOT_EFLASH;
+        }
+    }
+
+    if (info.it_magic != IMAGE_TLV_INFO_MAGIC || off > w->img_size ||
+        info.it_tlv_tot > w->img_size - off) {
+        return BOOT_EBADIMAGE;
+    }
+
+    end = off + info.it_tlv_tot;
+    off += sizeof(info);
+    while (off + sizeof(tlv) <= end) {
+        if (flash_area_read(w->fap, off, &tlv, sizeof(tlv)) != 0) {
+            return BOOT_EFLASH;
+        }
+        off += sizeof(tlv);
+
+        if (tlv.it_type == EXPECTED_HASH_TLV && tlv.it_len == IMAGE_HASH_SIZE &&
+            off + IMAGE_HASH_SIZE <= end) {
+            if (flash_area_read(w->fap, off, hash, IMAGE_HASH_SIZE) != 0) {
+                return BOOT_EFLASH;
+            }
+            return 0;
+        }
+        off += tlv.it_len;
+    }
+
+    return BOOT_EBADIMAGE;
+}
+
+int
+boot_image_writer_open(struct boot_image_writer *w, int image_index,
+                       uint32_t img_size)
+{
+    struct flash_sector sector;
+    uint32_t trailer_off;
+    int rc;
+
+    memset(w, 0, sizeof(*w));
+    w->image_index = image_index;
+    w->img_size = img_size;
+
+    if (flash_area_open(FLASH_AREA_IMAGE_SECONDARY(image_index), &w->fap) != 0) {
+        w->fap = NULL;
+        return BOOT_EFLASH;
+    }
+
+    trailer_off = boot_swap_info_off(w->fap);
+    if (img_size < sizeof(struct image_header) || img_size > trailer_off) {
+        rc = BOOT_EBADARGS;
+        goto fail;
+    }
+
+    if (flash_area_get_sector(w->fap, trailer_off, &sector) != 0) {
+        rc = BOOT_EFLASH;
+        goto fail;
+    }
+    w->trailer_off = flash_sector_get_off(&sector);
+
+    rc = flash_area_erase(w->fap, w->trailer_off,
+                          flash_area_get_size(w->fap) - w->trailer_off);
+    if (rc != 0) {
+        rc = BOOT_EFLASH;
+        goto fail;
+    }
+
+    return 0;
+
+fail:
+    flash_area_close(w->fap);
+    w->fap = NULL;
+    return rc;
+}
+
+int
+boot_image_writer_write(struct boot_image_writer *w, const void *data,
+                        size_t len)
+{
+    const uint8_t *src = data;
+    size_t chunk;
+    int rc;
+
+    if (w->fap == NULL || len > w->img_size - (w->off + w->buf_len)) {
+        return BOOT_EBADARGS;
+    }
+
+    while (len > 0) {
+        chunk = sizeof(w->buf) - w->buf_len;
+        if (chunk > len) {
+            chunk = len;
+        }
+
+        memcpy(w->buf + w->buf_len, src, chunk);
+        w->buf_len += chunk;
+        src += chunk;
+        len -= chunk;
+
+        if (w->buf_len == sizeof(w->buf)) {
+            rc = boot_image_writer_flush(w, w->buf_len);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int
+boot_image_writer_finish(struct boot_image_writer *w)
+{
+    uint8_t tlv_hash[IMAGE_HASH_SIZE];
+    int rc;
+
+    if (w->fap == NULL || w->off + w->buf_len != w->img_size) {
+        return BOOT_EBADARGS;
+    }
+
+    if (w->buf_len > 0) {
+        rc = boot_image_writer_flush(w, w->buf_len);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    /* Whatever follows the image is stored to erased flash. */
+    rc = boot_image_writer_erase_to(w, w->img_size + BOOT_IMAGE_WRITER_TAIL);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (!w->hashing) {
+        return 0;
+    }
+
+    bootutil_sha_finish(&w->sha, w->digest);
+    bootutil_sha_drop(&w->sha);
+    w->hashing = false;
+
+    rc = boot_image_writer_hash_tlv(w, tlv_hash);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (memcmp(tlv_hash, w->digest, IMAGE_HASH_SIZE) != 0) {
+        BOOT_LOG_ERR("Image %d does not match its hash", w->image_index);
+        return BOOT_EBADIMAGE;
+    }
+    w->digest_valid = true;
+
+    return 0;
+}
+
+int
+boot_image_writer_set_pending(struct boot_image_writer *w, int permanent)
+{
+#ifdef MCUBOOT_PENDING_DIGEST
+    if (w->digest_valid) {
+        return boot_set_pending_digest_multi(w->image_index, permanent,
+                                             w->digest);
+    }
+#endif
+
+    return boot_set_pending_multi(w->image_index, permanent);
+}
+
+void
+boot_image_writer_close(struct boot_image_writer *w)
+{
+    if (w->hashing) {
+        bootutil_sha_drop(&w->sha);
+        w->hashing = false;
+    }
+
+    if (w->fap != NULL) {
+        flash_area_close(w->fap);
+        w->fap = NULL;
+    }
+}
+
+#endif /* MCUBOOT_IMAGE_WRITER */
@@ -34,6 +34,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include "bootutil/bootutil.h"
@@ -47,7 +48,34 @@
 #include "bootutil/fault_injection_hardening.h"
 #include "bootutil/ramload.h"
 #include "bootutil/boot_hooks.h"
+#include "bootutil/boot_public_hooks.h"
+#include "bootutil/boot_perf_hooks.h"
 #include "bootutil/mcuboot_status.h"
+#include "crypto_arena.h"
+
+#ifdef MCUBOOT_VALIDATION_CACHE
+#include "bootutil/validation_cache.h"
+#endif
+
+#ifdef MCUBOOT_IMAGE_VERDICT_HOOKS
+#include "bootutil/crypto/sha.h"
+#endif
+
+#ifdef MCUBOOT_BOOT_INDEX
+#include "bootutil/boot_index.h"
+#endif
+
+#ifdef MCUBOOT_PENDING_DIGEST
+#include "bootutil/pending_digest.h"
+#endif
+
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+#include "bootutil/boot_parallel.h"
+#endif
+
+#ifdef MCUBOOT_IMAGE_SOURCE
+#include "bootutil/image_source.h"
+#endif
 
 #ifdef MCUBOOT_ENC_IMAGES
 #include "bootutil/enc_key.h"
@@ -67,8 +95,8 @@ static struct boot_loader_state boot_data;
 static struct image_max_size image_max_sizes[BOOT_IMAGE_NUMBER] = {0};
 #endif
 
-#if (!defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)) || \
-defined(MCUBOOT_SERIAL_IMG_GRP_SLOT_INFO)
+#if ((!defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)) || \
+     defined(MCUBOOT_SERIAL_IMG_GRP_SLOT_INFO)) && !defined(MCUBOOT_SECTOR_RUNS)
 #if !defined(__BOOTSIM__)
 /* Used for holding static buffers in multiple functions to work around issues
  * in older versions of gcc (e.g. 4.8.4)
@@ -104,10 +132,96 @@ static struct sector_buffer_t sector_buffers;
 #define TARGET_STATIC
 #endif
 
-#if BOOT_MAX_ALIGN > 1024
+/*
+ * Size of the buffer used to copy flash regions. Each chunk takes one flash
+ * read and one flash write, so a larger buffer means fewer backend calls when
+ * swapping or copying images, at the cost of RAM.
+ */
+#ifndef MCUBOOT_COPY_BUF_SIZE
+#define MCUBOOT_COPY_BUF_SIZE 1024
+#endif
+
+#if (MCUBOOT_COPY_BUF_SIZE % BOOT_MAX_ALIGN) != 0
+#error "MCUBOOT_COPY_BUF_SIZE must be a multiple of BOOT_MAX_ALIGN"
+#endif
+
+#if defined(MCUBOOT_RAM_LOAD_STAGED) && \
+    (!defined(MCUBOOT_RAM_LOAD) || !defined(MCUBOOT_HASH_CHUNKS))
+#error "MCUBOOT_RAM_LOAD_STAGED requires MCUBOOT_RAM_LOAD and MCUBOOT_HASH_CHUNKS"
+#endif
+
+#if BOOT_MAX_ALIGN > MCUBOOT_COPY_BUF_SIZE
 #define BUF_SZ BOOT_MAX_ALIGN
 #else
-#define BUF_SZ 1024
+#define BUF_SZ MCUBOOT_COPY_BUF_SIZE
+#endif
+
+#ifdef MCUBOOT_COPY_PIPELINE
+/*
+ * Number of copy buffers used in turn: while chunk N is being processed, the
+ * read of chunk N+1 and the write of chunk N-1 can both be in progress.
+ */
+#define BOOT_COPY_PIPELINE_BUFS 3
+#define BOOT_COPY_BUFS_SZ       (BOOT_COPY_PIPELINE_BUFS * BUF_SZ)
+#else
+#define BOOT_COPY_BUFS_SZ       BUF_SZ
+#endif
+
+/*
+ * With MCUBOOT_WORK_ARENA, the buffers used to copy flash regions and the
+ * work buffers used to validate images are taken from one static arena: no
+ * image is validated by the loader while a region is being copied. The
+ * validation then gets the whole arena, and so reads images in chunks as
+ * large as the copy buffers instead of BOOT_TMPBUF_SZ bytes.
+ */
+#ifdef MCUBOOT_WORK_ARENA
+#if defined(MCUBOOT_PARALLEL_VALIDATION)
+#error "MCUBOOT_WORK_ARENA is not supported with MCUBOOT_PARALLEL_VALIDATION"
+#endif
+
+#if BOOT_COPY_BUFS_SZ > BOOT_TMPBUF_SZ
+#define BOOT_WORK_ARENA_SZ BOOT_COPY_BUFS_SZ
+#else
+#define BOOT_WORK_ARENA_SZ BOOT_TMPBUF_SZ
+#endif
+
+#if !defined(__BOOTSIM__)
+static uint8_t boot_work_arena[BOOT_WORK_ARENA_SZ] __attribute__((aligned(4)));
+#else
+static __thread uint8_t boot_work_arena[BOOT_WORK_ARENA_SZ] __attribute__((aligned(4)));
+#endif
+
+/* Declares name as the validation work buffer of BOOT_WORK_BUF_SZ bytes. */
+#define BOOT_WORK_BUF(name) uint8_t *const name = boot_work_arena
+#define BOOT_WORK_BUF_SZ    BOOT_WORK_ARENA_SZ
+#else
+#define BOOT_WORK_BUF(name) TARGET_STATIC uint8_t name[BOOT_TMPBUF_SZ]
+#define BOOT_WORK_BUF_SZ    BOOT_TMPBUF_SZ
+#endif
+
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+/* Paints the static arenas, so that the profiler can tell their use. */
+static void
+boot_profile_paint_arenas(void)
+{
+#ifdef MCUBOOT_WORK_ARENA
+    boot_profile_arena_paint(BOOT_ARENA_WORK, boot_work_arena, sizeof(boot_work_arena));
+#endif
+#ifdef MCUBOOT_CRYPTO_ARENA
+    boot_crypto_arena_paint();
+#endif
+}
+#else
+#define boot_profile_paint_arenas() do { } while (0)
+#endif
+
+#ifdef MCUBOOT_COPY_VERIFY
+#ifdef MCUBOOT_COPY_PIPELINE
+#error "MCUBOOT_COPY_VERIFY can not be used with MCUBOOT_COPY_PIPELINE"
+#endif
+#ifndef MCUBOOT_COPY_VERIFY_RETRIES
+#define MCUBOOT_COPY_VERIFY_RETRIES 2
+#endif
 #endif
 
 static int
@@ -118,12 +232,14 @@ boot_read_image_headers(struct boot_loader_state *state, bool require_all,
     int i;
 
     for (i = 0; i < BOOT_NUM_SLOTS; i++) {
+        boot_phase_start(BOOT_PHASE_HDR_READ);
         rc = BOOT_HOOK_CALL(boot_read_image_header_hook, BOOT_HOOK_REGULAR,
                             BOOT_CURR_IMG(state), i, boot_img_hdr(state, i));
         if (rc == BOOT_HOOK_REGULAR)
         {
             rc = boot_read_image_header(state, i, boot_img_hdr(state, i), bs);
         }
+        boot_phase_stop(BOOT_PHASE_HDR_READ);
         if (rc != 0) {
             /* If `require_all` is set, fail on any single fail, otherwise
              * if at least the first slot's header was read successfully,
@@ -142,6 +258,34 @@ boot_read_image_headers(struct boot_loader_state *state, bool require_all,
     return 0;
 }
 
+#ifdef MCUBOOT_MEASURED_BOOT
+/*
+ * Returns the slot of the current image whose flash area is fap.
+ */
+static int
+boot_measured_slot(struct boot_loader_state *state,
+                   const struct flash_area *fap)
+{
+    return (fap == BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT)) ?
+           BOOT_SECONDARY_SLOT : BOOT_PRIMARY_SLOT;
+}
+
+/*
+ * Returns the hash the image in a slot of the current image was last
+ * validated with, or NULL if it has not been validated since the slot was
+ * last written.
+ */
+static const uint8_t *
+boot_measured_hash(struct boot_loader_state *state, uint8_t slot)
+{
+    if (state->measured[BOOT_CURR_IMG(state)][slot].valid) {
+        return state->measured[BOOT_CURR_IMG(state)][slot].hash;
+    }
+
+    return NULL;
+}
+#endif /* MCUBOOT_MEASURED_BOOT */
+
 /**
  * Saves boot status and shared data for current image.
  *
@@ -158,9 +302,10 @@ boot_add_shared_data(struct boot_loader_state *state,
     int rc;
 
 #ifdef MCUBOOT_MEASURED_BOOT
-    rc = boot_save_boot_status(BOOT_CURR_IMG(state),
-                                boot_img_hdr(state, active_slot),
-                                BOOT_IMG_AREA(state, active_slot));
+    rc = boot_save_boot_status_hash(BOOT_CURR_IMG(state),
+                                    boot_img_hdr(state, active_slot),
+                                    BOOT_IMG_AREA(state, active_slot),
+                                    boot_measured_hash(state, active_slot));
     if (rc != 0) {
         BOOT_LOG_ERR("Failed to add image data to shared area");
         return rc;
@@ -202,6 +347,11 @@ fill_rsp(struct boot_loader_state *state, struct boot_rsp *rsp)
     /* Always boot from the first enabled image. */
     BOOT_CURR_IMG(state) = 0;
     IMAGES_ITER(BOOT_CURR_IMG(state)) {
+#ifdef MCUBOOT_LAZY_VALIDATION
+        if (state->img_deferred[BOOT_CURR_IMG(state)]) {
+            continue;
+        }
+#endif
         if (!state->img_mask[BOOT_CURR_IMG(state)]) {
             break;
         }
@@ -306,6 +456,81 @@ boot_version_cmp(const struct image_version *ver1,
 
 #if (!defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)) || \
 defined(MCUBOOT_SERIAL_IMG_GRP_SLOT_INFO)
+#ifdef MCUBOOT_SECTOR_RUNS
+/*
+ * Reads the sector layout of a flash area as runs of sectors of the same
+ * size. The table does not depend on the number of sectors, only on how
+ * many times the sector size changes across the area.
+ */
+static int
+boot_initialize_area(struct boot_loader_state *state, int flash_area)
+{
+    const struct flash_area *fap;
+    struct flash_sector sector;
+    struct boot_sector_runs *out_sectors;
+    struct boot_sector_run *run;
+    uint32_t *out_num_sectors;
+    uint32_t num_sectors;
+    uint32_t size;
+    uint32_t off;
+    int rc;
+
+    if (flash_area == FLASH_AREA_IMAGE_PRIMARY(BOOT_CURR_IMG(state))) {
+        out_sectors = &BOOT_IMG(state, BOOT_PRIMARY_SLOT).sectors;
+        out_num_sectors = &BOOT_IMG(state, BOOT_PRIMARY_SLOT).num_sectors;
+    } else if (flash_area == FLASH_AREA_IMAGE_SECONDARY(BOOT_CURR_IMG(state))) {
+        out_sectors = &BOOT_IMG(state, BOOT_SECONDARY_SLOT).sectors;
+        out_num_sectors = &BOOT_IMG(state, BOOT_SECONDARY_SLOT).num_sectors;
+#if MCUBOOT_SWAP_USING_SCRATCH
+    } else if (flash_area == FLASH_AREA_IMAGE_SCRATCH) {
+        out_sectors = &state->scratch.sectors;
+        out_num_sectors = &state->scratch.num_sectors;
+#endif
+    } else {
+        return BOOT_EFLASH;
+    }
+
+    rc = flash_area_open(flash_area, &fap);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    out_sectors->num_runs = 0;
+    num_sectors = 0;
+    run = NULL;
+    size = flash_area_get_size(fap);
+    for (off = 0; off < size; off += flash_sector_get_size(&sector)) {
+        rc = flash_area_get_sector(fap, off, &sector);
+        if (rc != 0 || flash_sector_get_off(&sector) != off ||
+            flash_sector_get_size(&sector) == 0) {
+            rc = BOOT_EFLASH;
+            goto done;
+        }
+
+        if (run == NULL || run->size != flash_sector_get_size(&sector)) {
+            if (out_sectors->num_runs == MCUBOOT_MAX_SECTOR_RUNS) {
+                BOOT_LOG_ERR("Flash area %d has more than %d sector runs",
+                             flash_area, MCUBOOT_MAX_SECTOR_RUNS);
+                rc = BOOT_ENOMEM;
+                goto done;
+            }
+            run = &out_sectors->runs[out_sectors->num_runs++];
+            run->off = off;
+            run->size = flash_sector_get_size(&sector);
+            run->count = 0;
+        }
+        run->count++;
+        num_sectors++;
+    }
+
+    *out_num_sectors = num_sectors;
+    rc = 0;
+
+done:
+    flash_area_close(fap);
+    return rc;
+}
+#else
 static int
 boot_initialize_area(struct boot_loader_state *state, int flash_area)
 {
@@ -343,6 +568,7 @@ boot_initialize_area(struct boot_loader_state *state, int flash_area)
     *out_num_sectors = num_sectors;
     return 0;
 }
+#endif /* MCUBOOT_SECTOR_RUNS */
 #endif
 
 #if defined(MCUBOOT_SERIAL_IMG_GRP_SLOT_INFO)
@@ -372,110 +598,214 @@ boot_read_sectors_recovery(struct boot_loader_state *state)
 
 #if (BOOT_IMAGE_NUMBER > 1)
 
-static int
-boot_verify_slot_dependencies(struct boot_loader_state *state, uint32_t slot);
-
 /**
- * Check the image dependency whether it is satisfied and modify
- * the swap type if necessary.
+ * Read all dependency TLVs of a slot from the flash, unless they have
+ * already been read during this boot.
  *
- * @param dep               Image dependency which has to be verified.
+ * @param image_index       Index of the image.
+ * @param slot              Image slot number.
  *
  * @return                  0 on success; nonzero on failure.
  */
 static int
-boot_verify_slot_dependency(struct boot_loader_state *state,
-                            struct image_dependency *dep)
+boot_read_slot_dependencies(struct boot_loader_state *state,
+                            uint8_t image_index, uint32_t slot)
 {
-    struct image_version *dep_version;
-    size_t dep_slot;
+    const struct flash_area *fap;
+    const struct image_header *hdr;
+    struct image_tlv_iter it;
+    struct image_dependency dep;
+    uint32_t off;
+    uint16_t len;
     int rc;
 
-    /* Determine the source of the image which is the subject of
-     * the dependency and get it's version. */
-#if !defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)
-    uint8_t swap_type = state->swap_type[dep->image_id];
-    dep_slot = BOOT_IS_UPGRADE(swap_type) ? BOOT_SECONDARY_SLOT
-                                          : BOOT_PRIMARY_SLOT;
-#else
-    dep_slot = state->slot_usage[dep->image_id].active_slot;
-#endif
+    if (state->deps[image_index][slot].loaded) {
+        return state->deps[image_index][slot].rc;
+    }
 
-    dep_version = &state->imgs[dep->image_id][dep_slot].hdr.ih_ver;
+    memset(&state->deps[image_index][slot], 0,
+           sizeof(state->deps[image_index][slot]));
 
-    rc = boot_version_cmp(dep_version, &dep->image_min_version);
-#if !defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)
-    if (rc < 0) {
-        /* Dependency not satisfied.
-         * Modify the swap type to decrease the version number of the image
-         * (which will be located in the primary slot after the boot process),
-         * consequently the number of unsatisfied dependencies will be
-         * decreased or remain the same.
-         */
-        switch (BOOT_SWAP_TYPE(state)) {
-        case BOOT_SWAP_TYPE_TEST:
-        case BOOT_SWAP_TYPE_PERM:
-            BOOT_SWAP_TYPE(state) = BOOT_SWAP_TYPE_NONE;
-            break;
-        case BOOT_SWAP_TYPE_NONE:
-            BOOT_SWAP_TYPE(state) = BOOT_SWAP_TYPE_REVERT;
-            break;
-        default:
+    fap = state->imgs[image_index][slot].area;
+    hdr = &state->imgs[image_index][slot].hdr;
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_DEPENDENCY, true);
+    if (rc != 0) {
+        goto done;
+    }
+
+    while (true) {
+        rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+        if (rc < 0) {
+            rc = -1;
+            goto done;
+        } else if (rc > 0) {
+            rc = 0;
             break;
         }
-    } else {
-        /* Dependency satisfied. */
-        rc = 0;
-    }
-#else
-  if (rc >= 0) {
-        /* Dependency satisfied. */
-        rc = 0;
+
+        if (len != sizeof(dep)) {
+            rc = BOOT_EBADIMAGE;
+            goto done;
+        }
+
+        rc = LOAD_IMAGE_DATA(hdr, fap, off, &dep, len);
+        if (rc != 0) {
+            rc = BOOT_EFLASH;
+            goto done;
+        }
+
+        if (dep.image_id >= BOOT_IMAGE_NUMBER) {
+            rc = BOOT_EBADARGS;
+            goto done;
+        }
+
+        if (!state->deps[image_index][slot].on[dep.image_id] ||
+            boot_version_cmp(&dep.image_min_version,
+                &state->deps[image_index][slot].min_ver[dep.image_id]) > 0) {
+            state->deps[image_index][slot].on[dep.image_id] = true;
+            state->deps[image_index][slot].min_ver[dep.image_id] =
+                dep.image_min_version;
+        }
     }
-#endif
 
+done:
+    state->deps[image_index][slot].loaded = true;
+    state->deps[image_index][slot].rc = rc;
     return rc;
 }
 
+/**
+ * Slot of an image which will be booted, according to the current swap
+ * type or active slot of the image.
+ */
+static uint32_t
+boot_dependency_slot(struct boot_loader_state *state, uint8_t image_index)
+{
 #if !defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)
+    return BOOT_IS_UPGRADE(state->swap_type[image_index]) ?
+           BOOT_SECONDARY_SLOT : BOOT_PRIMARY_SLOT;
+#else
+    return state->slot_usage[image_index].active_slot;
+#endif
+}
+
 /**
- * Iterate over all the images and verify whether the image dependencies in the
- * TLV area are all satisfied and update the related swap type if necessary.
+ * Verify the dependencies of a slot against the images which will be booted.
+ *
+ * @param image_index       Index of the image.
+ * @param slot              Image slot number.
+ * @param unmet             Set to whether each image is depended on at a
+ *                          higher version than the one which will be booted;
+ *                          may be NULL.
+ *
+ * @return                  0 if all the dependencies are satisfied; nonzero
+ *                          otherwise.
  */
 static int
-boot_verify_dependencies(struct boot_loader_state *state)
+boot_verify_slot_dependencies(struct boot_loader_state *state,
+                              uint8_t image_index, uint32_t slot,
+                              bool *unmet)
 {
-    int rc = -1;
-    uint8_t slot;
+    const struct image_version *dep_version;
+    uint8_t i;
+    int rc;
 
-    BOOT_CURR_IMG(state) = 0;
-    while (BOOT_CURR_IMG(state) < BOOT_IMAGE_NUMBER) {
-        if (state->img_mask[BOOT_CURR_IMG(state)]) {
-            BOOT_CURR_IMG(state)++;
+    rc = boot_read_slot_dependencies(state, image_index, slot);
+    if (rc != 0) {
+        return rc;
+    }
+
+    for (i = 0; i < BOOT_IMAGE_NUMBER; i++) {
+        if (unmet != NULL) {
+            unmet[i] = false;
+        }
+        if (!state->deps[image_index][slot].on[i]) {
             continue;
         }
-        if (BOOT_SWAP_TYPE(state) != BOOT_SWAP_TYPE_NONE &&
-            BOOT_SWAP_TYPE(state) != BOOT_SWAP_TYPE_FAIL) {
-            slot = BOOT_SECONDARY_SLOT;
-        } else {
-            slot = BOOT_PRIMARY_SLOT;
+
+        dep_version = &state->imgs[i][boot_dependency_slot(state, i)].hdr.ih_ver;
+        if (boot_version_cmp(dep_version,
+                             &state->deps[image_index][slot].min_ver[i]) < 0) {
+            /* Dependency not satisfied. */
+            rc = -1;
+            if (unmet == NULL) {
+                break;
+            }
+            unmet[i] = true;
         }
+    }
 
-        rc = boot_verify_slot_dependencies(state, slot);
-        if (rc == 0) {
-            /* All dependencies've been satisfied, continue with next image. */
-            BOOT_CURR_IMG(state)++;
-        } else {
-            /* Cannot upgrade due to non-met dependencies, so disable all
-             * image upgrades.
+    return rc;
+}
+
+#if !defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)
+/**
+ * Find the largest set of upgrades whose dependencies are satisfied, and
+ * cancel the others.
+ *
+ * The dependency TLVs of every image are read once, then the dependencies of
+ * each image on the images which will be booted are checked again, from
+ * memory, every time an upgrade is cancelled. An upgrade is cancelled if the
+ * image it installs has an unsatisfied dependency, or if it installs an
+ * image which is older than a dependency of another image requires. This
+ * ends after at most one pass per image, when no more upgrades are
+ * cancelled.
+ *
+ * @return                  0 if no upgrade had to be cancelled; nonzero
+ *                          otherwise.
+ */
+static int
+boot_verify_dependencies(struct boot_loader_state *state)
+{
+    bool unmet[BOOT_IMAGE_NUMBER];
+    bool changed;
+    uint8_t image_index;
+    uint8_t i;
+    uint8_t swap_type;
+    int rc = 0;
+
+    do {
+        changed = false;
+
+        for (image_index = 0; image_index < BOOT_IMAGE_NUMBER; image_index++) {
+            if (state->img_mask[image_index]) {
+                continue;
+            }
+
+            if (boot_verify_slot_dependencies(state, image_index,
+                    boot_dependency_slot(state, image_index), unmet) == 0) {
+                continue;
+            }
+
+            swap_type = state->swap_type[image_index];
+            if (swap_type == BOOT_SWAP_TYPE_TEST ||
+                swap_type == BOOT_SWAP_TYPE_PERM) {
+                BOOT_LOG_WRN("Image %d: dependencies not satisfied, "
+                             "upgrade cancelled", image_index);
+                state->swap_type[image_index] = BOOT_SWAP_TYPE_NONE;
+                changed = true;
+                rc = -1;
+                continue;
+            }
+
+            /* The image stays in place: cancel instead the upgrades which
+             * install an image too old for it.
              */
-            for (int idx = 0; idx < BOOT_IMAGE_NUMBER; idx++) {
-                BOOT_CURR_IMG(state) = idx;
-                BOOT_SWAP_TYPE(state) = BOOT_SWAP_TYPE_NONE;
+            for (i = 0; i < BOOT_IMAGE_NUMBER; i++) {
+                swap_type = state->swap_type[i];
+                if (unmet[i] && (swap_type == BOOT_SWAP_TYPE_TEST ||
+                                 swap_type == BOOT_SWAP_TYPE_PERM)) {
+                    BOOT_LOG_WRN("Image %d: required by image %d at a "
+                                 "higher version, upgrade cancelled",
+                                 i, image_index);
+                    state->swap_type[i] = BOOT_SWAP_TYPE_NONE;
+                    changed = true;
+                    rc = -1;
+                }
             }
-            break;
         }
-    }
+    } while (changed);
+
     return rc;
 }
 #else
@@ -500,7 +830,8 @@ boot_verify_dependencies(struct boot_loader_state *state)
             continue;
         }
         active_slot = state->slot_usage[BOOT_CURR_IMG(state)].active_slot;
-        rc = boot_verify_slot_dependencies(state, active_slot);
+        rc = boot_verify_slot_dependencies(state, BOOT_CURR_IMG(state),
+                                           active_slot, NULL);
         if (rc != 0) {
             /* Dependencies not met or invalid dependencies. */
 
@@ -519,89 +850,21 @@ boot_verify_dependencies(struct boot_loader_state *state)
 }
 #endif
 
-/**
- * Read all dependency TLVs of an image from the flash and verify
- * one after another to see if they are all satisfied.
- *
- * @param slot              Image slot number.
- *
- * @return                  0 on success; nonzero on failure.
- */
-static int
-boot_verify_slot_dependencies(struct boot_loader_state *state, uint32_t slot)
-{
-    const struct flash_area *fap;
-    struct image_tlv_iter it;
-    struct image_dependency dep;
-    uint32_t off;
-    uint16_t len;
-    int area_id;
-    int rc;
+#endif /* (BOOT_IMAGE_NUMBER > 1) */
 
-    area_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), slot);
-    rc = flash_area_open(area_id, &fap);
-    if (rc != 0) {
-        rc = BOOT_EFLASH;
-        goto done;
-    }
-
-    rc = bootutil_tlv_iter_begin(&it, boot_img_hdr(state, slot), fap,
-            IMAGE_TLV_DEPENDENCY, true);
-    if (rc != 0) {
-        goto done;
-    }
-
-    while (true) {
-        rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
-        if (rc < 0) {
-            return -1;
-        } else if (rc > 0) {
-            rc = 0;
-            break;
-        }
-
-        if (len != sizeof(dep)) {
-            rc = BOOT_EBADIMAGE;
-            goto done;
-        }
-
-        rc = LOAD_IMAGE_DATA(boot_img_hdr(state, slot),
-                             fap, off, &dep, len);
-        if (rc != 0) {
-            rc = BOOT_EFLASH;
-            goto done;
-        }
-
-        if (dep.image_id >= BOOT_IMAGE_NUMBER) {
-            rc = BOOT_EBADARGS;
-            goto done;
-        }
-
-        /* Verify dependency and modify the swap type if not satisfied. */
-        rc = boot_verify_slot_dependency(state, &dep);
-        if (rc != 0) {
-            /* Dependency not satisfied */
-            goto done;
-        }
-    }
-
-done:
-    flash_area_close(fap);
-    return rc;
-}
-
-#endif /* (BOOT_IMAGE_NUMBER > 1) */
-
-#if !defined(MCUBOOT_DIRECT_XIP)
+#if !defined(MCUBOOT_DIRECT_XIP)
 
 #if !defined(MCUBOOT_RAM_LOAD)
 static uint32_t
 boot_write_sz(struct boot_loader_state *state)
 {
     uint32_t elem_sz;
-#if MCUBOOT_SWAP_USING_SCRATCH
+#if MCUBOOT_SWAP_USING_SCRATCH || defined(MCUBOOT_SWAP_STATUS_PARTITION)
     uint32_t align;
 #endif
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+    const struct flash_area *fap;
+#endif
 
     /* Figure out what size to write update status update as.  The size depends
      * on what the minimum write size is for scratch area, active image slot.
@@ -614,6 +877,16 @@ boot_write_sz(struct boot_loader_state *state)
         elem_sz = align;
     }
 #endif
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+    /* The status entries are written to the swap status partition. */
+    if (flash_area_open(FLASH_AREA_SWAP_STATUS, &fap) == 0) {
+        align = flash_area_align(fap);
+        flash_area_close(fap);
+        if (align > elem_sz) {
+            elem_sz = align;
+        }
+    }
+#endif
 
     return elem_sz;
 }
@@ -696,7 +969,6 @@ boot_write_status(const struct boot_loader_state *state, struct boot_status *bs)
 {
     const struct flash_area *fap;
     uint32_t off;
-    int area_id;
     int rc = 0;
     uint8_t buf[BOOT_MAX_ALIGN];
     uint32_t align;
@@ -708,29 +980,48 @@ boot_write_status(const struct boot_loader_state *state, struct boot_status *bs)
      *       the primary slot!
      */
 
+#if defined(MCUBOOT_SWAP_STATUS_PARTITION)
+    /* Write to the log of the image in the swap status partition. */
+    rc = swap_status_area_open(state, &fap, &off);
+    if (rc != 0) {
+        return rc;
+    }
+#else
 #if MCUBOOT_SWAP_USING_SCRATCH
     if (bs->use_scratch) {
         /* Write to scratch. */
-        area_id = FLASH_AREA_IMAGE_SCRATCH;
+        fap = BOOT_SCRATCH_AREA(state);
     } else {
 #endif
         /* Write to the primary slot. */
-        area_id = FLASH_AREA_IMAGE_PRIMARY(BOOT_CURR_IMG(state));
+        fap = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
 #if MCUBOOT_SWAP_USING_SCRATCH
     }
 #endif
+    off = boot_status_off(fap);
+#endif /* MCUBOOT_SWAP_STATUS_PARTITION */
 
-    rc = flash_area_open(area_id, &fap);
+    off += boot_status_internal_off(bs, BOOT_STATUS_ELEM_SZ(state));
+    align = flash_area_align(fap);
+    erased_val = flash_area_erased_val(fap);
+#ifdef MCUBOOT_SWAP_STATUS_PACKED
+    /* The write unit holding the entry is programmed again, with the entries
+     * already written in it left as they are.
+     */
+    (void)erased_val;
+    rc = flash_area_read(fap, ALIGN_DOWN(off, align), buf, align);
     if (rc != 0) {
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+        flash_area_close(fap);
+#endif
         return BOOT_EFLASH;
     }
-
-    off = boot_status_off(fap) +
-          boot_status_internal_off(bs, BOOT_WRITE_SZ(state));
-    align = flash_area_align(fap);
-    erased_val = flash_area_erased_val(fap);
+    buf[off % align] = bs->state;
+    off = ALIGN_DOWN(off, align);
+#else
     memset(buf, erased_val, BOOT_MAX_ALIGN);
     buf[0] = bs->state;
+#endif
 
     BOOT_LOG_DBG("writing swap status; fa_id=%d off=0x%lx (0x%lx)",
                  flash_area_get_id(fap), (unsigned long)off,
@@ -741,7 +1032,9 @@ boot_write_status(const struct boot_loader_state *state, struct boot_status *bs)
         rc = BOOT_EFLASH;
     }
 
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
     flash_area_close(fap);
+#endif
 
     return rc;
 }
@@ -751,11 +1044,100 @@ boot_write_status(const struct boot_loader_state *state, struct boot_status *bs)
 /*
  * Validate image hash/signature and optionally the security counter in a slot.
  */
+#ifdef MCUBOOT_PENDING_DIGEST
+/*
+ * Read the digest stored by the application after the TLVs of the image in
+ * the secondary slot. It is only returned if the record lies in front of the
+ * swap status area and its MAC matches the image header and the digest.
+ */
 static fih_ret
-boot_image_check(struct boot_loader_state *state, struct image_header *hdr,
-                 const struct flash_area *fap, struct boot_status *bs)
+boot_pending_digest_read(struct boot_loader_state *state,
+                         const struct image_header *hdr,
+                         const struct flash_area *fap, uint8_t *digest)
+{
+    struct boot_pending_digest rec;
+    uint8_t mac[BOOT_PENDING_DIGEST_MAC_SZ];
+    uint32_t off;
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    rc = boot_pending_digest_off(fap, hdr, &off);
+    if (rc != 0 || off > boot_status_off(fap) ||
+        boot_status_off(fap) - off < sizeof(rec)) {
+        FIH_RET(fih_rc);
+    }
+
+    rc = flash_area_read(fap, off, &rec, sizeof(rec));
+    if (rc != 0 || rec.magic != BOOT_PENDING_DIGEST_MAGIC) {
+        FIH_RET(fih_rc);
+    }
+
+    rc = boot_pending_digest_mac(BOOT_CURR_IMG(state), hdr, rec.digest, mac);
+    if (rc != 0) {
+        FIH_RET(fih_rc);
+    }
+
+    FIH_CALL(boot_fih_memequal, fih_rc, mac, rec.mac, sizeof(mac));
+    if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+        memcpy(digest, rec.digest, IMAGE_HASH_SIZE);
+    }
+
+    FIH_RET(fih_rc);
+}
+#endif
+
+#ifdef MCUBOOT_ENC_XIP
+/**
+ * Loads the key of the encrypted image in the given slot area, to decrypt it
+ * while it is validated, and keeps it to program the decryption engine with
+ * if the image is booted.
+ *
+ * @param  state        Boot loader status information.
+ * @param  hdr          Header of the image.
+ * @param  fap          Flash area of the slot.
+ *
+ * @return              0 on success; nonzero on failure.
+ */
+static int
+boot_enc_xip_load_key(struct boot_loader_state *state,
+                      const struct image_header *hdr,
+                      const struct flash_area *fap)
 {
-    TARGET_STATIC uint8_t tmpbuf[BOOT_TMPBUF_SZ];
+    struct boot_status bs;
+    int slot;
+    int rc;
+
+    slot = flash_area_id_to_multi_image_slot(BOOT_CURR_IMG(state),
+                                             flash_area_get_id(fap));
+    if (slot < 0) {
+        return -1;
+    }
+
+    rc = boot_enc_load(BOOT_CURR_ENC(state), slot, hdr, fap, &bs);
+    if (rc < 0) {
+        return rc;
+    }
+
+    /* if rc > 0 then the key has already been loaded */
+    if (rc == 0) {
+        if (boot_enc_set_key(BOOT_CURR_ENC(state), slot, &bs)) {
+            return -1;
+        }
+        memcpy(state->slot_usage[BOOT_CURR_IMG(state)].enc_key[slot],
+               bs.enckey[slot], BOOT_ENC_KEY_SIZE);
+        memset(bs.enckey[slot], 0, BOOT_ENC_KEY_SIZE);
+    }
+
+    return 0;
+}
+#endif /* MCUBOOT_ENC_XIP */
+
+static fih_ret
+boot_image_check_hash(struct boot_loader_state *state,
+                      struct image_header *hdr, const struct flash_area *fap,
+                      struct boot_status *bs, uint8_t *out_hash)
+{
+    BOOT_WORK_BUF(tmpbuf);
     int rc;
     FIH_DECLARE(fih_rc, FIH_FAILURE);
 
@@ -770,6 +1152,13 @@ boot_image_check(struct boot_loader_state *state, struct image_header *hdr,
  * decrypted when copied in ram */
 #if defined(MCUBOOT_ENC_IMAGES) && !defined(MCUBOOT_RAM_LOAD)
     if (MUST_DECRYPT(fap, BOOT_CURR_IMG(state), hdr)) {
+#ifdef MCUBOOT_ENC_XIP
+        /* Direct-XIP validates slots without a boot status to load the key
+         * in. */
+        if (boot_enc_xip_load_key(state, hdr, fap) != 0) {
+            FIH_RET(fih_rc);
+        }
+#else
         rc = boot_enc_load(BOOT_CURR_ENC(state), 1, hdr, fap, bs);
         if (rc < 0) {
             FIH_RET(fih_rc);
@@ -777,157 +1166,471 @@ boot_image_check(struct boot_loader_state *state, struct image_header *hdr,
         if (rc == 0 && boot_enc_set_key(BOOT_CURR_ENC(state), 1, bs)) {
             FIH_RET(fih_rc);
         }
+#endif
+    }
+#endif
+
+#if defined(MCUBOOT_PARALLEL_VALIDATION) && !defined(MCUBOOT_DIRECT_XIP)
+    /* The primary slot was already hashed on another core. */
+    if (fap == BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT) &&
+        state->primary_hash[BOOT_CURR_IMG(state)].valid) {
+        state->primary_hash[BOOT_CURR_IMG(state)].valid = false;
+        FIH_CALL(bootutil_img_validate_digest, fih_rc, BOOT_CURR_IMG(state),
+                 hdr, fap, tmpbuf, BOOT_WORK_BUF_SZ,
+                 state->primary_hash[BOOT_CURR_IMG(state)].hash);
+        if (out_hash != NULL) {
+            memcpy(out_hash, state->primary_hash[BOOT_CURR_IMG(state)].hash,
+                   IMAGE_HASH_SIZE);
+        }
+        FIH_RET(fih_rc);
+    }
+#endif
+
+#if defined(MCUBOOT_RAM_LOAD_HASH_COPY) || defined(MCUBOOT_RAM_LOAD_SEGMENTS) || \
+    (defined(MCUBOOT_PARALLEL_VALIDATION) && defined(MCUBOOT_DIRECT_XIP))
+    /* The image was already hashed, while it was copied to RAM or on another
+     * core, only its TLVs are left to check. The hash is only used once.
+     */
+    if (state->slot_usage[BOOT_CURR_IMG(state)].img_hash_valid) {
+        state->slot_usage[BOOT_CURR_IMG(state)].img_hash_valid = false;
+        FIH_CALL(bootutil_img_validate_digest, fih_rc, BOOT_CURR_IMG(state),
+                 hdr, fap, tmpbuf, BOOT_WORK_BUF_SZ,
+                 state->slot_usage[BOOT_CURR_IMG(state)].img_hash);
+        if (out_hash != NULL) {
+            memcpy(out_hash, state->slot_usage[BOOT_CURR_IMG(state)].img_hash,
+                   IMAGE_HASH_SIZE);
+        }
+        FIH_RET(fih_rc);
+    }
+#endif
+
+#ifdef MCUBOOT_PENDING_DIGEST
+    /* The upgrade was already hashed by the application when it received it,
+     * only its TLVs are left to check. A digest that does not match them
+     * falls back to hashing the image.
+     */
+    if (fap == BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT) && !IS_ENCRYPTED(hdr)) {
+        uint8_t digest[IMAGE_HASH_SIZE];
+
+        FIH_CALL(boot_pending_digest_read, fih_rc, state, hdr, fap, digest);
+        if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+            FIH_CALL(bootutil_img_validate_digest, fih_rc, BOOT_CURR_IMG(state),
+                     hdr, fap, tmpbuf, BOOT_WORK_BUF_SZ, digest);
+            if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+                if (out_hash != NULL) {
+                    memcpy(out_hash, digest, IMAGE_HASH_SIZE);
+                }
+                FIH_RET(fih_rc);
+            }
+            BOOT_LOG_WRN("Image %d: pending digest rejected, hashing the image",
+                         BOOT_CURR_IMG(state));
+        }
     }
 #endif
 
     FIH_CALL(bootutil_img_validate, fih_rc, BOOT_CURR_ENC(state),
-             BOOT_CURR_IMG(state), hdr, fap, tmpbuf, BOOT_TMPBUF_SZ,
-             NULL, 0, NULL);
+             BOOT_CURR_IMG(state), hdr, fap, tmpbuf, BOOT_WORK_BUF_SZ,
+             NULL, 0, out_hash);
 
     FIH_RET(fih_rc);
 }
 
-#if !defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)
 static fih_ret
-split_image_check(struct image_header *app_hdr,
-                  const struct flash_area *app_fap,
-                  struct image_header *loader_hdr,
-                  const struct flash_area *loader_fap)
+boot_image_check(struct boot_loader_state *state, struct image_header *hdr,
+                 const struct flash_area *fap, struct boot_status *bs)
 {
-    static void *tmpbuf;
-    uint8_t loader_hash[32];
     FIH_DECLARE(fih_rc, FIH_FAILURE);
-
-    if (!tmpbuf) {
-        tmpbuf = malloc(BOOT_TMPBUF_SZ);
-        if (!tmpbuf) {
-            goto out;
-        }
-    }
-
-    FIH_CALL(bootutil_img_validate, fih_rc, NULL, 0, loader_hdr, loader_fap,
-             tmpbuf, BOOT_TMPBUF_SZ, NULL, 0, loader_hash);
-    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
-        FIH_RET(fih_rc);
+#ifdef MCUBOOT_MEASURED_BOOT
+    int slot;
+
+    /* The hash is kept as the measurement of the image, if it is valid. */
+    slot = boot_measured_slot(state, fap);
+    state->measured[BOOT_CURR_IMG(state)][slot].valid = false;
+    FIH_CALL(boot_image_check_hash, fih_rc, state, hdr, fap, bs,
+             state->measured[BOOT_CURR_IMG(state)][slot].hash);
+    if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+        state->measured[BOOT_CURR_IMG(state)][slot].valid = true;
     }
+#else
+    FIH_CALL(boot_image_check_hash, fih_rc, state, hdr, fap, bs, NULL);
+#endif
 
-    FIH_CALL(bootutil_img_validate, fih_rc, NULL, 0, app_hdr, app_fap,
-             tmpbuf, BOOT_TMPBUF_SZ, loader_hash, 32, NULL);
-
-out:
     FIH_RET(fih_rc);
 }
-#endif /* !MCUBOOT_DIRECT_XIP && !MCUBOOT_RAM_LOAD */
 
+#if defined(MCUBOOT_HW_ROLLBACK_PROT) && \
+    (defined(MCUBOOT_VALIDATION_CACHE) || defined(MCUBOOT_IMAGE_VERDICT_HOOKS))
 /*
- * Check that this is a valid header.  Valid means that the magic is
- * correct, and that the sizes/offsets are "sane".  Sane means that
- * there is no overflow on the arithmetic, and that the result fits
- * within the flash area we are in. Also check the flags in the image
- * and class the image as invalid if flags for encryption/compression
- * are present but these features are not enabled.
+ * Check the security counter of an image whose validation is skipped. It may
+ * have been increased since the image was validated, so it is always checked
+ * again.
  */
-static bool
-boot_is_header_valid(const struct image_header *hdr, const struct flash_area *fap,
-                     struct boot_loader_state *state)
+static fih_ret
+boot_image_check_security_cnt(struct boot_loader_state *state,
+                              struct image_header *hdr,
+                              const struct flash_area *fap)
 {
-    uint32_t size;
-
-    (void)state;
+    uint32_t img_security_cnt;
+    fih_int security_cnt = fih_int_encode(INT_MAX);
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
 
-    if (hdr->ih_magic != IMAGE_MAGIC) {
-        return false;
+    if (bootutil_get_img_security_cnt(hdr, fap, &img_security_cnt) != 0) {
+        FIH_RET(FIH_FAILURE);
     }
 
-    if (!boot_u32_safe_add(&size, hdr->ih_img_size, hdr->ih_hdr_size)) {
-        return false;
+    FIH_CALL(boot_security_counter_get, fih_rc, BOOT_CURR_IMG(state),
+             &security_cnt);
+    if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+        fih_rc = fih_ret_encode_zero_equality(img_security_cnt <
+                       (uint32_t)fih_int_decode(security_cnt));
     }
 
-#ifdef MCUBOOT_DECOMPRESS_IMAGES
-    if (!MUST_DECOMPRESS(fap, BOOT_CURR_IMG(state), hdr)) {
-#else
-    if (1) {
+    FIH_RET(fih_rc);
+}
 #endif
-        if (!boot_u32_safe_add(&size, size, hdr->ih_protect_tlv_size)) {
-            return false;
-        }
-    }
-
-    if (size >= flash_area_get_size(fap)) {
-        return false;
-    }
 
-#if !defined(MCUBOOT_ENC_IMAGES)
-    if (IS_ENCRYPTED(hdr)) {
-        return false;
-    }
-#else
-    if ((hdr->ih_flags & IMAGE_F_ENCRYPTED_AES128) &&
-        (hdr->ih_flags & IMAGE_F_ENCRYPTED_AES256))
-    {
-        return false;
-    }
+#ifdef MCUBOOT_IMAGE_VERDICT_HOOKS
+#ifndef MCUBOOT_IMAGE_ACCESS_HOOKS
+#error "MCUBOOT_IMAGE_VERDICT_HOOKS requires MCUBOOT_IMAGE_ACCESS_HOOKS"
 #endif
-
-#if !defined(MCUBOOT_DECOMPRESS_IMAGES)
-    if (IS_COMPRESSED(hdr)) {
-        return false;
-    }
-#else
-    if ((hdr->ih_flags & IMAGE_F_COMPRESSED_LZMA1) &&
-        (hdr->ih_flags & IMAGE_F_COMPRESSED_LZMA2))
-    {
-        return false;
-    }
+#ifdef MCUBOOT_VALIDATION_CACHE
+#error "MCUBOOT_IMAGE_VERDICT_HOOKS and MCUBOOT_VALIDATION_CACHE are mutually exclusive"
 #endif
 
-    return true;
-}
+/* Digests a verdict of the platform is bound to, see boot_hooks.h. */
+struct boot_image_verdict {
+    bool bound;
+    uint8_t hdr_digest[IMAGE_HASH_SIZE];
+    uint8_t img_hash[IMAGE_HASH_SIZE];
+};
 
 /*
- * Check that a memory area consists of a given value.
+ * Look up the verdict the platform holds on the image in a slot.
+ *
+ * @returns
+ *         FIH_SUCCESS                      if the image is known to be valid
+ *         FIH_FAILURE                      if the image is known to be invalid
+ *         FIH_BOOT_HOOK_REGULAR            if the image has to be validated
  */
-static inline bool
-boot_data_is_set_to(uint8_t val, void *data, size_t len)
+static fih_ret
+boot_image_verdict_lookup(struct boot_loader_state *state, int slot,
+                          struct image_header *hdr,
+                          const struct flash_area *fap,
+                          struct boot_image_verdict *verdict)
 {
-    uint8_t i;
-    uint8_t *p = (uint8_t *)data;
-    for (i = 0; i < len; i++) {
-        if (val != p[i]) {
-            return false;
-        }
+    FIH_DECLARE(fih_rc, FIH_BOOT_HOOK_REGULAR);
+
+    /* Without a hash TLV, the image will not pass the validation anyway. */
+    verdict->bound = (boot_image_digests(hdr, fap, verdict->hdr_digest,
+                                         verdict->img_hash) == 0);
+    if (!verdict->bound) {
+        FIH_RET(fih_rc);
     }
-    return true;
+
+    FIH_CALL(boot_image_verdict_lookup_hook, fih_rc, BOOT_CURR_IMG(state),
+             slot, verdict->hdr_digest, verdict->img_hash);
+#ifdef MCUBOOT_HW_ROLLBACK_PROT
+    if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+        FIH_CALL(boot_image_check_security_cnt, fih_rc, state, hdr, fap);
+    }
+#endif
+    if (FIH_NOT_EQ(fih_rc, FIH_BOOT_HOOK_REGULAR)) {
+        BOOT_LOG_DBG("Image %d: verdict of the platform for slot %d: %s",
+                     BOOT_CURR_IMG(state), slot,
+                     FIH_EQ(fih_rc, FIH_SUCCESS) ? "valid" : "invalid");
+    }
+
+    FIH_RET(fih_rc);
 }
+#endif /* MCUBOOT_IMAGE_VERDICT_HOOKS */
+
+#ifdef MCUBOOT_VALIDATION_CACHE
+#ifdef MCUBOOT_RAM_LOAD
+#error "MCUBOOT_VALIDATION_CACHE is not supported with MCUBOOT_RAM_LOAD"
+#endif
 
+/*
+ * Build the validation record describing the image currently in a slot: the
+ * erase generation of the slot, a digest of the header and the value of the
+ * image hash TLV.
+ */
 static int
-boot_check_header_erased(struct boot_loader_state *state, int slot)
+boot_validation_record_make(struct boot_loader_state *state,
+                            struct image_header *hdr,
+                            const struct flash_area *fap,
+                            struct boot_validation_record *rec)
 {
-    const struct flash_area *fap;
-    struct image_header *hdr;
-    uint8_t erased_val;
-    int area_id;
     int rc;
 
-    area_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), slot);
-    rc = flash_area_open(area_id, &fap);
-    if (rc != 0) {
-        return -1;
-    }
-
-    erased_val = flash_area_erased_val(fap);
-    flash_area_close(fap);
+    memset(rec, 0, sizeof(*rec));
+    rec->magic = BOOT_VALIDATION_RECORD_MAGIC;
 
-    hdr = boot_img_hdr(state, slot);
-    if (!boot_data_is_set_to(erased_val, &hdr->ih_magic, sizeof(hdr->ih_magic))) {
-        return -1;
+    rc = boot_validation_cache_generation(BOOT_CURR_IMG(state),
+                                          &rec->generation);
+    if (rc != 0) {
+        return rc;
     }
 
-    return 0;
+    return boot_image_digests(hdr, fap, rec->hdr_digest, rec->img_hash);
 }
 
-#if defined(MCUBOOT_DIRECT_XIP)
-/**
+/*
+ * Validate the image in the primary slot, skipping the hash/signature check
+ * if the stored validation record matches the image currently in the slot.
+ * The record is refreshed after every successful full validation.
+ */
+static fih_ret
+boot_image_check_cached(struct boot_loader_state *state,
+                        struct image_header *hdr,
+                        const struct flash_area *fap, struct boot_status *bs)
+{
+    struct boot_validation_record cur;
+    struct boot_validation_record cached;
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+#ifdef MCUBOOT_VALIDATION_CACHE_UPGRADE
+    struct boot_validation_record *upgrade;
+    bool from_upgrade = false;
+#endif
+
+    rc = boot_validation_record_make(state, hdr, fap, &cur);
+#ifdef MCUBOOT_VALIDATION_CACHE_UPGRADE
+    /* An image installed during this boot has been fully validated in the
+     * secondary slot already. Only its header and hash TLV are compared,
+     * the generation of the slot has changed with the copy.
+     */
+    upgrade = &state->upgrade_rec[BOOT_CURR_IMG(state)];
+    if (rc == 0 && state->upgrade_installed[BOOT_CURR_IMG(state)] &&
+        upgrade->magic == BOOT_VALIDATION_RECORD_MAGIC) {
+        upgrade->generation = cur.generation;
+        FIH_CALL(boot_fih_memequal, fih_rc, &cur, upgrade, sizeof(cur));
+        from_upgrade = FIH_EQ(fih_rc, FIH_SUCCESS);
+    }
+#endif
+    if (rc == 0 && FIH_NOT_EQ(fih_rc, FIH_SUCCESS) &&
+        boot_validation_cache_read(BOOT_CURR_IMG(state), &cached) == 0) {
+        FIH_CALL(boot_fih_memequal, fih_rc, &cur, &cached, sizeof(cur));
+    }
+    if (rc == 0) {
+#ifdef MCUBOOT_HW_ROLLBACK_PROT
+        if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+            FIH_CALL(boot_image_check_security_cnt, fih_rc, state, hdr, fap);
+        }
+#endif
+        if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+            BOOT_LOG_DBG("Image %d: validation cache hit",
+                         BOOT_CURR_IMG(state));
+#ifdef MCUBOOT_VALIDATION_CACHE_UPGRADE
+            if (from_upgrade &&
+                boot_validation_cache_write(BOOT_CURR_IMG(state), &cur) != 0) {
+                BOOT_LOG_WRN("Image %d: failed to store validation record",
+                             BOOT_CURR_IMG(state));
+            }
+#endif
+            FIH_RET(fih_rc);
+        }
+    }
+
+    boot_phase_start(BOOT_PHASE_VALIDATE);
+    FIH_CALL(boot_image_check, fih_rc, state, hdr, fap, bs);
+    boot_phase_stop(BOOT_PHASE_VALIDATE);
+    if (rc == 0 && FIH_EQ(fih_rc, FIH_SUCCESS)) {
+        rc = boot_validation_cache_write(BOOT_CURR_IMG(state), &cur);
+        if (rc != 0) {
+            BOOT_LOG_WRN("Image %d: failed to store validation record",
+                         BOOT_CURR_IMG(state));
+        }
+    }
+
+    FIH_RET(fih_rc);
+}
+
+#ifdef MCUBOOT_VALIDATION_CACHE_UPGRADE
+/*
+ * Keep the validation record of the image just checked in the secondary
+ * slot, so that it does not have to be validated again once installed.
+ */
+static void
+boot_validation_upgrade_note(struct boot_loader_state *state,
+                             struct image_header *hdr,
+                             const struct flash_area *fap, fih_ret fih_rc)
+{
+    struct boot_validation_record *upgrade;
+
+    upgrade = &state->upgrade_rec[BOOT_CURR_IMG(state)];
+    state->upgrade_installed[BOOT_CURR_IMG(state)] = false;
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS) ||
+        boot_validation_record_make(state, hdr, fap, upgrade) != 0) {
+        memset(upgrade, 0, sizeof(*upgrade));
+    }
+}
+#endif
+#endif /* MCUBOOT_VALIDATION_CACHE */
+
+#if !defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)
+/*
+ * Hash of the loader image, kept once it has been validated so that further
+ * calls to split_go() only hash the application. It is only used again for
+ * the same flash area and image header.
+ */
+static struct {
+    bool valid;
+    uint8_t fa_id;
+    struct image_header hdr;
+    uint8_t hash[32];
+} split_loader_hash;
+
+static fih_ret
+split_image_check(struct image_header *app_hdr,
+                  const struct flash_area *app_fap,
+                  struct image_header *loader_hdr,
+                  const struct flash_area *loader_fap)
+{
+    BOOT_WORK_BUF(tmpbuf);
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    if (!split_loader_hash.valid ||
+        split_loader_hash.fa_id != flash_area_get_id(loader_fap) ||
+        memcmp(&split_loader_hash.hdr, loader_hdr, sizeof(*loader_hdr)) != 0) {
+        split_loader_hash.valid = false;
+
+        FIH_CALL(bootutil_img_validate, fih_rc, NULL, 0, loader_hdr, loader_fap,
+                 tmpbuf, BOOT_WORK_BUF_SZ, NULL, 0, split_loader_hash.hash);
+        if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+            FIH_RET(fih_rc);
+        }
+
+        split_loader_hash.fa_id = flash_area_get_id(loader_fap);
+        memcpy(&split_loader_hash.hdr, loader_hdr, sizeof(*loader_hdr));
+        split_loader_hash.valid = true;
+    }
+
+    FIH_CALL(bootutil_img_validate, fih_rc, NULL, 0, app_hdr, app_fap,
+             tmpbuf, BOOT_WORK_BUF_SZ, split_loader_hash.hash,
+             sizeof(split_loader_hash.hash), NULL);
+
+    FIH_RET(fih_rc);
+}
+#endif /* !MCUBOOT_DIRECT_XIP && !MCUBOOT_RAM_LOAD */
+
+/*
+ * Check that this is a valid header.  Valid means that the magic is
+ * correct, and that the sizes/offsets are "sane".  Sane means that
+ * there is no overflow on the arithmetic, and that the result fits
+ * within the flash area we are in. Also check the flags in the image
+ * and class the image as invalid if flags for encryption/compression
+ * are present but these features are not enabled.
+ */
+static bool
+boot_is_header_valid(const struct image_header *hdr, const struct flash_area *fap,
+                     struct boot_loader_state *state)
+{
+    uint32_t size;
+
+    (void)state;
+
+    if (hdr->ih_magic != IMAGE_MAGIC) {
+        return false;
+    }
+
+    if (!boot_u32_safe_add(&size, hdr->ih_img_size, hdr->ih_hdr_size)) {
+        return false;
+    }
+
+#ifdef MCUBOOT_DECOMPRESS_IMAGES
+    if (!MUST_DECOMPRESS(fap, BOOT_CURR_IMG(state), hdr)) {
+#else
+    if (1) {
+#endif
+        if (!boot_u32_safe_add(&size, size, hdr->ih_protect_tlv_size)) {
+            return false;
+        }
+    }
+
+    if (size >= flash_area_get_size(fap)) {
+        return false;
+    }
+
+#if !defined(MCUBOOT_ENC_IMAGES)
+    if (IS_ENCRYPTED(hdr)) {
+        return false;
+    }
+#else
+    if ((hdr->ih_flags & IMAGE_F_ENCRYPTED_AES128) &&
+        (hdr->ih_flags & IMAGE_F_ENCRYPTED_AES256))
+    {
+        return false;
+    }
+#endif
+
+#if defined(MCUBOOT_ENC_GCM)
+    /* The payload of every encrypted image is authenticated by a GCM tag */
+    if (IS_ENCRYPTED(hdr) != ((hdr->ih_flags & IMAGE_F_ENCRYPTED_GCM) != 0)) {
+        return false;
+    }
+#else
+    if (hdr->ih_flags & IMAGE_F_ENCRYPTED_GCM) {
+        return false;
+    }
+#endif
+
+#if !defined(MCUBOOT_DECOMPRESS_IMAGES)
+    if (IS_COMPRESSED(hdr)) {
+        return false;
+    }
+#else
+    if ((hdr->ih_flags & IMAGE_F_COMPRESSED_LZMA1) &&
+        (hdr->ih_flags & IMAGE_F_COMPRESSED_LZMA2))
+    {
+        return false;
+    }
+
+    /* Compressed images are only decompressed from the secondary slot. */
+    if (IS_COMPRESSED(hdr) &&
+        (!MUST_DECOMPRESS(fap, BOOT_CURR_IMG(state), hdr) ||
+         !boot_is_compressed_header_valid(hdr, fap, state))) {
+        return false;
+    }
+#endif
+
+#if !defined(MCUBOOT_HASH_CHUNKS)
+    if (hdr->ih_flags & IMAGE_F_HASH_CHUNKED) {
+        return false;
+    }
+#else
+    if ((hdr->ih_flags & IMAGE_F_HASH_CHUNKED) && IS_ENCRYPTED(hdr)) {
+        return false;
+    }
+#endif
+
+    /* A delta image is only a patch; boot_delta_apply() replaces it by the
+     * image it describes before the secondary slot gets validated.
+     */
+    if (hdr->ih_flags & IMAGE_F_DELTA) {
+        return false;
+    }
+
+    return true;
+}
+
+static int
+boot_check_header_erased(struct boot_loader_state *state, int slot)
+{
+    const struct flash_area *fap;
+    struct image_header *hdr;
+
+    fap = BOOT_IMG_AREA(state, slot);
+    hdr = boot_img_hdr(state, slot);
+    if (!bootutil_buffer_is_erased(fap, &hdr->ih_magic,
+                                   sizeof(hdr->ih_magic))) {
+        return -1;
+    }
+
+    return 0;
+}
+
+#if defined(MCUBOOT_DIRECT_XIP)
+/**
  * Check if image in slot has been set with specific ROM address to run from
  * and whether the slot starts at that address.
  *
@@ -963,6 +1666,131 @@ boot_rom_address_check(struct boot_loader_state *state)
 }
 #endif
 
+/*
+ * Cheap check of the TLV area of an image, done before it is hashed so that
+ * a partially written or corrupted image is rejected without reading all of
+ * it: the TLV info headers must be found where the header places them, and
+ * the TLVs must lie within them and within the flash area. This does not
+ * replace the validation, which has to pass as well.
+ */
+static bool
+boot_is_tlv_area_valid(const struct image_header *hdr,
+                       const struct flash_area *fap)
+{
+    struct image_tlv_iter it;
+    uint32_t off;
+    uint16_t len;
+    int rc;
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_ANY, false);
+    if (rc != 0 || it.tlv_end > flash_area_get_size(fap)) {
+        return false;
+    }
+
+    do {
+        rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+    } while (rc == 0);
+
+    return rc == 1;
+}
+
+#if defined(MCUBOOT_DIRECT_XIP_REVERT_FAST) || defined(MCUBOOT_INVALIDATE_SLOT_FAST)
+/**
+ * Makes the image in a slot unbootable by erasing the sectors holding its
+ * trailer, then the sector holding its header, rather than the whole slot.
+ * If this is interrupted after the trailer is erased, the image is seen as
+ * faulty again on the next boot, so no stale trailer is ever left behind
+ * for the next image written to the slot.
+ *
+ * @param  fap          Flash area of the slot.
+ *
+ * @return              0 on success; nonzero on failure.
+ */
+static int
+boot_invalidate_slot(const struct flash_area *fap)
+{
+    struct flash_sector sector;
+    uint32_t off;
+    int rc;
+
+#if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE) || \
+    defined(MCUBOOT_SWAP_USING_OFFSET) || defined(MCUBOOT_SWAP_USING_BANK)
+    /* The whole trailer, including the swap status area. */
+    off = boot_status_off(fap);
+#else
+    off = boot_swap_info_off(fap);
+#endif
+    rc = flash_area_get_sector(fap, off, &sector);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    off = flash_sector_get_off(&sector);
+    rc = boot_erase_region(fap, off, flash_area_get_size(fap) - off);
+    if (rc != 0 || off == 0) {
+        return rc;
+    }
+
+    rc = flash_area_get_sector(fap, 0, &sector);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    return boot_erase_region(fap, 0, flash_sector_get_size(&sector));
+}
+#endif
+
+/*
+ * Erases a slot holding an image which can not be used, or with
+ * MCUBOOT_INVALIDATE_SLOT_FAST only its header and trailer. With
+ * MCUBOOT_IMAGE_SOURCE, the secondary slot is read-only and the source is
+ * told to drop the upgrade instead.
+ */
+static int
+boot_erase_invalid_slot(struct boot_loader_state *state,
+                        const struct flash_area *fap)
+{
+#ifdef MCUBOOT_IMAGE_SOURCE
+    if (fap == BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT)) {
+        boot_image_source_done(BOOT_CURR_IMG(state), false);
+        return 0;
+    }
+#else
+    (void)state;
+#endif
+
+#ifdef MCUBOOT_INVALIDATE_SLOT_FAST
+    return boot_invalidate_slot(fap);
+#else
+    return flash_area_erase(fap, 0, flash_area_get_size(fap));
+#endif
+}
+
+#if defined(MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY) || \
+    defined(MCUBOOT_BOOTSTRAP_VERIFY_COPY)
+/*
+ * Checks an image which is hashed while it is copied to the primary slot,
+ * before the primary slot is erased: its TLV area, and its signature and
+ * security counter against the value of its hash TLV. Only an image whose
+ * data does not match its hash TLV is then left to fail after the copy.
+ */
+static fih_ret
+boot_check_image_tlvs(struct boot_loader_state *state,
+                      struct image_header *hdr, const struct flash_area *fap)
+{
+    BOOT_WORK_BUF(tmpbuf);
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    if (!boot_is_tlv_area_valid(hdr, fap)) {
+        FIH_RET(fih_rc);
+    }
+
+    FIH_CALL(bootutil_img_validate_tlvs, fih_rc, BOOT_CURR_IMG(state), hdr,
+             fap, tmpbuf, BOOT_WORK_BUF_SZ);
+    FIH_RET(fih_rc);
+}
+#endif
+
 /*
  * Check that there is a valid image in a slot
  *
@@ -977,21 +1805,23 @@ boot_validate_slot(struct boot_loader_state *state, int slot,
 {
     const struct flash_area *fap;
     struct image_header *hdr;
-    int area_id;
     FIH_DECLARE(fih_rc, FIH_FAILURE);
+#ifdef MCUBOOT_IMAGE_VERDICT_HOOKS
+    struct boot_image_verdict verdict;
+#endif
+#if (defined(MCUBOOT_OVERWRITE_ONLY) && defined(MCUBOOT_DOWNGRADE_PREVENTION)) || \
+    (MCUBOOT_IMAGE_NUMBER > 1 && !defined(MCUBOOT_ENC_IMAGES) && \
+     defined(MCUBOOT_VERIFY_IMG_ADDRESS))
     int rc;
+#endif
 
-    area_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), slot);
-    rc = flash_area_open(area_id, &fap);
-    if (rc != 0) {
-        FIH_RET(fih_rc);
-    }
-
+    fap = BOOT_IMG_AREA(state, slot);
     hdr = boot_img_hdr(state, slot);
     if (boot_check_header_erased(state, slot) == 0 ||
         (hdr->ih_flags & IMAGE_F_NON_BOOTABLE)) {
 
-#if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE)
+#if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE) || \
+    defined(MCUBOOT_SWAP_USING_OFFSET) || defined(MCUBOOT_SWAP_USING_BANK)
         /*
          * This fixes an issue where an image might be erased, but a trailer
          * be left behind. It can happen if the image is in the secondary slot
@@ -1020,7 +1850,7 @@ boot_validate_slot(struct boot_loader_state *state, int slot,
                 &boot_img_hdr(state, BOOT_PRIMARY_SLOT)->ih_ver);
         if (rc < 0 && boot_check_header_erased(state, BOOT_PRIMARY_SLOT)) {
             BOOT_LOG_ERR("insufficient version in secondary slot");
-            flash_area_erase(fap, 0, flash_area_get_size(fap));
+            boot_erase_invalid_slot(state, fap);
             /* Image in the secondary slot does not satisfy version requirement.
              * Erase the image and continue booting from the primary slot.
              */
@@ -1035,12 +1865,68 @@ boot_validate_slot(struct boot_loader_state *state, int slot,
         BOOT_HOOK_CALL_FIH(boot_image_check_hook, FIH_BOOT_HOOK_REGULAR,
                            fih_rc, BOOT_CURR_IMG(state), slot);
         if (FIH_EQ(fih_rc, FIH_BOOT_HOOK_REGULAR)) {
-            FIH_CALL(boot_image_check, fih_rc, state, hdr, fap, bs);
+#ifdef MCUBOOT_IMAGE_VERDICT_HOOKS
+            FIH_CALL(boot_image_verdict_lookup, fih_rc, state, slot, hdr, fap,
+                     &verdict);
+            if (FIH_NOT_EQ(fih_rc, FIH_BOOT_HOOK_REGULAR)) {
+                /* Verdict held by the platform for this slot and image. */
+            } else
+#endif
+#ifdef MCUBOOT_RAM_LOAD_RESIDENT
+            if ((uint32_t)slot == state->slot_usage[BOOT_CURR_IMG(state)].active_slot &&
+                FIH_EQ(state->slot_usage[BOOT_CURR_IMG(state)].resident_rc,
+                       FIH_SUCCESS)) {
+                /* Validated by a previous boot, and still intact in RAM. */
+                fih_rc = state->slot_usage[BOOT_CURR_IMG(state)].resident_rc;
+            } else
+#endif
+#ifdef MCUBOOT_VALIDATION_CACHE
+            if (slot == BOOT_PRIMARY_SLOT) {
+                FIH_CALL(boot_image_check_cached, fih_rc, state, hdr, fap, bs);
+            } else
+#endif
+#ifdef MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY
+            if (slot != BOOT_PRIMARY_SLOT &&
+                !(hdr->ih_flags & IMAGE_F_HASH_CHUNKED)) {
+                /* The image is hashed while it is copied to the primary
+                 * slot, and checked against its hash TLV by
+                 * boot_copy_image().
+                 */
+                FIH_CALL(boot_check_image_tlvs, fih_rc, state, hdr, fap);
+            } else
+#endif
+            if (!boot_is_tlv_area_valid(hdr, fap)) {
+                BOOT_LOG_DBG("Image in the %s slot has no valid TLV area",
+                             (slot == BOOT_PRIMARY_SLOT) ? "primary" : "secondary");
+                fih_rc = FIH_FAILURE;
+            } else {
+                boot_phase_start(BOOT_PHASE_VALIDATE);
+                FIH_CALL(boot_image_check, fih_rc, state, hdr, fap, bs);
+                boot_phase_stop(BOOT_PHASE_VALIDATE);
+#ifdef MCUBOOT_IMAGE_VERDICT_HOOKS
+                if (verdict.bound) {
+                    boot_image_verdict_store_hook(BOOT_CURR_IMG(state), slot,
+                                                  verdict.hdr_digest,
+                                                  verdict.img_hash, fih_rc);
+                }
+#endif
+#ifdef MCUBOOT_RAM_LOAD_RESIDENT
+                if (FIH_EQ(fih_rc, FIH_SUCCESS) &&
+                    (uint32_t)slot == state->slot_usage[BOOT_CURR_IMG(state)].active_slot) {
+                    boot_ram_resident_note(state, slot);
+                }
+#endif
+#ifdef MCUBOOT_VALIDATION_CACHE_UPGRADE
+                if (slot == BOOT_SECONDARY_SLOT) {
+                    boot_validation_upgrade_note(state, hdr, fap, fih_rc);
+                }
+#endif
+            }
         }
     }
     if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
         if ((slot != BOOT_PRIMARY_SLOT) || ARE_SLOTS_EQUIVALENT()) {
-            flash_area_erase(fap, 0, flash_area_get_size(fap));
+            boot_erase_invalid_slot(state, fap);
             /* Image is invalid, erase it to prevent further unnecessary
              * attempts to validate and boot it.
              */
@@ -1059,13 +1945,14 @@ boot_validate_slot(struct boot_loader_state *state, int slot,
      * overwriting an application written to the incorrect slot.
      * This feature is only supported by ARM platforms.
      */
-    if (area_id == FLASH_AREA_IMAGE_SECONDARY(BOOT_CURR_IMG(state))) {
+    if (slot == BOOT_SECONDARY_SLOT) {
         const struct flash_area *pri_fa = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
         struct image_header *secondary_hdr = boot_img_hdr(state, slot);
         uint32_t reset_value = 0;
         uint32_t reset_addr = secondary_hdr->ih_hdr_size + sizeof(reset_value);
 
-        rc = flash_area_read(fap, reset_addr, &reset_value, sizeof(reset_value));
+        rc = flash_area_read(fap, BOOT_IMG_START_OFF(fap) + reset_addr,
+                             &reset_value, sizeof(reset_value));
         if (rc != 0) {
             fih_rc = FIH_NO_BOOTABLE_IMAGE;
             goto out;
@@ -1089,8 +1976,6 @@ boot_validate_slot(struct boot_loader_state *state, int slot,
 #endif
 
 out:
-    flash_area_close(fap);
-
     FIH_RET(fih_rc);
 }
 
@@ -1100,8 +1985,8 @@ out:
  * value which resides in the given slot, only if it's greater than the stored
  * value.
  *
- * @param image_index   Index of the image to determine which security
- *                      counter to update.
+ * @param state         Boot loader status information, whose current image
+ *                      determines which security counter to update.
  * @param slot          Slot number of the image.
  * @param hdr           Pointer to the image header structure of the image
  *                      that is currently stored in the given slot.
@@ -1109,33 +1994,20 @@ out:
  * @return              0 on success; nonzero on failure.
  */
 static int
-boot_update_security_counter(uint8_t image_index, int slot,
+boot_update_security_counter(struct boot_loader_state *state, int slot,
                              struct image_header *hdr)
 {
-    const struct flash_area *fap = NULL;
     uint32_t img_security_cnt;
     int rc;
 
-    rc = flash_area_open(flash_area_id_from_multi_image_slot(image_index, slot),
-                         &fap);
+    rc = bootutil_get_img_security_cnt(hdr, BOOT_IMG_AREA(state, slot),
+                                       &img_security_cnt);
     if (rc != 0) {
-        rc = BOOT_EFLASH;
-        goto done;
-    }
-
-    rc = bootutil_get_img_security_cnt(hdr, fap, &img_security_cnt);
-    if (rc != 0) {
-        goto done;
-    }
-
-    rc = boot_nv_security_counter_update(image_index, img_security_cnt);
-    if (rc != 0) {
-        goto done;
+        return rc;
     }
 
-done:
-    flash_area_close(fap);
-    return rc;
+    return boot_security_counter_update(BOOT_CURR_IMG(state),
+                                        img_security_cnt);
 }
 #endif /* MCUBOOT_HW_ROLLBACK_PROT */
 
@@ -1155,8 +2027,31 @@ boot_validated_swap_type(struct boot_loader_state *state,
     int swap_type;
     FIH_DECLARE(fih_rc, FIH_FAILURE);
 
+#ifdef MCUBOOT_IMAGE_SOURCE
+    /* The upgrade request comes from the source, not from a trailer. */
+    swap_type = boot_image_source_pending(BOOT_CURR_IMG(state)) ?
+                BOOT_SWAP_TYPE_PERM : BOOT_SWAP_TYPE_NONE;
+    if (BOOT_IS_UPGRADE(swap_type) &&
+        (boot_img_hdr(state, BOOT_SECONDARY_SLOT)->ih_flags &
+         IMAGE_F_HASH_CHUNKED)) {
+        /* Chunks are only checked in the source, which could change before
+         * they are copied.
+         */
+        BOOT_LOG_ERR("Chunk hashed images can not be installed from a source");
+        boot_image_source_done(BOOT_CURR_IMG(state), false);
+        swap_type = BOOT_SWAP_TYPE_NONE;
+    }
+#else
     swap_type = boot_swap_type_multi(BOOT_CURR_IMG(state));
+#endif
     if (BOOT_IS_UPGRADE(swap_type)) {
+#ifdef MCUBOOT_DELTA_IMAGES
+        /* Rebuild the new image if the secondary slot holds a delta image,
+         * failures are caught by the validation below.
+         */
+        (void)boot_delta_apply(state, bs);
+#endif
+
         /* Boot loader wants to switch to the secondary slot.
          * Ensure image is valid.
          */
@@ -1187,6 +2082,64 @@ boot_validated_swap_type(struct boot_loader_state *state,
 int
 boot_erase_region(const struct flash_area *fap, uint32_t off, uint32_t sz)
 {
+#ifdef MCUBOOT_SKIP_ERASED_SECTORS
+    struct flash_sector sector;
+    uint32_t run_off;
+    uint32_t end;
+    uint32_t len;
+    bool erased;
+    int rc;
+#endif
+
+#ifdef MCUBOOT_TLV_INDEX
+    bootutil_tlv_index_invalidate(fap);
+#endif
+
+#ifdef MCUBOOT_SKIP_ERASED_SECTORS
+
+    /* Blank-checking a sector is much quicker than erasing it again, so
+     * only the sectors of the region which are not erased are erased.
+     * Consecutive sectors that need erasing are erased with a single call,
+     * which lets the backend use its larger block erase commands.
+     */
+    end = off + sz;
+    run_off = off;
+    while (off < end) {
+        rc = flash_area_get_sector(fap, off, &sector);
+        if (rc != 0 || flash_sector_get_off(&sector) != off) {
+            break;
+        }
+
+        len = flash_sector_get_size(&sector);
+        if (len == 0 || len > end - off) {
+            break;
+        }
+
+        rc = bootutil_area_is_erased(fap, off, len, &erased);
+        if (rc == 0 && erased) {
+            if (run_off < off) {
+                rc = flash_area_erase(fap, run_off, off - run_off);
+                if (rc != 0) {
+                    return rc;
+                }
+            }
+            run_off = off + len;
+        }
+
+        off += len;
+    }
+
+    if (run_off >= end) {
+        return 0;
+    }
+
+    /* Erase the last run of sectors, with the rest of the region if it is
+     * not sector aligned.
+     */
+    off = run_off;
+    sz = end - run_off;
+#endif
+
     return flash_area_erase(fap, off, sz);
 }
 
@@ -1206,6 +2159,132 @@ static void like_mbedtls_zeroize(void *p, size_t n)
 }
 #endif
 
+#ifdef MCUBOOT_COPY_VERIFY
+#define BOOT_COPY_VERIFY_BUF_SZ 32
+
+/*
+ * Reads back a chunk that has just been written and compares it with the
+ * data that was written, so that a failed or silently corrupted write is
+ * caught while the data is still at hand.
+ */
+static int
+boot_copy_verify(const struct flash_area *fap, uint32_t off,
+                 const uint8_t *data, uint32_t sz)
+{
+    uint8_t buf[BOOT_COPY_VERIFY_BUF_SZ];
+    uint32_t chunk_sz;
+    uint32_t i;
+
+    for (i = 0; i < sz; i += chunk_sz) {
+        chunk_sz = sz - i;
+        if (chunk_sz > BOOT_COPY_VERIFY_BUF_SZ) {
+            chunk_sz = BOOT_COPY_VERIFY_BUF_SZ;
+        }
+
+        if (flash_area_read(fap, off + i, buf, chunk_sz) != 0) {
+            return BOOT_EFLASH;
+        }
+        if (memcmp(buf, &data[i], chunk_sz) != 0) {
+            BOOT_LOG_ERR("Copy verification failed; fa_id=%d off=0x%lx",
+                         flash_area_get_id(fap), (unsigned long)(off + i));
+            return BOOT_EFLASH;
+        }
+    }
+
+    return 0;
+}
+#endif
+
+#ifdef MCUBOOT_COPY_PIPELINE
+/*
+ * Start reading or writing a chunk. Without an asynchronous flash backend
+ * the transfer completes before this returns, and the matching wait is a
+ * no-op.
+ */
+static inline int
+boot_copy_read_start(const struct flash_area *fap, uint32_t off, void *dst,
+                     uint32_t len)
+{
+#ifdef MCUBOOT_FLASH_AREA_READ_ASYNC
+    return flash_area_read_async(fap, off, dst, len);
+#else
+    return flash_area_read(fap, off, dst, len);
+#endif
+}
+
+static inline int
+boot_copy_read_wait(const struct flash_area *fap)
+{
+#ifdef MCUBOOT_FLASH_AREA_READ_ASYNC
+    return flash_area_read_wait(fap);
+#else
+    (void)fap;
+    return 0;
+#endif
+}
+
+static inline int
+boot_copy_write_start(const struct flash_area *fap, uint32_t off,
+                      const void *src, uint32_t len)
+{
+#ifdef MCUBOOT_FLASH_AREA_WRITE_ASYNC
+    return flash_area_write_async(fap, off, src, len);
+#else
+    return flash_area_write(fap, off, src, len);
+#endif
+}
+
+static inline int
+boot_copy_write_wait(const struct flash_area *fap)
+{
+#ifdef MCUBOOT_FLASH_AREA_WRITE_ASYNC
+    return flash_area_write_wait(fap);
+#else
+    (void)fap;
+    return 0;
+#endif
+}
+#endif /* MCUBOOT_COPY_PIPELINE */
+
+#ifdef MCUBOOT_SWAP_PERM_DISCARD
+/*
+ * A permanent upgrade is never reverted, so the image it moves out of the
+ * primary slot is dropped instead of being written, and encrypted again, to
+ * the secondary slot, which is left erased but for the image header.
+ */
+static inline bool
+boot_swap_discards_primary(struct boot_loader_state *state)
+{
+    return BOOT_SWAP_TYPE(state) == BOOT_SWAP_TYPE_PERM;
+}
+
+/*
+ * Write the header of the image leaving the primary slot at the start of the
+ * secondary slot. An interrupted swap reads it back from there when it is
+ * resumed. The header is not encrypted, so no key is needed.
+ */
+static int
+boot_swap_discard_copy_hdr(const struct flash_area *fap_src,
+                           const struct flash_area *fap_dst, uint32_t off_src)
+{
+    uint8_t buf[ALIGN_UP(sizeof(struct image_header), BOOT_MAX_ALIGN)];
+
+    memset(buf, flash_area_erased_val(fap_dst), sizeof(buf));
+    if (flash_area_read(fap_src, off_src, buf,
+                        sizeof(struct image_header)) != 0) {
+        return BOOT_EFLASH;
+    }
+
+    if (flash_area_write(fap_dst, 0, buf,
+                         ALIGN_UP(sizeof(struct image_header),
+                                  flash_area_align(fap_dst))) != 0) {
+        return BOOT_EFLASH;
+    }
+
+    return 0;
+}
+#endif
+
 /**
  * Copies the contents of one flash region to another.  You must erase the
  * destination region prior to calling this function.
@@ -1252,116 +2331,646 @@ boot_copy_region(struct boot_loader_state *state,
     (void)state;
 #endif
 
-    TARGET_STATIC uint8_t buf[BUF_SZ] __attribute__((aligned(4)));
+#ifdef MCUBOOT_FLASH_AREA_COPY
+    bool offload;
+#endif
+#ifdef MCUBOOT_COPY_PIPELINE
+#ifdef MCUBOOT_WORK_ARENA
+    uint8_t (*const bufs)[BUF_SZ] = (uint8_t (*)[BUF_SZ])boot_work_arena;
+#else
+    TARGET_STATIC uint8_t bufs[BOOT_COPY_PIPELINE_BUFS][BUF_SZ]
+        __attribute__((aligned(4)));
+#endif
+    uint8_t *buf;
+    uint32_t next_off;
+    bool read_pending;
+    bool write_pending;
+    int wait_rc;
+    int cur;
+#elif defined(MCUBOOT_WORK_ARENA)
+    uint8_t *const buf = boot_work_arena;
+#else
+    TARGET_STATIC uint8_t buf[BUF_SZ] __attribute__((aligned(4)));
+#endif
+
+#ifdef MCUBOOT_SWAP_PERM_DISCARD
+    /* The destination was erased by the caller and is left so, but for the
+     * header of the image, which is always at its start.
+     */
+    if (boot_swap_discards_primary(state) &&
+        fap_src == BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT) &&
+        fap_dst == BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT)) {
+        if (off_dst == 0 && sz >= sizeof(struct image_header)) {
+            return boot_swap_discard_copy_hdr(fap_src, fap_dst, off_src);
+        }
+        return 0;
+    }
+#endif
+
+#ifdef MCUBOOT_ENC_IMAGES
+    encrypted_src = (flash_area_get_id(fap_src) != FLASH_AREA_IMAGE_PRIMARY(image_index));
+    encrypted_dst = (flash_area_get_id(fap_dst) != FLASH_AREA_IMAGE_PRIMARY(image_index));
+
+    if (encrypted_src != encrypted_dst) {
+        if (encrypted_dst) {
+            /* Need encryption, metadata from the primary slot */
+            hdr = boot_img_hdr(state, BOOT_PRIMARY_SLOT);
+            source_slot = 0;
+        } else {
+            /* Need decryption, metadata from the secondary slot */
+            hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
+            source_slot = 1;
+        }
+    } else {
+        /* In case when source and targe is the same area, this means that we
+         * only have to copy bytes, no encryption or decryption.
+         */
+        only_copy = true;
+    }
+#endif
+
+#ifdef MCUBOOT_FLASH_AREA_COPY
+    /* When the data does not have to be transformed or hashed on the way,
+     * let the backend copy it without going through a RAM buffer.
+     */
+    offload = (sz > 0);
+#ifdef MCUBOOT_ENC_IMAGES
+    if (!only_copy && IS_ENCRYPTED(hdr)) {
+        offload = false;
+    }
+#endif
+#ifdef BOOT_VERIFY_COPY
+    if (state->copy_sha != NULL) {
+        offload = false;
+    }
+#endif
+#ifdef MCUBOOT_COPY_VERIFY
+    /* The written data is read back from the copy buffer. */
+    offload = false;
+#endif
+    if (offload) {
+        rc = flash_area_copy(fap_src, off_src, fap_dst, off_dst, sz);
+        if (rc == 0) {
+            return 0;
+        } else if (rc < 0) {
+            return BOOT_EFLASH;
+        }
+        /* The backend can not copy this region, fall back to the CPU. */
+    }
+#endif
+
+    bytes_copied = 0;
+#ifdef MCUBOOT_COPY_PIPELINE
+    cur = 0;
+    rc = 0;
+    read_pending = false;
+    write_pending = false;
+    if (sz > 0) {
+        rc = boot_copy_read_start(fap_src, off_src, bufs[cur],
+                                  (sz > BUF_SZ) ? BUF_SZ : sz);
+        read_pending = (rc == 0);
+    }
+#endif
+    while (bytes_copied < sz) {
+        if (sz - bytes_copied > BUF_SZ) {
+            chunk_sz = BUF_SZ;
+        } else {
+            chunk_sz = sz - bytes_copied;
+        }
+
+#ifdef MCUBOOT_COPY_PIPELINE
+        if (rc != 0) {
+            break;
+        }
+
+        buf = bufs[cur];
+        read_pending = false;
+        rc = boot_copy_read_wait(fap_src);
+        if (rc != 0) {
+            break;
+        }
+
+        /* The buffer of the next chunk was last written from two chunks
+         * ago, and that write has completed before the previous one was
+         * started.
+         */
+        next_off = bytes_copied + chunk_sz;
+        if (next_off < sz) {
+            rc = boot_copy_read_start(fap_src, off_src + next_off,
+                                      bufs[(cur + 1) % BOOT_COPY_PIPELINE_BUFS],
+                                      (sz - next_off > BUF_SZ) ?
+                                      BUF_SZ : sz - next_off);
+            if (rc != 0) {
+                break;
+            }
+            read_pending = true;
+        }
+#else
+        rc = flash_area_read(fap_src, off_src + bytes_copied, buf, chunk_sz);
+        if (rc != 0) {
+            return BOOT_EFLASH;
+        }
+#endif
+
+#ifdef MCUBOOT_ENC_IMAGES
+        /* If only copy, then does not matter if header indicates need for
+         * encryptio/decryptio, we just copy data. */
+        if (!only_copy && IS_ENCRYPTED(hdr)) {
+            uint32_t abs_off = off + bytes_copied;
+            if (abs_off < hdr->ih_hdr_size) {
+                /* do not decrypt header */
+                if (abs_off + chunk_sz > hdr->ih_hdr_size) {
+                    /* The lower part of the chunk contains header data */
+                    blk_off = 0;
+                    blk_sz = chunk_sz - (hdr->ih_hdr_size - abs_off);
+                    idx = hdr->ih_hdr_size  - abs_off;
+                } else {
+                    /* The chunk contains exclusively header data */
+                    blk_sz = 0; /* nothing to decrypt */
+                }
+            } else {
+                idx = 0;
+                blk_sz = chunk_sz;
+                blk_off = (abs_off - hdr->ih_hdr_size) & 0xf;
+            }
+
+            if (blk_sz > 0)
+            {
+                tlv_off = BOOT_TLV_OFF(hdr);
+                if (abs_off + chunk_sz > tlv_off) {
+                    /* do not decrypt TLVs */
+                    if (abs_off >= tlv_off) {
+                        blk_sz = 0;
+                    } else {
+                        blk_sz = tlv_off - abs_off;
+                    }
+                }
+                if (source_slot == 0) {
+                    boot_enc_encrypt(BOOT_CURR_ENC(state), source_slot,
+                            (abs_off + idx) - hdr->ih_hdr_size, blk_sz,
+                            blk_off, &buf[idx]);
+                } else {
+                    boot_enc_decrypt(BOOT_CURR_ENC(state), source_slot,
+                            (abs_off + idx) - hdr->ih_hdr_size, blk_sz,
+                            blk_off, &buf[idx]);
+                }
+            }
+        }
+#endif
+
+#ifdef BOOT_VERIFY_COPY
+        if (state->copy_sha != NULL &&
+            off_src + bytes_copied < state->copy_sha_sz) {
+            uint32_t hash_sz = state->copy_sha_sz - (off_src + bytes_copied);
+
+            if (hash_sz > (uint32_t)chunk_sz) {
+                hash_sz = chunk_sz;
+            }
+            bootutil_sha_update(state->copy_sha, buf, hash_sz);
+        }
+#endif
+
+#ifdef MCUBOOT_COPY_PIPELINE
+        if (write_pending) {
+            write_pending = false;
+            rc = boot_copy_write_wait(fap_dst);
+            if (rc != 0) {
+                break;
+            }
+        }
+
+        rc = boot_copy_write_start(fap_dst, off_dst + bytes_copied, buf,
+                                   chunk_sz);
+        if (rc != 0) {
+            break;
+        }
+        write_pending = true;
+        cur = (cur + 1) % BOOT_COPY_PIPELINE_BUFS;
+#else
+        rc = flash_area_write(fap_dst, off_dst + bytes_copied, buf, chunk_sz);
+        if (rc != 0) {
+            return BOOT_EFLASH;
+        }
+#ifdef MCUBOOT_COPY_VERIFY
+        rc = boot_copy_verify(fap_dst, off_dst + bytes_copied, buf, chunk_sz);
+        if (rc != 0) {
+            return rc;
+        }
+#endif
+#endif
+
+        bytes_copied += chunk_sz;
+
+        boot_watchdog_feed(chunk_sz);
+    }
+
+#ifdef MCUBOOT_COPY_PIPELINE
+    /* Do not leave transfers running on the static buffers, even when
+     * bailing out on an error.
+     */
+    if (read_pending) {
+        wait_rc = boot_copy_read_wait(fap_src);
+        if (rc == 0) {
+            rc = wait_rc;
+        }
+    }
+    if (write_pending) {
+        wait_rc = boot_copy_write_wait(fap_dst);
+        if (rc == 0) {
+            rc = wait_rc;
+        }
+    }
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+#endif
+
+    return 0;
+}
+
+/**
+ * Erases a region of flash and copies data to it, as done by each step of
+ * a swap. With MCUBOOT_COPY_VERIFY, a copy that does not read back as it
+ * was written is erased and done again, up to MCUBOOT_COPY_VERIFY_RETRIES
+ * times. Must not be used while the copy is hashed.
+ *
+ * @param erase_sz              The number of bytes to erase, from off_dst.
+ * @param copy_sz               The number of bytes to copy.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+int
+boot_erase_copy_region(struct boot_loader_state *state,
+                       const struct flash_area *fap_src,
+                       const struct flash_area *fap_dst,
+                       uint32_t off_src, uint32_t off_dst,
+                       uint32_t erase_sz, uint32_t copy_sz)
+{
+    int rc;
+#ifdef MCUBOOT_COPY_VERIFY
+    int retries = MCUBOOT_COPY_VERIFY_RETRIES;
+#endif
+
+    while (1) {
+        rc = boot_erase_region(fap_dst, off_dst, erase_sz);
+        if (rc == 0) {
+            rc = boot_copy_region(state, fap_src, fap_dst, off_src, off_dst,
+                                  copy_sz);
+        }
+
+#ifdef MCUBOOT_COPY_VERIFY
+        if (rc != 0 && retries-- > 0) {
+            BOOT_LOG_WRN("Copy failed, retrying; fa_id=%d off=0x%lx",
+                         flash_area_get_id(fap_dst), (unsigned long)off_dst);
+            continue;
+        }
+#endif
+        return rc;
+    }
+}
+
+/**
+ * Overwrite primary slot with the image contained in the secondary slot.
+ * If a prior copy operation was interrupted by a system reset, this function
+ * redos the copy.
+ *
+ * @param bs                    The current boot status.  This function reads
+ *                                  this struct to determine if it is resuming
+ *                                  an interrupted swap operation.  This
+ *                                  function writes the updated status to this
+ *                                  function on return.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+#if defined(MCUBOOT_OVERWRITE_ONLY) || defined(MCUBOOT_BOOTSTRAP)
+#ifdef BOOT_VERIFY_COPY
+#if defined(MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY) && !defined(MCUBOOT_OVERWRITE_ONLY)
+#error "MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY requires MCUBOOT_OVERWRITE_ONLY"
+#endif
+
+/*
+ * Check the TLVs of the image just copied to the primary slot against the
+ * hash computed while copying it. If the image is not valid, both slots are
+ * erased so that neither the partial copy nor the bad image gets used.
+ *
+ * @return                      0 on success; BOOT_EBADIMAGE if the image is
+ *                                  not valid.
+ */
+static int
+boot_verify_copied_image(struct boot_loader_state *state,
+                         const struct flash_area *fap_primary_slot,
+                         const struct flash_area *fap_secondary_slot,
+                         uint8_t *hash)
+{
+    BOOT_WORK_BUF(tmpbuf);
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    FIH_CALL(bootutil_img_validate_digest, fih_rc, BOOT_CURR_IMG(state),
+             boot_img_hdr(state, BOOT_SECONDARY_SLOT), fap_primary_slot,
+             tmpbuf, BOOT_WORK_BUF_SZ, hash);
+    if (FIH_EQ(fih_rc, FIH_SUCCESS)) {
+        return 0;
+    }
+
+    BOOT_LOG_ERR("Image in the secondary slot is not valid!");
+    boot_erase_region(fap_primary_slot,
+                      boot_img_sector_off(state, BOOT_PRIMARY_SLOT, 0),
+                      boot_img_sector_size(state, BOOT_PRIMARY_SLOT, 0));
+#ifdef MCUBOOT_IMAGE_SOURCE
+    (void)fap_secondary_slot;
+    boot_image_source_done(BOOT_CURR_IMG(state), false);
+#else
+    flash_area_erase(fap_secondary_slot, 0,
+                     flash_area_get_size(fap_secondary_slot));
+#endif
+
+    return BOOT_EBADIMAGE;
+}
+#endif /* BOOT_VERIFY_COPY */
+
+#ifdef MCUBOOT_OVERWRITE_ONLY_RESUME
+#ifndef MCUBOOT_OVERWRITE_ONLY
+#error "MCUBOOT_OVERWRITE_ONLY_RESUME requires MCUBOOT_OVERWRITE_ONLY"
+#endif
+#ifdef MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY
+#error "MCUBOOT_OVERWRITE_ONLY_RESUME can not be used with MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY"
+#endif
+
+/*
+ * The progress of an overwrite is kept in the swap status area of the
+ * secondary slot, which is otherwise unused in overwrite-only mode: one
+ * entry of BOOT_WRITE_SZ bytes is written after each sector of the primary
+ * slot has been erased and copied, and bs->idx counts the entries.
+ */
+static uint32_t
+boot_copy_status_off(struct boot_loader_state *state,
+                     const struct flash_area *fap, uint32_t idx)
+{
+    return boot_status_off(fap) +
+           (idx - BOOT_STATUS_IDX_0) * BOOT_WRITE_SZ(state);
+}
+
+/*
+ * Reads the progress of an interrupted copy into bs->idx. Progress can only
+ * be recorded if the image does not reach into the status area and the
+ * entries not written yet are erased; when resuming, the primary slot must
+ * also hold the header of the image being copied, otherwise the entries are
+ * left over from another image. If any of this does not hold, *record is
+ * cleared and the copy starts from the first sector.
+ */
+static int
+boot_copy_status_read(struct boot_loader_state *state,
+                      const struct flash_area *fap_secondary_slot,
+                      struct boot_status *bs, uint32_t src_size,
+                      uint32_t sect_count, bool *record)
+{
+    uint8_t buf[BOOT_MAX_ALIGN];
+    uint32_t write_sz;
+    uint32_t last_idx;
+    uint32_t idx;
+    bool erased;
+    int rc;
+
+    bs->idx = BOOT_STATUS_IDX_0;
+    *record = false;
+
+    if (src_size > boot_status_off(fap_secondary_slot)) {
+        return 0;
+    }
+
+    write_sz = BOOT_WRITE_SZ(state);
+    last_idx = BOOT_STATUS_IDX_0 + sect_count;
+    for (idx = BOOT_STATUS_IDX_0; idx < last_idx; idx++) {
+        rc = flash_area_read(fap_secondary_slot,
+                             boot_copy_status_off(state, fap_secondary_slot, idx),
+                             buf, write_sz);
+        if (rc != 0) {
+            return BOOT_EFLASH;
+        }
+        if (bootutil_buffer_is_erased(fap_secondary_slot, buf, write_sz)) {
+            break;
+        }
+    }
+
+    rc = bootutil_area_is_erased(fap_secondary_slot,
+                                 boot_copy_status_off(state, fap_secondary_slot,
+                                                      idx),
+                                 (last_idx - idx) * write_sz, &erased);
+    if (rc != 0 || !erased) {
+        return 0;
+    }
+
+    if (idx != BOOT_STATUS_IDX_0 &&
+        memcmp(boot_img_hdr(state, BOOT_PRIMARY_SLOT),
+               boot_img_hdr(state, BOOT_SECONDARY_SLOT),
+               sizeof(struct image_header)) != 0) {
+        return 0;
+    }
+
+    bs->idx = idx;
+    *record = true;
+
+    return 0;
+}
+
+/* Records that the sector at bs->idx has been copied. */
+static int
+boot_copy_status_write(struct boot_loader_state *state,
+                       const struct flash_area *fap_secondary_slot,
+                       const struct boot_status *bs)
+{
+    uint8_t buf[BOOT_MAX_ALIGN];
+
+    memset(buf, flash_area_erased_val(fap_secondary_slot), BOOT_MAX_ALIGN);
+    buf[0] = BOOT_STATUS_STATE_0;
+
+    return flash_area_write(fap_secondary_slot,
+                            boot_copy_status_off(state, fap_secondary_slot,
+                                                 bs->idx),
+                            buf, BOOT_WRITE_SZ(state));
+}
+#endif /* MCUBOOT_OVERWRITE_ONLY_RESUME */
+
+#ifdef MCUBOOT_ERASE_AHEAD
+#if !defined(MCUBOOT_OVERWRITE_ONLY) || (BOOT_IMAGE_NUMBER == 1)
+#error "MCUBOOT_ERASE_AHEAD requires MCUBOOT_OVERWRITE_ONLY and several images"
+#endif
+#ifndef MCUBOOT_FLASH_AREA_ERASE_ASYNC
+#error "MCUBOOT_ERASE_AHEAD requires MCUBOOT_FLASH_AREA_ERASE_ASYNC"
+#endif
+#ifdef MCUBOOT_OVERWRITE_ONLY_RESUME
+#error "MCUBOOT_ERASE_AHEAD can not be used with MCUBOOT_OVERWRITE_ONLY_RESUME"
+#endif
+#ifdef MCUBOOT_IMAGE_ACCESS_HOOKS
+#error "MCUBOOT_ERASE_AHEAD can not be used with MCUBOOT_IMAGE_ACCESS_HOOKS"
+#endif
+
+/*
+ * Starts erasing the primary slot of the next image to be upgraded, so that
+ * the erase runs while the current image is copied. This is only done when
+ * the next primary slot is on another flash device than both slots of the
+ * current image, as the erase would otherwise hold up the copy.
+ *
+ * Erasing ahead does not change what an interrupted upgrade leaves behind:
+ * the secondary slot of the next image, and so its pending upgrade, is not
+ * touched until that image is copied, and the copy is started over on the
+ * next boot.
+ */
+static void
+boot_erase_ahead_start(struct boot_loader_state *state)
+{
+    const struct flash_area *fap;
+    uint8_t image_index;
+    uint8_t next;
+    uint32_t src_size;
+    uint32_t size;
+    size_t sect;
+    int rc;
+
+    image_index = BOOT_CURR_IMG(state);
+    for (next = image_index + 1; next < BOOT_IMAGE_NUMBER; next++) {
+        if (!state->img_mask[next] &&
+            (state->swap_type[next] == BOOT_SWAP_TYPE_TEST ||
+             state->swap_type[next] == BOOT_SWAP_TYPE_PERM)) {
+            break;
+        }
+    }
+    if (next == BOOT_IMAGE_NUMBER) {
+        return;
+    }
+
+    fap = state->imgs[next][BOOT_PRIMARY_SLOT].area;
+    if (flash_area_get_device_id(fap) ==
+            flash_area_get_device_id(BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT)) ||
+        flash_area_get_device_id(fap) ==
+            flash_area_get_device_id(BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT))) {
+        return;
+    }
+
+    BOOT_CURR_IMG(state) = next;
+    size = 0;
+#if defined(MCUBOOT_DECOMPRESS_IMAGES)
+    /* The size needed by a compressed image is only known once it has been
+     * decompressed, leave it to boot_copy_image().
+     */
+    if (IS_COMPRESSED(boot_img_hdr(state, BOOT_SECONDARY_SLOT))) {
+        goto done;
+    }
+#endif
+    rc = boot_read_image_size(state, BOOT_SECONDARY_SLOT, &src_size);
+    if (rc != 0 || src_size == 0) {
+        goto done;
+    }
+
+    /* Only whole sectors holding the image are erased ahead, the rest of
+     * the slot is erased by boot_copy_image() as usual.
+     */
+    for (sect = 0; sect < boot_img_num_sectors(state, BOOT_PRIMARY_SLOT) &&
+                   size < src_size; sect++) {
+        size += boot_img_sector_size(state, BOOT_PRIMARY_SLOT, sect);
+    }
+
+#ifdef MCUBOOT_TLV_INDEX
+    bootutil_tlv_index_invalidate(fap);
+#endif
+    rc = flash_area_erase_async(fap, 0, size);
+    if (rc != 0) {
+        size = 0;
+    } else {
+        BOOT_LOG_DBG("Image %d erasing ahead 0x%x bytes of the primary slot",
+                     next, (unsigned)size);
+    }
+
+done:
+    state->erase_ahead[next] = size;
+    BOOT_CURR_IMG(state) = image_index;
+}
 
-#ifdef MCUBOOT_ENC_IMAGES
-    encrypted_src = (flash_area_get_id(fap_src) != FLASH_AREA_IMAGE_PRIMARY(image_index));
-    encrypted_dst = (flash_area_get_id(fap_dst) != FLASH_AREA_IMAGE_PRIMARY(image_index));
+/*
+ * Waits for the erase started by boot_erase_ahead_start() on the primary
+ * slot of an image, if any, and returns the number of bytes from the start
+ * of the slot that are known to be erased.
+ */
+static uint32_t
+boot_erase_ahead_wait(struct boot_loader_state *state, uint8_t image_index)
+{
+    uint32_t size;
 
-    if (encrypted_src != encrypted_dst) {
-        if (encrypted_dst) {
-            /* Need encryption, metadata from the primary slot */
-            hdr = boot_img_hdr(state, BOOT_PRIMARY_SLOT);
-            source_slot = 0;
-        } else {
-            /* Need decryption, metadata from the secondary slot */
-            hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
-            source_slot = 1;
+    size = state->erase_ahead[image_index];
+    if (size != 0) {
+        if (flash_area_erase_wait(state->imgs[image_index][BOOT_PRIMARY_SLOT].area) != 0) {
+            BOOT_LOG_WRN("Image %d erase ahead failed", image_index);
+            size = 0;
         }
-    } else {
-        /* In case when source and targe is the same area, this means that we
-         * only have to copy bytes, no encryption or decryption.
-         */
-        only_copy = true;
+        state->erase_ahead[image_index] = 0;
     }
-#endif
 
-    bytes_copied = 0;
-    while (bytes_copied < sz) {
-        if (sz - bytes_copied > sizeof buf) {
-            chunk_sz = sizeof buf;
-        } else {
-            chunk_sz = sz - bytes_copied;
-        }
+    return size;
+}
+#endif /* MCUBOOT_ERASE_AHEAD */
 
-        rc = flash_area_read(fap_src, off_src + bytes_copied, buf, chunk_sz);
-        if (rc != 0) {
-            return BOOT_EFLASH;
-        }
+#ifdef MCUBOOT_OVERWRITE_ONLY_TOMBSTONE
+/*
+ * Invalidates the image copied from the secondary slot without erasing any
+ * sector, by programming the write unit holding the trailer magic and, unless
+ * the image is kept as a backup, the one holding the image header magic,
+ * over their current content.
+ */
+static int
+boot_write_tombstone(struct boot_loader_state *state,
+                     const struct flash_area *fap)
+{
+    uint8_t buf[BOOT_MAX_ALIGN];
+    uint32_t align;
+    int rc;
 
-#ifdef MCUBOOT_ENC_IMAGES
-        /* If only copy, then does not matter if header indicates need for
-         * encryptio/decryptio, we just copy data. */
-        if (!only_copy && IS_ENCRYPTED(hdr)) {
-            uint32_t abs_off = off + bytes_copied;
-            if (abs_off < hdr->ih_hdr_size) {
-                /* do not decrypt header */
-                if (abs_off + chunk_sz > hdr->ih_hdr_size) {
-                    /* The lower part of the chunk contains header data */
-                    blk_off = 0;
-                    blk_sz = chunk_sz - (hdr->ih_hdr_size - abs_off);
-                    idx = hdr->ih_hdr_size  - abs_off;
-                } else {
-                    /* The chunk contains exclusively header data */
-                    blk_sz = 0; /* nothing to decrypt */
-                }
-            } else {
-                idx = 0;
-                blk_sz = chunk_sz;
-                blk_off = (abs_off - hdr->ih_hdr_size) & 0xf;
-            }
+    align = BOOT_WRITE_SZ(state);
+    memset(buf, (uint8_t)~flash_area_erased_val(fap), sizeof(buf));
 
-            if (blk_sz > 0)
-            {
-                tlv_off = BOOT_TLV_OFF(hdr);
-                if (abs_off + chunk_sz > tlv_off) {
-                    /* do not decrypt TLVs */
-                    if (abs_off >= tlv_off) {
-                        blk_sz = 0;
-                    } else {
-                        blk_sz = tlv_off - abs_off;
-                    }
-                }
-                if (source_slot == 0) {
-                    boot_enc_encrypt(BOOT_CURR_ENC(state), source_slot,
-                            (abs_off + idx) - hdr->ih_hdr_size, blk_sz,
-                            blk_off, &buf[idx]);
-                } else {
-                    boot_enc_decrypt(BOOT_CURR_ENC(state), source_slot,
-                            (abs_off + idx) - hdr->ih_hdr_size, blk_sz,
-                            blk_off, &buf[idx]);
-                }
-            }
-        }
+    rc = flash_area_write(fap, ALIGN_DOWN(flash_area_get_size(fap) -
+                                          BOOT_MAGIC_SZ, align),
+                          buf, align);
+#ifndef MCUBOOT_OVERWRITE_ONLY_KEEP_BACKUP
+    if (rc == 0) {
+        rc = flash_area_write(fap, 0, buf, align);
+    }
 #endif
 
-        rc = flash_area_write(fap_dst, off_dst + bytes_copied, buf, chunk_sz);
-        if (rc != 0) {
-            return BOOT_EFLASH;
-        }
+    return rc;
+}
+#endif
 
-        bytes_copied += chunk_sz;
+/*
+ * Copies the part of [off, off + sz) of the primary slot that holds data:
+ * the image, up to copy_end, and the trailer, from trailer_off. The padding
+ * in between is left erased.
+ */
+static int
+boot_copy_image_span(struct boot_loader_state *state,
+                     const struct flash_area *fap_secondary_slot,
+                     const struct flash_area *fap_primary_slot,
+                     size_t off, size_t sz, size_t copy_end,
+                     size_t trailer_off)
+{
+    size_t start;
+    size_t end;
+    int rc;
 
-        MCUBOOT_WATCHDOG_FEED();
+    rc = 0;
+    if (off < copy_end) {
+        end = (off + sz < copy_end) ? off + sz : copy_end;
+        rc = boot_copy_region(state, fap_secondary_slot, fap_primary_slot,
+                              off, off, end - off);
+    }
+    if (rc == 0 && off + sz > trailer_off) {
+        start = (off > trailer_off) ? off : trailer_off;
+        rc = boot_copy_region(state, fap_secondary_slot, fap_primary_slot,
+                              start, start, off + sz - start);
     }
 
-    return 0;
+    return rc;
 }
 
-/**
- * Overwrite primary slot with the image contained in the secondary slot.
- * If a prior copy operation was interrupted by a system reset, this function
- * redos the copy.
- *
- * @param bs                    The current boot status.  This function reads
- *                                  this struct to determine if it is resuming
- *                                  an interrupted swap operation.  This
- *                                  function writes the updated status to this
- *                                  function on return.
- *
- * @return                      0 on success; nonzero on failure.
- */
-#if defined(MCUBOOT_OVERWRITE_ONLY) || defined(MCUBOOT_BOOTSTRAP)
 static int
 boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
 {
@@ -1371,6 +2980,9 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
     size_t size;
     size_t this_size;
     size_t last_sector;
+    size_t copy_end;
+    size_t trailer_off;
+    uint32_t src_size;
     const struct flash_area *fap_primary_slot;
     const struct flash_area *fap_secondary_slot;
     uint8_t image_index;
@@ -1382,12 +2994,42 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
     uint32_t sz;
 #endif
 
+#if defined(BOOT_VERIFY_COPY)
+    bootutil_sha_context sha_ctx;
+    uint8_t hash[IMAGE_HASH_SIZE];
+    struct image_header *hdr;
+    bool verify_copy;
+#endif
+
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+    size_t copy_off;
+    size_t copy_sz;
+    size_t resume_off;
+    bool record;
+#endif
+
+#if defined(MCUBOOT_UPGRADE_PROGRESS)
+    size_t progress_off;
+    uint32_t progress_cnt;
+#endif
+
+#if defined(MCUBOOT_ERASE_AHEAD)
+    uint32_t erased_sz;
+#endif
+
     (void)bs;
 
-#if defined(MCUBOOT_OVERWRITE_ONLY_FAST)
-    uint32_t src_size = 0;
+    src_size = 0;
     rc = boot_read_image_size(state, BOOT_SECONDARY_SLOT, &src_size);
     assert(rc == 0);
+#if defined(MCUBOOT_DECOMPRESS_IMAGES)
+    /* Erase what the decompressed image needs. */
+    if (IS_COMPRESSED(boot_img_hdr(state, BOOT_SECONDARY_SLOT))) {
+        rc = boot_decompressed_image_size(boot_img_hdr(state, BOOT_SECONDARY_SLOT),
+                                          BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT),
+                                          &src_size);
+        assert(rc == 0);
+    }
 #endif
 
     image_index = BOOT_CURR_IMG(state);
@@ -1395,19 +3037,45 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
     BOOT_LOG_INF("Image %d upgrade secondary slot -> primary slot", image_index);
     BOOT_LOG_INF("Erasing the primary slot");
 
-    rc = flash_area_open(FLASH_AREA_IMAGE_PRIMARY(image_index),
-            &fap_primary_slot);
-    assert (rc == 0);
-
-    rc = flash_area_open(FLASH_AREA_IMAGE_SECONDARY(image_index),
-            &fap_secondary_slot);
-    assert (rc == 0);
+    fap_primary_slot = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
+    fap_secondary_slot = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
 
     sect_count = boot_img_num_sectors(state, BOOT_PRIMARY_SLOT);
+#if defined(MCUBOOT_ERASE_AHEAD)
+    erased_sz = boot_erase_ahead_wait(state, image_index);
+#endif
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+    rc = boot_copy_status_read(state, fap_secondary_slot, bs, src_size,
+                               sect_count, &record);
+    if (rc != 0) {
+        return rc;
+    }
+    if (bs->idx != BOOT_STATUS_IDX_0) {
+        BOOT_LOG_INF("Image %d resuming the copy at sector %u", image_index,
+                     (unsigned)(bs->idx - BOOT_STATUS_IDX_0));
+    }
+    resume_off = 0;
+#endif
     for (sect = 0, size = 0; sect < sect_count; sect++) {
         this_size = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, sect);
-        rc = boot_erase_region(fap_primary_slot, size, this_size);
-        assert(rc == 0);
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+        if (BOOT_STATUS_IDX_0 + sect < bs->idx) {
+            resume_off += this_size;
+        }
+
+        /* When progress is recorded, each sector is erased right before it
+         * is copied instead.
+         */
+        if (!record)
+#endif
+#if defined(MCUBOOT_ERASE_AHEAD)
+        /* The sectors erased ahead while the previous image was copied. */
+        if (size + this_size > erased_sz)
+#endif
+        {
+            rc = boot_erase_region(fap_primary_slot, size, this_size);
+            assert(rc == 0);
+        }
 
 #if defined(MCUBOOT_OVERWRITE_ONLY_FAST)
         if ((size + this_size) >= src_size) {
@@ -1420,6 +3088,25 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
         size += this_size;
     }
 
+    /* Only the image and the trailer are copied, the padding in between is
+     * left erased. With MCUBOOT_OVERWRITE_ONLY_FAST, size already ends with
+     * the image and the trailer is written anew.
+     */
+#if defined(MCUBOOT_OVERWRITE_ONLY_FAST)
+    copy_end = size;
+    trailer_off = size;
+#else
+    trailer_off = ALIGN_DOWN(size - boot_trailer_sz(BOOT_WRITE_SZ(state)),
+                             BOOT_WRITE_SZ(state));
+    if (src_size == 0 || src_size >= trailer_off) {
+        /* Unknown size or the image runs into the trailer. */
+        copy_end = size;
+        trailer_off = size;
+    } else {
+        copy_end = ALIGN_UP(src_size, BOOT_WRITE_SZ(state));
+    }
+#endif
+
 #if defined(MCUBOOT_OVERWRITE_ONLY_FAST)
     trailer_sz = boot_trailer_sz(BOOT_WRITE_SZ(state));
     sector = boot_img_num_sectors(state, BOOT_PRIMARY_SLOT) - 1;
@@ -1430,8 +3117,20 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
         sector--;
     } while (sz < trailer_sz);
 
-    rc = boot_erase_region(fap_primary_slot, off, sz);
-    assert(rc == 0);
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+    /* Do not erase what has been copied already if the image shares its
+     * last sectors with the trailer.
+     */
+    if (off < resume_off) {
+        sz = (off + sz > resume_off) ? off + sz - resume_off : 0;
+        off = resume_off;
+    }
+    if (sz > 0)
+#endif
+    {
+        rc = boot_erase_region(fap_primary_slot, off, sz);
+        assert(rc == 0);
+    }
 #endif
 
 #ifdef MCUBOOT_ENC_IMAGES
@@ -1449,9 +3148,107 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
     }
 #endif
 
+#if defined(BOOT_VERIFY_COPY)
+    /* Chunk hashed images have been fully validated in the secondary slot
+     * already; all others are hashed on the fly.
+     */
+    hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
+    verify_copy = !(hdr->ih_flags & IMAGE_F_HASH_CHUNKED);
+    if (verify_copy) {
+        bootutil_sha_init(&sha_ctx);
+        state->copy_sha = &sha_ctx;
+        state->copy_sha_sz = hdr->ih_hdr_size + hdr->ih_img_size +
+                             hdr->ih_protect_tlv_size;
+    }
+#endif
+
     BOOT_LOG_INF("Image %d copying the secondary slot to the primary slot: 0x%zx bytes",
-                 image_index, size);
-    rc = boot_copy_region(state, fap_secondary_slot, fap_primary_slot, 0, 0, size);
+                 image_index, copy_end + (size - trailer_off));
+#if defined(MCUBOOT_UPGRADE_PROGRESS)
+    /* The progress is reported for each sector copied. */
+    for (progress_cnt = 0, progress_off = 0; progress_off < size;
+         progress_cnt++) {
+        progress_off += boot_img_sector_size(state, BOOT_PRIMARY_SLOT,
+                                             progress_cnt);
+    }
+    boot_progress_start(state, progress_cnt, bs->idx - BOOT_STATUS_IDX_0);
+#endif
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+    if (record) {
+        rc = 0;
+        for (sect = 0, copy_off = 0; rc == 0 && copy_off < size; sect++) {
+            this_size = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, sect);
+            if (BOOT_STATUS_IDX_0 + sect >= bs->idx) {
+                copy_sz = size - copy_off;
+                if (copy_sz > this_size) {
+                    copy_sz = this_size;
+                }
+
+                rc = boot_erase_region(fap_primary_slot, copy_off, this_size);
+                if (rc == 0) {
+                    rc = boot_copy_image_span(state, fap_secondary_slot,
+                                              fap_primary_slot, copy_off,
+                                              copy_sz, copy_end, trailer_off);
+                }
+                if (rc == 0) {
+                    /* A failed status write only means that this sector is
+                     * copied again if the copy is interrupted.
+                     */
+                    if (boot_copy_status_write(state, fap_secondary_slot,
+                                               bs) != 0) {
+                        BOOT_LOG_WRN("Failed to record the copy of sector %u",
+                                     (unsigned)sect);
+                    }
+                    bs->idx++;
+                    boot_progress_step(copy_sz);
+                }
+            }
+            copy_off += this_size;
+        }
+    } else
+#endif
+#if defined(MCUBOOT_DECOMPRESS_IMAGES)
+    if (IS_COMPRESSED(boot_img_hdr(state, BOOT_SECONDARY_SLOT))) {
+        rc = boot_copy_region_decompress(state, fap_secondary_slot,
+                                         fap_primary_slot);
+    } else
+#endif
+    {
+#if defined(MCUBOOT_UPGRADE_PROGRESS)
+        rc = 0;
+        for (sect = 0, progress_off = 0; rc == 0 && progress_off < size;
+             sect++) {
+            this_size = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, sect);
+            if (this_size > size - progress_off) {
+                this_size = size - progress_off;
+            }
+
+            rc = boot_copy_image_span(state, fap_secondary_slot,
+                                      fap_primary_slot, progress_off,
+                                      this_size, copy_end, trailer_off);
+            progress_off += this_size;
+            boot_progress_step(this_size);
+        }
+#else
+        rc = boot_copy_image_span(state, fap_secondary_slot, fap_primary_slot,
+                                  0, size, copy_end, trailer_off);
+#endif
+    }
+
+#if defined(BOOT_VERIFY_COPY)
+    if (verify_copy) {
+        state->copy_sha = NULL;
+        if (rc == 0) {
+            bootutil_sha_finish(&sha_ctx, hash);
+        }
+        bootutil_sha_drop(&sha_ctx);
+        if (rc == 0) {
+            rc = boot_verify_copied_image(state, fap_primary_slot,
+                                          fap_secondary_slot, hash);
+        }
+    }
+#endif
+
     if (rc != 0) {
         return rc;
     }
@@ -1475,7 +3272,7 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
      * slot's image header must be passed since the image headers in the
      * boot_data structure have not been updated yet.
      */
-    rc = boot_update_security_counter(BOOT_CURR_IMG(state), BOOT_PRIMARY_SLOT,
+    rc = boot_update_security_counter(state, BOOT_PRIMARY_SLOT,
                                 boot_img_hdr(state, BOOT_SECONDARY_SLOT));
     if (rc != 0) {
         BOOT_LOG_ERR("Security counter update failed after image upgrade.");
@@ -1483,6 +3280,17 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
     }
 #endif /* MCUBOOT_HW_ROLLBACK_PROT */
 
+#ifdef MCUBOOT_OVERWRITE_ONLY_TOMBSTONE
+    if (boot_write_tombstone(state, fap_secondary_slot) == 0) {
+        return 0;
+    }
+    BOOT_LOG_WRN("Failed to invalidate the secondary slot, erasing it");
+#endif
+
+#ifdef MCUBOOT_IMAGE_SOURCE
+    (void)last_sector;
+    boot_image_source_done(image_index, true);
+#else
 #ifndef MCUBOOT_OVERWRITE_ONLY_KEEP_BACKUP
     /*
      * Erases header and trailer. The trailer is erased because when a new
@@ -1504,9 +3312,7 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
                            boot_img_sector_size(state, BOOT_SECONDARY_SLOT,
                                last_sector));
     assert(rc == 0);
-
-    flash_area_close(fap_primary_slot);
-    flash_area_close(fap_secondary_slot);
+#endif
 
     /* TODO: Perhaps verify the primary slot's signature again? */
 
@@ -1558,7 +3364,14 @@ boot_swap_image(struct boot_loader_state *state, struct boot_status *bs)
         }
 
 #ifdef MCUBOOT_ENC_IMAGES
+#ifdef MCUBOOT_SWAP_PERM_DISCARD
+        /* The key of the image in the primary slot is only used to encrypt
+         * it again on its way to the secondary slot.
+         */
+        if (IS_ENCRYPTED(hdr) && !boot_swap_discards_primary(state)) {
+#else
         if (IS_ENCRYPTED(hdr)) {
+#endif
             fap = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
             rc = boot_enc_load(BOOT_CURR_ENC(state), 0, hdr, fap, bs);
             assert(rc >= 0);
@@ -1637,10 +3450,11 @@ boot_swap_image(struct boot_loader_state *state, struct boot_status *bs)
         flash_area_close(fap);
     }
 
+    boot_phase_start(BOOT_PHASE_SWAP);
     swap_run(state, bs, copy_size);
+    boot_phase_stop(BOOT_PHASE_SWAP);
 
 #ifdef MCUBOOT_VALIDATE_PRIMARY_SLOT
-    extern int boot_status_fails;
     if (boot_status_fails > 0) {
         BOOT_LOG_WRN("%d status write fails performing the swap",
                      boot_status_fails);
@@ -1654,6 +3468,59 @@ boot_swap_image(struct boot_loader_state *state, struct boot_status *bs)
 #endif
 
 
+#ifdef MCUBOOT_BOOTSTRAP_VERIFY_COPY
+/*
+ * Whether the primary slot of the current image holds an image installed by
+ * a bootstrap or a permanent upgrade, which needs not be bootstrapped: the
+ * image is validated before it is booted anyway.
+ */
+static bool
+boot_bootstrap_installed(struct boot_loader_state *state)
+{
+    struct boot_swap_state swap_state;
+
+    if (boot_read_swap_state(BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT),
+                             &swap_state) != 0) {
+        return false;
+    }
+
+    return swap_state.magic == BOOT_MAGIC_GOOD &&
+           swap_state.image_ok == BOOT_FLAG_SET &&
+           swap_state.copy_done == BOOT_FLAG_SET;
+}
+
+/*
+ * Checks the image in the secondary slot before it is bootstrapped. Unless it
+ * is chunk hashed, it is hashed while it is copied, so only its header and
+ * TLVs are checked here.
+ */
+static fih_ret
+boot_bootstrap_check_secondary(struct boot_loader_state *state,
+                               struct boot_status *bs)
+{
+    const struct flash_area *fap;
+    struct image_header *hdr;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    fap = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
+    if (hdr->ih_flags & IMAGE_F_HASH_CHUNKED) {
+        FIH_CALL(boot_validate_slot, fih_rc, state, BOOT_SECONDARY_SLOT, bs);
+        FIH_RET(fih_rc);
+    }
+
+    if (boot_check_header_erased(state, BOOT_SECONDARY_SLOT) == 0 ||
+        (hdr->ih_flags & IMAGE_F_NON_BOOTABLE) ||
+        !boot_is_header_valid(hdr, fap, state)) {
+        FIH_RET(FIH_NO_BOOTABLE_IMAGE);
+    }
+
+    FIH_CALL(boot_check_image_tlvs, fih_rc, state, hdr, fap);
+    FIH_RET(fih_rc);
+}
+#endif /* MCUBOOT_BOOTSTRAP_VERIFY_COPY */
+
+
 /**
  * Performs a clean (not aborted) image update.
  *
@@ -1669,27 +3536,64 @@ boot_perform_update(struct boot_loader_state *state, struct boot_status *bs)
     uint8_t swap_type;
 #endif
 
+#ifdef MCUBOOT_MEASURED_BOOT
+    /* Both slots are about to be rewritten, their hashes no longer hold. */
+    memset(state->measured[BOOT_CURR_IMG(state)], 0,
+           sizeof(state->measured[BOOT_CURR_IMG(state)]));
+#endif
+
     /* At this point there are no aborted swaps. */
 #if defined(MCUBOOT_OVERWRITE_ONLY)
+    boot_phase_start(BOOT_PHASE_COPY);
     rc = boot_copy_image(state, bs);
+    boot_phase_stop(BOOT_PHASE_COPY);
 #elif defined(MCUBOOT_BOOTSTRAP)
     /* Check if the image update was triggered by a bad image in the
      * primary slot (the validity of the image in the secondary slot had
      * already been checked).
      */
     FIH_DECLARE(fih_rc, FIH_FAILURE);
-    rc = boot_check_header_erased(state, BOOT_PRIMARY_SLOT);
-    FIH_CALL(boot_validate_slot, fih_rc, state, BOOT_PRIMARY_SLOT, bs);
+#ifdef MCUBOOT_BOOTSTRAP_VERIFY_COPY
+    if (state->bootstrap_copy[BOOT_CURR_IMG(state)]) {
+        /* The primary slot was already found empty or invalid. */
+        rc = 0;
+    } else
+#endif
+    {
+        rc = boot_check_header_erased(state, BOOT_PRIMARY_SLOT);
+        FIH_CALL(boot_validate_slot, fih_rc, state, BOOT_PRIMARY_SLOT, bs);
+    }
     if (rc == 0 || FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        boot_phase_start(BOOT_PHASE_COPY);
         rc = boot_copy_image(state, bs);
+        boot_phase_stop(BOOT_PHASE_COPY);
     } else {
         rc = boot_swap_image(state, bs);
     }
 #else
         rc = boot_swap_image(state, bs);
+#endif
+#if defined(BOOT_VERIFY_COPY)
+    if (rc == BOOT_EBADIMAGE) {
+        /* The image failed verification while being copied and both slots
+         * have been erased.
+         */
+        BOOT_SWAP_TYPE(state) = BOOT_SWAP_TYPE_FAIL;
+        return 0;
+    }
 #endif
     assert(rc == 0);
 
+#ifdef MCUBOOT_VALIDATION_CACHE_UPGRADE
+    /* The primary slot now holds the image validated in the secondary slot,
+     * unless a revert or an interrupted swap was completed.
+     */
+    if (BOOT_SWAP_TYPE(state) == BOOT_SWAP_TYPE_TEST ||
+        BOOT_SWAP_TYPE(state) == BOOT_SWAP_TYPE_PERM) {
+        state->upgrade_installed[BOOT_CURR_IMG(state)] = true;
+    }
+#endif
+
 #ifndef MCUBOOT_OVERWRITE_ONLY
     /* The following state needs image_ok be explicitly set after the
      * swap was finished to avoid a new revert.
@@ -1715,7 +3619,7 @@ boot_perform_update(struct boot_loader_state *state, struct boot_status *bs)
          * counter must be increased right after the image upgrade.
          */
         rc = boot_update_security_counter(
-                                    BOOT_CURR_IMG(state),
+                                    state,
                                     BOOT_PRIMARY_SLOT,
                                     boot_img_hdr(state, BOOT_SECONDARY_SLOT));
         if (rc != 0) {
@@ -1732,6 +3636,21 @@ boot_perform_update(struct boot_loader_state *state, struct boot_status *bs)
             BOOT_SWAP_TYPE(state) = BOOT_SWAP_TYPE_PANIC;
         }
     }
+
+#ifdef MCUBOOT_BOOTSTRAP_VERIFY_COPY
+    if (state->bootstrap_copy[BOOT_CURR_IMG(state)]) {
+        state->bootstrap_copy[BOOT_CURR_IMG(state)] = false;
+        /* The magic, written last, marks the image as installed, so that
+         * the next boots do not look for a bootstrap.
+         */
+        if (rc == 0) {
+            rc = boot_write_magic(BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT));
+            if (rc != 0) {
+                BOOT_SWAP_TYPE(state) = BOOT_SWAP_TYPE_PANIC;
+            }
+        }
+    }
+#endif
 #endif /* !MCUBOOT_OVERWRITE_ONLY */
 
     return rc;
@@ -1846,6 +3765,83 @@ boot_review_image_swap_types(struct boot_loader_state *state,
 }
 #endif
 
+#ifdef MCUBOOT_LAZY_SECTORS
+/*
+ * Tells whether the current image may have to be swapped or copied during
+ * this boot: a swap was interrupted, or its trailers request an upgrade or a
+ * revert. Each trailer is read once, with a single flash read, from the
+ * areas already open. This is the union of the conditions checked by
+ * swap_status_source() and boot_swap_type_multi(), so an image is never
+ * wrongly found clean; on a read error it is found pending, and the regular
+ * path then decides.
+ */
+static bool
+boot_update_pending(struct boot_loader_state *state)
+{
+    struct boot_swap_state primary_slot;
+    struct boot_swap_state secondary_slot;
+#ifdef MCUBOOT_SWAP_USING_SCRATCH
+    struct boot_swap_state scratch;
+#endif
+    int rc;
+
+    rc = BOOT_HOOK_CALL(boot_read_swap_state_primary_slot_hook,
+                        BOOT_HOOK_REGULAR, BOOT_CURR_IMG(state), &primary_slot);
+    if (rc == BOOT_HOOK_REGULAR) {
+        rc = boot_read_swap_state(BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT),
+                                  &primary_slot);
+    }
+    if (rc != 0) {
+        return true;
+    }
+
+    if (primary_slot.magic == BOOT_MAGIC_GOOD) {
+#ifndef MCUBOOT_OVERWRITE_ONLY
+        /* A swap was interrupted. */
+        if (primary_slot.copy_done == BOOT_FLAG_UNSET) {
+            return true;
+        }
+#endif
+        /* A revert is requested. */
+        if (primary_slot.copy_done == BOOT_FLAG_SET &&
+            primary_slot.image_ok == BOOT_FLAG_UNSET) {
+            return true;
+        }
+    }
+
+#ifdef MCUBOOT_IMAGE_SOURCE
+    (void)secondary_slot;
+    if (boot_image_source_pending(BOOT_CURR_IMG(state))) {
+        return true;
+    }
+#else
+    rc = boot_read_swap_state(BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT),
+                              &secondary_slot);
+    if (rc == BOOT_EFLASH) {
+        /* Unreachable, treated as empty as by boot_swap_type_multi(). */
+        secondary_slot.magic = BOOT_MAGIC_UNSET;
+    } else if (rc != 0) {
+        return true;
+    }
+
+    /* An upgrade is requested. */
+    if (secondary_slot.magic == BOOT_MAGIC_GOOD) {
+        return true;
+    }
+#endif
+
+#ifdef MCUBOOT_SWAP_USING_SCRATCH
+    /* A swap was interrupted with its status in the scratch area. */
+    rc = boot_read_swap_state_by_id(FLASH_AREA_IMAGE_SCRATCH, &scratch);
+    if (rc != 0 || scratch.magic == BOOT_MAGIC_GOOD) {
+        return true;
+    }
+#endif
+
+    return false;
+}
+#endif
+
 /**
  * Prepare image to be updated if required.
  *
@@ -1868,6 +3864,33 @@ boot_prepare_image_for_update(struct boot_loader_state *state,
     int max_size;
 #endif
 
+#ifdef MCUBOOT_LAZY_SECTORS
+    /* Booting the primary slot as it is does not need the sector layout of
+     * the slots, it is only read when there is an update to perform. Nothing
+     * uses the secondary slot header either in that case.
+     */
+    if (!boot_update_pending(state)) {
+        BOOT_LOG_INF("Image index: %d, no update pending", BOOT_CURR_IMG(state));
+        BOOT_WRITE_SZ(state) = boot_write_sz(state);
+        BOOT_SWAP_TYPE(state) = BOOT_SWAP_TYPE_NONE;
+        boot_status_reset(bs);
+
+        rc = BOOT_HOOK_CALL(boot_read_image_header_hook, BOOT_HOOK_REGULAR,
+                            BOOT_CURR_IMG(state), BOOT_PRIMARY_SLOT,
+                            boot_img_hdr(state, BOOT_PRIMARY_SLOT));
+        if (rc == BOOT_HOOK_REGULAR) {
+            rc = boot_read_image_header(state, BOOT_PRIMARY_SLOT,
+                                        boot_img_hdr(state, BOOT_PRIMARY_SLOT),
+                                        NULL);
+        }
+        if (rc != 0) {
+            BOOT_LOG_WRN("Failed reading image headers; Image=%u",
+                    BOOT_CURR_IMG(state));
+        }
+        return;
+    }
+#endif
+
     /* Determine the sector layout of the image slots and scratch area. */
     rc = boot_read_sectors(state);
     if (rc != 0) {
@@ -1921,12 +3944,18 @@ boot_prepare_image_for_update(struct boot_loader_state *state,
         }
 #endif
 
-#if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE)
+#if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE) || \
+    defined(MCUBOOT_SWAP_USING_OFFSET)
         /*
          * Must re-read image headers because the boot status might
-         * have been updated in the previous function call.
+         * have been updated in the previous function call. Without a swap
+         * in progress, the headers read above are still the ones in the
+         * slots.
          */
-        rc = boot_read_image_headers(state, !boot_status_is_reset(bs), bs);
+        rc = 0;
+        if (!boot_status_is_reset(bs)) {
+            rc = boot_read_image_headers(state, true, bs);
+        }
 #ifdef MCUBOOT_BOOTSTRAP
         /* When bootstrapping it's OK to not have image magic in the primary slot */
         if (rc != 0 && boot_check_header_erased(state, BOOT_PRIMARY_SLOT) != 0) {
@@ -2009,14 +4038,27 @@ boot_prepare_image_for_update(struct boot_loader_state *state,
                  * sure it's not OK.
                  */
                 rc = boot_check_header_erased(state, BOOT_PRIMARY_SLOT);
+#ifdef MCUBOOT_BOOTSTRAP_VERIFY_COPY
+                state->bootstrap_copy[BOOT_CURR_IMG(state)] = false;
+                if (rc != 0 && boot_bootstrap_installed(state)) {
+                    /* Validated before it is booted, it is not checked
+                     * twice.
+                     */
+                    fih_rc = FIH_SUCCESS;
+                } else
+#endif
                 FIH_CALL(boot_validate_slot, fih_rc,
                          state, BOOT_PRIMARY_SLOT, bs);
 
                 if (rc == 0 || FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
 
                     rc = (boot_img_hdr(state, BOOT_SECONDARY_SLOT)->ih_magic == IMAGE_MAGIC) ? 1: 0;
+#ifdef MCUBOOT_BOOTSTRAP_VERIFY_COPY
+                    FIH_CALL(boot_bootstrap_check_secondary, fih_rc, state, bs);
+#else
                     FIH_CALL(boot_validate_slot, fih_rc,
                              state, BOOT_SECONDARY_SLOT, bs);
+#endif
 
                     if (rc == 1 && FIH_EQ(fih_rc, FIH_SUCCESS)) {
                         /* Set swap type to REVERT to overwrite the primary
@@ -2025,6 +4067,9 @@ boot_prepare_image_for_update(struct boot_loader_state *state,
                          * image_ok flag.
                          */
                         BOOT_SWAP_TYPE(state) = BOOT_SWAP_TYPE_REVERT;
+#ifdef MCUBOOT_BOOTSTRAP_VERIFY_COPY
+                        state->bootstrap_copy[BOOT_CURR_IMG(state)] = true;
+#endif
                     }
                 }
             }
@@ -2061,7 +4106,7 @@ boot_update_hw_rollback_protection(struct boot_loader_state *state)
     */
     if (BOOT_SWAP_TYPE(state) == BOOT_SWAP_TYPE_NONE) {
         rc = boot_update_security_counter(
-                                BOOT_CURR_IMG(state),
+                                state,
                                 BOOT_PRIMARY_SLOT,
                                 boot_img_hdr(state, BOOT_PRIMARY_SLOT));
         if (rc != 0) {
@@ -2094,7 +4139,8 @@ static int
 check_downgrade_prevention(struct boot_loader_state *state)
 {
 #if defined(MCUBOOT_DOWNGRADE_PREVENTION) && \
-    (defined(MCUBOOT_SWAP_USING_MOVE) || defined(MCUBOOT_SWAP_USING_SCRATCH))
+    (defined(MCUBOOT_SWAP_USING_MOVE) || defined(MCUBOOT_SWAP_USING_SCRATCH) || \
+     defined(MCUBOOT_SWAP_USING_OFFSET) || defined(MCUBOOT_SWAP_USING_BANK))
     uint32_t security_counter[2];
     int rc;
 
@@ -2134,6 +4180,94 @@ check_downgrade_prevention(struct boot_loader_state *state)
 #endif
 }
 
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+/**
+ * Hashes the primary slot of every image selected by
+ * boot_parallel_hash_start(). This runs on a secondary core, so it only reads
+ * the headers and flash areas of these images and uses its own buffer.
+ *
+ * @param  arg          Boot loader status information.
+ */
+static void
+boot_parallel_hash_job(void *arg)
+{
+    struct boot_loader_state *state = arg;
+    uint32_t image_index;
+    int rc;
+    BOOT_WORK_BUF(tmpbuf);
+
+    for (image_index = 1; image_index < BOOT_IMAGE_NUMBER; image_index++) {
+        if (!state->primary_hash[image_index].pending) {
+            continue;
+        }
+
+        rc = bootutil_img_hash(NULL, image_index,
+                               &state->imgs[image_index][BOOT_PRIMARY_SLOT].hdr,
+                               state->imgs[image_index][BOOT_PRIMARY_SLOT].area,
+                               tmpbuf, BOOT_WORK_BUF_SZ,
+                               state->primary_hash[image_index].hash, NULL, 0);
+        state->primary_hash[image_index].valid = (rc == 0);
+    }
+}
+
+/**
+ * Starts hashing the primary slot of every image but the first on a
+ * secondary core, while the first image is validated. Called once all the
+ * upgrades are done.
+ *
+ * @param  state        Boot loader status information.
+ *
+ * @return              true if the hashing was started; false otherwise.
+ */
+static bool
+boot_parallel_hash_start(struct boot_loader_state *state)
+{
+    bool any = false;
+
+    IMAGES_ITER(BOOT_CURR_IMG(state)) {
+        state->primary_hash[BOOT_CURR_IMG(state)].pending = false;
+        state->primary_hash[BOOT_CURR_IMG(state)].valid = false;
+
+        if (BOOT_CURR_IMG(state) == 0 || state->img_mask[BOOT_CURR_IMG(state)]) {
+            continue;
+        }
+#ifdef MCUBOOT_LAZY_VALIDATION
+        if (state->img_deferred[BOOT_CURR_IMG(state)]) {
+            continue;
+        }
+#endif
+        if (BOOT_SWAP_TYPE(state) != BOOT_SWAP_TYPE_NONE &&
+            boot_read_image_headers(state, false, NULL) != 0) {
+            continue;
+        }
+        if (BOOT_IMG(state, BOOT_PRIMARY_SLOT).hdr.ih_magic != IMAGE_MAGIC) {
+            continue;
+        }
+
+        state->primary_hash[BOOT_CURR_IMG(state)].pending = true;
+        any = true;
+    }
+
+    return any && boot_parallel_start(boot_parallel_hash_job, state) == 0;
+}
+
+/**
+ * Waits for the hashing started by boot_parallel_hash_start() to complete.
+ *
+ * @param  state        Boot loader status information.
+ */
+static void
+boot_parallel_hash_join(struct boot_loader_state *state)
+{
+    if (boot_parallel_join() != 0) {
+        BOOT_LOG_WRN("Hashing on the secondary core failed");
+        IMAGES_ITER(BOOT_CURR_IMG(state)) {
+            state->primary_hash[BOOT_CURR_IMG(state)].valid = false;
+        }
+    }
+}
+#endif /* MCUBOOT_PARALLEL_VALIDATION */
+
 fih_ret
 context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
 {
@@ -2145,8 +4279,11 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
     int image_index;
     bool has_upgrade;
     volatile int fih_cnt;
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+    bool hashing = false;
+#endif
 
-#if defined(__BOOTSIM__)
+#if defined(__BOOTSIM__) && !defined(MCUBOOT_SECTOR_RUNS)
     /* The array of slot sectors are defined here (as opposed to file scope) so
      * that they don't get allocated for non-boot-loader apps.  This is
      * necessary because the gcc option "-fdata-sections" doesn't seem to have
@@ -2185,7 +4322,9 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
 
         image_index = BOOT_CURR_IMG(state);
 
-#if !defined(__BOOTSIM__)
+#if defined(MCUBOOT_SECTOR_RUNS)
+        /* The sector runs are held in the state itself. */
+#elif !defined(__BOOTSIM__)
         BOOT_IMG(state, BOOT_PRIMARY_SLOT).sectors =
             sector_buffers.primary[image_index];
         BOOT_IMG(state, BOOT_SECONDARY_SLOT).sectors =
@@ -2303,6 +4442,9 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
                                 BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT));
             if (rc == BOOT_HOOK_REGULAR)
             {
+#ifdef MCUBOOT_ERASE_AHEAD
+                boot_erase_ahead_start(state);
+#endif
                 rc = boot_perform_update(state, &bs);
             }
             assert(rc == 0);
@@ -2335,12 +4477,29 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
         }
     }
 
+#ifdef MCUBOOT_ERASE_AHEAD
+    /* No erase may be left running on a slot that is about to be read. */
+    IMAGES_ITER(BOOT_CURR_IMG(state)) {
+        (void)boot_erase_ahead_wait(state, BOOT_CURR_IMG(state));
+    }
+#endif
+
     /* Iterate over all the images. At this point all required update operations
      * have finished. By the end of the loop each image in the primary slot will
      * have been re-validated.
      */
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+    hashing = boot_parallel_hash_start(state);
+#endif
     FIH_SET(fih_cnt, 0);
     IMAGES_ITER(BOOT_CURR_IMG(state)) {
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+        if (hashing && BOOT_CURR_IMG(state) != 0) {
+            /* The other images are hashed while the first one is validated. */
+            boot_parallel_hash_join(state);
+            hashing = false;
+        }
+#endif
 #if BOOT_IMAGE_NUMBER > 1
         /* Hardenned to prevent from skipping check of a given image,
          * tmp_img_mask is declared volatile
@@ -2351,6 +4510,18 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
             ++fih_cnt;
             continue;
         }
+#endif
+#ifdef MCUBOOT_LAZY_VALIDATION
+        /* The image was upgraded above; its primary slot is validated by
+         * boot_validate_deferred_image() before its core is started.
+         */
+        volatile bool tmp_img_deferred;
+        FIH_SET(tmp_img_deferred, state->img_deferred[BOOT_CURR_IMG(state)]);
+        if (FIH_EQ(tmp_img_deferred, true)) {
+            BOOT_LOG_INF("Image %d: validation deferred", BOOT_CURR_IMG(state));
+            ++fih_cnt;
+            continue;
+        }
 #endif
         if (BOOT_SWAP_TYPE(state) != BOOT_SWAP_TYPE_NONE) {
             /* Attempt to read an image header from each slot. Ensure that image
@@ -2421,6 +4592,16 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
         FIH_PANIC;
     }
 
+#ifdef MCUBOOT_HW_ROLLBACK_PROT_CACHE
+    /* The security counter updates of all images are written together. */
+    rc = boot_security_counter_commit();
+    if (rc != 0) {
+        BOOT_LOG_ERR("Security counter update failed.");
+        FIH_SET(fih_rc, FIH_FAILURE);
+        goto out;
+    }
+#endif
+
     fill_rsp(state, rsp);
 
     fih_rc = FIH_SUCCESS;
@@ -2436,6 +4617,12 @@ out:
     memset(&bs, 0, sizeof(struct boot_status));
 #endif
 
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+    if (hashing) {
+        /* The first image failed, the flash areas are still in use. */
+        boot_parallel_hash_join(state);
+    }
+#endif
     close_all_flash_areas(state);
     FIH_RET(fih_rc);
 }
@@ -2443,19 +4630,23 @@ out:
 fih_ret
 split_go(int loader_slot, int split_slot, void **entry)
 {
+#ifndef MCUBOOT_SECTOR_RUNS
     boot_sector_t *sectors;
+#endif
     uintptr_t entry_val;
     int loader_flash_id;
     int split_flash_id;
     int rc;
     FIH_DECLARE(fih_rc, FIH_FAILURE);
 
+#ifndef MCUBOOT_SECTOR_RUNS
     sectors = malloc(BOOT_MAX_IMG_SECTORS * 2 * sizeof *sectors);
     if (sectors == NULL) {
         FIH_RET(FIH_FAILURE);
     }
     BOOT_IMG(&boot_data, loader_slot).sectors = sectors + 0;
     BOOT_IMG(&boot_data, split_slot).sectors = sectors + BOOT_MAX_IMG_SECTORS;
+#endif
 
     loader_flash_id = flash_area_id_from_image_slot(loader_slot);
     rc = flash_area_open(loader_flash_id,
@@ -2466,49 +4657,257 @@ split_go(int loader_slot, int split_slot, void **entry)
                          &BOOT_IMG_AREA(&boot_data, split_slot));
     assert(rc == 0);
 
-    /* Determine the sector layout of the image slots and scratch area. */
-    rc = boot_read_sectors(&boot_data);
-    if (rc != 0) {
-        rc = SPLIT_GO_ERR;
-        goto done;
-    }
+    /* Determine the sector layout of the image slots and scratch area. */
+    rc = boot_read_sectors(&boot_data);
+    if (rc != 0) {
+        rc = SPLIT_GO_ERR;
+        goto done;
+    }
+
+    rc = boot_read_image_headers(&boot_data, true, NULL);
+    if (rc != 0) {
+        goto done;
+    }
+
+    /* Don't check the bootable image flag because we could really call a
+     * bootable or non-bootable image.  Just validate that the image check
+     * passes which is distinct from the normal check.
+     */
+    FIH_CALL(split_image_check, fih_rc,
+             boot_img_hdr(&boot_data, split_slot),
+             BOOT_IMG_AREA(&boot_data, split_slot),
+             boot_img_hdr(&boot_data, loader_slot),
+             BOOT_IMG_AREA(&boot_data, loader_slot));
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        goto done;
+    }
+
+    entry_val = boot_img_slot_off(&boot_data, split_slot) +
+                boot_img_hdr(&boot_data, split_slot)->ih_hdr_size;
+    *entry = (void *) entry_val;
+    rc = SPLIT_GO_OK;
+
+done:
+    flash_area_close(BOOT_IMG_AREA(&boot_data, split_slot));
+    flash_area_close(BOOT_IMG_AREA(&boot_data, loader_slot));
+#ifndef MCUBOOT_SECTOR_RUNS
+    free(sectors);
+#endif
+
+    if (rc) {
+        FIH_SET(fih_rc, FIH_FAILURE);
+    }
+
+    FIH_RET(fih_rc);
+}
+
+#else /* MCUBOOT_DIRECT_XIP || MCUBOOT_RAM_LOAD */
+
+/**
+ * Reads the image header of each slot of the current image and checks which
+ * slots contain an image with a valid header.
+ *
+ * @param  state        Boot loader status information.
+ *
+ * @return              0 on success; nonzero on failure.
+ */
+static int
+boot_read_slot_usage(struct boot_loader_state *state)
+{
+    uint32_t slot;
+    int rc;
+    struct image_header *hdr = NULL;
+
+    /* Attempt to read an image header from each slot. */
+    rc = boot_read_image_headers(state, false, NULL);
+    if (rc != 0) {
+        BOOT_LOG_WRN("Failed reading image headers.");
+        return rc;
+    }
+
+    /* Check headers in all slots */
+    for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
+        hdr = boot_img_hdr(state, slot);
+
+        if (boot_is_header_valid(hdr, BOOT_IMG_AREA(state, slot), state)) {
+            state->slot_usage[BOOT_CURR_IMG(state)].slot_available[slot] = true;
+            BOOT_LOG_IMAGE_INFO(slot, hdr);
+        } else {
+            state->slot_usage[BOOT_CURR_IMG(state)].slot_available[slot] = false;
+            BOOT_LOG_INF("Image %d %s slot: Image not found",
+                         BOOT_CURR_IMG(state),
+                         (slot == BOOT_PRIMARY_SLOT)
+                         ? "Primary" : "Secondary");
+        }
+    }
+
+#ifdef MCUBOOT_BOOT_INDEX
+    state->slot_usage[BOOT_CURR_IMG(state)].hdr_from_index = false;
+#endif
+
+    return 0;
+}
+
+#ifdef MCUBOOT_BOOT_INDEX
+#if BOOT_INDEX_NUM_SLOTS != BOOT_NUM_SLOTS
+#error "BOOT_INDEX_NUM_SLOTS does not match BOOT_NUM_SLOTS"
+#endif
+
+/**
+ * Reads the erase generation counter of each slot of the current image.
+ *
+ * @param  state        Boot loader status information.
+ * @param  generations  Where the counters are written.
+ *
+ * @return              0 on success; nonzero on failure.
+ */
+static int
+boot_index_generations(struct boot_loader_state *state, uint32_t *generations)
+{
+    uint32_t slot;
+    int rc;
+
+    for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
+        rc = boot_index_generation(BOOT_CURR_IMG(state), slot,
+                                   &generations[slot]);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Sets the slot usage of the current image from the boot index, if none of
+ * its slots changed since they were indexed. Only the versions of the image
+ * headers are then known, the header of the selected slot is read by
+ * boot_read_indexed_header().
+ *
+ * @param  state        Boot loader status information.
+ * @param  idx          The boot index.
+ *
+ * @return              true if the index was used; false otherwise.
+ */
+static bool
+boot_index_load_slot_usage(struct boot_loader_state *state,
+                           const struct boot_index *idx)
+{
+    const struct boot_index_slot *entries;
+    uint32_t generations[BOOT_NUM_SLOTS];
+    struct image_header *hdr;
+    uint32_t slot;
+
+    entries = idx->slots[BOOT_CURR_IMG(state)];
+
+    if (boot_index_generations(state, generations) != 0) {
+        return false;
+    }
+    for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
+        if (entries[slot].generation != generations[slot]) {
+            return false;
+        }
+    }
+
+    for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
+        hdr = boot_img_hdr(state, slot);
+        memset(hdr, 0, sizeof(*hdr));
+        hdr->ih_ver = entries[slot].ver;
+        state->slot_usage[BOOT_CURR_IMG(state)].slot_available[slot] =
+            (entries[slot].available != 0);
+    }
+    state->slot_usage[BOOT_CURR_IMG(state)].hdr_from_index = true;
+
+    BOOT_LOG_DBG("Image %d: slot usage read from the boot index",
+                 BOOT_CURR_IMG(state));
+
+    return true;
+}
+
+/**
+ * Updates the boot index entries of the current image from its slot usage.
+ *
+ * @param  state        Boot loader status information.
+ * @param  idx          The boot index.
+ * @param  generations  Erase generation of each slot, read before the
+ *                      headers were.
+ *
+ * @return              true if the entries changed; false otherwise.
+ */
+static bool
+boot_index_store_slot_usage(struct boot_loader_state *state,
+                            struct boot_index *idx,
+                            const uint32_t *generations)
+{
+    struct boot_index_slot entry;
+    uint32_t slot;
+    bool changed = false;
+
+    for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
+        memset(&entry, 0, sizeof(entry));
+        entry.generation = generations[slot];
+        if (state->slot_usage[BOOT_CURR_IMG(state)].slot_available[slot]) {
+            entry.available = 1;
+            entry.ver = boot_img_hdr(state, slot)->ih_ver;
+        }
 
-    rc = boot_read_image_headers(&boot_data, true, NULL);
-    if (rc != 0) {
-        goto done;
+        if (memcmp(&idx->slots[BOOT_CURR_IMG(state)][slot], &entry,
+                   sizeof(entry)) != 0) {
+            idx->slots[BOOT_CURR_IMG(state)][slot] = entry;
+            changed = true;
+        }
     }
 
-    /* Don't check the bootable image flag because we could really call a
-     * bootable or non-bootable image.  Just validate that the image check
-     * passes which is distinct from the normal check.
-     */
-    FIH_CALL(split_image_check, fih_rc,
-             boot_img_hdr(&boot_data, split_slot),
-             BOOT_IMG_AREA(&boot_data, split_slot),
-             boot_img_hdr(&boot_data, loader_slot),
-             BOOT_IMG_AREA(&boot_data, loader_slot));
-    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
-        goto done;
-    }
+    return changed;
+}
 
-    entry_val = boot_img_slot_off(&boot_data, split_slot) +
-                boot_img_hdr(&boot_data, split_slot)->ih_hdr_size;
-    *entry = (void *) entry_val;
-    rc = SPLIT_GO_OK;
+/**
+ * Reads the header of the selected slot of the current image, whose version
+ * only was known from the boot index, and checks that it still matches the
+ * index. If it does not, the headers of all the slots of the image are read
+ * again.
+ *
+ * @param  state        Boot loader status information.
+ * @param  slot         The selected slot.
+ *
+ * @return              0 if the header matches the index; nonzero if the
+ *                      slot has to be selected again.
+ */
+static int
+boot_read_indexed_header(struct boot_loader_state *state, uint32_t slot)
+{
+    struct image_version ver;
+    struct image_header *hdr;
+    int rc;
 
-done:
-    flash_area_close(BOOT_IMG_AREA(&boot_data, split_slot));
-    flash_area_close(BOOT_IMG_AREA(&boot_data, loader_slot));
-    free(sectors);
+    hdr = boot_img_hdr(state, slot);
+    ver = hdr->ih_ver;
 
-    if (rc) {
-        FIH_SET(fih_rc, FIH_FAILURE);
+    rc = BOOT_HOOK_CALL(boot_read_image_header_hook, BOOT_HOOK_REGULAR,
+                        BOOT_CURR_IMG(state), slot, hdr);
+    if (rc == BOOT_HOOK_REGULAR) {
+        rc = boot_read_image_header(state, slot, hdr, NULL);
     }
 
-    FIH_RET(fih_rc);
-}
+    if (rc == 0 && boot_is_header_valid(hdr, BOOT_IMG_AREA(state, slot), state) &&
+        memcmp(&hdr->ih_ver, &ver, sizeof(ver)) == 0) {
+        BOOT_LOG_IMAGE_INFO(slot, hdr);
+        return 0;
+    }
 
-#else /* MCUBOOT_DIRECT_XIP || MCUBOOT_RAM_LOAD */
+    BOOT_LOG_WRN("Image %d: boot index is stale, reading all image headers",
+                 BOOT_CURR_IMG(state));
+    rc = boot_read_slot_usage(state);
+    if (rc != 0) {
+        for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
+            state->slot_usage[BOOT_CURR_IMG(state)].slot_available[slot] = false;
+        }
+        state->slot_usage[BOOT_CURR_IMG(state)].hdr_from_index = false;
+    }
+
+    return -1;
+}
+#endif /* MCUBOOT_BOOT_INDEX */
 
 /**
  * Opens all flash areas and checks which contain an image with a valid header.
@@ -2523,7 +4922,22 @@ boot_get_slot_usage(struct boot_loader_state *state)
     uint32_t slot;
     int fa_id;
     int rc;
-    struct image_header *hdr = NULL;
+#ifdef MCUBOOT_BOOT_INDEX
+    struct boot_index idx;
+    uint32_t generations[BOOT_NUM_SLOTS];
+    bool idx_valid;
+    bool idx_changed = false;
+    int gen_rc;
+
+    /* A single read gives the slot usage of all the images, as long as
+     * their slots have not changed since they were indexed.
+     */
+    idx_valid = (boot_index_read(&idx) == 0 && idx.magic == BOOT_INDEX_MAGIC);
+    if (!idx_valid) {
+        memset(&idx, 0, sizeof(idx));
+        idx.magic = BOOT_INDEX_MAGIC;
+    }
+#endif
 
     IMAGES_ITER(BOOT_CURR_IMG(state)) {
 #if BOOT_IMAGE_NUMBER > 1
@@ -2539,31 +4953,38 @@ boot_get_slot_usage(struct boot_loader_state *state)
             assert(rc == 0);
         }
 
-        /* Attempt to read an image header from each slot. */
-        rc = boot_read_image_headers(state, false, NULL);
-        if (rc != 0) {
-            BOOT_LOG_WRN("Failed reading image headers.");
-            return rc;
-        }
+        state->slot_usage[BOOT_CURR_IMG(state)].active_slot = NO_ACTIVE_SLOT;
 
-        /* Check headers in all slots */
-        for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
-            hdr = boot_img_hdr(state, slot);
+#ifdef MCUBOOT_BOOT_INDEX
+        if (!idx_valid || !boot_index_load_slot_usage(state, &idx)) {
+            /* The generations are read first, so that a slot written while
+             * its header is read is indexed again on the next boot.
+             */
+            gen_rc = boot_index_generations(state, generations);
 
-            if (boot_is_header_valid(hdr, BOOT_IMG_AREA(state, slot), state)) {
-                state->slot_usage[BOOT_CURR_IMG(state)].slot_available[slot] = true;
-                BOOT_LOG_IMAGE_INFO(slot, hdr);
-            } else {
-                state->slot_usage[BOOT_CURR_IMG(state)].slot_available[slot] = false;
-                BOOT_LOG_INF("Image %d %s slot: Image not found",
-                             BOOT_CURR_IMG(state),
-                             (slot == BOOT_PRIMARY_SLOT)
-                             ? "Primary" : "Secondary");
+            rc = boot_read_slot_usage(state);
+            if (rc != 0) {
+                return rc;
             }
+
+            if (gen_rc == 0 &&
+                boot_index_store_slot_usage(state, &idx, generations)) {
+                idx_changed = true;
+            }
+        }
+#else
+        rc = boot_read_slot_usage(state);
+        if (rc != 0) {
+            return rc;
         }
+#endif
+    }
 
-        state->slot_usage[BOOT_CURR_IMG(state)].active_slot = NO_ACTIVE_SLOT;
+#ifdef MCUBOOT_BOOT_INDEX
+    if (idx_changed && boot_index_write(&idx) != 0) {
+        BOOT_LOG_WRN("Failed to store the boot index");
     }
+#endif
 
     return 0;
 }
@@ -2648,16 +5069,12 @@ static int
 boot_select_or_erase(struct boot_loader_state *state)
 {
     const struct flash_area *fap;
-    int fa_id;
     int rc;
     uint32_t active_slot;
     struct boot_swap_state* active_swap_state;
 
     active_slot = state->slot_usage[BOOT_CURR_IMG(state)].active_slot;
-
-    fa_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), active_slot);
-    rc = flash_area_open(fa_id, &fap);
-    assert(rc == 0);
+    fap = BOOT_IMG_AREA(state, active_slot);
 
     active_swap_state = &(state->slot_usage[BOOT_CURR_IMG(state)].swap_state);
 
@@ -2675,10 +5092,13 @@ boot_select_or_erase(struct boot_loader_state *state)
          */
         BOOT_LOG_DBG("Erasing faulty image in the %s slot.",
                      (active_slot == BOOT_PRIMARY_SLOT) ? "primary" : "secondary");
+#ifdef MCUBOOT_DIRECT_XIP_REVERT_FAST
+        rc = boot_invalidate_slot(fap);
+#else
         rc = flash_area_erase(fap, 0, flash_area_get_size(fap));
+#endif
         assert(rc == 0);
 
-        flash_area_close(fap);
         rc = -1;
     } else {
         if (active_swap_state->copy_done != BOOT_FLAG_SET) {
@@ -2700,13 +5120,110 @@ boot_select_or_erase(struct boot_loader_state *state)
                 rc = 0;
             }
         }
-        flash_area_close(fap);
     }
 
     return rc;
 }
 #endif /* MCUBOOT_DIRECT_XIP && MCUBOOT_DIRECT_XIP_REVERT */
 
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+/**
+ * Hashes the slot selected by boot_parallel_hash_start() for every image but
+ * the first. This runs on a secondary core, so it only reads the headers and
+ * flash areas of these images and uses its own buffer.
+ *
+ * @param  arg          Boot loader status information.
+ */
+static void
+boot_parallel_hash_job(void *arg)
+{
+    struct boot_loader_state *state = arg;
+    struct slot_usage_t *usage;
+    uint32_t image_index;
+    uint32_t slot;
+    int rc;
+    BOOT_WORK_BUF(tmpbuf);
+
+    for (image_index = 1; image_index < BOOT_IMAGE_NUMBER; image_index++) {
+        usage = &state->slot_usage[image_index];
+        slot = usage->img_hash_slot;
+        if (slot == NO_ACTIVE_SLOT) {
+            continue;
+        }
+
+        rc = bootutil_img_hash(NULL, image_index,
+                               &state->imgs[image_index][slot].hdr,
+                               state->imgs[image_index][slot].area,
+                               tmpbuf, BOOT_WORK_BUF_SZ, usage->img_hash,
+                               NULL, 0);
+        usage->img_hash_valid = (rc == 0);
+    }
+}
+
+/**
+ * Selects the slot most likely to be booted for every image but the first,
+ * and starts hashing these slots on a secondary core while the first image
+ * is validated.
+ *
+ * @param  state        Boot loader status information.
+ *
+ * @return              true if the hashing was started; false otherwise.
+ */
+static bool
+boot_parallel_hash_start(struct boot_loader_state *state)
+{
+    struct slot_usage_t *usage;
+    bool any = false;
+
+    IMAGES_ITER(BOOT_CURR_IMG(state)) {
+        usage = &state->slot_usage[BOOT_CURR_IMG(state)];
+        usage->img_hash_slot = NO_ACTIVE_SLOT;
+        usage->img_hash_valid = false;
+
+        if (BOOT_CURR_IMG(state) == 0 || state->img_mask[BOOT_CURR_IMG(state)] ||
+            usage->active_slot != NO_ACTIVE_SLOT) {
+            continue;
+        }
+#ifdef MCUBOOT_BOOT_INDEX
+        if (usage->hdr_from_index) {
+            /* Only the version of the headers is known yet. */
+            continue;
+        }
+#endif
+
+        usage->img_hash_slot = find_slot_with_highest_version(state);
+        any |= (usage->img_hash_slot != NO_ACTIVE_SLOT);
+    }
+
+    if (any && boot_parallel_start(boot_parallel_hash_job, state) == 0) {
+        return true;
+    }
+
+    /* The images are hashed when they are validated. */
+    IMAGES_ITER(BOOT_CURR_IMG(state)) {
+        state->slot_usage[BOOT_CURR_IMG(state)].img_hash_slot = NO_ACTIVE_SLOT;
+    }
+
+    return false;
+}
+
+/**
+ * Waits for the hashing started by boot_parallel_hash_start() to complete.
+ *
+ * @param  state        Boot loader status information.
+ */
+static void
+boot_parallel_hash_join(struct boot_loader_state *state)
+{
+    if (boot_parallel_join() != 0) {
+        BOOT_LOG_WRN("Hashing on the secondary core failed");
+        IMAGES_ITER(BOOT_CURR_IMG(state)) {
+            state->slot_usage[BOOT_CURR_IMG(state)].img_hash_valid = false;
+        }
+    }
+}
+#endif /* MCUBOOT_PARALLEL_VALIDATION */
+
 /**
  * Tries to load a slot for all the images with validation.
  *
@@ -2720,9 +5237,42 @@ boot_load_and_validate_images(struct boot_loader_state *state)
     uint32_t active_slot;
     int rc;
     fih_ret fih_rc;
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+    bool hashing;
+
+    hashing = boot_parallel_hash_start(state);
+#endif
+
+#ifdef MCUBOOT_RAM_LOAD_PARALLEL
+    /* Copy the slot each image would be loaded from first to RAM, for all the
+     * images at once. The images whose slot turns out to be invalid are then
+     * loaded again one at a time.
+     */
+    IMAGES_ITER(BOOT_CURR_IMG(state)) {
+        struct slot_usage_t *usage = &state->slot_usage[BOOT_CURR_IMG(state)];
+
+        usage->preload_slot = NO_ACTIVE_SLOT;
+        if (state->img_mask[BOOT_CURR_IMG(state)] ||
+#ifdef MCUBOOT_BOOT_INDEX
+            usage->hdr_from_index ||
+#endif
+            usage->active_slot != NO_ACTIVE_SLOT) {
+            continue;
+        }
+        usage->preload_slot = find_slot_with_highest_version(state);
+    }
+    boot_preload_images_to_sram(state);
+#endif
 
     /* Go over all the images and try to load one */
     IMAGES_ITER(BOOT_CURR_IMG(state)) {
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+        if (hashing && BOOT_CURR_IMG(state) != 0) {
+            /* The other images are hashed while the first one is validated. */
+            boot_parallel_hash_join(state);
+            hashing = false;
+        }
+#endif
         /* All slots tried until a valid image found. Breaking from this loop
          * means that a valid image found or already loaded. If no slot is
          * found the function returns with error code. */
@@ -2738,6 +5288,11 @@ boot_load_and_validate_images(struct boot_loader_state *state)
             if (active_slot == NO_ACTIVE_SLOT) {
                 BOOT_LOG_INF("No slot to load for image %d",
                              BOOT_CURR_IMG(state));
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+                if (hashing) {
+                    boot_parallel_hash_join(state);
+                }
+#endif
                 FIH_RET(FIH_FAILURE);
             }
 
@@ -2750,6 +5305,15 @@ boot_load_and_validate_images(struct boot_loader_state *state)
         }
 #endif
 
+#ifdef MCUBOOT_BOOT_INDEX
+            if (state->slot_usage[BOOT_CURR_IMG(state)].hdr_from_index &&
+                boot_read_indexed_header(state, active_slot) != 0) {
+                /* The slot usage of the image was read again. */
+                state->slot_usage[BOOT_CURR_IMG(state)].active_slot = NO_ACTIVE_SLOT;
+                continue;
+            }
+#endif
+
 #ifdef MCUBOOT_DIRECT_XIP
             rc = boot_rom_address_check(state);
             if (rc != 0) {
@@ -2786,6 +5350,13 @@ boot_load_and_validate_images(struct boot_loader_state *state)
             }
 #endif /* MCUBOOT_RAM_LOAD */
 
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+            if (state->slot_usage[BOOT_CURR_IMG(state)].img_hash_slot != active_slot) {
+                /* Another slot was hashed, it can not be used. */
+                state->slot_usage[BOOT_CURR_IMG(state)].img_hash_valid = false;
+            }
+#endif
+
             FIH_CALL(boot_validate_slot, fih_rc, state, active_slot, NULL);
             if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
                 /* Image is invalid. */
@@ -2829,7 +5400,7 @@ boot_update_hw_rollback_protection(struct boot_loader_state *state)
      */
     if (state->slot_usage[BOOT_CURR_IMG(state)].swap_state.image_ok == BOOT_FLAG_SET) {
 #endif
-        rc = boot_update_security_counter(BOOT_CURR_IMG(state),
+        rc = boot_update_security_counter(state,
                                           state->slot_usage[BOOT_CURR_IMG(state)].active_slot,
                                           boot_img_hdr(state, state->slot_usage[BOOT_CURR_IMG(state)].active_slot));
         if (rc != 0) {
@@ -2848,6 +5419,46 @@ boot_update_hw_rollback_protection(struct boot_loader_state *state)
 #endif
 }
 
+#ifdef MCUBOOT_ENC_XIP
+/**
+ * Programs the decryption engine with the key of the active image, if it is
+ * encrypted, so that it is decrypted as it is executed from its slot.
+ *
+ * @param  state        Boot loader status information.
+ *
+ * @return              0 on success; nonzero on failure.
+ */
+static int
+boot_enc_xip_start(struct boot_loader_state *state)
+{
+    uint32_t active_slot = state->slot_usage[BOOT_CURR_IMG(state)].active_slot;
+    struct image_header *hdr = boot_img_hdr(state, active_slot);
+
+    if (!IS_ENCRYPTED(hdr)) {
+        return 0;
+    }
+
+    return boot_enc_xip_configure(BOOT_CURR_IMG(state),
+                                  BOOT_IMG_AREA(state, active_slot), hdr,
+                                  state->slot_usage[BOOT_CURR_IMG(state)].enc_key[active_slot]);
+}
+
+/**
+ * Clears the image keys; they are only left in the decryption engine.
+ *
+ * @param  state        Boot loader status information.
+ */
+static void
+boot_enc_xip_clear_keys(struct boot_loader_state *state)
+{
+    IMAGES_ITER(BOOT_CURR_IMG(state)) {
+        boot_enc_zeroize(BOOT_CURR_ENC(state));
+        memset(state->slot_usage[BOOT_CURR_IMG(state)].enc_key, 0,
+               sizeof(state->slot_usage[BOOT_CURR_IMG(state)].enc_key));
+    }
+}
+#endif /* MCUBOOT_ENC_XIP */
+
 fih_ret
 context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
 {
@@ -2894,6 +5505,16 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
             goto out;
         }
 
+#ifdef MCUBOOT_ENC_XIP
+        rc = boot_enc_xip_start(state);
+        if (rc != 0) {
+            BOOT_LOG_ERR("Decryption engine setup failed for image %d.",
+                         BOOT_CURR_IMG(state));
+            FIH_SET(fih_rc, FIH_FAILURE);
+            goto out;
+        }
+#endif
+
         rc = boot_add_shared_data(state, (uint8_t)state->slot_usage[BOOT_CURR_IMG(state)].active_slot);
         if (rc != 0) {
             FIH_SET(fih_rc, FIH_FAILURE);
@@ -2901,6 +5522,16 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
         }
     }
 
+#ifdef MCUBOOT_HW_ROLLBACK_PROT_CACHE
+    /* The security counter updates of all images are written together. */
+    rc = boot_security_counter_commit();
+    if (rc != 0) {
+        BOOT_LOG_ERR("Security counter update failed.");
+        FIH_SET(fih_rc, FIH_FAILURE);
+        goto out;
+    }
+#endif
+
     /* All image loaded successfully. */
 #ifdef MCUBOOT_HAVE_LOGGING
     print_loaded_images(state);
@@ -2909,6 +5540,9 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
     fill_rsp(state, rsp);
 
 out:
+#ifdef MCUBOOT_ENC_XIP
+    boot_enc_xip_clear_keys(state);
+#endif
     close_all_flash_areas(state);
 
     if (rc != 0) {
@@ -2934,7 +5568,12 @@ boot_go(struct boot_rsp *rsp)
 
     boot_state_clear(NULL);
 
+    boot_perf_raise();
+    boot_profile_paint_arenas();
+    boot_phase_start(BOOT_PHASE_TOTAL);
     FIH_CALL(context_boot_go, fih_rc, &boot_data, rsp);
+    boot_phase_stop(BOOT_PHASE_TOTAL);
+    boot_perf_restore();
     FIH_RET(fih_rc);
 }
 
@@ -2943,6 +5582,10 @@ boot_go(struct boot_rsp *rsp)
  * moves images around in flash as appropriate, and tells you what address to
  * boot from.
  *
+ * With MCUBOOT_LAZY_VALIDATION, the other images are still upgraded, but the
+ * validation of their primary slots is deferred to
+ * boot_validate_deferred_image().
+ *
  * @param rsp                   On success, indicates how booting should occur.
  *
  * @param image_id              The image ID to prepare the boot process for.
@@ -2958,14 +5601,101 @@ boot_go_for_image_id(struct boot_rsp *rsp, uint32_t image_id)
         FIH_RET(FIH_FAILURE);
     }
 
-#if BOOT_IMAGE_NUMBER > 1
+#if defined(MCUBOOT_LAZY_VALIDATION)
+    memset(&boot_data.img_mask, 0, BOOT_IMAGE_NUMBER);
+    memset(&boot_data.img_deferred, 1, BOOT_IMAGE_NUMBER);
+    boot_data.img_deferred[image_id] = 0;
+#elif BOOT_IMAGE_NUMBER > 1
     memset(&boot_data.img_mask, 1, BOOT_IMAGE_NUMBER);
     boot_data.img_mask[image_id] = 0;
 #endif
 
+    boot_perf_raise();
+    boot_profile_paint_arenas();
+    boot_phase_start(BOOT_PHASE_TOTAL);
     FIH_CALL(context_boot_go, fih_rc, &boot_data, rsp);
+    boot_phase_stop(BOOT_PHASE_TOTAL);
+    boot_perf_restore();
+    FIH_RET(fih_rc);
+}
+
+#ifdef MCUBOOT_LAZY_VALIDATION
+/**
+ * Validates the primary slot of an image whose validation was deferred by
+ * boot_go_for_image_id(), and updates its security counter. To be called
+ * before the core running the image is started, with the state left by
+ * boot_go_for_image_id().
+ *
+ * @param image_id              The image ID to validate.
+ *
+ * @return                      FIH_SUCCESS on success; nonzero on failure.
+ */
+fih_ret
+boot_validate_deferred_image(uint32_t image_id)
+{
+    struct boot_loader_state *state = &boot_data;
+    size_t slot;
+    int fa_id;
+    int rc;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    if (image_id >= BOOT_IMAGE_NUMBER || !state->img_deferred[image_id]) {
+        FIH_RET(FIH_FAILURE);
+    }
+
+    BOOT_CURR_IMG(state) = image_id;
+
+    for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
+        fa_id = flash_area_id_from_multi_image_slot(image_id, slot);
+        rc = flash_area_open(fa_id, &BOOT_IMG_AREA(state, slot));
+        if (rc != 0) {
+            BOOT_LOG_ERR("Failed to open flash area ID %d (image %d slot %d): %d",
+                         fa_id, image_id, (int8_t)slot, rc);
+            while (slot-- > 0) {
+                flash_area_close(BOOT_IMG_AREA(state, slot));
+            }
+            FIH_RET(FIH_FAILURE);
+        }
+    }
+
+    /* The image may have been moved by an upgrade since its headers were
+     * read.
+     */
+    rc = boot_read_image_headers(state, false, NULL);
+    if (rc != 0) {
+        goto out;
+    }
+
+    FIH_CALL(boot_validate_slot, fih_rc, state, BOOT_PRIMARY_SLOT, NULL);
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        FIH_SET(fih_rc, FIH_FAILURE);
+        goto out;
+    }
+
+    rc = boot_update_hw_rollback_protection(state);
+#ifdef MCUBOOT_HW_ROLLBACK_PROT_CACHE
+    if (rc == 0) {
+        rc = boot_security_counter_commit();
+    }
+#endif
+    if (rc != 0) {
+        FIH_SET(fih_rc, FIH_FAILURE);
+        goto out;
+    }
+
+    state->img_deferred[image_id] = false;
+
+out:
+    if (rc != 0) {
+        FIH_SET(fih_rc, FIH_FAILURE);
+    }
+    for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
+        flash_area_close(BOOT_IMG_AREA(state, BOOT_NUM_SLOTS - 1 - slot));
+    }
+
     FIH_RET(fih_rc);
 }
+#endif /* MCUBOOT_LAZY_VALIDATION */
 
 /**
  * Clears the boot state, so that previous operations have no effect on new
@@ -2977,6 +5707,14 @@ boot_go_for_image_id(struct boot_rsp *rsp, uint32_t image_id)
  */
 void boot_state_clear(struct boot_loader_state *state)
 {
+#ifdef MCUBOOT_TLV_INDEX
+    /* The slots may have been written since the indexes were built. */
+    bootutil_tlv_index_invalidate(NULL);
+#endif
+#ifdef MCUBOOT_HW_ROLLBACK_PROT_CACHE
+    boot_security_counter_reset();
+#endif
+
     if (state != NULL) {
         memset(state, 0, sizeof(struct boot_loader_state));
     } else {
@@ -3002,12 +5740,14 @@ static void boot_fetch_slot_state_sizes(void)
 
         image_index = BOOT_CURR_IMG(&boot_data);
 
+#ifndef MCUBOOT_SECTOR_RUNS
         BOOT_IMG(&boot_data, BOOT_PRIMARY_SLOT).sectors =
             sector_buffers.primary[image_index];
         BOOT_IMG(&boot_data, BOOT_SECONDARY_SLOT).sectors =
             sector_buffers.secondary[image_index];
 #if MCUBOOT_SWAP_USING_SCRATCH
         boot_data.scratch.sectors = sector_buffers.scratch;
+#endif
 #endif
 
         /* Open primary and secondary image areas for the duration
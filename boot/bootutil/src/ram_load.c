@@ -39,6 +39,10 @@
 #include "bootutil/enc_key.h"
 #endif
 
+#ifdef MCUBOOT_RAM_LOAD_RESIDENT
+#include "bootutil/ram_resident.h"
+#endif
+
 #include "mcuboot_config/mcuboot_config.h"
 
 BOOT_LOG_MODULE_DECLARE(mcuboot);
@@ -119,37 +123,31 @@ boot_decrypt_and_copy_image_to_sram(struct boot_loader_state *state,
                                     uint32_t src_sz, uint32_t img_dst)
 {
     /* The flow for the decryption and copy of the image is as follows :
-     * 1. The whole image is copied to the RAM (header + payload + TLV).
-     * 2. The encryption key is loaded from the TLV in flash.
-     * 3. The image is then decrypted chunk by chunk in RAM (1 chunk
-     * is 1024 bytes). Only the payload section is decrypted.
+     * 1. The encryption key is loaded from the TLV in flash.
+     * 2. The whole image is copied to the RAM (header + payload + TLV).
+     * 3. The payload section is decrypted in place, in a single pass: the
+     * keystream is generated MCUBOOT_ENC_KEYSTREAM_BLOCKS blocks at a time
+     * from one counter, so the time taken is bound by the flash read.
      * 4. The image is authenticated in RAM.
+     *
+     * With AES-GCM, the tag is computed over the payload before it is
+     * decrypted and checked once it has been decrypted.
      */
     const struct flash_area *fap_src = NULL;
     struct boot_status bs;
-    uint32_t blk_off;
+#ifdef MCUBOOT_ENC_GCM
+    struct boot_enc_gcm gcm;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+#endif
     uint32_t tlv_off;
-    uint32_t blk_sz;
-    uint32_t bytes_copied = hdr->ih_hdr_size;
-    uint32_t chunk_sz;
-    uint32_t max_sz = 1024;
-    uint16_t idx;
-    uint8_t * cur_dst;
-    int area_id;
+    uint8_t *payload;
     int rc;
     uint8_t * ram_dst = (void *)(IMAGE_RAM_BASE + img_dst);
 
-    area_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), slot);
-    rc = flash_area_open(area_id, &fap_src);
-    if (rc != 0){
-        return BOOT_EFLASH;
-    }
-
+    fap_src = BOOT_IMG_AREA(state, slot);
     tlv_off = BOOT_TLV_OFF(hdr);
-
-    /* Copying the whole image in RAM */
-    rc = flash_area_read(fap_src, 0, ram_dst, src_sz);
-    if (rc != 0) {
+    if (tlv_off > src_sz) {
+        rc = BOOT_EBADIMAGE;
         goto done;
     }
 
@@ -160,40 +158,205 @@ boot_decrypt_and_copy_image_to_sram(struct boot_loader_state *state,
 
     /* if rc > 0 then the key has already been loaded */
     if (rc == 0 && boot_enc_set_key(BOOT_CURR_ENC(state), slot, &bs)) {
+        rc = -1;
         goto done;
     }
 
-    /* Starting at the end of the header as the header section is not encrypted */
-    while (bytes_copied < tlv_off) { /* TLV section copied previously */
-        if (src_sz - bytes_copied > max_sz) {
-            chunk_sz = max_sz;
-        } else {
-            chunk_sz = src_sz - bytes_copied;
-        }
+    /* Copying the whole image in RAM */
+    rc = flash_area_read(fap_src, 0, ram_dst, src_sz);
+    if (rc != 0) {
+        goto done;
+    }
 
-        cur_dst = ram_dst + bytes_copied;
-        blk_sz = chunk_sz;
-        idx = 0;
-        blk_off = ((bytes_copied) - hdr->ih_hdr_size) & 0xf;
-        if (bytes_copied + chunk_sz > tlv_off) {
-            /* Going over TLV section
-             * Part of the chunk is encrypted payload */
-            blk_sz = tlv_off - (bytes_copied);
-        }
-        boot_enc_decrypt(BOOT_CURR_ENC(state), slot,
-                (bytes_copied + idx) - hdr->ih_hdr_size, blk_sz,
-                blk_off, cur_dst);
-        bytes_copied += chunk_sz;
+#ifdef MCUBOOT_ENC_GCM
+    rc = boot_enc_gcm_start(BOOT_CURR_ENC(state), slot, &gcm);
+    if (rc != 0) {
+        goto done;
     }
+#endif
+
+    /* The header section is not encrypted, nor is the TLV section */
+    payload = ram_dst + hdr->ih_hdr_size;
+#ifdef MCUBOOT_ENC_GCM
+    boot_enc_gcm_update(&gcm, payload, hdr->ih_img_size);
+#endif
+    boot_enc_decrypt(BOOT_CURR_ENC(state), slot, 0, hdr->ih_img_size, 0,
+                     payload);
     rc = 0;
 
-done:
-    flash_area_close(fap_src);
+#ifdef MCUBOOT_ENC_GCM
+    FIH_CALL(boot_enc_gcm_verify, fih_rc, &gcm, hdr, fap_src);
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        rc = BOOT_EBADIMAGE;
+    }
+#endif
 
+done:
     return rc;
 }
 
 #endif /* MCUBOOT_ENC_IMAGES */
+#ifdef MCUBOOT_RAM_LOAD_HASH_COPY
+#ifndef MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE
+#define MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE 0x1000
+#endif
+
+static inline int
+boot_ram_load_read_start(const struct flash_area *fap, uint32_t off,
+                         void *dst, uint32_t len)
+{
+#ifdef MCUBOOT_FLASH_AREA_READ_ASYNC
+    return flash_area_read_async(fap, off, dst, len);
+#else
+    return flash_area_read(fap, off, dst, len);
+#endif
+}
+
+static inline int
+boot_ram_load_read_wait(const struct flash_area *fap)
+{
+#ifdef MCUBOOT_FLASH_AREA_READ_ASYNC
+    return flash_area_read_wait(fap);
+#else
+    (void)fap;
+    return 0;
+#endif
+}
+
+/**
+ * Copies an image from flash to SRAM chunk by chunk, hashing each chunk once
+ * it is in SRAM while the read of the next one is in progress. The hash
+ * covers the header, the payload and the protected TLVs, as the one
+ * bootutil_img_hash() computes over the SRAM copy.
+ *
+ * @param  fap      The flash area of the image.
+ * @param  hdr      The image header.
+ * @param  dst      The SRAM address the image is copied to.
+ * @param  img_sz   The size of the image, TLVs included.
+ * @param  hash     Where the hash is written.
+ *
+ * @return          0 on success; nonzero on failure.
+ */
+static int
+boot_copy_and_hash_image_to_sram(const struct flash_area *fap,
+                                 const struct image_header *hdr, uint8_t *dst,
+                                 uint32_t img_sz, uint8_t *hash)
+{
+    bootutil_sha_context sha_ctx;
+    uint32_t hash_sz;
+    uint32_t chunk_sz;
+    uint32_t next_sz;
+    uint32_t off;
+    int rc;
+
+    hash_sz = (uint32_t)hdr->ih_hdr_size + hdr->ih_img_size +
+              hdr->ih_protect_tlv_size;
+    if (hash_sz > img_sz) {
+        return BOOT_EBADIMAGE;
+    }
+
+    bootutil_sha_init(&sha_ctx);
+
+    off = 0;
+    chunk_sz = img_sz;
+    if (chunk_sz > MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE) {
+        chunk_sz = MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE;
+    }
+    rc = boot_ram_load_read_start(fap, 0, dst, chunk_sz);
+    while (rc == 0 && off < img_sz) {
+        rc = boot_ram_load_read_wait(fap);
+        if (rc != 0) {
+            break;
+        }
+
+        next_sz = img_sz - (off + chunk_sz);
+        if (next_sz > MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE) {
+            next_sz = MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE;
+        }
+        if (next_sz > 0) {
+            rc = boot_ram_load_read_start(fap, off + chunk_sz,
+                                          dst + off + chunk_sz, next_sz);
+            if (rc != 0) {
+                break;
+            }
+        }
+
+        if (off < hash_sz) {
+            bootutil_sha_update(&sha_ctx, dst + off,
+                                (hash_sz - off < chunk_sz) ?
+                                hash_sz - off : chunk_sz);
+        }
+        boot_watchdog_feed(chunk_sz);
+
+        off += chunk_sz;
+        chunk_sz = next_sz;
+    }
+
+    if (rc == 0) {
+        bootutil_sha_finish(&sha_ctx, hash);
+    }
+    bootutil_sha_drop(&sha_ctx);
+
+    return rc;
+}
+#endif /* MCUBOOT_RAM_LOAD_HASH_COPY */
+
+#ifdef MCUBOOT_RAM_LOAD_STAGED
+/**
+ * Copies the header, the TLVs and the first stage of the payload of a
+ * chunked image from flash to SRAM. The rest of the payload is left to the
+ * application, see boot_ram_load_finish(); for images without an
+ * IMAGE_TLV_RAM_LOAD_STAGE TLV, the first stage is the whole payload.
+ *
+ * @param  fap      The flash area of the image.
+ * @param  hdr      The image header.
+ * @param  dst      The SRAM address the image is copied to.
+ * @param  img_sz   The size of the image, TLVs included.
+ *
+ * @return          0 on success; nonzero on failure.
+ */
+static int
+boot_copy_image_stage_to_sram(const struct flash_area *fap,
+                              const struct image_header *hdr, uint8_t *dst,
+                              uint32_t img_sz)
+{
+    uint32_t tlv_off;
+    uint32_t stage_end;
+    int rc;
+
+    tlv_off = BOOT_TLV_OFF(hdr);
+    if (tlv_off > img_sz || hdr->ih_protect_tlv_size > img_sz - tlv_off) {
+        return BOOT_EBADIMAGE;
+    }
+
+    /* The TLVs are needed first, to find where the first stage ends. */
+    rc = flash_area_read(fap, 0, dst, hdr->ih_hdr_size);
+    if (rc == 0) {
+        rc = flash_area_read(fap, tlv_off, dst + tlv_off, img_sz - tlv_off);
+    }
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    rc = boot_ram_load_stage_end(dst, &stage_end);
+    if (rc != 0) {
+        return rc;
+    }
+    if (stage_end < hdr->ih_img_size) {
+        BOOT_LOG_INF("Loading the first 0x%lx bytes of the image payload",
+                     (unsigned long)stage_end);
+    }
+
+    rc = flash_area_read(fap, hdr->ih_hdr_size, dst + hdr->ih_hdr_size,
+                         stage_end);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    return 0;
+}
+#endif /* MCUBOOT_RAM_LOAD_STAGED */
+
 /**
  * Copies a slot of the current image into SRAM.
  *
@@ -210,31 +373,189 @@ boot_copy_image_to_sram(struct boot_loader_state *state, int slot,
                         uint32_t img_dst, uint32_t img_sz)
 {
     int rc;
-    const struct flash_area *fap_src = NULL;
-    int area_id;
+    const struct flash_area *fap_src;
 
-#if (BOOT_IMAGE_NUMBER == 1)
-    (void)state;
+    fap_src = BOOT_IMG_AREA(state, slot);
+
+#ifdef MCUBOOT_RAM_LOAD_STAGED
+    if (boot_img_hdr(state, slot)->ih_flags & IMAGE_F_HASH_CHUNKED) {
+        rc = boot_copy_image_stage_to_sram(fap_src, boot_img_hdr(state, slot),
+                (uint8_t *)(IMAGE_RAM_BASE + img_dst), img_sz);
+    } else
+#endif
+#ifdef MCUBOOT_RAM_LOAD_HASH_COPY
+    /* Hashing the image as it is copied, unless it needs a chunk table. */
+    if (!(boot_img_hdr(state, slot)->ih_flags & IMAGE_F_HASH_CHUNKED)) {
+        rc = boot_copy_and_hash_image_to_sram(fap_src,
+                boot_img_hdr(state, slot), (void *)(IMAGE_RAM_BASE + img_dst),
+                img_sz, state->slot_usage[BOOT_CURR_IMG(state)].img_hash);
+        state->slot_usage[BOOT_CURR_IMG(state)].img_hash_valid = (rc == 0);
+    } else
 #endif
+    {
+        /* Direct copy from flash to its new location in SRAM. */
+        rc = flash_area_read(fap_src, 0, (void *)(IMAGE_RAM_BASE + img_dst),
+                             img_sz);
+    }
+    if (rc != 0) {
+        BOOT_LOG_INF("Error whilst copying image %d from Flash to SRAM: %d",
+                     BOOT_CURR_IMG(state), rc);
+    }
 
-    area_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), slot);
+    return rc;
+}
 
-    rc = flash_area_open(area_id, &fap_src);
+#ifdef MCUBOOT_RAM_LOAD_RESIDENT
+/*
+ * Reads the value of the image hash TLV from the copy of the current image
+ * in SRAM.
+ */
+static int
+boot_ram_resident_hash_tlv(const struct image_header *hdr,
+                           const struct flash_area *fap, uint8_t *hash)
+{
+    struct image_tlv_iter it;
+    uint32_t off;
+    uint16_t len;
+    int rc;
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, EXPECTED_HASH_TLV, false);
     if (rc != 0) {
-        return BOOT_EFLASH;
+        return rc;
     }
 
-    /* Direct copy from flash to its new location in SRAM. */
-    rc = flash_area_read(fap_src, 0, (void *)(IMAGE_RAM_BASE + img_dst), img_sz);
-    if (rc != 0) {
-        BOOT_LOG_INF("Error whilst copying image %d from Flash to SRAM: %d",
-                     BOOT_CURR_IMG(state), rc);
+    rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+    if (rc != 0 || len != IMAGE_HASH_SIZE) {
+        return -1;
     }
 
-    flash_area_close(fap_src);
+    return LOAD_IMAGE_DATA(hdr, fap, off, hash, len);
+}
 
-    return rc;
+/**
+ * Checks whether the copy of a slot of the current image left in SRAM by a
+ * previous boot can be used as it is: the record of the platform must match
+ * the slot and load region, the header and TLVs in SRAM must be those of the
+ * slot, and the copy in SRAM must hash to the hash TLV that was validated
+ * when the record was written.
+ *
+ * @param  state    Boot loader status information.
+ * @param  slot     The flash slot of the image.
+ * @param  img_dst  The address the image is loaded at.
+ * @param  img_sz   The size of the image, TLVs included.
+ *
+ * @return          FIH_SUCCESS if the copy in SRAM can be used; FIH_FAILURE
+ *                  otherwise.
+ */
+static fih_ret
+boot_ram_resident_check(struct boot_loader_state *state, int slot,
+                        uint32_t img_dst, uint32_t img_sz)
+{
+    struct boot_ram_resident_record rec;
+    const struct flash_area *fap;
+    const struct image_header *hdr;
+    bootutil_sha_context sha_ctx;
+    uint8_t hash[IMAGE_HASH_SIZE];
+    uint8_t buf[64];
+    const uint8_t *ram;
+    uint32_t hash_sz;
+    uint32_t tlv_off;
+    uint32_t off;
+    uint32_t len;
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    fap = BOOT_IMG_AREA(state, slot);
+    hdr = boot_img_hdr(state, slot);
+    ram = (const uint8_t *)(IMAGE_RAM_BASE + img_dst);
+
+    /* Encrypted images are decrypted as they are copied, and chunked ones
+     * are hashed per chunk: both are always copied again.
+     */
+    if (IS_ENCRYPTED(hdr) || (hdr->ih_flags & IMAGE_F_HASH_CHUNKED)) {
+        FIH_RET(FIH_FAILURE);
+    }
+
+    if (boot_ram_resident_read(BOOT_CURR_IMG(state), &rec) != 0 ||
+        rec.magic != BOOT_RAM_RESIDENT_MAGIC || rec.slot != (uint32_t)slot ||
+        rec.img_dst != img_dst || rec.img_sz != img_sz) {
+        FIH_RET(FIH_FAILURE);
+    }
+
+    hash_sz = (uint32_t)hdr->ih_hdr_size + hdr->ih_img_size +
+              hdr->ih_protect_tlv_size;
+    tlv_off = BOOT_TLV_OFF(hdr);
+    if (img_sz < sizeof(*hdr) || hash_sz > img_sz || tlv_off > img_sz) {
+        FIH_RET(FIH_FAILURE);
+    }
+
+    /* The header and TLVs in SRAM must be those of the slot. */
+    if (memcmp(ram, hdr, sizeof(*hdr)) != 0) {
+        FIH_RET(FIH_FAILURE);
+    }
+    for (off = tlv_off; off < img_sz; off += len) {
+        len = (img_sz - off < sizeof(buf)) ? img_sz - off : sizeof(buf);
+        if (flash_area_read(fap, off, buf, len) != 0 ||
+            memcmp(ram + off, buf, len) != 0) {
+            FIH_RET(FIH_FAILURE);
+        }
+    }
+
+    if (boot_ram_resident_hash_tlv(hdr, fap, hash) != 0) {
+        FIH_RET(FIH_FAILURE);
+    }
+    FIH_CALL(boot_fih_memequal, fih_rc, hash, rec.img_hash, IMAGE_HASH_SIZE);
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        FIH_RET(FIH_FAILURE);
+    }
+
+    /* The copy in SRAM must still hash to it. */
+    bootutil_sha_init(&sha_ctx);
+    for (off = 0; off < hash_sz; off += len) {
+        len = (hash_sz - off < 1024) ? hash_sz - off : 1024;
+        bootutil_sha_update(&sha_ctx, ram + off, len);
+        boot_watchdog_feed(len);
+    }
+    bootutil_sha_finish(&sha_ctx, hash);
+    bootutil_sha_drop(&sha_ctx);
+
+    FIH_CALL(boot_fih_memequal, fih_rc, hash, rec.img_hash, IMAGE_HASH_SIZE);
+
+    FIH_RET(fih_rc);
+}
+
+/**
+ * Records that the active slot of the current image, just validated in
+ * SRAM, can be used as it is by the next boot.
+ *
+ * @param  state    Boot loader status information.
+ * @param  slot     The flash slot of the image.
+ */
+void
+boot_ram_resident_note(struct boot_loader_state *state, int slot)
+{
+    struct boot_ram_resident_record rec;
+    const struct image_header *hdr;
+
+    hdr = boot_img_hdr(state, slot);
+    if (IS_ENCRYPTED(hdr) || (hdr->ih_flags & IMAGE_F_HASH_CHUNKED) ||
+        state->slot_usage[BOOT_CURR_IMG(state)].img_sz == 0) {
+        return;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = BOOT_RAM_RESIDENT_MAGIC;
+    rec.slot = (uint32_t)slot;
+    rec.img_dst = state->slot_usage[BOOT_CURR_IMG(state)].img_dst;
+    rec.img_sz = state->slot_usage[BOOT_CURR_IMG(state)].img_sz;
+
+    if (boot_ram_resident_hash_tlv(hdr, BOOT_IMG_AREA(state, slot),
+                                   rec.img_hash) != 0 ||
+        boot_ram_resident_write(BOOT_CURR_IMG(state), &rec) != 0) {
+        BOOT_LOG_WRN("Image %d: failed to record the copy in RAM",
+                     BOOT_CURR_IMG(state));
+    }
 }
+#endif /* MCUBOOT_RAM_LOAD_RESIDENT */
 
 #if (BOOT_IMAGE_NUMBER > 1)
 /**
@@ -280,7 +601,41 @@ boot_check_ram_load_overlapping(struct boot_loader_state *state)
     uint32_t start_b;
     uint32_t end_b;
     uint32_t image_id_to_check = BOOT_CURR_IMG(state);
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+    const struct image_ram_load_segment *segs_a;
+    const struct image_ram_load_segment *segs_b;
+    uint32_t seg_a;
+    uint32_t seg_b;
+
+    segs_a = state->slot_usage[image_id_to_check].segs;
+
+    for (i = 0; i < BOOT_IMAGE_NUMBER; i++) {
+        if (state->slot_usage[i].active_slot == NO_ACTIVE_SLOT
+            || i == image_id_to_check) {
+            continue;
+        }
+
+        segs_b = state->slot_usage[i].segs;
+        for (seg_a = 0; seg_a < state->slot_usage[image_id_to_check].seg_cnt;
+             seg_a++) {
+            /* Safe to add here, values are already verified when the
+             * segments are set. */
+            start_a = segs_a[seg_a].load_addr;
+            end_a = start_a + segs_a[seg_a].size;
 
+            for (seg_b = 0; seg_b < state->slot_usage[i].seg_cnt; seg_b++) {
+                start_b = segs_b[seg_b].load_addr;
+                end_b = start_b + segs_b[seg_b].size;
+
+                if (do_regions_overlap(start_a, end_a, start_b, end_b)) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+#else
     start_a = state->slot_usage[image_id_to_check].img_dst;
     /* Safe to add here, values are already verified in
      * boot_verify_ram_load_address() */
@@ -303,9 +658,459 @@ boot_check_ram_load_overlapping(struct boot_loader_state *state)
     }
 
     return 0;
+#endif /* MCUBOOT_RAM_LOAD_SEGMENTS */
 }
 #endif
 
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+/**
+ * Reads the IMAGE_TLV_RAM_LOAD_SEGMENTS table of a scatter-loaded image into
+ * the boot loader state, and checks that each segment fits in one of the RAM
+ * regions of the image without overlapping the other segments, and that the
+ * segments make up the whole payload.
+ *
+ * @param  state    Boot loader status information.
+ * @param  fap      The flash area of the image.
+ * @param  hdr      The image header.
+ *
+ * @return          0 on success; nonzero on failure.
+ */
+static int
+boot_read_ram_load_segments(struct boot_loader_state *state,
+                            const struct flash_area *fap,
+                            const struct image_header *hdr)
+{
+    struct image_ram_load_segment *segs;
+    struct image_tlv_iter it;
+    uint32_t reg_start;
+    uint32_t reg_size;
+    uint32_t reg_end;
+    uint32_t seg_end;
+    uint32_t seg_cnt;
+    uint32_t total;
+    uint32_t region;
+    uint32_t off;
+    uint32_t i;
+    uint32_t j;
+    uint16_t len;
+    int rc;
+
+    segs = state->slot_usage[BOOT_CURR_IMG(state)].segs;
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_RAM_LOAD_SEGMENTS,
+                                 true);
+    if (rc != 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+    if (rc != 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    if (len == 0 || len % sizeof(*segs) != 0 ||
+        len > sizeof(state->slot_usage[0].segs)) {
+        BOOT_LOG_ERR("Image %d: invalid or too many RAM load segments",
+                     BOOT_CURR_IMG(state));
+        return BOOT_EBADIMAGE;
+    }
+
+    rc = flash_area_read(fap, off, segs, len);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+    seg_cnt = len / sizeof(*segs);
+
+    total = 0;
+    for (i = 0; i < seg_cnt; i++) {
+        if (segs[i].size == 0 ||
+            !boot_u32_safe_add(&seg_end, segs[i].load_addr, segs[i].size) ||
+            !boot_u32_safe_add(&total, total, segs[i].size)) {
+            return BOOT_EBADIMAGE;
+        }
+
+        for (region = 0; ; region++) {
+            rc = boot_get_image_ram_load_region(BOOT_CURR_IMG(state), region,
+                                                &reg_start, &reg_size);
+            if (rc != 0) {
+                BOOT_LOG_INF("Image %d segment %d at 0x%x is not in a RAM "
+                             "load region", BOOT_CURR_IMG(state), i,
+                             segs[i].load_addr);
+                return BOOT_EBADIMAGE;
+            }
+
+            if (segs[i].load_addr >= reg_start &&
+                boot_u32_safe_add(&reg_end, reg_start, reg_size) &&
+                seg_end <= reg_end) {
+                break;
+            }
+        }
+
+        /* A segment loaded over another one would change what was hashed. */
+        for (j = 0; j < i; j++) {
+            if (segs[i].load_addr < segs[j].load_addr + segs[j].size &&
+                segs[j].load_addr < seg_end) {
+                return BOOT_EBADIMAGE;
+            }
+        }
+    }
+
+    if (total != hdr->ih_img_size) {
+        return BOOT_EBADIMAGE;
+    }
+
+    state->slot_usage[BOOT_CURR_IMG(state)].seg_cnt = seg_cnt;
+
+    return 0;
+}
+
+/*
+ * Feeds size bytes of the slot starting at off into the hash context.
+ */
+static int
+boot_ram_load_hash_flash(bootutil_sha_context *sha_ctx,
+                         const struct flash_area *fap, uint32_t off,
+                         uint32_t size)
+{
+    uint8_t buf[64];
+    uint32_t len;
+    int rc;
+
+    while (size > 0) {
+        len = (size < sizeof(buf)) ? size : sizeof(buf);
+        rc = flash_area_read(fap, off, buf, len);
+        if (rc != 0) {
+            return BOOT_EFLASH;
+        }
+        bootutil_sha_update(sha_ctx, buf, len);
+        off += len;
+        size -= len;
+    }
+
+    return 0;
+}
+
+/**
+ * Copies each segment of a scatter-loaded image from flash to its RAM
+ * address, hashing it once it is there. The hash covers the header, the
+ * payload and the protected TLVs, as the one bootutil_img_hash() computes
+ * over flash, the payload being hashed from RAM.
+ *
+ * @param  state    Boot loader status information.
+ * @param  fap      The flash area of the image.
+ * @param  hdr      The image header.
+ * @param  hash     Where the hash is written.
+ *
+ * @return          0 on success; nonzero on failure.
+ */
+static int
+boot_copy_and_hash_segments_to_sram(struct boot_loader_state *state,
+                                    const struct flash_area *fap,
+                                    const struct image_header *hdr,
+                                    uint8_t *hash)
+{
+    const struct image_ram_load_segment *segs;
+    bootutil_sha_context sha_ctx;
+    uint32_t off;
+    uint32_t i;
+    uint8_t *dst;
+    int rc;
+
+    segs = state->slot_usage[BOOT_CURR_IMG(state)].segs;
+
+    if (hdr->ih_hdr_size < sizeof(*hdr)) {
+        return BOOT_EBADIMAGE;
+    }
+
+    bootutil_sha_init(&sha_ctx);
+
+    /* The header is hashed as it was read, the offsets used below come
+     * from it.
+     */
+    bootutil_sha_update(&sha_ctx, hdr, sizeof(*hdr));
+    rc = boot_ram_load_hash_flash(&sha_ctx, fap, sizeof(*hdr),
+                                  hdr->ih_hdr_size - sizeof(*hdr));
+
+    off = hdr->ih_hdr_size;
+    for (i = 0; rc == 0 && i < state->slot_usage[BOOT_CURR_IMG(state)].seg_cnt;
+         i++) {
+        dst = (uint8_t *)(IMAGE_RAM_BASE + segs[i].load_addr);
+        rc = flash_area_read(fap, off, dst, segs[i].size);
+        if (rc != 0) {
+            rc = BOOT_EFLASH;
+            break;
+        }
+        bootutil_sha_update(&sha_ctx, dst, segs[i].size);
+        boot_watchdog_feed(segs[i].size);
+
+        BOOT_LOG_DBG("Image %d segment %d loaded to 0x%x (0x%x bytes)",
+                     BOOT_CURR_IMG(state), i, segs[i].load_addr,
+                     segs[i].size);
+        off += segs[i].size;
+    }
+
+    if (rc == 0) {
+        rc = boot_ram_load_hash_flash(&sha_ctx, fap, off,
+                                      hdr->ih_protect_tlv_size);
+    }
+    if (rc == 0) {
+        bootutil_sha_finish(&sha_ctx, hash);
+    }
+    bootutil_sha_drop(&sha_ctx);
+
+    return rc;
+}
+
+/**
+ * Loads the segments of the active slot of the current image into SRAM,
+ * each at the address given by its IMAGE_TLV_RAM_LOAD_SEGMENTS entry.
+ *
+ * @param  state    Boot loader status information.
+ * @param  slot     The flash slot of the image.
+ * @param  hdr      The image header.
+ *
+ * @return          0 on success; nonzero on failure.
+ */
+static int
+boot_load_image_segments_to_sram(struct boot_loader_state *state,
+                                 uint32_t slot, const struct image_header *hdr)
+{
+    const struct flash_area *fap;
+    int rc;
+
+    if (IS_ENCRYPTED(hdr) || (hdr->ih_flags & IMAGE_F_HASH_CHUNKED)) {
+        BOOT_LOG_ERR("Image %d: scatter-loaded images can not be encrypted "
+                     "or chunk hashed", BOOT_CURR_IMG(state));
+        return BOOT_EBADIMAGE;
+    }
+
+    fap = BOOT_IMG_AREA(state, slot);
+    rc = boot_read_ram_load_segments(state, fap, hdr);
+    if (rc != 0) {
+        BOOT_LOG_INF("Image %d RAM load segments are invalid.",
+                     BOOT_CURR_IMG(state));
+        goto done;
+    }
+
+#if (BOOT_IMAGE_NUMBER > 1)
+    rc = boot_check_ram_load_overlapping(state);
+    if (rc != 0) {
+        BOOT_LOG_INF("Image %d RAM load segments would overlap with another "
+                     "image.", BOOT_CURR_IMG(state));
+        goto done;
+    }
+#endif
+
+    rc = boot_copy_and_hash_segments_to_sram(state, fap, hdr,
+            state->slot_usage[BOOT_CURR_IMG(state)].img_hash);
+    state->slot_usage[BOOT_CURR_IMG(state)].img_hash_valid = (rc == 0);
+
+done:
+    return rc;
+}
+#endif /* MCUBOOT_RAM_LOAD_SEGMENTS */
+
+#ifdef MCUBOOT_RAM_LOAD_PARALLEL
+/* Copy of an image started by boot_preload_images_to_sram(). */
+struct boot_ram_load_job {
+    const struct flash_area *fap;
+    uint8_t *dst;
+    uint32_t slot;
+    uint32_t img_sz;
+    uint32_t hash_sz;
+    uint32_t off;
+    uint32_t chunk_sz;
+    int rc;
+    bootutil_sha_context sha_ctx;
+};
+
+/**
+ * Copies the slot set in the preload_slot of every image to SRAM and hashes
+ * it, as boot_copy_and_hash_image_to_sram() does, but for all the images at
+ * the same time: the read of a chunk of every image is started before
+ * waiting for any of them, so that the reads from different flash areas
+ * overlap, and each chunk is hashed while the next ones are being read.
+ *
+ * The load regions of all the images are checked first. Images which can not
+ * be loaded this way, being encrypted, chunk hashed, or overlapping another
+ * one, have their preload_slot cleared, as have those whose copy failed; they
+ * are then loaded one at a time by boot_load_image_to_sram().
+ *
+ * @param  state        Boot loader status information.
+ */
+void
+boot_preload_images_to_sram(struct boot_loader_state *state)
+{
+    struct boot_ram_load_job jobs[BOOT_IMAGE_NUMBER];
+    struct boot_ram_load_job *job;
+    struct slot_usage_t *usage;
+    const struct image_header *hdr;
+    uint32_t next_sz;
+    uint32_t curr_img;
+    uint32_t i;
+    bool busy;
+
+    curr_img = BOOT_CURR_IMG(state);
+
+    /* Plan the copies. */
+    for (BOOT_CURR_IMG(state) = 0; BOOT_CURR_IMG(state) < BOOT_IMAGE_NUMBER;
+         BOOT_CURR_IMG(state)++) {
+        usage = &state->slot_usage[BOOT_CURR_IMG(state)];
+        job = &jobs[BOOT_CURR_IMG(state)];
+        job->fap = NULL;
+
+        job->slot = usage->preload_slot;
+        usage->preload_slot = NO_ACTIVE_SLOT;
+        if (job->slot == NO_ACTIVE_SLOT) {
+            continue;
+        }
+
+        hdr = boot_img_hdr(state, job->slot);
+        if (!(hdr->ih_flags & IMAGE_F_RAM_LOAD) || IS_ENCRYPTED(hdr) ||
+            (hdr->ih_flags & IMAGE_F_HASH_CHUNKED)) {
+            continue;
+        }
+
+        if (boot_read_image_size(state, job->slot, &job->img_sz) != 0) {
+            continue;
+        }
+        job->hash_sz = (uint32_t)hdr->ih_hdr_size + hdr->ih_img_size +
+                       hdr->ih_protect_tlv_size;
+        if (job->hash_sz > job->img_sz) {
+            continue;
+        }
+
+        usage->img_dst = hdr->ih_load_addr;
+        usage->img_sz = job->img_sz;
+        if (boot_verify_ram_load_address(state) != 0) {
+            usage->img_dst = 0;
+            usage->img_sz = 0;
+            continue;
+        }
+
+        for (i = 0; i < BOOT_CURR_IMG(state); i++) {
+            if (jobs[i].fap != NULL &&
+                do_regions_overlap(usage->img_dst,
+                                   usage->img_dst + usage->img_sz,
+                                   state->slot_usage[i].img_dst,
+                                   state->slot_usage[i].img_dst +
+                                   state->slot_usage[i].img_sz)) {
+                break;
+            }
+        }
+        if (i < BOOT_CURR_IMG(state)) {
+            usage->img_dst = 0;
+            usage->img_sz = 0;
+            continue;
+        }
+
+        job->fap = BOOT_IMG_AREA(state, job->slot);
+        job->dst = (uint8_t *)(IMAGE_RAM_BASE + usage->img_dst);
+        job->off = 0;
+        job->chunk_sz = job->img_sz;
+        if (job->chunk_sz > MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE) {
+            job->chunk_sz = MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE;
+        }
+        bootutil_sha_init(&job->sha_ctx);
+        job->rc = boot_ram_load_read_start(job->fap, 0, job->dst,
+                                           job->chunk_sz);
+    }
+
+    /* Run them, one chunk of each image at a time. */
+    do {
+        busy = false;
+
+        for (i = 0; i < BOOT_IMAGE_NUMBER; i++) {
+            job = &jobs[i];
+            if (job->fap == NULL || job->rc != 0 || job->off >= job->img_sz) {
+                continue;
+            }
+
+            job->rc = boot_ram_load_read_wait(job->fap);
+            if (job->rc != 0) {
+                continue;
+            }
+
+            next_sz = job->img_sz - (job->off + job->chunk_sz);
+            if (next_sz > MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE) {
+                next_sz = MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE;
+            }
+            if (next_sz > 0) {
+                job->rc = boot_ram_load_read_start(job->fap,
+                        job->off + job->chunk_sz,
+                        job->dst + job->off + job->chunk_sz, next_sz);
+                if (job->rc != 0) {
+                    continue;
+                }
+                busy = true;
+            }
+
+            if (job->off < job->hash_sz) {
+                bootutil_sha_update(&job->sha_ctx, job->dst + job->off,
+                                    (job->hash_sz - job->off < job->chunk_sz) ?
+                                    job->hash_sz - job->off : job->chunk_sz);
+            }
+            boot_watchdog_feed(job->chunk_sz);
+
+            job->off += job->chunk_sz;
+            job->chunk_sz = next_sz;
+        }
+    } while (busy);
+
+    for (BOOT_CURR_IMG(state) = 0; BOOT_CURR_IMG(state) < BOOT_IMAGE_NUMBER;
+         BOOT_CURR_IMG(state)++) {
+        usage = &state->slot_usage[BOOT_CURR_IMG(state)];
+        job = &jobs[BOOT_CURR_IMG(state)];
+        if (job->fap == NULL) {
+            continue;
+        }
+
+        if (job->rc == 0) {
+            bootutil_sha_finish(&job->sha_ctx, usage->img_hash);
+            usage->img_hash_valid = true;
+            usage->preload_slot = job->slot;
+        } else {
+            BOOT_LOG_INF("Error whilst copying image %d from Flash to SRAM: %d",
+                         BOOT_CURR_IMG(state), job->rc);
+            usage->img_dst = 0;
+            usage->img_sz = 0;
+        }
+        bootutil_sha_drop(&job->sha_ctx);
+    }
+
+    BOOT_CURR_IMG(state) = curr_img;
+}
+
+/**
+ * Forgets the copies of the other images made by
+ * boot_preload_images_to_sram() which the current image is about to be
+ * loaded over.
+ *
+ * @param  state        Boot loader status information.
+ */
+static void
+boot_drop_overlapping_preloads(struct boot_loader_state *state)
+{
+    struct slot_usage_t *cur = &state->slot_usage[BOOT_CURR_IMG(state)];
+    struct slot_usage_t *other;
+    uint32_t i;
+
+    for (i = 0; i < BOOT_IMAGE_NUMBER; i++) {
+        other = &state->slot_usage[i];
+        if (i == BOOT_CURR_IMG(state) || other->preload_slot == NO_ACTIVE_SLOT) {
+            continue;
+        }
+
+        if (do_regions_overlap(cur->img_dst, cur->img_dst + cur->img_sz,
+                               other->img_dst,
+                               other->img_dst + other->img_sz)) {
+            other->preload_slot = NO_ACTIVE_SLOT;
+            other->img_hash_valid = false;
+        }
+    }
+}
+#endif /* MCUBOOT_RAM_LOAD_PARALLEL */
+
 /**
  * Loads the active slot of the current image into SRAM. The load address and
  * image size is extracted from the image header.
@@ -325,6 +1130,26 @@ boot_load_image_to_sram(struct boot_loader_state *state)
 
     active_slot = state->slot_usage[BOOT_CURR_IMG(state)].active_slot;
     hdr = boot_img_hdr(state, active_slot);
+#ifdef MCUBOOT_RAM_LOAD_PARALLEL
+    if (state->slot_usage[BOOT_CURR_IMG(state)].preload_slot == active_slot) {
+        /* Already copied and hashed by boot_preload_images_to_sram(). */
+        state->slot_usage[BOOT_CURR_IMG(state)].preload_slot = NO_ACTIVE_SLOT;
+        BOOT_LOG_INF("Image %d RAM loading to 0x%x is succeeded.",
+                     BOOT_CURR_IMG(state),
+                     state->slot_usage[BOOT_CURR_IMG(state)].img_dst);
+        return 0;
+    }
+    state->slot_usage[BOOT_CURR_IMG(state)].preload_slot = NO_ACTIVE_SLOT;
+#endif
+#if defined(MCUBOOT_RAM_LOAD_HASH_COPY) || defined(MCUBOOT_RAM_LOAD_SEGMENTS)
+    state->slot_usage[BOOT_CURR_IMG(state)].img_hash_valid = false;
+#endif
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+    state->slot_usage[BOOT_CURR_IMG(state)].seg_cnt = 0;
+#endif
+#ifdef MCUBOOT_RAM_LOAD_RESIDENT
+    state->slot_usage[BOOT_CURR_IMG(state)].resident_rc = FIH_FAILURE;
+#endif
 
     if (hdr->ih_flags & IMAGE_F_RAM_LOAD) {
 
@@ -344,6 +1169,13 @@ boot_load_image_to_sram(struct boot_loader_state *state)
             return rc;
         }
 
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+        /* The image is a single segment. */
+        state->slot_usage[BOOT_CURR_IMG(state)].segs[0].load_addr = img_dst;
+        state->slot_usage[BOOT_CURR_IMG(state)].segs[0].size = img_sz;
+        state->slot_usage[BOOT_CURR_IMG(state)].seg_cnt = 1;
+#endif
+
 #if (BOOT_IMAGE_NUMBER > 1)
         rc = boot_check_ram_load_overlapping(state);
         if (rc != 0) {
@@ -352,6 +1184,20 @@ boot_load_image_to_sram(struct boot_loader_state *state)
             return rc;
         }
 #endif
+#ifdef MCUBOOT_RAM_LOAD_PARALLEL
+        boot_drop_overlapping_preloads(state);
+#endif
+#ifdef MCUBOOT_RAM_LOAD_RESIDENT
+        FIH_CALL(boot_ram_resident_check,
+                 state->slot_usage[BOOT_CURR_IMG(state)].resident_rc,
+                 state, active_slot, img_dst, img_sz);
+        if (FIH_EQ(state->slot_usage[BOOT_CURR_IMG(state)].resident_rc,
+                   FIH_SUCCESS)) {
+            BOOT_LOG_INF("Image %d is already resident in RAM at 0x%x.",
+                         BOOT_CURR_IMG(state), img_dst);
+            return 0;
+        }
+#endif
 #ifdef MCUBOOT_ENC_IMAGES
         /* decrypt image if encrypted and copy it to RAM */
         if (IS_ENCRYPTED(hdr)) {
@@ -370,6 +1216,18 @@ boot_load_image_to_sram(struct boot_loader_state *state)
         } else {
             BOOT_LOG_INF("Image %d RAM loading to 0x%x is succeeded.", BOOT_CURR_IMG(state), img_dst);
         }
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+    } else if (hdr->ih_flags & IMAGE_F_RAM_LOAD_SEGMENTS) {
+        rc = boot_load_image_segments_to_sram(state, active_slot, hdr);
+        if (rc != 0) {
+            BOOT_LOG_INF("Image %d RAM loading of segments is failed.",
+                         BOOT_CURR_IMG(state));
+        } else {
+            BOOT_LOG_INF("Image %d RAM loading of %d segments is succeeded.",
+                         BOOT_CURR_IMG(state),
+                         state->slot_usage[BOOT_CURR_IMG(state)].seg_cnt);
+        }
+#endif
     } else {
         /* Only images that support IMAGE_F_RAM_LOAD are allowed if
          * MCUBOOT_RAM_LOAD is set.
@@ -380,11 +1238,27 @@ boot_load_image_to_sram(struct boot_loader_state *state)
     if (rc != 0) {
         state->slot_usage[BOOT_CURR_IMG(state)].img_dst = 0;
         state->slot_usage[BOOT_CURR_IMG(state)].img_sz = 0;
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+        state->slot_usage[BOOT_CURR_IMG(state)].seg_cnt = 0;
+#endif
     }
 
     return rc;
 }
 
+/*
+ * Sets size bytes of SRAM at the load address dst to 0.
+ */
+static void
+boot_ram_load_clear(uint32_t dst, uint32_t size)
+{
+#ifdef MCUBOOT_RAM_CLEAR
+    boot_ram_clear((void *)(IMAGE_RAM_BASE + dst), size);
+#else
+    memset((void *)(IMAGE_RAM_BASE + dst), 0, size);
+#endif
+}
+
 /**
  * Removes an image from SRAM, by overwriting it with zeros.
  *
@@ -395,17 +1269,36 @@ boot_load_image_to_sram(struct boot_loader_state *state)
 int
 boot_remove_image_from_sram(struct boot_loader_state *state)
 {
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+    struct image_ram_load_segment *segs;
+    uint32_t i;
+#endif
+
     (void)state;
 
     BOOT_LOG_INF("Removing image %d from SRAM at address 0x%x",
                  BOOT_CURR_IMG(state),
                  state->slot_usage[BOOT_CURR_IMG(state)].img_dst);
 
-    memset((void*)(IMAGE_RAM_BASE + state->slot_usage[BOOT_CURR_IMG(state)].img_dst),
-           0, state->slot_usage[BOOT_CURR_IMG(state)].img_sz);
+#ifdef MCUBOOT_RAM_LOAD_SEGMENTS
+    /* The segments of the image, which is one segment unless it is scatter
+     * loaded.
+     */
+    segs = state->slot_usage[BOOT_CURR_IMG(state)].segs;
+    for (i = 0; i < state->slot_usage[BOOT_CURR_IMG(state)].seg_cnt; i++) {
+        boot_ram_load_clear(segs[i].load_addr, segs[i].size);
+    }
+    state->slot_usage[BOOT_CURR_IMG(state)].seg_cnt = 0;
+#else
+    boot_ram_load_clear(state->slot_usage[BOOT_CURR_IMG(state)].img_dst,
+                        state->slot_usage[BOOT_CURR_IMG(state)].img_sz);
+#endif
 
     state->slot_usage[BOOT_CURR_IMG(state)].img_dst = 0;
     state->slot_usage[BOOT_CURR_IMG(state)].img_sz = 0;
+#if defined(MCUBOOT_RAM_LOAD_HASH_COPY) || defined(MCUBOOT_RAM_LOAD_SEGMENTS)
+    state->slot_usage[BOOT_CURR_IMG(state)].img_hash_valid = false;
+#endif
 
     return 0;
 }
@@ -421,20 +1314,12 @@ boot_remove_image_from_sram(struct boot_loader_state *state)
 int
 boot_remove_image_from_flash(struct boot_loader_state *state, uint32_t slot)
 {
-    int area_id;
-    int rc;
     const struct flash_area *fap;
 
-    (void)state;
-
     BOOT_LOG_INF("Removing image %d slot %d from flash", BOOT_CURR_IMG(state),
                                                          slot);
-    area_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), slot);
-    rc = flash_area_open(area_id, &fap);
-    if (rc == 0) {
-        flash_area_erase(fap, 0, flash_area_get_size(fap));
-        flash_area_close(fap);
-    }
+    fap = BOOT_IMG_AREA(state, slot);
+    flash_area_erase(fap, 0, flash_area_get_size(fap));
 
-    return rc;
+    return 0;
 }
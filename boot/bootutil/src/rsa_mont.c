@@ -0,0 +1,127 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * RSA public key operation with precomputed Montgomery constants.
+ *
+ * The exponent is always 65537, so s^e mod N is computed as one conversion
+ * to the Montgomery domain (a product by R^2 mod N), 16 squarings and a
+ * last product by s, which also leaves the domain. The products use the
+ * CIOS method on fixed-size word arrays, with no heap, no division and no
+ * processing of the exponent.
+ */
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef MCUBOOT_RSA_MONT
+
+#include <stddef.h>
+#include <string.h>
+
+#include "bootutil/rsa_mont.h"
+
+#define W BOOTUTIL_RSA_MONT_WORDS
+
+/* r = a * b / R mod N, for a and b smaller than N. r may alias a or b. */
+static void
+rsa_mont_mul(uint32_t *r, const uint32_t *a, const uint32_t *b,
+             const struct bootutil_rsa_mont *key)
+{
+    uint32_t t[W + 2];
+    uint64_t uv;
+    uint32_t carry;
+    uint32_t m;
+    uint32_t borrow;
+    size_t i;
+    size_t j;
+
+    memset(t, 0, sizeof(t));
+
+    for (i = 0; i < W; i++) {
+        /* t += a * b[i] */
+        carry = 0;
+        for (j = 0; j < W; j++) {
+            uv = (uint64_t)a[j] * b[i] + t[j] + carry;
+            t[j] = (uint32_t)uv;
+            carry = (uint32_t)(uv >> 32);
+        }
+        uv = (uint64_t)t[W] + carry;
+        t[W] = (uint32_t)uv;
+        t[W + 1] = (uint32_t)(uv >> 32);
+
+        /* t = (t + m * N) / 2^32, with m chosen so that the division is
+         * exact.
+         */
+        m = t[0] * key->n0inv;
+        uv = (uint64_t)m * key->n[0] + t[0];
+        carry = (uint32_t)(uv >> 32);
+        for (j = 1; j < W; j++) {
+            uv = (uint64_t)m * key->n[j] + t[j] + carry;
+            t[j - 1] = (uint32_t)uv;
+            carry = (uint32_t)(uv >> 32);
+        }
+        uv = (uint64_t)t[W] + carry;
+        t[W - 1] = (uint32_t)uv;
+        t[W] = t[W + 1] + (uint32_t)(uv >> 32);
+    }
+
+    /* t < 2N: subtract N once if t >= N. */
+    borrow = 0;
+    for (j = 0; j < W; j++) {
+        uv = (uint64_t)t[j] - key->n[j] - borrow;
+        r[j] = (uint32_t)uv;
+        borrow = (uint32_t)(uv >> 32) & 1;
+    }
+    if (t[W] < borrow) {
+        memcpy(r, t, W * sizeof(uint32_t));
+    }
+}
+
+int
+bootutil_rsa_mont_public(const struct bootutil_rsa_mont *key,
+                         const uint8_t *sig, uint8_t *em)
+{
+    uint32_t s[W];
+    uint32_t a[W];
+    const uint8_t *p;
+    size_t i;
+    int cmp;
+
+    /* Load the big endian signature, least significant word first. */
+    for (i = 0; i < W; i++) {
+        p = &sig[(W - 1 - i) * 4];
+        s[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+               ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+    }
+
+    /* RSAVP1 requires the signature to be smaller than the modulus. */
+    cmp = 0;
+    for (i = W; i > 0 && cmp == 0; i--) {
+        if (s[i - 1] != key->n[i - 1]) {
+            cmp = s[i - 1] < key->n[i - 1] ? -1 : 1;
+        }
+    }
+    if (cmp >= 0) {
+        return -1;
+    }
+
+    rsa_mont_mul(a, s, key->rr, key);
+    for (i = 0; i < 16; i++) {
+        rsa_mont_mul(a, a, a, key);
+    }
+    rsa_mont_mul(a, a, s, key);
+
+    for (i = 0; i < W; i++) {
+        em[(W - 1 - i) * 4] = (uint8_t)(a[i] >> 24);
+        em[(W - 1 - i) * 4 + 1] = (uint8_t)(a[i] >> 16);
+        em[(W - 1 - i) * 4 + 2] = (uint8_t)(a[i] >> 8);
+        em[(W - 1 - i) * 4 + 3] = (uint8_t)a[i];
+    }
+
+    return 0;
+}
+
+#endif /* MCUBOOT_RSA_MONT */
@@ -0,0 +1,214 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * SHA-256 (FIPS 180-4) for MCUBOOT_SHA256_FAST.
+ *
+ * The 16 rounds that use one pass over the message schedule are unrolled,
+ * with the working variables renamed from one round to the next instead of
+ * being shifted, and the schedule is updated in place in a 16-word window.
+ * On Armv7-M this keeps a..h and the round temporaries in registers and
+ * lets every rotation be folded into the instruction that consumes it.
+ */
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef MCUBOOT_SHA256_FAST
+
+#include <stddef.h>
+#include <string.h>
+
+#include "bootutil/sha256_fast.h"
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n)    (((x) >> (n)) | ((x) << (32 - (n))))
+#define BSIG0(x)     (ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define BSIG1(x)     (ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define SSIG0(x)     (ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define SSIG1(x)     (ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+/* Ch and Maj with one operation less than their definitions. */
+#define CH(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+#define ROUND(a, b, c, d, e, f, g, h, i) do {                       \
+        uint32_t t_ = (h) + BSIG1(e) + CH(e, f, g) + k[i] + w[i];   \
+        (d) += t_;                                                  \
+        (h) = t_ + BSIG0(a) + MAJ(a, b, c);                         \
+    } while (0)
+
+static inline uint32_t
+sha256_load_be(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void
+sha256_store_be(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void
+sha256_blocks(uint32_t *state, const uint8_t *data, size_t blocks)
+{
+    uint32_t a, b, c, d, e, f, g, h;
+    uint32_t w[16];
+    const uint32_t *k;
+    size_t i;
+
+    while (blocks-- > 0) {
+        for (i = 0; i < 16; i++) {
+            w[i] = sha256_load_be(&data[i * 4]);
+        }
+        data += 64;
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+        for (k = sha256_k; k < &sha256_k[64]; k += 16) {
+            if (k != sha256_k) {
+                for (i = 0; i < 16; i++) {
+                    w[i] += SSIG1(w[(i + 14) & 15]) + w[(i + 9) & 15] +
+                            SSIG0(w[(i + 1) & 15]);
+                }
+            }
+
+            ROUND(a, b, c, d, e, f, g, h, 0);
+            ROUND(h, a, b, c, d, e, f, g, 1);
+            ROUND(g, h, a, b, c, d, e, f, 2);
+            ROUND(f, g, h, a, b, c, d, e, 3);
+            ROUND(e, f, g, h, a, b, c, d, 4);
+            ROUND(d, e, f, g, h, a, b, c, 5);
+            ROUND(c, d, e, f, g, h, a, b, 6);
+            ROUND(b, c, d, e, f, g, h, a, 7);
+            ROUND(a, b, c, d, e, f, g, h, 8);
+            ROUND(h, a, b, c, d, e, f, g, 9);
+            ROUND(g, h, a, b, c, d, e, f, 10);
+            ROUND(f, g, h, a, b, c, d, e, 11);
+            ROUND(e, f, g, h, a, b, c, d, 12);
+            ROUND(d, e, f, g, h, a, b, c, 13);
+            ROUND(c, d, e, f, g, h, a, b, 14);
+            ROUND(b, c, d, e, f, g, h, a, 15);
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+void
+bootutil_sha256_fast_init(struct bootutil_sha256_context *ctx)
+{
+    ctx->state[0] = 0x6a09e667;
+    ctx->state[1] = 0xbb67ae85;
+    ctx->state[2] = 0x3c6ef372;
+    ctx->state[3] = 0xa54ff53a;
+    ctx->state[4] = 0x510e527f;
+    ctx->state[5] = 0x9b05688c;
+    ctx->state[6] = 0x1f83d9ab;
+    ctx->state[7] = 0x5be0cd19;
+    ctx->len = 0;
+    ctx->buf_len = 0;
+}
+
+void
+bootutil_sha256_fast_update(struct bootutil_sha256_context *ctx,
+                            const void *data, uint32_t len)
+{
+    const uint8_t *p = data;
+    uint32_t n;
+
+    ctx->len += len;
+
+    if (ctx->buf_len > 0) {
+        n = sizeof(ctx->buf) - ctx->buf_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(&ctx->buf[ctx->buf_len], p, n);
+        ctx->buf_len += n;
+        p += n;
+        len -= n;
+
+        if (ctx->buf_len < sizeof(ctx->buf)) {
+            return;
+        }
+        sha256_blocks(ctx->state, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+
+    /* Whole blocks are hashed in place, without going through buf. */
+    n = len / sizeof(ctx->buf);
+    if (n > 0) {
+        sha256_blocks(ctx->state, p, n);
+        p += n * sizeof(ctx->buf);
+        len -= n * sizeof(ctx->buf);
+    }
+
+    if (len > 0) {
+        memcpy(ctx->buf, p, len);
+        ctx->buf_len = len;
+    }
+}
+
+void
+bootutil_sha256_fast_finish(struct bootutil_sha256_context *ctx,
+                            uint8_t *digest)
+{
+    uint64_t bits = ctx->len * 8;
+    size_t i;
+
+    ctx->buf[ctx->buf_len++] = 0x80;
+    if (ctx->buf_len > sizeof(ctx->buf) - 8) {
+        memset(&ctx->buf[ctx->buf_len], 0, sizeof(ctx->buf) - ctx->buf_len);
+        sha256_blocks(ctx->state, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+    memset(&ctx->buf[ctx->buf_len], 0, sizeof(ctx->buf) - 8 - ctx->buf_len);
+    sha256_store_be(&ctx->buf[56], (uint32_t)(bits >> 32));
+    sha256_store_be(&ctx->buf[60], (uint32_t)bits);
+    sha256_blocks(ctx->state, ctx->buf, 1);
+
+    for (i = 0; i < 8; i++) {
+        sha256_store_be(&digest[i * 4], ctx->state[i]);
+    }
+}
+
+#endif /* MCUBOOT_SHA256_FAST */
@@ -0,0 +1,257 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Swap using bank: the two slots of an image are the banks of a dual-bank
+ * flash controller, which can map either bank at the address of the primary
+ * slot. An image is installed by preparing the trailers and then having the
+ * port swap the banks with boot_bank_swap(), without copying any sector. The
+ * primary and secondary slots are always the banks as currently mapped.
+ *
+ * The trailers keep their meaning across the swap. Before the banks are
+ * swapped, copy_done is set in the trailer of the secondary slot, which then
+ * reads as an installed upgrade once mapped as the primary slot, and the
+ * trailer of the primary slot is erased, so that it does not read as an
+ * upgrade request once mapped as the secondary slot. Both steps can be run
+ * again after a reset, until the controller swaps the banks, atomically.
+ *
+ * A revert turns the image in the secondary slot into a permanent upgrade:
+ * its trailer gets image_ok, a swap_info recording the revert and, last, the
+ * magic. The banks are then swapped as for an upgrade. If this is interrupted
+ * the revert is found again from the swap_info, so that the image is not
+ * refused as a downgrade.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bootutil/bootutil.h"
+#include "bootutil/bank_swap.h"
+#include "bootutil_priv.h"
+#include "swap_priv.h"
+#include "bootutil/bootutil_log.h"
+
+#include "mcuboot_config/mcuboot_config.h"
+
+BOOT_LOG_MODULE_DECLARE(mcuboot);
+
+#ifdef MCUBOOT_SWAP_USING_BANK
+
+#if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT)
+/* No status is written while swapping, so this is never incremented. */
+#if !defined(__BOOTSIM__)
+int boot_status_fails = 0;
+#else
+__thread int boot_status_fails = 0;
+#endif
+#endif
+
+int
+boot_read_image_header(struct boot_loader_state *state, int slot,
+                       struct image_header *out_hdr, struct boot_status *bs)
+{
+    int rc;
+
+    /* The headers never move, whatever the state of the swap. */
+    rc = boot_read_hdr(BOOT_IMG_AREA(state, slot), 0, out_hdr);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    if (bs != NULL && out_hdr->ih_magic != IMAGE_MAGIC) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * There is no swap status log, as the banks are swapped in a single step.
+ */
+uint32_t
+boot_status_internal_off(const struct boot_status *bs, int elem_sz)
+{
+    (void)bs;
+    (void)elem_sz;
+
+    return 0;
+}
+
+/*
+ * The slots are compatible when they are banks of the same layout, which is
+ * what the controller requires to swap them.
+ */
+int
+boot_slots_compatible(struct boot_loader_state *state)
+{
+    size_t num_sectors;
+    size_t i;
+
+    num_sectors = boot_img_num_sectors(state, BOOT_PRIMARY_SLOT);
+    if (num_sectors > BOOT_MAX_IMG_SECTORS) {
+        BOOT_LOG_WRN("Cannot upgrade: more sectors than allowed");
+        return 0;
+    }
+
+    if (boot_img_num_sectors(state, BOOT_SECONDARY_SLOT) != num_sectors) {
+        BOOT_LOG_WRN("Cannot upgrade: banks have different layouts");
+        return 0;
+    }
+
+    for (i = 0; i < num_sectors; i++) {
+        if (boot_img_sector_size(state, BOOT_PRIMARY_SLOT, i) !=
+            boot_img_sector_size(state, BOOT_SECONDARY_SLOT, i)) {
+            BOOT_LOG_WRN("Cannot upgrade: banks have different layouts");
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int
+swap_status_source(struct boot_loader_state *state)
+{
+    (void)state;
+
+    return BOOT_STATUS_SOURCE_NONE;
+}
+
+/*
+ * A swap is never found half done, but an interrupted revert is found from
+ * the swap_info written to the trailer of the secondary slot, along with the
+ * magic turning it into an upgrade request.
+ */
+int
+swap_read_status(struct boot_loader_state *state, struct boot_status *bs)
+{
+    struct boot_swap_state swap_state;
+    int rc;
+
+    bs->source = BOOT_STATUS_SOURCE_NONE;
+
+    rc = boot_read_swap_state(BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT),
+                              &swap_state);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    if (swap_state.magic == BOOT_MAGIC_GOOD &&
+        swap_state.swap_type == BOOT_SWAP_TYPE_REVERT &&
+        swap_state.image_num == BOOT_CURR_IMG(state)) {
+        BOOT_LOG_INF("Resuming revert of image %d", BOOT_CURR_IMG(state));
+        bs->swap_type = BOOT_SWAP_TYPE_REVERT;
+    }
+
+    return 0;
+}
+
+/*
+ * Turns the image in the secondary slot into a permanent upgrade, with a
+ * swap_info telling that it is a revert. The magic is written last, as it
+ * makes the request visible.
+ */
+static int
+swap_bank_prepare_revert(struct boot_loader_state *state,
+                         const struct flash_area *fap,
+                         struct boot_swap_state *swap_state)
+{
+    int rc;
+
+    if (swap_state->magic == BOOT_MAGIC_GOOD) {
+        return 0;
+    }
+
+    /* Drop whatever was left of a previous attempt. */
+    rc = swap_erase_trailer_sectors(state, fap);
+    if (rc != 0) {
+        return rc;
+    }
+
+    rc = boot_write_image_ok(fap);
+    if (rc == 0) {
+        rc = boot_write_swap_info(fap, BOOT_SWAP_TYPE_REVERT,
+                                  BOOT_CURR_IMG(state));
+    }
+    if (rc == 0) {
+        rc = boot_write_magic(fap);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    return boot_read_swap_state(fap, swap_state);
+}
+
+void
+swap_run(struct boot_loader_state *state, struct boot_status *bs,
+         uint32_t copy_size)
+{
+    const struct flash_area *fap_pri;
+    const struct flash_area *fap_sec;
+    struct boot_swap_state swap_state;
+    uint8_t image_index;
+    int rc;
+
+    (void)copy_size;
+
+    image_index = BOOT_CURR_IMG(state);
+    fap_pri = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
+    fap_sec = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+
+    BOOT_LOG_INF("Swapping banks of image %d", image_index);
+
+    rc = boot_read_swap_state(fap_sec, &swap_state);
+    assert(rc == 0);
+
+    if (bs->swap_type == BOOT_SWAP_TYPE_REVERT) {
+        rc = swap_bank_prepare_revert(state, fap_sec, &swap_state);
+        assert(rc == 0);
+    }
+
+    if (swap_state.copy_done != BOOT_FLAG_SET) {
+        rc = boot_write_copy_done(fap_sec);
+        assert(rc == 0);
+    }
+
+    rc = swap_erase_trailer_sectors(state, fap_pri);
+    assert(rc == 0);
+
+    rc = boot_bank_swap(image_index);
+    if (rc != 0) {
+        BOOT_LOG_ERR("Failed swapping banks of image %d", image_index);
+        BOOT_SWAP_TYPE(state) = BOOT_SWAP_TYPE_PANIC;
+    }
+}
+
+int
+app_max_size(struct boot_loader_state *state)
+{
+    uint32_t sz_primary;
+    uint32_t sz_secondary;
+
+    /* The trailer sectors are erased when the banks are swapped. */
+    sz_primary = bootutil_max_image_size(BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT));
+    sz_secondary = bootutil_max_image_size(BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT));
+
+    return (sz_primary <= sz_secondary ? sz_primary : sz_secondary);
+}
+
+#endif /* MCUBOOT_SWAP_USING_BANK */
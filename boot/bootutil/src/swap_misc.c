@@ -30,7 +30,60 @@
 
 BOOT_LOG_MODULE_DECLARE(mcuboot);
 
-#if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE)
+#if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE) || \
+    defined(MCUBOOT_SWAP_USING_OFFSET) || defined(MCUBOOT_SWAP_USING_BANK)
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+int
+swap_status_area_open(const struct boot_loader_state *state,
+                      const struct flash_area **fap, uint32_t *off)
+{
+    uint32_t area_sz;
+    int rc;
+
+    rc = flash_area_open(FLASH_AREA_SWAP_STATUS, fap);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    area_sz = flash_area_get_size(*fap) / BOOT_IMAGE_NUMBER;
+    if (area_sz < boot_status_sz(BOOT_WRITE_SZ(state))) {
+        BOOT_LOG_ERR("Swap status partition too small for %d image(s)",
+                     BOOT_IMAGE_NUMBER);
+        flash_area_close(*fap);
+        return BOOT_EFLASH;
+    }
+
+    *off = BOOT_CURR_IMG(state) * area_sz;
+
+    return 0;
+}
+
+/*
+ * Erases the status log of the current image, which is the whole part of the
+ * swap status partition given to the image.
+ */
+static int
+swap_status_area_erase(const struct boot_loader_state *state)
+{
+    const struct flash_area *fap;
+    uint32_t off;
+    int rc;
+
+    rc = swap_status_area_open(state, &fap, &off);
+    if (rc != 0) {
+        return rc;
+    }
+
+    BOOT_LOG_DBG("erasing swap status; fa_id=%d off=0x%lx",
+                 flash_area_get_id(fap), (unsigned long)off);
+
+    rc = boot_erase_region(fap, off, flash_area_get_size(fap) / BOOT_IMAGE_NUMBER);
+    flash_area_close(fap);
+
+    return rc;
+}
+#endif /* MCUBOOT_SWAP_STATUS_PARTITION */
+
 int
 swap_erase_trailer_sectors(const struct boot_loader_state *state,
                            const struct flash_area *fap)
@@ -62,19 +115,39 @@ swap_erase_trailer_sectors(const struct boot_loader_state *state,
         return BOOT_EFLASH;
     }
 
-    /* delete starting from last sector and moving to beginning */
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+    /* The status log of the primary slot is kept in the swap status
+     * partition, and is erased first: the trailer left in the slot until it
+     * is erased below tells that the log is not in use.
+     */
+    if (slot == BOOT_PRIMARY_SLOT) {
+        rc = swap_status_area_erase(state);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+#endif
+
+    /* Find the first sector holding part of the trailer, going backwards
+     * from the last one, and erase them all with a single call. With
+     * MCUBOOT_SKIP_ERASED_SECTORS, boot_erase_region() then leaves out the
+     * sectors that are already erased.
+     */
     sector = boot_img_num_sectors(state, slot) - 1;
     trailer_sz = boot_trailer_sz(BOOT_WRITE_SZ(state));
     total_sz = 0;
-    do {
+    while (true) {
         sz = boot_img_sector_size(state, slot, sector);
         off = boot_img_sector_off(state, slot, sector);
-        rc = boot_erase_region(fap, off, sz);
-        assert(rc == 0);
-
-        sector--;
         total_sz += sz;
-    } while (total_sz < trailer_sz);
+        if (total_sz >= trailer_sz || sector == 0) {
+            break;
+        }
+        sector--;
+    }
+
+    rc = boot_erase_region(fap, off, total_sz);
+    assert(rc == 0);
 
     return rc;
 }
@@ -100,40 +173,27 @@ swap_status_init(const struct boot_loader_state *state,
             &swap_state);
     assert(rc == 0);
 
-    if (bs->swap_type != BOOT_SWAP_TYPE_NONE) {
-        rc = boot_write_swap_info(fap, bs->swap_type, image_index);
-        assert(rc == 0);
-    }
+    rc = boot_write_swap_fields(fap, bs->swap_type, image_index, bs);
+    assert(rc == 0);
 
     if (swap_state.image_ok == BOOT_FLAG_SET) {
         rc = boot_write_image_ok(fap);
         assert(rc == 0);
     }
 
-    rc = boot_write_swap_size(fap, bs->swap_size);
-    assert(rc == 0);
-
-#ifdef MCUBOOT_ENC_IMAGES
-    rc = boot_write_enc_key(fap, 0, bs);
-    assert(rc == 0);
-
-    rc = boot_write_enc_key(fap, 1, bs);
-    assert(rc == 0);
-#endif
-
     rc = boot_write_magic(fap);
     assert(rc == 0);
 
     return 0;
 }
 
+#ifndef MCUBOOT_SWAP_USING_BANK
 int
 swap_read_status(struct boot_loader_state *state, struct boot_status *bs)
 {
     const struct flash_area *fap;
     uint32_t off;
     uint8_t swap_info;
-    int area_id;
     int rc;
 
     bs->source = swap_status_source(state);
@@ -143,12 +203,12 @@ swap_read_status(struct boot_loader_state *state, struct boot_status *bs)
 
 #if MCUBOOT_SWAP_USING_SCRATCH
     case BOOT_STATUS_SOURCE_SCRATCH:
-        area_id = FLASH_AREA_IMAGE_SCRATCH;
+        fap = BOOT_SCRATCH_AREA(state);
         break;
 #endif
 
     case BOOT_STATUS_SOURCE_PRIMARY_SLOT:
-        area_id = FLASH_AREA_IMAGE_PRIMARY(BOOT_CURR_IMG(state));
+        fap = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
         break;
 
     default:
@@ -156,11 +216,6 @@ swap_read_status(struct boot_loader_state *state, struct boot_status *bs)
         return BOOT_EBADARGS;
     }
 
-    rc = flash_area_open(area_id, &fap);
-    if (rc != 0) {
-        return BOOT_EFLASH;
-    }
-
     rc = swap_read_status_bytes(fap, state, bs);
     if (rc == 0) {
         off = boot_swap_info_off(fap);
@@ -180,15 +235,17 @@ swap_read_status(struct boot_loader_state *state, struct boot_status *bs)
     }
 
 done:
-    flash_area_close(fap);
-
     return rc;
 }
+#endif /* !MCUBOOT_SWAP_USING_BANK */
 
 int
 swap_set_copy_done(uint8_t image_index)
 {
     const struct flash_area *fap;
+#ifdef MCUBOOT_SWAP_USING_BANK
+    struct boot_swap_state state;
+#endif
     int rc;
 
     rc = flash_area_open(FLASH_AREA_IMAGE_PRIMARY(image_index),
@@ -197,7 +254,23 @@ swap_set_copy_done(uint8_t image_index)
         return BOOT_EFLASH;
     }
 
+#ifdef MCUBOOT_SWAP_USING_BANK
+    /* copy_done was set before the banks were swapped. */
+    rc = boot_read_swap_state(fap, &state);
+    if (rc != 0) {
+        rc = BOOT_EFLASH;
+        goto out;
+    }
+
+    if (state.copy_done == BOOT_FLAG_SET) {
+        goto out;
+    }
+#endif
+
     rc = boot_write_copy_done(fap);
+#ifdef MCUBOOT_SWAP_USING_BANK
+out:
+#endif
     flash_area_close(fap);
     return rc;
 }
@@ -230,5 +303,48 @@ out:
     return rc;
 }
 
+#ifdef MCUBOOT_SWAP_SKIP_UNCHANGED
+#define SWAP_CMP_BUF_SZ 64
+
+bool
+swap_region_unchanged(struct boot_loader_state *state,
+                      const struct flash_area *fap_src, uint32_t off_src,
+                      const struct flash_area *fap_dst, uint32_t off_dst,
+                      uint32_t sz)
+{
+    uint8_t src_buf[SWAP_CMP_BUF_SZ];
+    uint8_t dst_buf[SWAP_CMP_BUF_SZ];
+    uint32_t chunk_sz;
+    uint32_t off;
+
+#ifdef MCUBOOT_ENC_IMAGES
+    /* Data is encrypted or decrypted when it moves between the slots, so
+     * the bytes stored in both slots never compare equal.
+     */
+    if (IS_ENCRYPTED(boot_img_hdr(state, BOOT_PRIMARY_SLOT)) ||
+        IS_ENCRYPTED(boot_img_hdr(state, BOOT_SECONDARY_SLOT))) {
+        return false;
+    }
+#else
+    (void)state;
+#endif
+
+    for (off = 0; off < sz; off += chunk_sz) {
+        chunk_sz = sz - off;
+        if (chunk_sz > SWAP_CMP_BUF_SZ) {
+            chunk_sz = SWAP_CMP_BUF_SZ;
+        }
+
+        if (flash_area_read(fap_src, off_src + off, src_buf, chunk_sz) != 0 ||
+            flash_area_read(fap_dst, off_dst + off, dst_buf, chunk_sz) != 0 ||
+            memcmp(src_buf, dst_buf, chunk_sz) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+#endif /* MCUBOOT_SWAP_SKIP_UNCHANGED */
 
-#endif /* defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE) */
+#endif /* defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE) || \
+          defined(MCUBOOT_SWAP_USING_OFFSET) || defined(MCUBOOT_SWAP_USING_BANK) */
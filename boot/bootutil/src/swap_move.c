@@ -33,10 +33,13 @@ BOOT_LOG_MODULE_DECLARE(mcuboot);
 #ifdef MCUBOOT_SWAP_USING_MOVE
 
 #if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT)
-/*
- * FIXME: this might have to be updated for threaded sim
- */
+/* Status writes which failed during the swap, each simulator thread
+ * counting its own. */
+#if !defined(__BOOTSIM__)
 int boot_status_fails = 0;
+#else
+__thread int boot_status_fails = 0;
+#endif
 #define BOOT_STATUS_ASSERT(x)                \
     do {                                     \
         if (!(x)) {                          \
@@ -47,6 +50,15 @@ int boot_status_fails = 0;
 #define BOOT_STATUS_ASSERT(x) ASSERT(x)
 #endif
 
+/* Size of the buffer used to read several status entries at once. */
+#ifndef BOOT_STATUS_READ_BUF_SZ
+#define BOOT_STATUS_READ_BUF_SZ 256
+#endif
+
+#if BOOT_STATUS_READ_BUF_SZ < BOOT_MAX_ALIGN
+#error "BOOT_STATUS_READ_BUF_SZ must be at least BOOT_MAX_ALIGN"
+#endif
+
 uint32_t
 find_last_idx(struct boot_loader_state *state, uint32_t swap_size)
 {
@@ -77,13 +89,8 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
     uint32_t sz;
     uint32_t last_idx;
     uint32_t swap_size;
-    int area_id;
     int rc;
 
-#if (BOOT_IMAGE_NUMBER == 1)
-    (void)state;
-#endif
-
     off = 0;
     if (bs && !boot_status_is_reset(bs)) {
         boot_find_status(BOOT_CURR_IMG(state), &fap);
@@ -115,14 +122,8 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
         }
     }
 
-    area_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), slot);
-    rc = flash_area_open(area_id, &fap);
-    if (rc != 0) {
-        rc = BOOT_EFLASH;
-        goto done;
-    }
-
-    rc = flash_area_read(fap, off, out_hdr, sizeof *out_hdr);
+    fap = BOOT_IMG_AREA(state, slot);
+    rc = boot_read_hdr(fap, off, out_hdr);
     if (rc != 0) {
         rc = BOOT_EFLASH;
         goto done;
@@ -137,7 +138,6 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
     rc = 0;
 
 done:
-    flash_area_close(fap);
     return rc;
 }
 
@@ -145,8 +145,12 @@ int
 swap_read_status_bytes(const struct flash_area *fap,
         struct boot_loader_state *state, struct boot_status *bs)
 {
+    uint8_t buf[BOOT_STATUS_READ_BUF_SZ];
+    const struct flash_area *fap_status;
     uint32_t off;
-    uint8_t status;
+    uint32_t buf_off;
+    uint32_t buf_len;
+    int buf_first;
     int max_entries;
     int found_idx;
     uint8_t write_sz;
@@ -165,15 +169,38 @@ swap_read_status_bytes(const struct flash_area *fap,
     found_idx = -1;
     /* skip erased sectors at the end */
     last_rc = 1;
-    write_sz = BOOT_WRITE_SZ(state);
+    write_sz = BOOT_STATUS_ELEM_SZ(state);
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+    rc = swap_status_area_open(state, &fap_status, &off);
+    if (rc != 0) {
+        return rc;
+    }
+#else
+    fap_status = fap;
     off = boot_status_off(fap);
+#endif
+    buf_first = max_entries + 1;
     for (i = max_entries; i > 0; i--) {
-        rc = flash_area_read(fap, off + (i - 1) * write_sz, &status, 1);
-        if (rc < 0) {
-            return BOOT_EFLASH;
+        /* The status bytes are read in blocks spanning several entries,
+         * going down from the end of the status area.
+         */
+        if (i < buf_first) {
+            buf_first = i - (int)((sizeof(buf) - 1) / write_sz);
+            if (buf_first < 1) {
+                buf_first = 1;
+            }
+            buf_off = off + (buf_first - 1) * write_sz;
+            buf_len = (i - buf_first) * write_sz + 1;
+            rc = flash_area_read(fap_status, buf_off, buf, buf_len);
+            if (rc < 0) {
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+                flash_area_close(fap_status);
+#endif
+                return BOOT_EFLASH;
+            }
         }
 
-        if (bootutil_buffer_is_erased(fap, &status, 1)) {
+        if (bootutil_buffer_is_erased(fap_status, &buf[(i - buf_first) * write_sz], 1)) {
             if (rc != last_rc) {
                 erased_sections++;
             }
@@ -181,10 +208,18 @@ swap_read_status_bytes(const struct flash_area *fap,
             if (found_idx == -1) {
                 found_idx = i;
             }
+            /* Only the last written entry matters from here on, and the
+             * erased sections were counted above it.
+             */
+            break;
         }
         last_rc = rc;
     }
 
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+    flash_area_close(fap_status);
+#endif
+
     if (erased_sections > 1) {
         /* This means there was an error writing status on the last
          * swap. Tell user and move on to validation!
@@ -414,10 +449,8 @@ boot_move_sector_up(int idx, uint32_t sz, struct boot_loader_state *state,
         assert(rc == 0);
     }
 
-    rc = boot_erase_region(fap_pri, new_off, sz);
-    assert(rc == 0);
-
-    rc = boot_copy_region(state, fap_pri, fap_pri, old_off, new_off, sz);
+    rc = boot_erase_copy_region(state, fap_pri, fap_pri, old_off, new_off,
+                                sz, sz);
     assert(rc == 0);
 
     rc = boot_write_status(state, bs);
@@ -441,10 +474,8 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
     sec_off = boot_img_sector_off(state, BOOT_SECONDARY_SLOT, idx - 1);
 
     if (bs->state == BOOT_STATUS_STATE_0) {
-        rc = boot_erase_region(fap_pri, pri_off, sz);
-        assert(rc == 0);
-
-        rc = boot_copy_region(state, fap_sec, fap_pri, sec_off, pri_off, sz);
+        rc = boot_erase_copy_region(state, fap_sec, fap_pri, sec_off, pri_off,
+                                    sz, sz);
         assert(rc == 0);
 
         rc = boot_write_status(state, bs);
@@ -453,11 +484,19 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
     }
 
     if (bs->state == BOOT_STATUS_STATE_1) {
-        rc = boot_erase_region(fap_sec, sec_off, sz);
-        assert(rc == 0);
-
-        rc = boot_copy_region(state, fap_pri, fap_sec, pri_up_off, sec_off, sz);
-        assert(rc == 0);
+#ifdef MCUBOOT_SWAP_SKIP_UNCHANGED
+        /* The sector moved up is the old primary one; if the upgrade did
+         * not change it, the secondary slot already holds it. The check is
+         * made again if the swap is resumed, so the status is unchanged.
+         */
+        if (!swap_region_unchanged(state, fap_pri, pri_up_off, fap_sec,
+                                   sec_off, sz))
+#endif
+        {
+            rc = boot_erase_copy_region(state, fap_pri, fap_sec, pri_up_off,
+                                        sec_off, sz, sz);
+            assert(rc == 0);
+        }
 
         rc = boot_write_status(state, bs);
         bs->idx++;
@@ -524,10 +563,8 @@ swap_run(struct boot_loader_state *state, struct boot_status *bs,
     uint32_t trailer_sz;
     uint32_t first_trailer_idx;
     uint32_t last_idx;
-    uint8_t image_index;
     const struct flash_area *fap_pri;
     const struct flash_area *fap_sec;
-    int rc;
 
     BOOT_LOG_INF("Starting swap using move algorithm.");
 
@@ -560,21 +597,24 @@ swap_run(struct boot_loader_state *state, struct boot_status *bs,
         }
     }
 
-    image_index = BOOT_CURR_IMG(state);
-
-    rc = flash_area_open(FLASH_AREA_IMAGE_PRIMARY(image_index), &fap_pri);
-    assert (rc == 0);
-
-    rc = flash_area_open(FLASH_AREA_IMAGE_SECONDARY(image_index), &fap_sec);
-    assert (rc == 0);
+    fap_pri = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
+    fap_sec = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
 
     fixup_revert(state, bs, fap_sec);
 
+    /* Each sector is moved up, then swapped. */
+    boot_progress_start(state, 2 * last_idx,
+                        (bs->idx - BOOT_STATUS_IDX_0) +
+                        ((bs->op == BOOT_STATUS_OP_MOVE) ? 0 : last_idx));
+
     if (bs->op == BOOT_STATUS_OP_MOVE) {
         idx = last_idx;
         while (idx > 0) {
             if (idx <= (last_idx - bs->idx + 1)) {
+                boot_phase_start(BOOT_PHASE_SWAP_STEP);
                 boot_move_sector_up(idx, sector_sz, state, bs, fap_pri, fap_sec);
+                boot_phase_stop(BOOT_PHASE_SWAP_STEP);
+                boot_progress_step(sector_sz);
             }
             idx--;
         }
@@ -586,13 +626,13 @@ swap_run(struct boot_loader_state *state, struct boot_status *bs,
     idx = 1;
     while (idx <= last_idx) {
         if (idx >= bs->idx) {
+            boot_phase_start(BOOT_PHASE_SWAP_STEP);
             boot_swap_sectors(idx, sector_sz, state, bs, fap_pri, fap_sec);
+            boot_phase_stop(BOOT_PHASE_SWAP_STEP);
+            boot_progress_step(sector_sz);
         }
         idx++;
     }
-
-    flash_area_close(fap_pri);
-    flash_area_close(fap_sec);
 }
 
 int app_max_size(struct boot_loader_state *state)
@@ -0,0 +1,753 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Swap using offset: an upgrade image is stored starting from the second
+ * sector of the secondary slot, so the slots can be swapped in a single pass
+ * without first moving the primary slot up by one sector as swap-move does.
+ *
+ * For each sector P[i] of the primary slot, the forward swap (new upgrade)
+ * copies P[i] to S[i] and then S[i + 1] to P[i]. Once done the image that was
+ * in the primary slot is stored from the start of the secondary slot. The
+ * backward swap (revert, or an image found at the start of the secondary slot)
+ * runs from the last sector down, copying P[i] to S[i + 1] and then S[i] to
+ * P[i]. Both directions take one erase and one copy per sector and slot.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bootutil/bootutil.h"
+#include "bootutil_priv.h"
+#include "swap_priv.h"
+#include "bootutil/bootutil_log.h"
+
+#include "mcuboot_config/mcuboot_config.h"
+
+BOOT_LOG_MODULE_DECLARE(mcuboot);
+
+#ifdef MCUBOOT_SWAP_USING_OFFSET
+
+#if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT)
+/* Status writes which failed during the swap, each simulator thread
+ * counting its own. */
+#if !defined(__BOOTSIM__)
+int boot_status_fails = 0;
+#else
+__thread int boot_status_fails = 0;
+#endif
+#define BOOT_STATUS_ASSERT(x)                \
+    do {                                     \
+        if (!(x)) {                          \
+            boot_status_fails++;             \
+        }                                    \
+    } while (0)
+#else
+#define BOOT_STATUS_ASSERT(x) ASSERT(x)
+#endif
+
+/* Size of the buffer used to read several status entries at once. */
+#ifndef BOOT_STATUS_READ_BUF_SZ
+#define BOOT_STATUS_READ_BUF_SZ 256
+#endif
+
+#if BOOT_STATUS_READ_BUF_SZ < BOOT_MAX_ALIGN
+#error "BOOT_STATUS_READ_BUF_SZ must be at least BOOT_MAX_ALIGN"
+#endif
+
+static uint32_t
+find_last_idx(struct boot_loader_state *state, uint32_t swap_size)
+{
+    uint32_t sector_sz;
+    uint32_t sz;
+    uint32_t last_idx;
+
+    sector_sz = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, 0);
+    sz = 0;
+    last_idx = 0;
+    while (1) {
+        sz += sector_sz;
+        last_idx++;
+        if (sz >= swap_size) {
+            break;
+        }
+    }
+
+    return last_idx;
+}
+
+/*
+ * Returns the number of sectors swapped in the given direction. The second
+ * sector of the secondary slot, where boot_img_start_off() looks for an
+ * upgrade, is only written by the last step of the backward swap; it must
+ * not be the first step, which runs before any status entry is written.
+ */
+static uint32_t
+swap_sector_count(struct boot_loader_state *state, uint32_t swap_size,
+                  uint8_t op)
+{
+    uint32_t last_idx;
+
+    last_idx = find_last_idx(state, swap_size);
+    if (op == BOOT_STATUS_OP_MOVE && last_idx < 2) {
+        last_idx = 2;
+    }
+
+    return last_idx;
+}
+
+/*
+ * Returns the index of the first sector of a slot holding trailer data,
+ * which is also the number of sectors available for the image.
+ */
+static uint32_t
+first_trailer_idx(struct boot_loader_state *state, int slot)
+{
+    uint32_t sz = 0;
+    uint32_t sector_sz;
+    uint32_t trailer_sz;
+    uint32_t first_trailer_idx;
+
+    sector_sz = boot_img_sector_size(state, slot, 0);
+    trailer_sz = boot_trailer_sz(BOOT_WRITE_SZ(state));
+    first_trailer_idx = boot_img_num_sectors(state, slot) - 1;
+
+    while (1) {
+        sz += sector_sz;
+        if  (sz >= trailer_sz) {
+            break;
+        }
+        first_trailer_idx--;
+    }
+
+    return first_trailer_idx;
+}
+
+uint32_t
+boot_img_start_off(const struct flash_area *fap)
+{
+    struct flash_sector sector;
+    uint32_t magic;
+    uint32_t off;
+    int image_index;
+    int rc;
+
+    for (image_index = 0; image_index < BOOT_IMAGE_NUMBER; image_index++) {
+        if (flash_area_get_id(fap) ==
+                flash_area_id_from_multi_image_slot(image_index,
+                                                    BOOT_SECONDARY_SLOT)) {
+            break;
+        }
+    }
+
+    if (image_index == BOOT_IMAGE_NUMBER) {
+        return 0;
+    }
+
+    rc = flash_area_get_sector(fap, 0, &sector);
+    if (rc != 0) {
+        return 0;
+    }
+
+    /*
+     * A new upgrade is looked for first: after a swap, the start of the
+     * secondary slot may still hold the header of a previous image.
+     */
+    off = flash_sector_get_size(&sector);
+    rc = flash_area_read(fap, off, &magic, sizeof(magic));
+    if (rc != 0 || magic != IMAGE_MAGIC) {
+        return 0;
+    }
+
+    return off;
+}
+
+int
+boot_read_image_header(struct boot_loader_state *state, int slot,
+                       struct image_header *out_hdr, struct boot_status *bs)
+{
+    const struct flash_area *fap;
+    uint32_t off;
+    uint32_t sz;
+    uint32_t last_idx;
+    uint32_t swap_size;
+    bool in_progress;
+    int rc;
+
+    off = 0;
+    in_progress = (bs && !boot_status_is_reset(bs));
+    if (in_progress) {
+        boot_find_status(BOOT_CURR_IMG(state), &fap);
+        if (fap == NULL || boot_read_swap_size(fap, &swap_size)) {
+            rc = BOOT_EFLASH;
+            goto done;
+        }
+        flash_area_close(fap);
+
+        last_idx = swap_sector_count(state, swap_size, bs->op);
+        sz = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, 0);
+
+        /*
+         * Find the slot and offset where the header of the image that was
+         * in the given slot is expected to be found at the current step.
+         */
+        if (bs->op == BOOT_STATUS_OP_SWAP) {
+            if (slot == BOOT_PRIMARY_SLOT) {
+                slot = BOOT_SECONDARY_SLOT;
+            } else if (bs->idx == BOOT_STATUS_IDX_0) {
+                off = sz;
+            } else {
+                slot = BOOT_PRIMARY_SLOT;
+            }
+        } else if (slot == BOOT_PRIMARY_SLOT) {
+            if (bs->idx > last_idx ||
+                    (bs->idx == last_idx && bs->state == BOOT_STATUS_STATE_1)) {
+                slot = BOOT_SECONDARY_SLOT;
+                off = sz;
+            }
+        }
+    }
+
+    fap = BOOT_IMG_AREA(state, slot);
+    if (!in_progress && slot == BOOT_SECONDARY_SLOT) {
+        off = boot_img_start_off(fap);
+    }
+
+    rc = boot_read_hdr(fap, off, out_hdr);
+    if (rc != 0) {
+        rc = BOOT_EFLASH;
+        goto done;
+    }
+
+    /* We only know where the headers are located when bs is valid */
+    if (bs != NULL && out_hdr->ih_magic != IMAGE_MAGIC) {
+        rc = -1;
+        goto done;
+    }
+
+    rc = 0;
+
+done:
+    return rc;
+}
+
+int
+swap_read_status_bytes(const struct flash_area *fap,
+        struct boot_loader_state *state, struct boot_status *bs)
+{
+    uint8_t buf[BOOT_STATUS_READ_BUF_SZ];
+    const struct flash_area *fap_status;
+    uint32_t off;
+    uint32_t buf_off;
+    uint32_t buf_len;
+    int buf_first;
+    int max_entries;
+    int found_idx;
+    uint8_t write_sz;
+    int move_entries;
+    int rc;
+    int last_rc;
+    int erased_sections;
+    int i;
+
+    max_entries = boot_status_entries(BOOT_CURR_IMG(state), fap);
+    if (max_entries < 0) {
+        return BOOT_EBADARGS;
+    }
+
+    erased_sections = 0;
+    found_idx = -1;
+    /* skip erased sectors at the end */
+    last_rc = 1;
+    write_sz = BOOT_STATUS_ELEM_SZ(state);
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+    rc = swap_status_area_open(state, &fap_status, &off);
+    if (rc != 0) {
+        return rc;
+    }
+#else
+    fap_status = fap;
+    off = boot_status_off(fap);
+#endif
+    buf_first = max_entries + 1;
+    for (i = max_entries; i > 0; i--) {
+        /* The status bytes are read in blocks spanning several entries,
+         * going down from the end of the status area.
+         */
+        if (i < buf_first) {
+            buf_first = i - (int)((sizeof(buf) - 1) / write_sz);
+            if (buf_first < 1) {
+                buf_first = 1;
+            }
+            buf_off = off + (buf_first - 1) * write_sz;
+            buf_len = (i - buf_first) * write_sz + 1;
+            rc = flash_area_read(fap_status, buf_off, buf, buf_len);
+            if (rc < 0) {
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+                flash_area_close(fap_status);
+#endif
+                return BOOT_EFLASH;
+            }
+        }
+
+        if (bootutil_buffer_is_erased(fap_status, &buf[(i - buf_first) * write_sz], 1)) {
+            if (rc != last_rc) {
+                erased_sections++;
+            }
+        } else {
+            if (found_idx == -1) {
+                found_idx = i;
+            }
+            break;
+        }
+        last_rc = rc;
+    }
+
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+    flash_area_close(fap_status);
+#endif
+
+    if (erased_sections > 1) {
+        /* This means there was an error writing status on the last
+         * swap. Tell user and move on to validation!
+         */
+#if !defined(__BOOTSIM__)
+        BOOT_LOG_ERR("Detected inconsistent status!");
+#endif
+
+#if !defined(MCUBOOT_VALIDATE_PRIMARY_SLOT)
+        /* With validation of the primary slot disabled, there is no way
+         * to be sure the swapped primary slot is OK, so abort!
+         */
+        assert(0);
+#endif
+    }
+
+    /* The backward swap is logged in the "move" entries, the forward swap
+     * in the "swap" entries.
+     */
+    move_entries = BOOT_MAX_IMG_SECTORS * BOOT_STATUS_MOVE_STATE_COUNT;
+    if (found_idx == -1) {
+        /* no swap status found; nothing to do */
+    } else if (found_idx < move_entries) {
+        bs->op = BOOT_STATUS_OP_MOVE;
+        bs->idx = (found_idx / BOOT_STATUS_MOVE_STATE_COUNT) + BOOT_STATUS_IDX_0;
+        bs->state = (found_idx % BOOT_STATUS_MOVE_STATE_COUNT) + BOOT_STATUS_STATE_0;
+    } else {
+        bs->op = BOOT_STATUS_OP_SWAP;
+        bs->idx = ((found_idx - move_entries) / BOOT_STATUS_SWAP_STATE_COUNT) + BOOT_STATUS_IDX_0;
+        bs->state = ((found_idx - move_entries) % BOOT_STATUS_SWAP_STATE_COUNT) + BOOT_STATUS_STATE_0;
+    }
+
+    return 0;
+}
+
+uint32_t
+boot_status_internal_off(const struct boot_status *bs, int elem_sz)
+{
+    uint32_t off;
+    int idx_sz;
+
+    idx_sz = elem_sz * ((bs->op == BOOT_STATUS_OP_MOVE) ?
+            BOOT_STATUS_MOVE_STATE_COUNT : BOOT_STATUS_SWAP_STATE_COUNT);
+
+    off = ((bs->op == BOOT_STATUS_OP_MOVE) ?
+               0 : (BOOT_MAX_IMG_SECTORS * BOOT_STATUS_MOVE_STATE_COUNT * elem_sz)) +
+           (bs->idx - BOOT_STATUS_IDX_0) * idx_sz +
+           (bs->state - BOOT_STATUS_STATE_0) * elem_sz;
+
+    return off;
+}
+
+int
+boot_slots_compatible(struct boot_loader_state *state)
+{
+    size_t num_sectors_pri;
+    size_t num_sectors_sec;
+    size_t sector_sz_pri;
+    size_t sector_sz_sec;
+    size_t i;
+
+    num_sectors_pri = boot_img_num_sectors(state, BOOT_PRIMARY_SLOT);
+    num_sectors_sec = boot_img_num_sectors(state, BOOT_SECONDARY_SLOT);
+
+    if (num_sectors_pri > BOOT_MAX_IMG_SECTORS ||
+            num_sectors_sec > BOOT_MAX_IMG_SECTORS) {
+        BOOT_LOG_WRN("Cannot upgrade: more sectors than allowed");
+        return 0;
+    }
+
+    /* Sectors are copied between both slots shifted by one, so all of them
+     * must have the same size.
+     */
+    sector_sz_pri = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, 0);
+    for (i = 1; i < num_sectors_pri; i++) {
+        if (boot_img_sector_size(state, BOOT_PRIMARY_SLOT, i) != sector_sz_pri) {
+            BOOT_LOG_WRN("Cannot upgrade: not same sector layout");
+            return 0;
+        }
+    }
+
+    sector_sz_sec = sector_sz_pri;
+    for (i = 0; i < num_sectors_sec; i++) {
+        sector_sz_sec = boot_img_sector_size(state, BOOT_SECONDARY_SLOT, i);
+        if (sector_sz_sec != sector_sz_pri) {
+            BOOT_LOG_WRN("Cannot upgrade: not same sector layout");
+            return 0;
+        }
+    }
+
+    if (first_trailer_idx(state, BOOT_SECONDARY_SLOT) !=
+            first_trailer_idx(state, BOOT_PRIMARY_SLOT) + 1) {
+        BOOT_LOG_DBG("Non-optimal sector distribution, slot0 has %d sectors "
+                     "but slot1 has %d, it should have one more",
+                     (int)num_sectors_pri, (int)num_sectors_sec);
+    }
+
+#ifdef MCUBOOT_SLOT0_EXPECTED_ERASE_SIZE
+    if (sector_sz_pri != MCUBOOT_SLOT0_EXPECTED_ERASE_SIZE) {
+        BOOT_LOG_DBG("Discrepancy, slot0 expected erase size: %d, actual: %d",
+                     MCUBOOT_SLOT0_EXPECTED_ERASE_SIZE, sector_sz_pri);
+    }
+#endif
+#ifdef MCUBOOT_SLOT1_EXPECTED_ERASE_SIZE
+    if (sector_sz_sec != MCUBOOT_SLOT1_EXPECTED_ERASE_SIZE) {
+        BOOT_LOG_DBG("Discrepancy, slot1 expected erase size: %d, actual: %d",
+                     MCUBOOT_SLOT1_EXPECTED_ERASE_SIZE, sector_sz_sec);
+    }
+#endif
+
+#if defined(MCUBOOT_SLOT0_EXPECTED_WRITE_SIZE) || defined(MCUBOOT_SLOT1_EXPECTED_WRITE_SIZE)
+    if (!swap_write_block_size_check(state)) {
+        BOOT_LOG_WRN("Cannot upgrade: slot write sizes are not compatible");
+        return 0;
+    }
+#endif
+
+    return 1;
+}
+
+#define BOOT_LOG_SWAP_STATE(area, state)                            \
+    BOOT_LOG_INF("%s: magic=%s, swap_type=0x%x, copy_done=0x%x, "   \
+                 "image_ok=0x%x",                                   \
+                 (area),                                            \
+                 ((state)->magic == BOOT_MAGIC_GOOD ? "good" :      \
+                  (state)->magic == BOOT_MAGIC_UNSET ? "unset" :    \
+                  "bad"),                                           \
+                 (state)->swap_type,                                \
+                 (state)->copy_done,                                \
+                 (state)->image_ok)
+
+int
+swap_status_source(struct boot_loader_state *state)
+{
+    struct boot_swap_state state_primary_slot;
+    struct boot_swap_state state_secondary_slot;
+    int rc;
+    uint8_t source;
+    uint8_t image_index;
+
+#if (BOOT_IMAGE_NUMBER == 1)
+    (void)state;
+#endif
+
+    image_index = BOOT_CURR_IMG(state);
+
+    rc = boot_read_swap_state_by_id(FLASH_AREA_IMAGE_PRIMARY(image_index),
+            &state_primary_slot);
+    assert(rc == 0);
+
+    BOOT_LOG_SWAP_STATE("Primary image", &state_primary_slot);
+
+    rc = boot_read_swap_state_by_id(FLASH_AREA_IMAGE_SECONDARY(image_index),
+            &state_secondary_slot);
+    assert(rc == 0);
+
+    BOOT_LOG_SWAP_STATE("Secondary image", &state_secondary_slot);
+
+    if (state_primary_slot.magic == BOOT_MAGIC_GOOD &&
+            state_primary_slot.copy_done == BOOT_FLAG_UNSET &&
+            state_secondary_slot.magic != BOOT_MAGIC_GOOD) {
+
+        source = BOOT_STATUS_SOURCE_PRIMARY_SLOT;
+
+        BOOT_LOG_INF("Boot source: primary slot");
+        return source;
+    }
+
+    BOOT_LOG_INF("Boot source: none");
+    return BOOT_STATUS_SOURCE_NONE;
+}
+
+/*
+ * Swaps the sector at idx - 1 of the primary slot with the image stored from
+ * the second sector of the secondary slot: P[idx - 1] goes to S[idx - 1], then
+ * S[idx] goes to P[idx - 1].
+ */
+static void
+boot_swap_sectors_forward(int idx, uint32_t sz, struct boot_loader_state *state,
+        struct boot_status *bs, const struct flash_area *fap_pri,
+        const struct flash_area *fap_sec)
+{
+    uint32_t pri_off;
+    uint32_t sec_off;
+    uint32_t sec_up_off;
+    int rc;
+
+    pri_off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, idx - 1);
+    sec_off = boot_img_sector_off(state, BOOT_SECONDARY_SLOT, idx - 1);
+    sec_up_off = boot_img_sector_off(state, BOOT_SECONDARY_SLOT, idx);
+
+    if (bs->state == BOOT_STATUS_STATE_0) {
+        rc = boot_erase_copy_region(state, fap_pri, fap_sec, pri_off, sec_off,
+                                    sz, sz);
+        assert(rc == 0);
+
+        rc = boot_write_status(state, bs);
+        bs->state = BOOT_STATUS_STATE_1;
+        BOOT_STATUS_ASSERT(rc == 0);
+    }
+
+    if (bs->state == BOOT_STATUS_STATE_1) {
+        rc = boot_erase_copy_region(state, fap_sec, fap_pri, sec_up_off,
+                                    pri_off, sz, sz);
+        assert(rc == 0);
+
+        rc = boot_write_status(state, bs);
+        bs->idx++;
+        bs->state = BOOT_STATUS_STATE_0;
+        BOOT_STATUS_ASSERT(rc == 0);
+    }
+}
+
+/*
+ * Swaps the sector at idx - 1 of the primary slot with the image stored from
+ * the start of the secondary slot: P[idx - 1] goes to S[idx], then S[idx - 1]
+ * goes to P[idx - 1]. Sectors are processed from the last one down.
+ */
+static void
+boot_swap_sectors_backward(int idx, uint32_t sz, struct boot_loader_state *state,
+        struct boot_status *bs, const struct flash_area *fap_pri,
+        const struct flash_area *fap_sec)
+{
+    uint32_t pri_off;
+    uint32_t sec_off;
+    uint32_t sec_up_off;
+    int rc;
+
+    pri_off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, idx - 1);
+    sec_off = boot_img_sector_off(state, BOOT_SECONDARY_SLOT, idx - 1);
+    sec_up_off = boot_img_sector_off(state, BOOT_SECONDARY_SLOT, idx);
+
+    if (bs->state == BOOT_STATUS_STATE_0) {
+        rc = boot_erase_copy_region(state, fap_pri, fap_sec, pri_off,
+                                    sec_up_off, sz, sz);
+        assert(rc == 0);
+
+        rc = boot_write_status(state, bs);
+        bs->state = BOOT_STATUS_STATE_1;
+        BOOT_STATUS_ASSERT(rc == 0);
+    }
+
+    if (bs->state == BOOT_STATUS_STATE_1) {
+        rc = boot_erase_copy_region(state, fap_sec, fap_pri, sec_off, pri_off,
+                                    sz, sz);
+        assert(rc == 0);
+
+        rc = boot_write_status(state, bs);
+        bs->idx++;
+        bs->state = BOOT_STATUS_STATE_0;
+        BOOT_STATUS_ASSERT(rc == 0);
+    }
+}
+
+/*
+ * When starting a revert the swap status exists in the primary slot, and
+ * the status in the secondary slot is erased. To start the swap, the status
+ * area in the primary slot must be re-initialized; if during the small
+ * window of time between re-initializing it and writing the first metadata
+ * a reset happens, the swap process is broken and cannot be resumed.
+ *
+ * This function handles the issue by making the revert look like a permanent
+ * upgrade (by initializing the secondary slot).
+ */
+static void
+fixup_revert(const struct boot_loader_state *state, struct boot_status *bs,
+        const struct flash_area *fap_sec)
+{
+    struct boot_swap_state swap_state;
+    int rc;
+
+#if (BOOT_IMAGE_NUMBER == 1)
+    (void)state;
+#endif
+
+    /* No fixup required */
+    if (bs->swap_type != BOOT_SWAP_TYPE_REVERT ||
+        !boot_status_is_reset(bs)) {
+        return;
+    }
+
+    rc = boot_read_swap_state(fap_sec, &swap_state);
+    assert(rc == 0);
+
+    BOOT_LOG_SWAP_STATE("Secondary image", &swap_state);
+
+    if (swap_state.magic == BOOT_MAGIC_UNSET) {
+        rc = swap_erase_trailer_sectors(state, fap_sec);
+        assert(rc == 0);
+
+        rc = boot_write_image_ok(fap_sec);
+        assert(rc == 0);
+
+        rc = boot_write_swap_size(fap_sec, bs->swap_size);
+        assert(rc == 0);
+
+        rc = boot_write_magic(fap_sec);
+        assert(rc == 0);
+    }
+}
+
+void
+swap_run(struct boot_loader_state *state, struct boot_status *bs,
+         uint32_t copy_size)
+{
+    uint32_t sector_sz;
+    uint32_t idx;
+    uint32_t last_idx;
+    uint32_t first_trailer_idx_pri;
+    uint32_t first_trailer_idx_sec;
+    uint8_t op;
+    const struct flash_area *fap_pri;
+    const struct flash_area *fap_sec;
+    int rc;
+
+    BOOT_LOG_INF("Starting swap using offset algorithm.");
+
+    fap_pri = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
+    fap_sec = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+
+    /*
+     * The direction of a new swap depends on where the image is stored in
+     * the secondary slot; once started it is known from the status entries.
+     */
+    op = bs->op;
+    if (boot_status_is_reset(bs) && boot_img_start_off(fap_sec) != 0) {
+        op = BOOT_STATUS_OP_SWAP;
+    }
+
+    last_idx = swap_sector_count(state, copy_size, op);
+    sector_sz = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, 0);
+
+    /*
+     * When starting a new swap upgrade, check that there is enough space:
+     * one more sector than the image is used in the secondary slot.
+     */
+    if (boot_status_is_reset(bs)) {
+        first_trailer_idx_pri = first_trailer_idx(state, BOOT_PRIMARY_SLOT);
+        first_trailer_idx_sec = first_trailer_idx(state, BOOT_SECONDARY_SLOT);
+
+        if (last_idx > first_trailer_idx_pri ||
+                last_idx >= first_trailer_idx_sec) {
+            BOOT_LOG_WRN("Not enough free space to run swap upgrade");
+            BOOT_LOG_WRN("required %d bytes but only %d are available",
+                         last_idx * sector_sz,
+                         (first_trailer_idx_pri < first_trailer_idx_sec - 1 ?
+                          first_trailer_idx_pri : first_trailer_idx_sec - 1) *
+                         sector_sz);
+            bs->swap_type = BOOT_SWAP_TYPE_NONE;
+            return;
+        }
+
+        fixup_revert(state, bs, fap_sec);
+
+        bs->op = op;
+        if (bs->source != BOOT_STATUS_SOURCE_PRIMARY_SLOT) {
+            rc = swap_erase_trailer_sectors(state, fap_pri);
+            assert(rc == 0);
+
+            rc = swap_status_init(state, fap_pri, bs);
+            assert(rc == 0);
+        }
+
+        rc = swap_erase_trailer_sectors(state, fap_sec);
+        assert(rc == 0);
+    }
+
+    boot_progress_start(state, last_idx, bs->idx - BOOT_STATUS_IDX_0);
+
+    if (bs->op == BOOT_STATUS_OP_SWAP) {
+        idx = 1;
+        while (idx <= last_idx) {
+            if (idx >= bs->idx) {
+                boot_phase_start(BOOT_PHASE_SWAP_STEP);
+                boot_swap_sectors_forward(idx, sector_sz, state, bs, fap_pri,
+                                          fap_sec);
+                boot_phase_stop(BOOT_PHASE_SWAP_STEP);
+                boot_progress_step(sector_sz);
+            }
+            idx++;
+        }
+
+        /*
+         * With a single sector image the header of the new image is left in
+         * the second sector of the secondary slot, where it would be taken
+         * for another upgrade.
+         */
+        if (last_idx == 1) {
+            rc = boot_erase_region(fap_sec,
+                    boot_img_sector_off(state, BOOT_SECONDARY_SLOT, 1),
+                    sector_sz);
+            assert(rc == 0);
+        }
+    } else {
+        idx = last_idx;
+        while (idx > 0) {
+            if (idx <= (last_idx - bs->idx + 1)) {
+                boot_phase_start(BOOT_PHASE_SWAP_STEP);
+                boot_swap_sectors_backward(idx, sector_sz, state, bs, fap_pri,
+                                           fap_sec);
+                boot_phase_stop(BOOT_PHASE_SWAP_STEP);
+                boot_progress_step(sector_sz);
+            }
+            idx--;
+        }
+    }
+}
+
+int app_max_size(struct boot_loader_state *state)
+{
+    uint32_t sector_sz_primary;
+    uint32_t sector_sz_secondary;
+    uint32_t sz_primary;
+    uint32_t sz_secondary;
+
+    sector_sz_primary = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, 0);
+    sector_sz_secondary = boot_img_sector_size(state, BOOT_SECONDARY_SLOT, 0);
+
+    /* Account for image flags and the offset sector of the secondary slot */
+    sz_primary = first_trailer_idx(state, BOOT_PRIMARY_SLOT) * sector_sz_primary;
+    sz_secondary = (first_trailer_idx(state, BOOT_SECONDARY_SLOT) - 1) *
+                   sector_sz_secondary;
+
+    return (sz_primary <= sz_secondary ? sz_primary : sz_secondary);
+}
+
+#endif
@@ -21,7 +21,8 @@
 
 #include "mcuboot_config/mcuboot_config.h"
 
-#if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE)
+#if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE) || \
+    defined(MCUBOOT_SWAP_USING_OFFSET) || defined(MCUBOOT_SWAP_USING_BANK)
 
 /**
  * Calculates the amount of space required to store the trailer, and erases
@@ -38,6 +39,25 @@ int swap_status_init(const struct boot_loader_state *state,
                      const struct flash_area *fap,
                      const struct boot_status *bs);
 
+#if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT)
+/* Status writes which failed during the swap, defined by the swap mode. */
+#if !defined(__BOOTSIM__)
+extern int boot_status_fails;
+#else
+extern __thread int boot_status_fails;
+#endif
+#endif
+
+#ifdef MCUBOOT_SWAP_STATUS_PARTITION
+/**
+ * Opens the swap status partition and gives the offset of the status log of
+ * the current image in it. The partition is split evenly between the images.
+ * The flash area must be closed by the caller.
+ */
+int swap_status_area_open(const struct boot_loader_state *state,
+                          const struct flash_area **fap, uint32_t *off);
+#endif
+
 /**
  * Tries to locate an interrupted swap status (metadata). If not metadata
  * was found returns BOOT_STATUS_SOURCE_NONE.
@@ -90,18 +110,45 @@ void swap_run(struct boot_loader_state *state,
               struct boot_status *bs,
               uint32_t copy_size);
 
+#ifdef MCUBOOT_SWAP_SKIP_UNCHANGED
+/**
+ * Checks whether a region of the destination already holds the bytes that
+ * a swap step would copy to it from the source, in which case the step's
+ * erase and copy can be skipped. Always false if the data is transformed on
+ * the way, i.e. for encrypted images, or if either region can not be read.
+ */
+bool swap_region_unchanged(struct boot_loader_state *state,
+                           const struct flash_area *fap_src, uint32_t off_src,
+                           const struct flash_area *fap_dst, uint32_t off_dst,
+                           uint32_t sz);
+#endif
+
 #if MCUBOOT_SWAP_USING_SCRATCH
 #define BOOT_SCRATCH_AREA(state) ((state)->scratch.area)
 
+#if defined(MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE) && (MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE > 0)
+/*
+ * Each swap step only uses a window of the scratch area, the steps using
+ * the windows in turn, so the size of a window is what a step can move.
+ */
+static inline size_t boot_scratch_area_size(const struct boot_loader_state *state)
+{
+    (void)state;
+
+    return MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE;
+}
+#else
 static inline size_t boot_scratch_area_size(const struct boot_loader_state *state)
 {
     return flash_area_get_size(BOOT_SCRATCH_AREA(state));
 }
 #endif
+#endif
 
-#endif /* defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE) */
+#endif /* defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE) || \
+          defined(MCUBOOT_SWAP_USING_OFFSET) || defined(MCUBOOT_SWAP_USING_BANK) */
 
-#if defined(MCUBOOT_SWAP_USING_MOVE)
+#if defined(MCUBOOT_SWAP_USING_MOVE) || defined(MCUBOOT_SWAP_USING_OFFSET)
 /**
  * Check if device write block sizes are as expected, function should emit an error if there is
  * a problem. If true is returned, the slots are marked as compatible, otherwise the slots are
@@ -112,7 +159,7 @@ static inline size_t boot_scratch_area_size(const struct boot_loader_state *stat
  * slot.
  */
 bool swap_write_block_size_check(struct boot_loader_state *state);
-#endif /* defined(MCUBOOT_SWAP_USING_MOVE) */
+#endif /* defined(MCUBOOT_SWAP_USING_MOVE) || defined(MCUBOOT_SWAP_USING_OFFSET) */
 
 /**
  * Returns the maximum size of an application that can be loaded to a slot.
@@ -30,13 +30,17 @@
 
 BOOT_LOG_MODULE_DECLARE(mcuboot);
 
-#if !defined(MCUBOOT_SWAP_USING_MOVE)
+#if !defined(MCUBOOT_SWAP_USING_MOVE) && !defined(MCUBOOT_SWAP_USING_OFFSET) && \
+    !defined(MCUBOOT_SWAP_USING_BANK)
 
 #if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT)
-/*
- * FIXME: this might have to be updated for threaded sim
- */
+/* Status writes which failed during the swap, each simulator thread
+ * counting its own. */
+#if !defined(__BOOTSIM__)
 int boot_status_fails = 0;
+#else
+__thread int boot_status_fails = 0;
+#endif
 #define BOOT_STATUS_ASSERT(x)                \
     do {                                     \
         if (!(x)) {                          \
@@ -47,7 +51,21 @@ int boot_status_fails = 0;
 #define BOOT_STATUS_ASSERT(x) ASSERT(x)
 #endif
 
+/* Size of the buffer used to read several status entries at once. */
+#ifndef BOOT_STATUS_READ_BUF_SZ
+#define BOOT_STATUS_READ_BUF_SZ 256
+#endif
+
+#if BOOT_STATUS_READ_BUF_SZ < BOOT_MAX_ALIGN
+#error "BOOT_STATUS_READ_BUF_SZ must be at least BOOT_MAX_ALIGN"
+#endif
+
 #if !defined(MCUBOOT_DIRECT_XIP) && !defined(MCUBOOT_RAM_LOAD)
+#ifdef MCUBOOT_SWAP_STATUS_MAX_ENTRIES
+static uint32_t find_swap_count(const struct boot_loader_state *state,
+                                uint32_t copy_size);
+#endif
+
 /**
  * Reads the status of a partially-completed swap, if any.  This is necessary
  * to recover in case the boot lodaer was reset in the middle of a swap
@@ -57,9 +75,14 @@ int
 swap_read_status_bytes(const struct flash_area *fap,
         struct boot_loader_state *state, struct boot_status *bs)
 {
+    uint8_t buf[BOOT_STATUS_READ_BUF_SZ];
     uint32_t off;
     uint8_t status;
+    uint8_t write_sz;
     int max_entries;
+    int buf_entries;
+    int buf_first;
+    int buf_end;
     int found;
     int found_idx;
     int invalid;
@@ -72,15 +95,31 @@ swap_read_status_bytes(const struct flash_area *fap,
         return BOOT_EBADARGS;
     }
 
+    /* The first byte of each entry is what tells whether it was written;
+     * as many entries as fit in the buffer are read at once.
+     */
+    write_sz = BOOT_STATUS_ELEM_SZ(state);
+    buf_entries = (int)((sizeof(buf) - 1) / write_sz) + 1;
+    buf_first = 0;
+    buf_end = 0;
+
     found = 0;
     found_idx = 0;
     invalid = 0;
     for (i = 0; i < max_entries; i++) {
-        rc = flash_area_read(fap, off + i * BOOT_WRITE_SZ(state),
-                &status, 1);
-        if (rc < 0) {
-            return BOOT_EFLASH;
+        if (i >= buf_end) {
+            buf_first = i;
+            buf_end = i + buf_entries;
+            if (buf_end > max_entries) {
+                buf_end = max_entries;
+            }
+            rc = flash_area_read(fap, off + buf_first * write_sz, buf,
+                                 (buf_end - 1 - buf_first) * write_sz + 1);
+            if (rc < 0) {
+                return BOOT_EFLASH;
+            }
         }
+        status = buf[(i - buf_first) * write_sz];
 
         if (bootutil_buffer_is_erased(fap, &status, 1)) {
             if (found && !found_idx) {
@@ -163,6 +202,13 @@ boot_slots_compatible(struct boot_loader_state *state)
     scratch_sz = boot_scratch_area_size(state);
 #endif
 
+#if defined(MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE) && (MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE > 0)
+    if (flash_area_get_size(BOOT_SCRATCH_AREA(state)) < scratch_sz) {
+        BOOT_LOG_WRN("Cannot upgrade: scratch window larger than scratch");
+        return 0;
+    }
+#endif
+
     /*
      * The following loop scans all sectors in a linear fashion, assuring that
      * for each possible sector in each slot, it is able to fit in the other
@@ -237,6 +283,16 @@ boot_slots_compatible(struct boot_loader_state *state)
     }
 #endif
 
+#ifdef MCUBOOT_SWAP_STATUS_MAX_ENTRIES
+    /* The status area only records as many steps as configured, which must
+     * be enough to swap the whole slot.
+     */
+    if (find_swap_count(state, primary_slot_sz) > BOOT_STATUS_MAX_ENTRIES) {
+        BOOT_LOG_WRN("Cannot upgrade: more swap steps than status entries");
+        return 0;
+    }
+#endif
+
     return 1;
 }
 
@@ -408,13 +464,58 @@ swap_status_source(struct boot_loader_state *state)
 }
 
 #ifndef MCUBOOT_OVERWRITE_ONLY
+/**
+ * Finds the sector of a slot that ends at the given offset.
+ *
+ * @param slot                  The slot whose sectors are searched.
+ * @param end                   The offset, from the start of the slot, right
+ *                                  after the sector.
+ *
+ * @return                      The index of the sector, or -1 if no sector of
+ *                                  the slot ends at this offset.
+ */
+static int
+boot_sector_ending_at(const struct boot_loader_state *state, int slot,
+                      uint32_t end)
+{
+    uint32_t sector_end;
+    int lo;
+    int hi;
+    int mid;
+
+    lo = 0;
+    hi = (int)boot_img_num_sectors(state, slot) - 1;
+    while (lo <= hi) {
+        mid = lo + (hi - lo) / 2;
+        sector_end = boot_img_sector_off(state, slot, mid) +
+                     boot_img_sector_size(state, slot, mid);
+        if (sector_end == end) {
+            return mid;
+        } else if (sector_end < end) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    return -1;
+}
+
 /**
  * Calculates the number of sectors the scratch area can contain.  A "last"
  * source sector is specified because images are copied backwards in flash
  * (final index to index number 0).
  *
+ * The sectors are taken in units that start and end on a sector boundary of
+ * both slots: a single sector when the slots have the same geometry, or e.g.
+ * one large sector of a slot and the small sectors of the other slot that it
+ * covers. As many units as the scratch area can hold are swapped in one step,
+ * which keeps every erase aligned on the sectors of both slots and the number
+ * of scratch round trips as low as it gets.
+ *
  * @param last_sector_idx       The index of the last source sector
- *                                  (inclusive).
+ *                                  (inclusive), which must end on a sector
+ *                                  boundary of the secondary slot.
  * @param out_first_sector_idx  The index of the first source sector
  *                                  (inclusive) gets written here.
  *
@@ -426,28 +527,54 @@ boot_copy_sz(const struct boot_loader_state *state, int last_sector_idx,
              int *out_first_sector_idx)
 {
     size_t scratch_sz;
-    uint32_t new_sz;
+    uint32_t primary_sz;
+    uint32_t secondary_sz;
     uint32_t sz;
     int i;
+    int j;
+    int unit_i;
+    int unit_j;
 
     sz = 0;
 
     scratch_sz = boot_scratch_area_size(state);
-    for (i = last_sector_idx; i >= 0; i--) {
-        new_sz = sz + boot_img_sector_size(state, BOOT_PRIMARY_SLOT, i);
-        /*
-         * The secondary slot is not being checked here, because
-         * `boot_slots_compatible` already provides assurance that the copy size
-         * will be compatible with the primary slot and scratch.
-         */
-        if (new_sz > scratch_sz) {
+    i = last_sector_idx;
+    j = boot_sector_ending_at(state, BOOT_SECONDARY_SLOT,
+                              boot_img_sector_off(state, BOOT_PRIMARY_SLOT, i) +
+                              boot_img_sector_size(state, BOOT_PRIMARY_SLOT, i));
+    /* `boot_slots_compatible` already provides assurance that the sectors of
+     * both slots line up at the end of every unit.
+     */
+    assert(j >= 0);
+
+    while (i >= 0 && j >= 0) {
+        unit_i = i;
+        unit_j = j;
+        primary_sz = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, unit_i);
+        secondary_sz = boot_img_sector_size(state, BOOT_SECONDARY_SLOT, unit_j);
+        while (primary_sz != secondary_sz) {
+            if (primary_sz < secondary_sz) {
+                assert(unit_i > 0);
+                primary_sz += boot_img_sector_size(state, BOOT_PRIMARY_SLOT,
+                                                   --unit_i);
+            } else {
+                assert(unit_j > 0);
+                secondary_sz += boot_img_sector_size(state, BOOT_SECONDARY_SLOT,
+                                                     --unit_j);
+            }
+        }
+
+        if (sz + primary_sz > scratch_sz) {
             break;
         }
-        sz = new_sz;
+        sz += primary_sz;
+        i = unit_i - 1;
+        j = unit_j - 1;
     }
 
-    /* i currently refers to a sector that doesn't fit or it is -1 because all
-     * sectors have been processed.  In both cases, exclude sector i.
+    /* i currently refers to the last sector of a unit that doesn't fit or it
+     * is -1 because all sectors have been processed.  In both cases, exclude
+     * sector i.
      */
     *out_first_sector_idx = i + 1;
     return sz;
@@ -464,42 +591,43 @@ boot_copy_sz(const struct boot_loader_state *state, int last_sector_idx,
 static int
 find_last_sector_idx(const struct boot_loader_state *state, uint32_t copy_size)
 {
-    int last_sector_idx;
+    size_t num_sectors_primary;
+    size_t num_sectors_secondary;
     uint32_t primary_slot_size;
     uint32_t secondary_slot_size;
+    size_t i;
+    size_t j;
 
+    num_sectors_primary = boot_img_num_sectors(state, BOOT_PRIMARY_SLOT);
+    num_sectors_secondary = boot_img_num_sectors(state, BOOT_SECONDARY_SLOT);
     primary_slot_size = 0;
     secondary_slot_size = 0;
-    last_sector_idx = 0;
+    i = 0;
+    j = 0;
 
     /*
      * Knowing the size of the largest image between both slots, here we
-     * find what is the last sector in the primary slot that needs swapping.
-     * Since we already know that both slots are compatible, the secondary
-     * slot's last sector is not really required after this check is finished.
+     * find what is the last sector in the primary slot that needs swapping:
+     * the one ending on the first sector boundary shared by both slots past
+     * the image. The sectors of each slot are walked with their own index,
+     * as the slots may have different sector sizes.
      */
-    while (1) {
-        if ((primary_slot_size < copy_size) ||
-            (primary_slot_size < secondary_slot_size)) {
-           primary_slot_size += boot_img_sector_size(state,
-                                                     BOOT_PRIMARY_SLOT,
-                                                     last_sector_idx);
-        }
-        if ((secondary_slot_size < copy_size) ||
-            (secondary_slot_size < primary_slot_size)) {
-           secondary_slot_size += boot_img_sector_size(state,
-                                                       BOOT_SECONDARY_SLOT,
-                                                       last_sector_idx);
-        }
-        if (primary_slot_size >= copy_size &&
-                secondary_slot_size >= copy_size &&
-                primary_slot_size == secondary_slot_size) {
+    do {
+        if (primary_slot_size <= secondary_slot_size &&
+            i < num_sectors_primary) {
+            primary_slot_size += boot_img_sector_size(state,
+                                                      BOOT_PRIMARY_SLOT, i++);
+        } else if (j < num_sectors_secondary) {
+            secondary_slot_size += boot_img_sector_size(state,
+                                                        BOOT_SECONDARY_SLOT,
+                                                        j++);
+        } else {
             break;
         }
-        last_sector_idx++;
-    }
+    } while (primary_slot_size != secondary_slot_size ||
+             primary_slot_size < copy_size);
 
-    return last_sector_idx;
+    return (int)i - 1;
 }
 
 /**
@@ -531,6 +659,32 @@ find_swap_count(const struct boot_loader_state *state, uint32_t copy_size)
     return swap_count;
 }
 
+/**
+ * Returns the offset in the scratch area at which a swap step keeps its
+ * data. With MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE, the steps of an upgrade use
+ * the windows of the scratch area in turn, so that the erases are spread
+ * across all of it rather than always hitting the same sectors.
+ *
+ * @param step                  The index of the step, from 0.
+ */
+static uint32_t
+swap_scratch_off(const struct boot_loader_state *state, uint32_t step)
+{
+#if defined(MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE) && (MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE > 0)
+    uint32_t windows;
+
+    windows = flash_area_get_size(BOOT_SCRATCH_AREA(state)) /
+              MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE;
+
+    return (step % windows) * MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE;
+#else
+    (void)state;
+    (void)step;
+
+    return 0;
+#endif
+}
+
 /**
  * Swaps the contents of two flash regions within the two image slots.
  *
@@ -554,6 +708,7 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
     uint32_t sector_sz;
     uint32_t img_off;
     uint32_t scratch_trailer_off;
+    uint32_t scratch_off;
     struct boot_swap_state swap_state;
     size_t last_sector;
     bool erase_scratch;
@@ -600,21 +755,26 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
 
     image_index = BOOT_CURR_IMG(state);
 
-    rc = flash_area_open(FLASH_AREA_IMAGE_PRIMARY(image_index),
-            &fap_primary_slot);
-    assert (rc == 0);
-
-    rc = flash_area_open(FLASH_AREA_IMAGE_SECONDARY(image_index),
-            &fap_secondary_slot);
-    assert (rc == 0);
-
-    rc = flash_area_open(FLASH_AREA_IMAGE_SCRATCH, &fap_scratch);
-    assert (rc == 0);
+    fap_primary_slot = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
+    fap_secondary_slot = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    fap_scratch = BOOT_SCRATCH_AREA(state);
+    scratch_off = swap_scratch_off(state, bs->idx - BOOT_STATUS_IDX_0);
 
     if (bs->state == BOOT_STATUS_STATE_0) {
-        BOOT_LOG_DBG("erasing scratch area");
-        rc = boot_erase_region(fap_scratch, 0, flash_area_get_size(fap_scratch));
-        assert(rc == 0);
+        if (bs->idx == BOOT_STATUS_IDX_0) {
+            BOOT_LOG_DBG("erasing scratch area");
+            rc = boot_erase_region(fap_scratch, 0,
+                                   flash_area_get_size(fap_scratch));
+            assert(rc == 0);
+        }
+        else {
+            /* Only the first step writes the scratch trailer, and leaves it
+             * erased: the other steps only need the data they use erased.
+             */
+            rc = boot_erase_region(fap_scratch, scratch_off,
+                                   boot_scratch_area_size(state));
+            assert(rc == 0);
+        }
 
         if (bs->idx == BOOT_STATUS_IDX_0) {
             /* Write a trailer to the scratch area, even if we don't need the
@@ -643,7 +803,7 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
         }
 
         rc = boot_copy_region(state, fap_secondary_slot, fap_scratch,
-                              img_off, 0, copy_sz);
+                              img_off, scratch_off, copy_sz);
         assert(rc == 0);
 
         rc = boot_write_status(state, bs);
@@ -652,12 +812,22 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
     }
 
     if (bs->state == BOOT_STATUS_STATE_1) {
-        rc = boot_erase_region(fap_secondary_slot, img_off, sz);
-        assert(rc == 0);
-
-        rc = boot_copy_region(state, fap_primary_slot, fap_secondary_slot,
-                              img_off, img_off, copy_sz);
-        assert(rc == 0);
+#ifdef MCUBOOT_SWAP_SKIP_UNCHANGED
+        /* Sectors that the upgrade did not change are already in place in
+         * both slots. The check is made again if the swap is resumed, so
+         * the status is unchanged. Sectors holding the trailer are always
+         * rewritten.
+         */
+        if (copy_sz != sz ||
+            !swap_region_unchanged(state, fap_primary_slot, img_off,
+                                   fap_secondary_slot, img_off, sz))
+#endif
+        {
+            rc = boot_erase_copy_region(state, fap_primary_slot,
+                                        fap_secondary_slot, img_off, img_off,
+                                        sz, copy_sz);
+            assert(rc == 0);
+        }
 
         if (bs->idx == BOOT_STATUS_IDX_0 && !bs->use_scratch) {
             /* If not all sectors of the slot are being swapped,
@@ -673,15 +843,19 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
     }
 
     if (bs->state == BOOT_STATUS_STATE_2) {
-        rc = boot_erase_region(fap_primary_slot, img_off, sz);
-        assert(rc == 0);
-
-        /* NOTE: If this is the final sector, we exclude the image trailer from
-         * this copy (copy_sz was truncated earlier).
-         */
-        rc = boot_copy_region(state, fap_scratch, fap_primary_slot,
-                              0, img_off, copy_sz);
-        assert(rc == 0);
+#ifdef MCUBOOT_SWAP_SKIP_UNCHANGED
+        if (copy_sz != sz ||
+            !swap_region_unchanged(state, fap_scratch, scratch_off,
+                                   fap_primary_slot, img_off, sz))
+#endif
+        {
+            /* NOTE: If this is the final sector, we exclude the image trailer
+             * from this copy (copy_sz was truncated earlier).
+             */
+            rc = boot_erase_copy_region(state, fap_scratch, fap_primary_slot,
+                                        scratch_off, img_off, sz, copy_sz);
+            assert(rc == 0);
+        }
 
         if (bs->use_scratch) {
             scratch_trailer_off = boot_status_off(fap_scratch);
@@ -689,7 +863,9 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
             /* copy current status that is being maintained in scratch */
             rc = boot_copy_region(state, fap_scratch, fap_primary_slot,
                         scratch_trailer_off, img_off + copy_sz,
-                        (BOOT_STATUS_STATE_COUNT - 1) * BOOT_WRITE_SZ(state));
+                        ALIGN_UP((BOOT_STATUS_STATE_COUNT - 1) *
+                                 BOOT_STATUS_ELEM_SZ(state),
+                                 BOOT_WRITE_SZ(state)));
             BOOT_STATUS_ASSERT(rc == 0);
 
             rc = boot_read_swap_state(fap_scratch, &swap_state);
@@ -700,22 +876,10 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
                 assert(rc == 0);
             }
 
-            if (swap_state.swap_type != BOOT_SWAP_TYPE_NONE) {
-                rc = boot_write_swap_info(fap_primary_slot,
-                        swap_state.swap_type, image_index);
-                assert(rc == 0);
-            }
-
-            rc = boot_write_swap_size(fap_primary_slot, bs->swap_size);
-            assert(rc == 0);
-
-#ifdef MCUBOOT_ENC_IMAGES
-            rc = boot_write_enc_key(fap_primary_slot, 0, bs);
+            rc = boot_write_swap_fields(fap_primary_slot,
+                    swap_state.swap_type, image_index, bs);
             assert(rc == 0);
 
-            rc = boot_write_enc_key(fap_primary_slot, 1, bs);
-            assert(rc == 0);
-#endif
             rc = boot_write_magic(fap_primary_slot);
             assert(rc == 0);
         }
@@ -738,10 +902,6 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
             assert(rc == 0);
         }
     }
-
-    flash_area_close(fap_primary_slot);
-    flash_area_close(fap_secondary_slot);
-    flash_area_close(fap_scratch);
 }
 
 void
@@ -752,16 +912,33 @@ swap_run(struct boot_loader_state *state, struct boot_status *bs,
     int first_sector_idx;
     int last_sector_idx;
     uint32_t swap_idx;
+    uint32_t swap_cnt;
 
     BOOT_LOG_INF("Starting swap using scratch algorithm.");
 
+    /* Each step moves as many sectors as the scratch can hold, and costs
+     * the same status writes and erases whatever their number.
+     */
+    swap_cnt = find_swap_count(state, copy_size);
+    BOOT_LOG_DBG("Swapping 0x%lx bytes in %lu steps of up to 0x%zx bytes",
+                 (unsigned long)copy_size, (unsigned long)swap_cnt,
+                 boot_scratch_area_size(state));
+    (void)swap_cnt;
+
+#ifdef MCUBOOT_UPGRADE_PROGRESS
+    boot_progress_start(state, swap_cnt, bs->idx - BOOT_STATUS_IDX_0);
+#endif
+
     last_sector_idx = find_last_sector_idx(state, copy_size);
 
     swap_idx = 0;
     while (last_sector_idx >= 0) {
         sz = boot_copy_sz(state, last_sector_idx, &first_sector_idx);
         if (swap_idx >= (bs->idx - BOOT_STATUS_IDX_0)) {
+            boot_phase_start(BOOT_PHASE_SWAP_STEP);
             boot_swap_sectors(first_sector_idx, sz, state, bs);
+            boot_phase_stop(BOOT_PHASE_SWAP_STEP);
+            boot_progress_step(sz);
         }
 
         last_sector_idx = first_sector_idx - 1;
@@ -854,19 +1031,11 @@ int app_max_size(struct boot_loader_state *state)
 #else
 int app_max_size(struct boot_loader_state *state)
 {
-    const struct flash_area *fap;
-    int fa_id;
-    int rc;
     uint32_t active_slot;
     int primary_sz, secondary_sz;
 
     active_slot = state->slot_usage[BOOT_CURR_IMG(state)].active_slot;
-
-    fa_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), active_slot);
-    rc = flash_area_open(fa_id, &fap);
-    assert(rc == 0);
-    primary_sz = flash_area_get_size(fap);
-    flash_area_close(fap);
+    primary_sz = flash_area_get_size(BOOT_IMG_AREA(state, active_slot));
 
     if (active_slot == BOOT_PRIMARY_SLOT) {
         active_slot = BOOT_SECONDARY_SLOT;
@@ -874,11 +1043,7 @@ int app_max_size(struct boot_loader_state *state)
         active_slot = BOOT_PRIMARY_SLOT;
     }
 
-    fa_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), active_slot);
-    rc = flash_area_open(fa_id, &fap);
-    assert(rc == 0);
-    secondary_sz = flash_area_get_size(fap);
-    flash_area_close(fap);
+    secondary_sz = flash_area_get_size(BOOT_IMG_AREA(state, active_slot));
 
     return (secondary_sz < primary_sz ? secondary_sz : primary_sz);
 }
@@ -894,7 +1059,7 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
     uint32_t swap_count;
     uint32_t swap_size;
 #endif
-    int area_id;
+    uint32_t hdr_off = 0;
     int hdr_slot;
     int rc = 0;
 
@@ -902,10 +1067,6 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
     (void)bs;
 #endif
 
-#if (BOOT_IMAGE_NUMBER == 1)
-    (void)state;
-#endif
-
     hdr_slot = slot;
 
 #ifdef MCUBOOT_SWAP_USING_SCRATCH
@@ -943,6 +1104,7 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
                  * scratch area.
                  */
                 hdr_slot = BOOT_NUM_SLOTS;
+                hdr_off = swap_scratch_off(state, swap_count - 1);
             } else if (slot == BOOT_PRIMARY_SLOT && bs->state >= BOOT_STATUS_STATE_2) {
                 /* After BOOT_STATUS_STATE_2, the primary image's header has been moved to the
                  * secondary slot.
@@ -953,19 +1115,15 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
     }
 
     if (hdr_slot == BOOT_NUM_SLOTS) {
-        area_id = FLASH_AREA_IMAGE_SCRATCH;
+        fap = BOOT_SCRATCH_AREA(state);
     } else {
-        area_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), hdr_slot);
+        fap = BOOT_IMG_AREA(state, hdr_slot);
     }
 #else
-    area_id = flash_area_id_from_multi_image_slot(BOOT_CURR_IMG(state), hdr_slot);
+    fap = BOOT_IMG_AREA(state, hdr_slot);
 #endif
 
-    rc = flash_area_open(area_id, &fap);
-    if (rc == 0) {
-        rc = flash_area_read(fap, 0, out_hdr, sizeof *out_hdr);
-        flash_area_close(fap);
-    }
+    rc = boot_read_hdr(fap, hdr_off, out_hdr);
 
     if (rc != 0) {
         rc = BOOT_EFLASH;
@@ -976,4 +1134,4 @@ done:
     return rc;
 }
 
-#endif /* !MCUBOOT_SWAP_USING_MOVE */
+#endif /* !MCUBOOT_SWAP_USING_MOVE && !MCUBOOT_SWAP_USING_OFFSET && !MCUBOOT_SWAP_USING_BANK */
@@ -18,11 +18,174 @@
  */
 
 #include <stddef.h>
+#include <string.h>
 
 #include "bootutil/bootutil.h"
 #include "bootutil/image.h"
 #include "bootutil_priv.h"
 
+#ifdef MCUBOOT_TLV_INDEX
+#ifdef MCUBOOT_RAM_LOAD
+#error "MCUBOOT_TLV_INDEX is not supported with MCUBOOT_RAM_LOAD"
+#endif
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+#error "MCUBOOT_TLV_INDEX is not supported with MCUBOOT_PARALLEL_VALIDATION"
+#endif
+
+#ifndef MCUBOOT_TLV_INDEX_MAX_ENTRIES
+#define MCUBOOT_TLV_INDEX_MAX_ENTRIES 16
+#endif
+
+/* Number of images whose TLVs are indexed, enough for both slots of the
+ * image being processed.
+ */
+#define BOOT_TLV_INDEX_NUM    2
+#define BOOT_TLV_INDEX_BUF_SZ 256
+
+struct bootutil_tlv_index_entry {
+    uint32_t off;   /* Offset of the TLV header in the flash area. */
+    uint16_t type;
+    uint16_t len;
+};
+
+/*
+ * Position of the TLVs of an image, gathered in a single pass over its TLV
+ * area so that the following lookups do not walk the TLVs in flash again.
+ * The index is only used for the exact header and TLV area it was built
+ * from, and is dropped when the flash area is erased.
+ */
+struct bootutil_tlv_index {
+    const struct flash_area *fap;
+    struct image_header hdr;
+    uint32_t prot_end;
+    uint32_t tlv_end;
+    uint16_t count;
+    bool valid;
+    struct bootutil_tlv_index_entry tlvs[MCUBOOT_TLV_INDEX_MAX_ENTRIES];
+};
+
+BOOT_CACHE_STATIC struct bootutil_tlv_index tlv_indexes[BOOT_TLV_INDEX_NUM];
+BOOT_CACHE_STATIC uint8_t tlv_index_next;
+
+/*
+ * Drop the TLV indexes of a flash area.
+ *
+ * @param fap flash_area whose indexes are dropped, NULL to drop all of them
+ */
+void
+bootutil_tlv_index_invalidate(const struct flash_area *fap)
+{
+    size_t i;
+
+    for (i = 0; i < BOOT_TLV_INDEX_NUM; i++) {
+        if (fap == NULL || tlv_indexes[i].fap == fap) {
+            tlv_indexes[i].valid = false;
+        }
+    }
+}
+
+static int
+bootutil_tlv_index_build(struct bootutil_tlv_index *idx,
+                         const struct image_header *hdr,
+                         const struct flash_area *fap, uint32_t off,
+                         uint32_t prot_end, uint32_t tlv_end)
+{
+    uint8_t buf[BOOT_TLV_INDEX_BUF_SZ];
+    uint32_t buf_off;
+    uint32_t buf_len;
+    struct image_tlv tlv;
+
+    /* The first window starts with the TLV info header rather than the first
+     * TLV, as images signed with "imgtool sign --layout-align" start their
+     * TLV area on an aligned boundary: TLV areas which fit in the buffer are
+     * then read in a single aligned transfer.
+     */
+    buf_off = off - sizeof(struct image_tlv_info);
+    buf_len = tlv_end - buf_off;
+    if (buf_len > sizeof(buf)) {
+        buf_len = sizeof(buf);
+    }
+    if (flash_area_read(fap, buf_off, buf, buf_len)) {
+        return -1;
+    }
+
+    idx->count = 0;
+    while (off < tlv_end) {
+        if (hdr->ih_protect_tlv_size > 0 && off == prot_end) {
+            off += sizeof(struct image_tlv_info);
+            continue;
+        }
+
+        /* The TLV area is read in windows, not one header at a time. */
+        if (off < buf_off || off + sizeof(tlv) > buf_off + buf_len) {
+            buf_off = off;
+            buf_len = tlv_end - off;
+            if (buf_len > sizeof(buf)) {
+                buf_len = sizeof(buf);
+            }
+            if (buf_len < sizeof(tlv)) {
+                return -1;
+            }
+            if (flash_area_read(fap, buf_off, buf, buf_len)) {
+                return -1;
+            }
+        }
+
+        if (idx->count == MCUBOOT_TLV_INDEX_MAX_ENTRIES) {
+            return -1;
+        }
+
+        memcpy(&tlv, &buf[off - buf_off], sizeof(tlv));
+        idx->tlvs[idx->count].off = off;
+        idx->tlvs[idx->count].type = tlv.it_type;
+        idx->tlvs[idx->count].len = tlv.it_len;
+        idx->count++;
+        off += sizeof(tlv) + tlv.it_len;
+    }
+
+    return 0;
+}
+
+/*
+ * Find the index of the TLVs of an image, building it if there is none.
+ *
+ * @returns the index, NULL if the TLVs can not be indexed
+ */
+static const struct bootutil_tlv_index *
+bootutil_tlv_index_get(const struct image_header *hdr,
+                       const struct flash_area *fap, uint32_t off,
+                       uint32_t prot_end, uint32_t tlv_end)
+{
+    struct bootutil_tlv_index *idx;
+    size_t i;
+
+    for (i = 0; i < BOOT_TLV_INDEX_NUM; i++) {
+        idx = &tlv_indexes[i];
+        if (idx->valid && idx->fap == fap && idx->prot_end == prot_end &&
+            idx->tlv_end == tlv_end &&
+            memcmp(&idx->hdr, hdr, sizeof(*hdr)) == 0) {
+            return idx;
+        }
+    }
+
+    idx = &tlv_indexes[tlv_index_next];
+    tlv_index_next = (tlv_index_next + 1) % BOOT_TLV_INDEX_NUM;
+
+    idx->valid = false;
+    if (bootutil_tlv_index_build(idx, hdr, fap, off, prot_end, tlv_end)) {
+        /* Too many TLVs, or an unreadable area: walk the TLVs in flash. */
+        return NULL;
+    }
+
+    idx->fap = fap;
+    memcpy(&idx->hdr, hdr, sizeof(*hdr));
+    idx->prot_end = prot_end;
+    idx->tlv_end = tlv_end;
+    idx->valid = true;
+    return idx;
+}
+#endif /* MCUBOOT_TLV_INDEX */
+
 /*
  * Initialize a TLV iterator.
  *
@@ -46,7 +209,8 @@ bootutil_tlv_iter_begin(struct image_tlv_iter *it, const struct image_header *hd
         return -1;
     }
 
-    off_ = BOOT_TLV_OFF(hdr);
+    /* The TLV offsets returned are relative to the start of the flash area. */
+    off_ = BOOT_IMG_START_OFF(fap) + BOOT_TLV_OFF(hdr);
     if (LOAD_IMAGE_DATA(hdr, fap, off_, &info, sizeof(info))) {
         return -1;
     }
@@ -76,6 +240,13 @@ bootutil_tlv_iter_begin(struct image_tlv_iter *it, const struct image_header *hd
     it->tlv_end = off_ + it->hdr->ih_protect_tlv_size + info.it_tlv_tot;
     // position on first TLV
     it->tlv_off = off_ + sizeof(info);
+#ifdef MCUBOOT_TLV_INDEX
+    it->index = bootutil_tlv_index_get(hdr, fap, it->tlv_off, it->prot_end,
+                                       it->tlv_end);
+#else
+    it->index = NULL;
+#endif
+    it->index_pos = 0;
     return 0;
 }
 
@@ -102,9 +273,39 @@ bootutil_tlv_iter_next(struct image_tlv_iter *it, uint32_t *off, uint16_t *len,
         return -1;
     }
 
+#ifdef MCUBOOT_TLV_INDEX
+    if (it->index != NULL) {
+        const struct bootutil_tlv_index_entry *e;
+
+        while (it->index_pos < it->index->count) {
+            e = &it->index->tlvs[it->index_pos++];
+
+            /* No more TLVs in the protected area */
+            if (it->prot && e->off >= it->prot_end) {
+                return 1;
+            }
+
+            it->tlv_off = e->off + sizeof(tlv) + e->len;
+            if (it->type == IMAGE_TLV_ANY || e->type == it->type) {
+                if (type != NULL) {
+                    *type = e->type;
+                }
+                *off = e->off + sizeof(tlv);
+                *len = e->len;
+                return 0;
+            }
+        }
+
+        it->tlv_off = it->tlv_end;
+        return 1;
+    }
+#endif
+
     while (it->tlv_off < it->tlv_end) {
         if (it->hdr->ih_protect_tlv_size > 0 && it->tlv_off == it->prot_end) {
+            /* The unprotected TLV area may be too short for any TLV. */
             it->tlv_off += sizeof(struct image_tlv_info);
+            continue;
         }
 
         rc = LOAD_IMAGE_DATA(it->hdr, it->fap, it->tlv_off, &tlv, sizeof tlv);
@@ -152,3 +353,96 @@ bootutil_tlv_iter_is_prot(struct image_tlv_iter *it, uint32_t off)
 
     return off < it->prot_end;
 }
+
+#ifdef MCUBOOT_SECTOR_DIGESTS
+/*
+ * Find the digest of the payload held by a sector of the slot, in the
+ * protected IMAGE_TLV_SECTOR_DIGESTS table. Sectors are counted from the
+ * start of the image, and the table holds an entry for each sector from the
+ * one holding the first payload byte to the one holding the last. The table
+ * is part of the protected TLVs, so it must only be relied upon once the
+ * image hash and signature have been verified.
+ *
+ * @param hdr image_header of the slot's image
+ * @param fap flash_area of the slot which is storing the image
+ * @param off Offset in the image of a byte of the sector
+ * @param digest Returns the digest of the sector
+ * @param digest_len Size of the digests of the image hash algorithm
+ * @param start Returns the offset in the image of the payload covered by the
+ *              digest
+ * @param len Returns the size of the payload covered by the digest
+ *
+ * @returns 0 if the digest was found
+ *          1 if the image has no table or the sector holds no payload
+ *          -1 on errors
+ */
+int
+bootutil_tlv_sector_digest(const struct image_header *hdr,
+                           const struct flash_area *fap, uint32_t off,
+                           uint8_t *digest, uint16_t digest_len,
+                           uint32_t *start, uint32_t *len)
+{
+    struct image_tlv_iter it;
+    uint32_t sector_sz;
+    uint32_t first;
+    uint32_t last;
+    uint32_t sector;
+    uint32_t end;
+    uint32_t tlv_off;
+    uint16_t tlv_len;
+    int rc;
+
+    if (digest == NULL || digest_len == 0 || start == NULL || len == NULL) {
+        return -1;
+    }
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_SECTOR_DIGESTS, true);
+    if (rc) {
+        return -1;
+    }
+
+    rc = bootutil_tlv_iter_next(&it, &tlv_off, &tlv_len, NULL);
+    if (rc) {
+        return rc;
+    }
+
+    if (tlv_len < sizeof(sector_sz) ||
+        LOAD_IMAGE_DATA(hdr, fap, tlv_off, &sector_sz, sizeof(sector_sz)) ||
+        sector_sz == 0) {
+        return -1;
+    }
+
+    end = hdr->ih_hdr_size + hdr->ih_img_size;
+    if (hdr->ih_img_size == 0) {
+        return (tlv_len == sizeof(sector_sz)) ? 1 : -1;
+    }
+
+    first = hdr->ih_hdr_size / sector_sz;
+    last = (end - 1) / sector_sz;
+    if ((tlv_len - sizeof(sector_sz)) % digest_len != 0 ||
+        (tlv_len - sizeof(sector_sz)) / digest_len != last - first + 1) {
+        return -1;
+    }
+
+    sector = off / sector_sz;
+    if (sector < first || sector > last) {
+        return 1;
+    }
+
+    *start = sector * sector_sz;
+    if (*start < hdr->ih_hdr_size) {
+        *start = hdr->ih_hdr_size;
+    }
+    *len = end - *start;
+    if (*len > (sector + 1) * sector_sz - *start) {
+        *len = (sector + 1) * sector_sz - *start;
+    }
+
+    tlv_off += sizeof(sector_sz) + (sector - first) * digest_len;
+    if (LOAD_IMAGE_DATA(hdr, fap, tlv_off, digest, digest_len)) {
+        return -1;
+    }
+
+    return 0;
+}
+#endif /* MCUBOOT_SECTOR_DIGESTS */
@@ -31,6 +31,7 @@ COMPILER ?= GCC_ARM
 
 USE_CRYPTO_HW ?= 0
 USE_EXTERNAL_FLASH ?= 0
+USE_EXTERNAL_FLASH_XIP ?= 0
 MCUBOOT_IMAGE_NUMBER ?= 1
 ENC_IMG ?= 0
 
@@ -57,6 +58,9 @@ DEFINES_APP += -DCORE=$(CORE)
 DEFINES_APP += -DMCUBOOT_IMAGE_NUMBER=$(MCUBOOT_IMAGE_NUMBER)
 ifeq ($(USE_EXTERNAL_FLASH), 1)
 DEFINES_APP += -DCY_BOOT_USE_EXTERNAL_FLASH
+ifeq ($(USE_EXTERNAL_FLASH_XIP), 1)
+DEFINES_APP += -DCY_BOOT_USE_SMIF_XIP
+endif
 endif
 DEFINES_APP += -DMCUBOOT_MAX_IMG_SECTORS=$(MAX_IMG_SECTORS)
 # Hardrware acceleration support
@@ -71,6 +71,43 @@
 
 #define PSOC6_FLASH_ERASE_BLOCK_SIZE	CY_FLASH_SIZEOF_ROW /* PSoC6 Flash erases by Row */
 
+#ifdef CY_BOOT_USE_SMIF_XIP
+/* SMIF is in memory-mapped (XIP) mode, rather than command mode */
+static bool psoc6_smif_xip_mode = false;
+
+/*
+ * Switches SMIF between XIP mode, used for reads, and command mode, needed
+ * for program and erase. The switch is only done when the mode changes, so
+ * read-only phases such as image validation or reading the copy source run
+ * entirely from the memory-mapped window.
+ */
+static int psoc6_smif_set_xip(bool enable)
+{
+    SMIF_Type *base = qspi_get_device();
+
+    if (psoc6_smif_xip_mode == enable) {
+        return 0;
+    }
+
+    if (Cy_SMIF_BusyCheck(base)) {
+        return -1;
+    }
+
+    if (enable) {
+        /* Drop any line cached before the memory was last modified */
+        if (Cy_SMIF_CacheInvalidate(base, CY_SMIF_CACHE_BOTH) != CY_SMIF_SUCCESS) {
+            return -1;
+        }
+        Cy_SMIF_SetMode(base, CY_SMIF_MEMORY);
+    } else {
+        Cy_SMIF_SetMode(base, CY_SMIF_NORMAL);
+    }
+
+    psoc6_smif_xip_mode = enable;
+    return 0;
+}
+#endif
+
 int psoc6_smif_read(const struct flash_area *fap,
                                         off_t addr,
                                         void *data,
@@ -81,6 +118,14 @@ int psoc6_smif_read(const struct flash_area *fap,
     cy_en_smif_status_t st;
     uint32_t address;
 
+#ifdef CY_BOOT_USE_SMIF_XIP
+    /* The flash area addresses are those of the memory-mapped window */
+    if (psoc6_smif_set_xip(true) == 0) {
+        memcpy(data, (const void *)addr, len);
+        return 0;
+    }
+#endif
+
     cfg = qspi_get_memory_config(FLASH_DEVICE_GET_EXT_INDEX(fap->fa_device_id));
 
     address = addr - CY_SMIF_BASE_MEM_OFFSET;
@@ -102,6 +147,12 @@ int psoc6_smif_write(const struct flash_area *fap,
     cy_stc_smif_mem_config_t *cfg;
     uint32_t address;
 
+#ifdef CY_BOOT_USE_SMIF_XIP
+    if (psoc6_smif_set_xip(false) != 0) {
+        return rc;
+    }
+#endif
+
     cfg =  qspi_get_memory_config(FLASH_DEVICE_GET_EXT_INDEX(fap->fa_device_id));
 
     address = addr - CY_SMIF_BASE_MEM_OFFSET;
@@ -127,6 +178,12 @@ int psoc6_smif_erase(off_t addr, size_t size)
      */
     cy_stc_smif_mem_config_t *memCfg = qspi_get_memory_config(0);
 
+#ifdef CY_BOOT_USE_SMIF_XIP
+    if (psoc6_smif_set_xip(false) != 0) {
+        return rc;
+    }
+#endif
+
     address = (addr - CY_SMIF_BASE_MEM_OFFSET ) & ~((uint32_t)(memCfg->deviceCfg->eraseSize - 1u));
 
     (void)size;
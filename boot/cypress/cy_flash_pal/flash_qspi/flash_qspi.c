@@ -197,8 +197,13 @@ static cy_stc_smif_mem_config_t mem_sfdp_0 =
     .baseAddress = 0x18000000U,
     /* The size allocated in the PSoC memory map, for the memory slave device.
     The size is allocated from the base address. Valid when the memory mapped mode is enabled. */
+#ifdef CY_BOOT_USE_SMIF_XIP
+    .memMappedSize = 0x4000000U,
+    .flags = CY_SMIF_FLAG_DETECT_SFDP | CY_SMIF_FLAG_MEMORY_MAPPED,
+#else
 /*    .memMappedSize = 0x4000000U, */
     .flags = CY_SMIF_FLAG_DETECT_SFDP,
+#endif
     .slaveSelect = CY_SMIF_SLAVE_SELECT_0,
     .dataSelect = CY_SMIF_DATA_SEL0,
     .deviceCfg = &dev_sfdp_0
@@ -9,3 +9,4 @@
 #include <stdint.h>
 
 void appcpu_start(uint32_t entry_addr);
+void appcpu_stop(void);
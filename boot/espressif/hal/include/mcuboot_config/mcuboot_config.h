@@ -86,6 +86,15 @@
  */
 #define MCUBOOT_VALIDATE_PRIMARY_SLOT
 
+/* Hash the primary slot of the second image on the APP CPU while the PRO CPU
+ * validates the first one. */
+#ifdef CONFIG_ESP_PARALLEL_VALIDATION
+#  if !defined(CONFIG_ESP_MULTI_PROCESSOR_BOOT)
+#    error "CONFIG_ESP_PARALLEL_VALIDATION requires CONFIG_ESP_MULTI_PROCESSOR_BOOT"
+#  endif
+#define MCUBOOT_PARALLEL_VALIDATION
+#endif
+
 #ifdef CONFIG_ESP_DOWNGRADE_PREVENTION
 #define MCUBOOT_DOWNGRADE_PREVENTION 1
 /* MCUBOOT_DOWNGRADE_PREVENTION_SECURITY_COUNTER is used later as bool value so it is
@@ -106,6 +115,11 @@
  * See the flash APIs for more details. */
 #define MCUBOOT_USE_FLASH_AREA_GET_SECTORS
 
+/* The flash map implements flash_area_mmap() with bootloader_mmap(), so
+ * images are hashed from the cache-mapped flash in 64 KiB windows instead
+ * of being copied to RAM 256 bytes at a time. */
+#define MCUBOOT_FLASH_AREA_MMAP
+
 /* Default maximum number of flash sectors per image slot; change
  * as desirable. */
 #define MCUBOOT_MAX_IMG_SECTORS 512
@@ -36,3 +36,14 @@ void appcpu_start(uint32_t entry_addr)
     uart_tx_wait_idle(0);
     ESP_LOGI(TAG, "APPCPU start sequence complete");
 }
+
+void appcpu_stop(void)
+{
+    esp_cpu_stall(1);
+
+    /* Keep the ROM from jumping to the previous entry once started again */
+    ets_set_appcpu_boot_addr(0);
+
+    DPORT_SET_PERI_REG_MASK(DPORT_APPCPU_CTRL_A_REG, DPORT_APPCPU_RESETTING);
+    DPORT_CLEAR_PERI_REG_MASK(DPORT_APPCPU_CTRL_B_REG, DPORT_APPCPU_CLKGATE_EN);
+}
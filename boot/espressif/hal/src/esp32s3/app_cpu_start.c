@@ -40,3 +40,15 @@ void appcpu_start(uint32_t entry_addr)
     uart_tx_wait_idle(0);
     ESP_LOGI(TAG, "APPCPU start sequence complete");
 }
+
+void appcpu_stop(void)
+{
+    esp_cpu_stall(1);
+
+    /* Keep the ROM from jumping to the previous entry once started again */
+    ets_set_appcpu_boot_addr(0);
+
+    /* With the clock gated, appcpu_start() resets the APP CPU again */
+    REG_SET_BIT(SYSTEM_CORE_1_CONTROL_0_REG, SYSTEM_CONTROL_CORE_1_RESETING);
+    REG_CLR_BIT(SYSTEM_CORE_1_CONTROL_0_REG, SYSTEM_CONTROL_CORE_1_CLKGATE_EN);
+}
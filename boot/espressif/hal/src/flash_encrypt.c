@@ -22,6 +22,7 @@
 #endif
 
 #include "esp_mcuboot_image.h"
+#include "bootutil/image.h"
 
 #if CONFIG_IDF_TARGET_ESP32
 #define CRYPT_CNT ESP_EFUSE_FLASH_CRYPT_CNT
@@ -33,6 +34,9 @@
 
 #define FLASH_ENC_CNT_MAX (CRYPT_CNT[0]->bit_count)
 
+/* Number of sectors of the primary slot read, erased and written at once */
+#define ENCRYPT_SLOT_RUN_SECTORS 4
+
 /* This file implements FLASH ENCRYPTION related APIs to perform
  * various operations such as programming necessary flash encryption
  * eFuses, detect whether flash encryption is enabled (by reading eFuse)
@@ -46,6 +50,10 @@ static esp_err_t encrypt_bootloader(void);
 static esp_err_t encrypt_primary_slot(void);
 static size_t get_flash_encrypt_cnt_value(void);
 
+#ifdef CONFIG_SECURE_BOOT_V2_ENABLED
+extern bool esp_secure_boot_bootloader_verified(void);
+#endif
+
 /**
  * This former inlined function must not be defined in the header file anymore.
  * As it depends on efuse component, any use of it outside of `bootloader_support`,
@@ -377,8 +385,20 @@ static esp_err_t encrypt_bootloader(void)
 {
     esp_err_t err;
     uint32_t image_length;
+    bool plaintext = false;
+
+#ifdef CONFIG_SECURE_BOOT_V2_ENABLED
+    /* Secure boot has verified the bootloader as read from flash in this
+     * boot, so it is valid and in plaintext: do not hash it once more.
+     */
+    plaintext = esp_secure_boot_bootloader_verified();
+#endif
     /* Check for plaintext bootloader (verification will fail if it's already encrypted) */
-    if (esp_image_verify_bootloader(&image_length) == ESP_OK) {
+    if (!plaintext) {
+        plaintext = (esp_image_verify_bootloader(&image_length) == ESP_OK);
+    }
+
+    if (plaintext) {
         ESP_LOGI(TAG, "Encrypting bootloader...");
 
         err = esp_flash_encrypt_region(ESP_BOOTLOADER_OFFSET, CONFIG_ESP_BOOTLOADER_SIZE);
@@ -410,6 +430,108 @@ static esp_err_t verify_img_header(uint32_t addr, const esp_image_load_header_t
     return err;
 }
 
+/* Returns the size of the part of a slot used by the MCUboot image it holds,
+ * in plaintext: header, image and TLVs, rounded up to a whole sector. The
+ * whole slot is used if the image size can not be found.
+ */
+static uint32_t slot_used_size(uint32_t slot_addr, uint32_t slot_size)
+{
+    struct image_header hdr;
+    struct image_tlv_info info;
+    uint32_t off;
+
+    if (bootloader_flash_read(slot_addr, &hdr, sizeof(hdr), true) != ESP_OK ||
+        hdr.ih_magic != IMAGE_MAGIC) {
+        return slot_size;
+    }
+
+    off = (uint32_t)hdr.ih_hdr_size + hdr.ih_img_size + hdr.ih_protect_tlv_size;
+    if (off > slot_size - sizeof(info) ||
+        bootloader_flash_read(slot_addr + off, &info, sizeof(info), true) != ESP_OK ||
+        info.it_magic != IMAGE_TLV_INFO_MAGIC ||
+        info.it_tlv_tot > slot_size - off) {
+        return slot_size;
+    }
+    off += info.it_tlv_tot;
+
+    off = (off + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
+
+    return (off < slot_size) ? off : slot_size;
+}
+
+static bool sector_is_erased(const uint32_t *sector)
+{
+    for (size_t i = 0; i < FLASH_SECTOR_SIZE / sizeof(uint32_t); i++) {
+        if (sector[i] != 0xffffffff) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Encrypts a slot in place like esp_flash_encrypt_region() does, but with
+ * a single erase and write for each run of sectors. The sectors holding the
+ * image are always encrypted; past the image, the erased sectors are left
+ * as they are, as MCUboot leaves the sectors it erases.
+ */
+static esp_err_t encrypt_slot(uint32_t slot_addr, uint32_t slot_size)
+{
+    static uint32_t buf[ENCRYPT_SLOT_RUN_SECTORS * FLASH_SECTOR_SIZE / sizeof(uint32_t)];
+    wdt_hal_context_t rtc_wdt_ctx = RWDT_HAL_CONTEXT_DEFAULT();
+    uint32_t used_size;
+    uint32_t run_start = 0;
+    uint32_t run_len = 0;
+    esp_err_t err;
+
+    used_size = slot_used_size(slot_addr, slot_size);
+    ESP_LOGI(TAG, "Image uses 0x%x bytes of the slot", used_size);
+
+    for (uint32_t off = 0; off <= slot_size; off += FLASH_SECTOR_SIZE) {
+        bool encrypt = false;
+
+        if (off < slot_size) {
+            uint32_t *sector = &buf[run_len / sizeof(uint32_t)];
+
+            err = bootloader_flash_read(slot_addr + off, sector, FLASH_SECTOR_SIZE, true);
+            if (err != ESP_OK) {
+                goto flash_failed;
+            }
+            encrypt = (off < used_size || !sector_is_erased(sector));
+        }
+
+        if (encrypt) {
+            if (run_len == 0) {
+                run_start = off;
+            }
+            run_len += FLASH_SECTOR_SIZE;
+        }
+
+        /* Write back the run once it ends or fills the buffer */
+        if (run_len > 0 && (!encrypt || run_len == sizeof(buf))) {
+            wdt_hal_write_protect_disable(&rtc_wdt_ctx);
+            wdt_hal_feed(&rtc_wdt_ctx);
+            wdt_hal_write_protect_enable(&rtc_wdt_ctx);
+
+            err = bootloader_flash_erase_range(slot_addr + run_start, run_len);
+            if (err != ESP_OK) {
+                goto flash_failed;
+            }
+            err = bootloader_flash_write(slot_addr + run_start, buf, run_len, true);
+            if (err != ESP_OK) {
+                goto flash_failed;
+            }
+            run_len = 0;
+        }
+    }
+
+    return ESP_OK;
+
+flash_failed:
+    ESP_LOGE(TAG, "flash operation failed: 0x%x", err);
+    return err;
+}
+
 static esp_err_t encrypt_primary_slot(void)
 {
     esp_err_t err;
@@ -432,8 +554,8 @@ static esp_err_t encrypt_primary_slot(void)
     if (err == ESP_OK) {
         ESP_LOGI(TAG, "Encrypting primary slot...");
 
-        err = esp_flash_encrypt_region(CONFIG_ESP_IMAGE0_PRIMARY_START_ADDRESS,
-                                       CONFIG_ESP_APPLICATION_SIZE);
+        err = encrypt_slot(CONFIG_ESP_IMAGE0_PRIMARY_START_ADDRESS,
+                           CONFIG_ESP_APPLICATION_SIZE);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "Failed to encrypt slot in place: 0x%x", err);
             return err;
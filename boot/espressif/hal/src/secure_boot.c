@@ -26,6 +26,28 @@
 #define ALIGN_UP(num, align) (((num) + ((align) - 1)) & ~((align) - 1))
 static const char *TAG = "secure_boot_v2";
 
+/* Set once the bootloader image has been verified in this boot. */
+static bool s_bootloader_verified;
+
+/* Tells whether the bootloader image in flash has already been verified in
+ * this boot, either by the ROM, which checks its signature when secure boot
+ * is enabled, or by check_and_generate_secure_boot_keys(). It was read from
+ * flash as is, so it is known to be valid and in plaintext, and need not be
+ * hashed again.
+ */
+bool esp_secure_boot_bootloader_verified(void)
+{
+#ifndef CONFIG_EFUSE_VIRTUAL
+    /* Secure boot is only enabled during a boot after the bootloader was
+     * verified, otherwise the ROM verified it.
+     */
+    if (esp_secure_boot_enabled()) {
+        return true;
+    }
+#endif
+    return s_bootloader_verified;
+}
+
 /* A signature block is valid when it has correct magic byte, crc and image digest. */
 static esp_err_t validate_signature_block(const ets_secure_boot_sig_block_t *block, int block_num, const uint8_t *image_digest)
 {
@@ -166,6 +188,7 @@ esp_err_t check_and_generate_secure_boot_keys(void)
         ESP_LOGE(TAG, "bootloader image appears invalid! error %d", ret);
         return ret;
     }
+    s_bootloader_verified = true;
 
     /* Initialize all efuse block entries to invalid (max) value */
     esp_efuse_block_t blocks[SECURE_BOOT_NUM_BLOCKS] = {[0 ... SECURE_BOOT_NUM_BLOCKS-1] = EFUSE_BLK_KEY_MAX};
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef MCUBOOT_PARALLEL_VALIDATION
+/* Whether a job of bootutil/boot_parallel.h runs on the APP CPU */
+bool esp_parallel_busy(void);
+
+/* Serializes flash accesses between the PRO and APP CPUs */
+void esp_parallel_flash_lock(void);
+void esp_parallel_flash_unlock(void);
+#else
+static inline bool esp_parallel_busy(void)
+{
+    return false;
+}
+
+static inline void esp_parallel_flash_lock(void)
+{
+}
+
+static inline void esp_parallel_flash_unlock(void)
+{
+}
+#endif
@@ -77,6 +77,13 @@ uint8_t flash_area_erased_val(const struct flash_area *area);
 int flash_area_get_sectors(int fa_id, uint32_t *count,
                            struct flash_sector *sectors);
 
+//! Maps `len` bytes of flash memory at `off` through the cache, storing
+//! their address in `ptr`; only one region is mapped at a time
+int flash_area_mmap(const struct flash_area *fa, uint32_t off, uint32_t len,
+                    const void **ptr);
+//! Releases the region mapped by flash_area_mmap()
+void flash_area_munmap(const struct flash_area *fa, const void *ptr);
+
 //! Retrieve the flash sector a given offset belongs to.
 int flash_area_sector_from_off(uint32_t off, struct flash_sector *sector);
 
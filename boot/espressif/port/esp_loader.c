@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdbool.h>
 #include <string.h>
 
 #include <bootutil/bootutil_log.h>
@@ -23,6 +24,14 @@
 #include "app_cpu_start.h"
 #endif
 
+#ifndef MIN
+#  define MIN(a, b)                 (((a) < (b)) ? (a) : (b))
+#endif
+
+#ifndef MAX
+#  define MAX(a, b)                 (((a) > (b)) ? (a) : (b))
+#endif
+
 static int load_segment(const struct flash_area *fap, uint32_t data_addr, uint32_t data_len, uint32_t load_addr)
 {
     const uint32_t *data = (const uint32_t *)bootloader_mmap((fap->fa_off + data_addr), data_len);
@@ -35,6 +44,38 @@ static int load_segment(const struct flash_area *fap, uint32_t data_addr, uint32
     return 0;
 }
 
+/* Loads both segments from a single mapping covering them, instead of
+ * remapping the MMU for each of them; returns false if the free MMU pages
+ * can not hold that mapping, in which case nothing was loaded.
+ */
+static bool load_segments(const struct flash_area *fap, const esp_image_load_header_t *load_header)
+{
+    const uint32_t iram_end = load_header->iram_flash_offset + load_header->iram_size;
+    const uint32_t dram_end = load_header->dram_flash_offset + load_header->dram_size;
+
+    if (iram_end < load_header->iram_flash_offset || dram_end < load_header->dram_flash_offset) {
+        return false;
+    }
+
+    const uint32_t start = MIN(load_header->iram_flash_offset, load_header->dram_flash_offset);
+    const uint32_t end = MAX(iram_end, dram_end);
+    const uint32_t page_start = (fap->fa_off + start) & ~(CONFIG_MMU_PAGE_SIZE - 1);
+    const uint32_t pages = (fap->fa_off + end - page_start + CONFIG_MMU_PAGE_SIZE - 1) / CONFIG_MMU_PAGE_SIZE;
+
+    if (pages > bootloader_mmap_get_free_pages()) {
+        return false;
+    }
+
+    const uint8_t *data = (const uint8_t *)bootloader_mmap((fap->fa_off + start), end - start);
+    if (!data) {
+        return false;
+    }
+    memcpy((void *)load_header->dram_dest_addr, &data[load_header->dram_flash_offset - start], load_header->dram_size);
+    memcpy((void *)load_header->iram_dest_addr, &data[load_header->iram_flash_offset - start], load_header->iram_size);
+    bootloader_munmap(data);
+    return true;
+}
+
 void esp_app_image_load(int image_index, int slot, unsigned int hdr_offset, unsigned int *entry_addr)
 {
     const struct flash_area *fap;
@@ -75,10 +116,11 @@ void esp_app_image_load(int image_index, int slot, unsigned int hdr_offset, unsi
     }
 
     BOOT_LOG_INF("DRAM segment: start=0x%x, size=0x%x, vaddr=0x%x", fap->fa_off + load_header.dram_flash_offset, load_header.dram_size, load_header.dram_dest_addr);
-    load_segment(fap, load_header.dram_flash_offset, load_header.dram_size, load_header.dram_dest_addr);
-
     BOOT_LOG_INF("IRAM segment: start=0x%x, size=0x%x, vaddr=0x%x", fap->fa_off + load_header.iram_flash_offset, load_header.iram_size, load_header.iram_dest_addr);
-    load_segment(fap, load_header.iram_flash_offset, load_header.iram_size, load_header.iram_dest_addr);
+    if (!load_segments(fap, &load_header)) {
+        load_segment(fap, load_header.dram_flash_offset, load_header.dram_size, load_header.dram_dest_addr);
+        load_segment(fap, load_header.iram_flash_offset, load_header.iram_size, load_header.iram_dest_addr);
+    }
 
     BOOT_LOG_INF("start=0x%x", load_header.entry_addr);
     uart_tx_wait_idle(0);
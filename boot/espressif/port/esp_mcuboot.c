@@ -18,6 +18,7 @@
 
 #include "flash_map_backend/flash_map_backend.h"
 #include "sysflash/sysflash.h"
+#include "esp_parallel.h"
 
 #ifndef ARRAY_SIZE
 #  define ARRAY_SIZE(arr)           (sizeof(arr) / sizeof((arr)[0]))
@@ -200,7 +201,9 @@ int flash_area_read(const struct flash_area *fa, uint32_t off, void *dst,
         return -1;
     }
 
+    esp_parallel_flash_lock();
     bool success = aligned_flash_read(fa->fa_off + off, dst, len);
+    esp_parallel_flash_unlock();
     if (!success) {
         BOOT_LOG_ERR("%s: Flash read failed", __func__);
 
@@ -210,6 +213,39 @@ int flash_area_read(const struct flash_area *fa, uint32_t off, void *dst,
     return 0;
 }
 
+#ifdef MCUBOOT_FLASH_AREA_MMAP
+int flash_area_mmap(const struct flash_area *fa, uint32_t off, uint32_t len,
+                    const void **ptr)
+{
+    if (fa->fa_device_id != FLASH_DEVICE_INTERNAL_FLASH) {
+        return -1;
+    }
+
+    if (off > fa->fa_size || len > fa->fa_size - off) {
+        BOOT_LOG_ERR("%s: Out of Bounds (0x%x vs 0x%x)", __func__, off + len, fa->fa_size);
+        return -1;
+    }
+
+    if (esp_parallel_busy()) {
+        /* Only the PRO CPU sees the mapping, and the SPI reads of the APP CPU
+         * would disable the cache under it.
+         */
+        return -1;
+    }
+
+    /* Reads through the cache are decrypted when flash encryption is on */
+    *ptr = bootloader_mmap(fa->fa_off + off, len);
+    return *ptr != NULL ? 0 : -1;
+}
+
+void flash_area_munmap(const struct flash_area *fa, const void *ptr)
+{
+    (void)fa;
+
+    bootloader_munmap(ptr);
+}
+#endif
+
 static bool aligned_flash_write(size_t dest_addr, const void *src, size_t size)
 {
 #ifdef CONFIG_SECURE_FLASH_ENC_ENABLED
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <bootutil/boot_parallel.h>
+
+#include "sdkconfig.h"
+#include "esp_cpu.h"
+#include "esp_flash_encrypt.h"
+
+#include "app_cpu_start.h"
+#include "esp_parallel.h"
+
+/* The validation job of bootutil runs on the APP CPU, on the stack the ROM
+ * sets up for it, before the APP CPU is reset and started again with the
+ * second image. Both CPUs then read flash through flash_area_read(), which
+ * takes the lock below, and hash the data they read at the same time.
+ */
+
+static volatile uint32_t s_flash_lock;
+static volatile bool s_busy;
+static volatile bool s_done;
+static boot_parallel_job_t s_job;
+static void *s_arg;
+
+bool esp_parallel_busy(void)
+{
+    return s_busy;
+}
+
+void esp_parallel_flash_lock(void)
+{
+    while (!esp_cpu_compare_and_set(&s_flash_lock, 0, 1)) {
+    }
+}
+
+void esp_parallel_flash_unlock(void)
+{
+    esp_cpu_compare_and_set(&s_flash_lock, 1, 0);
+}
+
+static void appcpu_job_entry(void)
+{
+    s_job(s_arg);
+    s_done = true;
+
+    /* Stalled and reset by boot_parallel_join() */
+    while (true) {
+    }
+}
+
+int boot_parallel_start(boot_parallel_job_t job, void *arg)
+{
+#if defined(CONFIG_IDF_TARGET_ESP32) && defined(CONFIG_SECURE_FLASH_ENC_ENABLED)
+    /* Decrypted reads go through the cache of the PRO CPU, which the APP CPU
+     * of the ESP32 does not share.
+     */
+    if (esp_flash_encryption_enabled()) {
+        return -1;
+    }
+#endif
+
+    s_job = job;
+    s_arg = arg;
+    s_done = false;
+    s_busy = true;
+    appcpu_start((uint32_t)appcpu_job_entry);
+
+    return 0;
+}
+
+int boot_parallel_join(void)
+{
+    while (!s_done) {
+        MCUBOOT_WATCHDOG_FEED();
+    }
+
+    appcpu_stop();
+    s_busy = false;
+
+    return 0;
+}
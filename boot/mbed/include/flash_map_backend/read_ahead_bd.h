@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MCUBOOT_BOOT_MBED_INCLUDE_FLASH_MAP_BACKEND_READ_AHEAD_BD_H_
+#define MCUBOOT_BOOT_MBED_INCLUDE_FLASH_MAP_BACKEND_READ_AHEAD_BD_H_
+
+#include "blockdevice/BlockDevice.h"
+
+/**
+ * Block device that reads ahead from an underlying block device.
+ *
+ * Reads smaller than the cache are served from a single cached block,
+ * which is filled with one read of the underlying device, aligned to the
+ * cache size. This turns the many small reads done while hashing and
+ * copying an image into a few large transactions, which matters on
+ * storage with a high per-transaction latency such as SPI flash or SD
+ * cards. Reads at least as large as the cache go directly to the
+ * underlying device.
+ *
+ * Programs and erases are written through to the underlying device and
+ * invalidate the cached block if they overlap it.
+ */
+class ReadAheadBlockDevice : public mbed::BlockDevice {
+public:
+    /**
+     * @param bd       Underlying block device
+     * @param buffer   Cache buffer, used for the lifetime of the object
+     * @param size     Size of the cache buffer, a multiple of the read size
+     *                 of the underlying device, ideally its erase size
+     */
+    ReadAheadBlockDevice(mbed::BlockDevice* bd, uint8_t* buffer, bd_size_t size);
+
+    int init() override;
+    int deinit() override;
+    int sync() override;
+    int read(void* buffer, bd_addr_t addr, bd_size_t size) override;
+    int program(const void* buffer, bd_addr_t addr, bd_size_t size) override;
+    int erase(bd_addr_t addr, bd_size_t size) override;
+    int trim(bd_addr_t addr, bd_size_t size) override;
+    bd_size_t get_read_size() const override;
+    bd_size_t get_program_size() const override;
+    bd_size_t get_erase_size() const override;
+    bd_size_t get_erase_size(bd_addr_t addr) const override;
+    int get_erase_value() const override;
+    bd_size_t size() const override;
+    const char* get_type() const override;
+
+private:
+    void invalidate(bd_addr_t addr, bd_size_t size);
+
+    mbed::BlockDevice* _bd;
+    uint8_t* _buffer;
+    bd_size_t _buffer_size;
+    bd_addr_t _cache_addr;
+    bd_size_t _cache_size;      /** Valid bytes in the cache, 0 when empty */
+};
+
+#endif /* MCUBOOT_BOOT_MBED_INCLUDE_FLASH_MAP_BACKEND_READ_AHEAD_BD_H_ */
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include "bootutil/bootutil.h"
 #include "bootutil/image.h"
+#include "bootutil/flash_stats.h"
 #include "hal/serial_api.h"
 #include "platform/mbed_application.h"
 
@@ -78,6 +79,10 @@ int main()
         exit(rc);
     }
 
+#ifdef MCUBOOT_FLASH_STATS
+    flash_stats_log();
+#endif
+
     uint32_t address = rsp.br_image_off + rsp.br_hdr->ih_hdr_size;
 
     // Workaround: The extra \n ensures the last trace gets flushed
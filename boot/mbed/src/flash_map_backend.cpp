@@ -20,6 +20,7 @@
 #include <cstring>
 #include "flash_map_backend/flash_map_backend.h"
 #include "flash_map_backend/secondary_bd.h"
+#include "flash_map_backend/read_ahead_bd.h"
 #include "sysflash/sysflash.h"
 
 #include "blockdevice/BlockDevice.h"
@@ -27,6 +28,11 @@
 
 #include "mcuboot_config/mcuboot_logging.h"
 
+#ifdef MCUBOOT_FLASH_STATS
+#include "hal/us_ticker_api.h"
+#include "bootutil/flash_stats.h"
+#endif
+
 #include "bootutil_priv.h"
 
 #define FLASH_DEVICE_INTERNAL_FLASH 0
@@ -35,6 +41,13 @@
 /** Application defined secondary block device */
 mbed::BlockDevice* mcuboot_secondary_bd = get_secondary_bd();
 
+#if MCUBOOT_SECONDARY_READ_CACHE
+/** Read-ahead cache in front of the secondary block device */
+static uint8_t mcuboot_secondary_cache[MCUBOOT_SECONDARY_READ_CACHE];
+static ReadAheadBlockDevice mcuboot_secondary_cache_bd(mcuboot_secondary_bd,
+        mcuboot_secondary_cache, sizeof(mcuboot_secondary_cache));
+#endif
+
 /** Internal application block device */
 static FlashIAPBlockDevice mcuboot_primary_bd(MCUBOOT_PRIMARY_SLOT_START_ADDR, MCUBOOT_SLOT_SIZE);
 
@@ -45,7 +58,11 @@ static FlashIAPBlockDevice mcuboot_scratch_bd(MCUBOOT_SCRATCH_START_ADDR, MCUBOO
 
 static mbed::BlockDevice* flash_map_bd[FLASH_AREAS] = {
         (mbed::BlockDevice*) &mcuboot_primary_bd,       /** Primary (loadable) image area */
+#if MCUBOOT_SECONDARY_READ_CACHE
+        (mbed::BlockDevice*) &mcuboot_secondary_cache_bd, /** Secondary (update candidate) image area */
+#else
         mcuboot_secondary_bd,                           /** Secondary (update candidate) image area */
+#endif
 #if MCUBOOT_SWAP_USING_SCRATCH
         (mbed::BlockDevice*) &mcuboot_scratch_bd        /** Scratch space for swapping images */
 #else
@@ -130,7 +147,7 @@ void flash_area_close(const struct flash_area* fap) {
 /*
  * Read/write/erase. Offset is relative from beginning of flash area.
  */
-int flash_area_read(const struct flash_area* fap, uint32_t off, void* dst, uint32_t len) {
+static int flash_device_read(const struct flash_area* fap, uint32_t off, void* dst, uint32_t len) {
     mbed::BlockDevice* bd = flash_map_bd[fap->fa_id];
 
     /* Note: The address must be aligned to bd->get_read_size(). If MCUBOOT_READ_GRANULARITY
@@ -188,16 +205,49 @@ int flash_area_read(const struct flash_area* fap, uint32_t off, void* dst, uint3
     return 0;
 }
 
-int flash_area_write(const struct flash_area* fap, uint32_t off, const void* src, uint32_t len) {
+static int flash_device_write(const struct flash_area* fap, uint32_t off, const void* src, uint32_t len) {
     mbed::BlockDevice* bd = flash_map_bd[fap->fa_id];
     return bd->program(src, off, len);
 }
 
-int flash_area_erase(const struct flash_area* fap, uint32_t off, uint32_t len) {
+static int flash_device_erase(const struct flash_area* fap, uint32_t off, uint32_t len) {
     mbed::BlockDevice* bd = flash_map_bd[fap->fa_id];
     return bd->erase(off, len);
 }
 
+int flash_area_read(const struct flash_area* fap, uint32_t off, void* dst, uint32_t len) {
+#ifdef MCUBOOT_FLASH_STATS
+    uint32_t start = us_ticker_read();
+    int rc = flash_device_read(fap, off, dst, len);
+    flash_stats_record(fap->fa_id, FLASH_STATS_READ, len, us_ticker_read() - start, rc);
+    return rc;
+#else
+    return flash_device_read(fap, off, dst, len);
+#endif
+}
+
+int flash_area_write(const struct flash_area* fap, uint32_t off, const void* src, uint32_t len) {
+#ifdef MCUBOOT_FLASH_STATS
+    uint32_t start = us_ticker_read();
+    int rc = flash_device_write(fap, off, src, len);
+    flash_stats_record(fap->fa_id, FLASH_STATS_WRITE, len, us_ticker_read() - start, rc);
+    return rc;
+#else
+    return flash_device_write(fap, off, src, len);
+#endif
+}
+
+int flash_area_erase(const struct flash_area* fap, uint32_t off, uint32_t len) {
+#ifdef MCUBOOT_FLASH_STATS
+    uint32_t start = us_ticker_read();
+    int rc = flash_device_erase(fap, off, len);
+    flash_stats_record(fap->fa_id, FLASH_STATS_ERASE, len, us_ticker_read() - start, rc);
+    return rc;
+#else
+    return flash_device_erase(fap, off, len);
+#endif
+}
+
 uint32_t flash_area_align(const struct flash_area* fap) {
     mbed::BlockDevice* bd = flash_map_bd[fap->fa_id];
     return bd->get_program_size();
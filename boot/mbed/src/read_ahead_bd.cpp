@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cstring>
+#include "flash_map_backend/read_ahead_bd.h"
+
+#include "mcuboot_config/mcuboot_logging.h"
+
+ReadAheadBlockDevice::ReadAheadBlockDevice(mbed::BlockDevice* bd, uint8_t* buffer, bd_size_t size)
+    : _bd(bd), _buffer(buffer), _buffer_size(size), _cache_addr(0), _cache_size(0)
+{
+}
+
+int ReadAheadBlockDevice::init() {
+    _cache_size = 0;
+
+    int ret = _bd->init();
+    if (ret) {
+        return ret;
+    }
+
+    bd_size_t read_size = _bd->get_read_size();
+    if (read_size == 0 || _buffer_size < read_size || _buffer_size % read_size) {
+        MCUBOOT_LOG_ERR("Read-ahead cache size %u is not a multiple of the read size %u",
+                (unsigned int) _buffer_size, (unsigned int) read_size);
+        _bd->deinit();
+        return -1;
+    }
+
+    return 0;
+}
+
+int ReadAheadBlockDevice::deinit() {
+    _cache_size = 0;
+    return _bd->deinit();
+}
+
+int ReadAheadBlockDevice::sync() {
+    return _bd->sync();
+}
+
+int ReadAheadBlockDevice::read(void* buffer, bd_addr_t addr, bd_size_t size) {
+    uint8_t* dst = (uint8_t*) buffer;
+
+    while (size > 0) {
+        if (_cache_size && addr >= _cache_addr && addr < _cache_addr + _cache_size) {
+            bd_size_t chunk = _cache_addr + _cache_size - addr;
+            if (chunk > size) {
+                chunk = size;
+            }
+
+            memcpy(dst, _buffer + (addr - _cache_addr), chunk);
+            dst += chunk;
+            addr += chunk;
+            size -= chunk;
+            continue;
+        }
+
+        /* Nothing to gain from caching what is at least a whole block */
+        if (size >= _buffer_size) {
+            return _bd->read(dst, addr, size);
+        }
+
+        bd_addr_t block = addr - (addr % _buffer_size);
+        bd_size_t block_size = _buffer_size;
+        if (block + block_size > _bd->size()) {
+            block_size = _bd->size() - block;
+        }
+
+        _cache_size = 0;
+        int ret = _bd->read(_buffer, block, block_size);
+        if (ret) {
+            return ret;
+        }
+
+        _cache_addr = block;
+        _cache_size = block_size;
+    }
+
+    return 0;
+}
+
+int ReadAheadBlockDevice::program(const void* buffer, bd_addr_t addr, bd_size_t size) {
+    invalidate(addr, size);
+    return _bd->program(buffer, addr, size);
+}
+
+int ReadAheadBlockDevice::erase(bd_addr_t addr, bd_size_t size) {
+    invalidate(addr, size);
+    return _bd->erase(addr, size);
+}
+
+int ReadAheadBlockDevice::trim(bd_addr_t addr, bd_size_t size) {
+    invalidate(addr, size);
+    return _bd->trim(addr, size);
+}
+
+bd_size_t ReadAheadBlockDevice::get_read_size() const {
+    return _bd->get_read_size();
+}
+
+bd_size_t ReadAheadBlockDevice::get_program_size() const {
+    return _bd->get_program_size();
+}
+
+bd_size_t ReadAheadBlockDevice::get_erase_size() const {
+    return _bd->get_erase_size();
+}
+
+bd_size_t ReadAheadBlockDevice::get_erase_size(bd_addr_t addr) const {
+    return _bd->get_erase_size(addr);
+}
+
+int ReadAheadBlockDevice::get_erase_value() const {
+    return _bd->get_erase_value();
+}
+
+bd_size_t ReadAheadBlockDevice::size() const {
+    return _bd->size();
+}
+
+const char* ReadAheadBlockDevice::get_type() const {
+    return _bd->get_type();
+}
+
+void ReadAheadBlockDevice::invalidate(bd_addr_t addr, bd_size_t size) {
+    if (_cache_size && addr < _cache_addr + _cache_size && _cache_addr < addr + size) {
+        _cache_size = 0;
+    }
+}
@@ -49,6 +49,7 @@ struct flash_area
   /* NuttX implementation-specific fields */
 
   const char *fa_mtd_path;   /* Path for the MTD partition */
+  void       *fa_priv;       /* Backend device, set while the area is open */
 };
 
 /* Structure describing a sector within a flash area. */
@@ -243,6 +244,28 @@ int flash_area_open(uint8_t id, const struct flash_area **fa);
 
 void flash_area_close(const struct flash_area *fa);
 
+#ifdef CONFIG_MCUBOOT_HASH_MMAP_FLASH
+/****************************************************************************
+ * Name: flash_area_get_mapped_addr
+ *
+ * Description:
+ *   Retrieve the address of an open flash area in the CPU address space,
+ *   if the MTD driver supports memory-mapped XIP access.
+ *
+ * Input Parameters:
+ *   fa - Flash area.
+ *
+ * Output Parameters:
+ *   addr - Address of the first byte of the flash area.
+ *
+ * Returned Value:
+ *   Zero on success, or negative value if the area is not memory-mapped.
+ *
+ ****************************************************************************/
+
+int flash_area_get_mapped_addr(const struct flash_area *fa, uintptr_t *addr);
+#endif
+
 /****************************************************************************
  * Name: flash_area_read
  *
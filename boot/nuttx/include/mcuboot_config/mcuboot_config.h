@@ -169,6 +169,20 @@
 #  define MCUBOOT_HAVE_LOGGING
 #endif
 
+/* Flash operation statistics */
+
+#ifdef CONFIG_MCUBOOT_FLASH_STATS
+#  define MCUBOOT_FLASH_STATS
+#endif
+
+/* Hash images and read their headers straight from memory-mapped flash,
+ * for MTD drivers supporting the MTDIOC_XIPBASE ioctl command.
+ */
+
+#ifdef CONFIG_MCUBOOT_HASH_MMAP_FLASH
+#  define MCUBOOT_HASH_MMAP_FLASH
+#endif
+
 /* Assertions */
 
 /* Uncomment if your platform has its own mcuboot_config/mcuboot_assert.h.
@@ -29,6 +29,7 @@
 
 #include <bootutil/bootutil.h>
 #include <bootutil/image.h>
+#include <bootutil/flash_stats.h>
 
 #include "flash_map_backend/flash_map_backend.h"
 
@@ -131,6 +132,10 @@ int main(int argc, FAR char *argv[])
       FIH_PANIC;
     }
 
+#ifdef MCUBOOT_FLASH_STATS
+  flash_stats_log();
+#endif
+
   do_boot(&rsp);
 
   while (1);
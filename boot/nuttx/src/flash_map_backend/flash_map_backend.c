@@ -29,12 +29,14 @@
 #include <stdint.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <nuttx/fs/fs.h>
 #include <nuttx/mtd/mtd.h>
 
 #include <bootutil/bootutil_log.h>
+#include <bootutil/flash_stats.h>
 
 #include "flash_map_backend/flash_map_backend.h"
 #include "os/os_malloc.h"
@@ -67,6 +69,14 @@ struct flash_device_s
   int      fd;          /* File descriptor for an open flash area */
   uint32_t refs;        /* Reference counter */
   uint8_t  erase_state; /* Byte value of the flash erased state */
+
+#ifdef MCUBOOT_HASH_MMAP_FLASH
+  /* Address of the flash area in the CPU address space, or NULL if the MTD
+   * driver does not support memory-mapped XIP access.
+   */
+
+  const void *xip_base;
+#endif
 };
 
 /****************************************************************************
@@ -190,6 +200,25 @@ static struct flash_device_s *lookup_flash_device_by_id(uint8_t fa_id)
   return NULL;
 }
 
+/****************************************************************************
+ * Name: flash_device
+ *
+ * Description:
+ *   Retrieve the flash device of an open flash area, without looking it up.
+ *
+ * Input Parameters:
+ *   fa - Flash area.
+ *
+ * Returned Value:
+ *   Reference to the flash device, or NULL if the area was never opened.
+ *
+ ****************************************************************************/
+
+static inline struct flash_device_s *flash_device(const struct flash_area *fa)
+{
+  return (struct flash_device_s *)fa->fa_priv;
+}
+
 /****************************************************************************
  * Name: lookup_flash_device_by_offset
  *
@@ -221,6 +250,220 @@ static struct flash_device_s *lookup_flash_device_by_offset(uint32_t offset)
   return NULL;
 }
 
+/****************************************************************************
+ * Name: flash_device_read
+ *
+ * Description:
+ *   Read data from flash area.
+ *   Area readout boundaries are asserted before read request. API has the
+ *   same limitation regarding read-block alignment and size as the
+ *   underlying flash driver.
+ *
+ * Input Parameters:
+ *   fa  - Flash area to be read.
+ *   off - Offset relative from beginning of flash area to be read.
+ *   len - Number of bytes to read.
+ *
+ * Output Parameters:
+ *   dst - Buffer to store read data.
+ *
+ * Returned Value:
+ *   Zero on success, or negative value in case of error.
+ *
+ ****************************************************************************/
+
+static int flash_device_read(const struct flash_area *fa, uint32_t off,
+                             void *dst, uint32_t len)
+{
+  struct flash_device_s *dev = flash_device(fa);
+  ssize_t nbytes;
+
+  BOOT_LOG_DBG("ID:%" PRIu8 " offset:%" PRIu32 " length:%" PRIu32,
+               fa->fa_id, off, len);
+
+  DEBUGASSERT(dev != NULL);
+
+  if (off > fa->fa_size || len > fa->fa_size - off)
+    {
+      BOOT_LOG_ERR("Attempt to read out of flash area bounds");
+
+      return ERROR;
+    }
+
+  /* Read the flash block into memory, from the beginning of the flash area */
+
+  nbytes = pread(dev->fd, dst, len, (off_t)off);
+  if (nbytes != (ssize_t)len)
+    {
+      int errcode = nbytes < 0 ? errno : EIO;
+
+      BOOT_LOG_ERR("Read from %s failed: %d", fa->fa_mtd_path, errcode);
+
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: flash_device_write
+ *
+ * Description:
+ *   Write data to flash area.
+ *   Area write boundaries are asserted before write request. API has the
+ *   same limitation regarding write-block alignment and size as the
+ *   underlying flash driver.
+ *
+ * Input Parameters:
+ *   fa  - Flash area to be written.
+ *   off - Offset relative from beginning of flash area to be written.
+ *   src - Buffer with data to be written.
+ *   len - Number of bytes to write.
+ *
+ * Returned Value:
+ *   Zero on success, or negative value in case of error.
+ *
+ ****************************************************************************/
+
+static int flash_device_write(const struct flash_area *fa, uint32_t off,
+                              const void *src, uint32_t len)
+{
+  struct flash_device_s *dev = flash_device(fa);
+  ssize_t nbytes;
+
+  BOOT_LOG_DBG("ID:%" PRIu8 " offset:%" PRIu32 " length:%" PRIu32,
+               fa->fa_id, off, len);
+
+  DEBUGASSERT(dev != NULL);
+
+  if (off > fa->fa_size || len > fa->fa_size - off)
+    {
+      BOOT_LOG_ERR("Attempt to write out of flash area bounds");
+
+      return ERROR;
+    }
+
+  /* Write the buffer to the flash block, from the beginning of the flash
+   * area.
+   */
+
+  nbytes = pwrite(dev->fd, src, len, (off_t)off);
+  if (nbytes != (ssize_t)len)
+    {
+      int errcode = nbytes < 0 ? errno : EIO;
+
+      BOOT_LOG_ERR("Write to %s failed: %d", fa->fa_mtd_path, errcode);
+
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: flash_device_erase
+ *
+ * Description:
+ *   Erase a given flash area range.
+ *   Area boundaries are asserted before erase request. API has the same
+ *   limitation regarding erase-block alignment and size as the underlying
+ *   flash driver.
+ *
+ * Input Parameters:
+ *   fa  - Flash area to be erased.
+ *   off - Offset relative from beginning of flash area to be erased.
+ *   len - Number of bytes to be erase.
+ *
+ * Returned Value:
+ *   Zero on success, or negative value in case of error.
+ *
+ ****************************************************************************/
+
+static int flash_device_erase(const struct flash_area *fa, uint32_t off,
+                              uint32_t len)
+{
+  int ret;
+  void *buffer;
+  size_t i;
+  struct flash_device_s *dev = flash_device(fa);
+  const size_t sector_size = dev->mtdgeo.erasesize;
+  const uint8_t erase_val = dev->erase_state;
+
+  BOOT_LOG_DBG("ID:%" PRIu8 " offset:%" PRIu32 " length:%" PRIu32,
+               fa->fa_id, off, len);
+
+  if (off == 0 && len == fa->fa_size)
+    {
+      /* The whole partition is erased at once by the MTD driver, instead of
+       * writing the erased value to each of its sectors.
+       */
+
+      ret = ioctl(dev->fd, MTDIOC_BULKERASE, 0);
+      if (ret >= 0)
+        {
+          return OK;
+        }
+
+      BOOT_LOG_DBG("Bulk erase not supported: %d", errno);
+    }
+
+  buffer = malloc(sector_size);
+  if (buffer == NULL)
+    {
+      BOOT_LOG_ERR("Failed to allocate erase buffer");
+
+      return ERROR;
+    }
+
+  memset(buffer, erase_val, sector_size);
+
+  i = 0;
+
+  do
+    {
+      BOOT_LOG_DBG("Erasing %zu bytes at offset %" PRIu32,
+                   sector_size, off + i);
+
+      ret = flash_device_write(fa, off + i, buffer, sector_size);
+      i += sector_size;
+    }
+  while (ret == OK && i < (len - sector_size));
+
+  if (ret == OK)
+    {
+      BOOT_LOG_DBG("Erasing %" PRIu32 " bytes at offset %" PRIu32,
+                   len - i, off + i);
+
+      ret = flash_device_write(fa, off + i, buffer, len - i);
+    }
+
+  free(buffer);
+
+  return ret;
+}
+
+#ifdef MCUBOOT_FLASH_STATS
+/****************************************************************************
+ * Name: flash_stats_usecs
+ *
+ * Description:
+ *   Get the monotonic time used to measure the flash operation latencies.
+ *
+ * Returned Value:
+ *   Time in microseconds, wrapping around.
+ *
+ ****************************************************************************/
+
+static uint32_t flash_stats_usecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint32_t)ts.tv_sec * 1000000 + (uint32_t)(ts.tv_nsec / 1000);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -249,7 +492,7 @@ int flash_area_open(uint8_t id, const struct flash_area **fa)
   int fd;
   int ret;
 
-  BOOT_LOG_INF("ID:%" PRIu8, id);
+  BOOT_LOG_DBG("ID:%" PRIu8, id);
 
   dev = lookup_flash_device_by_id(id);
   if (dev == NULL)
@@ -263,7 +506,7 @@ int flash_area_open(uint8_t id, const struct flash_area **fa)
 
   if (dev->refs++ > 0)
     {
-      BOOT_LOG_INF("Flash area ID %" PRIu8 " already open, count: %" PRIu32 " (+)",
+      BOOT_LOG_DBG("Flash area ID %" PRIu8 " already open, count: %" PRIu32 " (+)",
                    id, dev->refs);
 
       return OK;
@@ -310,6 +553,18 @@ int flash_area_open(uint8_t id, const struct flash_area **fa)
       goto errout_with_fd;
     }
 
+#ifdef MCUBOOT_HASH_MMAP_FLASH
+  /* MTD partitions report the XIP address of their own first byte */
+
+  ret = ioctl(fd, MTDIOC_XIPBASE, (unsigned long)((uintptr_t)&dev->xip_base));
+  if (ret < 0)
+    {
+      BOOT_LOG_DBG("MTD device not memory-mapped: %d", errno);
+
+      dev->xip_base = NULL;
+    }
+#endif
+
   dev->fa_cfg->fa_off = dev->partinfo.startsector * dev->partinfo.sectorsize;
   dev->fa_cfg->fa_size = dev->partinfo.numsectors * dev->partinfo.sectorsize;
 
@@ -318,6 +573,7 @@ int flash_area_open(uint8_t id, const struct flash_area **fa)
   BOOT_LOG_INF("MTD erase state: 0x%" PRIx8, dev->erase_state);
 
   dev->fd = fd;
+  dev->fa_cfg->fa_priv = dev;
 
   BOOT_LOG_INF("Flash area %" PRIu8 " open, count: %" PRIu32 " (+)", id, dev->refs);
 
@@ -348,7 +604,7 @@ errout:
 
 void flash_area_close(const struct flash_area *fa)
 {
-  BOOT_LOG_INF("ID:%" PRIu8, fa->fa_id);
+  BOOT_LOG_DBG("ID:%" PRIu8, fa->fa_id);
 
   struct flash_device_s *dev = lookup_flash_device_by_id(fa->fa_id);
 
@@ -363,220 +619,130 @@ void flash_area_close(const struct flash_area *fa)
       return;
     }
 
-  BOOT_LOG_INF("Close request for flash area %" PRIu8 ", count: %" PRIu32 " (-)",
+  BOOT_LOG_DBG("Close request for flash area %" PRIu8 ", count: %" PRIu32 " (-)",
                fa->fa_id, dev->refs);
 
   if (--dev->refs == 0)
     {
       close(dev->fd);
       dev->fd = -1;
+#ifdef MCUBOOT_HASH_MMAP_FLASH
+      dev->xip_base = NULL;
+#endif
 
       BOOT_LOG_INF("Flash area %" PRIu8 " closed", fa->fa_id);
     }
 }
 
+#ifdef MCUBOOT_HASH_MMAP_FLASH
 /****************************************************************************
- * Name: flash_area_read
+ * Name: flash_area_get_mapped_addr
  *
  * Description:
- *   Read data from flash area.
- *   Area readout boundaries are asserted before read request. API has the
- *   same limitation regarding read-block alignment and size as the
- *   underlying flash driver.
+ *   Retrieve the address of an open flash area in the CPU address space,
+ *   through which bootutil hashes images and parses their headers without
+ *   a read() call and a copy for each access.
  *
  * Input Parameters:
- *   fa  - Flash area to be read.
- *   off - Offset relative from beginning of flash area to be read.
- *   len - Number of bytes to read.
+ *   fa - Flash area.
  *
  * Output Parameters:
- *   dst - Buffer to store read data.
+ *   addr - Address of the first byte of the flash area.
  *
  * Returned Value:
- *   Zero on success, or negative value in case of error.
+ *   Zero on success, or negative value if the flash area is not
+ *   memory-mapped, in which case it must be read with flash_area_read().
  *
  ****************************************************************************/
 
-int flash_area_read(const struct flash_area *fa, uint32_t off,
-                    void *dst, uint32_t len)
+int flash_area_get_mapped_addr(const struct flash_area *fa, uintptr_t *addr)
 {
-  struct flash_device_s *dev;
-  off_t seekpos;
-  ssize_t nbytes;
-
-  BOOT_LOG_INF("ID:%" PRIu8 " offset:%" PRIu32 " length:%" PRIu32,
-               fa->fa_id, off, len);
+  struct flash_device_s *dev = flash_device(fa);
 
-  dev = lookup_flash_device_by_id(fa->fa_id);
-
-  DEBUGASSERT(dev != NULL);
-
-  if (off + len > fa->fa_size)
+  if (dev == NULL || dev->xip_base == NULL)
     {
-      BOOT_LOG_ERR("Attempt to read out of flash area bounds");
-
-      return ERROR;
+      return -ENOTSUP;
     }
 
-  /* Reposition the file offset from the beginning of the flash area */
-
-  seekpos = lseek(dev->fd, (off_t)off, SEEK_SET);
-  if (seekpos != (off_t)off)
-    {
-      int errcode = errno;
-
-      BOOT_LOG_ERR("Seek to offset %" PRIu32 " failed: %d", off, errcode);
+  *addr = (uintptr_t)dev->xip_base;
 
-      return ERROR;
-    }
-
-  /* Read the flash block into memory */
+  return OK;
+}
+#endif
 
-  nbytes = read(dev->fd, dst, len);
-  if (nbytes < 0)
-    {
-      int errcode = errno;
+/****************************************************************************
+ * Name: flash_area_read
+ *
+ * Description:
+ *   Read data from flash area, see flash_device_read. The operation is
+ *   accounted in the flash statistics if MCUBOOT_FLASH_STATS is enabled.
+ *
+ ****************************************************************************/
 
-      BOOT_LOG_ERR("Read from %s failed: %d", fa->fa_mtd_path, errcode);
+int flash_area_read(const struct flash_area *fa, uint32_t off,
+                    void *dst, uint32_t len)
+{
+#ifdef MCUBOOT_FLASH_STATS
+  uint32_t start = flash_stats_usecs();
+  int ret = flash_device_read(fa, off, dst, len);
 
-      return ERROR;
-    }
+  flash_stats_record(fa->fa_id, FLASH_STATS_READ, len,
+                     flash_stats_usecs() - start, ret);
 
-  return OK;
+  return ret;
+#else
+  return flash_device_read(fa, off, dst, len);
+#endif
 }
 
 /****************************************************************************
  * Name: flash_area_write
  *
  * Description:
- *   Write data to flash area.
- *   Area write boundaries are asserted before write request. API has the
- *   same limitation regarding write-block alignment and size as the
- *   underlying flash driver.
- *
- * Input Parameters:
- *   fa  - Flash area to be written.
- *   off - Offset relative from beginning of flash area to be written.
- *   src - Buffer with data to be written.
- *   len - Number of bytes to write.
- *
- * Returned Value:
- *   Zero on success, or negative value in case of error.
+ *   Write data to flash area, see flash_device_write. The operation is
+ *   accounted in the flash statistics if MCUBOOT_FLASH_STATS is enabled.
  *
  ****************************************************************************/
 
 int flash_area_write(const struct flash_area *fa, uint32_t off,
                      const void *src, uint32_t len)
 {
-  struct flash_device_s *dev;
-  off_t seekpos;
-  ssize_t nbytes;
-
-  BOOT_LOG_INF("ID:%" PRIu8 " offset:%" PRIu32 " length:%" PRIu32,
-               fa->fa_id, off, len);
-
-  dev = lookup_flash_device_by_id(fa->fa_id);
-
-  DEBUGASSERT(dev != NULL);
-
-  if (off + len > fa->fa_size)
-    {
-      BOOT_LOG_ERR("Attempt to write out of flash area bounds");
-
-      return ERROR;
-    }
-
-  /* Reposition the file offset from the beginning of the flash area */
-
-  seekpos = lseek(dev->fd, (off_t)off, SEEK_SET);
-  if (seekpos != (off_t)off)
-    {
-      int errcode = errno;
+#ifdef MCUBOOT_FLASH_STATS
+  uint32_t start = flash_stats_usecs();
+  int ret = flash_device_write(fa, off, src, len);
 
-      BOOT_LOG_ERR("Seek to offset %" PRIu32 " failed: %d", off, errcode);
+  flash_stats_record(fa->fa_id, FLASH_STATS_WRITE, len,
+                     flash_stats_usecs() - start, ret);
 
-      return ERROR;
-    }
-
-  /* Write the buffer to the flash block */
-
-  nbytes = write(dev->fd, src, len);
-  if (nbytes < 0)
-    {
-      int errcode = errno;
-
-      BOOT_LOG_ERR("Write to %s failed: %d", fa->fa_mtd_path, errcode);
-
-      return ERROR;
-    }
-
-  return OK;
+  return ret;
+#else
+  return flash_device_write(fa, off, src, len);
+#endif
 }
 
 /****************************************************************************
  * Name: flash_area_erase
  *
  * Description:
- *   Erase a given flash area range.
- *   Area boundaries are asserted before erase request. API has the same
- *   limitation regarding erase-block alignment and size as the underlying
- *   flash driver.
- *
- * Input Parameters:
- *   fa  - Flash area to be erased.
- *   off - Offset relative from beginning of flash area to be erased.
- *   len - Number of bytes to be erase.
- *
- * Returned Value:
- *   Zero on success, or negative value in case of error.
+ *   Erase a given flash area range, see flash_device_erase. The operation
+ *   is accounted in the flash statistics, as a single erase, if
+ *   MCUBOOT_FLASH_STATS is enabled.
  *
  ****************************************************************************/
 
 int flash_area_erase(const struct flash_area *fa, uint32_t off, uint32_t len)
 {
-  int ret;
-  void *buffer;
-  size_t i;
-  struct flash_device_s *dev = lookup_flash_device_by_id(fa->fa_id);
-  const size_t sector_size = dev->mtdgeo.erasesize;
-  const uint8_t erase_val = dev->erase_state;
-
-  BOOT_LOG_INF("ID:%" PRIu8 " offset:%" PRIu32 " length:%" PRIu32,
-               fa->fa_id, off, len);
-
-  buffer = malloc(sector_size);
-  if (buffer == NULL)
-    {
-      BOOT_LOG_ERR("Failed to allocate erase buffer");
-
-      return ERROR;
-    }
+#ifdef MCUBOOT_FLASH_STATS
+  uint32_t start = flash_stats_usecs();
+  int ret = flash_device_erase(fa, off, len);
 
-  memset(buffer, erase_val, sector_size);
-
-  i = 0;
-
-  do
-    {
-      BOOT_LOG_DBG("Erasing %zu bytes at offset %" PRIu32,
-                   sector_size, off + i);
-
-      ret = flash_area_write(fa, off + i, buffer, sector_size);
-      i += sector_size;
-    }
-  while (ret == OK && i < (len - sector_size));
-
-  if (ret == OK)
-    {
-      BOOT_LOG_DBG("Erasing %" PRIu32 " bytes at offset %" PRIu32,
-                   len - i, off + i);
-
-      ret = flash_area_write(fa, off + i, buffer, len - i);
-    }
-
-  free(buffer);
+  flash_stats_record(fa->fa_id, FLASH_STATS_ERASE, len,
+                     flash_stats_usecs() - start, ret);
 
   return ret;
+#else
+  return flash_device_erase(fa, off, len);
+#endif
 }
 
 /****************************************************************************
@@ -603,7 +769,7 @@ uint32_t flash_area_align(const struct flash_area *fa)
 
   const uint32_t minimum_write_length = 1;
 
-  BOOT_LOG_INF("ID:%" PRIu8 " align:%" PRIu32,
+  BOOT_LOG_DBG("ID:%" PRIu8 " align:%" PRIu32,
                fa->fa_id, minimum_write_length);
 
   return minimum_write_length;
@@ -635,7 +801,7 @@ uint8_t flash_area_erased_val(const struct flash_area *fa)
 
   erased_val = dev->erase_state;
 
-  BOOT_LOG_INF("ID:%" PRIu8 " erased_val:0x%" PRIx8, fa->fa_id, erased_val);
+  BOOT_LOG_DBG("ID:%" PRIu8 " erased_val:0x%" PRIx8, fa->fa_id, erased_val);
 
   return erased_val;
 }
@@ -5,6 +5,7 @@
  */
 
 #include <zephyr/toolchain.h>
+#include <zephyr/sys/util.h>
 
 #include <cmsis_core.h>
 #if CONFIG_CPU_HAS_NXP_MPU
@@ -16,12 +17,16 @@ void cleanup_arm_nvic(void) {
 	__ISB();
 	__disable_irq();
 
+	/* Only the registers of the interrupt lines the SoC has */
+	const uint8_t num_regs = MIN(DIV_ROUND_UP(CONFIG_NUM_IRQS, 32),
+				     ARRAY_SIZE(NVIC->ICER));
+
 	/* Disable NVIC interrupts */
-	for (uint8_t i = 0; i < ARRAY_SIZE(NVIC->ICER); i++) {
+	for (uint8_t i = 0; i < num_regs; i++) {
 		NVIC->ICER[i] = 0xFFFFFFFF;
 	}
 	/* Clear pending NVIC interrupts */
-	for (uint8_t i = 0; i < ARRAY_SIZE(NVIC->ICPR); i++) {
+	for (uint8_t i = 0; i < num_regs; i++) {
 		NVIC->ICPR[i] = 0xFFFFFFFF;
 	}
 }
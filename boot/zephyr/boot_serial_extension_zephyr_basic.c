@@ -27,6 +27,47 @@
 BOOT_LOG_MODULE_DECLARE(mcuboot);
 
 #ifdef CONFIG_BOOT_MGMT_CUSTOM_STORAGE_ERASE
+#ifdef CONFIG_BOOT_SERIAL_BACKGROUND_ERASE
+/*
+ * The erase is only queued, a read of the same command reports its
+ * progress.
+ */
+static int bs_custom_storage_erase(const struct nmgr_hdr *hdr,
+                                   const char *buffer, int len,
+                                   zcbor_state_t *cs)
+{
+    uint32_t off = 0;
+    uint32_t size = 0;
+    int rc;
+
+    (void)buffer;
+    (void)len;
+
+    if (hdr->nh_group != ZEPHYR_MGMT_GRP_BASIC ||
+        hdr->nh_id != ZEPHYR_MGMT_GRP_BASIC_CMD_ERASE_STORAGE) {
+        return MGMT_ERR_ENOTSUP;
+    }
+
+    if (hdr->nh_op == NMGR_OP_WRITE) {
+        rc = bs_erase_start(FIXED_PARTITION_ID(storage_partition));
+    } else {
+        rc = bs_erase_status(FIXED_PARTITION_ID(storage_partition), &off, &size);
+    }
+
+    zcbor_map_start_encode(cs, 10);
+    zcbor_tstr_put_lit(cs, "rc");
+    zcbor_uint32_put(cs, rc);
+    if (hdr->nh_op != NMGR_OP_WRITE && rc != MGMT_ERR_ENOENT) {
+        zcbor_tstr_put_lit(cs, "off");
+        zcbor_uint32_put(cs, off);
+        zcbor_tstr_put_lit(cs, "len");
+        zcbor_uint32_put(cs, size);
+    }
+    zcbor_map_end_encode(cs, 10);
+
+    return rc;
+}
+#else
 static int bs_custom_storage_erase(const struct nmgr_hdr *hdr,
                                    const char *buffer, int len,
                                    zcbor_state_t *cs)
@@ -66,6 +107,7 @@ static int bs_custom_storage_erase(const struct nmgr_hdr *hdr,
 
     return rc;
 }
+#endif
 
 MCUMGR_HANDLER_DEFINE(storage_erase, bs_custom_storage_erase);
 #endif
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+#include "bootutil/boot_step.h"
+
+/*
+ * boot_go() runs in a thread of its own, which hands control back to the
+ * caller of boot_go_step() at each step point and waits for the next call.
+ * Only one of the two threads runs at a time, so bootutil needs no locking,
+ * and other threads, such as those of the USB stack, get the CPU whenever
+ * the caller yields between two steps.
+ */
+
+static K_THREAD_STACK_DEFINE(boot_step_stack, CONFIG_BOOT_GO_STEP_STACK_SIZE);
+static struct k_thread boot_step_thread;
+static K_SEM_DEFINE(boot_step_run, 0, 1);
+static K_SEM_DEFINE(boot_step_done, 0, 1);
+
+static struct boot_rsp *boot_step_rsp;
+static fih_ret boot_step_rc;
+static bool boot_step_started;
+static bool boot_step_finished;
+
+void
+boot_step_point(enum boot_step_kind kind)
+{
+    ARG_UNUSED(kind);
+
+    /* Step points reached outside of boot_go(), e.g. from serial recovery,
+     * or on another core, are not steps.
+     */
+    if (!boot_step_started || boot_step_finished ||
+        k_current_get() != &boot_step_thread) {
+        return;
+    }
+
+    k_sem_give(&boot_step_done);
+    k_sem_take(&boot_step_run, K_FOREVER);
+}
+
+static void
+boot_step_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    FIH_CALL(boot_go, boot_step_rc, boot_step_rsp);
+
+    boot_step_finished = true;
+    k_sem_give(&boot_step_done);
+}
+
+int
+boot_go_step(struct boot_rsp *rsp, fih_ret *fih_rc)
+{
+    if (boot_step_finished) {
+        *fih_rc = boot_step_rc;
+        return BOOT_STEP_DONE;
+    }
+
+    if (!boot_step_started) {
+        boot_step_rsp = rsp;
+        boot_step_started = true;
+        k_thread_create(&boot_step_thread, boot_step_stack,
+                        K_THREAD_STACK_SIZEOF(boot_step_stack),
+                        boot_step_entry, NULL, NULL, NULL,
+                        k_thread_priority_get(k_current_get()), 0, K_NO_WAIT);
+        k_thread_name_set(&boot_step_thread, "boot_go");
+    } else {
+        k_sem_give(&boot_step_run);
+    }
+
+    k_sem_take(&boot_step_done, K_FOREVER);
+
+    if (boot_step_finished) {
+        k_thread_join(&boot_step_thread, K_FOREVER);
+        *fih_rc = boot_step_rc;
+        return BOOT_STEP_DONE;
+    }
+
+    return BOOT_STEP_MORE;
+}
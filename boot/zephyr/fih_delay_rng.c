@@ -0,0 +1,48 @@
+/*
+ *  Copyright (c) 2026, NOWATCH BV
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Random delays of the fault injection hardening drawn from the Zephyr
+ * cryptographically secure random number API. With a hardware entropy
+ * driver as its generator, this reads the TRNG directly and needs no
+ * Mbed TLS DRBG.
+ */
+
+#include <stddef.h>
+
+#include <zephyr/random/random.h>
+
+#include "bootutil/fault_injection_hardening.h"
+
+#if defined(FIH_ENABLE_DELAY) && defined(MCUBOOT_FIH_DELAY_RNG_PLATFORM)
+
+/* Number of delays drawn from the generator at once. */
+#ifndef MCUBOOT_FIH_DELAY_POOL_SIZE
+#define MCUBOOT_FIH_DELAY_POOL_SIZE 64
+#endif
+
+static unsigned char fih_delay_pool[MCUBOOT_FIH_DELAY_POOL_SIZE];
+static size_t fih_delay_pool_used = MCUBOOT_FIH_DELAY_POOL_SIZE;
+
+int fih_delay_init(void)
+{
+    /* The generator is set up by the kernel. */
+    return 1;
+}
+
+unsigned char fih_delay_random_uchar(void)
+{
+    if (fih_delay_pool_used >= sizeof(fih_delay_pool)) {
+        if (sys_csrand_get(fih_delay_pool, sizeof(fih_delay_pool)) != 0) {
+            FIH_PANIC;
+        }
+        fih_delay_pool_used = 0;
+    }
+
+    return fih_delay_pool[fih_delay_pool_used++];
+}
+
+#endif /* FIH_ENABLE_DELAY && MCUBOOT_FIH_DELAY_RNG_PLATFORM */
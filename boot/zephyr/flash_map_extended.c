@@ -5,6 +5,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/flash.h>
@@ -15,6 +16,7 @@
 #include <sysflash/sysflash.h>
 
 #include "bootutil/bootutil_log.h"
+#include "bootutil/flash_stats.h"
 
 BOOT_LOG_MODULE_DECLARE(mcuboot);
 
@@ -51,6 +53,24 @@ int flash_device_base(uint8_t fd_id, uintptr_t *ret)
     return 0;
 }
 
+#if defined(CONFIG_BOOT_HASH_MMAP_FLASH)
+int flash_area_get_mapped_addr(const struct flash_area *fa, uintptr_t *addr)
+{
+#ifdef CONFIG_BOOT_SECONDARY_RAM
+    if (flash_area_is_ram(fa)) {
+        *addr = flash_area_ram_addr(fa);
+        return 0;
+    }
+#endif
+    /* Only the SoC flash controller is mapped into the address space. */
+    if (fa->fa_dev != flash_dev) {
+        return -ENOTSUP;
+    }
+    *addr = FLASH_DEVICE_BASE + fa->fa_off;
+    return 0;
+}
+#endif
+
 /*
  * This depends on the mappings defined in sysflash.h.
  * MCUBoot uses continuous numbering for the primary slot, the secondary slot,
@@ -123,12 +143,109 @@ int flash_area_id_from_direct_image(int image_id)
 }
 #endif
 
+/*
+ * Page layout of the flash devices sectors are looked up on, as sectors are
+ * looked up one by one during swaps and uploads. When all the pages of a
+ * device have the same size, lookups are a division, otherwise the last page
+ * found is kept so that the lookups within a sector do not go through the
+ * driver again.
+ */
+#define FLASH_LAYOUT_CACHE_DEVS 2
+
+struct flash_layout_cache {
+    const struct device *dev;
+    /* Size of the pages if they all have the same size, 0 otherwise. */
+    size_t page_size;
+    size_t page_count;
+    /* Last page found, valid if its size is not 0. */
+    struct flash_pages_info last;
+};
+
+static struct flash_layout_cache layout_cache[FLASH_LAYOUT_CACHE_DEVS];
+static uint8_t layout_cache_next;
+
+static bool flash_layout_check_page(const struct flash_pages_info *info,
+                                    void *data)
+{
+    size_t *page_size = data;
+
+    if (info->size != *page_size) {
+        *page_size = 0;
+        return false;
+    }
+
+    return true;
+}
+
+static struct flash_layout_cache *flash_layout_cache_get(const struct device *dev)
+{
+    struct flash_layout_cache *cache;
+    struct flash_pages_info info;
+    int i;
+
+    for (i = 0; i < FLASH_LAYOUT_CACHE_DEVS; i++) {
+        if (layout_cache[i].dev == dev) {
+            return &layout_cache[i];
+        }
+    }
+
+    cache = &layout_cache[layout_cache_next];
+    layout_cache_next = (layout_cache_next + 1) % FLASH_LAYOUT_CACHE_DEVS;
+
+    memset(cache, 0, sizeof(*cache));
+    cache->dev = dev;
+    cache->page_count = flash_get_page_count(dev);
+    if (flash_get_page_info_by_idx(dev, 0, &info) == 0) {
+        cache->page_size = info.size;
+        flash_page_foreach(dev, flash_layout_check_page, &cache->page_size);
+    }
+
+    return cache;
+}
+
+static int flash_page_info_cached(const struct device *dev, off_t off,
+                                  struct flash_pages_info *info)
+{
+    struct flash_layout_cache *cache;
+    size_t idx;
+    int rc;
+
+    if (off < 0) {
+        return -EINVAL;
+    }
+
+    cache = flash_layout_cache_get(dev);
+    if (cache->page_size != 0) {
+        idx = off / cache->page_size;
+        if (idx >= cache->page_count) {
+            return -EINVAL;
+        }
+        info->start_offset = idx * cache->page_size;
+        info->size = cache->page_size;
+        info->index = idx;
+        return 0;
+    }
+
+    if (cache->last.size != 0 && off >= cache->last.start_offset &&
+        off - cache->last.start_offset < cache->last.size) {
+        *info = cache->last;
+        return 0;
+    }
+
+    rc = flash_get_page_info_by_offs(dev, off, info);
+    if (rc == 0) {
+        cache->last = *info;
+    }
+
+    return rc;
+}
+
 int flash_area_sector_from_off(off_t off, struct flash_sector *sector)
 {
     int rc;
     struct flash_pages_info page;
 
-    rc = flash_get_page_info_by_offs(flash_dev, off, &page);
+    rc = flash_page_info_cached(flash_dev, off, &page);
     if (rc) {
         return rc;
     }
@@ -166,8 +283,15 @@ int flash_area_get_sector(const struct flash_area *fap, off_t off,
         return -ERANGE;
     }
 
-    rc = flash_get_page_info_by_offs(fap->fa_dev, fap->fa_off + off,
-            &fpi);
+#ifdef CONFIG_BOOT_SECONDARY_RAM
+    if (flash_area_is_ram(fap)) {
+        fsp->fs_off = ROUND_DOWN(off, CONFIG_BOOT_SECONDARY_RAM_SECTOR_SIZE);
+        fsp->fs_size = CONFIG_BOOT_SECONDARY_RAM_SECTOR_SIZE;
+        return 0;
+    }
+#endif
+
+    rc = flash_page_info_cached(fap->fa_dev, fap->fa_off + off, &fpi);
 
     if (rc == 0) {
         fsp->fs_off = fpi.start_offset - fap->fa_off;
@@ -176,3 +300,55 @@ int flash_area_get_sector(const struct flash_area *fap, off_t off,
 
     return rc;
 }
+
+#ifdef CONFIG_BOOT_FLASH_STATS
+/*
+ * The flash area accessors are provided by Zephyr, calls from MCUboot are
+ * redirected here with the linker's --wrap option, see CMakeLists.txt.
+ */
+int __real_flash_area_read(const struct flash_area *fa, off_t off, void *dst,
+                           size_t len);
+int __real_flash_area_write(const struct flash_area *fa, off_t off,
+                            const void *src, size_t len);
+int __real_flash_area_erase(const struct flash_area *fa, off_t off,
+                            size_t len);
+
+static void flash_stats_done(const struct flash_area *fa,
+                             enum flash_stats_op op, size_t len,
+                             uint32_t start, int rc)
+{
+    uint32_t usecs = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+    flash_stats_record(fa->fa_id, op, len, usecs, rc);
+}
+
+int __wrap_flash_area_read(const struct flash_area *fa, off_t off, void *dst,
+                           size_t len)
+{
+    uint32_t start = k_cycle_get_32();
+    int rc = __real_flash_area_read(fa, off, dst, len);
+
+    flash_stats_done(fa, FLASH_STATS_READ, len, start, rc);
+    return rc;
+}
+
+int __wrap_flash_area_write(const struct flash_area *fa, off_t off,
+                            const void *src, size_t len)
+{
+    uint32_t start = k_cycle_get_32();
+    int rc = __real_flash_area_write(fa, off, src, len);
+
+    flash_stats_done(fa, FLASH_STATS_WRITE, len, start, rc);
+    return rc;
+}
+
+int __wrap_flash_area_erase(const struct flash_area *fa, off_t off,
+                            size_t len)
+{
+    uint32_t start = k_cycle_get_32();
+    int rc = __real_flash_area_erase(fa, off, len);
+
+    flash_stats_done(fa, FLASH_STATS_ERASE, len, start, rc);
+    return rc;
+}
+#endif /* CONFIG_BOOT_FLASH_STATS */
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/storage/flash_map.h>
+
+#include <flash_map_backend/flash_map_backend.h>
+
+/*
+ * Secondary slot kept in the RAM region chosen as "mcuboot,ram-secondary",
+ * e.g. in PSRAM, where the application stages an update instead of writing
+ * it to flash. Calls to the flash area accessors are redirected here with
+ * the linker's --wrap option, see CMakeLists.txt; the ones on the secondary
+ * slot access the RAM region, the others are passed on to Zephyr.
+ *
+ * The slot1_partition of the devicetree only provides the ID of the slot.
+ * The region is laid out as a slot in flash, with a write alignment of
+ * BOOT_RAM_SLOT_ALIGN bytes and an erased value of 0xff: the image from
+ * offset 0 and the trailer at the end of the region. Its content must be
+ * kept across the reset into MCUboot, which never writes to the region
+ * otherwise. A request written by the application is only acted upon once
+ * the trailer magic is in place, and the image is validated as in flash, so
+ * the random content of the region after a power-on reset is rejected.
+ */
+
+#define BOOT_RAM_SLOT_NODE      DT_CHOSEN(mcuboot_ram_secondary)
+#define BOOT_RAM_SLOT_ADDR      DT_REG_ADDR(BOOT_RAM_SLOT_NODE)
+#define BOOT_RAM_SLOT_SIZE      DT_REG_SIZE(BOOT_RAM_SLOT_NODE)
+#define BOOT_RAM_SLOT_ID        FIXED_PARTITION_ID(slot1_partition)
+#define BOOT_RAM_SLOT_ALIGN     8
+#define BOOT_RAM_SLOT_SECTOR    CONFIG_BOOT_SECONDARY_RAM_SECTOR_SIZE
+#define BOOT_RAM_SLOT_ERASED    0xff
+
+BUILD_ASSERT(BOOT_RAM_SLOT_SIZE % BOOT_RAM_SLOT_SECTOR == 0,
+             "mcuboot,ram-secondary must be a whole number of sectors");
+
+static const struct flash_area boot_ram_slot = {
+    .fa_id = BOOT_RAM_SLOT_ID,
+    .fa_off = 0,
+    .fa_size = BOOT_RAM_SLOT_SIZE,
+    .fa_dev = NULL,
+};
+
+int __real_flash_area_open(uint8_t id, const struct flash_area **fa);
+void __real_flash_area_close(const struct flash_area *fa);
+int __real_flash_area_read(const struct flash_area *fa, off_t off, void *dst,
+                           size_t len);
+int __real_flash_area_write(const struct flash_area *fa, off_t off,
+                            const void *src, size_t len);
+int __real_flash_area_erase(const struct flash_area *fa, off_t off,
+                            size_t len);
+uint32_t __real_flash_area_align(const struct flash_area *fa);
+int __real_flash_area_get_sectors(int fa_id, uint32_t *count,
+                                  struct flash_sector *sectors);
+
+bool flash_area_is_ram(const struct flash_area *fa)
+{
+    return fa == &boot_ram_slot;
+}
+
+uintptr_t flash_area_ram_addr(const struct flash_area *fa)
+{
+    ARG_UNUSED(fa);
+
+    return BOOT_RAM_SLOT_ADDR;
+}
+
+static void *boot_ram_slot_ptr(off_t off, size_t len)
+{
+    if (off < 0 || (size_t)off > BOOT_RAM_SLOT_SIZE ||
+        len > BOOT_RAM_SLOT_SIZE - (size_t)off) {
+        return NULL;
+    }
+
+    return (void *)(BOOT_RAM_SLOT_ADDR + (uintptr_t)off);
+}
+
+int __wrap_flash_area_open(uint8_t id, const struct flash_area **fa)
+{
+    if (id == BOOT_RAM_SLOT_ID) {
+        *fa = &boot_ram_slot;
+        return 0;
+    }
+
+    return __real_flash_area_open(id, fa);
+}
+
+void __wrap_flash_area_close(const struct flash_area *fa)
+{
+    if (!flash_area_is_ram(fa)) {
+        __real_flash_area_close(fa);
+    }
+}
+
+int __wrap_flash_area_read(const struct flash_area *fa, off_t off, void *dst,
+                           size_t len)
+{
+    void *src;
+
+    if (!flash_area_is_ram(fa)) {
+        return __real_flash_area_read(fa, off, dst, len);
+    }
+
+    src = boot_ram_slot_ptr(off, len);
+    if (src == NULL) {
+        return -EINVAL;
+    }
+    memcpy(dst, src, len);
+
+    return 0;
+}
+
+int __wrap_flash_area_write(const struct flash_area *fa, off_t off,
+                            const void *src, size_t len)
+{
+    void *dst;
+
+    if (!flash_area_is_ram(fa)) {
+        return __real_flash_area_write(fa, off, src, len);
+    }
+
+    dst = boot_ram_slot_ptr(off, len);
+    if (dst == NULL) {
+        return -EINVAL;
+    }
+    memcpy(dst, src, len);
+
+    return 0;
+}
+
+int __wrap_flash_area_erase(const struct flash_area *fa, off_t off,
+                            size_t len)
+{
+    void *dst;
+
+    if (!flash_area_is_ram(fa)) {
+        return __real_flash_area_erase(fa, off, len);
+    }
+
+    dst = boot_ram_slot_ptr(off, len);
+    if (dst == NULL) {
+        return -EINVAL;
+    }
+    memset(dst, BOOT_RAM_SLOT_ERASED, len);
+
+    return 0;
+}
+
+uint32_t __wrap_flash_area_align(const struct flash_area *fa)
+{
+    if (!flash_area_is_ram(fa)) {
+        return __real_flash_area_align(fa);
+    }
+
+    return BOOT_RAM_SLOT_ALIGN;
+}
+
+int __wrap_flash_area_get_sectors(int fa_id, uint32_t *count,
+                                  struct flash_sector *sectors)
+{
+    uint32_t i;
+
+    if (fa_id != BOOT_RAM_SLOT_ID) {
+        return __real_flash_area_get_sectors(fa_id, count, sectors);
+    }
+
+    if (*count < BOOT_RAM_SLOT_SIZE / BOOT_RAM_SLOT_SECTOR) {
+        return -ENOMEM;
+    }
+
+    *count = BOOT_RAM_SLOT_SIZE / BOOT_RAM_SLOT_SECTOR;
+    for (i = 0; i < *count; i++) {
+        sectors[i].fs_off = i * BOOT_RAM_SLOT_SECTOR;
+        sectors[i].fs_size = BOOT_RAM_SLOT_SECTOR;
+    }
+
+    return 0;
+}
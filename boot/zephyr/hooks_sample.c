@@ -51,6 +51,25 @@ fih_ret boot_image_check_hook(int img_index, int slot)
     FIH_RET(FIH_BOOT_HOOK_REGULAR);
 }
 
+#ifdef CONFIG_BOOT_IMAGE_VERDICT_HOOKS
+/* A real implementation keeps its verdicts where the application can not
+ * forge them, e.g. in a secure element, and drops them as soon as the slot
+ * is written. This one never has a verdict.
+ */
+fih_ret boot_image_verdict_lookup_hook(int img_index, int slot,
+                                       const uint8_t *hdr_digest,
+                                       const uint8_t *img_hash)
+{
+    FIH_RET(FIH_BOOT_HOOK_REGULAR);
+}
+
+void boot_image_verdict_store_hook(int img_index, int slot,
+                                   const uint8_t *hdr_digest,
+                                   const uint8_t *img_hash, fih_ret fih_rc)
+{
+}
+#endif
+
 int boot_perform_update_hook(int img_index, struct image_header *img_head,
                              const struct flash_area *area)
 {
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef H_BOOT_LOG_RETAINED_
+#define H_BOOT_LOG_RETAINED_
+
+#include <stdint.h>
+
+/*
+ * Layout of the boot log stored by CONFIG_BOOT_LOG_RETAINED in the retention
+ * partition chosen as "mcuboot,boot-log". The application reads it with the
+ * retention API and formats it, after the header, one record at a time.
+ *
+ * Each record is a boot_log_retained_record followed by the cbprintf package
+ * of the message, which cbpprintf() formats. The format strings of the
+ * packages point into the MCUboot image, so they can only be formatted while
+ * it is still mapped at the same address. Records start on
+ * BOOT_LOG_RETAINED_ALIGN byte boundaries.
+ */
+
+#define BOOT_LOG_RETAINED_MAGIC 0x4d424c47 /* "MBLG" */
+#define BOOT_LOG_RETAINED_ALIGN 8
+
+struct boot_log_retained_header {
+    uint32_t magic;
+    /* Size of the records following the header */
+    uint16_t size;
+    /* Number of messages which did not fit */
+    uint16_t dropped;
+};
+
+struct boot_log_retained_record {
+    /* Size of the package following the record */
+    uint16_t len;
+    /* Zephyr log level of the message */
+    uint8_t level;
+    uint8_t reserved[5];
+};
+
+#endif /* H_BOOT_LOG_RETAINED_ */
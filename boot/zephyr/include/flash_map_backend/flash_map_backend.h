@@ -44,6 +44,14 @@ extern "C" {
  */
 int flash_device_base(uint8_t fd_id, uintptr_t *ret);
 
+/*
+ * Retrieve the address at which a flash area can be read directly through
+ * memory. Only available with CONFIG_BOOT_HASH_MMAP_FLASH.
+ *
+ * Returns 0 on success, or -ENOTSUP if the area is not memory mapped.
+ */
+int flash_area_get_mapped_addr(const struct flash_area *fa, uintptr_t *addr);
+
 int flash_area_id_from_image_slot(int slot);
 int flash_area_id_from_multi_image_slot(int image_index, int slot);
 
@@ -95,6 +103,15 @@ static inline uint32_t flash_sector_get_size(const struct flash_sector *fs)
 	return fs->fs_size;
 }
 
+#ifdef CONFIG_BOOT_SECONDARY_RAM
+/*
+ * Whether a flash area is the secondary slot kept in RAM, and the address of
+ * this RAM, see flash_map_ram.c.
+ */
+bool flash_area_is_ram(const struct flash_area *fa);
+uintptr_t flash_area_ram_addr(const struct flash_area *fa);
+#endif
+
 /* Retrieve the flash sector withing given flash area, at a given offset.
  *
  * @param fa        flash area where the sector is taken from.
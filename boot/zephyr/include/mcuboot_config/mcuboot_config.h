@@ -20,10 +20,16 @@
 #  else
 #    define MCUBOOT_SIGN_RSA_LEN CONFIG_BOOT_SIGNATURE_TYPE_RSA_LEN
 #  endif
+#  ifdef CONFIG_BOOT_RSA_MONT
+#    define MCUBOOT_RSA_MONT
+#  endif
 #elif defined(CONFIG_BOOT_SIGNATURE_TYPE_ECDSA_P256)
 #define MCUBOOT_SIGN_EC256
 #elif defined(CONFIG_BOOT_SIGNATURE_TYPE_ED25519)
 #define MCUBOOT_SIGN_ED25519
+#  ifdef CONFIG_BOOT_CURVE25519_FIXED_DER
+#    define MCUBOOT_CURVE25519_FIXED_DER
+#  endif
 #endif
 
 #if defined(CONFIG_BOOT_USE_TINYCRYPT)
@@ -38,6 +44,9 @@
 #define MCUBOOT_USE_MBED_TLS
 #elif defined(CONFIG_BOOT_USE_TINYCRYPT)
 #define MCUBOOT_USE_TINYCRYPT
+#ifdef CONFIG_BOOT_ECDSA_P256_COMB
+#define MCUBOOT_ECDSA_P256_COMB
+#endif
 #elif defined(CONFIG_BOOT_USE_CC310)
 #define MCUBOOT_USE_CC310
 #ifdef CONFIG_BOOT_USE_NRF_CC310_BL
@@ -55,6 +64,10 @@
 #define MCUBOOT_SHA256
 #endif
 
+#ifdef CONFIG_BOOT_SHA256_FAST
+#define MCUBOOT_SHA256_FAST
+#endif
+
 /* Zephyr, regardless of C library used, provides snprintf */
 #define MCUBOOT_USE_SNPRINTF 1
 
@@ -70,11 +83,156 @@
 #define MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE
 #endif
 
+#ifdef CONFIG_BOOT_VALIDATION_CACHE
+#define MCUBOOT_VALIDATION_CACHE
+#endif
+
+#ifdef CONFIG_BOOT_VALIDATION_CACHE_UPGRADE
+#define MCUBOOT_VALIDATION_CACHE_UPGRADE
+#endif
+
+#ifdef CONFIG_BOOT_PENDING_DIGEST
+#define MCUBOOT_PENDING_DIGEST
+#endif
+
+#ifdef CONFIG_BOOT_INDEX
+#define MCUBOOT_BOOT_INDEX
+#endif
+
+#ifdef CONFIG_BOOT_PARALLEL_VALIDATION
+#define MCUBOOT_PARALLEL_VALIDATION
+#endif
+
+#ifdef CONFIG_BOOT_KEY_HASH_CACHE
+#define MCUBOOT_KEY_HASH_CACHE
+#define MCUBOOT_KEY_HASH_CACHE_SIZE CONFIG_BOOT_KEY_HASH_CACHE_SIZE
+#endif
+
+#ifdef CONFIG_BOOT_KEY_CONTEXT_CACHE
+#define MCUBOOT_KEY_CONTEXT_CACHE
+#define MCUBOOT_KEY_CONTEXT_CACHE_SIZE CONFIG_BOOT_KEY_CONTEXT_CACHE_SIZE
+#endif
+
+#ifdef CONFIG_BOOT_CRYPTO_ARENA
+#define MCUBOOT_CRYPTO_ARENA
+#endif
+
+#ifdef CONFIG_BOOT_WORK_ARENA
+#define MCUBOOT_WORK_ARENA
+#endif
+
+#ifdef CONFIG_BOOT_TLV_INDEX
+#define MCUBOOT_TLV_INDEX
+#define MCUBOOT_TLV_INDEX_MAX_ENTRIES CONFIG_BOOT_TLV_INDEX_MAX_ENTRIES
+#endif
+
+#ifdef CONFIG_BOOT_HASH_CHUNKS
+#define MCUBOOT_HASH_CHUNKS
+#endif
+
+#ifdef CONFIG_BOOT_SECTOR_DIGESTS
+#define MCUBOOT_SECTOR_DIGESTS
+#endif
+
+#ifdef CONFIG_BOOT_DELTA_IMAGES
+#define MCUBOOT_DELTA_IMAGES
+#endif
+
+#ifdef CONFIG_BOOT_DELTA_ARM_THUMB
+#define MCUBOOT_DELTA_ARM_THUMB
+#endif
+
+#ifdef CONFIG_BOOT_HASH_MMAP_FLASH
+#define MCUBOOT_HASH_MMAP_FLASH
+#endif
+
+#ifdef CONFIG_BOOT_SKIP_ERASED_SECTORS
+#define MCUBOOT_SKIP_ERASED_SECTORS
+#endif
+
+#ifdef CONFIG_BOOT_FLASH_AREA_IS_ERASED
+#define MCUBOOT_FLASH_AREA_IS_ERASED
+#endif
+
+#ifdef CONFIG_BOOT_SWAP_SKIP_UNCHANGED
+#define MCUBOOT_SWAP_SKIP_UNCHANGED
+#endif
+
+#if defined(CONFIG_BOOT_SWAP_STATUS_MAX_ENTRIES) && (CONFIG_BOOT_SWAP_STATUS_MAX_ENTRIES > 0)
+#define MCUBOOT_SWAP_STATUS_MAX_ENTRIES CONFIG_BOOT_SWAP_STATUS_MAX_ENTRIES
+#endif
+
+#if defined(CONFIG_BOOT_SWAP_SCRATCH_WINDOW_SIZE) && (CONFIG_BOOT_SWAP_SCRATCH_WINDOW_SIZE > 0)
+#define MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE CONFIG_BOOT_SWAP_SCRATCH_WINDOW_SIZE
+#endif
+
+#ifdef CONFIG_BOOT_SWAP_STATUS_PACKED
+#define MCUBOOT_SWAP_STATUS_PACKED
+#endif
+
+#ifdef CONFIG_BOOT_SWAP_STATUS_PARTITION
+#define MCUBOOT_SWAP_STATUS_PARTITION
+#endif
+
+#ifdef CONFIG_BOOT_COPY_BUF_SIZE
+#define MCUBOOT_COPY_BUF_SIZE CONFIG_BOOT_COPY_BUF_SIZE
+#endif
+
+#ifdef CONFIG_BOOT_COPY_VERIFY
+#define MCUBOOT_COPY_VERIFY
+#define MCUBOOT_COPY_VERIFY_RETRIES CONFIG_BOOT_COPY_VERIFY_RETRIES
+#endif
+
+#ifdef CONFIG_BOOT_HASH_PIPELINE
+#define MCUBOOT_HASH_PIPELINE
+#define MCUBOOT_HASH_PIPELINE_BUF_SIZE CONFIG_BOOT_HASH_PIPELINE_BUF_SIZE
+#endif
+
+#ifdef CONFIG_BOOT_FLASH_AREA_READ_ASYNC
+#define MCUBOOT_FLASH_AREA_READ_ASYNC
+#endif
+
+#ifdef CONFIG_BOOT_FLASH_AREA_COPY
+#define MCUBOOT_FLASH_AREA_COPY
+#endif
+
+#ifdef CONFIG_BOOT_COPY_PIPELINE
+#define MCUBOOT_COPY_PIPELINE
+#endif
+
+#ifdef CONFIG_BOOT_FLASH_AREA_WRITE_ASYNC
+#define MCUBOOT_FLASH_AREA_WRITE_ASYNC
+#endif
+
+#ifdef CONFIG_BOOT_FLASH_AREA_ERASE_ASYNC
+#define MCUBOOT_FLASH_AREA_ERASE_ASYNC
+#endif
+
 #ifdef CONFIG_BOOT_UPGRADE_ONLY
 #define MCUBOOT_OVERWRITE_ONLY
 #define MCUBOOT_OVERWRITE_ONLY_FAST
 #endif
 
+#ifdef CONFIG_BOOT_UPGRADE_ONLY_VERIFY_COPY
+#define MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY
+#endif
+
+#ifdef CONFIG_BOOT_UPGRADE_ONLY_RESUME
+#define MCUBOOT_OVERWRITE_ONLY_RESUME
+#endif
+
+#ifdef CONFIG_BOOT_UPGRADE_ONLY_TOMBSTONE
+#define MCUBOOT_OVERWRITE_ONLY_TOMBSTONE
+#endif
+
+#ifdef CONFIG_BOOT_ERASE_AHEAD
+#define MCUBOOT_ERASE_AHEAD
+#endif
+
+#ifdef CONFIG_BOOT_IMAGE_SOURCE
+#define MCUBOOT_IMAGE_SOURCE
+#endif
+
 #ifdef CONFIG_SINGLE_APPLICATION_SLOT
 #define MCUBOOT_SINGLE_APPLICATION_SLOT 1
 #define MCUBOOT_IMAGE_NUMBER    1
@@ -84,6 +242,14 @@
 #define MCUBOOT_SWAP_USING_MOVE 1
 #endif
 
+#ifdef CONFIG_BOOT_SWAP_USING_OFFSET
+#define MCUBOOT_SWAP_USING_OFFSET 1
+#endif
+
+#ifdef CONFIG_BOOT_SWAP_USING_BANK
+#define MCUBOOT_SWAP_USING_BANK 1
+#endif
+
 #ifdef CONFIG_BOOT_DIRECT_XIP
 #define MCUBOOT_DIRECT_XIP
 #endif
@@ -92,12 +258,41 @@
 #define MCUBOOT_DIRECT_XIP_REVERT
 #endif
 
+#ifdef CONFIG_BOOT_DIRECT_XIP_REVERT_FAST
+#define MCUBOOT_DIRECT_XIP_REVERT_FAST
+#endif
+
+#ifdef CONFIG_BOOT_INVALIDATE_SLOT_FAST
+#define MCUBOOT_INVALIDATE_SLOT_FAST
+#endif
+
 #ifdef CONFIG_BOOT_RAM_LOAD
 #define MCUBOOT_RAM_LOAD 1
 #define IMAGE_EXECUTABLE_RAM_START CONFIG_BOOT_IMAGE_EXECUTABLE_RAM_START
 #define IMAGE_EXECUTABLE_RAM_SIZE CONFIG_BOOT_IMAGE_EXECUTABLE_RAM_SIZE
 #endif
 
+#ifdef CONFIG_BOOT_RAM_CLEAR
+#define MCUBOOT_RAM_CLEAR
+#endif
+
+#ifdef CONFIG_BOOT_RAM_LOAD_HASH_COPY
+#define MCUBOOT_RAM_LOAD_HASH_COPY
+#define MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE CONFIG_BOOT_RAM_LOAD_COPY_CHUNK_SIZE
+#endif
+
+#ifdef CONFIG_BOOT_RAM_LOAD_PARALLEL
+#define MCUBOOT_RAM_LOAD_PARALLEL
+#endif
+
+#ifdef CONFIG_BOOT_RAM_LOAD_RESIDENT
+#define MCUBOOT_RAM_LOAD_RESIDENT
+#endif
+
+#ifdef CONFIG_BOOT_RAM_LOAD_STAGED
+#define MCUBOOT_RAM_LOAD_STAGED
+#endif
+
 #ifdef CONFIG_BOOT_FIRMWARE_LOADER
 #define MCUBOOT_FIRMWARE_LOADER
 #endif
@@ -116,6 +311,11 @@
 #define MCUBOOT_SWAP_SAVE_ENCTLV 1
 #endif
 
+#ifdef CONFIG_BOOT_SWAP_SAVE_WRAPPED_ENCKEY
+#define MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY
+#define MCUBOOT_SWAP_WRAPPED_ENCKEY_SIZE CONFIG_BOOT_SWAP_WRAPPED_ENCKEY_SIZE
+#endif
+
 #endif /* CONFIG_SINGLE_APPLICATION_SLOT */
 
 #ifdef CONFIG_SINGLE_APPLICATION_SLOT_RAM_LOAD
@@ -145,18 +345,61 @@
 #define MCUBOOT_ENCRYPT_X25519
 #endif
 
+#ifdef CONFIG_BOOT_ENCRYPT_KEYSTREAM_BLOCKS
+#define MCUBOOT_ENC_KEYSTREAM_BLOCKS CONFIG_BOOT_ENCRYPT_KEYSTREAM_BLOCKS
+#endif
+
+#ifdef CONFIG_BOOT_ENCRYPT_GCM
+#define MCUBOOT_ENC_GCM
+#endif
+
+#ifdef CONFIG_BOOT_ENCRYPT_XIP
+#define MCUBOOT_ENC_XIP
+#endif
+
 #ifdef CONFIG_BOOT_DECOMPRESSION
 #define MCUBOOT_DECOMPRESS_IMAGES
+#define MCUBOOT_DECOMPRESSION_BUFFER_SIZE CONFIG_BOOT_DECOMPRESSION_BUFFER_SIZE
+#ifdef CONFIG_BOOT_DECOMPRESSION_LZMA2
+#define MCUBOOT_DECOMPRESS_LZMA2
+#endif
+#ifdef CONFIG_BOOT_DECOMPRESSION_LZ4
+#define MCUBOOT_DECOMPRESS_LZ4
+#endif
 #endif
 
 #ifdef CONFIG_BOOT_BOOTSTRAP
 #define MCUBOOT_BOOTSTRAP 1
 #endif
 
+#ifdef CONFIG_BOOT_BOOTSTRAP_VERIFY_COPY
+#define MCUBOOT_BOOTSTRAP_VERIFY_COPY
+#endif
+
 #ifdef CONFIG_BOOT_USE_BENCH
 #define MCUBOOT_USE_BENCH 1
 #endif
 
+#ifdef CONFIG_BOOT_PROFILE
+#define MCUBOOT_BOOT_PROFILE 1
+#endif
+
+#ifdef CONFIG_BOOT_PROFILE_STACK
+#define MCUBOOT_BOOT_PROFILE_STACK 1
+#endif
+
+#ifdef CONFIG_MCUBOOT_ACTION_HOOKS_PROGRESS
+#include <zephyr/kernel.h>
+
+#define MCUBOOT_UPGRADE_PROGRESS 1
+#define MCUBOOT_UPTIME_MS() k_uptime_get_32()
+#endif
+
+#ifdef CONFIG_BOOT_FLASH_STATS
+#define MCUBOOT_FLASH_STATS 1
+#define MCUBOOT_FLASH_STATS_AREAS CONFIG_BOOT_FLASH_STATS_AREAS
+#endif
+
 #ifdef CONFIG_MCUBOOT_DOWNGRADE_PREVENTION
 #define MCUBOOT_DOWNGRADE_PREVENTION 1
 /* MCUBOOT_DOWNGRADE_PREVENTION_SECURITY_COUNTER is used later as bool value so it is
@@ -173,6 +416,14 @@
 #define MCUBOOT_HW_ROLLBACK_PROT
 #endif
 
+#ifdef CONFIG_MCUBOOT_HW_DOWNGRADE_PREVENTION_CACHE
+#define MCUBOOT_HW_ROLLBACK_PROT_CACHE
+#endif
+
+#ifdef CONFIG_MCUBOOT_HW_DOWNGRADE_PREVENTION_BATCH
+#define MCUBOOT_HW_ROLLBACK_PROT_BATCH
+#endif
+
 #ifdef CONFIG_MEASURED_BOOT
 #define MCUBOOT_MEASURED_BOOT
 #endif
@@ -209,6 +460,10 @@
 #define MCUBOOT_FIH_PROFILE_HIGH
 #endif
 
+#ifdef CONFIG_BOOT_FIH_DELAY_RNG_CSRAND
+#define MCUBOOT_FIH_DELAY_RNG_PLATFORM
+#endif
+
 #ifdef CONFIG_ENABLE_MGMT_PERUSER
 #define MCUBOOT_PERUSER_MGMT_GROUP_ENABLED 1
 #else
@@ -227,6 +482,18 @@
 #define MCUBOOT_IMAGE_ACCESS_HOOKS
 #endif
 
+#ifdef CONFIG_BOOT_IMAGE_VERDICT_HOOKS
+#define MCUBOOT_IMAGE_VERDICT_HOOKS
+#endif
+
+#ifdef CONFIG_BOOT_GO_STEP
+#define MCUBOOT_BOOT_STEP
+#endif
+
+#ifdef CONFIG_BOOT_PERF_HOOKS
+#define MCUBOOT_PERF_HOOKS
+#endif
+
 #ifdef CONFIG_MCUBOOT_VERIFY_IMG_ADDRESS
 #define MCUBOOT_VERIFY_IMG_ADDRESS
 #endif
@@ -308,10 +575,84 @@
 #define MCUBOOT_MAX_IMG_SECTORS       128
 #endif
 
+#ifdef CONFIG_BOOT_SECTOR_RUNS
+#define MCUBOOT_SECTOR_RUNS
+#define MCUBOOT_MAX_SECTOR_RUNS       CONFIG_BOOT_MAX_SECTOR_RUNS
+#endif
+
+#ifdef CONFIG_BOOT_SWAP_PERM_DISCARD
+#define MCUBOOT_SWAP_PERM_DISCARD
+#endif
+
+#ifdef CONFIG_BOOT_LAZY_SECTORS
+#define MCUBOOT_LAZY_SECTORS
+#endif
+
 #ifdef CONFIG_BOOT_SERIAL_MAX_RECEIVE_SIZE
 #define MCUBOOT_SERIAL_MAX_RECEIVE_SIZE CONFIG_BOOT_SERIAL_MAX_RECEIVE_SIZE
 #endif
 
+#ifdef CONFIG_BOOT_SERIAL_UPLOAD_HASH
+#define MCUBOOT_SERIAL_UPLOAD_HASH
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_RAM_UPLOAD
+#define MCUBOOT_SERIAL_RAM_UPLOAD
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_SLOT_CACHE
+#define MCUBOOT_SERIAL_SLOT_CACHE
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_UPLOAD_RESUME
+#define MCUBOOT_SERIAL_UPLOAD_RESUME
+#define MCUBOOT_SERIAL_UPLOAD_RESUME_INTERVAL CONFIG_BOOT_SERIAL_UPLOAD_RESUME_INTERVAL
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_DECOMPRESS
+#define MCUBOOT_SERIAL_DECOMPRESS
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_RAW_FRAMING
+#define MCUBOOT_SERIAL_RAW_FRAMING
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_FAST_FRAMING
+#define MCUBOOT_SERIAL_FAST_FRAMING
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_BACKGROUND_ERASE
+#define MCUBOOT_SERIAL_BACKGROUND_ERASE
+#define MCUBOOT_SERIAL_BACKGROUND_ERASE_JOBS CONFIG_BOOT_SERIAL_BACKGROUND_ERASE_JOBS
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_BAUD_SWITCH
+#include <zephyr/kernel.h>
+
+#define MCUBOOT_SERIAL_BAUD_SWITCH
+#define MCUBOOT_SERIAL_BAUD_MAX CONFIG_BOOT_SERIAL_BAUD_MAX
+#define MCUBOOT_SERIAL_BAUD_TIMEOUT_MS CONFIG_BOOT_SERIAL_BAUD_TIMEOUT
+#ifndef MCUBOOT_UPTIME_MS
+#define MCUBOOT_UPTIME_MS() k_uptime_get_32()
+#endif
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_ASYNC_WRITE
+#define MCUBOOT_SERIAL_ASYNC_WRITE
+#endif
+
+#if defined(CONFIG_BOOT_SERIAL_ERASE_AHEAD) && CONFIG_BOOT_SERIAL_ERASE_AHEAD > 0
+#define MCUBOOT_SERIAL_ERASE_AHEAD CONFIG_BOOT_SERIAL_ERASE_AHEAD
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_UPLOAD_SESSIONS
+#define MCUBOOT_SERIAL_UPLOAD_SESSIONS
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_UPLOAD_WINDOW
+#define MCUBOOT_SERIAL_UPLOAD_WINDOW CONFIG_BOOT_SERIAL_UPLOAD_WINDOW
+#endif
+
 #ifdef CONFIG_BOOT_SERIAL_UNALIGNED_BUFFER_SIZE
 #define MCUBOOT_SERIAL_UNALIGNED_BUFFER_SIZE CONFIG_BOOT_SERIAL_UNALIGNED_BUFFER_SIZE
 #endif
@@ -408,6 +749,9 @@
     do {                                \
     } while (0)
 
+#if CONFIG_BOOT_WATCHDOG_FEED_BYTES > 0
+#define MCUBOOT_WATCHDOG_FEED_BYTES CONFIG_BOOT_WATCHDOG_FEED_BYTES
+#endif
 #endif /* CONFIG_BOOT_WATCHDOG_FEED */
 
 #ifndef MCUBOOT_WATCHDOG_SETUP
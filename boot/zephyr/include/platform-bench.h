@@ -22,11 +22,18 @@
 #include "zephyr.h"
 #include "bootutil/bootutil_log.h"
 
-/* TODO: Unclear if this can be here (redundantly). */
-BOOT_LOG_MODULE_DECLARE(mcuboot);
+/* The log module is the one declared by the file using the macros, this
+ * header is included by every bootutil source when the boot-phase profiler
+ * is enabled. */
 
 typedef uint32_t bench_state_t;
 
+#define plat_bench_cycles() k_cycle_get_32()
+
+/* The bootloader runs on the main thread. */
+#define plat_bench_stack_start() (k_current_get()->stack_info.start)
+#define plat_bench_stack_size() (k_current_get()->stack_info.size)
+
 #define plat_bench_start(_s) do { \
     BOOT_LOG_ERR("start benchmark"); \
     *(_s) = k_cycle_get_32(); \
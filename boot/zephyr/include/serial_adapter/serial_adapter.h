@@ -17,6 +17,9 @@
 #ifndef H_SERIAL_ADAPTER
 #define H_SERIAL_ADAPTER
 
+#include <stdbool.h>
+#include <stdint.h>
+
 int
 console_out(int c);
 
@@ -29,4 +32,16 @@ boot_console_init(void);
 int
 console_read(char *str, int str_cnt, int *newline);
 
+#ifdef CONFIG_BOOT_SERIAL_BAUD_SWITCH
+/* Switches the uart to the given baud rate, 0 for the one it had at boot. */
+int
+console_set_baud(uint32_t baud);
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_WAIT_FOR_DFU_ON_RX
+/* Tells whether a line starting like an mcumgr frame has been received. */
+bool
+console_frame_started(void);
+#endif
+
 #endif // SERIAL_ADAPTER
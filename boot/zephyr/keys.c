@@ -34,9 +34,15 @@
 #if defined(MCUBOOT_SIGN_RSA)
 extern const unsigned char rsa_pub_key[];
 extern unsigned int rsa_pub_key_len;
+#ifdef MCUBOOT_RSA_MONT
+extern const struct bootutil_rsa_mont rsa_pub_key_mont;
+#endif
 #elif defined(MCUBOOT_SIGN_EC256)
 extern const unsigned char ecdsa_pub_key[];
 extern unsigned int ecdsa_pub_key_len;
+#ifdef MCUBOOT_ECDSA_P256_COMB
+extern const struct bootutil_ecdsa_comb ecdsa_pub_key_comb;
+#endif
 #elif defined(MCUBOOT_SIGN_ED25519)
 extern const unsigned char ed25519_pub_key[];
 extern unsigned int ed25519_pub_key_len;
@@ -54,9 +60,15 @@ const struct bootutil_key bootutil_keys[] = {
 #if defined(MCUBOOT_SIGN_RSA)
         .key = rsa_pub_key,
         .len = &rsa_pub_key_len,
+#ifdef MCUBOOT_RSA_MONT
+        .mont = &rsa_pub_key_mont,
+#endif
 #elif defined(MCUBOOT_SIGN_EC256)
         .key = ecdsa_pub_key,
         .len = &ecdsa_pub_key_len,
+#ifdef MCUBOOT_ECDSA_P256_COMB
+        .comb = &ecdsa_pub_key_comb,
+#endif
 #elif defined(MCUBOOT_SIGN_ED25519)
         .key = ed25519_pub_key,
         .len = &ed25519_pub_key_len,
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/retention/retention.h>
+#include <zephyr/logging/log_backend.h>
+#include <zephyr/logging/log_msg.h>
+#include <zephyr/sys/util.h>
+
+#include "boot_log_retained.h"
+
+/*
+ * Log backend storing the messages as they were packaged by the logging
+ * subsystem, instead of formatting and outputting them, so that the time
+ * spent processing the log while booting does not depend on its verbosity.
+ */
+
+static const struct device *boot_log_dev = DEVICE_DT_GET(DT_CHOSEN(mcuboot_boot_log));
+static struct boot_log_retained_header boot_log_hdr;
+static size_t boot_log_max_size;
+
+BUILD_ASSERT(sizeof(struct boot_log_retained_header) == BOOT_LOG_RETAINED_ALIGN &&
+             sizeof(struct boot_log_retained_record) == BOOT_LOG_RETAINED_ALIGN,
+             "boot log records must keep the packages aligned");
+
+static void boot_log_write_header(void)
+{
+    (void)retention_write(boot_log_dev, 0, (const uint8_t *)&boot_log_hdr,
+                          sizeof(boot_log_hdr));
+}
+
+static void boot_log_retained_process(const struct log_backend *const backend,
+                                      union log_msg_generic *msg)
+{
+    struct boot_log_retained_record rec = {0};
+    size_t off = sizeof(boot_log_hdr) + boot_log_hdr.size;
+    size_t len;
+    uint8_t *package = log_msg_get_package(&msg->log, &len);
+
+    ARG_UNUSED(backend);
+
+    if (off + sizeof(rec) + len > boot_log_max_size || len > UINT16_MAX) {
+        boot_log_hdr.dropped++;
+        boot_log_write_header();
+        return;
+    }
+
+    rec.len = len;
+    rec.level = log_msg_get_level(&msg->log);
+
+    if (retention_write(boot_log_dev, off, (const uint8_t *)&rec, sizeof(rec)) != 0 ||
+        retention_write(boot_log_dev, off + sizeof(rec), package, len) != 0) {
+        boot_log_hdr.dropped++;
+    } else {
+        boot_log_hdr.size += ROUND_UP(sizeof(rec) + len, BOOT_LOG_RETAINED_ALIGN);
+    }
+    boot_log_write_header();
+}
+
+static void boot_log_retained_init(const struct log_backend *const backend)
+{
+    ssize_t size = retention_size(boot_log_dev);
+
+    ARG_UNUSED(backend);
+
+    (void)retention_clear(boot_log_dev);
+    /* The size of the records is kept on 16 bits */
+    size = CLAMP(size, 0, (ssize_t)sizeof(boot_log_hdr) + UINT16_MAX);
+    boot_log_max_size = ROUND_DOWN(size, BOOT_LOG_RETAINED_ALIGN);
+    boot_log_hdr.magic = BOOT_LOG_RETAINED_MAGIC;
+    boot_log_write_header();
+}
+
+static void boot_log_retained_panic(const struct log_backend *const backend)
+{
+    ARG_UNUSED(backend);
+}
+
+static void boot_log_retained_dropped(const struct log_backend *const backend,
+                                      uint32_t cnt)
+{
+    ARG_UNUSED(backend);
+
+    boot_log_hdr.dropped += MIN(cnt, UINT16_MAX - boot_log_hdr.dropped);
+    boot_log_write_header();
+}
+
+static const struct log_backend_api boot_log_retained_api = {
+    .process = boot_log_retained_process,
+    .init = boot_log_retained_init,
+    .panic = boot_log_retained_panic,
+    .dropped = boot_log_retained_dropped,
+};
+
+LOG_BACKEND_DEFINE(boot_log_retained, boot_log_retained_api, true);
@@ -27,7 +27,7 @@
 #include <soc.h>
 #include <zephyr/linker/linker-defs.h>
 
-#if defined(CONFIG_BOOT_DISABLE_CACHES)
+#if defined(CONFIG_BOOT_DISABLE_CACHES) || defined(CONFIG_BOOT_ENABLE_CACHES)
 #include <zephyr/cache.h>
 #endif
 
@@ -43,6 +43,14 @@
 #include "bootutil/bootutil.h"
 #include "bootutil/fault_injection_hardening.h"
 #include "bootutil/mcuboot_status.h"
+#include "bootutil/bench.h"
+#include "bootutil/flash_stats.h"
+#ifdef CONFIG_BOOT_GO_STEP
+#include "bootutil/boot_step.h"
+#endif
+#ifdef CONFIG_BOOT_RAM_CLEAR
+#include "bootutil/ramload.h"
+#endif
 #include "flash_map_backend/flash_map_backend.h"
 
 /* Check if Espressif target is supported */
@@ -75,7 +83,10 @@
 
 const struct boot_uart_funcs boot_funcs = {
     .read = console_read,
-    .write = console_write
+    .write = console_write,
+#ifdef CONFIG_BOOT_SERIAL_BAUD_SWITCH
+    .set_baud = console_set_baud,
+#endif
 };
 #endif
 
@@ -132,6 +143,9 @@ K_SEM_DEFINE(boot_log_sem, 1, 1);
 BOOT_LOG_MODULE_REGISTER(mcuboot);
 
 void os_heap_init(void);
+#ifdef CONFIG_BOOT_MBEDTLS_POOL_HEAP
+size_t os_heap_high_water(void);
+#endif
 
 #if defined(CONFIG_ARM)
 
@@ -144,9 +158,53 @@ struct arm_vector_table {
     uint32_t reset;
 };
 
+#if CONFIG_MCUBOOT_CLEANUP_RAM && defined(CONFIG_BOOT_RAM_CLEAR)
+#if CONFIG_MCUBOOT_CLEANUP_RAM_BOOT_ONLY
+#define CLEANUP_RAM_START   ((uintptr_t)_image_ram_start)
+#define CLEANUP_RAM_END     ((uintptr_t)_image_ram_end)
+#else
+#define CLEANUP_RAM_START   ((uintptr_t)CONFIG_SRAM_BASE_ADDRESS)
+#define CLEANUP_RAM_END     ((uintptr_t)CONFIG_SRAM_BASE_ADDRESS + \
+                             CONFIG_SRAM_SIZE * 1024)
+#endif
+
+/*
+ * Clears the RAM to be cleaned up with boot_ram_clear(), except for the
+ * stack of the current thread, and narrows start and end down to that stack,
+ * which is only cleared once it is no longer used.
+ */
+static void cleanup_ram_but_stack(uintptr_t *start, uintptr_t *end)
+{
+    uintptr_t stack_start = k_current_get()->stack_info.start;
+    uintptr_t stack_end = stack_start + k_current_get()->stack_info.size;
+
+    if (stack_start < *start) {
+        stack_start = *start;
+    }
+    if (stack_end > *end) {
+        stack_end = *end;
+    }
+    if (stack_start >= stack_end) {
+        boot_ram_clear((void *)*start, *end - *start);
+        *start = *end;
+        return;
+    }
+
+    boot_ram_clear((void *)*start, stack_start - *start);
+    boot_ram_clear((void *)stack_end, *end - stack_end);
+    *start = stack_start & ~3U;
+    *end = stack_end;
+}
+#endif
+
 static void do_boot(struct boot_rsp *rsp)
 {
     struct arm_vector_table *vt;
+#if CONFIG_MCUBOOT_CLEANUP_RAM && defined(CONFIG_BOOT_RAM_CLEAR)
+    struct arm_vector_table boot_vt;
+    uintptr_t ram_start = CLEANUP_RAM_START;
+    uintptr_t ram_end = CLEANUP_RAM_END;
+#endif
 
     /* The beginning of the image is the ARM vector table, containing
      * the initial stack pointer address and the reset vector
@@ -194,6 +252,13 @@ static void do_boot(struct boot_rsp *rsp)
     /* Flush and disable instruction/data caches before chain-loading the application */
     (void)sys_cache_instr_flush_all();
     (void)sys_cache_data_flush_all();
+#if defined(CONFIG_BOOT_ENABLE_CACHES)
+    /* Nothing cached while booting may be seen by the application, e.g. the
+     * instructions of an image just loaded to RAM.
+     */
+    (void)sys_cache_instr_invd_all();
+    (void)sys_cache_data_flush_and_invd_all();
+#endif
     sys_cache_instr_disable();
     sys_cache_data_disable();
 #endif
@@ -231,6 +296,13 @@ static void do_boot(struct boot_rsp *rsp)
 #endif
 #endif /* CONFIG_BOOT_INTR_VEC_RELOC */
 
+#if CONFIG_MCUBOOT_CLEANUP_RAM && defined(CONFIG_BOOT_RAM_CLEAR)
+    /* The vector table read from the image may be in the RAM cleared. */
+    boot_vt = *vt;
+    vt = &boot_vt;
+    cleanup_ram_but_stack(&ram_start, &ram_end);
+#endif
+
     __set_MSP(vt->msp);
 #if CONFIG_MCUBOOT_CLEANUP_ARM_CORE
     __set_CONTROL(0x00); /* application will configures core on its own */
@@ -244,22 +316,40 @@ static void do_boot(struct boot_rsp *rsp)
         "   mov     r1, %1\n"
         /* size to write -> r2 */
         "   mov     r2, %2\n"
-        /* value to write -> r3 */
+        /* value to write -> r3-r6 */
         "   mov     r3, %3\n"
-        "clear:\n"
-        "   str     r3, [r1]\n"
-        "   add     r1, r1, #4\n"
+        "   mov     r4, r3\n"
+        "   mov     r5, r3\n"
+        "   mov     r6, r3\n"
+        /* 16 bytes at a time, then the remaining words */
+        "1:\n"
+        "   cmp     r2, #16\n"
+        "   blo     2f\n"
+        "   stmia   r1!, {r3-r6}\n"
+        "   sub     r2, r2, #16\n"
+        "   b       1b\n"
+        "2:\n"
+        "   cbz     r2, 3f\n"
+        "   str     r3, [r1], #4\n"
         "   sub     r2, r2, #4\n"
-        "   cbz     r2, out\n"
-        "   b       clear\n"
-        "out:\n"
+        "   b       2b\n"
+        "3:\n"
         "   dsb\n"
         /* jump to reset vector of an app */
         "   bx      r0\n"
         :
+#if defined(CONFIG_BOOT_RAM_CLEAR)
+        /* Only the stack is left */
+        : "r" (vt->reset), "r" (ram_start),
+          "r" ((uint32_t)(ram_end - ram_start) & ~3U), "i" (0)
+#elif CONFIG_MCUBOOT_CLEANUP_RAM_BOOT_ONLY
+        : "r" (vt->reset), "r" (_image_ram_start),
+          "r" ((uint32_t)(_image_ram_end - _image_ram_start) & ~3U), "i" (0)
+#else
         : "r" (vt->reset), "i" (CONFIG_SRAM_BASE_ADDRESS),
           "i" (CONFIG_SRAM_SIZE * 1024), "i" (0)
-        : "r0", "r1", "r2", "r3", "memory"
+#endif
+        : "r0", "r1", "r2", "r3", "r4", "r5", "r6", "memory"
     );
 #else
     ((void (*)(void))vt->reset)();
@@ -272,11 +362,15 @@ static void do_boot(struct boot_rsp *rsp)
 
 #define SRAM_BASE_ADDRESS	0xBE030000
 
-static void copy_img_to_SRAM(int slot, unsigned int hdr_offset)
+/* Only the payload is copied, the header, the TLVs and the rest of the slot
+ * are not needed to run the image.
+ */
+static void copy_img_to_SRAM(int slot, const struct image_header *hdr)
 {
     const struct flash_area *fap;
     int area_id;
     int rc;
+    unsigned int hdr_offset = hdr->ih_hdr_size;
     unsigned char *dst = (unsigned char *)(SRAM_BASE_ADDRESS + hdr_offset);
 
     BOOT_LOG_INF("Copying image to SRAM");
@@ -288,7 +382,12 @@ static void copy_img_to_SRAM(int slot, unsigned int hdr_offset)
         goto done;
     }
 
-    rc = flash_area_read(fap, hdr_offset, dst, fap->fa_size - hdr_offset);
+    if (hdr->ih_img_size > fap->fa_size - hdr_offset) {
+        BOOT_LOG_ERR("image does not fit in its slot\n");
+        goto done;
+    }
+
+    rc = flash_area_read(fap, hdr_offset, dst, hdr->ih_img_size);
     if (rc != 0) {
         BOOT_LOG_ERR("flash_area_read failed with %d\n", rc);
         goto done;
@@ -318,7 +417,7 @@ static void do_boot(struct boot_rsp *rsp)
     start_cpu0_image(IMAGE_INDEX_0, slot, rsp->br_hdr->ih_hdr_size);
 #else
     /* Copy from the flash to HP SRAM */
-    copy_img_to_SRAM(0, rsp->br_hdr->ih_hdr_size);
+    copy_img_to_SRAM(0, rsp->br_hdr);
 
     /* Jump to entry point */
     start = (void *)(SRAM_BASE_ADDRESS + rsp->br_hdr->ih_hdr_size);
@@ -416,6 +515,26 @@ void zephyr_boot_log_stop(void)
         * !defined(CONFIG_LOG_PROCESS_THREAD) && !defined(ZEPHYR_LOG_MODE_MINIMAL)
         */
 
+#ifdef CONFIG_BOOT_SERIAL_RAM_UPLOAD
+void boot_serial_ram_boot(struct boot_rsp *rsp)
+{
+    BOOT_LOG_INF("Jumping to the image uploaded to RAM at 0x%x",
+                 rsp->br_hdr->ih_load_addr);
+
+    mcuboot_status_change(MCUBOOT_STATUS_BOOTABLE_IMAGE_FOUND);
+
+    ZEPHYR_BOOT_LOG_STOP();
+
+    do_boot(rsp);
+
+    mcuboot_status_change(MCUBOOT_STATUS_BOOT_FAILED);
+
+    BOOT_LOG_ERR("Never should get here");
+    while (1)
+        ;
+}
+#endif
+
 #if defined(CONFIG_BOOT_SERIAL_ENTRANCE_GPIO) || defined(CONFIG_BOOT_SERIAL_PIN_RESET) \
     || defined(CONFIG_BOOT_SERIAL_BOOT_MODE) || defined(CONFIG_BOOT_SERIAL_NO_APPLICATION)
 static void boot_serial_enter()
@@ -431,6 +550,7 @@ static void boot_serial_enter()
     BOOT_LOG_INF("Enter the serial recovery mode");
     rc = boot_console_init();
     __ASSERT(rc == 0, "Error initializing boot console.\n");
+    boot_phase_start(BOOT_PHASE_SERIAL);
     boot_serial_start(&boot_funcs);
     __ASSERT(0, "Bootloader serial process was terminated unexpectedly.\n");
 }
@@ -445,6 +565,16 @@ int main(void)
     MCUBOOT_WATCHDOG_SETUP();
     MCUBOOT_WATCHDOG_FEED();
 
+#if defined(CONFIG_BOOT_ENABLE_CACHES)
+    /* Hashing and signature checks run from and read flash much faster with
+     * the caches on; do_boot() cleans and disables them again.
+     */
+    sys_cache_instr_enable();
+#if defined(CONFIG_BOOT_ENABLE_DCACHE)
+    sys_cache_data_enable();
+#endif
+#endif
+
 #if !defined(MCUBOOT_DIRECT_XIP)
     BOOT_LOG_INF("Starting bootloader");
 #else
@@ -458,6 +588,11 @@ int main(void)
 
     os_heap_init();
 
+    /* Seed the generator of the random delays, if any, before the first
+     * hardened check.
+     */
+    (void)fih_delay_init();
+
     ZEPHYR_BOOT_LOG_START();
 
     (void)rc;
@@ -517,15 +652,31 @@ int main(void)
      * initial mcumgr command(s) into our buffers
      */
     rc = boot_console_init();
+#ifndef CONFIG_BOOT_SERIAL_WAIT_FOR_DFU_ON_RX
     int timeout_in_ms = CONFIG_BOOT_SERIAL_WAIT_FOR_DFU_TIMEOUT;
     uint32_t start = k_uptime_get_32();
+#endif
 
 #ifdef CONFIG_MCUBOOT_INDICATION_LED
     io_led_set(1);
 #endif
 #endif
 
+#ifdef CONFIG_BOOT_GO_STEP
+    /* Threads of the same priority, e.g. bringing up USB or a display, run
+     * between the steps of boot_go().
+     */
+    while (boot_go_step(&rsp, &fih_rc) == BOOT_STEP_MORE) {
+        k_yield();
+    }
+#else
     FIH_CALL(boot_go, fih_rc, &rsp);
+#endif
+
+#ifdef CONFIG_BOOT_MBEDTLS_POOL_HEAP
+    BOOT_LOG_DBG("mbed TLS heap high-water mark: %u bytes",
+                 (unsigned int)os_heap_high_water());
+#endif
 
 #ifdef CONFIG_BOOT_SERIAL_BOOT_MODE
     if (io_detect_boot_mode()) {
@@ -537,12 +688,26 @@ int main(void)
 #endif
 
 #ifdef CONFIG_BOOT_SERIAL_WAIT_FOR_DFU
+#ifdef CONFIG_BOOT_SERIAL_WAIT_FOR_DFU_ON_RX
+    /* Only wait if a host has started to send a frame while booting, it is
+     * then given the whole timeout to complete it.
+     */
+    if (console_frame_started()) {
+        boot_phase_start(BOOT_PHASE_SERIAL);
+        boot_serial_check_start(&boot_funcs,
+                                CONFIG_BOOT_SERIAL_WAIT_FOR_DFU_TIMEOUT);
+        boot_phase_stop(BOOT_PHASE_SERIAL);
+    }
+#else
     timeout_in_ms -= (k_uptime_get_32() - start);
     if( timeout_in_ms <= 0 ) {
         /* at least one check if time was expired */
         timeout_in_ms = 1;
     }
+    boot_phase_start(BOOT_PHASE_SERIAL);
     boot_serial_check_start(&boot_funcs,timeout_in_ms);
+    boot_phase_stop(BOOT_PHASE_SERIAL);
+#endif
 
 #ifdef CONFIG_MCUBOOT_INDICATION_LED
     io_led_set(0);
@@ -572,6 +737,8 @@ int main(void)
         FIH_PANIC;
     }
 
+    boot_phase_start(BOOT_PHASE_JUMP);
+
 #ifdef CONFIG_BOOT_RAM_LOAD
     BOOT_LOG_INF("Bootloader chainload address offset: 0x%x",
                  rsp.br_hdr->ih_load_addr);
@@ -592,7 +759,21 @@ int main(void)
 
     mcuboot_status_change(MCUBOOT_STATUS_BOOTABLE_IMAGE_FOUND);
 
+#ifdef CONFIG_BOOT_FLASH_STATS
+    flash_stats_log();
+#endif
+
+#ifdef CONFIG_BOOT_PROFILE
+    boot_profile_log();
+#endif
+
     ZEPHYR_BOOT_LOG_STOP();
+
+    boot_phase_stop(BOOT_PHASE_JUMP);
+#if defined(CONFIG_BOOT_PROFILE) && defined(CONFIG_BOOT_SHARE_DATA)
+    (void)boot_profile_save_shared_data();
+#endif
+
     do_boot(&rsp);
 
     mcuboot_status_change(MCUBOOT_STATUS_BOOT_FAILED);
@@ -21,6 +21,8 @@
 #include <string.h>
 
 #include "os/os_heap.h"
+#include "mcuboot_config/mcuboot_config.h"
+#include "bootutil/bench.h"
 
 #ifdef CONFIG_BOOT_USE_MBEDTLS
 
@@ -47,6 +49,7 @@
 #  endif
 #endif
 
+#ifndef CONFIG_BOOT_MBEDTLS_POOL_HEAP
 static unsigned char mempool[CRYPTO_HEAP_SIZE];
 
 /*
@@ -57,6 +60,138 @@ void os_heap_init(void)
     mbedtls_memory_buffer_alloc_init(mempool, sizeof(mempool));
 }
 #else
+/*
+ * Allocator tuned for the way the bootloader uses the heap: a signature
+ * check or a key decryption makes many short-lived allocations of a few
+ * sizes, and frees all of them before it returns. Blocks are carved from
+ * the top of the pool in size classes, 16, 24, 32, 48, 64... bytes
+ * including their header, and a freed block is only reused for a block of
+ * the same class, or a smaller one when the pool is exhausted: no search or
+ * coalescing is done. Once every block is freed the whole pool is free
+ * again, so each crypto operation starts from an empty pool.
+ */
+#define POOL_ALIGN      8
+#define POOL_HDR_SZ     POOL_ALIGN
+#define POOL_MIN_SZ     16
+#define POOL_CLASSES    24
+
+struct pool_free_block {
+    struct pool_free_block *next;
+};
+
+static unsigned char mempool[CRYPTO_HEAP_SIZE] __aligned(POOL_ALIGN);
+static struct pool_free_block *pool_free_list[POOL_CLASSES];
+static size_t pool_top;
+static size_t pool_high_water;
+static size_t pool_live;
+
+static int pool_class(size_t sz, size_t *class_sz)
+{
+    size_t c = POOL_MIN_SZ;
+    int i;
+
+    for (i = 0; i < POOL_CLASSES; i += 2) {
+        if (sz <= c) {
+            *class_sz = c;
+            return i;
+        }
+        if (sz <= c + c / 2) {
+            *class_sz = c + c / 2;
+            return i + 1;
+        }
+        c *= 2;
+    }
+
+    return -1;
+}
+
+static void *pool_calloc(size_t n, size_t size)
+{
+    struct pool_free_block *blk = NULL;
+    size_t class_sz;
+    size_t sz;
+    int c;
+    int i;
+
+    if (n == 0 || size == 0 || size > sizeof(mempool) / n) {
+        return NULL;
+    }
+    sz = n * size;
+
+    c = pool_class(sz + POOL_HDR_SZ, &class_sz);
+    if (c < 0) {
+        return NULL;
+    }
+
+    if (pool_free_list[c] != NULL) {
+        blk = pool_free_list[c];
+        pool_free_list[c] = blk->next;
+    } else if (class_sz <= sizeof(mempool) - pool_top) {
+        blk = (struct pool_free_block *)&mempool[pool_top];
+        pool_top += class_sz;
+        if (pool_top > pool_high_water) {
+            pool_high_water = pool_top;
+        }
+    } else {
+        for (i = c + 1; i < POOL_CLASSES; i++) {
+            if (pool_free_list[i] != NULL) {
+                blk = pool_free_list[i];
+                pool_free_list[i] = blk->next;
+                c = i;
+                break;
+            }
+        }
+        if (blk == NULL) {
+            return NULL;
+        }
+    }
+
+    *(uint32_t *)blk = c;
+    pool_live++;
+    memset((unsigned char *)blk + POOL_HDR_SZ, 0, sz);
+
+    return (unsigned char *)blk + POOL_HDR_SZ;
+}
+
+static void pool_free(void *ptr)
+{
+    struct pool_free_block *blk;
+    uint32_t c;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    blk = (struct pool_free_block *)((unsigned char *)ptr - POOL_HDR_SZ);
+    c = *(uint32_t *)blk;
+    __ASSERT(c < POOL_CLASSES && pool_live > 0, "bad mbed TLS heap block");
+
+    if (--pool_live == 0) {
+        /* Nothing is allocated anymore, start again from an empty pool. */
+        memset(pool_free_list, 0, sizeof(pool_free_list));
+        pool_top = 0;
+        return;
+    }
+
+    blk->next = pool_free_list[c];
+    pool_free_list[c] = blk;
+}
+
+void os_heap_init(void)
+{
+#ifdef MCUBOOT_BOOT_PROFILE_STACK
+    /* Blocks are carved from the start of the pool and cleared. */
+    boot_profile_arena_paint(BOOT_ARENA_HEAP, mempool, sizeof(mempool));
+#endif
+    mbedtls_platform_set_calloc_free(pool_calloc, pool_free);
+}
+
+size_t os_heap_high_water(void)
+{
+    return pool_high_water;
+}
+#endif /* CONFIG_BOOT_MBEDTLS_POOL_HEAP */
+#else
 void os_heap_init(void)
 {
 }
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+#include "bootutil/ramload.h"
+
+/*
+ * Clears RAM 16 bytes at a time. SoCs with a DMA controller able to fill
+ * memory may replace it, polling the transfer for completion.
+ */
+__weak void boot_ram_clear(void *dst, uint32_t size)
+{
+    volatile uint8_t *p = dst;
+    volatile uint32_t *w;
+
+    while (size > 0 && ((uintptr_t)p & 3U) != 0) {
+        *p++ = 0;
+        size--;
+    }
+
+    w = (volatile uint32_t *)p;
+    for (; size >= 16; size -= 16) {
+        w[0] = 0;
+        w[1] = 0;
+        w[2] = 0;
+        w[3] = 0;
+        w += 4;
+    }
+    for (; size >= 4; size -= 4) {
+        *w++ = 0;
+    }
+
+    p = (volatile uint8_t *)w;
+    while (size-- > 0) {
+        *p++ = 0;
+    }
+}
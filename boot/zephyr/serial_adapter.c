@@ -62,6 +62,12 @@ static sys_slist_t avail_queue;
 static sys_slist_t lines_queue;
 
 static uint16_t cur;
+#ifdef CONFIG_BOOT_SERIAL_WAIT_FOR_DFU_ON_RX
+/* First byte of an mcumgr serial frame (SHELL_NLIP_PKT_START1). */
+#define MCUMGR_FRAME_START 0x06
+
+static volatile bool frame_started;
+#endif
 
 static int boot_uart_fifo_getline(char **line);
 static int boot_uart_fifo_init(void);
@@ -109,6 +115,57 @@ console_read(char *str, int str_size, int *newline)
 	return len + 1;
 }
 
+#ifdef CONFIG_BOOT_SERIAL_BAUD_SWITCH
+/* Characters that may still be in the TX FIFO when the last one is queued. */
+#define BAUD_SWITCH_DRAIN_CHARS 64
+
+static uint32_t boot_baud;
+
+int
+console_set_baud(uint32_t baud)
+{
+	struct uart_config cfg;
+	unsigned int key;
+	int rc;
+
+	rc = uart_config_get(uart_dev, &cfg);
+	if (rc != 0) {
+		return rc;
+	}
+
+	if (boot_baud == 0) {
+		boot_baud = cfg.baudrate;
+	}
+	if (baud == 0) {
+		baud = boot_baud;
+	}
+	if (baud == cfg.baudrate) {
+		return 0;
+	}
+
+	/* Let the last response go out at the rate the host expects it. */
+	k_busy_wait(BAUD_SWITCH_DRAIN_CHARS * 10 * USEC_PER_SEC / cfg.baudrate);
+
+	cfg.baudrate = baud;
+	rc = uart_configure(uart_dev, &cfg);
+
+	/* Drop the part of a line received at the previous rate. */
+	key = irq_lock();
+	cur = 0;
+	irq_unlock(key);
+
+	return rc;
+}
+#endif
+
+#ifdef CONFIG_BOOT_SERIAL_WAIT_FOR_DFU_ON_RX
+bool
+console_frame_started(void)
+{
+	return frame_started;
+}
+#endif
+
 int
 boot_console_init(void)
 {
@@ -132,8 +189,16 @@ static void
 boot_uart_fifo_callback(const struct device *dev, void *user_data)
 {
 	static struct line_input *cmd;
-	uint8_t byte;
+	/* Each driver call empties as much of the receive FIFO (or of the USB
+	 * endpoint buffer) as fits in the block, the lines are then split out
+	 * of it.
+	 */
+	static uint8_t block[CONFIG_BOOT_SERIAL_READ_BLOCK_SIZE];
+	const uint8_t *eol;
+	int copy;
+	int len;
 	int rx;
+	int i;
 
 	uart_irq_update(uart_dev);
 
@@ -142,32 +207,44 @@ boot_uart_fifo_callback(const struct device *dev, void *user_data)
 	}
 
 	while (true) {
-		rx = uart_fifo_read(uart_dev, &byte, 1);
-		if (rx != 1) {
+		rx = uart_fifo_read(uart_dev, block, sizeof(block));
+		if (rx <= 0) {
 			break;
 		}
 
-		if (!cmd) {
-			sys_snode_t *node;
+		for (i = 0; i < rx; i += len) {
+			if (!cmd) {
+				sys_snode_t *node;
+
+				node = sys_slist_get(&avail_queue);
+				if (!node) {
+					BOOT_LOG_ERR("Not enough memory to store"
+						     " incoming data!");
+					return;
+				}
+				cmd = CONTAINER_OF(node, struct line_input, node);
+			}
 
-			node = sys_slist_get(&avail_queue);
-			if (!node) {
-				BOOT_LOG_ERR("Not enough memory to store"
-					     " incoming data!");
-				return;
+#ifdef CONFIG_BOOT_SERIAL_WAIT_FOR_DFU_ON_RX
+			if (cur == 0 && block[i] == MCUMGR_FRAME_START) {
+				frame_started = true;
 			}
-			cmd = CONTAINER_OF(node, struct line_input, node);
-		}
+#endif
 
-		if (cur < CONFIG_BOOT_MAX_LINE_INPUT_LEN) {
-			cmd->line[cur++] = byte;
-		}
+			eol = memchr(&block[i], '\n', rx - i);
+			len = (eol != NULL) ? (eol - &block[i] + 1) : (rx - i);
 
-		if (byte ==  '\n') {
-			cmd->len = cur;
-			sys_slist_append(&lines_queue, &cmd->node);
-			cur = 0;
-			cmd = NULL;
+			/* Bytes past the end of the line buffer are dropped. */
+			copy = MIN(len, CONFIG_BOOT_MAX_LINE_INPUT_LEN - cur);
+			memcpy(&cmd->line[cur], &block[i], copy);
+			cur += copy;
+
+			if (eol != NULL) {
+				cmd->len = cur;
+				sys_slist_append(&lines_queue, &cmd->node);
+				cur = 0;
+				cmd = NULL;
+			}
 		}
 	}
 }
@@ -22,7 +22,7 @@ BOOT_LOG_MODULE_DECLARE(mcuboot);
 static const struct flash_area *_fa_p;
 static struct image_header _hdr = { 0 };
 
-#if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT) || defined(MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE)
+#if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT)
 /**
  * Validate hash of a primary boot image.
  *
@@ -58,40 +58,7 @@ boot_image_validate(const struct flash_area *fa_p,
 
     FIH_RET(fih_rc);
 }
-#endif /* MCUBOOT_VALIDATE_PRIMARY_SLOT || MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE*/
-
-#if defined(MCUBOOT_VALIDATE_PRIMARY_SLOT_ONCE)
-inline static fih_ret
-boot_image_validate_once(const struct flash_area *fa_p,
-                    struct image_header *hdr)
-{
-    static struct boot_swap_state state;
-    int rc;
-    FIH_DECLARE(fih_rc, FIH_FAILURE);
-
-    memset(&state, 0, sizeof(struct boot_swap_state));
-    rc = boot_read_swap_state(fa_p, &state);
-    if (rc != 0)
-        FIH_RET(FIH_FAILURE);
-    if (state.magic != BOOT_MAGIC_GOOD
-            || state.image_ok != BOOT_FLAG_SET) {
-        /* At least validate the image once */
-        FIH_CALL(boot_image_validate, fih_rc, fa_p, hdr);
-        if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
-            FIH_RET(FIH_FAILURE);
-        }
-        if (state.magic != BOOT_MAGIC_GOOD) {
-            rc = boot_write_magic(fa_p);
-            if (rc != 0)
-                FIH_RET(FIH_FAILURE);
-        }
-        rc = boot_write_image_ok(fa_p);
-        if (rc != 0)
-            FIH_RET(FIH_FAILURE);
-    }
-    FIH_RET(FIH_SUCCESS);
-}
-#endif
+#endif /* MCUBOOT_VALIDATE_PRIMARY_SLOT */
 
 /**
  * Gather information on image and prepare for booting.
@@ -44,16 +44,13 @@ if [[ ! -z $MULTI_FEATURES ]]; then
   IFS=','
   read -ra multi_features <<< "$MULTI_FEATURES"
 
-  # psa crypto tests require single thread mode
-  TEST_ARGS=''
   for features in "${multi_features[@]}"; do
+    # psa crypto tests require single thread mode
+    TEST_ARGS=''
     if [[ $features =~ "psa" ]]; then
         TEST_ARGS='--test-threads=1'
-        break
     fi
-  done
 
-  for features in "${multi_features[@]}"; do
     echo "Running cargo for features=\"${features}\""
     time cargo test --no-run --features "$features" -- $TEST_ARGS
     time cargo test --features "$features" -- $TEST_ARGS
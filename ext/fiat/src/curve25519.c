@@ -51,6 +51,16 @@
 
 #define SHA512_DIGEST_LENGTH 64
 
+// Size, in 32-bit words, of a public key decoded by
+// ED25519_decode_public_key().
+#define ED25519_DECODED_KEY_WORDS 48
+
+int ED25519_decode_public_key(uint32_t decoded[ED25519_DECODED_KEY_WORDS],
+                              const uint8_t public_key[32]);
+int ED25519_verify_decoded(const uint8_t *message, size_t message_len,
+                           const uint8_t signature[64],
+                           const uint32_t decoded[ED25519_DECODED_KEY_WORDS]);
+
 // Low-level intrinsic operations
 
 static uint64_t load_3(const uint8_t *in) {
@@ -1049,22 +1059,54 @@ void x25519_sc_reduce(uint8_t s[64]) {
   s[31] = s11 >> 17;
 }
 
+// A public key decoded by ED25519_decode_public_key(): the point -A and the
+// encoded key, which is hashed with the message.
+typedef struct {
+  ge_p3 A;
+  uint8_t pk[32];
+} ed25519_decoded_key;
+
+typedef char ed25519_decoded_key_size_check[
+  sizeof(ed25519_decoded_key) == ED25519_DECODED_KEY_WORDS * 4 ? 1 : -1];
+
+int ED25519_decode_public_key(uint32_t decoded[ED25519_DECODED_KEY_WORDS],
+                              const uint8_t public_key[32]) {
+  ed25519_decoded_key *key = (ed25519_decoded_key *)decoded;
+
+  if (!x25519_ge_frombytes_vartime(&key->A, public_key)) {
+    return 0;
+  }
+
+  fe_loose t;
+  fe_neg(&t, &key->A.X);
+  fe_carry(&key->A.X, &t);
+  fe_neg(&t, &key->A.T);
+  fe_carry(&key->A.T, &t);
+
+  memcpy(key->pk, public_key, 32);
+  return 1;
+}
+
 int ED25519_verify(const uint8_t *message, size_t message_len,
                    const uint8_t signature[64], const uint8_t public_key[32]) {
-  ge_p3 A;
+  uint32_t decoded[ED25519_DECODED_KEY_WORDS];
+
   if ((signature[63] & 224) != 0 ||
-      !x25519_ge_frombytes_vartime(&A, public_key)) {
+      !ED25519_decode_public_key(decoded, public_key)) {
     return 0;
   }
 
-  fe_loose t;
-  fe_neg(&t, &A.X);
-  fe_carry(&A.X, &t);
-  fe_neg(&t, &A.T);
-  fe_carry(&A.T, &t);
+  return ED25519_verify_decoded(message, message_len, signature, decoded);
+}
+
+int ED25519_verify_decoded(const uint8_t *message, size_t message_len,
+                           const uint8_t signature[64],
+                           const uint32_t decoded[ED25519_DECODED_KEY_WORDS]) {
+  const ed25519_decoded_key *key = (const ed25519_decoded_key *)decoded;
+  if ((signature[63] & 224) != 0) {
+    return 0;
+  }
 
-  uint8_t pkcopy[32];
-  memcpy(pkcopy, public_key, 32);
   uint8_t rcopy[32];
   memcpy(rcopy, signature, 32);
   union {
@@ -1105,7 +1147,7 @@ int ED25519_verify(const uint8_t *message, size_t message_len,
 
   ret = mbedtls_sha512_update_ret(&ctx, signature, 32);
   assert(ret == 0);
-  ret = mbedtls_sha512_update_ret(&ctx, public_key, 32);
+  ret = mbedtls_sha512_update_ret(&ctx, key->pk, 32);
   assert(ret == 0);
   ret = mbedtls_sha512_update_ret(&ctx, message, message_len);
   assert(ret == 0);
@@ -1125,7 +1167,7 @@ int ED25519_verify(const uint8_t *message, size_t message_len,
 
   rc = tc_sha512_update(&s, signature, 32);
   assert(rc == TC_CRYPTO_SUCCESS);
-  rc = tc_sha512_update(&s, public_key, 32);
+  rc = tc_sha512_update(&s, key->pk, 32);
   assert(rc == TC_CRYPTO_SUCCESS);
   rc = tc_sha512_update(&s, message, message_len);
   assert(rc == TC_CRYPTO_SUCCESS);
@@ -1139,7 +1181,7 @@ int ED25519_verify(const uint8_t *message, size_t message_len,
   x25519_sc_reduce(h);
 
   ge_p2 R;
-  ge_double_scalarmult_vartime(&R, h, &A, scopy.u8);
+  ge_double_scalarmult_vartime(&R, h, &key->A, scopy.u8);
 
   uint8_t rcheck[32];
   x25519_ge_tobytes(rcheck, &R);
@@ -17,6 +17,9 @@
 
 #include "cc310_glue.h"
 
+/* Size of the buffer used to feed data not located in RAM to the CC310. */
+#define CC310_BOUNCE_BUF_SZ 256
+
 int cc310_init(void)
 {
     /* Only initialize once */
@@ -39,15 +42,25 @@ void cc310_sha256_update(nrf_cc310_bl_hash_context_sha256_t *ctx,
                          uint32_t data_len)
 {
     /*
-     * NRF Cryptocell can only read from RAM this allocates a buffer on the stack
-     * if the data provided is not located in RAM.
+     * NRF Cryptocell can only read from RAM, data located elsewhere (e.g.
+     * memory-mapped flash) is bounced through a small buffer on the stack.
      */
 
     if ((uint32_t) data < CONFIG_SRAM_BASE_ADDRESS) {
-        uint8_t stack_buffer[data_len];
-        uint32_t block_len = data_len;
-        memcpy(stack_buffer, data, block_len);
-        nrf_cc310_bl_hash_sha256_update(ctx, stack_buffer, block_len);
+        uint8_t stack_buffer[CC310_BOUNCE_BUF_SZ];
+        const uint8_t *src = data;
+        uint32_t block_len;
+
+        while (data_len > 0) {
+            block_len = data_len;
+            if (block_len > sizeof(stack_buffer)) {
+                block_len = sizeof(stack_buffer);
+            }
+            memcpy(stack_buffer, src, block_len);
+            nrf_cc310_bl_hash_sha256_update(ctx, stack_buffer, block_len);
+            src += block_len;
+            data_len -= block_len;
+        }
     } else {
         nrf_cc310_bl_hash_sha256_update(ctx, data, data_len);
     }
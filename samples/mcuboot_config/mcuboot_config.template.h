@@ -30,9 +30,38 @@
 /* Uncomment for RSA signature support */
 /* #define MCUBOOT_SIGN_RSA */
 
+#ifdef MCUBOOT_SIGN_RSA
+/* Uncomment to apply the built-in RSA keys with precomputed Montgomery
+ * constants, generated by "imgtool getpub -e lang-c-mont" (Mbed TLS and
+ * public exponent 65537 only). */
+/* #define MCUBOOT_RSA_MONT */
+#endif
+
 /* Uncomment for ECDSA signatures using curve P-256. */
 /* #define MCUBOOT_SIGN_EC256 */
 
+#ifdef MCUBOOT_SIGN_EC256
+/* Uncomment to verify ECDSA P-256 signatures with precomputed comb tables
+ * of the generator and of each built-in key (TinyCrypt only). The key
+ * tables are generated by "imgtool getpub -e lang-c-comb". */
+/* #define MCUBOOT_ECDSA_P256_COMB */
+#endif
+
+/* Uncomment to hash images with the SHA-256 implementation of bootutil
+ * (bootutil/sha256_fast.h) instead of the one of the crypto library, on
+ * targets without hashing hardware. SHA-256 image hashes only. */
+/* #define MCUBOOT_SHA256_FAST */
+
+/* Uncomment for ECDSA signatures using curve P-384 (PSA Crypto only). */
+/* #define MCUBOOT_SIGN_EC384 */
+
+#ifdef MCUBOOT_SIGN_EC384
+/* Uncomment to hash images with SHA-384 and verify P-384 signatures on the
+ * accelerator reached through the platform provided <ec384_hw_glue.h>, see
+ * docs/PORTING.md. */
+/* #define MCUBOOT_EC384_HW */
+#endif
+
 /*
  * Public key handling
  *
@@ -45,6 +74,11 @@
 /* Uncomment to use builtin key(s) instead of incorporating
  * the public key into the code. */
 /* #define MCUBOOT_BUILTIN_KEY */
+#ifdef MCUBOOT_BUILTIN_KEY
+/* Uncomment to override the ID of the (e.g. persistent) PSA key verifying
+ * the signature of an image; the default is the image index plus one. */
+/* #define MCUBOOT_BUILTIN_KEY_ID(image_index) (0x7fff0000 + (image_index)) */
+#endif
 
 /*
  * Upgrade mode
@@ -65,15 +99,94 @@
 /* Uncomment to only erase and overwrite those primary slot sectors needed
  * to install the new image, rather than the entire image slot. */
 /* #define MCUBOOT_OVERWRITE_ONLY_FAST */
+/* Uncomment to hash the image in the secondary slot while it is copied to
+ * the primary slot instead of before. Its signature and security counter
+ * are checked before the copy, against its hash TLV, and the hash once the
+ * copy is done. If the data does not match, both slots are erased. */
+/* #define MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY */
+/* Uncomment to record the progress of the copy after each sector, so that
+ * an interrupted upgrade resumes instead of starting over. Not compatible
+ * with MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY. */
+/* #define MCUBOOT_OVERWRITE_ONLY_RESUME */
+/* Uncomment to invalidate the image in the secondary slot after it has been
+ * copied by programming the write units holding its header and trailer
+ * magic again, instead of erasing the sectors holding them. The flash must
+ * allow written bytes to be programmed again, which flash with ECC usually
+ * does not. */
+/* #define MCUBOOT_OVERWRITE_ONLY_TOMBSTONE */
+/* Uncomment to erase the primary slot of the next image to be upgraded
+ * while the current one is copied, when it is on another flash device.
+ * Needs several images and MCUBOOT_FLASH_AREA_ERASE_ASYNC. Not compatible
+ * with MCUBOOT_OVERWRITE_ONLY_RESUME. */
+/* #define MCUBOOT_ERASE_AHEAD */
+/* Uncomment to install upgrades from a source provided by the port, such
+ * as an SD card or the network, served by the flash map backend as a
+ * read-only secondary slot. The port implements the hooks declared in
+ * bootutil/image_source.h. The copy in the primary slot is always checked
+ * against the image TLVs. */
+/* #define MCUBOOT_IMAGE_SOURCE */
 #endif
 
+/* Uncomment to enable the swap-using-offset code path. The update image is
+ * written one sector into the secondary slot, and the swap needs neither a
+ * scratch area nor moving the primary slot up first. Not compatible with
+ * MCUBOOT_ENC_IMAGES or MCUBOOT_BOOTSTRAP. */
+/* #define MCUBOOT_SWAP_USING_OFFSET */
+
+/* Uncomment to enable the swap-using-bank code path. The slots are the two
+ * banks of a dual-bank flash controller, which the port swaps with
+ * boot_bank_swap() instead of copying them. Not compatible with
+ * MCUBOOT_ENC_IMAGES, compressed or delta images or MCUBOOT_BOOTSTRAP. */
+/* #define MCUBOOT_SWAP_USING_BANK */
+
+/* Uncomment, with MCUBOOT_BOOTSTRAP and MCUBOOT_VALIDATE_PRIMARY_SLOT in a
+ * swap mode, to hash the image bootstrapped to an empty or invalid primary
+ * slot while it is copied, and check its signature once the copy is done.
+ * If the image is not valid, both slots are erased. */
+/* #define MCUBOOT_BOOTSTRAP_VERIFY_COPY */
+
 /* Uncomment to enable the direct-xip code path. */
 /* #define MCUBOOT_DIRECT_XIP */
 /* Uncomment to enable the revert mechanism in direct-xip mode. */
 /* #define MCUBOOT_DIRECT_XIP_REVERT */
+/* Uncomment to only erase the header and trailer sectors of a faulty image
+ * when reverting in direct-xip mode, instead of its whole slot. */
+/* #define MCUBOOT_DIRECT_XIP_REVERT_FAST */
+
+/* Uncomment to only erase the header and trailer sectors of an image which
+ * failed validation, instead of its whole slot, leaving the rest of the slot
+ * to be erased by whatever writes the next image to it. */
+/* #define MCUBOOT_INVALIDATE_SLOT_FAST */
 
 /* Uncomment to enable the ram-load code path. */
 /* #define MCUBOOT_RAM_LOAD */
+/* Uncomment to remove images from RAM with boot_ram_clear(), provided by the
+ * port, e.g. with a DMA memset, instead of memset(). */
+/* #define MCUBOOT_RAM_CLEAR */
+/* Uncomment to hash images while they are copied to RAM, in chunks of
+ * MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE bytes, instead of after the copy. */
+/* #define MCUBOOT_RAM_LOAD_HASH_COPY */
+/* #define MCUBOOT_RAM_LOAD_COPY_CHUNK_SIZE 4096 */
+/* Uncomment to copy (and hash) all the images to RAM at the same time, the
+ * reads from the slots of different images overlapping. Requires
+ * MCUBOOT_RAM_LOAD_HASH_COPY, MCUBOOT_FLASH_AREA_READ_ASYNC with reads on
+ * different flash areas allowed to run concurrently, and more than one
+ * image. */
+/* #define MCUBOOT_RAM_LOAD_PARALLEL */
+/* Uncomment to use the copy of an image left in RAM by the previous boot,
+ * without copying or validating it again, while it still hashes to the hash
+ * TLV validated then. The platform implements bootutil/ram_resident.h, and
+ * must protect the records from the application. */
+/* #define MCUBOOT_RAM_LOAD_RESIDENT */
+/* Uncomment to only load the first stage of chunk-hashed images (see
+ * MCUBOOT_HASH_CHUNKS) before boot, the application loading the rest with
+ * boot_ram_load_range() or boot_ram_load_finish(). */
+/* #define MCUBOOT_RAM_LOAD_STAGED */
+/* Uncomment to accept images whose payload segments are each loaded to their
+ * own RAM address. The platform then implements
+ * boot_get_image_ram_load_region(). */
+/* #define MCUBOOT_RAM_LOAD_SEGMENTS */
+/* #define MCUBOOT_RAM_LOAD_MAX_SEGMENTS 4 */
 
 /*
  * Cryptographic settings
@@ -104,10 +217,36 @@
 /* Uncomment to use ECIES-X25519 for key encryption */
 /* #define MCUBOOT_ENCRYPT_X25519 */
 
+/* Uncomment to match Ed25519 and X25519 keys against their fixed DER
+ * encoding instead of parsing them, so that no Mbed TLS ASN.1 code is
+ * needed by these algorithms. */
+/* #define MCUBOOT_CURVE25519_FIXED_DER */
+
 /* Uncomment to use a builtin key-encryption key (retrieved from a trusted
  * source - if implemented) instead of a key embedded in the bootloader. */
 /* #define MCUBOOT_ENC_BUILTIN_KEY */
 
+/* Number of AES-CTR counter blocks whose keystream is generated by a single
+ * crypto library call, from a stack buffer of 16 bytes per block. */
+/* #define MCUBOOT_ENC_KEYSTREAM_BLOCKS 8 */
+
+/* Uncomment to only accept images encrypted with AES-GCM, whose tag is
+ * checked while the payload is decrypted for validation. */
+/* #define MCUBOOT_ENC_GCM */
+
+/* Uncomment to execute encrypted images in place with MCUBOOT_DIRECT_XIP,
+ * through an inline decryption engine programmed by the
+ * boot_enc_xip_configure() hook with the key of the image to boot. */
+/* #define MCUBOOT_ENC_XIP */
+
+/* Uncomment to save the image keys in the swap status wrapped by the
+ * boot_enc_wrap_key() and boot_enc_unwrap_key() hooks, for example under a
+ * hardware unique key, instead of in plaintext. Resuming a swap then does not
+ * decrypt the key TLVs again. */
+/* #define MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY */
+/* Size of a wrapped key, by default that of an AES key wrap of the key. */
+/* #define MCUBOOT_SWAP_WRAPPED_ENCKEY_SIZE 24 */
+
 #if defined(MCUBOOT_ENCRYPT_RSA)    || \
     defined(MCUBOOT_ENCRYPT_KW)     || \
     defined(MCUBOOT_ENCRYPT_EC256)  || \
@@ -122,6 +261,113 @@
  */
 #define MCUBOOT_VALIDATE_PRIMARY_SLOT
 
+/*
+ * Uncomment to skip the signature check of the primary slot image when it
+ * matches the record of the last successful validation. The platform must
+ * implement the interface from bootutil/validation_cache.h.
+ */
+/* #define MCUBOOT_VALIDATION_CACHE */
+
+/*
+ * Uncomment to also skip the validation of an image in the primary slot
+ * right after it has been installed from the secondary slot, where it was
+ * validated during the same boot. Requires MCUBOOT_VALIDATION_CACHE.
+ */
+/* #define MCUBOOT_VALIDATION_CACHE_UPGRADE */
+
+/*
+ * Uncomment to use the digest of an upgrade stored by the application with
+ * boot_set_pending_digest_multi() instead of hashing the secondary slot
+ * again. The platform must implement boot_pending_digest_mac() from
+ * bootutil/pending_digest.h.
+ */
+/* #define MCUBOOT_PENDING_DIGEST */
+
+/*
+ * Uncomment, in the configuration an application builds bootutil with, to
+ * provide the streaming writer of the secondary slot declared in
+ * bootutil/image_writer.h. MCUBOOT_IMAGE_WRITER_BUF_SIZE sets the size of
+ * its writes, 512 bytes by default.
+ */
+/* #define MCUBOOT_IMAGE_WRITER */
+
+/*
+ * With MCUBOOT_HW_ROLLBACK_PROT, uncomment to read each security counter
+ * only once per boot and to write all the counter updates together right
+ * before booting. Also uncomment MCUBOOT_HW_ROLLBACK_PROT_BATCH if the
+ * platform implements boot_nv_security_counter_update_batch(), to write
+ * them in a single operation.
+ */
+/* #define MCUBOOT_HW_ROLLBACK_PROT_CACHE */
+/* #define MCUBOOT_HW_ROLLBACK_PROT_BATCH */
+
+/*
+ * Uncomment to select the slot to boot in direct-xip and ram-load modes from
+ * a cached index of the image headers instead of reading all of them. The
+ * platform must implement the interface from bootutil/boot_index.h.
+ */
+/* #define MCUBOOT_BOOT_INDEX */
+
+/*
+ * Uncomment to hash the images after the first one on a secondary core while
+ * the first image is validated, in direct-xip mode or, with
+ * MCUBOOT_VALIDATE_PRIMARY_SLOT, when the primary slots are validated before
+ * booting. The platform must implement the interface from
+ * bootutil/boot_parallel.h.
+ */
+/* #define MCUBOOT_PARALLEL_VALIDATION */
+
+/*
+ * Uncomment to have boot_go_for_image_id() upgrade all the images but only
+ * validate the primary slot of the image it boots. The port must validate
+ * each of the other images with boot_validate_deferred_image() before
+ * starting the core running it. Requires MCUBOOT_VALIDATE_PRIMARY_SLOT and
+ * more than one image.
+ */
+/* #define MCUBOOT_LAZY_VALIDATION */
+
+/*
+ * Uncomment to compute the digests of the first
+ * MCUBOOT_KEY_HASH_CACHE_SIZE built-in keys only once, and reuse them to
+ * find the key of every image validated during a boot.
+ */
+/* #define MCUBOOT_KEY_HASH_CACHE */
+/* #define MCUBOOT_KEY_HASH_CACHE_SIZE 4 */
+
+/*
+ * Uncomment to parse (or import into PSA Crypto) each of the first
+ * MCUBOOT_KEY_CONTEXT_CACHE_SIZE built-in keys only once, and keep the
+ * result until the application is started. Not available with
+ * MCUBOOT_HW_KEY or MCUBOOT_BUILTIN_KEY.
+ */
+/* #define MCUBOOT_KEY_CONTEXT_CACHE */
+/* #define MCUBOOT_KEY_CONTEXT_CACHE_SIZE 2 */
+
+/*
+ * Uncomment to take the crypto contexts of the image hash, of the signature
+ * check and of the encryption key decryption from one static arena, sized
+ * for the largest of them, instead of the stack. Not available with
+ * MCUBOOT_PARALLEL_VALIDATION.
+ */
+/* #define MCUBOOT_CRYPTO_ARENA */
+
+/*
+ * Uncomment to take the copy buffers and the image validation work buffers
+ * of the loader from one static arena, sized for the largest of them. The
+ * validation then reads images in chunks as large as the copy buffers. Not
+ * available with MCUBOOT_PARALLEL_VALIDATION.
+ */
+/* #define MCUBOOT_WORK_ARENA */
+
+/*
+ * Uncomment to read the TLV area of an image once, on the first lookup of
+ * one of its TLVs, and serve the following lookups from an index of up to
+ * MCUBOOT_TLV_INDEX_MAX_ENTRIES TLVs. Not available with MCUBOOT_RAM_LOAD
+ * or MCUBOOT_PARALLEL_VALIDATION.
+ */
+/* #define MCUBOOT_TLV_INDEX */
+/* #define MCUBOOT_TLV_INDEX_MAX_ENTRIES 16 */
+
 /*
  * Flash abstraction
  */
@@ -130,10 +376,195 @@
  * See the flash APIs for more details. */
 /* #define MCUBOOT_USE_FLASH_AREA_GET_SECTORS */
 
+/* Uncomment to accept images whose payload is covered by a table of chunk
+ * digests (imgtool sign --hash-chunk-size). */
+/* #define MCUBOOT_HASH_CHUNKS */
+
+/* Uncomment to build bootutil_tlv_sector_digest(), which looks up the digest
+ * of a sector of the image in its sector digest table (imgtool sign
+ * --sector-digest-size). */
+/* #define MCUBOOT_SECTOR_DIGESTS */
+
+/* Uncomment to accept delta images (imgtool sign --delta-base), rebuilt in
+ * the secondary slot from the primary slot before an upgrade. Not supported
+ * with swap-using-offset, direct-xip, ram-load or encrypted images. */
+/* #define MCUBOOT_DELTA_IMAGES */
+
+/* Uncomment to also accept delta images whose copies adjust the Thumb BL
+ * instructions they move (imgtool sign --delta-arm-thumb). */
+/* #define MCUBOOT_DELTA_ARM_THUMB */
+
+/* Uncomment to support compressed images in the secondary slot, which are
+ * decompressed into the primary slot by overwrite-only upgrades, after
+ * decryption for encrypted ones. Not supported with resumed or verified
+ * copies. The write buffer size defaults to 4096 bytes. */
+/* #define MCUBOOT_DECOMPRESS_IMAGES */
+/* #define MCUBOOT_DECOMPRESSION_BUFFER_SIZE 4096 */
+
+/* Select the codecs to decompress, LZMA2 if none is. LZ4 images are larger
+ * but decompress faster, without the ~30 KiB model LZMA2 needs in RAM. */
+/* #define MCUBOOT_DECOMPRESS_LZMA2 */
+/* #define MCUBOOT_DECOMPRESS_LZ4 */
+
+/* Uncomment if your flash map API supports flash_area_get_mapped_addr(),
+ * to hash images in memory-mapped flash without copying them to RAM, and
+ * to check flash regions for the erased state and read image headers
+ * without going through flash_area_read(). */
+/* #define MCUBOOT_HASH_MMAP_FLASH */
+
+/* Uncomment if your flash map API supports flash_area_mmap() and
+ * flash_area_munmap(), to hash images through a memory-mapped window of
+ * flash, e.g. an MMU page, instead of copying them to RAM. */
+/* #define MCUBOOT_FLASH_AREA_MMAP */
+
+/* Uncomment to blank-check each flash sector before erasing it, and skip
+ * the erase if it is already erased. */
+/* #define MCUBOOT_SKIP_ERASED_SECTORS */
+
+/* Uncomment if your flash map API supports flash_area_is_erased(), which
+ * blank-checks a region using the flash device instead of reading it. */
+/* #define MCUBOOT_FLASH_AREA_IS_ERASED */
+
+/* Uncomment to skip the erase and copy of the sectors that an upgrade did
+ * not change when swapping with MCUBOOT_SWAP_USING_MOVE or
+ * MCUBOOT_SWAP_USING_SCRATCH. */
+/* #define MCUBOOT_SWAP_SKIP_UNCHANGED */
+
+/* Uncomment to size the swap status area of the image trailer for this many
+ * MCUBOOT_SWAP_USING_SCRATCH steps instead of MCUBOOT_MAX_IMG_SECTORS. Each
+ * step moves as many sectors as fit in the scratch area. Images must be
+ * signed with the same value passed to imgtool as --max-sectors.
+ */
+/* #define MCUBOOT_SWAP_STATUS_MAX_ENTRIES 16 */
+
+/* Uncomment to only erase and use a window of this many bytes of the
+ * scratch area in each MCUBOOT_SWAP_USING_SCRATCH step, the steps using the
+ * windows in turn to spread the erases across the scratch area. Must be a
+ * multiple of the scratch area erase size.
+ */
+/* #define MCUBOOT_SWAP_SCRATCH_WINDOW_SIZE 4096 */
+
+/* Uncomment to store each swap status entry in a single byte instead of a
+ * full write unit, which shrinks the swap status area by the write size.
+ * The flash must allow a write unit to be programmed again with only
+ * erased bytes changing, which flash with ECC does not. */
+/* #define MCUBOOT_SWAP_STATUS_PACKED */
+
+/* Uncomment to keep the swap status logs of all images in the flash area
+ * FLASH_AREA_SWAP_STATUS, e.g. on internal flash, instead of the trailer of
+ * the primary slots, which then only hold the magic, flags and keys. The area
+ * is split evenly between the images, each part being a whole number of
+ * sectors. Only supported with MCUBOOT_SWAP_USING_MOVE and
+ * MCUBOOT_SWAP_USING_OFFSET.
+ */
+/* #define MCUBOOT_SWAP_STATUS_PARTITION */
+
+/* Size of the buffer used to copy flash regions during swaps and overwrite
+ * upgrades; larger values mean fewer flash reads and writes. Must be a
+ * multiple of the flash write alignment. */
+/* #define MCUBOOT_COPY_BUF_SIZE 1024 */
+
+/* Uncomment to overlap flash reads with hashing when validating an image.
+ * Two buffers of MCUBOOT_HASH_PIPELINE_BUF_SIZE bytes are used. */
+/* #define MCUBOOT_HASH_PIPELINE */
+/* #define MCUBOOT_HASH_PIPELINE_BUF_SIZE 1024 */
+
+/* Uncomment if your flash map API supports flash_area_read_async() and
+ * flash_area_read_wait(), allowing the hash pipeline to read the next block
+ * while the current one is hashed. It is also used by
+ * MCUBOOT_RAM_LOAD_HASH_COPY. */
+/* #define MCUBOOT_FLASH_AREA_READ_ASYNC */
+
+/* Uncomment if your flash map API supports flash_area_copy(), which copies
+ * between flash areas without the CPU (e.g. using DMA). It is used when
+ * the data does not need to be decrypted or encrypted. */
+/* #define MCUBOOT_FLASH_AREA_COPY */
+
+/* Uncomment to copy flash regions using three buffers of
+ * MCUBOOT_COPY_BUF_SIZE bytes, so that reading the next chunk and writing
+ * the previous one can overlap with decrypting the current one. */
+/* #define MCUBOOT_COPY_PIPELINE */
+
+/* Uncomment to read back and check each chunk written when copying images.
+ * A swap step that fails the check is erased and copied again, up to
+ * MCUBOOT_COPY_VERIFY_RETRIES times. Not compatible with
+ * MCUBOOT_COPY_PIPELINE. */
+/* #define MCUBOOT_COPY_VERIFY */
+/* #define MCUBOOT_COPY_VERIFY_RETRIES 2 */
+
+/* Uncomment if your flash map API supports flash_area_write_async() and
+ * flash_area_write_wait(), allowing the copy pipeline to program a chunk
+ * while the next one is read. */
+/* #define MCUBOOT_FLASH_AREA_WRITE_ASYNC */
+
+/* Uncomment if your flash map API supports flash_area_erase_async() and
+ * flash_area_erase_wait(), so that MCUBOOT_ERASE_AHEAD can erase a slot
+ * while another one is being copied. */
+/* #define MCUBOOT_FLASH_AREA_ERASE_ASYNC */
+
+/* Uncomment to time the boot phases into a table of per-phase cycle
+ * counts, see bootutil/bench.h.  The platform-bench.h of the port must
+ * define plat_bench_cycles().  With MCUBOOT_DATA_SHARING, the table can be
+ * passed to the application with boot_profile_save_shared_data(). */
+/* #define MCUBOOT_BOOT_PROFILE */
+
+/* Uncomment to also record the stack high-water mark of each boot phase and
+ * the use of the static arenas.  The platform-bench.h of the port must
+ * define plat_bench_stack_start() and plat_bench_stack_size(), the stack is
+ * assumed to grow down. */
+/* #define MCUBOOT_BOOT_PROFILE_STACK */
+
+/* Uncomment to have the flash map backend count the operations, bytes,
+ * errors and latencies of the reads, writes and erases of each flash area,
+ * see bootutil/flash_stats.h.  Supported by the Zephyr, NuttX and Mbed
+ * ports, which log the statistics before booting. */
+/* #define MCUBOOT_FLASH_STATS */
+/* #define MCUBOOT_FLASH_STATS_AREAS 8 */
+
+/* Uncomment to have mcuboot_status_progress() called with the progress of
+ * image swaps and copies, see bootutil/mcuboot_status.h.  Define
+ * MCUBOOT_UPTIME_MS() to a millisecond clock to also get the throughput and
+ * the estimated time left. */
+/* #define MCUBOOT_UPGRADE_PROGRESS */
+/* #define MCUBOOT_UPTIME_MS() platform_uptime_ms() */
+
 /* Default maximum number of flash sectors per image slot; change
  * as desirable. */
 #define MCUBOOT_MAX_IMG_SECTORS 128
 
+/* Uncomment to keep the sector layout of each slot as runs of sectors of
+ * the same size, instead of one entry per sector, so that the RAM used
+ * does not grow with MCUBOOT_MAX_IMG_SECTORS. Requires
+ * MCUBOOT_USE_FLASH_AREA_GET_SECTORS and flash_area_get_sector(). */
+/* #define MCUBOOT_SECTOR_RUNS */
+/* #define MCUBOOT_MAX_SECTOR_RUNS 4 */
+
+/* Uncomment to leave the secondary slot erased after a permanent upgrade
+ * instead of moving the previous image there. With encrypted images this
+ * also skips encrypting it again. Requires swap-using-scratch or
+ * swap-using-move. */
+/* #define MCUBOOT_SWAP_PERM_DISCARD */
+
+/* Uncomment to only read the sector layout of the slots of an image when
+ * its trailers show a swap to resume or an update to perform. */
+/* #define MCUBOOT_LAZY_SECTORS */
+
+/* Uncomment to have the image access hooks ask the platform for the
+ * verdict it holds on an image, bound to its slot and digests, before
+ * validating it, and give it the result of each validation. Requires
+ * MCUBOOT_IMAGE_ACCESS_HOOKS; not supported with MCUBOOT_VALIDATION_CACHE. */
+/* #define MCUBOOT_IMAGE_VERDICT_HOOKS */
+
+/* Uncomment to have boot_go() call the boot_perf_raise() and
+ * boot_perf_restore() port hooks, to use faster clock and flash settings
+ * while the images are validated and updated. */
+/* #define MCUBOOT_PERF_HOOKS */
+
+/* Uncomment to have bootutil call the boot_step_point() port hook after each
+ * chunk hashed or copied and each signature verified, so that a port running
+ * boot_go() in its own thread can provide boot_go_step(). */
+/* #define MCUBOOT_BOOT_STEP */
+
 /* Default number of separately updateable images; change in case of
  * multiple images. */
 #define MCUBOOT_IMAGE_NUMBER 1
@@ -185,6 +616,13 @@
  *    do { do watchdog feeding here! } while (0)
  */
 
+/* Uncomment to only feed the watchdog once this many bytes have been hashed,
+ * copied or loaded since it was last fed, instead of after every chunk. The
+ * value must be small enough for the slowest of these operations to process
+ * it within the watchdog timeout.
+ */
+/* #define MCUBOOT_WATCHDOG_FEED_BYTES 65536 */
+
 /* If a OS ports support single thread mode or is bare-metal then:
  * This macro implements call that switches CPU to an idle state, from which
  * the CPU may be woken up by, for example, UART transmission event.
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2026 The MCUboot project contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/reboot.h>
+#include <zephyr/retention/retention.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/dfu/mcuboot.h>
+
+/*
+ * Layout of the profile passed by MCUboot with CONFIG_BOOT_PROFILE, see
+ * boot/bootutil/include/bootutil/bench.h and boot_status.h.
+ */
+#define SHARED_DATA_TLV_INFO_MAGIC 0x2016
+#define BOOT_PROFILE_TLV_TYPE      ((0x3 << 12) | 0x00)
+
+enum phase {
+	PHASE_TOTAL,
+	PHASE_HDR_READ,
+	PHASE_VALIDATE,
+	PHASE_HASH,
+	PHASE_SIG,
+	PHASE_KEY,
+	PHASE_SWAP,
+	PHASE_SWAP_STEP,
+	PHASE_COPY,
+	PHASE_JUMP,
+	PHASE_COUNT,
+};
+
+static const char *const phase_names[PHASE_COUNT] = {
+	"total", "hdr_read", "validate", "hash", "sig",
+	"key", "swap", "swap_step", "copy", "jump",
+};
+
+struct phase_entry {
+	uint32_t cycles;
+	uint16_t count;
+	uint8_t parent;
+	uint8_t reserved;
+};
+
+struct tlv_header {
+	uint16_t type;
+	uint16_t len;
+};
+
+/* Sums over the measured upgrades, kept in RAM across the warm resets. */
+#define TOTALS_MAGIC 0x53424e31 /* "SBN1" */
+
+struct totals {
+	uint32_t magic;
+	uint32_t runs;
+	uint64_t cycles[PHASE_COUNT];
+	uint32_t count[PHASE_COUNT];
+	uint32_t min_total;
+	uint32_t max_total;
+};
+
+static __noinit struct totals totals;
+
+static const struct device *info_dev =
+	DEVICE_DT_GET(DT_CHOSEN(zephyr_bootloader_info));
+
+static int read_profile(struct phase_entry *table)
+{
+	struct tlv_header hdr;
+	uint16_t tot_len;
+	off_t off;
+	int rc;
+
+	if (!device_is_ready(info_dev) || retention_is_valid(info_dev) != 1) {
+		return -ENOENT;
+	}
+
+	rc = retention_read(info_dev, 0, (uint8_t *)&hdr, sizeof(hdr));
+	if (rc != 0 || hdr.type != SHARED_DATA_TLV_INFO_MAGIC) {
+		return -ENOENT;
+	}
+	tot_len = hdr.len;
+
+	for (off = sizeof(hdr); off + sizeof(hdr) <= tot_len;
+	     off += sizeof(hdr) + hdr.len) {
+		rc = retention_read(info_dev, off, (uint8_t *)&hdr, sizeof(hdr));
+		if (rc != 0) {
+			return rc;
+		}
+		if (hdr.type == BOOT_PROFILE_TLV_TYPE) {
+			memset(table, 0, sizeof(struct phase_entry) * PHASE_COUNT);
+			return retention_read(info_dev, off + sizeof(hdr),
+					      (uint8_t *)table,
+					      MIN(hdr.len, sizeof(struct phase_entry) *
+							   PHASE_COUNT));
+		}
+	}
+
+	return -ENOENT;
+}
+
+static void print_profile(const struct phase_entry *table)
+{
+	int i;
+
+	printk("%-10s %6s %10s %10s %s\n", "phase", "count", "cycles", "us",
+	       "parent");
+	for (i = 0; i < PHASE_COUNT; i++) {
+		if (table[i].count == 0) {
+			continue;
+		}
+		printk("%-10s %6u %10u %10u %s\n", phase_names[i], table[i].count,
+		       table[i].cycles, k_cyc_to_us_floor32(table[i].cycles),
+		       table[i].parent < PHASE_COUNT ? phase_names[table[i].parent] : "-");
+	}
+}
+
+static void print_summary(void)
+{
+	int i;
+
+	printk("\nSummary over %u upgrades\n", totals.runs);
+	printk("%-10s %10s %12s %10s\n", "phase", "runs/boot", "cycles/boot",
+	       "us/boot");
+	for (i = 0; i < PHASE_COUNT; i++) {
+		uint64_t cycles = totals.cycles[i] / totals.runs;
+
+		if (totals.count[i] == 0) {
+			continue;
+		}
+		printk("%-10s %10u %12llu %10llu\n", phase_names[i],
+		       totals.count[i] / totals.runs, cycles,
+		       k_cyc_to_us_floor64(cycles));
+	}
+	printk("total: min %u us, max %u us\n",
+	       k_cyc_to_us_floor32(totals.min_total),
+	       k_cyc_to_us_floor32(totals.max_total));
+}
+
+int main(void)
+{
+	struct phase_entry table[PHASE_COUNT];
+	struct mcuboot_img_header hdr;
+	int rc;
+	int i;
+
+	printk("Swap benchmark on %s\n", CONFIG_BOARD);
+
+	rc = read_profile(table);
+	if (rc != 0) {
+		printk("No boot profile from MCUboot (%d), is CONFIG_BOOT_PROFILE set?\n",
+		       rc);
+		return 0;
+	}
+	print_profile(table);
+
+	if (totals.magic != TOTALS_MAGIC) {
+		memset(&totals, 0, sizeof(totals));
+		totals.magic = TOTALS_MAGIC;
+		totals.min_total = UINT32_MAX;
+	}
+
+	/* Only the boots which installed an upgrade are measured. */
+	if (table[PHASE_SWAP].count != 0 || table[PHASE_COPY].count != 0) {
+		totals.runs++;
+		for (i = 0; i < PHASE_COUNT; i++) {
+			totals.cycles[i] += table[i].cycles;
+			totals.count[i] += table[i].count;
+		}
+		totals.min_total = MIN(totals.min_total, table[PHASE_TOTAL].cycles);
+		totals.max_total = MAX(totals.max_total, table[PHASE_TOTAL].cycles);
+	}
+
+	if (totals.runs >= CONFIG_SWAP_BENCH_RUNS) {
+		print_summary();
+		totals.magic = 0;
+		return 0;
+	}
+
+	rc = boot_write_img_confirmed();
+	if (rc != 0) {
+		printk("Failed to confirm the image (%d)\n", rc);
+		return 0;
+	}
+
+	/* With overwrite-only upgrades, the secondary slot is erased. */
+	rc = boot_read_bank_header(FIXED_PARTITION_ID(slot1_partition), &hdr,
+				   sizeof(hdr));
+	if (rc != 0) {
+		printk("No image in the secondary slot, load one to continue "
+		       "(%u of %u upgrades measured)\n",
+		       totals.runs, CONFIG_SWAP_BENCH_RUNS);
+		return 0;
+	}
+
+	rc = boot_request_upgrade(BOOT_UPGRADE_TEST);
+	if (rc != 0) {
+		printk("Failed to request the upgrade (%d)\n", rc);
+		return 0;
+	}
+
+	printk("Upgrade %u of %u requested, rebooting\n", totals.runs + 1,
+	       CONFIG_SWAP_BENCH_RUNS);
+	sys_reboot(SYS_REBOOT_WARM);
+
+	return 0;
+}
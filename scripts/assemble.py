@@ -27,6 +27,7 @@ import re
 import os
 import os.path
 import pickle
+import shutil
 import sys
 
 def same_keys(a, b):
@@ -89,11 +90,10 @@ class Assembly():
             if pos < self.offsets[partition]:
                 buf = b'\xFF' * (self.offsets[partition] - pos)
                 ofd.write(buf)
+            if os.path.getsize(source) > self.sizes[partition]:
+                raise Exception("Image {} is too large for partition".format(source))
             with open(source, 'rb') as rfd:
-                ibuf = rfd.read()
-                if len(ibuf) > self.sizes[partition]:
-                    raise Exception("Image {} is too large for partition".format(source))
-            ofd.write(ibuf)
+                shutil.copyfileobj(rfd, ofd)
 
 def find_board_name(bootdir):
     dot_config = os.path.join(bootdir, "zephyr", ".config")
@@ -0,0 +1,230 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Patches for delta images.
+
+A patch is a list of operations, each starting with a 32-bit word holding
+the number of bytes it produces, with DELTA_OP_INSERT set for literal data:
+
+    COPY:   len, base offset    copies len bytes from the base image
+    INSERT: len | INSERT, data  copies the len bytes following the word
+
+A COPY with DELTA_OP_THUMB set also adjusts the Thumb BL instructions it
+copies, found by the ARM Thumb BCJ filter scan from the start of the copy, so
+that they still branch to the same address once moved; the bootloader must
+be built with MCUBOOT_DELTA_ARM_THUMB to apply such patches.
+
+Every operation produces a multiple of the flash write alignment, so the
+bootloader can write its output directly, see boot/bootutil/src/delta.c.
+"""
+
+import struct
+
+from imgtool import lz4
+
+DELTA_OP_INSERT = 0x80000000
+DELTA_OP_THUMB = 0x40000000
+DELTA_OP_LEN = 0x3fffffff
+
+# Smallest run of bytes worth a COPY operation.
+DELTA_BLOCK_SIZE = 32
+
+IMAGE_HEADER_FMT = 'IIHHII'
+TLV_INFO_MAGIC = 0x6907
+SHA_TLVS = (0x10, 0x11, 0x12)
+
+
+def image_size(data, e='<'):
+    """Return the size of a signed image, header and TLVs included."""
+    _, _, hdr_size, prot_size, img_size, _ = \
+        struct.unpack_from(e + IMAGE_HEADER_FMT, data)
+    off = hdr_size + img_size + prot_size
+    magic, tlv_tot = struct.unpack_from(e + 'HH', data, off)
+    if magic != TLV_INFO_MAGIC:
+        raise ValueError("Invalid TLV info magic in base image")
+    return off + tlv_tot
+
+
+def protected_tlvs(data, e='<'):
+    """Return the kind and value of the protected TLVs of a signed image."""
+    _, _, hdr_size, prot_size, img_size, _ = \
+        struct.unpack_from(e + IMAGE_HEADER_FMT, data)
+    off = hdr_size + img_size
+    end = off + prot_size
+    tlvs = []
+    off += 4
+    while off < end:
+        kind, length = struct.unpack_from(e + 'HH', data, off)
+        tlvs.append((kind, bytes(data[off + 4:off + 4 + length])))
+        off += 4 + length
+    return tlvs
+
+
+def image_hash(data, e='<'):
+    """Return the value of the hash TLV of a signed image."""
+    size = image_size(data, e)
+    _, _, hdr_size, prot_size, img_size, _ = \
+        struct.unpack_from(e + IMAGE_HEADER_FMT, data)
+    off = hdr_size + img_size + prot_size + 4
+    while off < size:
+        kind, _, length = struct.unpack_from(e + 'BBH', data, off)
+        if kind in SHA_TLVS:
+            return bytes(data[off + 4:off + 4 + length])
+        off += 4 + length
+    raise ValueError("No hash TLV in base image")
+
+
+def is_thumb_bl(data, i):
+    return (data[i + 1] & 0xf8) == 0xf0 and (data[i + 3] & 0xf8) == 0xf8
+
+
+def move_thumb_bl(insn, adj):
+    """Return the BL pair insn with its offset moved by adj half-words."""
+    off = (((insn[1] & 7) << 19) | (insn[0] << 11) |
+           ((insn[3] & 7) << 8) | insn[2])
+    off = (off + adj) & 0x3fffff
+    return bytes([(off >> 11) & 0xff, 0xf0 | ((off >> 19) & 7),
+                  off & 0xff, 0xf8 | ((off >> 8) & 7)])
+
+
+def copy_thumb(base, src, dst, length):
+    """Return the output of a DELTA_OP_THUMB copy from src to dst."""
+    adj = (src - dst) >> 1
+    out = bytearray(base[src:src + length])
+    i = 0
+    while i + 4 <= length:
+        if is_thumb_bl(out, i):
+            out[i:i + 4] = move_thumb_bl(out[i:i + 4], adj)
+            i += 4
+        else:
+            i += 2
+    return bytes(out)
+
+
+def thumb_match(base, src, target, dst, align):
+    """Return the length of the DELTA_OP_THUMB copy from src giving target
+    at dst, or 0."""
+    if (src - dst) % 2:
+        return 0
+    adj = (src - dst) >> 1
+    limit = min(len(base) - src, len(target) - dst)
+    i = 0
+    bls = []
+    while i < limit:
+        if i + 4 <= limit and is_thumb_bl(base, src + i):
+            got = move_thumb_bl(base[src + i:src + i + 4], adj)
+            bls.append(i)
+            step = 4
+        else:
+            step = min(2, limit - i)
+            got = base[src + i:src + i + step]
+        want = target[dst + i:dst + i + step]
+        if got != want:
+            i += next(k for k in range(step) if got[k] != want[k])
+            break
+        i += step
+    length = i - i % align
+    # A BL pair cut by the end of the copy would not be adjusted.
+    for bl in reversed(bls):
+        if bl < length < bl + 4:
+            length = bl - bl % align
+        elif bl + 4 <= length:
+            break
+    return length
+
+
+def encode(base, target, align, erased_val=0xff, e='<', thumb=False):
+    """Return the patch rebuilding target from base.
+
+    With thumb, copies may adjust Thumb BL instructions, see copy_thumb().
+    """
+    block = max(DELTA_BLOCK_SIZE, align)
+    target = bytes(target) + bytes([erased_val]) * (-len(target) % align)
+    base = bytes(base)
+
+    # Offset of the first occurrence of every block of the base image.
+    index = {}
+    for i in range(len(base) - block, -1, -1):
+        index[base[i:i + block]] = i
+
+    # Same for the filtered images, in which moved BL instructions still
+    # match since they hold absolute branch targets.
+    if thumb:
+        filtered = lz4.armthumb_filter(target)
+        thumb_index = {}
+        fbase = lz4.armthumb_filter(base)
+        for i in range(len(fbase) - block, -1, -1):
+            thumb_index[fbase[i:i + block]] = i
+
+    patch = bytearray()
+    literal = bytearray()
+    pos = 0
+
+    def flush():
+        if literal:
+            patch.extend(struct.pack(e + 'I', DELTA_OP_INSERT | len(literal)))
+            patch.extend(literal)
+            literal.clear()
+
+    while pos < len(target):
+        length = 0
+        src = index.get(target[pos:pos + block])
+        if src is not None:
+            length = block
+            while (pos + length + align <= len(target) and
+                   src + length + align <= len(base) and
+                   target[pos + length:pos + length + align] ==
+                   base[src + length:src + length + align]):
+                length += align
+        op = length
+        if thumb:
+            tsrc = thumb_index.get(filtered[pos:pos + block])
+            if tsrc is not None:
+                tlength = thumb_match(base, tsrc, target, pos, align)
+                if tlength >= block and tlength > length:
+                    src, length, op = tsrc, tlength, DELTA_OP_THUMB | tlength
+        if length == 0:
+            literal.extend(target[pos:pos + align])
+            pos += align
+            continue
+        flush()
+        patch.extend(struct.pack(e + 'II', op, src))
+        pos += length
+    flush()
+
+    return bytes(patch)
+
+
+def apply(base, patch, e='<'):
+    """Return the output of a patch applied to base."""
+    out = bytearray()
+    pos = 0
+    while pos < len(patch):
+        op, = struct.unpack_from(e + 'I', patch, pos)
+        pos += 4
+        length = op & DELTA_OP_LEN
+        if op & DELTA_OP_INSERT:
+            out.extend(patch[pos:pos + length])
+            pos += length
+        else:
+            src, = struct.unpack_from(e + 'I', patch, pos)
+            pos += 4
+            if src + length > len(base):
+                raise ValueError("COPY outside of the base image")
+            if op & DELTA_OP_THUMB:
+                out.extend(copy_thumb(base, src, len(out), length))
+            else:
+                out.extend(base[src:src + length])
+    return bytes(out)
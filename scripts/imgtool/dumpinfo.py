@@ -17,12 +17,18 @@
 """
 Parse and print header, TLV area and trailer information of a signed image.
 """
+import fnmatch
+import json
+import mmap
 import os.path
 import struct
 import sys
+from concurrent.futures import ThreadPoolExecutor
 
 import click
 import yaml
+from cryptography.exceptions import InvalidSignature
+from intelhex import IntelHex
 
 from imgtool import image
 
@@ -326,3 +332,196 @@ def dump_imginfo(imgfile, outfile=None, silent=False):
 
     footer = "End of Image "
     print_in_row(footer)
+
+
+def find_images(paths, pattern):
+    """Return the files of paths, walking directories for the files whose
+    name matches pattern."""
+    for path in paths:
+        if not os.path.isdir(path):
+            yield path
+            continue
+        for root, dirs, files in os.walk(path):
+            dirs.sort()
+            for name in sorted(files):
+                if fnmatch.fnmatch(name, pattern):
+                    yield os.path.join(root, name)
+
+
+def parse_tlvs(b, off, end, endian):
+    """Return the TLVs found between off and end."""
+    tlvs = []
+    while off < end:
+        if off + image.TLV_SIZE > end:
+            raise ValueError("truncated TLV area")
+        tlv_type, tlv_len = struct.unpack_from(endian + 'HH', b, off)
+        if endian == '>' and tlv_type & 0xff == 0:
+            # The type of the predefined TLVs is written as a byte followed
+            # by a zero byte.
+            tlv_type >>= 8
+        off += image.TLV_SIZE
+        if off + tlv_len > end:
+            raise ValueError("truncated TLV")
+        tlvs.append({"type": tlv_type,
+                     "name": TLV_TYPES.get(tlv_type, "UNKNOWN"),
+                     "len": tlv_len,
+                     "off": off,
+                     "data": b[off:off + tlv_len].hex()})
+        off += tlv_len
+    return tlvs
+
+
+def check_image(b, info, key):
+    """Fill the hash and signature status of the image in info."""
+    endian = info["endian"]
+    header = info["header"]
+    hdr_size = header["hdr_size"]
+    img_size = header["img_size"]
+    prot_end = hdr_size + img_size + header["protected_tlv_size"]
+    tlvs = info["protected_tlvs"] + info["tlvs"]
+
+    with memoryview(b) as view:
+        if header["flags"] & image.IMAGE_F['HASH_CHUNKED']:
+            # verify_hash_chunks() only parses little-endian images.
+            if endian != '<' or not image.Image.verify_hash_chunks(
+                    b, hdr_size, img_size):
+                info["hash"] = "invalid"
+                return
+            hash_region = [view[:hdr_size], view[hdr_size + img_size:prot_end]]
+        else:
+            hash_region = [view[:prot_end]]
+
+        sha_tlv = next((tlv for tlv in tlvs if image.is_sha_tlv(tlv["type"])),
+                       None)
+        if sha_tlv is None:
+            return
+        sha = image.TLV_SHA_TO_SHA_AND_ALG[sha_tlv["type"]].alg()
+        for region in hash_region:
+            sha.update(region)
+        digest = sha.digest()
+        if digest.hex() != sha_tlv["data"]:
+            info["hash"] = "invalid"
+            return
+        info["hash"] = "ok"
+        if key is None:
+            return
+
+        if not image.tlv_matches_key_type(sha_tlv["type"], key):
+            info["signature"] = "key-mismatch"
+            return
+        info["signature"] = "invalid"
+        sig_type = image.TLV_VALUES[key.sig_tlv()]
+        for tlv in tlvs:
+            if tlv["type"] != sig_type:
+                continue
+            sig = bytes.fromhex(tlv["data"])
+            try:
+                if hasattr(key, 'verify'):
+                    key.verify(sig, b''.join(hash_region))
+                else:
+                    key.verify_digest(sig, digest)
+                info["signature"] = "ok"
+                return
+            except InvalidSignature:
+                pass
+
+
+def inspect_image(path, key=None):
+    """Return the header, TLVs, hash and signature status of an image.
+
+    Binary files are memory-mapped, so that only the parts of the image
+    which are parsed or hashed are read.
+    """
+    info = {"file": path}
+    try:
+        if os.path.splitext(path)[1][1:].lower() == image.INTEL_HEX_EXT:
+            inspect_buffer(IntelHex(path).tobinstr(), info, key)
+            return info
+        with open(path, "rb") as f:
+            if os.fstat(f.fileno()).st_size == 0:
+                raise ValueError("empty file")
+            with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as b:
+                inspect_buffer(b, info, key)
+    except (OSError, ValueError, struct.error) as e:
+        info["error"] = str(e)
+    return info
+
+
+def inspect_buffer(b, info, key):
+    info["size"] = len(b)
+    if len(b) < image.IMAGE_HEADER_SIZE:
+        raise ValueError("file smaller than an image header")
+    for endian in ('<', '>'):
+        if struct.unpack_from(endian + 'I', b)[0] == image.IMAGE_MAGIC:
+            break
+    else:
+        raise ValueError("invalid image magic")
+    info["endian"] = endian
+
+    _header = struct.unpack_from(endian + 'IIHHIIBBHI', b)
+    header = dict(zip(HEADER_ITEMS, _header))
+    header["version"] = "{}.{}.{}+{}".format(*_header[-4:])
+    header["flag_names"] = [flag for flag, value in image.IMAGE_F.items()
+                            if header["flags"] & value]
+    info["header"] = header
+
+    tlv_off = header["hdr_size"] + header["img_size"]
+    info["protected_tlvs"] = []
+    if header["protected_tlv_size"] != 0:
+        magic, tlv_tot = struct.unpack_from(endian + 'HH', b, tlv_off)
+        if (magic != image.TLV_PROT_INFO_MAGIC or
+                tlv_tot != header["protected_tlv_size"]):
+            raise ValueError("invalid protected TLV area")
+        info["protected_tlvs"] = parse_tlvs(b, tlv_off + image.TLV_INFO_SIZE,
+                                            tlv_off + tlv_tot, endian)
+        tlv_off += tlv_tot
+
+    magic, tlv_tot = struct.unpack_from(endian + 'HH', b, tlv_off)
+    if magic != image.TLV_INFO_MAGIC:
+        raise ValueError("invalid TLV area magic")
+    info["tlvs"] = parse_tlvs(b, tlv_off + image.TLV_INFO_SIZE,
+                              tlv_off + tlv_tot, endian)
+    tlv_end = tlv_off + tlv_tot
+
+    info["trailer_magic"] = None
+    if len(b) > tlv_end:
+        magic = b[-BOOT_MAGIC_SIZE:]
+        if magic == BOOT_MAGIC or magic[-len(BOOT_MAGIC_2):] == BOOT_MAGIC_2:
+            info["trailer_magic"] = "good"
+        else:
+            info["trailer_magic"] = "bad"
+
+    info["hash"] = "missing"
+    info["signature"] = "unchecked" if key is None else "missing"
+    check_image(b, info, key)
+
+
+def image_failed(info):
+    return ("error" in info or info["hash"] != "ok" or
+            info["signature"] not in ("ok", "unchecked"))
+
+
+def dump_imginfo_bulk(paths, outfile=None, key=None, pattern="*.bin",
+                      jobs=None):
+    """Inspect every image of paths and directories and write the result as
+    a JSON list, to outfile or stdout.
+
+    Returns the number of images which could not be parsed or whose hash or
+    signature is not valid.
+    """
+    files = list(find_images(paths, pattern))
+    if jobs is None:
+        jobs = os.cpu_count() or 1
+    # File reads and hashing release the GIL, so threads are enough.
+    with ThreadPoolExecutor(max(1, jobs)) as pool:
+        infos = list(pool.map(lambda path: inspect_image(path, key), files))
+
+    if outfile is not None:
+        with open(outfile, "w") as outf:
+            json.dump(infos, outf, indent=2)
+            outf.write("\n")
+    else:
+        json.dump(infos, sys.stdout, indent=2)
+        sys.stdout.write("\n")
+    return sum(1 for info in infos if image_failed(info))
+
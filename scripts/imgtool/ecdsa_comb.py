@@ -0,0 +1,94 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Precomputed comb tables for ECDSA P-256 signature verification.
+
+For a point P, the table holds the 15 affine points
+sum(b_j * 2^(64 * j) * P) for j in 0..3, where b_j is bit j of the entry
+index plus one. It is used by bootutil when MCUBOOT_ECDSA_P256_COMB is
+enabled, see boot/bootutil/include/bootutil/ecdsa_comb.h.
+"""
+
+P256_P = 0xffffffff00000001000000000000000000000000ffffffffffffffffffffffff
+P256_A = P256_P - 3
+P256_N = 0xffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551
+P256_G = (0x6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296,
+          0x4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5)
+
+COMB_TEETH = 4
+COMB_SPACING = 64
+
+
+def point_add(p, q):
+    """Add two affine points, None being the point at infinity."""
+    if p is None:
+        return q
+    if q is None:
+        return p
+    if p[0] == q[0]:
+        if (p[1] + q[1]) % P256_P == 0:
+            return None
+        lam = (3 * p[0] * p[0] + P256_A) * pow(2 * p[1], -1, P256_P)
+    else:
+        lam = (q[1] - p[1]) * pow(q[0] - p[0], -1, P256_P)
+    lam %= P256_P
+    x = (lam * lam - p[0] - q[0]) % P256_P
+    return (x, (lam * (p[0] - x) - p[1]) % P256_P)
+
+
+def point_mul(k, p):
+    """Multiply an affine point by a scalar."""
+    r = None
+    while k:
+        if k & 1:
+            r = point_add(r, p)
+        p = point_add(p, p)
+        k >>= 1
+    return r
+
+
+def comb_table(point):
+    """Return the 15 comb table points of an affine point."""
+    teeth = [point_mul(1 << (COMB_SPACING * j), point)
+             for j in range(COMB_TEETH)]
+    table = []
+    for idx in range(1, 1 << COMB_TEETH):
+        acc = None
+        for j in range(COMB_TEETH):
+            if idx & (1 << j):
+                acc = point_add(acc, teeth[j])
+        table.append(acc)
+    return table
+
+
+def _words(value):
+    """Split a field element into 32-bit words, least significant first."""
+    return [(value >> (32 * i)) & 0xffffffff for i in range(8)]
+
+
+def emit_c_comb(name, point, file):
+    """Emit the comb table of a point as a struct bootutil_ecdsa_comb."""
+    print("const struct bootutil_ecdsa_comb {} = {{".format(name), file=file)
+    print("    .points = {", file=file)
+    for x, y in comb_table(point):
+        words = _words(x) + _words(y)
+        print("        {", file=file)
+        for i in range(0, len(words), 4):
+            print("            " +
+                  " ".join("0x{:08x},".format(w) for w in words[i:i + 4]),
+                  file=file)
+        print("        },", file=file)
+    print("    },", file=file)
+    print("};", file=file)
@@ -0,0 +1,233 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Streaming Intel HEX and binary output, and assembly of factory images.
+
+The writers take data in increasing address order and write it out as it
+comes, instead of building the whole output in memory as intelhex does with
+one dictionary entry per byte. HexWriter writes the same records as
+IntelHex.tofile(): 16 data bytes per record, no record crossing a 64 KiB
+boundary, and extended linear address records only when the data goes
+beyond the first 64 KiB.
+"""
+
+import os
+
+INTEL_HEX_EXT = "hex"
+RECORD_SIZE = 16
+BLOCK_SIZE = 0x10000
+
+REC_DATA = 0
+REC_EOF = 1
+REC_EXT_SEGMENT = 2
+REC_EXT_LINEAR = 4
+
+
+def _record(rtype, addr, data=b''):
+    rec = bytes([len(data), (addr >> 8) & 0xff, addr & 0xff, rtype]) + data
+    return ':{}{:02X}\n'.format(rec.hex().upper(), -sum(rec) & 0xff)
+
+
+class HexWriter:
+    """Write data to an Intel HEX text file.
+
+    max_addr is the highest address that will be written, which tells
+    whether extended linear address records are needed; if it is not known,
+    they are always written.
+    """
+
+    def __init__(self, f, max_addr=None):
+        self.f = f
+        self.ela = max_addr is None or max_addr > 0xffff
+        self.high = None
+        self.end = 0
+        # Start of the last record, kept until the next write as that one
+        # may continue it.
+        self.pending_addr = 0
+        self.pending = b''
+
+    def write(self, addr, data):
+        if addr < self.end:
+            raise ValueError("Data at 0x{:x} overlaps or precedes data up to "
+                             "0x{:x}".format(addr, self.end))
+        end = addr + len(data)
+        data = bytes(data)
+        if self.pending:
+            if addr == self.end:
+                addr = self.pending_addr
+                data = self.pending + data
+            else:
+                self.f.write(self._records(self.pending_addr, self.pending))
+            self.pending = b''
+        self.end = end
+        self.f.write(self._records(addr, data, keep_last=True))
+
+    def close(self):
+        if self.pending:
+            self.f.write(self._records(self.pending_addr, self.pending))
+            self.pending = b''
+        self.f.write(_record(REC_EOF, 0))
+
+    def _records(self, addr, data, keep_last=False):
+        lines = []
+        pos = 0
+        while pos < len(data):
+            a = addr + pos
+            size = min(RECORD_SIZE, 0x10000 - (a & 0xffff), len(data) - pos)
+            # A short last record, not ending on a 64 KiB boundary, is kept
+            # back as the next write may continue it.
+            if (keep_last and pos + size == len(data) and
+                    size < RECORD_SIZE and (a + size) & 0xffff != 0):
+                self.pending_addr = a
+                self.pending = data[pos:]
+                break
+            if self.ela and a >> 16 != self.high:
+                self.high = a >> 16
+                lines.append(_record(REC_EXT_LINEAR, 0,
+                                     self.high.to_bytes(2, 'big')))
+            lines.append(_record(REC_DATA, a & 0xffff, data[pos:pos + size]))
+            pos += size
+        return ''.join(lines)
+
+
+class BinWriter:
+    """Write data to a binary file starting at address base, filling the
+    gaps with erased_val. Without base, the file starts at the first address
+    written."""
+
+    def __init__(self, f, base=None, erased_val=0xff):
+        self.f = f
+        self.end = base
+        self.erased_val = erased_val
+
+    def write(self, addr, data):
+        if self.end is None:
+            self.end = addr
+        if addr < self.end:
+            raise ValueError("Data at 0x{:x} overlaps or precedes data up to "
+                             "0x{:x}".format(addr, self.end))
+        gap = addr - self.end
+        fill = bytes([self.erased_val]) * min(gap, BLOCK_SIZE)
+        while gap > 0:
+            self.f.write(fill[:gap])
+            gap -= len(fill)
+        self.f.write(data)
+        self.end = addr + len(data)
+
+    def close(self):
+        pass
+
+
+def read_hex(path):
+    """Yield the (address, data) blocks of an Intel HEX file, merging
+    contiguous records into blocks of up to BLOCK_SIZE bytes."""
+    base = 0
+    addr = None
+    block = bytearray()
+    with open(path, 'r') as f:
+        for n, line in enumerate(f, 1):
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                if line[0] != ':':
+                    raise ValueError
+                rec = bytes.fromhex(line[1:])
+                if len(rec) < 5 or rec[0] != len(rec) - 5 or sum(rec) & 0xff:
+                    raise ValueError
+            except ValueError:
+                raise ValueError("{}:{}: invalid record".format(path, n))
+            rtype = rec[3]
+            data = rec[4:-1]
+            if rtype == REC_DATA:
+                a = base + (rec[1] << 8 | rec[2])
+                if block and (a != addr + len(block) or
+                              len(block) >= BLOCK_SIZE):
+                    yield addr, bytes(block)
+                    block = bytearray()
+                if not block:
+                    addr = a
+                block += data
+            elif rtype == REC_EOF:
+                break
+            elif rtype == REC_EXT_SEGMENT:
+                base = int.from_bytes(data, 'big') << 4
+            elif rtype == REC_EXT_LINEAR:
+                base = int.from_bytes(data, 'big') << 16
+    if block:
+        yield addr, bytes(block)
+
+
+def _read_bin(path, addr):
+    with open(path, 'rb') as f:
+        while True:
+            block = f.read(BLOCK_SIZE)
+            if not block:
+                break
+            yield addr, block
+            addr += len(block)
+
+
+def _is_hex(path):
+    return os.path.splitext(path)[1][1:].lower() == INTEL_HEX_EXT
+
+
+def assemble(inputs, outfile, erased_val=0xff, base=None):
+    """Write the files of inputs, a list of (path, address) pairs, to
+    outfile in one pass over them, in Intel HEX if outfile has a .hex
+    extension and as a binary otherwise.
+
+    Binary files are placed at the address they are given with; Intel HEX
+    files carry their own addresses and are given None. A binary output
+    starts at base, or at the lowest input address, and its gaps are filled
+    with erased_val. The inputs must not overlap.
+    """
+    sources = []
+    for path, addr in inputs:
+        if _is_hex(path):
+            if addr is not None:
+                raise ValueError("{}: Intel HEX files carry their own "
+                                 "addresses".format(path))
+            blocks = read_hex(path)
+            first = next(blocks, None)
+            blocks.close()
+            if first is None:
+                continue
+            sources.append((first[0], path, read_hex(path)))
+        else:
+            if addr is None:
+                raise ValueError("{}: binary files need an address".format(
+                                 path))
+            sources.append((addr, path, _read_bin(path, addr)))
+    sources.sort(key=lambda s: s[0])
+
+    if _is_hex(outfile):
+        f = open(outfile, 'w')
+        out = HexWriter(f)
+    else:
+        f = open(outfile, 'wb')
+        out = BinWriter(f, base, erased_val)
+    try:
+        with f:
+            for _, path, blocks in sources:
+                for addr, data in blocks:
+                    try:
+                        out.write(addr, data)
+                    except ValueError as e:
+                        raise ValueError("{}: {}".format(path, e))
+            out.close()
+    except BaseException:
+        os.remove(outfile)
+        raise
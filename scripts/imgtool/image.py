@@ -28,6 +28,7 @@ from enum import Enum
 import array
 from intelhex import IntelHex
 import hashlib
+import io
 import array
 import os.path
 import struct
@@ -40,11 +41,12 @@ from cryptography.hazmat.primitives import hashes, hmac
 from cryptography.hazmat.primitives.asymmetric import ec, padding
 from cryptography.hazmat.primitives.asymmetric.x25519 import X25519PrivateKey
 from cryptography.hazmat.primitives.ciphers import Cipher, algorithms, modes
+from cryptography.hazmat.primitives.ciphers.aead import AESGCM
 from cryptography.hazmat.primitives.kdf.hkdf import HKDF
 from cryptography.hazmat.primitives.serialization import Encoding, PublicFormat
 from intelhex import IntelHex
 
-from . import version as versmod, keys
+from . import version as versmod, keys, hexfile
 from .boot_record import create_sw_component_data
 from .keys import rsa, ecdsa, x25519
 
@@ -59,6 +61,7 @@ DEFAULT_MAX_ALIGN = 8
 DEP_IMAGES_KEY = "images"
 DEP_VERSIONS_KEY = "versions"
 MAX_SW_TYPE_LENGTH = 12  # Bytes
+STREAM_BLOCK_SIZE = 64 * 1024
 
 # Image header flags.
 IMAGE_F = {
@@ -71,6 +74,11 @@ IMAGE_F = {
         'COMPRESSED_LZMA1':      0x0000200,
         'COMPRESSED_LZMA2':      0x0000400,
         'COMPRESSED_ARM_THUMB':  0x0000800,
+        'HASH_CHUNKED':          0x0001000,
+        'DELTA':                 0x0002000,
+        'COMPRESSED_LZ4':        0x0004000,
+        'ENCRYPTED_GCM':         0x0008000,
+        'RAM_LOAD_SEGMENTS':     0x0010000,
 }
 
 TLV_VALUES = {
@@ -79,6 +87,10 @@ TLV_VALUES = {
         'SHA256': 0x10,
         'SHA384': 0x11,
         'SHA512': 0x12,
+        'HASH_CHUNKS': 0x14,
+        'RAM_LOAD_STAGE': 0x15,
+        'RAM_LOAD_SEGMENTS': 0x16,
+        'SECTOR_DIGESTS': 0x17,
         'RSA2048': 0x20,
         'ECDSASIG': 0x22,
         'RSA3072': 0x23,
@@ -88,12 +100,14 @@ TLV_VALUES = {
         'ENCKW': 0x31,
         'ENCEC256': 0x32,
         'ENCX25519': 0x33,
+        'ENC_GCM_TAG': 0x34,
         'DEPENDENCY': 0x40,
         'SEC_CNT': 0x50,
         'BOOT_RECORD': 0x60,
         'DECOMP_SIZE': 0x70,
         'DECOMP_SHA': 0x71,
         'DECOMP_SIGNATURE': 0x72,
+        'DELTA_BASE': 0x73,
 }
 
 TLV_SIZE = 4
@@ -240,6 +254,25 @@ def tlv_matches_key_type(tlv_type, key):
     return False
 
 
+class ZeroPaddedFile:
+    """Read-only view of a file followed by zeros, up to size bytes."""
+
+    def __init__(self, f, size):
+        self.f = f
+        self.size = size
+        self.pos = 0
+
+    def seek(self, pos):
+        self.pos = pos
+        self.f.seek(pos)
+
+    def read(self, n):
+        n = max(0, min(n, self.size - self.pos))
+        data = self.f.read(n)
+        self.pos += n
+        return data + bytes(n - len(data))
+
+
 class Image:
 
     def __init__(self, version=None, header_size=IMAGE_HEADER_SIZE,
@@ -248,7 +281,10 @@ class Image:
                  overwrite_only=False, endian="little", load_addr=0,
                  rom_fixed=None, erased_val=None, save_enctlv=False,
                  security_counter=None, max_align=None,
-                 non_bootable=False):
+                 non_bootable=False, hash_chunk_size=None,
+                 wrapped_key_size=None, ram_load_stage=None,
+                 ram_load_segments=None, sector_digest_size=None,
+                 primary_slot=False, layout_align=None, sig_cache=None):
 
         if load_addr and rom_fixed:
             raise click.UsageError("Can not set rom_fixed and load_addr at the same time")
@@ -275,8 +311,17 @@ class Image:
         self.enckey = None
         self.save_enctlv = save_enctlv
         self.enctlv_len = 0
+        self.encrypt_mode = 'ctr'
+        self.wrapped_key_size = wrapped_key_size
         self.max_align = max(DEFAULT_MAX_ALIGN, align) if max_align is None else int(max_align)
         self.non_bootable = non_bootable
+        self.hash_chunk_size = hash_chunk_size
+        self.ram_load_stage = ram_load_stage
+        self.ram_load_segments = ram_load_segments
+        self.sector_digest_size = sector_digest_size
+        self.primary_slot = primary_slot
+        self.layout_align = layout_align
+        self.sig_cache = sig_cache
 
         if self.max_align == DEFAULT_MAX_ALIGN:
             self.boot_magic = bytes([
@@ -348,8 +393,12 @@ class Image:
         self.check_header()
 
     def load_compressed(self, data, compression_header):
+        """Load a compressed image from buffer"""
+        self.load_buffer(compression_header + data)
+
+    def load_buffer(self, data):
         """Load an image from buffer"""
-        self.payload = compression_header + data
+        self.payload = data
         self.image_size = len(self.payload)
 
         # Add the image header if needed.
@@ -370,28 +419,36 @@ class Image:
             if self.base_addr is None and hex_addr is None:
                 raise click.UsageError("No address exists in input file "
                                        "neither was it provided by user")
-            h = IntelHex()
             if hex_addr is not None:
                 self.base_addr = hex_addr
-            h.frombytes(bytes=self.payload, offset=self.base_addr)
-            if self.pad:
-                trailer_size = self._trailer_size(self.align, self.max_sectors,
-                                                  self.overwrite_only,
-                                                  self.enckey,
-                                                  self.save_enctlv,
-                                                  self.enctlv_len)
-                trailer_addr = (self.base_addr + self.slot_size) - trailer_size
-                if self.confirm and not self.overwrite_only:
-                    magic_align_size = align_up(len(self.boot_magic),
-                                                self.max_align)
-                    image_ok_idx = -(magic_align_size + self.max_align)
-                    flag = bytearray([self.erased_val] * self.max_align)
-                    flag[0] = 0x01  # image_ok = 0x01
-                    h.puts(trailer_addr + trailer_size + image_ok_idx,
-                           bytes(flag))
-                h.puts(trailer_addr + (trailer_size - len(self.boot_magic)),
-                       bytes(self.boot_magic))
-            h.tofile(path, 'hex')
+            # As with intelhex, the padding up to the trailer fields is
+            # left out.
+            end = self.base_addr + (self.slot_size if self.pad
+                                    else len(self.payload))
+            with open(path, 'w') as f:
+                h = hexfile.HexWriter(f, end - 1)
+                h.write(self.base_addr, self.payload)
+                if self.pad:
+                    trailer_size = self._trailer_size(self.align,
+                                                      self.max_sectors,
+                                                      self.overwrite_only,
+                                                      self.enckey,
+                                                      self.save_enctlv,
+                                                      self.enctlv_len)
+                    trailer_addr = (self.base_addr + self.slot_size) - \
+                        trailer_size
+                    if self.confirm and not self.overwrite_only:
+                        magic_align_size = align_up(len(self.boot_magic),
+                                                    self.max_align)
+                        image_ok_idx = -(magic_align_size + self.max_align)
+                        flag = bytearray([self.erased_val] * self.max_align)
+                        flag[0] = 0x01  # image_ok = 0x01
+                        h.write(trailer_addr + trailer_size + image_ok_idx,
+                                bytes(flag))
+                    h.write(trailer_addr +
+                            (trailer_size - len(self.boot_magic)),
+                            bytes(self.boot_magic))
+                h.close()
         else:
             if self.pad:
                 self.pad_to(self.slot_size)
@@ -404,16 +461,18 @@ class Image:
                 raise click.UsageError("Header padding was not requested and "
                                        "image does not start with zeros")
 
-    def check_trailer(self):
+    def check_trailer(self, size=None):
+        if size is None:
+            size = len(self.payload)
         if self.slot_size > 0:
             tsize = self._trailer_size(self.align, self.max_sectors,
                                        self.overwrite_only, self.enckey,
                                        self.save_enctlv, self.enctlv_len)
-            padding = self.slot_size - (len(self.payload) + tsize)
+            padding = self.slot_size - (size + tsize)
             if padding < 0:
                 msg = "Image size (0x{:x}) + trailer (0x{:x}) exceeds " \
                       "requested size 0x{:x}".format(
-                          len(self.payload), tsize, self.slot_size)
+                          size, tsize, self.slot_size)
                 raise click.UsageError(msg)
 
     def ecies_hkdf(self, enckey, plainkey):
@@ -447,78 +506,44 @@ class Image:
     def create(self, key, public_key_format, enckey, dependencies=None,
                sw_type=None, custom_tlvs=None, compression_tlvs=None,
                compression_type=None, encrypt_keylen=128, clear=False,
-               fixed_sig=None, pub_key=None, vector_to_sign=None, user_sha='auto'):
+               fixed_sig=None, pub_key=None, vector_to_sign=None, user_sha='auto',
+               encrypt_mode='ctr'):
         self.enckey = enckey
+        self.encrypt_mode = encrypt_mode
+
+        if (enckey is not None and encrypt_mode == 'gcm' and clear and
+                not self.primary_slot):
+            raise click.UsageError("AES-GCM images can not be output in "
+                                   "clear, their tag is over the encrypted "
+                                   "payload")
 
         # key decides on sha, then pub_key; of both are none default is used
         check_key = key if key is not None else pub_key
         hash_algorithm, hash_tlv = key_and_user_sha_to_alg_and_tlv(check_key, user_sha)
 
-        # Calculate the hash of the public key
-        if key is not None:
-            pub = key.get_public_bytes()
-            sha = hash_algorithm()
-            sha.update(pub)
-            pubbytes = sha.digest()
-        elif pub_key is not None:
-            if hasattr(pub_key, 'sign'):
-                print(os.path.basename(__file__) + ": sign the payload")
-            pub = pub_key.get_public_bytes()
-            sha = hash_algorithm()
-            sha.update(pub)
-            pubbytes = sha.digest()
-        else:
-            pubbytes = bytes(hashlib.sha256().digest_size)
-
-        protected_tlv_size = 0
-
-        if self.security_counter is not None:
-            # Size of the security counter TLV: header ('HH') + payload ('I')
-            #                                   = 4 + 4 = 8 Bytes
-            protected_tlv_size += TLV_SIZE + 4
-
-        if sw_type is not None:
-            if len(sw_type) > MAX_SW_TYPE_LENGTH:
-                msg = "'{}' is too long ({} characters) for sw_type. Its " \
-                      "maximum allowed length is 12 characters.".format(
-                       sw_type, len(sw_type))
-                raise click.UsageError(msg)
-
-            image_version = (str(self.version.major) + '.'
-                             + str(self.version.minor) + '.'
-                             + str(self.version.revision))
-
-            # The image hash is computed over the image header, the image
-            # itself and the protected TLV area. However, the boot record TLV
-            # (which is part of the protected area) should contain this hash
-            # before it is even calculated. For this reason the script fills
-            # this field with zeros and the bootloader will insert the right
-            # value later.
-            digest = bytes(hash_algorithm().digest_size)
-
-            # Create CBOR encoded boot record
-            boot_record = create_sw_component_data(sw_type, image_version,
-                                                   hash_tlv, digest,
-                                                   pubbytes)
-
-            protected_tlv_size += TLV_SIZE + len(boot_record)
-
-        if dependencies is not None:
-            # Size of a Dependency TLV = Header ('HH') + Payload('IBBHI')
-            # = 4 + 12 = 16 Bytes
-            dependencies_num = len(dependencies[DEP_IMAGES_KEY])
-            protected_tlv_size += (dependencies_num * 16)
-
-        if compression_tlvs is not None:
-            for value in compression_tlvs.values():
-                protected_tlv_size += TLV_SIZE + len(value)
-        if custom_tlvs is not None:
-            for value in custom_tlvs.values():
-                protected_tlv_size += TLV_SIZE + len(value)
-
-        if protected_tlv_size != 0:
-            # Add the size of the TLV info header
-            protected_tlv_size += TLV_INFO_SIZE
+        pub, pubbytes = self.public_key_hash(key, pub_key, hash_algorithm)
+
+        # The TLV area starts right after the payload, which is padded so
+        # that it starts on the layout boundary as well.
+        self.payload += bytes(self.layout_pad(len(self.payload)))
+
+        body_size = len(self.payload) - self.header_size
+        segments = self.check_layout(enckey, compression_tlvs, body_size)
+        chunk_table = None
+        if self.hash_chunk_size is not None:
+            chunk_table = self.hash_chunks(hash_algorithm,
+                                           self.payload[self.header_size:])
+        sector_table = None
+        if self.sector_digest_size is not None:
+            body = io.BytesIO(bytes(self.payload[self.header_size:]))
+            sector_table = self.sector_digests(hash_algorithm, body.read,
+                                               self.padded_size(enckey,
+                                                                body_size))
+
+        prot_tlv = self.protected_tlvs(hash_algorithm, hash_tlv, pubbytes,
+                                       dependencies, sw_type, custom_tlvs,
+                                       compression_tlvs, chunk_table,
+                                       segments, sector_table)
 
         # At this point the image is already on the payload
         #
@@ -539,49 +564,23 @@ class Image:
                 compression_flags = IMAGE_F['COMPRESSED_LZMA2']
                 if compression_type == "lzma2armthumb":
                     compression_flags |= IMAGE_F['COMPRESSED_ARM_THUMB']
+            elif compression_type in ["lz4", "lz4armthumb"]:
+                compression_flags = IMAGE_F['COMPRESSED_LZ4']
+                if compression_type == "lz4armthumb":
+                    compression_flags |= IMAGE_F['COMPRESSED_ARM_THUMB']
+            elif compression_type == "delta":
+                compression_flags = IMAGE_F['DELTA']
         # This adds the header to the payload as well
         if encrypt_keylen == 256:
-            self.add_header(enckey, protected_tlv_size, compression_flags, 256)
+            self.add_header(enckey, len(prot_tlv.get()), compression_flags,
+                            256)
         else:
-            self.add_header(enckey, protected_tlv_size, compression_flags)
-
-        prot_tlv = TLV(self.endian, TLV_PROT_INFO_MAGIC)
+            self.add_header(enckey, len(prot_tlv.get()), compression_flags)
 
         # Protected TLVs must be added first, because they are also included
         # in the hash calculation
-        protected_tlv_off = None
-        if protected_tlv_size != 0:
-
-            e = STRUCT_ENDIAN_DICT[self.endian]
-
-            if self.security_counter is not None:
-                payload = struct.pack(e + 'I', self.security_counter)
-                prot_tlv.add('SEC_CNT', payload)
-
-            if sw_type is not None:
-                prot_tlv.add('BOOT_RECORD', boot_record)
-
-            if dependencies is not None:
-                for i in range(dependencies_num):
-                    payload = struct.pack(
-                        e + 'B3x' + 'BBHI',
-                        int(dependencies[DEP_IMAGES_KEY][i]),
-                        dependencies[DEP_VERSIONS_KEY][i].major,
-                        dependencies[DEP_VERSIONS_KEY][i].minor,
-                        dependencies[DEP_VERSIONS_KEY][i].revision,
-                        dependencies[DEP_VERSIONS_KEY][i].build
-                    )
-                    prot_tlv.add('DEPENDENCY', payload)
-
-            if compression_tlvs is not None:
-                for tag, value in compression_tlvs.items():
-                    prot_tlv.add(tag, value)
-            if custom_tlvs is not None:
-                for tag, value in custom_tlvs.items():
-                    prot_tlv.add(tag, value)
-
-            protected_tlv_off = len(self.payload)
-            self.payload += prot_tlv.get()
+        protected_tlv_off = len(self.payload)
+        self.payload += prot_tlv.get()
 
         tlv = TLV(self.endian)
 
@@ -589,10 +588,16 @@ class Image:
         # EC signatures so called Pure algorithm, designated to be run
         # over entire message is used with sha of image as message,
         # so, for example, in case of ED25519 we have here SHAxxx-ED25519-SHA512.
+        if self.hash_chunk_size is not None:
+            # The payload is covered by the chunk table, only the header
+            # and the protected TLVs are hashed and signed.
+            hash_region = bytes(self.payload[:self.header_size] +
+                                self.payload[protected_tlv_off:])
+        else:
+            hash_region = bytes(self.payload)
         sha = hash_algorithm()
-        sha.update(self.payload)
+        sha.update(hash_region)
         digest = sha.digest()
-        message = digest;
         tlv.add(hash_tlv, digest)
         self.image_hash = digest
 
@@ -606,61 +611,26 @@ class Image:
             print(os.path.basename(__file__) + ': export digest')
             return
 
-        if key is not None or fixed_sig is not None:
-            if public_key_format == 'hash':
-                tlv.add('KEYHASH', pubbytes)
-            else:
-                tlv.add('PUBKEY', pub)
-
-            if key is not None and fixed_sig is None:
-                # `sign` expects the full image payload (hashing done
-                # internally), while `sign_digest` expects only the digest
-                # of the payload
-
-                if hasattr(key, 'sign'):
-                    print(os.path.basename(__file__) + ": sign the payload")
-                    sig = key.sign(bytes(self.payload))
-                else:
-                    print(os.path.basename(__file__) + ": sign the digest")
-                    sig = key.sign_digest(message)
-                tlv.add(key.sig_tlv(), sig)
-                self.signature = sig
-            elif fixed_sig is not None and key is None:
-                tlv.add(pub_key.sig_tlv(), fixed_sig['value'])
-                self.signature = fixed_sig['value']
-            else:
-                raise click.UsageError("Can not sign using key and provide fixed-signature at the same time")
+        self.add_signature(tlv, key, public_key_format, pub, pubbytes,
+                           fixed_sig, pub_key, digest, hash_region)
 
         # At this point the image was hashed + signed, we can remove the
         # protected TLVs from the payload (will be re-added later)
-        if protected_tlv_off is not None:
-            self.payload = self.payload[:protected_tlv_off]
+        self.payload = self.payload[:protected_tlv_off]
 
         if enckey is not None:
-            if encrypt_keylen == 256:
-                plainkey = os.urandom(32)
-            else:
-                plainkey = os.urandom(16)
-
-            if isinstance(enckey, rsa.RSAPublic):
-                cipherkey = enckey._get_public().encrypt(
-                    plainkey, padding.OAEP(
-                        mgf=padding.MGF1(algorithm=hashes.SHA256()),
-                        algorithm=hashes.SHA256(),
-                        label=None))
-                self.enctlv_len = len(cipherkey)
-                tlv.add('ENCRSA2048', cipherkey)
-            elif isinstance(enckey, (ecdsa.ECDSA256P1Public,
-                                     x25519.X25519Public)):
-                cipherkey, mac, pubk = self.ecies_hkdf(enckey, plainkey)
-                enctlv = pubk + mac + cipherkey
-                self.enctlv_len = len(enctlv)
-                if isinstance(enckey, ecdsa.ECDSA256P1Public):
-                    tlv.add('ENCEC256', enctlv)
-                else:
-                    tlv.add('ENCX25519', enctlv)
+            plainkey = os.urandom(32 if encrypt_keylen == 256 else 16)
+            tlv.add(*self.wrap_key(enckey, plainkey))
 
-            if not clear:
+            if self.encrypt_mode == 'gcm':
+                # Image keys are random and used once, so the IV is all
+                # zeroes, like the AES-CTR nonce.
+                img = bytes(self.payload[self.header_size:])
+                out = AESGCM(plainkey).encrypt(bytes(12), img, None)
+                if not clear:
+                    self.payload[self.header_size:] = out[:-16]
+                tlv.add('ENC_GCM_TAG', out[-16:])
+            elif not clear:
                 nonce = bytes([0] * 16)
                 cipher = Cipher(algorithms.AES(plainkey), modes.CTR(nonce),
                                 backend=default_backend())
@@ -674,6 +644,488 @@ class Image:
 
         self.check_trailer()
 
+    def create_stream(self, infile, outfile, key, public_key_format, enckey,
+                      dependencies=None, sw_type=None, custom_tlvs=None,
+                      encrypt_keylen=128, clear=False, fixed_sig=None,
+                      pub_key=None, user_sha='auto', encrypt_mode='ctr'):
+        """Sign infile into outfile without holding the image in memory.
+
+        The output is the same as the one of load(), create() and save(),
+        but the payload is read, hashed, encrypted and written in blocks of
+        STREAM_BLOCK_SIZE bytes, so that images larger than the host memory
+        can be signed. Only binary files are supported; compressed and
+        delta images, which need the whole payload, can not be streamed.
+        """
+        for path in (infile, outfile):
+            if os.path.splitext(path)[1][1:].lower() == INTEL_HEX_EXT:
+                raise click.UsageError("Streamed signing only supports "
+                                       "binary files")
+        self.enckey = enckey
+        self.encrypt_mode = encrypt_mode
+
+        if (enckey is not None and encrypt_mode == 'gcm' and clear and
+                not self.primary_slot):
+            raise click.UsageError("AES-GCM images can not be output in "
+                                   "clear, their tag is over the encrypted "
+                                   "payload")
+
+        check_key = key if key is not None else pub_key
+        hash_algorithm, hash_tlv = key_and_user_sha_to_alg_and_tlv(check_key, user_sha)
+        if key is not None and fixed_sig is None and hasattr(key, 'sign') \
+                and not hasattr(key, 'sign_prehashed'):
+            raise click.UsageError("This key type can not sign a streamed "
+                                   "image")
+
+        pub, pubbytes = self.public_key_hash(key, pub_key, hash_algorithm)
+
+        try:
+            file_size = os.path.getsize(infile)
+        except FileNotFoundError:
+            raise click.UsageError("Input file not found")
+        # Offset of the payload in the input file, which starts with the
+        # header unless it is padded here.
+        body_off = 0 if self.pad_header else self.header_size
+        if file_size < body_off:
+            raise click.UsageError("Input file is smaller than the header")
+        body_size = file_size - body_off
+        self.image_size = file_size
+        layout_pad = self.layout_pad(self.header_size + body_size)
+        body_size += layout_pad
+
+        segments = self.check_layout(enckey, None, body_size)
+
+        if self.header_size < IMAGE_HEADER_SIZE:
+            raise click.UsageError("Streamed signing requires a header size "
+                                   "of at least {} bytes".format(
+                                       IMAGE_HEADER_SIZE))
+
+        with open(infile, 'rb') as infd:
+            f = infd
+            if layout_pad:
+                f = ZeroPaddedFile(infd, body_off + body_size)
+            if self.pad_header:
+                filler = bytes([self.erased_val] * self.header_size)
+            else:
+                filler = f.read(self.header_size)
+                if any(v != 0 for v in filler):
+                    raise click.UsageError("Header padding was not requested "
+                                           "and image does not start with "
+                                           "zeros")
+
+            chunk_table = None
+            if self.hash_chunk_size is not None:
+                chunk_table = self.stream_hash_chunks(hash_algorithm, f,
+                                                      body_off, body_size)
+            sector_table = None
+            if self.sector_digest_size is not None:
+                f.seek(body_off)
+                sector_table = self.sector_digests(
+                    hash_algorithm, f.read,
+                    self.padded_size(enckey, body_size))
+
+            prot_tlv = self.protected_tlvs(hash_algorithm, hash_tlv,
+                                           pubbytes, dependencies, sw_type,
+                                           custom_tlvs, None, chunk_table,
+                                           segments, sector_table)
+
+            # Encrypted payloads are padded to the AES block size, in the
+            # hashed payload as well.
+            pad = bytes()
+            if enckey is not None and (self.header_size + body_size) % 16:
+                pad = bytes(16 - (self.header_size + body_size) % 16)
+
+            header = self.build_header(enckey, len(prot_tlv.get()), 0,
+                                       256 if encrypt_keylen == 256 else 128,
+                                       body_size + len(pad))
+            header += filler[len(header):]
+
+            tlv = TLV(self.endian)
+            encryptor = None
+            if enckey is not None:
+                plainkey = os.urandom(32 if encrypt_keylen == 256 else 16)
+                enctlv = self.wrap_key(enckey, plainkey)
+                if self.encrypt_mode == 'gcm':
+                    # Same all zeroes IV as create(), the tag is that of
+                    # AESGCM over the payload.
+                    encryptor = Cipher(algorithms.AES(plainkey),
+                                       modes.GCM(bytes(12)),
+                                       backend=default_backend()).encryptor()
+                elif not clear:
+                    encryptor = Cipher(algorithms.AES(plainkey),
+                                       modes.CTR(bytes([0] * 16)),
+                                       backend=default_backend()).encryptor()
+
+            sha = hash_algorithm()
+            sha.update(header)
+            try:
+                with open(outfile, 'wb') as out:
+                    out.write(header)
+                    f.seek(body_off)
+                    remaining = body_size
+                    while remaining > 0 or pad:
+                        if remaining > 0:
+                            block = f.read(min(STREAM_BLOCK_SIZE, remaining))
+                            if not block:
+                                raise click.UsageError("Input file changed "
+                                                       "while signing")
+                            remaining -= len(block)
+                        else:
+                            block, pad = pad, bytes()
+                        if self.hash_chunk_size is None:
+                            sha.update(block)
+                        if encryptor is not None:
+                            enc_block = encryptor.update(block)
+                            # A primary slot image keeps its payload in
+                            # clear, the AES-GCM tag is still computed.
+                            if not clear:
+                                block = enc_block
+                        out.write(block)
+                    if encryptor is not None:
+                        enc_block = encryptor.finalize()
+                        if not clear:
+                            out.write(enc_block)
+
+                    sha.update(prot_tlv.get())
+                    digest = sha.digest()
+                    tlv.add(hash_tlv, digest)
+                    self.image_hash = digest
+                    self.add_signature(tlv, key, public_key_format, pub,
+                                       pubbytes, fixed_sig, pub_key, digest)
+                    if enckey is not None:
+                        tlv.add(*enctlv)
+                        if self.encrypt_mode == 'gcm':
+                            tlv.add('ENC_GCM_TAG', encryptor.tag)
+                    out.write(prot_tlv.get())
+                    out.write(tlv.get())
+
+                    size = out.tell()
+                    self.check_trailer(size)
+                    if self.pad:
+                        self.stream_pad_to(out, size, self.slot_size)
+            except BaseException:
+                os.remove(outfile)
+                raise
+
+    def public_key_hash(self, key, pub_key, hash_algorithm):
+        """Return the public key to embed and the hash of it."""
+        pub = None
+        if key is not None:
+            pub = key.get_public_bytes()
+            sha = hash_algorithm()
+            sha.update(pub)
+            pubbytes = sha.digest()
+        elif pub_key is not None:
+            if hasattr(pub_key, 'sign'):
+                print(os.path.basename(__file__) + ": sign the payload")
+            pub = pub_key.get_public_bytes()
+            sha = hash_algorithm()
+            sha.update(pub)
+            pubbytes = sha.digest()
+        else:
+            pubbytes = bytes(hashlib.sha256().digest_size)
+        return pub, pubbytes
+
+    def check_layout(self, enckey, compression_tlvs, body_size):
+        """Check the layout, hash chunk and RAM load options against the
+        payload.
+
+        Returns the RAM load segments, if any.
+        """
+        if self.layout_align is not None and \
+                self.header_size % self.layout_align:
+            raise click.UsageError("The header size must be a multiple of "
+                                   "the layout alignment")
+        if self.hash_chunk_size is not None and enckey is not None:
+            raise click.UsageError("Chunked image hash can not be used "
+                                   "with encrypted images")
+        if self.ram_load_stage is not None:
+            if self.hash_chunk_size is None or self.load_addr == 0:
+                raise click.UsageError("Staged RAM loading requires a chunked "
+                                       "image hash and a load address")
+            if self.ram_load_stage > body_size:
+                raise click.UsageError("RAM load stage is larger than the "
+                                       "image payload")
+        if self.ram_load_segments is not None:
+            return self.segment_table(enckey, compression_tlvs, body_size)
+        return None
+
+    def protected_tlvs(self, hash_algorithm, hash_tlv, pubbytes,
+                       dependencies, sw_type, custom_tlvs, compression_tlvs,
+                       chunk_table, segments, sector_table=None):
+        """Build the protected TLV area, which is hashed with the image."""
+        prot_tlv = TLV(self.endian, TLV_PROT_INFO_MAGIC)
+        e = STRUCT_ENDIAN_DICT[self.endian]
+
+        if self.security_counter is not None:
+            payload = struct.pack(e + 'I', self.security_counter)
+            prot_tlv.add('SEC_CNT', payload)
+
+        if sw_type is not None:
+            if len(sw_type) > MAX_SW_TYPE_LENGTH:
+                msg = "'{}' is too long ({} characters) for sw_type. Its " \
+                      "maximum allowed length is 12 characters.".format(
+                       sw_type, len(sw_type))
+                raise click.UsageError(msg)
+
+            image_version = (str(self.version.major) + '.'
+                             + str(self.version.minor) + '.'
+                             + str(self.version.revision))
+
+            # The image hash is computed over the image header, the image
+            # itself and the protected TLV area. However, the boot record TLV
+            # (which is part of the protected area) should contain this hash
+            # before it is even calculated. For this reason the script fills
+            # this field with zeros and the bootloader will insert the right
+            # value later.
+            digest = bytes(hash_algorithm().digest_size)
+
+            # Create CBOR encoded boot record
+            boot_record = create_sw_component_data(sw_type, image_version,
+                                                   hash_tlv, digest,
+                                                   pubbytes)
+            prot_tlv.add('BOOT_RECORD', boot_record)
+
+        if dependencies is not None:
+            for i in range(len(dependencies[DEP_IMAGES_KEY])):
+                payload = struct.pack(
+                    e + 'B3x' + 'BBHI',
+                    int(dependencies[DEP_IMAGES_KEY][i]),
+                    dependencies[DEP_VERSIONS_KEY][i].major,
+                    dependencies[DEP_VERSIONS_KEY][i].minor,
+                    dependencies[DEP_VERSIONS_KEY][i].revision,
+                    dependencies[DEP_VERSIONS_KEY][i].build
+                )
+                prot_tlv.add('DEPENDENCY', payload)
+
+        if compression_tlvs is not None:
+            for tag, value in compression_tlvs.items():
+                prot_tlv.add(tag, value)
+        if custom_tlvs is not None:
+            for tag, value in custom_tlvs.items():
+                prot_tlv.add(tag, value)
+
+        if chunk_table is not None:
+            prot_tlv.add('HASH_CHUNKS', chunk_table)
+        if sector_table is not None:
+            prot_tlv.add('SECTOR_DIGESTS', sector_table)
+        if self.ram_load_stage is not None:
+            prot_tlv.add('RAM_LOAD_STAGE',
+                         struct.pack(e + 'I', self.ram_load_stage))
+        if segments is not None:
+            prot_tlv.add('RAM_LOAD_SEGMENTS',
+                         b''.join(struct.pack(e + 'II', addr, size)
+                                  for addr, size in segments))
+        return prot_tlv
+
+    def add_signature(self, tlv, key, public_key_format, pub, pubbytes,
+                      fixed_sig, pub_key, digest, hash_region=None):
+        """Add the key and signature TLVs.
+
+        Without hash_region, keys signing the payload sign its digest
+        instead, as when streaming the image.
+        """
+        if key is None and fixed_sig is None:
+            return
+
+        if public_key_format == 'hash':
+            tlv.add('KEYHASH', pubbytes)
+        else:
+            tlv.add('PUBKEY', pub)
+
+        if key is not None and fixed_sig is None:
+            sig = self.cached_signature(key, pub, digest, hash_region)
+            if sig is not None:
+                print(os.path.basename(__file__) +
+                      ": signature found in the signature cache")
+            # `sign` expects the full image payload (hashing done
+            # internally), while `sign_digest` expects only the digest
+            # of the payload
+            elif hasattr(key, 'sign'):
+                print(os.path.basename(__file__) + ": sign the payload")
+                if hash_region is not None:
+                    sig = key.sign(hash_region)
+                else:
+                    sig = key.sign_prehashed(digest)
+                self.cache_signature(key, pub, digest, sig)
+            else:
+                print(os.path.basename(__file__) + ": sign the digest")
+                sig = key.sign_digest(digest)
+                self.cache_signature(key, pub, digest, sig)
+            tlv.add(key.sig_tlv(), sig)
+            self.signature = sig
+        elif fixed_sig is not None and key is None:
+            tlv.add(pub_key.sig_tlv(), fixed_sig['value'])
+            self.signature = fixed_sig['value']
+        else:
+            raise click.UsageError("Can not sign using key and provide fixed-signature at the same time")
+
+    def sig_cache_path(self, key, pub, digest):
+        """Return the signature cache entry of an image digest.
+
+        The image digest covers the header, the payload and the protected
+        TLVs, the entry being also keyed by the public key and the signature
+        format.
+        """
+        sha = hashlib.sha256(b'imgtool-sig-cache-v1')
+        sha.update(digest)
+        sha.update(pub)
+        sha.update(key.sig_tlv().encode())
+        sha.update(bytes([bool(getattr(key, 'pad_sig', False))]))
+        return os.path.join(self.sig_cache, sha.hexdigest() + '.sig')
+
+    def cached_signature(self, key, pub, digest, hash_region):
+        """Return the cached signature of an image, None if there is none.
+
+        Cached signatures are checked with the key before being used, so
+        that a corrupted cache entry is replaced rather than output.
+        """
+        if self.sig_cache is None:
+            return None
+        try:
+            with open(self.sig_cache_path(key, pub, digest), 'rb') as f:
+                sig = f.read()
+        except FileNotFoundError:
+            return None
+        try:
+            if not hasattr(key, 'sign'):
+                key.verify_digest(sig, digest)
+            elif hash_region is not None:
+                key.verify(sig, hash_region)
+            else:
+                key.verify_prehashed(sig, digest)
+        except (InvalidSignature, ValueError, IndexError):
+            return None
+        return sig
+
+    def cache_signature(self, key, pub, digest, sig):
+        if self.sig_cache is None:
+            return
+        os.makedirs(self.sig_cache, exist_ok=True)
+        path = self.sig_cache_path(key, pub, digest)
+        # Concurrent builds may store the same entry, write it atomically.
+        tmp = '{}.{}.tmp'.format(path, os.getpid())
+        with open(tmp, 'wb') as f:
+            f.write(sig)
+        os.replace(tmp, path)
+
+    def wrap_key(self, enckey, plainkey):
+        """Return the TLV kind and payload of the encrypted image key."""
+        if isinstance(enckey, rsa.RSAPublic):
+            cipherkey = enckey._get_public().encrypt(
+                plainkey, padding.OAEP(
+                    mgf=padding.MGF1(algorithm=hashes.SHA256()),
+                    algorithm=hashes.SHA256(),
+                    label=None))
+            self.enctlv_len = len(cipherkey)
+            return 'ENCRSA2048', cipherkey
+        elif isinstance(enckey, (ecdsa.ECDSA256P1Public,
+                                 x25519.X25519Public)):
+            cipherkey, mac, pubk = self.ecies_hkdf(enckey, plainkey)
+            enctlv = pubk + mac + cipherkey
+            self.enctlv_len = len(enctlv)
+            if isinstance(enckey, ecdsa.ECDSA256P1Public):
+                return 'ENCEC256', enctlv
+            else:
+                return 'ENCX25519', enctlv
+        raise click.UsageError("Unsupported encryption key type")
+
+    def segment_table(self, enckey, compression_tlvs, body_size):
+        """Return the load address and size of each RAM load segment.
+
+        The segments follow each other in the payload; the size of the last
+        one may be left out, it then gets the rest of the payload.
+        """
+        if self.load_addr or self.rom_fixed:
+            raise click.UsageError("RAM load segments can not be used with "
+                                   "a load address or a fixed ROM address")
+        if (self.hash_chunk_size is not None or enckey is not None or
+                compression_tlvs):
+            raise click.UsageError("RAM load segments can not be used with "
+                                   "chunked hashes, encryption, compression "
+                                   "or delta images")
+        remaining = body_size
+        segments = []
+        for i, (addr, size) in enumerate(self.ram_load_segments):
+            if size is None:
+                if i != len(self.ram_load_segments) - 1:
+                    raise click.UsageError("Only the last RAM load segment "
+                                           "may be given without a size")
+                size = remaining
+            if size <= 0 or size > remaining:
+                raise click.UsageError("RAM load segments do not match the "
+                                       "image payload")
+            segments.append((addr, size))
+            remaining -= size
+        if remaining != 0:
+            raise click.UsageError("RAM load segments do not cover the image "
+                                   "payload")
+        return segments
+
+    def hash_chunks(self, hash_algorithm, body):
+        """Build the HASH_CHUNKS TLV payload for the given image body."""
+        e = STRUCT_ENDIAN_DICT[self.endian]
+        table = struct.pack(e + 'I', self.hash_chunk_size)
+        for off in range(0, len(body), self.hash_chunk_size):
+            sha = hash_algorithm()
+            sha.update(body[off:off + self.hash_chunk_size])
+            table += sha.digest()
+        return table
+
+    def layout_pad(self, size):
+        """Return the padding which aligns an image of size bytes, header
+        included, to the layout boundary."""
+        if self.layout_align is None:
+            return 0
+        return -size % self.layout_align
+
+    def padded_size(self, enckey, body_size):
+        """Return the payload size once padded to the AES block size."""
+        if enckey is None:
+            return body_size
+        return body_size + (-(self.header_size + body_size)) % 16
+
+    def sector_digests(self, hash_algorithm, read, body_size):
+        """Build the SECTOR_DIGESTS TLV payload.
+
+        The slot is split in sectors of sector_digest_size bytes, starting
+        at the image header, and the table holds the digest of the payload
+        bytes of each sector, from the one holding the first payload byte
+        to the one holding the last. read(n) returns the next n bytes of
+        the plain payload, the AES padding being read as zeros.
+        """
+        e = STRUCT_ENDIAN_DICT[self.endian]
+        size = self.sector_digest_size
+        table = struct.pack(e + 'I', size)
+        off = self.header_size
+        end = self.header_size + body_size
+        while off < end:
+            nxt = min((off // size + 1) * size, end)
+            block = read(nxt - off)
+            block += bytes(nxt - off - len(block))
+            sha = hash_algorithm()
+            sha.update(block)
+            table += sha.digest()
+            off = nxt
+        return table
+
+    def stream_hash_chunks(self, hash_algorithm, f, body_off, body_size):
+        """Build the HASH_CHUNKS TLV payload from the image body in f."""
+        e = STRUCT_ENDIAN_DICT[self.endian]
+        table = struct.pack(e + 'I', self.hash_chunk_size)
+        f.seek(body_off)
+        for off in range(0, body_size, self.hash_chunk_size):
+            sha = hash_algorithm()
+            remaining = min(self.hash_chunk_size, body_size - off)
+            while remaining > 0:
+                block = f.read(min(STREAM_BLOCK_SIZE, remaining))
+                if not block:
+                    raise click.UsageError("Input file changed while "
+                                           "signing")
+                sha.update(block)
+                remaining -= len(block)
+            table += sha.digest()
+        return table
+
     def get_struct_endian(self):
         return STRUCT_ENDIAN_DICT[self.endian]
 
@@ -685,6 +1137,15 @@ class Image:
 
     def add_header(self, enckey, protected_tlv_size, compression_flags, aes_length=128):
         """Install the image header."""
+        header = self.build_header(enckey, protected_tlv_size,
+                                   compression_flags, aes_length,
+                                   len(self.payload) - self.header_size)
+        self.payload = bytearray(self.payload)
+        self.payload[:len(header)] = header
+
+    def build_header(self, enckey, protected_tlv_size, compression_flags,
+                     aes_length, img_size):
+        """Return the image header for a payload of img_size bytes."""
 
         flags = 0
         if enckey is not None:
@@ -692,6 +1153,8 @@ class Image:
                 flags |= IMAGE_F['ENCRYPTED_AES128']
             else:
                 flags |= IMAGE_F['ENCRYPTED_AES256']
+            if self.encrypt_mode == 'gcm':
+                flags |= IMAGE_F['ENCRYPTED_GCM']
         if self.load_addr != 0:
             # Indicates that this image should be loaded into RAM
             # instead of run directly from flash.
@@ -700,6 +1163,15 @@ class Image:
             flags |= IMAGE_F['ROM_FIXED']
         if self.non_bootable:
             flags |= IMAGE_F['NON_BOOTABLE']
+        if self.hash_chunk_size is not None:
+            flags |= IMAGE_F['HASH_CHUNKED']
+        load_addr = self.rom_fixed or self.load_addr
+        if self.ram_load_segments is not None:
+            # The image is started from its first segment, as if the header
+            # was loaded right before it.
+            flags |= IMAGE_F['RAM_LOAD_SEGMENTS']
+            load_addr = ((self.ram_load_segments[0][0] - self.header_size)
+                         & 0xffffffff)
 
         e = STRUCT_ENDIAN_DICT[self.endian]
         fmt = (e +
@@ -716,19 +1188,18 @@ class Image:
         assert struct.calcsize(fmt) == IMAGE_HEADER_SIZE
         header = struct.pack(fmt,
                              IMAGE_MAGIC,
-                             self.rom_fixed or self.load_addr,
+                             load_addr,
                              self.header_size,
                              protected_tlv_size,  # TLV Info header +
                                                   # Protected TLVs
-                             len(self.payload) - self.header_size,  # ImageSz
+                             img_size,  # ImageSz
                              flags | compression_flags,
                              self.version.major,
                              self.version.minor or 0,
                              self.version.revision or 0,
                              self.version.build or 0,
                              0)  # Pad1
-        self.payload = bytearray(self.payload)
-        self.payload[:len(header)] = header
+        return header
 
     def _trailer_size(self, write_size, max_sectors, overwrite_only, enckey,
                       save_enctlv, enctlv_len):
@@ -747,6 +1218,9 @@ class Image:
                 if save_enctlv:
                     # TLV saved by the bootloader is aligned
                     keylen = align_up(enctlv_len, self.max_align)
+                elif self.wrapped_key_size:
+                    # Wrapped key saved by the bootloader is aligned
+                    keylen = align_up(self.wrapped_key_size, self.max_align)
                 else:
                     keylen = align_up(16, self.max_align)
                 trailer += keylen * 2  # encryption keys
@@ -761,14 +1235,32 @@ class Image:
                                    self.save_enctlv, self.enctlv_len)
         padding = size - (len(self.payload) + tsize)
         pbytes = bytearray([self.erased_val] * padding)
-        pbytes += bytearray([self.erased_val] * (tsize - len(self.boot_magic)))
+        pbytes += self.trailer(tsize)
+        self.payload += pbytes
+
+    def stream_pad_to(self, out, image_size, size):
+        """Write the padding and trailer after an image of image_size bytes
+        to out, up to the given size."""
+        tsize = self._trailer_size(self.align, self.max_sectors,
+                                   self.overwrite_only, self.enckey,
+                                   self.save_enctlv, self.enctlv_len)
+        padding = size - (image_size + tsize)
+        block = bytes([self.erased_val] * min(STREAM_BLOCK_SIZE, padding))
+        while padding > 0:
+            out.write(block[:padding])
+            padding -= len(block)
+        out.write(self.trailer(tsize))
+
+    def trailer(self, tsize):
+        """Return the initial image trailer, of tsize bytes."""
+        pbytes = bytearray([self.erased_val] * (tsize - len(self.boot_magic)))
         pbytes += self.boot_magic
         if self.confirm and not self.overwrite_only:
             magic_size = 16
             magic_align_size = align_up(magic_size, self.max_align)
             image_ok_idx = -(magic_align_size + self.max_align)
             pbytes[image_ok_idx] = 0x01  # image_ok = 0x01
-        self.payload += pbytes
+        return pbytes
 
     @staticmethod
     def verify(imgfile, key):
@@ -782,7 +1274,8 @@ class Image:
         except FileNotFoundError:
             raise click.UsageError(f"Image file {imgfile} not found")
 
-        magic, _, header_size, _, img_size = struct.unpack('IIHHI', b[:16])
+        magic, _, header_size, _, img_size, flags = struct.unpack('IIHHII',
+                                                                  b[:20])
         version = struct.unpack('BBHI', b[20:28])
 
         if magic != IMAGE_MAGIC:
@@ -800,7 +1293,15 @@ class Image:
             return VerifyResult.INVALID_TLV_INFO_MAGIC, None, None
 
         prot_tlv_size = tlv_off
-        hash_region = b[:prot_tlv_size]
+        if flags & IMAGE_F['HASH_CHUNKED']:
+            hash_region = (b[:header_size] +
+                           b[header_size + img_size:prot_tlv_size])
+            if not Image.verify_hash_chunks(b, header_size, img_size):
+                return VerifyResult.INVALID_HASH, None, None
+        else:
+            hash_region = b[:prot_tlv_size]
+        if not Image.verify_sector_digests(b, header_size, img_size):
+            return VerifyResult.INVALID_HASH, None, None
         digest = None
         tlv_end = tlv_off + tlv_tot
         tlv_off += TLV_INFO_SIZE  # skip tlv info
@@ -820,7 +1321,7 @@ class Image:
             elif key is not None and tlv_type == TLV_VALUES[key.sig_tlv()]:
                 off = tlv_off + TLV_SIZE
                 tlv_sig = b[off:off + tlv_len]
-                payload = b[:prot_tlv_size]
+                payload = hash_region
                 try:
                     if hasattr(key, 'verify'):
                         key.verify(tlv_sig, payload)
@@ -832,3 +1333,226 @@ class Image:
                     pass
             tlv_off += TLV_SIZE + tlv_len
         return VerifyResult.INVALID_SIGNATURE, None, None
+
+    @staticmethod
+    def verify_hash_chunks(b, header_size, img_size):
+        """Check the payload against the protected HASH_CHUNKS table."""
+        tlv_off = header_size + img_size
+        magic, tlv_tot = struct.unpack('HH', b[tlv_off:tlv_off + TLV_INFO_SIZE])
+        if magic != TLV_PROT_INFO_MAGIC:
+            return False
+        tlv_end = tlv_off + tlv_tot
+        tlv_off += TLV_INFO_SIZE
+        table = None
+        while tlv_off < tlv_end:
+            tlv_type, _, tlv_len = struct.unpack('BBH',
+                                                 b[tlv_off:tlv_off + TLV_SIZE])
+            off = tlv_off + TLV_SIZE
+            if tlv_type == TLV_VALUES['HASH_CHUNKS']:
+                table = b[off:off + tlv_len]
+            tlv_off = off + tlv_len
+        if table is None or len(table) < 4:
+            return False
+        chunk_size, = struct.unpack('I', table[:4])
+        if img_size == 0:
+            return len(table) == 4
+        chunk_count = -(-img_size // chunk_size) if chunk_size else 0
+        if chunk_count == 0 or (len(table) - 4) % chunk_count:
+            return False
+        sha_len = (len(table) - 4) // chunk_count
+        alg = next((t.alg for t in TLV_SHA_TO_SHA_AND_ALG.values()
+                    if t.alg().digest_size == sha_len), None)
+        if alg is None:
+            return False
+        body = b[header_size:header_size + img_size]
+        for i in range(chunk_count):
+            sha = alg()
+            sha.update(body[i * chunk_size:(i + 1) * chunk_size])
+            if sha.digest() != table[4 + i * sha_len:4 + (i + 1) * sha_len]:
+                return False
+        return True
+
+    @staticmethod
+    def verify_sector_digests(b, header_size, img_size):
+        """Check the payload against the protected SECTOR_DIGESTS table.
+
+        Images without the table are accepted.
+        """
+        tlv_off = header_size + img_size
+        magic, tlv_tot = struct.unpack('HH', b[tlv_off:tlv_off + TLV_INFO_SIZE])
+        if magic != TLV_PROT_INFO_MAGIC:
+            return True
+        tlv_end = tlv_off + tlv_tot
+        tlv_off += TLV_INFO_SIZE
+        table = None
+        while tlv_off < tlv_end:
+            tlv_type, _, tlv_len = struct.unpack('BBH',
+                                                 b[tlv_off:tlv_off + TLV_SIZE])
+            off = tlv_off + TLV_SIZE
+            if tlv_type == TLV_VALUES['SECTOR_DIGESTS']:
+                table = b[off:off + tlv_len]
+            tlv_off = off + tlv_len
+        if table is None:
+            return True
+        if len(table) < 4:
+            return False
+        sectors, alg = Image.sector_layout(table, header_size, img_size)
+        if sectors is None:
+            return False
+        sha_len = alg().digest_size if sectors else 0
+        for i, (start, stop) in enumerate(sectors):
+            sha = alg()
+            sha.update(b[start:stop])
+            if sha.digest() != table[4 + i * sha_len:4 + (i + 1) * sha_len]:
+                return False
+        return True
+
+    @staticmethod
+    def sector_layout(table, header_size, img_size):
+        """Return the image range covered by each digest of a SECTOR_DIGESTS
+        table, and the hash algorithm of the digests.
+
+        Returns None if the table does not match the image.
+        """
+        if len(table) < 4:
+            return None, None
+        sector_size, = struct.unpack('I', table[:4])
+        if sector_size == 0:
+            return None, None
+        end = header_size + img_size
+        sectors = []
+        off = header_size
+        while off < end:
+            stop = min((off // sector_size + 1) * sector_size, end)
+            sectors.append((off, stop))
+            off = stop
+        if not sectors:
+            return (sectors, None) if len(table) == 4 else (None, None)
+        if (len(table) - 4) % len(sectors):
+            return None, None
+        sha_len = (len(table) - 4) // len(sectors)
+        alg = next((t.alg for t in TLV_SHA_TO_SHA_AND_ALG.values()
+                    if t.alg().digest_size == sha_len), None)
+        if alg is None:
+            return None, None
+        return sectors, alg
+
+    @staticmethod
+    def verify_stream(imgfile, key):
+        """Verify a binary image like verify(), reading it in blocks.
+
+        Only the header and the TLV area are held in memory, the hashed
+        region being read in blocks of STREAM_BLOCK_SIZE bytes. Intel HEX
+        files and chunk-hashed images are checked by verify().
+        """
+        if os.path.splitext(imgfile)[1][1:].lower() == INTEL_HEX_EXT:
+            return Image.verify(imgfile, key)
+        try:
+            f = open(imgfile, 'rb')
+        except FileNotFoundError:
+            raise click.UsageError(f"Image file {imgfile} not found")
+
+        with f:
+            hdr = f.read(IMAGE_HEADER_SIZE)
+            if len(hdr) < IMAGE_HEADER_SIZE:
+                return VerifyResult.INVALID_MAGIC, None, None
+            magic, _, header_size, _, img_size, flags = struct.unpack(
+                'IIHHII', hdr[:20])
+            version = struct.unpack('BBHI', hdr[20:28])
+            if magic != IMAGE_MAGIC:
+                return VerifyResult.INVALID_MAGIC, None, None
+            if flags & IMAGE_F['HASH_CHUNKED']:
+                return Image.verify(imgfile, key)
+
+            tlv_off = header_size + img_size
+            f.seek(tlv_off)
+            prot = bytes()
+            tlv_info = f.read(TLV_INFO_SIZE)
+            if len(tlv_info) < TLV_INFO_SIZE:
+                return VerifyResult.INVALID_TLV_INFO_MAGIC, None, None
+            magic, tlv_tot = struct.unpack('HH', tlv_info)
+            if magic == TLV_PROT_INFO_MAGIC:
+                prot = tlv_info + f.read(tlv_tot - TLV_INFO_SIZE)
+                tlv_info = f.read(TLV_INFO_SIZE)
+                if len(tlv_info) < TLV_INFO_SIZE:
+                    return VerifyResult.INVALID_TLV_INFO_MAGIC, None, None
+                magic, tlv_tot = struct.unpack('HH', tlv_info)
+            if magic != TLV_INFO_MAGIC:
+                return VerifyResult.INVALID_TLV_INFO_MAGIC, None, None
+            tlvs = tlv_info + f.read(tlv_tot - TLV_INFO_SIZE)
+            prot_tlv_size = tlv_off + len(prot)
+
+            # The sector digests are checked in the same pass as the hash.
+            sectors = []
+            sector_alg = None
+            table = Image.find_tlv(prot, 'SECTOR_DIGESTS')
+            if table is not None:
+                sectors, sector_alg = Image.sector_layout(table, header_size,
+                                                          img_size)
+                if sectors is None:
+                    return VerifyResult.INVALID_HASH, None, None
+
+            digest = None
+            off = TLV_INFO_SIZE
+            while off < len(tlvs):
+                tlv_type, _, tlv_len = struct.unpack('BBH',
+                                                     tlvs[off:off + TLV_SIZE])
+                value = tlvs[off + TLV_SIZE:off + TLV_SIZE + tlv_len]
+                if is_sha_tlv(tlv_type):
+                    if not tlv_matches_key_type(tlv_type, key):
+                        return VerifyResult.KEY_MISMATCH, None, None
+                    sha = TLV_SHA_TO_SHA_AND_ALG[tlv_type].alg()
+                    digests = []
+                    sector_sha = None
+                    f.seek(0)
+                    pos = 0
+                    while pos < prot_tlv_size:
+                        block = f.read(min(STREAM_BLOCK_SIZE,
+                                           prot_tlv_size - pos))
+                        if not block:
+                            return VerifyResult.INVALID_HASH, None, None
+                        sha.update(block)
+                        view = memoryview(block)
+                        for start, stop in sectors[len(digests):]:
+                            if start >= pos + len(block):
+                                break
+                            lo = max(start, pos)
+                            hi = min(stop, pos + len(block))
+                            if lo == start:
+                                sector_sha = sector_alg()
+                            sector_sha.update(view[lo - pos:hi - pos])
+                            if hi < stop:
+                                break
+                            digests.append(sector_sha.digest())
+                        pos += len(block)
+                    if table is not None and table[4:] != b''.join(digests):
+                        return VerifyResult.INVALID_HASH, None, None
+                    digest = sha.digest()
+                    if digest != value:
+                        return VerifyResult.INVALID_HASH, None, None
+                    if key is None:
+                        return VerifyResult.OK, version, digest
+                elif key is not None and tlv_type == TLV_VALUES[key.sig_tlv()]:
+                    try:
+                        if hasattr(key, 'verify'):
+                            key.verify_prehashed(value, digest)
+                        else:
+                            key.verify_digest(value, digest)
+                        return VerifyResult.OK, version, digest
+                    except InvalidSignature:
+                        # continue to next TLV
+                        pass
+                off += TLV_SIZE + tlv_len
+        return VerifyResult.INVALID_SIGNATURE, None, None
+
+    @staticmethod
+    def find_tlv(area, name):
+        """Return the value of the first TLV of a TLV area, None if absent."""
+        off = TLV_INFO_SIZE
+        while off + TLV_SIZE <= len(area):
+            tlv_type, _, tlv_len = struct.unpack('BBH',
+                                                 area[off:off + TLV_SIZE])
+            if tlv_type == TLV_VALUES[name]:
+                return area[off + TLV_SIZE:off + TLV_SIZE + tlv_len]
+            off += TLV_SIZE + tlv_len
+        return None
@@ -5,13 +5,15 @@ ECDSA key management
 # SPDX-License-Identifier: Apache-2.0
 import os.path
 import hashlib
+import sys
 
 from cryptography.hazmat.backends import default_backend
 from cryptography.hazmat.primitives import serialization
-from cryptography.hazmat.primitives.asymmetric import ec
+from cryptography.hazmat.primitives.asymmetric import ec, utils
 from cryptography.hazmat.primitives.hashes import SHA256, SHA384
 
-from .general import KeyClass
+from .general import KeyClass, FileHandler
+from .. import ecdsa_comb
 from .privatebytes import PrivateBytesMixin
 
 
@@ -152,6 +154,17 @@ class ECDSA256P1Public(ECDSAPublicKey):
     def shortname(self):
         return "ecdsa"
 
+    def emit_c_public_comb(self, file=sys.stdout):
+        """Emit the public key followed by its precomputed comb table."""
+        numbers = self._get_public().public_numbers()
+        with FileHandler(file, 'w') as file:
+            self.emit_c_public(file=file)
+            print("", file=file)
+            print("#include <bootutil/ecdsa_comb.h>", file=file)
+            print("", file=file)
+            ecdsa_comb.emit_c_comb("{}_pub_key_comb".format(self.shortname()),
+                                   (numbers.x, numbers.y), file)
+
     def sig_type(self):
         return "ECDSA256_SHA256"
 
@@ -181,6 +194,17 @@ class ECDSA256P1Public(ECDSAPublicKey):
         return k.verify(signature=signature, data=payload,
                         signature_algorithm=ec.ECDSA(SHA256()))
 
+    def verify_prehashed(self, signature, digest):
+        """Verify the signature of a payload from its SHA-256 digest, like
+        verify() does from the payload itself."""
+        signature = signature[:signature[1] + 2]
+        k = self.key
+        if isinstance(self.key, ec.EllipticCurvePrivateKey):
+            k = self.key.public_key()
+        return k.verify(signature=signature, data=digest,
+                        signature_algorithm=ec.ECDSA(
+                            utils.Prehashed(SHA256())))
+
 
 class ECDSA256P1(ECDSAPrivateKey, ECDSA256P1Public):
     """
@@ -213,6 +237,16 @@ class ECDSA256P1(ECDSAPrivateKey, ECDSA256P1Public):
         else:
             return sig
 
+    def sign_prehashed(self, digest):
+        """Sign the SHA-256 digest of a payload, like sign() does for the
+        payload itself."""
+        sig = self.key.sign(
+                data=digest,
+                signature_algorithm=ec.ECDSA(utils.Prehashed(SHA256())))
+        if self.pad_sig:
+            sig += b'\000' * (self.sig_len() - len(sig))
+        return sig
+
 
 class ECDSA384P1Public(ECDSAPublicKey):
     """
@@ -254,6 +288,17 @@ class ECDSA384P1Public(ECDSAPublicKey):
         return k.verify(signature=signature, data=payload,
                         signature_algorithm=ec.ECDSA(SHA384()))
 
+    def verify_prehashed(self, signature, digest):
+        """Verify the signature of a payload from its SHA-384 digest, like
+        verify() does from the payload itself."""
+        signature = signature[:signature[1] + 2]
+        k = self.key
+        if isinstance(self.key, ec.EllipticCurvePrivateKey):
+            k = self.key.public_key()
+        return k.verify(signature=signature, data=digest,
+                        signature_algorithm=ec.ECDSA(
+                            utils.Prehashed(SHA384())))
+
 
 class ECDSA384P1(ECDSAPrivateKey, ECDSA384P1Public):
     """
@@ -287,3 +332,13 @@ class ECDSA384P1(ECDSAPrivateKey, ECDSA384P1Public):
             return sig
         else:
             return sig
+
+    def sign_prehashed(self, digest):
+        """Sign the SHA-384 digest of a payload, like sign() does for the
+        payload itself."""
+        sig = self.key.sign(
+                data=digest,
+                signature_algorithm=ec.ECDSA(utils.Prehashed(SHA384())))
+        if self.pad_sig:
+            sig += b'\000' * (self.sig_len() - len(sig))
+        return sig
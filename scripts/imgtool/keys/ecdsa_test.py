@@ -67,6 +67,11 @@ class EcKeyGeneration(unittest.TestCase):
         self.assertIn("ecdsa_pub_key_hash", hashccode.getvalue())
         self.assertIn("ecdsa_pub_key_hash_len", hashccode.getvalue())
 
+        combccode = io.StringIO()
+        k.emit_c_public_comb(combccode)
+        self.assertIn("ecdsa_pub_key_len", combccode.getvalue())
+        self.assertIn("ecdsa_pub_key_comb", combccode.getvalue())
+
         rustcode = io.StringIO()
         k.emit_rust_public(rustcode)
         self.assertIn("ECDSA_PUB_KEY", rustcode.getvalue())
@@ -3,14 +3,16 @@ RSA Key management
 """
 
 # SPDX-License-Identifier: Apache-2.0
+import sys
 
 from cryptography.hazmat.backends import default_backend
 from cryptography.hazmat.primitives import serialization
-from cryptography.hazmat.primitives.asymmetric import rsa
+from cryptography.hazmat.primitives.asymmetric import rsa, utils
 from cryptography.hazmat.primitives.asymmetric.padding import PSS, MGF1
 from cryptography.hazmat.primitives.hashes import SHA256
 
-from .general import KeyClass
+from .general import KeyClass, FileHandler
+from .. import rsa_mont
 from .privatebytes import PrivateBytesMixin
 
 
@@ -64,6 +66,19 @@ class RSAPublic(KeyClass):
         with open(path, 'wb') as f:
             f.write(pem)
 
+    def emit_c_public_mont(self, file=sys.stdout):
+        """Emit the public key followed by its Montgomery constants."""
+        numbers = self._get_public().public_numbers()
+        if numbers.e != 65537:
+            raise RSAUsageError("Montgomery constants require e = 65537")
+        with FileHandler(file, 'w') as file:
+            self.emit_c_public(file=file)
+            print("", file=file)
+            print("#include <bootutil/rsa_mont.h>", file=file)
+            print("", file=file)
+            rsa_mont.emit_c_mont("{}_pub_key_mont".format(self.shortname()),
+                                 numbers.n, self.key_size(), file)
+
     def sig_type(self):
         return "PKCS1_PSS_RSA{}_SHA256".format(self.key_size())
 
@@ -81,6 +96,16 @@ class RSAPublic(KeyClass):
                         padding=PSS(mgf=MGF1(SHA256()), salt_length=32),
                         algorithm=SHA256())
 
+    def verify_prehashed(self, signature, digest):
+        """Verify the signature of a payload from its SHA-256 digest, like
+        verify() does from the payload itself."""
+        k = self.key
+        if isinstance(self.key, rsa.RSAPrivateKey):
+            k = self.key.public_key()
+        return k.verify(signature=signature, data=digest,
+                        padding=PSS(mgf=MGF1(SHA256()), salt_length=32),
+                        algorithm=utils.Prehashed(SHA256()))
+
 
 class RSA(RSAPublic, PrivateBytesMixin):
     """
@@ -171,3 +196,11 @@ class RSA(RSAPublic, PrivateBytesMixin):
                 data=payload,
                 padding=PSS(mgf=MGF1(SHA256()), salt_length=32),
                 algorithm=SHA256())
+
+    def sign_prehashed(self, digest):
+        """Sign the SHA-256 digest of a payload, like sign() does for the
+        payload itself."""
+        return self.key.sign(
+                data=digest,
+                padding=PSS(mgf=MGF1(SHA256()), salt_length=32),
+                algorithm=utils.Prehashed(SHA256()))
@@ -0,0 +1,161 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+LZ4 compression of image payloads.
+
+The payload of an LZ4 compressed image is a single LZ4 block, without frame
+header, size or checksum, see:
+
+    https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+
+Each sequence is a token holding the literal and match length nibbles, the
+rest of the literal length, the literals, a 16-bit little endian match
+offset and the rest of the match length; the last sequence only has
+literals. The bootloader decodes it into the primary slot, which serves as
+the 64 KiB window, see boot/bootutil/src/decompress.c.
+"""
+
+import struct
+
+MIN_MATCH = 4
+MAX_OFFSET = 0xffff
+
+# The last match starts at least MF_LIMIT bytes before the end of the block
+# and the last LAST_LITERALS bytes are literals.
+MF_LIMIT = 12
+LAST_LITERALS = 5
+
+
+def _put_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def _put_sequence(out, literals, offset=0, length=0):
+    lit_len = len(literals)
+    match_len = length - MIN_MATCH if offset else 0
+    out.append((min(lit_len, 15) << 4) | min(match_len, 15))
+    if lit_len >= 15:
+        _put_length(out, lit_len - 15)
+    out += literals
+    if offset:
+        out += struct.pack('<H', offset)
+        if match_len >= 15:
+            _put_length(out, match_len - 15)
+
+
+def compress(data):
+    """Compress data into a single LZ4 block."""
+    data = bytes(data)
+    size = len(data)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    pos = 0
+    match_limit = size - MF_LIMIT
+    end = size - LAST_LITERALS
+
+    while pos < match_limit:
+        key = data[pos:pos + MIN_MATCH]
+        ref = table.get(key)
+        table[key] = pos
+        if ref is None or pos - ref > MAX_OFFSET:
+            pos += 1
+            continue
+
+        length = MIN_MATCH
+        while (pos + length + 8 <= end and
+               data[ref + length:ref + length + 8] ==
+               data[pos + length:pos + length + 8]):
+            length += 8
+        while pos + length < end and data[ref + length] == data[pos + length]:
+            length += 1
+        while pos > anchor and ref > 0 and data[pos - 1] == data[ref - 1]:
+            pos -= 1
+            ref -= 1
+            length += 1
+
+        _put_sequence(out, data[anchor:pos], pos - ref, length)
+        for i in range(pos + 1, min(pos + length, match_limit)):
+            table[data[i:i + MIN_MATCH]] = i
+        pos += length
+        anchor = pos
+
+    _put_sequence(out, data[anchor:])
+    return bytes(out)
+
+
+def _get_length(data, pos):
+    length = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        length += b
+        if b != 255:
+            return length, pos
+
+
+def decompress(data):
+    """Decompress a single LZ4 block."""
+    out = bytearray()
+    pos = 0
+    while True:
+        token = data[pos]
+        pos += 1
+        lit_len = token >> 4
+        if lit_len == 15:
+            length, pos = _get_length(data, pos)
+            lit_len += length
+        out += data[pos:pos + lit_len]
+        pos += lit_len
+        if pos >= len(data):
+            return bytes(out)
+
+        offset, = struct.unpack_from('<H', data, pos)
+        pos += 2
+        if offset == 0 or offset > len(out):
+            raise ValueError("Invalid LZ4 match offset")
+        length = (token & 15) + MIN_MATCH
+        if token & 15 == 15:
+            extra, pos = _get_length(data, pos)
+            length += extra
+        for _ in range(length):
+            out.append(out[-offset])
+
+
+def armthumb_filter(data):
+    """Apply the ARM Thumb BCJ filter of xz to data.
+
+    The filter converts the branch offsets of BL instructions to absolute
+    targets, which makes repeated calls to a function compress better. It
+    gives the same result as the lzma.FILTER_ARMTHUMB filter.
+    """
+    out = bytearray(data)
+    i = 0
+    while i + 4 <= len(out):
+        if (out[i + 1] & 0xf8) == 0xf0 and (out[i + 3] & 0xf8) == 0xf8:
+            src = (((out[i + 1] & 7) << 19) | (out[i] << 11) |
+                   ((out[i + 3] & 7) << 8) | out[i + 2])
+            dest = ((src << 1) + i + 4) >> 1
+            out[i + 1] = 0xf0 | ((dest >> 19) & 7)
+            out[i] = (dest >> 11) & 0xff
+            out[i + 3] = 0xf8 | ((dest >> 8) & 7)
+            out[i + 2] = dest & 0xff
+            i += 4
+        else:
+            i += 2
+    return bytes(out)
@@ -27,9 +27,13 @@ import os
 import lzma
 import hashlib
 import base64
-from imgtool import image, imgtool_version
-from imgtool.version import decode_version
-from imgtool.dumpinfo import dump_imginfo
+import json
+import multiprocessing
+import time
+from concurrent.futures import ThreadPoolExecutor
+from imgtool import delta, hexfile, image, imgtool_version, lz4
+from imgtool.version import decode_version, SemiSemVersion
+from imgtool.dumpinfo import dump_imginfo, dump_imginfo_bulk
 from .keys import (
     RSAUsageError, ECDSAUsageError, Ed25519UsageError, X25519UsageError)
 
@@ -73,7 +77,8 @@ def gen_x25519(keyfile, passwd):
 
 valid_langs = ['c', 'rust']
 valid_hash_encodings = ['lang-c', 'raw']
-valid_encodings = ['lang-c', 'lang-rust', 'pem', 'raw']
+valid_encodings = ['lang-c', 'lang-c-comb', 'lang-c-mont', 'lang-rust', 'pem',
+                   'raw']
 keygens = {
     'rsa-2048':   gen_rsa2048,
     'rsa-3072':   gen_rsa3072,
@@ -98,13 +103,24 @@ def save_signature(sigfile, sig):
         f.write(signature)
 
 
+# Keys, and the passphrases of the encrypted ones, already loaded by this
+# process; sign-batch signs many images with the same few keys.
+loaded_keys = {}
+key_passwords = {}
+
+
 def load_key(keyfile):
     # TODO: better handling of invalid pass-phrase
-    key = keys.load(keyfile)
+    key = loaded_keys.get(keyfile)
     if key is not None:
         return key
-    passwd = getpass.getpass("Enter key passphrase: ").encode('utf-8')
-    return keys.load(keyfile, passwd)
+    key = keys.load(keyfile, key_passwords.get(keyfile))
+    if key is None:
+        passwd = getpass.getpass("Enter key passphrase: ").encode('utf-8')
+        key = keys.load(keyfile, passwd)
+        key_passwords[keyfile] = passwd
+    loaded_keys[keyfile] = key
+    return key
 
 
 def get_password():
@@ -161,6 +177,16 @@ def getpub(key, encoding, lang, output):
         print("Invalid passphrase")
     elif lang == 'c' or encoding == 'lang-c':
         key.emit_c_public(file=output)
+    elif encoding == 'lang-c-comb':
+        if not hasattr(key, 'emit_c_public_comb'):
+            raise click.UsageError('Encoding lang-c-comb is only supported '
+                                   'for ECDSA P-256 keys')
+        key.emit_c_public_comb(file=output)
+    elif encoding == 'lang-c-mont':
+        if not hasattr(key, 'emit_c_public_mont'):
+            raise click.UsageError('Encoding lang-c-mont is only supported '
+                                   'for RSA keys')
+        key.emit_c_public_mont(file=output)
     elif lang == 'rust' or encoding == 'lang-rust':
         key.emit_rust_public(file=output)
     elif encoding == 'pem':
@@ -221,41 +247,94 @@ def getpriv(key, minimal, format):
         raise click.UsageError(e)
 
 
-@click.argument('imgfile')
-@click.option('-k', '--key', metavar='filename')
-@click.command(help="Check that signed image can be verified by given key")
-def verify(key, imgfile):
-    key = load_key(key) if key else None
-    ret, version, digest = image.Image.verify(imgfile, key)
+def verify_image(imgfile, key):
+    """Verify an image, returning the lines to print and the time taken."""
+    start = time.perf_counter()
+    try:
+        ret, version, digest = image.Image.verify_stream(imgfile, key)
+    except click.UsageError as e:
+        return False, [e.format_message()], time.perf_counter() - start
+    elapsed = time.perf_counter() - start
     if ret == image.VerifyResult.OK:
-        print("Image was correctly validated")
-        print("Image version: {}.{}.{}+{}".format(*version))
-        print("Image digest: {}".format(digest.hex()))
-        return
+        return True, ["Image was correctly validated",
+                      "Image version: {}.{}.{}+{}".format(*version),
+                      "Image digest: {}".format(digest.hex())], elapsed
     elif ret == image.VerifyResult.INVALID_MAGIC:
-        print("Invalid image magic; is this an MCUboot image?")
+        msg = "Invalid image magic; is this an MCUboot image?"
     elif ret == image.VerifyResult.INVALID_TLV_INFO_MAGIC:
-        print("Invalid TLV info magic; is this an MCUboot image?")
+        msg = "Invalid TLV info magic; is this an MCUboot image?"
     elif ret == image.VerifyResult.INVALID_HASH:
-        print("Image has an invalid hash")
+        msg = "Image has an invalid hash"
     elif ret == image.VerifyResult.INVALID_SIGNATURE:
-        print("No signature found for the given key")
+        msg = "No signature found for the given key"
     elif ret == image.VerifyResult.KEY_MISMATCH:
-        print("Key type does not match TLV record")
+        msg = "Key type does not match TLV record"
     else:
-        print("Unknown return code: {}".format(ret))
-    sys.exit(1)
+        msg = "Unknown return code: {}".format(ret)
+    return False, [msg], elapsed
 
 
-@click.argument('imgfile')
+@click.argument('imgfile', nargs=-1, required=True)
+@click.option('-k', '--key', metavar='filename')
+@click.option('-j', '--jobs', type=click.IntRange(min=1),
+              help='Number of images verified in parallel; defaults to the '
+              'number of CPUs')
+@click.option('--timing', default=False, is_flag=True,
+              help='Print the time taken to verify each image')
+@click.command(help="Check that signed images can be verified by given key")
+def verify(key, imgfile, jobs, timing):
+    key = load_key(key) if key else None
+    # The images are read and hashed in blocks, which releases the GIL, and
+    # share the loaded key.
+    with ThreadPoolExecutor(jobs or os.cpu_count() or 1) as pool:
+        results = list(pool.map(lambda path: verify_image(path, key),
+                                imgfile))
+
+    failed = 0
+    for path, (ok, lines, elapsed) in zip(imgfile, results):
+        if timing:
+            lines.append("Verification time: {:.3f} s".format(elapsed))
+        prefix = path + ": " if len(imgfile) > 1 else ""
+        for line in lines:
+            print(prefix + line)
+        failed += not ok
+    if failed:
+        sys.exit(1)
+
+
+@click.argument('imgfile', nargs=-1, required=True)
 @click.option('-o', '--outfile', metavar='filename', required=False,
-              help='Save image information to outfile in YAML format')
+              help='Save image information to outfile in YAML format, or '
+              'in JSON format with --json')
 @click.option('-s', '--silent', default=False, is_flag=True,
               help='Do not print image information to output')
+@click.option('--json', 'json_out', default=False, is_flag=True,
+              help='Inspect every given image, walking directories, and '
+              'output the header, TLVs, hash and signature status of each '
+              'of them as a JSON list. Exits with an error if any image is '
+              'invalid.')
+@click.option('-k', '--key', metavar='filename',
+              help='With --json, also check the image signatures with this '
+              'key')
+@click.option('--pattern', default='*.bin', show_default=True,
+              help='With --json, name pattern of the files inspected in '
+              'directories')
+@click.option('-j', '--jobs', type=click.IntRange(min=1),
+              help='With --json, number of images inspected in parallel; '
+              'defaults to the number of CPUs')
 @click.command(help='Print header, TLV area and trailer information '
                     'of a signed image')
-def dumpinfo(imgfile, outfile, silent):
-    dump_imginfo(imgfile, outfile, silent)
+def dumpinfo(imgfile, outfile, silent, json_out, key, pattern, jobs):
+    if json_out:
+        key = load_key(key) if key else None
+        failed = dump_imginfo_bulk(imgfile, outfile, key, pattern, jobs)
+        if failed:
+            raise click.ClickException("{} invalid image(s)".format(failed))
+        return
+    if len(imgfile) != 1 or os.path.isdir(imgfile[0]):
+        raise click.UsageError("Only one image file can be given without "
+                               "--json")
+    dump_imginfo(imgfile[0], outfile, silent)
     print("dumpinfo has run successfully")
 
 
@@ -311,6 +390,25 @@ def get_dependencies(ctx, param, value):
         dependencies[image.DEP_VERSIONS_KEY] = versions
         return dependencies
 
+def get_ram_load_segments(ctx, param, value):
+    segments = []
+    for segment in value:
+        fields = segment.split(':')
+        try:
+            if len(fields) > 2:
+                raise ValueError
+            addr = int(fields[0], 0)
+            size = int(fields[1], 0) if len(fields) == 2 else None
+        except ValueError:
+            raise click.BadParameter(
+                "RAM load segment format is invalid: {}".format(segment))
+        if not 0 <= addr <= 0xffffffff or (size is not None and
+                                          not 0 < size <= 0xffffffff):
+            raise click.BadParameter(
+                "RAM load segment is out of range: {}".format(segment))
+        segments.append((addr, size))
+    return segments or None
+
 def create_lzma2_header(dictsize, pb, lc, lp):
     header = bytearray()
     for i in range(0, 40):
@@ -320,6 +418,36 @@ def create_lzma2_header(dictsize, pb, lc, lp):
     header.append( ( pb * 5 + lp) * 9 + lc)
     return header
 
+def compress_lzma2(data, preset, dict_size, armthumb, threads):
+    """Return the raw LZMA2 stream of data.
+
+    With several threads, data is split in as many blocks which are
+    compressed in parallel, each of them starting with a dictionary reset.
+    The ARM thumb BCJ filter then has to be applied to the whole payload
+    first, since it depends on the position in the payload.
+    """
+    lzma2 = {"id": lzma.FILTER_LZMA2, "preset": preset,
+             "dict_size": dict_size, "lp": comp_default_lp,
+             "lc": comp_default_lc}
+    if threads <= 1 or len(data) < threads:
+        filters = [lzma2]
+        if armthumb:
+            filters.insert(0, {"id": lzma.FILTER_ARMTHUMB})
+        return lzma.compress(data, filters=filters, format=lzma.FORMAT_RAW)
+
+    if armthumb:
+        data = lz4.armthumb_filter(data)
+    block = -(-len(data) // threads)
+    blocks = [data[i:i + block] for i in range(0, len(data), block)]
+    # The lzma module releases the GIL while compressing.
+    with ThreadPoolExecutor(threads) as pool:
+        streams = pool.map(lambda b: lzma.compress(b, filters=[lzma2],
+                                                   format=lzma.FORMAT_RAW),
+                           blocks)
+        # Drop the end marker of all streams but the last.
+        return b''.join(s[:-1] for s in streams) + b'\x00'
+
+
 class BasedIntParamType(click.ParamType):
     name = 'integer'
 
@@ -355,6 +483,11 @@ class BasedIntParamType(click.ParamType):
               help='When upgrading, save encrypted key TLVs instead of plain '
                    'keys. Enable when BOOT_SWAP_SAVE_ENCTLV config option '
                    'was set.')
+@click.option('--wrapped-key-size', type=int, required=False,
+              help='When upgrading, the bootloader saves keys wrapped to this '
+                   'size instead of plain keys. Set to '
+                   'BOOT_SWAP_WRAPPED_ENCKEY_SIZE when the '
+                   'BOOT_SWAP_SAVE_WRAPPED_ENCKEY config option was set.')
 @click.option('-E', '--encrypt', metavar='filename',
               help='Encrypt image using the provided public key. '
                    '(Not supported in direct-xip or ram-load mode.)')
@@ -362,11 +495,42 @@ class BasedIntParamType(click.ParamType):
               type=click.Choice(['128', '256']),
               help='When encrypting the image using AES, select a 128 bit or '
                    '256 bit key len.')
+@click.option('--encrypt-mode', default='ctr',
+              type=click.Choice(['ctr', 'gcm']),
+              help='When encrypting the image, use AES-CTR or AES-GCM, whose '
+                   'tag is checked by the bootloader when decrypting. Use gcm '
+                   'when the MCUBOOT_ENC_GCM config option was set.')
 @click.option('--compression', default='disabled',
-              type=click.Choice(['disabled', 'lzma2', 'lzma2armthumb']),
+              type=click.Choice(['disabled', 'lzma2', 'lzma2armthumb', 'lz4',
+                                 'lz4armthumb']),
               help='Enable image compression using specified type. '
                    'Will fall back without image compression automatically '
                    'if the compression increases the image size.')
+@click.option('--compression-preset', type=click.IntRange(0, 9),
+              default=comp_default_preset,
+              help='LZMA2 preset, lower ones compress faster and worse.')
+@click.option('--compression-extreme', default=False, is_flag=True,
+              help='Use the extreme variant of the LZMA2 preset, slower to '
+                   'compress for a slightly better ratio.')
+@click.option('--compression-dict-size', type=BasedIntParamType(),
+              default=comp_default_dictsize,
+              help='LZMA2 dictionary size. The bootloader reads the '
+                   'dictionary back from the primary slot, so any size up '
+                   'to the image size can be used without more RAM.')
+@click.option('--compression-threads', type=int, default=1,
+              help='Compress LZMA2 images in this many blocks in parallel. '
+                   'The image then compresses slightly worse, and depends on '
+                   'the number of threads.')
+@click.option('--delta-base', metavar='filename',
+              help='Output a delta image, which the bootloader applies to '
+                   'this signed image in the primary slot. Will fall back to '
+                   'a full image if the delta image is not smaller. Requires '
+                   'MCUBOOT_DELTA_IMAGES support in the bootloader.')
+@click.option('--delta-arm-thumb', default=False, is_flag=True,
+              help='Let the copies of the delta image adjust the Thumb BL '
+                   'instructions they move, for smaller patches of Thumb '
+                   'code. Requires MCUBOOT_DELTA_ARM_THUMB support in the '
+                   'bootloader.')
 @click.option('-c', '--clear', required=False, is_flag=True, default=False,
               help='Output a non-encrypted image with encryption capabilities,'
                    'so it can be installed in the primary slot, and encrypted '
@@ -429,6 +593,53 @@ class BasedIntParamType(click.ParamType):
 @click.option('--sha', 'user_sha', type=click.Choice(valid_sha), default='auto',
               help='selected sha algorithm to use; defaults to "auto" which is 256 if '
               'no cryptographic signature is used, or default for signature type')
+@click.option('--hash-chunk-size', type=BasedIntParamType(), required=False,
+              help='Cover the payload with a table of per-chunk digests of '
+              'this size, stored in the protected TLVs, instead of a single '
+              'linear image hash. Requires MCUBOOT_HASH_CHUNKS support in the '
+              'bootloader.')
+@click.option('--layout-align', type=BasedIntParamType(), required=False,
+              help='Align the payload and the TLV area to this power of two '
+              'boundary, e.g. the XIP page or cache line size: the header '
+              'size must be a multiple of it, and the payload is padded '
+              'with zeros up to the next boundary.')
+@click.option('--sector-digest-size', type=BasedIntParamType(),
+              required=False,
+              help='Add a protected table of the digests of the payload held '
+              'by each flash sector of this size, counted from the start of '
+              'the slot, for the bootloader to check or compare the image '
+              'one sector at a time. The sector size must divide the slot '
+              'size.')
+@click.option('--ram-load-stage', type=BasedIntParamType(), required=False,
+              help='Size of the start of the payload, e.g. the vector table '
+              'and early boot code, that the bootloader loads to RAM and '
+              'checks before booting the image, the application loading the '
+              'rest. Requires --hash-chunk-size, --load-addr and '
+              'MCUBOOT_RAM_LOAD_STAGED support in the bootloader.')
+@click.option('--ram-load-segment', 'ram_load_segments', multiple=True,
+              callback=get_ram_load_segments, metavar='addr[:size]',
+              help='Load the next SIZE bytes of the payload to RAM address '
+              'ADDR. Can be given several times, the segments following '
+              'each other in the payload; the last one gets the rest of the '
+              'payload if its size is left out. The image is started from '
+              'the first segment. Requires MCUBOOT_RAM_LOAD_SEGMENTS support '
+              'in the bootloader.')
+@click.option('--sig-cache', metavar='directory',
+              help='Take the signature of the image from this directory, '
+              'when the same image was already signed with the same key, '
+              'instead of signing it again; new signatures are stored in '
+              'it. Cached signatures are checked before being used.')
+@click.option('--primary-slot', default=False, is_flag=True,
+              help='Output the image as it is once installed in the primary '
+              'slot, to be programmed there directly: the payload of '
+              'encrypted images is left in clear and the image is padded '
+              'to --slot-size with a confirmed trailer, so that the '
+              'bootloader boots it without an upgrade.')
+@click.option('--stream', default=False, is_flag=True,
+              help='Read, sign and write the image in blocks instead of '
+              'loading it in memory, for images too large for the host. '
+              'Only binary files are supported, and not with --compression, '
+              '--delta-base or --vector-to-sign.')
 @click.option('--vector-to-sign', type=click.Choice(['payload', 'digest']),
               help='send to OUTFILE the payload or payload''s digest instead '
               'of complied image. These data can be used for external image '
@@ -438,26 +649,56 @@ class BasedIntParamType(click.ParamType):
                .hex extension, otherwise binary format is used''')
 def sign(key, public_key_format, align, version, pad_sig, header_size,
          pad_header, slot_size, pad, confirm, max_sectors, overwrite_only,
-         endian, encrypt_keylen, encrypt, compression, infile, outfile,
-         dependencies, load_addr, hex_addr, erased_val, save_enctlv,
-         security_counter, boot_record, custom_tlv, rom_fixed, max_align,
-         clear, fix_sig, fix_sig_pubkey, sig_out, user_sha, vector_to_sign,
-         non_bootable):
-
+         endian, encrypt_keylen, encrypt_mode, encrypt, compression, infile,
+         outfile, dependencies, load_addr, hex_addr, erased_val, save_enctlv,
+         wrapped_key_size, security_counter, boot_record, custom_tlv,
+         rom_fixed, max_align, clear, fix_sig, fix_sig_pubkey, sig_out,
+         user_sha, vector_to_sign, non_bootable, hash_chunk_size,
+         layout_align, sector_digest_size, ram_load_stage, ram_load_segments, delta_base,
+         delta_arm_thumb, sig_cache, primary_slot, stream, compression_preset, compression_extreme,
+         compression_dict_size, compression_threads):
+
+    if primary_slot:
+        if not slot_size:
+            raise click.UsageError("--primary-slot requires --slot-size")
+        if compression != 'disabled' or delta_base is not None:
+            raise click.UsageError("--primary-slot can not be used with "
+                                   "compressed or delta images, sign the "
+                                   "full image instead")
+        # The primary slot holds the plain payload of encrypted images, the
+        # header and TLVs being those of the secondary slot image.
+        clear = True
+        confirm = True
     if confirm:
         # Confirmed but non-padded images don't make much sense, because
         # otherwise there's no trailer area for writing the confirmed status.
         pad = True
+    if save_enctlv and wrapped_key_size:
+        raise click.UsageError("--save-enctlv and --wrapped-key-size are "
+                               "mutually exclusive")
     img = image.Image(version=decode_version(version), header_size=header_size,
                       pad_header=pad_header, pad=pad, confirm=confirm,
                       align=int(align), slot_size=slot_size,
                       max_sectors=max_sectors, overwrite_only=overwrite_only,
                       endian=endian, load_addr=load_addr, rom_fixed=rom_fixed,
                       erased_val=erased_val, save_enctlv=save_enctlv,
+                      wrapped_key_size=wrapped_key_size,
                       security_counter=security_counter, max_align=max_align,
-                      non_bootable=non_bootable)
+                      non_bootable=non_bootable,
+                      hash_chunk_size=hash_chunk_size,
+                      ram_load_stage=ram_load_stage,
+                      ram_load_segments=ram_load_segments,
+                      sector_digest_size=sector_digest_size,
+                      primary_slot=primary_slot,
+                      layout_align=layout_align, sig_cache=sig_cache)
     compression_tlvs = {}
-    img.load(infile)
+    if stream and (compression != 'disabled' or delta_base is not None or
+                   vector_to_sign is not None):
+        raise click.UsageError("--stream can not be used with "
+                               "--compression, --delta-base or "
+                               "--vector-to-sign")
+    if not stream:
+        img.load(infile)
     key = load_key(key) if key else None
     enckey = load_key(encrypt) if encrypt else None
     if enckey and key:
@@ -471,8 +712,48 @@ def sign(key, public_key_format, align, version, pad_sig, header_size,
             raise click.UsageError("Signing and encryption must use the same "
                                    "type of key")
 
-    if pad_sig and hasattr(key, 'pad_sig'):
-        key.pad_sig = True
+    if hash_chunk_size is not None and hash_chunk_size <= 0:
+        raise click.BadParameter("--hash-chunk-size must be positive")
+
+    if layout_align is not None:
+        if layout_align <= 0 or layout_align & (layout_align - 1):
+            raise click.BadParameter("--layout-align must be a power of two")
+        if compression != 'disabled' or delta_base is not None:
+            raise click.UsageError("Compressed and delta images can not use "
+                                   "--layout-align")
+
+    if sector_digest_size is not None:
+        if sector_digest_size <= 0 or sector_digest_size % int(align):
+            raise click.BadParameter("--sector-digest-size must be a "
+                                     "positive multiple of --align")
+        if slot_size and slot_size % sector_digest_size:
+            raise click.BadParameter("--sector-digest-size must divide "
+                                     "--slot-size")
+        if compression != 'disabled' or delta_base is not None:
+            raise click.UsageError("Compressed and delta images can not use "
+                                   "--sector-digest-size")
+
+    if ram_load_stage is not None and ram_load_stage < 0:
+        raise click.BadParameter("--ram-load-stage must not be negative")
+
+    if delta_base is not None and (enckey is not None or
+                                   compression != 'disabled'):
+        raise click.UsageError("Delta images can not be encrypted or "
+                               "compressed")
+
+    if compression != 'disabled' and hash_chunk_size is not None:
+        raise click.UsageError("Compressed images can not use "
+                               "--hash-chunk-size")
+
+    if not 4096 <= compression_dict_size <= 1536 << 20:
+        raise click.BadParameter("--compression-dict-size must be between "
+                                 "4 KiB and 1.5 GiB")
+    if compression_threads < 1:
+        raise click.BadParameter("--compression-threads must be positive")
+
+    if hasattr(key, 'pad_sig'):
+        # Loaded keys are shared by the images of a sign-batch.
+        key.pad_sig = pad_sig
 
     # Get list of custom protected TLVs from the command-line
     custom_tlvs = {}
@@ -509,34 +790,64 @@ def sign(key, public_key_format, align, version, pad_sig, header_size,
             'value': raw_signature
         }
 
+    if stream:
+        img.create_stream(infile, outfile, key, public_key_format, enckey,
+                          dependencies, boot_record, custom_tlvs,
+                          int(encrypt_keylen), clear, baked_signature,
+                          pub_key, user_sha, encrypt_mode=encrypt_mode)
+        if sig_out is not None:
+            save_signature(sig_out, img.get_signature())
+        return
+
     img.create(key, public_key_format, enckey, dependencies, boot_record,
                custom_tlvs, compression_tlvs, None, int(encrypt_keylen), clear,
-               baked_signature, pub_key, vector_to_sign, user_sha)
+               baked_signature, pub_key, vector_to_sign, user_sha,
+               encrypt_mode=encrypt_mode)
 
-    if compression in ["lzma2", "lzma2armthumb"]:
+    if compression != 'disabled':
         compressed_img = image.Image(version=decode_version(version),
-                  header_size=header_size, pad_header=pad_header,
+                  header_size=header_size, pad_header=True,
                   pad=pad, confirm=confirm, align=int(align),
                   slot_size=slot_size, max_sectors=max_sectors,
                   overwrite_only=overwrite_only, endian=endian,
                   load_addr=load_addr, rom_fixed=rom_fixed,
                   erased_val=erased_val, save_enctlv=save_enctlv,
-                  security_counter=security_counter, max_align=max_align)
-        compression_filters = [
-            {"id": lzma.FILTER_LZMA2, "preset": comp_default_preset,
-                "dict_size": comp_default_dictsize, "lp": comp_default_lp,
-                "lc": comp_default_lc}
-        ]
-        if compression == "lzma2armthumb":
-            compression_filters.insert(0, {"id":lzma.FILTER_ARMTHUMB})
-        compressed_data = lzma.compress(img.get_infile_data(),filters=compression_filters,
-            format=lzma.FORMAT_RAW)
-        uncompressed_size = len(img.get_infile_data())
+                  wrapped_key_size=wrapped_key_size,
+                  security_counter=security_counter, max_align=max_align,
+                  non_bootable=non_bootable, sig_cache=sig_cache)
+        # Only the payload is compressed, the bootloader rebuilds the header
+        # and TLVs of the signed image from those of the compressed one.
+        uncompressed_data = bytes(img.get_infile_data())
+        if not pad_header:
+            uncompressed_data = uncompressed_data[header_size:]
+        # Encryption pads the payload of the signed image to the AES block
+        # size, the compressed one is encrypted instead.
+        img_size, = struct.unpack_from(img.get_struct_endian() + 'I',
+                                       img.payload, 12)
+        uncompressed_data += bytes(img_size - len(uncompressed_data))
+        if compression in ["lzma2", "lzma2armthumb"]:
+            preset = compression_preset
+            if compression_extreme:
+                preset |= lzma.PRESET_EXTREME
+            compressed_data = compress_lzma2(uncompressed_data, preset,
+                                             compression_dict_size,
+                                             compression == "lzma2armthumb",
+                                             compression_threads)
+            compression_header = create_lzma2_header(
+                dictsize = compression_dict_size, pb = comp_default_pb,
+                lc = comp_default_lc, lp = comp_default_lp)
+        else:
+            filtered_data = uncompressed_data
+            if compression == "lz4armthumb":
+                filtered_data = lz4.armthumb_filter(uncompressed_data)
+            compressed_data = lz4.compress(filtered_data)
+            compression_header = b''
+        uncompressed_size = len(uncompressed_data)
         compressed_size = len(compressed_data)
         print(f"compressed image size: {compressed_size} bytes")
         print(f"original image size: {uncompressed_size} bytes")
         compression_tlvs["DECOMP_SIZE"] = struct.pack(
-            img.get_struct_endian() + 'L', img.image_size)
+            img.get_struct_endian() + 'L', uncompressed_size)
         compression_tlvs["DECOMP_SHA"] = img.image_hash
         compression_tlvs_size = len(compression_tlvs["DECOMP_SIZE"])
         compression_tlvs_size += len(compression_tlvs["DECOMP_SHA"])
@@ -544,22 +855,298 @@ def sign(key, public_key_format, align, version, pad_sig, header_size,
             compression_tlvs["DECOMP_SIGNATURE"] = img.get_signature()
             compression_tlvs_size += len(compression_tlvs["DECOMP_SIGNATURE"])
         if (compressed_size + compression_tlvs_size) < uncompressed_size:
-            compression_header = create_lzma2_header(
-                dictsize = comp_default_dictsize, pb = comp_default_pb,
-                lc = comp_default_lc, lp = comp_default_lp)
             compressed_img.load_compressed(compressed_data, compression_header)
+            # The header padding is part of the hash of the signed image.
+            compressed_img.payload = (bytes(img.payload[:header_size]) +
+                                      compressed_img.payload[header_size:])
             compressed_img.base_addr = img.base_addr
             compressed_img.create(key, public_key_format, enckey,
                dependencies, boot_record, custom_tlvs, compression_tlvs,
                compression, int(encrypt_keylen), clear, baked_signature,
-               pub_key, vector_to_sign, user_sha=user_sha)
+               pub_key, vector_to_sign, user_sha=user_sha,
+               encrypt_mode=encrypt_mode)
             img = compressed_img
+
+    if delta_base is not None:
+        patch, delta_tlvs = delta_patch(delta_base, img.payload,
+                                        img.get_struct_endian(), max_align,
+                                        img.erased_val, delta_arm_thumb)
+        print(f"delta image patch size: {len(patch)} bytes")
+        print(f"full image size: {len(img.payload)} bytes")
+        if header_size + len(patch) < len(img.payload):
+            delta_img = image.Image(version=decode_version(version),
+                      header_size=header_size, pad_header=True,
+                      pad=pad, confirm=confirm, align=int(align),
+                      slot_size=slot_size, max_sectors=max_sectors,
+                      overwrite_only=overwrite_only, endian=endian,
+                      load_addr=load_addr, rom_fixed=rom_fixed,
+                      erased_val=erased_val, save_enctlv=save_enctlv,
+                      wrapped_key_size=wrapped_key_size,
+                      security_counter=security_counter, max_align=max_align,
+                      hash_chunk_size=hash_chunk_size, sig_cache=sig_cache)
+            delta_img.load_buffer(patch)
+            delta_img.base_addr = img.base_addr
+            delta_img.create(key, public_key_format, None,
+               dependencies, boot_record, custom_tlvs, delta_tlvs,
+               "delta", int(encrypt_keylen), clear, baked_signature,
+               pub_key, vector_to_sign, user_sha=user_sha)
+            img = delta_img
     img.save(outfile, hex_addr)
     if sig_out is not None:
         new_signature = img.get_signature()
         save_signature(sig_out, new_signature)
 
 
+def delta_patch(base_file, target, e, max_align, erased_val, thumb):
+    """Return the patch rebuilding target from the signed image in
+    base_file, and the protected TLVs binding it to that image."""
+    with open(base_file, 'rb') as f:
+        base = f.read()
+    try:
+        base = base[:delta.image_size(base, e)]
+        delta_tlvs = {"DELTA_BASE": delta.image_hash(base, e)}
+    except (ValueError, struct.error) as err:
+        raise click.UsageError("Invalid delta base image: {}".format(err))
+    # Every operation must be a multiple of the flash write size.
+    delta_align = int(max_align) if max_align is not None else 8
+    return delta.encode(base, target, delta_align, erased_val, e,
+                        thumb=thumb), delta_tlvs
+
+
+@click.argument('outfile')
+@click.argument('new')
+@click.argument('base')
+@click.option('--arm-thumb', default=False, is_flag=True,
+              help='Let the copies adjust the Thumb BL instructions they '
+                   'move, for smaller patches of Thumb code. Requires '
+                   'MCUBOOT_DELTA_ARM_THUMB support in the bootloader.')
+@click.option('-R', '--erased-val', type=click.Choice(['0', '0xff']),
+              required=False,
+              help='The value that is read back from erased flash.')
+@click.option('-e', '--endian', type=click.Choice(['little', 'big']),
+              default='little', help="Select little or big endian")
+@click.option('--overwrite-only', default=False, is_flag=True,
+              help='Use overwrite-only instead of swap upgrades')
+@click.option('-M', '--max-sectors', type=int,
+              help='When padding allow for this amount of sectors (defaults '
+                   'to 128)')
+@click.option('--confirm', default=False, is_flag=True,
+              help='When padding the image, mark it as confirmed (implies '
+                   '--pad)')
+@click.option('--pad', default=False, is_flag=True,
+              help='Pad image to --slot-size bytes, adding trailer magic')
+@click.option('-S', '--slot-size', type=BasedIntParamType(), required=True,
+              help='Size of the secondary slot.')
+@click.option('--align', type=click.Choice(['1', '2', '4', '8', '16', '32']),
+              default='1',
+              required=False,
+              help='Alignment used by swap update modes.')
+@click.option('--max-align', type=click.Choice(['8', '16', '32']),
+              required=False,
+              help='Maximum flash alignment, the patch operations are aligned '
+              'to it.')
+@click.option('--public-key-format', type=click.Choice(['hash', 'full']),
+              default='hash', help='In what format to add the public key to '
+              'the image manifest: full key or hash of the key.')
+@click.option('-k', '--key', metavar='filename')
+@click.command('delta', help='''Create a delta image from two signed images\n
+               Outputs to OUTFILE a delta image, signed with KEY, which the
+               bootloader applies to the signed image BASE in the primary
+               slot to rebuild the signed image NEW. The delta image gets the
+               header size, version, security counter and dependencies of
+               NEW.''')
+def delta_cmd(base, new, outfile, key, public_key_format, max_align, align,
+              slot_size, pad, confirm, max_sectors, overwrite_only, endian,
+              erased_val, arm_thumb):
+    if confirm:
+        pad = True
+    e = image.STRUCT_ENDIAN_DICT[endian]
+    try:
+        with open(new, 'rb') as f:
+            target = f.read()
+    except FileNotFoundError:
+        raise click.UsageError("Image file {} not found".format(new))
+    try:
+        target = target[:delta.image_size(target, e)]
+        _, _, header_size, _, _, flags = \
+            struct.unpack_from(e + delta.IMAGE_HEADER_FMT, target)
+        version = SemiSemVersion(*struct.unpack_from(e + 'BBHI', target, 20))
+        prot_tlvs = delta.protected_tlvs(target, e)
+    except (ValueError, struct.error) as err:
+        raise click.UsageError("Invalid new image: {}".format(err))
+    if flags & (image.IMAGE_F['DELTA'] | image.IMAGE_F['ENCRYPTED_AES128'] |
+                image.IMAGE_F['ENCRYPTED_AES256'] |
+                image.IMAGE_F['COMPRESSED_LZMA2'] |
+                image.IMAGE_F['COMPRESSED_LZ4']):
+        raise click.UsageError("Delta images can only be made of plain "
+                               "images")
+
+    security_counter = None
+    dependencies = None
+    custom_tlvs = {}
+    for kind, value in prot_tlvs:
+        if kind == image.TLV_VALUES['SEC_CNT']:
+            security_counter, = struct.unpack(e + 'I', value)
+        elif kind == image.TLV_VALUES['DEPENDENCY']:
+            if dependencies is None:
+                dependencies = {image.DEP_IMAGES_KEY: [],
+                                image.DEP_VERSIONS_KEY: []}
+            dep = struct.unpack(e + 'B3xBBHI', value)
+            dependencies[image.DEP_IMAGES_KEY].append(dep[0])
+            dependencies[image.DEP_VERSIONS_KEY].append(
+                SemiSemVersion(*dep[1:]))
+        elif image.TLV_VENDOR_RES_MIN <= kind <= image.TLV_VENDOR_RES_MAX:
+            custom_tlvs[kind] = value
+
+    erased = int(erased_val, 0) if erased_val is not None else 0xff
+    patch, delta_tlvs = delta_patch(base, target, e, max_align, erased,
+                                    arm_thumb)
+    print(f"delta image patch size: {len(patch)} bytes")
+    print(f"full image size: {len(target)} bytes")
+
+    img = image.Image(version=version, header_size=header_size,
+                      pad_header=True, pad=pad, confirm=confirm,
+                      align=int(align), slot_size=slot_size,
+                      max_sectors=max_sectors, overwrite_only=overwrite_only,
+                      endian=endian, erased_val=erased_val,
+                      security_counter=security_counter, max_align=max_align)
+    img.load_buffer(patch)
+    key = load_key(key) if key else None
+    img.create(key, public_key_format, None, dependencies, None,
+               custom_tlvs or None, delta_tlvs, "delta")
+    img.save(outfile)
+
+
+BATCH_KEY_OPTIONS = ['key', 'encrypt', 'fix-sig-pubkey']
+
+
+def batch_sign_args(entry):
+    """Return the sign command line of a sign-batch manifest entry.
+
+    Options given several times are lists, and the values of options taking
+    several arguments, like custom-tlv, are lists as well.
+    """
+    entry = dict(entry)
+    try:
+        args = [str(entry.pop('infile')), str(entry.pop('outfile'))]
+    except KeyError as e:
+        raise click.UsageError("Manifest entry without {}".format(e))
+    for name, value in entry.items():
+        values = value if isinstance(value, list) else [value]
+        for v in values:
+            if v is True:
+                args.append('--' + name)
+            elif isinstance(v, list):
+                args += ['--' + name] + [str(x) for x in v]
+            elif v is not False and v is not None:
+                args += ['--' + name, str(v)]
+    return args
+
+
+def batch_init(passwords):
+    key_passwords.update(passwords)
+
+
+def batch_sign(args):
+    """Sign one image of a sign-batch, returning the error if it failed."""
+    try:
+        sign.main(args=args, prog_name='imgtool sign', standalone_mode=False)
+    except click.ClickException as e:
+        return e.format_message()
+    except click.Abort:
+        return "aborted"
+    except Exception as e:
+        return "{}: {}".format(type(e).__name__, e)
+    return None
+
+
+@click.option('-j', '--jobs', type=int, default=None,
+              help='Number of images signed in parallel, the number of CPUs '
+              'by default.')
+@click.argument('manifest')
+@click.command('sign-batch', help='''Sign the images listed in MANIFEST\n
+               MANIFEST is a JSON object whose "images" list gives the sign
+               options of each image: "infile", "outfile" and the long option
+               names of the sign command, e.g. "header-size" or "key". The
+               options of its "defaults" object apply to every image. Each
+               key is loaded once per worker process.''')
+def sign_batch(manifest, jobs):
+    try:
+        with open(manifest) as f:
+            batch = json.load(f)
+    except FileNotFoundError:
+        raise click.UsageError("Manifest file not found")
+    except ValueError as e:
+        raise click.UsageError("Invalid manifest: {}".format(e))
+    defaults = batch.get('defaults', {})
+    images = [dict(defaults, **entry) for entry in batch.get('images', [])]
+    argv = [batch_sign_args(entry) for entry in images]
+
+    # Ask for the passphrases here rather than from the workers.
+    for entry in images:
+        for name in BATCH_KEY_OPTIONS:
+            if entry.get(name):
+                load_key(str(entry[name]))
+
+    if jobs is None:
+        jobs = os.cpu_count() or 1
+    jobs = max(1, min(jobs, len(argv)))
+    if jobs == 1:
+        errors = [batch_sign(args) for args in argv]
+    else:
+        with multiprocessing.Pool(jobs, initializer=batch_init,
+                                  initargs=(key_passwords,)) as pool:
+            errors = pool.map(batch_sign, argv)
+
+    failed = 0
+    for args, error in zip(argv, errors):
+        if error is not None:
+            print("{}: {}".format(args[0], error), file=sys.stderr)
+            failed += 1
+    if failed:
+        raise click.ClickException("{} of {} images failed".format(
+            failed, len(argv)))
+
+
+def parse_assemble_input(value):
+    """Split an INFILE[@ADDR] argument of assemble."""
+    path, sep, addr = value.rpartition('@')
+    if not sep:
+        return value, None
+    try:
+        return path, int(addr, 0)
+    except ValueError:
+        raise click.UsageError("Invalid address in {}".format(value))
+
+
+@click.argument('infiles', nargs=-1, required=True, metavar='INFILE[@ADDR]...')
+@click.option('-o', '--outfile', metavar='filename', required=True,
+              help='Output file, Intel HEX if its extension is .hex and '
+              'binary otherwise.')
+@click.option('-R', '--erased-val', type=click.Choice(['0', '0xff']),
+              default='0xff', show_default=True,
+              help='The value that is read back from erased flash, used to '
+              'fill the gaps of a binary output.')
+@click.option('--base', type=BasedIntParamType(), required=False,
+              help='Address of the start of a binary output, the lowest '
+              'input address by default.')
+@click.command(help='''Assemble images into a single factory image
+
+               Writes the binary files, each at the address given after its
+               name, and the Intel HEX files, at their own addresses, to
+               OUTFILE in one pass, e.g. the bootloader, a primary slot image
+               made with "sign --primary-slot" and its trailer, and the images
+               of the other slots. The inputs must not overlap.''')
+def assemble(infiles, outfile, erased_val, base):
+    inputs = [parse_assemble_input(f) for f in infiles]
+    try:
+        hexfile.assemble(inputs, outfile, int(erased_val, 0), base)
+    except FileNotFoundError as e:
+        raise click.UsageError("Input file not found: {}".format(e.filename))
+    except ValueError as e:
+        raise click.UsageError(str(e))
+
+
 class AliasesGroup(click.Group):
 
     _aliases = {
@@ -597,6 +1184,9 @@ imgtool.add_command(getpubhash)
 imgtool.add_command(getpriv)
 imgtool.add_command(verify)
 imgtool.add_command(sign)
+imgtool.add_command(sign_batch)
+imgtool.add_command(delta_cmd)
+imgtool.add_command(assemble)
 imgtool.add_command(version)
 imgtool.add_command(dumpinfo)
 
@@ -0,0 +1,55 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Precomputed Montgomery constants for RSA signature verification.
+
+For a modulus N of k 32-bit words and R = 2^(32 * k), bootutil needs N
+itself, R^2 mod N and -N^-1 mod 2^32 to compute s^65537 mod N without any
+division. They are used when MCUBOOT_RSA_MONT is enabled, see
+boot/bootutil/include/bootutil/rsa_mont.h.
+"""
+
+
+def mont_params(n, bits):
+    """Return the words of N and of R^2 mod N, and -N^-1 mod 2^32."""
+    if n % 2 == 0 or n.bit_length() > bits:
+        raise ValueError("Invalid modulus for a {}-bit key".format(bits))
+    k = bits // 32
+    rr = pow(2, 64 * k, n)
+    n0inv = (-pow(n, -1, 1 << 32)) % (1 << 32)
+    return _words(n, k), _words(rr, k), n0inv
+
+
+def _words(value, k):
+    """Split a number into k 32-bit words, least significant first."""
+    return [(value >> (32 * i)) & 0xffffffff for i in range(k)]
+
+
+def _emit_words(field, words, file):
+    print("    .{} = {{".format(field), file=file)
+    for i in range(0, len(words), 4):
+        print("        " + " ".join("0x{:08x},".format(w)
+                                    for w in words[i:i + 4]), file=file)
+    print("    },", file=file)
+
+
+def emit_c_mont(name, n, bits, file):
+    """Emit the constants of a modulus as a struct bootutil_rsa_mont."""
+    n_words, rr_words, n0inv = mont_params(n, bits)
+    print("const struct bootutil_rsa_mont {} = {{".format(name), file=file)
+    _emit_words("n", n_words, file)
+    _emit_words("rr", rr_words, file)
+    print("    .n0inv = 0x{:08x},".format(n0inv), file=file)
+    print("};", file=file)
@@ -0,0 +1,127 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import io
+import os
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+from intelhex import IntelHex
+
+from imgtool import hexfile
+from imgtool.main import imgtool
+
+HEADER_SIZE = 0x200
+SLOT_SIZE = 0x20000
+
+
+def to_hex(chunks, split):
+    """Write chunks with HexWriter, each in pieces of split bytes."""
+    f = io.StringIO()
+    w = hexfile.HexWriter(f, max(a + len(d) for a, d in chunks) - 1)
+    for addr, data in chunks:
+        for i in range(0, len(data), split):
+            w.write(addr + i, data[i:i + split])
+    w.close()
+    return f.getvalue()
+
+
+@pytest.mark.parametrize('chunks', [
+    [(0, os.urandom(100))],
+    [(0x8000, os.urandom(0x10005))],
+    [(0x1fff3, os.urandom(40)), (0x20100, os.urandom(7))],
+    [(0x10000000, os.urandom(3000)), (0x10000bb8, os.urandom(33))],
+])
+def test_hex_writer(tmp_path, chunks):
+    """HexWriter writes the records of intelhex, however the data is
+    split."""
+    ih = IntelHex()
+    for addr, data in chunks:
+        ih.puts(addr, data)
+    ref = tmp_path / 'ref.hex'
+    ih.tofile(str(ref), 'hex')
+
+    for split in (1, 7, 16, 1 << 20):
+        assert to_hex(chunks, split) == ref.read_text()
+
+    blocks = list(hexfile.read_hex(str(ref)))
+    got = IntelHex()
+    for addr, data in blocks:
+        got.puts(addr, data)
+    assert got.todict() == ih.todict()
+
+
+def sign(tmp_path, name, *args):
+    infile = tmp_path / 'zephyr.bin'
+    infile.write_bytes(os.urandom(0x1000))
+    outfile = tmp_path / name
+    result = CliRunner().invoke(imgtool, [
+        'sign', str(infile), str(outfile), f'--header-size={HEADER_SIZE}',
+        f'--slot-size={SLOT_SIZE}', '--version=1.0.0', '--pad-header',
+        *args])
+    assert result.exit_code == 0, result.output
+    return outfile
+
+
+def test_sign_hex(tmp_path):
+    """A padded HEX image holds the binary image and its trailer."""
+    bin_file = sign(tmp_path, 'app.bin', '--confirm')
+    hex_file = sign(tmp_path, 'app.hex', '--confirm', '--hex-addr=0x10000')
+
+    ih = IntelHex(str(hex_file))
+    padded = bin_file.read_bytes()
+    for addr, value in ih.todict().items():
+        assert padded[addr - 0x10000] == value
+    assert ih.minaddr() == 0x10000
+    assert ih.maxaddr() == 0x10000 + SLOT_SIZE - 1
+
+
+def assemble(tmp_path, outfile, *inputs, exit_code=0):
+    result = CliRunner().invoke(imgtool, [
+        'assemble', '-o', str(tmp_path / outfile), *inputs])
+    assert result.exit_code == exit_code, result.output
+    return tmp_path / outfile
+
+
+def test_assemble(tmp_path):
+    boot = tmp_path / 'boot.bin'
+    boot.write_bytes(os.urandom(0x3000))
+    app = sign(tmp_path, 'app.bin', '--confirm')
+    net = sign(tmp_path, 'net.hex', '--hex-addr=0x30000')
+
+    out = assemble(tmp_path, 'factory.bin', f'{app}@0x10000', str(net),
+                   f'{boot}@0')
+    data = out.read_bytes()
+    assert data[:0x3000] == boot.read_bytes()
+    assert data[0x3000:0x10000] == b'\xff' * 0xd000
+    assert data[0x10000:0x30000] == app.read_bytes()
+    for addr, value in IntelHex(str(net)).todict().items():
+        assert data[addr] == value
+
+    out_hex = assemble(tmp_path, 'factory.hex', f'{boot}@0',
+                       f'{app}@0x10000', str(net))
+    ih = IntelHex(str(out_hex))
+    for addr, value in ih.todict().items():
+        assert data[addr] == value
+    assert len(ih) == 0x3000 + SLOT_SIZE + len(IntelHex(str(net)))
+
+
+def test_assemble_overlap(tmp_path):
+    boot = tmp_path / 'boot.bin'
+    boot.write_bytes(os.urandom(0x3000))
+    out = assemble(tmp_path, 'factory.bin', f'{boot}@0', f'{boot}@0x2000',
+                   exit_code=2)
+    assert not Path(out).exists()
+    assemble(tmp_path, 'factory.bin', str(boot), exit_code=2)
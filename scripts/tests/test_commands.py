@@ -21,12 +21,14 @@ from imgtool import imgtool_version
 # all available imgtool commands
 COMMANDS = [
     "create",
+    "delta",
     "dumpinfo",
     "getpriv",
     "getpub",
     "getpubhash",
     "keygen",
     "sign",
+    "sign-batch",
     "verify",
     "version",
 ]
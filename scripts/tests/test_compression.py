@@ -12,12 +12,23 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
+import hashlib
+import lzma
+import random
+import struct
 from pathlib import Path
 
 import pytest
 from click.testing import CliRunner
 
-from imgtool.image import Image
+from imgtool import lz4
+from imgtool.image import (
+    IMAGE_F,
+    TLV_INFO_MAGIC,
+    TLV_PROT_INFO_MAGIC,
+    TLV_VALUES,
+    Image,
+)
 from imgtool.main import (
     comp_default_lp,
     comp_default_dictsize,
@@ -86,3 +97,241 @@ def test_lzma2_compression(tmpdir: Path, key_file: Path, compression: str, compr
     assert result.exit_code == 0
     assert out_file.exists()
     assert check_if_compressed(out_file) is compressed
+
+
+def read_tlvs(data: bytes, off: int, magic: int):
+    info_magic, tot = struct.unpack_from('<HH', data, off)
+    assert info_magic == magic
+    tlvs = []
+    pos = off + 4
+    while pos < off + tot:
+        kind, length = struct.unpack_from('<HH', data, pos)
+        tlvs.append((kind, data[pos + 4:pos + 4 + length]))
+        pos += 4 + length
+    return tlvs, off + tot
+
+
+def pack_tlvs(tlvs, magic: int) -> bytes:
+    data = b''.join(struct.pack('<HH', kind, len(value)) + value
+                    for kind, value in tlvs)
+    return struct.pack('<HH', magic, len(data) + 4) + data
+
+
+def decompress(img: bytes) -> bytes:
+    """Rebuild the image a compressed image decompresses to, the same way
+    as the bootloader, see boot/bootutil/src/decompress.c."""
+    magic, load_addr, hdr_size, prot_size, img_size, flags = \
+        struct.unpack_from('<IIHHII', img)
+    # Dictionary size of the LZMA2 header in front of the stream.
+    dict_bits = img[hdr_size]
+    dict_size = (2 | (dict_bits & 1)) << (dict_bits // 2 + 11)
+    filters = [{"id": lzma.FILTER_LZMA2, "dict_size": dict_size,
+                "lc": comp_default_lc, "lp": comp_default_lp,
+                "pb": comp_default_pb}]
+    if flags & IMAGE_F['COMPRESSED_LZ4']:
+        body = lz4.decompress(img[hdr_size:hdr_size + img_size])
+        # Undo the BCJ filter by decoding an unfiltered LZMA2 stream of the
+        # body through it.
+        if flags & IMAGE_F['COMPRESSED_ARM_THUMB']:
+            body = lzma.compress(body, format=lzma.FORMAT_RAW,
+                                 filters=filters)
+            body = lzma.decompress(body, format=lzma.FORMAT_RAW,
+                                   filters=[{"id": lzma.FILTER_ARMTHUMB}] +
+                                   filters)
+    else:
+        if flags & IMAGE_F['COMPRESSED_ARM_THUMB']:
+            filters.insert(0, {"id": lzma.FILTER_ARMTHUMB})
+        body = lzma.decompress(img[hdr_size + 2:hdr_size + img_size],
+                               format=lzma.FORMAT_RAW, filters=filters)
+
+    off = hdr_size + img_size
+    prot, off = read_tlvs(img, off, TLV_PROT_INFO_MAGIC)
+    unprot, _ = read_tlvs(img, off, TLV_INFO_MAGIC)
+    decomp_tlvs = (TLV_VALUES['DECOMP_SIZE'], TLV_VALUES['DECOMP_SHA'],
+                   TLV_VALUES['DECOMP_SIGNATURE'])
+    decomp = {kind: value for kind, value in prot if kind in decomp_tlvs}
+    prot = [(kind, value) for kind, value in prot
+            if kind not in decomp_tlvs]
+    assert struct.unpack('<I', decomp[TLV_VALUES['DECOMP_SIZE']]) == \
+        (len(body),)
+
+    prot_data = pack_tlvs(prot, TLV_PROT_INFO_MAGIC) if prot else b''
+    replace = {TLV_VALUES['SHA256']: decomp[TLV_VALUES['DECOMP_SHA']],
+               TLV_VALUES['ECDSASIG']: decomp[TLV_VALUES['DECOMP_SIGNATURE']]}
+    unprot = [(kind, replace.get(kind, value)) for kind, value in unprot]
+
+    flags &= ~(IMAGE_F['COMPRESSED_LZMA2'] | IMAGE_F['COMPRESSED_LZ4'] |
+               IMAGE_F['COMPRESSED_ARM_THUMB'])
+    out = struct.pack('<IIHHII', magic, load_addr, hdr_size, len(prot_data),
+                      len(body), flags) + img[20:hdr_size]
+    out += body + prot_data
+    assert hashlib.sha256(out).digest() == decomp[TLV_VALUES['DECOMP_SHA']]
+    return out + pack_tlvs(unprot, TLV_INFO_MAGIC)
+
+
+@pytest.mark.parametrize('compression', ['lzma2', 'lzma2armthumb', 'lz4',
+                                         'lz4armthumb'])
+@pytest.mark.parametrize('pad_header', [True, False])
+def test_decompressed_image(tmpdir: Path, key_file: Path,
+                            compression: str, pad_header: bool):
+    """Check that a compressed image decompresses to the signed image."""
+    payload = (b"hello world\x00\x00\x00\x00\x00" * 64 +
+               b"\x12\xf0\x34\xf8\x00\xbf" * 128)
+    if not pad_header:
+        payload = bytes(HEADER_SIZE) + payload
+    in_file = tmpdir / 'zephyr.bin'
+    with in_file.open("wb") as f:
+        f.write(payload)
+    out_file = tmpdir / 'zephyr_signed.bin'
+    uncompressed_file = tmpdir / 'zephyr_uncompressed.bin'
+
+    args = [
+        f'--header-size={HEADER_SIZE}',
+        f'--slot-size={SLOT_SIZE}',
+        f'--version={VERSION}',
+        '--security-counter=3',
+        f'--key={key_file}',
+    ]
+    if pad_header:
+        args.append('--pad-header')
+    runner = CliRunner()
+    result = runner.invoke(imgtool, ['sign', *args, str(in_file),
+                                     str(uncompressed_file)])
+    assert result.exit_code == 0
+    result = runner.invoke(imgtool, ['sign', *args,
+                                     f'--compression={compression}',
+                                     str(in_file), str(out_file)])
+    assert result.exit_code == 0
+
+    with out_file.open("rb") as f:
+        out = f.read()
+    flags, = struct.unpack_from('<I', out, 16)
+    if compression.startswith('lz4'):
+        assert flags & IMAGE_F['COMPRESSED_LZ4']
+    else:
+        assert check_if_compressed(out_file)
+    assert bool(flags & IMAGE_F['COMPRESSED_ARM_THUMB']) == \
+        compression.endswith('armthumb')
+    out = decompress(out)
+    with uncompressed_file.open("rb") as f:
+        uncompressed = f.read()
+    # ECDSA signatures differ between runs, compare up to the TLVs.
+    _, _, _, prot_size, img_size, _ = struct.unpack_from('<IIHHII', out)
+    size = HEADER_SIZE + img_size + prot_size
+    assert out[:size] == uncompressed[:size]
+
+    rebuilt_file = tmpdir / 'zephyr_rebuilt.bin'
+    with rebuilt_file.open("wb") as f:
+        f.write(out)
+    result = runner.invoke(imgtool, ['verify', f'--key={key_file}',
+                                     str(rebuilt_file)])
+    assert result.exit_code == 0
+
+
+@pytest.mark.parametrize('args', [
+    ['--compression-threads=4'],
+    ['--compression-preset=1', '--compression-dict-size=0x100000'],
+    ['--compression-extreme', '--compression-threads=3'],
+])
+@pytest.mark.parametrize('compression', ['lzma2', 'lzma2armthumb'])
+def test_lzma2_options(tmpdir: Path, key_file: Path, compression: str,
+                       args):
+    """Check that tuned and multi-threaded LZMA2 images decompress to the
+    signed image."""
+    rng = random.Random(0)
+    payload = bytes(rng.choice(b"hello\x00\xf0\xf8") for _ in range(8192))
+    in_file = tmpdir / 'zephyr.bin'
+    with in_file.open("wb") as f:
+        f.write(payload)
+    out_file = tmpdir / 'zephyr_signed.bin'
+    uncompressed_file = tmpdir / 'zephyr_uncompressed.bin'
+
+    sign_args = [
+        f'--header-size={HEADER_SIZE}',
+        f'--slot-size={SLOT_SIZE}',
+        f'--version={VERSION}',
+        '--pad-header',
+        f'--key={key_file}',
+    ]
+    runner = CliRunner()
+    result = runner.invoke(imgtool, ['sign', *sign_args, str(in_file),
+                                     str(uncompressed_file)])
+    assert result.exit_code == 0
+    result = runner.invoke(imgtool, ['sign', *sign_args, *args,
+                                     f'--compression={compression}',
+                                     str(in_file), str(out_file)])
+    assert result.exit_code == 0
+
+    with out_file.open("rb") as f:
+        out = decompress(f.read())
+    with uncompressed_file.open("rb") as f:
+        uncompressed = f.read()
+    _, _, _, prot_size, img_size, _ = struct.unpack_from('<IIHHII', out)
+    size = HEADER_SIZE + img_size + prot_size
+    assert out[:size] == uncompressed[:size]
+
+
+@pytest.mark.parametrize('seed', range(4))
+def test_lz4_compress(seed: int):
+    """Check LZ4 blocks and the BCJ filter against reference results."""
+    rng = random.Random(seed)
+    data = bytearray()
+    while len(data) < 100000:
+        if data and rng.random() < 0.4:
+            off = rng.randrange(len(data))
+            data += data[off:off + rng.randint(1, 400)]
+        else:
+            data += bytes(rng.getrandbits(8) for _ in range(rng.randint(1, 40)))
+    data = bytes(data)
+
+    block = lz4.compress(data)
+    assert lz4.decompress(block) == data
+    assert len(block) < len(data) // 2
+
+    filtered = lzma.compress(data, format=lzma.FORMAT_RAW,
+                             filters=[{"id": lzma.FILTER_ARMTHUMB},
+                                      {"id": lzma.FILTER_LZMA2}])
+    filtered = lzma.decompress(filtered, format=lzma.FORMAT_RAW,
+                               filters=[{"id": lzma.FILTER_LZMA2}])
+    assert lz4.armthumb_filter(data) == filtered
+
+
+@pytest.mark.parametrize('compression', ['lzma2', 'lz4armthumb'])
+def test_compression_encrypted(tmpdir: Path, key_file: Path,
+                               compression: str):
+    """Check that encrypted images are compressed, then encrypted."""
+    in_file = tmpdir / 'zephyr.bin'
+    with in_file.open("wb") as f:
+        f.write(b"hello world\x00\x00\x00\x00\x00" * 64 + b"\x01")
+    out_file = tmpdir / 'zephyr_signed.bin'
+
+    result = CliRunner().invoke(
+        imgtool,
+        [
+            'sign',
+            str(in_file),
+            str(out_file),
+            f'--header-size={HEADER_SIZE}',
+            f'--slot-size={SLOT_SIZE}',
+            f'--version={VERSION}',
+            '--pad-header',
+            f'--compression={compression}',
+            f'--key={key_file}',
+            f'--encrypt={key_file.parent / "enc-ec256-pub.pem"}',
+        ],
+    )
+    assert result.exit_code == 0
+
+    with out_file.open("rb") as f:
+        img = f.read()
+    _, _, hdr_size, _, img_size, flags = struct.unpack_from('<IIHHII', img)
+    assert flags & IMAGE_F['ENCRYPTED_AES128']
+    assert flags & (IMAGE_F['COMPRESSED_LZMA2'] | IMAGE_F['COMPRESSED_LZ4'])
+    assert img_size % 16 == 0
+    assert img_size < 1025 // 2
+
+    # The decompressed image is the encrypted signed image, whose payload
+    # is padded to the AES block size before encryption.
+    prot, _ = read_tlvs(img, hdr_size + img_size, TLV_PROT_INFO_MAGIC)
+    prot = dict(prot)
+    assert struct.unpack('<I', prot[TLV_VALUES['DECOMP_SIZE']]) == (1040,)
@@ -0,0 +1,199 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import random
+import struct
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+
+from imgtool import delta
+from imgtool.image import IMAGE_F
+from imgtool.main import imgtool
+
+HEADER_SIZE = 0x200
+SLOT_SIZE = 0x7a000
+
+
+@pytest.fixture
+def key_file() -> Path:
+    return Path(__file__).parents[2] / 'root-ec-p256.pem'
+
+
+def payloads(seed: int):
+    rng = random.Random(seed)
+    base = bytearray(rng.getrandbits(8) for _ in range(16384))
+    new = bytearray(base)
+    new[100:100] = b'inserted'
+    new[5000:5016] = bytes(16)
+    del new[9000:9003]
+    return bytes(base), bytes(new)
+
+
+def sign(tmpdir: Path, key_file: Path, name: str, payload: bytes,
+         version: str, *args):
+    in_file = tmpdir / (name + '.bin')
+    with in_file.open("wb") as f:
+        f.write(payload)
+    out_file = tmpdir / (name + '_signed.bin')
+
+    runner = CliRunner()
+    result = runner.invoke(
+        imgtool,
+        [
+            'sign',
+            str(in_file),
+            str(out_file),
+            f'--header-size={HEADER_SIZE}',
+            f'--slot-size={SLOT_SIZE}',
+            f'--version={version}',
+            '--pad-header',
+            f'--key={key_file}',
+            *args
+        ],
+    )
+    assert result.exit_code == 0
+    with out_file.open("rb") as f:
+        return out_file, f.read()
+
+
+@pytest.mark.parametrize('align', [1, 8, 32])
+def test_delta_encode_apply(align: int):
+    """Check that a patch rebuilds the target up to the alignment padding."""
+    base, new = payloads(align)
+    patch = delta.encode(base, new, align)
+    out = delta.apply(base, patch)
+    assert len(out) % align == 0
+    assert out[:len(new)] == new
+    assert len(patch) < len(new) // 4
+
+
+def test_delta_sign(tmpdir: Path, key_file: Path):
+    """Check that a delta image verifies and rebuilds the full image."""
+    base, new = payloads(0)
+    base_file, base_img = sign(tmpdir, key_file, 'base', base, '1.0.0')
+    _, full_img = sign(tmpdir, key_file, 'full', new, '1.1.0')
+    delta_file, delta_img = sign(tmpdir, key_file, 'delta', new, '1.1.0',
+                                 f'--delta-base={base_file}')
+
+    flags, = struct.unpack('<I', delta_img[16:20])
+    assert flags & IMAGE_F['DELTA']
+    assert len(delta_img) < len(full_img) // 4
+
+    result = CliRunner().invoke(imgtool, ['verify', f'--key={key_file}',
+                                          str(delta_file)])
+    assert result.exit_code == 0
+
+    # The base hash TLV binds the patch to the image it applies to.
+    assert delta.image_hash(base_img) in delta_img
+
+    # ECDSA signatures differ between runs, compare up to the TLVs and check
+    # that the rebuilt image verifies on its own.
+    img_size, = struct.unpack('<I', delta_img[12:16])
+    patch = delta_img[HEADER_SIZE:HEADER_SIZE + img_size]
+    out = delta.apply(base_img, patch)
+    out = out[:delta.image_size(out)]
+    assert out[:HEADER_SIZE + len(new)] == full_img[:HEADER_SIZE + len(new)]
+
+    out_file = tmpdir / 'rebuilt.bin'
+    with out_file.open("wb") as f:
+        f.write(out)
+    result = CliRunner().invoke(imgtool, ['verify', f'--key={key_file}',
+                                          str(out_file)])
+    assert result.exit_code == 0
+
+
+def test_delta_sign_unrelated_base(tmpdir: Path, key_file: Path):
+    """Check that a full image is output if the patch is not smaller."""
+    base, _ = payloads(1)
+    _, new = payloads(2)
+    base_file, _ = sign(tmpdir, key_file, 'base', base, '1.0.0')
+    _, delta_img = sign(tmpdir, key_file, 'delta', new, '1.1.0',
+                        f'--delta-base={base_file}')
+
+    flags, = struct.unpack('<I', delta_img[16:20])
+    assert not flags & IMAGE_F['DELTA']
+
+
+def thumb_payloads(seed: int):
+    """Return Thumb-like code calling a few functions, and the same code with
+    a function inserted in front, every call then being moved."""
+    rng = random.Random(seed)
+    funcs = [0x400 * i for i in range(1, 16)]
+    code = bytearray()
+    while len(code) < 16384:
+        if rng.random() < 0.3:
+            off = ((rng.choice(funcs) - len(code) - 4) >> 1) & 0x3fffff
+            code += bytes([(off >> 11) & 0xff, 0xf0 | (off >> 19),
+                           off & 0xff, 0xf8 | ((off >> 8) & 7)])
+        else:
+            code += bytes([rng.getrandbits(8), rng.choice([0x20, 0x46])])
+    base = bytes(code)
+    inserted = bytes([0x00, 0xbf]) * 64
+    new = bytearray(inserted + base)
+    i = 0
+    while i + 4 <= len(base):
+        if delta.is_thumb_bl(base, i):
+            moved = delta.move_thumb_bl(base[i:i + 4], -len(inserted) // 2)
+            new[len(inserted) + i:len(inserted) + i + 4] = moved
+            i += 4
+        else:
+            i += 2
+    return base, bytes(new)
+
+
+@pytest.mark.parametrize('align', [1, 8])
+def test_delta_thumb(align: int):
+    """Check that Thumb copies follow moved calls and still rebuild the
+    target."""
+    base, new = thumb_payloads(align)
+    patch = delta.encode(base, new, align)
+    thumb_patch = delta.encode(base, new, align, thumb=True)
+    out = delta.apply(base, thumb_patch)
+    assert out[:len(new)] == new
+    assert len(thumb_patch) < len(patch) // 10
+
+
+def test_delta_command(tmpdir: Path, key_file: Path):
+    """Check that the delta command rebuilds the new signed image."""
+    base, new = thumb_payloads(0)
+    base_file, base_img = sign(tmpdir, key_file, 'base', base, '1.0.0')
+    new_file, new_img = sign(tmpdir, key_file, 'new', new, '1.1.0',
+                             '--security-counter=3', '-d', '(1, 2.0.0)')
+    delta_file = tmpdir / 'delta.bin'
+
+    result = CliRunner().invoke(imgtool, [
+        'delta', f'--key={key_file}', f'--slot-size={SLOT_SIZE}',
+        '--arm-thumb', str(base_file), str(new_file), str(delta_file)])
+    assert result.exit_code == 0
+
+    with delta_file.open("rb") as f:
+        delta_img = f.read()
+    flags, = struct.unpack('<I', delta_img[16:20])
+    assert flags & IMAGE_F['DELTA']
+    assert delta_img[20:28] == new_img[20:28]
+    assert len(delta_img) < len(new_img) // 4
+    # The security counter and dependency TLVs are those of the new image.
+    assert (set(delta.protected_tlvs(new_img)) <=
+            set(delta.protected_tlvs(delta_img)))
+
+    result = CliRunner().invoke(imgtool, ['verify', f'--key={key_file}',
+                                          str(delta_file)])
+    assert result.exit_code == 0
+
+    img_size, = struct.unpack('<I', delta_img[12:16])
+    patch = delta_img[HEADER_SIZE:HEADER_SIZE + img_size]
+    out = delta.apply(base_img, patch)
+    assert out[:len(new_img)] == new_img
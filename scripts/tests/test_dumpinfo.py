@@ -0,0 +1,85 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import json
+from pathlib import Path
+
+from click.testing import CliRunner
+
+from imgtool.main import imgtool
+
+KEY = Path(__file__).parents[2] / 'root-ec-p256.pem'
+OTHER_KEY = Path(__file__).parents[2] / 'root-ec-p384.pem'
+
+
+def sign_images(tmpdir: Path):
+    """Sign two images, one of them in a sub-directory."""
+    (tmpdir / 'sub').mkdir()
+    outfiles = [tmpdir / 'app.bin', tmpdir / 'sub' / 'net.bin']
+    runner = CliRunner()
+    for i, out_file in enumerate(outfiles):
+        in_file = tmpdir / 'in{}.img'.format(i)
+        with in_file.open("wb") as f:
+            f.write(bytes([i]) * (1000 + i * 300))
+        result = runner.invoke(imgtool, [
+            'sign', '--header-size=0x200', '--slot-size=0x7a000',
+            '--pad-header', f'--key={KEY}', '--version=1.2.{}'.format(i),
+            str(in_file), str(out_file)])
+        assert result.exit_code == 0
+    return outfiles
+
+
+def dumpinfo_json(tmpdir: Path, *args):
+    report = tmpdir / 'report.json'
+    runner = CliRunner()
+    result = runner.invoke(imgtool, ['dumpinfo', '--json', '-o', str(report),
+                                     *args])
+    with report.open() as f:
+        return result, json.load(f)
+
+
+def test_dumpinfo_json(tmpdir: Path):
+    """Check that directories are walked and every image is reported."""
+    outfiles = sign_images(tmpdir)
+    result, report = dumpinfo_json(tmpdir, f'--key={KEY}', str(tmpdir))
+    assert result.exit_code == 0
+    assert [info['file'] for info in report] == [str(f) for f in outfiles]
+    for i, info in enumerate(report):
+        assert info['header']['version'] == '1.2.{}+0'.format(i)
+        assert info['hash'] == 'ok'
+        assert info['signature'] == 'ok'
+        assert 'SHA256' in [tlv['name'] for tlv in info['tlvs']]
+
+
+def test_dumpinfo_json_invalid(tmpdir: Path):
+    """Check that corrupted images and other files are reported."""
+    outfiles = sign_images(tmpdir)
+    with outfiles[0].open("r+b") as f:
+        f.seek(0x300)
+        f.write(b'\xff')
+    with (tmpdir / 'notes.bin').open("wb") as f:
+        f.write(b'not an image')
+
+    result, report = dumpinfo_json(tmpdir, str(tmpdir))
+    assert result.exit_code != 0
+    infos = {Path(info['file']).name: info for info in report}
+    assert infos['app.bin']['hash'] == 'invalid'
+    assert infos['net.bin']['hash'] == 'ok'
+    assert infos['net.bin']['signature'] == 'unchecked'
+    assert 'error' in infos['notes.bin']
+
+    result, report = dumpinfo_json(tmpdir, f'--key={OTHER_KEY}',
+                                   str(outfiles[1]))
+    assert result.exit_code != 0
+    assert report[0]['signature'] == 'key-mismatch'
@@ -0,0 +1,57 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import io
+import re
+
+import pytest
+
+from imgtool import ecdsa_comb as comb
+
+P256_B = 0x5ac635d8aa3a93e7b3ebbd55769886bc651d06b0cc53b0f63bce3c3e27d2604b
+
+
+def on_curve(point):
+    x, y = point
+    return (y * y - (x * x * x - 3 * x + P256_B)) % comb.P256_P == 0
+
+
+def test_generator_order():
+    assert on_curve(comb.P256_G)
+    assert comb.point_mul(comb.P256_N, comb.P256_G) is None
+
+
+@pytest.mark.parametrize('scalar', [1, 2, 0xdeadbeef, comb.P256_N - 1])
+def test_comb_table(scalar):
+    """Check that every entry is the expected combination of the teeth."""
+    point = comb.point_mul(scalar, comb.P256_G)
+    table = comb.comb_table(point)
+    assert len(table) == 15
+    for idx, entry in enumerate(table, start=1):
+        k = sum(1 << (comb.COMB_SPACING * j)
+                for j in range(comb.COMB_TEETH) if idx & (1 << j))
+        assert entry == comb.point_mul(k * scalar % comb.P256_N, comb.P256_G)
+        assert on_curve(entry)
+
+
+def test_emit_c_comb():
+    out = io.StringIO()
+    comb.emit_c_comb('test_comb', comb.P256_G, out)
+    words = re.findall(r'0x[0-9a-f]{8}', out.getvalue())
+    assert out.getvalue().startswith(
+        'const struct bootutil_ecdsa_comb test_comb = {')
+    assert len(words) == 15 * 16
+    # First entry is the point itself, least significant word first.
+    assert int(words[0], 16) == comb.P256_G[0] & 0xffffffff
+    assert int(words[8], 16) == comb.P256_G[1] & 0xffffffff
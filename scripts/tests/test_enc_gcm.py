@@ -0,0 +1,143 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import struct
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+from cryptography.hazmat.primitives.ciphers import Cipher, algorithms, modes
+from cryptography.hazmat.primitives.ciphers.aead import AESGCM
+
+from imgtool import image
+from imgtool.image import IMAGE_F, TLV_INFO_MAGIC, TLV_VALUES
+from imgtool.main import imgtool
+
+VERSION = '1.0.0'
+HEADER_SIZE = 0x200
+SLOT_SIZE = 0x7a000
+PLAINKEY = bytes(range(0x40, 0x60))
+PAYLOAD = bytes(range(256)) * 8 + b'tail'
+
+
+@pytest.fixture
+def key_file() -> Path:
+    return Path(__file__).parents[2] / 'root-ec-p256.pem'
+
+
+def sign(tmpdir: Path, key_file: Path, *args):
+    in_file = tmpdir / 'zephyr.bin'
+    with in_file.open("wb") as f:
+        f.write(PAYLOAD)
+    out_file = tmpdir / 'zephyr_signed.bin'
+
+    result = CliRunner().invoke(
+        imgtool,
+        [
+            'sign',
+            str(in_file),
+            str(out_file),
+            f'--header-size={HEADER_SIZE}',
+            f'--slot-size={SLOT_SIZE}',
+            f'--version={VERSION}',
+            '--pad-header',
+            f'--key={key_file}',
+            f'--encrypt={key_file.parent / "enc-ec256-pub.pem"}',
+            *args
+        ],
+    )
+    if result.exit_code != 0:
+        return None
+    with out_file.open("rb") as f:
+        return f.read()
+
+
+def unprotected_tlvs(img: bytes) -> dict:
+    _, _, hdr_size, prot_size, img_size = struct.unpack_from('<IIHHI', img)
+    off = hdr_size + img_size + prot_size
+    magic, tot = struct.unpack_from('<HH', img, off)
+    assert magic == TLV_INFO_MAGIC
+    tlvs = {}
+    pos = off + 4
+    while pos < off + tot:
+        kind, length = struct.unpack_from('<HH', img, pos)
+        tlvs[kind] = img[pos + 4:pos + 4 + length]
+        pos += 4 + length
+    return tlvs
+
+
+@pytest.mark.parametrize('keylen', [128, 256])
+def test_gcm_sign(tmpdir: Path, key_file: Path, monkeypatch, keylen: int):
+    """Check the AES-GCM payload against what the bootloader decrypts."""
+    monkeypatch.setattr(image.os, 'urandom', lambda n: PLAINKEY[:n])
+    img = sign(tmpdir, key_file, '--encrypt-mode=gcm',
+               f'--encrypt-keylen={keylen}')
+    assert img is not None
+
+    img_size, flags = struct.unpack_from('<II', img, 12)
+    assert flags & IMAGE_F['ENCRYPTED_GCM']
+    assert flags & IMAGE_F['ENCRYPTED_AES%d' % keylen]
+    tag = unprotected_tlvs(img)[TLV_VALUES['ENC_GCM_TAG']]
+    assert len(tag) == 16
+
+    key = PLAINKEY[:keylen // 8]
+    payload = img[HEADER_SIZE:HEADER_SIZE + img_size]
+    padded = PAYLOAD + bytes(-len(PAYLOAD) % 16)
+    assert AESGCM(key).decrypt(bytes(12), payload + tag, None) == padded
+
+    # The bootloader decrypts with AES-CTR from counter block 2 on.
+    decryptor = Cipher(algorithms.AES(key),
+                       modes.CTR(bytes(15) + b'\x02')).decryptor()
+    assert decryptor.update(payload) + decryptor.finalize() == padded
+
+
+def test_ctr_sign(tmpdir: Path, key_file: Path):
+    """Check that AES-CTR images have no GCM flag or tag."""
+    img = sign(tmpdir, key_file)
+    assert img is not None
+
+    flags, = struct.unpack_from('<I', img, 16)
+    assert not flags & IMAGE_F['ENCRYPTED_GCM']
+    assert TLV_VALUES['ENC_GCM_TAG'] not in unprotected_tlvs(img)
+
+
+def test_gcm_clear(tmpdir: Path, key_file: Path):
+    """Check that AES-GCM images can not be output in clear."""
+    assert sign(tmpdir, key_file, '--encrypt-mode=gcm', '--clear') is None
+
+
+@pytest.mark.parametrize('mode', ['ctr', 'gcm'])
+def test_primary_slot(tmpdir: Path, key_file: Path, mode: str):
+    """Check that primary slot images keep their payload in clear and are
+    padded to the slot with a confirmed trailer."""
+    img = sign(tmpdir, key_file, f'--encrypt-mode={mode}', '--primary-slot')
+    assert img is not None
+    assert len(img) == SLOT_SIZE
+
+    img_size, flags = struct.unpack_from('<II', img, 12)
+    assert flags & IMAGE_F['ENCRYPTED_AES128']
+    padded = PAYLOAD + bytes(-len(PAYLOAD) % 16)
+    assert img[HEADER_SIZE:HEADER_SIZE + img_size] == padded
+    assert (TLV_VALUES['ENC_GCM_TAG'] in unprotected_tlvs(img)) == \
+        (mode == 'gcm')
+
+    magic = bytes([0x77, 0xc2, 0x95, 0xf3, 0x60, 0xd2, 0xef, 0x7f,
+                   0x35, 0x52, 0x50, 0x0f, 0x2c, 0xb6, 0x79, 0x80])
+    assert img[-16:] == magic
+    # image_ok, right before the aligned magic.
+    assert img[-16 - 8] == 0x01
+
+    result = CliRunner().invoke(imgtool, ['verify', f'--key={key_file}',
+                                          str(tmpdir / 'zephyr_signed.bin')])
+    assert result.exit_code == 0
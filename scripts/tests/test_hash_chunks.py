@@ -0,0 +1,190 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import hashlib
+import struct
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+
+from imgtool.image import IMAGE_F, TLV_VALUES
+from imgtool.main import imgtool
+
+VERSION = '1.2.3'
+HEADER_SIZE = 0x200
+SLOT_SIZE = 0x7a000
+
+
+@pytest.fixture
+def key_file() -> Path:
+    return Path(__file__).parents[2] / 'root-ec-p256.pem'
+
+
+def sign(tmpdir: Path, key_file: Path, payload: bytes, chunk_size: int,
+         *args, exit_code=0):
+    in_file = tmpdir / 'zephyr.bin'
+    with in_file.open("wb") as f:
+        f.write(payload)
+    out_file = tmpdir / 'zephyr_signed.bin'
+
+    runner = CliRunner()
+    result = runner.invoke(
+        imgtool,
+        [
+            'sign',
+            str(in_file),
+            str(out_file),
+            f'--header-size={HEADER_SIZE}',
+            f'--slot-size={SLOT_SIZE}',
+            f'--version={VERSION}',
+            '--pad-header',
+            f'--key={key_file}',
+            *([f'--hash-chunk-size={chunk_size}'] if chunk_size else []),
+            *args
+        ],
+    )
+    assert result.exit_code == exit_code
+    return out_file
+
+
+def verify(out_file: Path, key_file: Path):
+    runner = CliRunner()
+    return runner.invoke(imgtool, ['verify', f'--key={key_file}',
+                                   str(out_file)])
+
+
+@pytest.mark.parametrize('chunk_size', [256, 1000, 4096])
+def test_hash_chunks_sign_verify(tmpdir: Path, key_file: Path,
+                                 chunk_size: int):
+    """Check that a chunk-hashed image is flagged and verifies."""
+    out_file = sign(tmpdir, key_file, bytes(range(256)) * 11, chunk_size)
+
+    with out_file.open("rb") as f:
+        data = f.read()
+    flags, = struct.unpack('<I', data[16:20])
+    assert flags & IMAGE_F['HASH_CHUNKED']
+
+    result = verify(out_file, key_file)
+    assert result.exit_code == 0
+
+
+def test_hash_chunks_tampered_payload(tmpdir: Path, key_file: Path):
+    """Check that corrupting a payload chunk is detected."""
+    out_file = sign(tmpdir, key_file, bytes(range(256)) * 11, 512)
+
+    with out_file.open("rb") as f:
+        data = bytearray(f.read())
+    data[HEADER_SIZE + 1500] ^= 0xff
+    with out_file.open("wb") as f:
+        f.write(data)
+
+    result = verify(out_file, key_file)
+    assert result.exit_code != 0
+
+
+def protected_tlvs(data: bytes) -> dict:
+    hdr_size, prot_size, img_size = struct.unpack_from('<HHI', data, 8)
+    off = hdr_size + img_size
+    end = off + prot_size
+    tlvs = {}
+    off += 4
+    while off < end:
+        kind, length = struct.unpack_from('<HH', data, off)
+        tlvs[kind] = data[off + 4:off + 4 + length]
+        off += 4 + length
+    return tlvs
+
+
+def test_ram_load_stage(tmpdir: Path, key_file: Path):
+    """Check that the size of the first RAM load stage is signed."""
+    out_file = sign(tmpdir, key_file, bytes(range(256)) * 11, 512,
+                    '--load-addr=0x20000000', '--ram-load-stage=0x300')
+
+    with out_file.open("rb") as f:
+        data = f.read()
+    stage = protected_tlvs(data)[TLV_VALUES['RAM_LOAD_STAGE']]
+    assert struct.unpack('<I', stage) == (0x300,)
+
+    result = verify(out_file, key_file)
+    assert result.exit_code == 0
+
+
+@pytest.mark.parametrize('chunk_size, args', [
+    (None, ['--load-addr=0x20000000', '--ram-load-stage=0x300']),
+    (512, ['--ram-load-stage=0x300']),
+    (512, ['--load-addr=0x20000000', '--ram-load-stage=0x10000']),
+])
+def test_ram_load_stage_invalid(tmpdir: Path, key_file: Path, chunk_size, args):
+    """Check that staged images need chunks, a load address and a stage that
+    fits in the payload."""
+    sign(tmpdir, key_file, bytes(range(256)) * 11, chunk_size, *args,
+         exit_code=2)
+
+
+@pytest.mark.parametrize('sector_size', [0x100, 0x400, 0x1000])
+def test_sector_digests(tmpdir: Path, key_file: Path, sector_size: int):
+    """Check that the sector digest table covers the payload of each sector
+    of the slot and verifies."""
+    payload = bytes(range(256)) * 11
+    out_file = sign(tmpdir, key_file, payload, None,
+                    f'--sector-digest-size={sector_size}')
+
+    with out_file.open("rb") as f:
+        data = f.read()
+    table = protected_tlvs(data)[TLV_VALUES['SECTOR_DIGESTS']]
+    assert struct.unpack_from('<I', table) == (sector_size,)
+
+    end = HEADER_SIZE + len(payload)
+    digests = b''
+    off = HEADER_SIZE
+    while off < end:
+        nxt = min((off // sector_size + 1) * sector_size, end)
+        digests += hashlib.sha256(data[off:nxt]).digest()
+        off = nxt
+    assert table[4:] == digests
+
+    result = verify(out_file, key_file)
+    assert result.exit_code == 0
+
+
+def test_sector_digests_tampered_table(tmpdir: Path, key_file: Path):
+    """Check that a wrong sector digest is detected."""
+    out_file = sign(tmpdir, key_file, bytes(range(256)) * 11, None,
+                    '--sector-digest-size=0x400')
+
+    with out_file.open("rb") as f:
+        data = bytearray(f.read())
+    hdr_size, _, img_size = struct.unpack_from('<HHI', data, 8)
+    off = hdr_size + img_size + 4
+    while struct.unpack_from('<H', data, off)[0] != \
+            TLV_VALUES['SECTOR_DIGESTS']:
+        off += 4 + struct.unpack_from('<H', data, off + 2)[0]
+    data[off + 8] ^= 0xff
+    with out_file.open("wb") as f:
+        f.write(data)
+
+    result = verify(out_file, key_file)
+    assert result.exit_code != 0
+
+
+@pytest.mark.parametrize('args', [
+    ['--sector-digest-size=0'],
+    ['--sector-digest-size=0x300'],
+    ['--sector-digest-size=0x100', '--align=8', '--compression=lz4'],
+])
+def test_sector_digests_invalid(tmpdir: Path, key_file: Path, args):
+    """Check that sector sizes must divide the slot and that compressed
+    images are rejected."""
+    sign(tmpdir, key_file, bytes(range(256)) * 11, None, *args, exit_code=2)
@@ -0,0 +1,109 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import struct
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+
+from imgtool.image import IMAGE_F, TLV_PROT_INFO_MAGIC, TLV_VALUES
+from imgtool.main import imgtool
+
+VERSION = '1.0.0'
+HEADER_SIZE = 0x200
+SLOT_SIZE = 0x7a000
+PAYLOAD = bytes(range(256)) * 16
+
+
+@pytest.fixture
+def key_file() -> Path:
+    return Path(__file__).parents[2] / 'root-ec-p256.pem'
+
+
+def sign(tmpdir: Path, key_file: Path, *args, exit_code=0):
+    in_file = tmpdir / 'zephyr.bin'
+    with in_file.open("wb") as f:
+        f.write(PAYLOAD)
+    out_file = tmpdir / 'zephyr_signed.bin'
+
+    result = CliRunner().invoke(
+        imgtool,
+        [
+            'sign',
+            str(in_file),
+            str(out_file),
+            f'--header-size={HEADER_SIZE}',
+            f'--slot-size={SLOT_SIZE}',
+            f'--version={VERSION}',
+            '--pad-header',
+            f'--key={key_file}',
+            *args
+        ],
+    )
+    assert result.exit_code == exit_code
+    return out_file
+
+
+def protected_tlvs(img: bytes) -> dict:
+    _, _, hdr_size, prot_size, img_size = struct.unpack_from('<IIHHI', img)
+    off = hdr_size + img_size
+    magic, tot = struct.unpack_from('<HH', img, off)
+    assert magic == TLV_PROT_INFO_MAGIC
+    assert tot == prot_size
+    tlvs = {}
+    pos = off + 4
+    while pos < off + tot:
+        kind, length = struct.unpack_from('<HH', img, pos)
+        tlvs[kind] = img[pos + 4:pos + 4 + length]
+        pos += 4 + length
+    return tlvs
+
+
+def test_ram_load_segments(tmpdir: Path, key_file: Path):
+    """Check the segment table, flags and load address of an image."""
+    out_file = sign(tmpdir, key_file, '--ram-load-segment=0x100:0x800',
+                    '--ram-load-segment=0x20000000:0x400',
+                    '--ram-load-segment=0x30000000')
+    with out_file.open("rb") as f:
+        img = f.read()
+
+    load_addr, = struct.unpack_from('<I', img, 4)
+    flags, = struct.unpack_from('<I', img, 16)
+    assert flags & IMAGE_F['RAM_LOAD_SEGMENTS']
+    assert not flags & IMAGE_F['RAM_LOAD']
+    assert load_addr == 0x100 - HEADER_SIZE + (1 << 32)
+
+    table = protected_tlvs(img)[TLV_VALUES['RAM_LOAD_SEGMENTS']]
+    assert list(struct.iter_unpack('<II', table)) == [
+        (0x100, 0x800), (0x20000000, 0x400),
+        (0x30000000, len(PAYLOAD) - 0xc00)]
+
+    result = CliRunner().invoke(imgtool, ['verify', f'--key={key_file}',
+                                          str(out_file)])
+    assert result.exit_code == 0
+
+
+@pytest.mark.parametrize('args', [
+    ['--ram-load-segment=0x1000:0x100'],
+    ['--ram-load-segment=0x1000', '--ram-load-segment=0x2000:0x100'],
+    ['--ram-load-segment=0x1000:0x10000'],
+    ['--ram-load-segment=0x1000', '--load-addr=0x1000'],
+    ['--ram-load-segment=0x1000', '--hash-chunk-size=0x100'],
+    ['--ram-load-segment=0x1000:0'],
+    ['--ram-load-segment=0x1000:0x100:0x100'],
+])
+def test_ram_load_segments_invalid(tmpdir: Path, key_file: Path, args):
+    """Check that segments must exactly cover the payload of a plain image."""
+    sign(tmpdir, key_file, *args, exit_code=2)
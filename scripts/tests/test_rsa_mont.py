@@ -0,0 +1,68 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import io
+import re
+
+import pytest
+
+from imgtool import rsa_mont as mont
+
+# Product of two primes, large enough to need every word of a 2048-bit key.
+N_2048 = (2 ** 1023 + 1155) * (2 ** 1024 - 105)
+
+
+def from_words(words):
+    return sum(w << (32 * i) for i, w in enumerate(words))
+
+
+def mont_mul(a, b, n, k):
+    """Reference Montgomery product a * b / R mod n, R = 2^(32 * k)."""
+    return a * b * pow(2, -32 * k, n) % n
+
+
+@pytest.mark.parametrize('bits', [2048, 3072])
+def test_mont_params(bits):
+    n = N_2048 if bits == 2048 else N_2048 * (2 ** 1023 + 1155) | 1
+    n_words, rr_words, n0inv = mont.mont_params(n, bits)
+    k = bits // 32
+    assert len(n_words) == len(rr_words) == k
+    assert from_words(n_words) == n
+    assert from_words(rr_words) == pow(2, 64 * k, n)
+    assert (n * n0inv + 1) % (1 << 32) == 0
+
+    # s^65537 as computed by bootutil through Montgomery products.
+    s = 0x1234567890abcdef ** 20 % n
+    a = mont_mul(s, from_words(rr_words), n, k)
+    for _ in range(16):
+        a = mont_mul(a, a, n, k)
+    assert mont_mul(a, s, n, k) == pow(s, 65537, n)
+
+
+def test_mont_params_invalid():
+    with pytest.raises(ValueError):
+        mont.mont_params(N_2048 + 1, 2048)
+    with pytest.raises(ValueError):
+        mont.mont_params(N_2048, 1024)
+
+
+def test_emit_c_mont():
+    out = io.StringIO()
+    mont.emit_c_mont('test_mont', N_2048, 2048, out)
+    text = out.getvalue()
+    assert text.startswith('const struct bootutil_rsa_mont test_mont = {')
+    words = re.findall(r'0x[0-9a-f]{8}', text)
+    assert len(words) == 64 + 64 + 1
+    # Least significant word first.
+    assert int(words[0], 16) == N_2048 & 0xffffffff
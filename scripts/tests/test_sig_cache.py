@@ -0,0 +1,65 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+
+from imgtool.main import imgtool
+
+KEYS = Path(__file__).parents[2]
+
+
+def sign(tmpdir: Path, key_file: Path, name: str, *args):
+    in_file = tmpdir / 'zephyr.bin'
+    with in_file.open("wb") as f:
+        f.write(bytes(range(256)) * 20)
+    out_file = tmpdir / name
+    runner = CliRunner()
+    result = runner.invoke(imgtool, [
+        'sign', '--header-size=0x200', '--slot-size=0x7a000', '--pad-header',
+        f'--key={key_file}', f'--sig-cache={tmpdir / "cache"}', *args,
+        str(in_file), str(out_file)])
+    assert result.exit_code == 0
+    result = runner.invoke(imgtool, ['verify', f'--key={key_file}',
+                                     str(out_file)])
+    assert result.exit_code == 0
+    return out_file.read_binary()
+
+
+@pytest.mark.parametrize('key', ['root-ec-p256.pem', 'root-rsa-2048.pem',
+                                 'root-ed25519.pem'])
+def test_sig_cache(tmpdir: Path, key: str):
+    """Check that re-signing an unchanged image takes the signature from
+    the cache, so that the output is identical even for randomized
+    signatures, and that changed images get a new signature."""
+    first = sign(tmpdir, KEYS / key, 'first.bin', '--version=1.0.0')
+    second = sign(tmpdir, KEYS / key, 'second.bin', '--version=1.0.0')
+    assert first == second
+    assert len(list((tmpdir / "cache").listdir())) == 1
+
+    sign(tmpdir, KEYS / key, 'third.bin', '--version=1.0.1')
+    assert len(list((tmpdir / "cache").listdir())) == 2
+
+
+def test_sig_cache_corrupted(tmpdir: Path):
+    """Check that a corrupted cache entry is replaced."""
+    key_file = KEYS / 'root-ec-p256.pem'
+    sign(tmpdir, key_file, 'first.bin', '--version=1.0.0')
+    entry, = (tmpdir / "cache").listdir()
+    entry.write_binary(b'\x30\x06' + bytes(6))
+
+    sign(tmpdir, key_file, 'second.bin', '--version=1.0.0')
+    assert entry.read_binary() != b'\x30\x06' + bytes(6)
@@ -0,0 +1,71 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import json
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+
+from imgtool.main import imgtool
+
+KEY = Path(__file__).parents[2] / 'root-ec-p256.pem'
+VERSIONS = ['1.0.0', '1.2.3', '2.0.0+7']
+
+
+def write_images(tmpdir: Path):
+    images = []
+    for i, version in enumerate(VERSIONS):
+        in_file = tmpdir / 'image{}.bin'.format(i)
+        with in_file.open("wb") as f:
+            f.write(bytes([i]) * (1000 + i * 300))
+        images.append({'infile': str(in_file),
+                       'outfile': str(tmpdir / 'image{}_signed.bin'.format(i)),
+                       'version': version})
+    return images
+
+
+def sign_batch(tmpdir: Path, images, *args):
+    manifest = tmpdir / 'manifest.json'
+    with manifest.open("w") as f:
+        json.dump({'defaults': {'key': str(KEY), 'header-size': '0x200',
+                                'slot-size': '0x7a000', 'pad-header': True},
+                   'images': images}, f)
+    runner = CliRunner()
+    return runner.invoke(imgtool, ['sign-batch', *args, str(manifest)])
+
+
+@pytest.mark.parametrize('jobs', ['1', '2'])
+def test_sign_batch(tmpdir: Path, jobs):
+    """Check that every image of the manifest is signed and verifies."""
+    images = write_images(tmpdir)
+    result = sign_batch(tmpdir, images, '-j', jobs)
+    assert result.exit_code == 0
+
+    runner = CliRunner()
+    for image in images:
+        result = runner.invoke(imgtool, ['verify', f'--key={KEY}',
+                                         image['outfile']])
+        assert result.exit_code == 0
+
+
+def test_sign_batch_failure(tmpdir: Path):
+    """Check that a failing image fails the batch but not the others."""
+    images = write_images(tmpdir)
+    images[1]['slot-size'] = '0x100'
+    result = sign_batch(tmpdir, images, '-j', '1')
+    assert result.exit_code != 0
+    assert Path(images[0]['outfile']).exists()
+    assert not Path(images[1]['outfile']).exists()
+    assert Path(images[2]['outfile']).exists()
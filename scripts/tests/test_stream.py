@@ -0,0 +1,129 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import struct
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+
+from imgtool import image
+from imgtool.main import imgtool
+
+VERSION = '1.2.3'
+HEADER_SIZE = 0x200
+SLOT_SIZE = 0x7a000
+KEYS = Path(__file__).parents[2]
+
+
+def sign(tmpdir: Path, payload: bytes, name: str, *args, exit_code=0):
+    in_file = tmpdir / 'zephyr.bin'
+    with in_file.open("wb") as f:
+        f.write(payload)
+    out_file = tmpdir / name
+
+    runner = CliRunner()
+    result = runner.invoke(
+        imgtool,
+        [
+            'sign',
+            str(in_file),
+            str(out_file),
+            f'--header-size={HEADER_SIZE}',
+            f'--slot-size={SLOT_SIZE}',
+            f'--version={VERSION}',
+            '--pad-header',
+            *args
+        ],
+    )
+    assert result.exit_code == exit_code
+    return out_file
+
+
+def verify(out_file: Path, key_file: Path):
+    runner = CliRunner()
+    return runner.invoke(imgtool, ['verify', f'--key={key_file}',
+                                   str(out_file)])
+
+
+@pytest.mark.parametrize('args', [
+    [],
+    ['--pad', '--confirm'],
+    ['--hash-chunk-size=1000'],
+    ['--security-counter=5', '-d', '(1, 1.2.3+0)'],
+    ['--ram-load-segment=0x20000000:0x1000',
+     '--ram-load-segment=0x20010000'],
+    ['--layout-align=0x100'],
+    ['--layout-align=0x200', '--hash-chunk-size=1000',
+     '--sector-digest-size=0x400'],
+])
+def test_stream_same_output(tmpdir: Path, monkeypatch, args):
+    """Check that a streamed unsigned image is the same as a loaded one,
+    also over several blocks."""
+    monkeypatch.setattr(image, 'STREAM_BLOCK_SIZE', 0x1000)
+    payload = bytes(range(256)) * 100 + b'tail'
+    loaded = sign(tmpdir, payload, 'loaded.bin', *args)
+    streamed = sign(tmpdir, payload, 'streamed.bin', '--stream', *args)
+
+    assert loaded.read_binary() == streamed.read_binary()
+
+
+@pytest.mark.parametrize('key, args', [
+    ('root-ec-p256.pem', []),
+    ('root-ec-p384.pem', []),
+    ('root-rsa-2048.pem', []),
+    ('root-ed25519.pem', []),
+    ('root-ec-p256.pem', ['--hash-chunk-size=4096']),
+    ('root-ec-p256.pem', ['--encrypt', str(KEYS / 'enc-ec256-pub.pem'),
+                          '--clear']),
+])
+def test_stream_sign_verify(tmpdir: Path, monkeypatch, key, args):
+    """Check that streamed images verify."""
+    monkeypatch.setattr(image, 'STREAM_BLOCK_SIZE', 0x1000)
+    out_file = sign(tmpdir, bytes(range(256)) * 100, 'streamed.bin',
+                    '--stream', f'--key={KEYS / key}', *args)
+
+    result = verify(out_file, KEYS / key)
+    assert result.exit_code == 0
+
+
+@pytest.mark.parametrize('args', [
+    ['--compression=lzma2'],
+    ['--vector-to-sign=digest'],
+])
+def test_stream_unsupported(tmpdir: Path, args):
+    """Check that options needing the whole payload are refused."""
+    sign(tmpdir, bytes(256), 'streamed.bin', '--stream', *args, exit_code=2)
+
+
+@pytest.mark.parametrize('align', [0x20, 0x200])
+def test_layout_align(tmpdir: Path, align: int):
+    """Check that the payload is padded for the TLV area to start on the
+    layout boundary, and that the header size must be aligned."""
+    payload = bytes(range(256)) * 100 + b'tail'
+    out_file = sign(tmpdir, payload, 'aligned.bin', f'--layout-align={align}')
+    data = out_file.read_binary()
+    img_size, = struct.unpack_from('<I', data, 12)
+    assert img_size >= len(payload)
+    assert (HEADER_SIZE + img_size) % align == 0
+    assert data[HEADER_SIZE:HEADER_SIZE + img_size] == \
+        payload + bytes(img_size - len(payload))
+    result = CliRunner().invoke(imgtool, ['verify', str(out_file)])
+    assert result.exit_code == 0
+
+    sign(tmpdir, payload, 'unaligned.bin', '--layout-align=0x400',
+         exit_code=2)
+    sign(tmpdir, payload, 'unaligned.bin', '--layout-align=0x300',
+         exit_code=2)
+
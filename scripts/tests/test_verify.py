@@ -0,0 +1,85 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+
+from imgtool import image
+from imgtool.main import imgtool, load_key
+
+KEY = Path(__file__).parents[2] / 'root-rsa-2048.pem'
+
+
+def sign_images(tmpdir: Path, count: int, *args):
+    outfiles = []
+    runner = CliRunner()
+    for i in range(count):
+        in_file = tmpdir / 'in{}.bin'.format(i)
+        with in_file.open("wb") as f:
+            f.write(bytes(range(256)) * (40 + i * 30))
+        out_file = tmpdir / 'out{}.bin'.format(i)
+        result = runner.invoke(imgtool, [
+            'sign', '--header-size=0x200', '--slot-size=0x7a000',
+            '--pad-header', f'--key={KEY}', '--version=1.0.{}'.format(i),
+            *args, str(in_file), str(out_file)])
+        assert result.exit_code == 0
+        outfiles.append(out_file)
+    return outfiles
+
+
+@pytest.mark.parametrize('args', [[], ['--hash-chunk-size=0x400'],
+                                  ['--sector-digest-size=0x100']])
+def test_verify_stream(tmpdir: Path, args):
+    """Check that the block-wise verification agrees with verify()."""
+    key = load_key(str(KEY))
+    out_file, = sign_images(tmpdir, 1, *args)
+    assert (image.Image.verify_stream(str(out_file), key) ==
+            image.Image.verify(str(out_file), key))
+
+    with out_file.open("r+b") as f:
+        f.seek(0x1000)
+        f.write(b'\xff')
+    ret, _, _ = image.Image.verify_stream(str(out_file), key)
+    assert ret == image.VerifyResult.INVALID_HASH
+
+
+@pytest.mark.parametrize('jobs', ['1', '3'])
+def test_verify_many(tmpdir: Path, jobs):
+    """Check that several images are verified and timed."""
+    outfiles = sign_images(tmpdir, 3)
+    runner = CliRunner()
+    result = runner.invoke(imgtool, ['verify', f'--key={KEY}', '-j', jobs,
+                                     '--timing', *map(str, outfiles)])
+    assert result.exit_code == 0
+    for out_file in outfiles:
+        assert f'{out_file}: Image was correctly validated' in result.output
+        assert f'{out_file}: Verification time:' in result.output
+
+
+def test_verify_many_failure(tmpdir: Path):
+    """Check that a bad image fails the command but not the others."""
+    outfiles = sign_images(tmpdir, 2)
+    with outfiles[0].open("r+b") as f:
+        f.seek(0x300)
+        f.write(b'\xff')
+    runner = CliRunner()
+    result = runner.invoke(imgtool, ['verify', f'--key={KEY}',
+                                     *map(str, outfiles),
+                                     str(tmpdir / 'missing.bin')])
+    assert result.exit_code != 0
+    assert f'{outfiles[0]}: Image has an invalid hash' in result.output
+    assert f'{outfiles[1]}: Image was correctly validated' in result.output
+    assert 'missing.bin: Image file' in result.output
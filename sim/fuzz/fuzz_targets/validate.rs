@@ -0,0 +1,19 @@
+// Copyright (c) 2026, NOWATCH BV
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#![no_main]
+
+use bootsim::{FuzzTarget, Fuzzer};
+use libfuzzer_sys::fuzz_target;
+use std::cell::RefCell;
+
+thread_local! {
+    static FUZZER: RefCell<Fuzzer> = RefCell::new(Fuzzer::new(FuzzTarget::Validate));
+}
+
+fuzz_target!(|data: &[u8]| {
+    FUZZER.with(|fuzzer| {
+        fuzzer.borrow_mut().run(data);
+    });
+});
@@ -19,7 +19,10 @@ fn main() {
     let sig_p384 = env::var("CARGO_FEATURE_SIG_P384").is_ok();
     let sig_ed25519 = env::var("CARGO_FEATURE_SIG_ED25519").is_ok();
     let overwrite_only = env::var("CARGO_FEATURE_OVERWRITE_ONLY").is_ok();
+    let overwrite_resume = env::var("CARGO_FEATURE_OVERWRITE_RESUME").is_ok();
+    let overwrite_verify_copy = env::var("CARGO_FEATURE_OVERWRITE_VERIFY_COPY").is_ok();
     let swap_move = env::var("CARGO_FEATURE_SWAP_MOVE").is_ok();
+    let swap_offset = env::var("CARGO_FEATURE_SWAP_OFFSET").is_ok();
     let validate_primary_slot =
                   env::var("CARGO_FEATURE_VALIDATE_PRIMARY_SLOT").is_ok();
     let enc_rsa = env::var("CARGO_FEATURE_ENC_RSA").is_ok();
@@ -31,20 +34,44 @@ fn main() {
     let enc_aes256_ec256 = env::var("CARGO_FEATURE_ENC_AES256_EC256").is_ok();
     let enc_x25519 = env::var("CARGO_FEATURE_ENC_X25519").is_ok();
     let enc_aes256_x25519 = env::var("CARGO_FEATURE_ENC_AES256_X25519").is_ok();
+    let enc_wrapped_key = env::var("CARGO_FEATURE_ENC_WRAPPED_KEY").is_ok();
     let bootstrap = env::var("CARGO_FEATURE_BOOTSTRAP").is_ok();
+    let bootstrap_verify_copy = env::var("CARGO_FEATURE_BOOTSTRAP_VERIFY_COPY").is_ok();
     let multiimage = env::var("CARGO_FEATURE_MULTIIMAGE").is_ok();
     let downgrade_prevention = env::var("CARGO_FEATURE_DOWNGRADE_PREVENTION").is_ok();
     let ram_load = env::var("CARGO_FEATURE_RAM_LOAD").is_ok();
     let direct_xip = env::var("CARGO_FEATURE_DIRECT_XIP").is_ok();
     let max_align_32 = env::var("CARGO_FEATURE_MAX_ALIGN_32").is_ok();
     let hw_rollback_protection = env::var("CARGO_FEATURE_HW_ROLLBACK_PROTECTION").is_ok();
+    let hash_pipeline = env::var("CARGO_FEATURE_HASH_PIPELINE").is_ok();
+    let copy_pipeline = env::var("CARGO_FEATURE_COPY_PIPELINE").is_ok();
+    let flash_area_copy = env::var("CARGO_FEATURE_FLASH_AREA_COPY").is_ok();
+    let sector_runs = env::var("CARGO_FEATURE_SECTOR_RUNS").is_ok();
+    let swap_skip_unchanged = env::var("CARGO_FEATURE_SWAP_SKIP_UNCHANGED").is_ok();
+    let swap_perm_discard = env::var("CARGO_FEATURE_SWAP_PERM_DISCARD").is_ok();
+    let copy_verify = env::var("CARGO_FEATURE_COPY_VERIFY").is_ok();
+    let tlv_index = env::var("CARGO_FEATURE_TLV_INDEX").is_ok();
+    let key_hash_cache = env::var("CARGO_FEATURE_KEY_HASH_CACHE").is_ok();
+    let ecdsa_comb = env::var("CARGO_FEATURE_ECDSA_COMB").is_ok();
+    let rsa_mont = env::var("CARGO_FEATURE_RSA_MONT").is_ok();
+    let sha256_fast = env::var("CARGO_FEATURE_SHA256_FAST").is_ok();
+    let crypto_arena = env::var("CARGO_FEATURE_CRYPTO_ARENA").is_ok();
+    let curve25519_fixed_der = env::var("CARGO_FEATURE_CURVE25519_FIXED_DER").is_ok();
+    let skip_erased_sectors = env::var("CARGO_FEATURE_SKIP_ERASED_SECTORS").is_ok();
+    let large_flash = env::var("CARGO_FEATURE_LARGE_FLASH").is_ok();
+    let serial_recovery = env::var("CARGO_FEATURE_SERIAL_RECOVERY").is_ok();
 
     let mut conf = CachedBuild::new();
     conf.conf.define("__BOOTSIM__", None);
     conf.conf.define("MCUBOOT_HAVE_LOGGING", None);
     conf.conf.define("MCUBOOT_USE_FLASH_AREA_GET_SECTORS", None);
     conf.conf.define("MCUBOOT_HAVE_ASSERT_H", None);
-    conf.conf.define("MCUBOOT_MAX_IMG_SECTORS", Some("128"));
+    if large_flash {
+        // Enough for the 16 MB slots with 4 KB sectors of the large devices.
+        conf.conf.define("MCUBOOT_MAX_IMG_SECTORS", Some("4096"));
+    } else {
+        conf.conf.define("MCUBOOT_MAX_IMG_SECTORS", Some("128"));
+    }
 
     if max_align_32 {
         conf.conf.define("MCUBOOT_BOOT_MAX_ALIGN", Some("32"));
@@ -63,6 +90,13 @@ fn main() {
         conf.conf.define("MCUBOOT_OVERWRITE_ONLY_FAST", None);
     }
 
+    if bootstrap_verify_copy {
+        if !bootstrap || overwrite_only || !validate_primary_slot {
+            panic!("Bootstrap verify copy requires bootstrap, a swap mode and validate primary slot");
+        }
+        conf.conf.define("MCUBOOT_BOOTSTRAP_VERIFY_COPY", None);
+    }
+
     if validate_primary_slot {
         conf.conf.define("MCUBOOT_VALIDATE_PRIMARY_SLOT", None);
     }
@@ -79,6 +113,53 @@ fn main() {
         conf.conf.define("MCUBOOT_DIRECT_XIP", None);
     }
 
+    if hash_pipeline {
+        // Use a small buffer so that blocks regularly straddle the header,
+        // payload and TLV boundaries.
+        conf.conf.define("MCUBOOT_HASH_PIPELINE", None);
+        conf.conf.define("MCUBOOT_HASH_PIPELINE_BUF_SIZE", Some("96"));
+    }
+
+    if copy_pipeline {
+        // Use a small buffer so that every sector is copied in several
+        // chunks, and chunks straddle the header and TLV boundaries.
+        conf.conf.define("MCUBOOT_COPY_PIPELINE", None);
+        conf.conf.define("MCUBOOT_COPY_BUF_SIZE", Some("96"));
+    }
+
+    if flash_area_copy {
+        conf.conf.define("MCUBOOT_FLASH_AREA_COPY", None);
+    }
+
+    if sector_runs {
+        conf.conf.define("MCUBOOT_SECTOR_RUNS", None);
+    }
+
+    if swap_skip_unchanged {
+        conf.conf.define("MCUBOOT_SWAP_SKIP_UNCHANGED", None);
+    }
+
+    if swap_perm_discard {
+        conf.conf.define("MCUBOOT_SWAP_PERM_DISCARD", None);
+    }
+
+    if copy_verify {
+        conf.conf.define("MCUBOOT_COPY_VERIFY", None);
+    }
+
+    if tlv_index {
+        conf.conf.define("MCUBOOT_TLV_INDEX", None);
+    }
+
+    if key_hash_cache {
+        conf.conf.define("MCUBOOT_KEY_HASH_CACHE", None);
+        conf.conf.define("MCUBOOT_KEY_CONTEXT_CACHE", None);
+    }
+
+    if skip_erased_sectors {
+        conf.conf.define("MCUBOOT_SKIP_ERASED_SECTORS", None);
+    }
+
     if hw_rollback_protection {
         conf.conf.define("MCUBOOT_HW_ROLLBACK_PROT", None);
         conf.file("csupport/security_cnt.c");
@@ -174,6 +255,10 @@ fn main() {
         conf.file("../../ext/mbedtls/library/asn1parse.c");
         conf.file("../../ext/mbedtls/library/md.c");
 
+        if rsa_mont {
+            conf.conf.define("MCUBOOT_RSA_MONT", None);
+            conf.file("../../boot/bootutil/src/rsa_mont.c");
+        }
     } else if sig_ecdsa {
         conf.conf.define("MCUBOOT_SIGN_EC256", None);
         conf.conf.define("MCUBOOT_USE_TINYCRYPT", None);
@@ -192,6 +277,11 @@ fn main() {
         conf.file("../../ext/tinycrypt/lib/source/ecc_platform_specific.c");
         conf.file("../../ext/mbedtls/library/platform_util.c");
         conf.file("../../ext/mbedtls/library/asn1parse.c");
+
+        if ecdsa_comb {
+            conf.conf.define("MCUBOOT_ECDSA_P256_COMB", None);
+            conf.file("../../boot/bootutil/src/ecdsa_p256_comb.c");
+        }
     } else if sig_ecdsa_mbedtls {
         conf.conf.define("MCUBOOT_SIGN_EC256", None);
         conf.conf.define("MCUBOOT_USE_MBED_TLS", None);
@@ -253,8 +343,24 @@ fn main() {
         conf.conf.define("MCUBOOT_OVERWRITE_ONLY", None);
     }
 
+    if overwrite_resume {
+        if !overwrite_only {
+            panic!("overwrite-resume requires overwrite-only");
+        }
+        conf.conf.define("MCUBOOT_OVERWRITE_ONLY_RESUME", None);
+    }
+
+    if overwrite_verify_copy {
+        if !overwrite_only || overwrite_resume {
+            panic!("overwrite-verify-copy requires overwrite-only, without overwrite-resume");
+        }
+        conf.conf.define("MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY", None);
+    }
+
     if swap_move {
         conf.conf.define("MCUBOOT_SWAP_USING_MOVE", None);
+    } else if swap_offset {
+        conf.conf.define("MCUBOOT_SWAP_USING_OFFSET", None);
     } else if !overwrite_only && !direct_xip && !ram_load {
         conf.conf.define("CONFIG_BOOT_SWAP_USING_SCRATCH", None);
         conf.conf.define("MCUBOOT_SWAP_USING_SCRATCH", None);
@@ -330,7 +436,9 @@ fn main() {
         conf.conf.define("MCUBOOT_ENCRYPT_EC256", None);
         conf.conf.define("MCUBOOT_ENC_IMAGES", None);
         conf.conf.define("MCUBOOT_USE_TINYCRYPT", None);
-        conf.conf.define("MCUBOOT_SWAP_SAVE_ENCTLV", None);
+        if !enc_wrapped_key {
+            conf.conf.define("MCUBOOT_SWAP_SAVE_ENCTLV", None);
+        }
 
         conf.file("../../boot/bootutil/src/encrypted.c");
         conf.file("csupport/keys.c");
@@ -361,7 +469,9 @@ fn main() {
         conf.conf.define("MCUBOOT_ENCRYPT_EC256", None);
         conf.conf.define("MCUBOOT_ENC_IMAGES", None);
         conf.conf.define("MCUBOOT_USE_MBED_TLS", None);
-        conf.conf.define("MCUBOOT_SWAP_SAVE_ENCTLV", None);
+        if !enc_wrapped_key {
+            conf.conf.define("MCUBOOT_SWAP_SAVE_ENCTLV", None);
+        }
 
         conf.conf.include("../../ext/mbedtls/include");
 
@@ -383,7 +493,9 @@ fn main() {
         conf.conf.define("MCUBOOT_ENCRYPT_X25519", None);
         conf.conf.define("MCUBOOT_ENC_IMAGES", None);
         conf.conf.define("MCUBOOT_USE_TINYCRYPT", None);
-        conf.conf.define("MCUBOOT_SWAP_SAVE_ENCTLV", None);
+        if !enc_wrapped_key {
+            conf.conf.define("MCUBOOT_SWAP_SAVE_ENCTLV", None);
+        }
 
         conf.file("../../boot/bootutil/src/encrypted.c");
         conf.file("csupport/keys.c");
@@ -411,7 +523,9 @@ fn main() {
         conf.conf.define("MCUBOOT_ENCRYPT_X25519", None);
         conf.conf.define("MCUBOOT_ENC_IMAGES", None);
         conf.conf.define("MCUBOOT_USE_MBED_TLS", None);
-        conf.conf.define("MCUBOOT_SWAP_SAVE_ENCTLV", None);
+        if !enc_wrapped_key {
+            conf.conf.define("MCUBOOT_SWAP_SAVE_ENCTLV", None);
+        }
 
         conf.file("../../boot/bootutil/src/encrypted.c");
         conf.file("csupport/keys.c");
@@ -427,6 +541,10 @@ fn main() {
         conf.file("../../ext/mbedtls/library/sha512.c");
     }
 
+    if enc_wrapped_key {
+        conf.conf.define("MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY", None);
+    }
+
     if sig_rsa && enc_kw {
         conf.conf.define("MBEDTLS_CONFIG_FILE", Some("<config-rsa-kw.h>"));
     } else if sig_rsa || sig_rsa3072 || enc_rsa || enc_aes256_rsa {
@@ -461,11 +579,48 @@ fn main() {
     conf.file("../../boot/bootutil/src/swap_misc.c");
     conf.file("../../boot/bootutil/src/swap_scratch.c");
     conf.file("../../boot/bootutil/src/swap_move.c");
+    conf.file("../../boot/bootutil/src/swap_offset.c");
+    conf.file("../../boot/bootutil/src/swap_bank.c");
     conf.file("../../boot/bootutil/src/caps.c");
+    conf.file("../../boot/bootutil/src/delta.c");
+    conf.file("../../boot/bootutil/src/decompress.c");
+    conf.file("../../boot/bootutil/src/boot_profile.c");
     conf.file("../../boot/bootutil/src/bootutil_misc.c");
     conf.file("../../boot/bootutil/src/bootutil_public.c");
     conf.file("../../boot/bootutil/src/tlv.c");
     conf.file("../../boot/bootutil/src/fault_injection_hardening.c");
+    if sha256_fast {
+        conf.conf.define("MCUBOOT_SHA256_FAST", None);
+        conf.file("../../boot/bootutil/src/sha256_fast.c");
+    }
+    if crypto_arena {
+        conf.conf.define("MCUBOOT_CRYPTO_ARENA", None);
+        conf.file("../../boot/bootutil/src/crypto_arena.c");
+    }
+    if curve25519_fixed_der {
+        conf.conf.define("MCUBOOT_CURVE25519_FIXED_DER", None);
+    }
+    if serial_recovery {
+        if enc_rsa || enc_aes256_rsa || enc_kw || enc_aes256_kw || enc_ec256 ||
+            enc_ec256_mbedtls || enc_aes256_ec256 || enc_x25519 || enc_aes256_x25519 {
+            panic!("serial-recovery does not support image encryption");
+        }
+
+        // The framings and upload window compared by the serial benchmark.
+        conf.conf.define("MCUBOOT_SERIAL", None);
+        conf.conf.define("MCUBOOT_SERIAL_FAST_FRAMING", None);
+        conf.conf.define("MCUBOOT_SERIAL_RAW_FRAMING", None);
+        conf.conf.define("MCUBOOT_SERIAL_UPLOAD_WINDOW", Some("4"));
+        conf.conf.define("MCUBOOT_PERUSER_MGMT_GROUP_ENABLED", Some("0"));
+        conf.conf.include("../../boot/boot_serial/include");
+        conf.conf.include("../../boot/zcbor/include");
+        conf.file("../../boot/boot_serial/src/boot_serial.c");
+        conf.file("../../boot/boot_serial/src/boot_serial_framing.c");
+        conf.file("../../boot/boot_serial/src/zcbor_bulk.c");
+        conf.file("../../boot/zcbor/src/zcbor_common.c");
+        conf.file("../../boot/zcbor/src/zcbor_decode.c");
+        conf.file("../../boot/zcbor/src/zcbor_encode.c");
+    }
     conf.file("csupport/run.c");
     conf.conf.include("../../boot/bootutil/include");
     conf.conf.include("csupport");
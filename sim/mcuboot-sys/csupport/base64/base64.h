@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef H_BASE64_
+#define H_BASE64_
+
+/* The simulator builds serial recovery with MCUBOOT_SERIAL_FAST_FRAMING,
+ * which brings its own base64 codec.
+ */
+#define BASE64_ENCODE_SIZE(in_size) ((((((in_size) - 1) / 3) * 4) + 4) + 1)
+
+#endif
@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Mynewt BSP, none is needed by serial recovery in the simulator. */
+
+#ifndef H_BSP_
+#define H_BSP_
+
+#endif
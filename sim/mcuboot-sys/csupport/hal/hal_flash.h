@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* The flash is accessed through the flash map of the simulator. */
+
+#ifndef H_HAL_FLASH_
+#define H_HAL_FLASH_
+
+#endif
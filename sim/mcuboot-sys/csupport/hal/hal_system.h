@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef H_HAL_SYSTEM_
+#define H_HAL_SYSTEM_
+
+/* Ends the serial recovery run of the simulator, see invoke_boot_serial(). */
+void hal_system_reset(void);
+
+#endif
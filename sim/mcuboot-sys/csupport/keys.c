@@ -50,6 +50,48 @@ const unsigned char root_pub_der[] = {
     0xc9, 0x02, 0x03, 0x01, 0x00, 0x01
 };
 const unsigned int root_pub_der_len = 270;
+#ifdef MCUBOOT_RSA_MONT
+#include <bootutil/rsa_mont.h>
+const struct bootutil_rsa_mont root_pub_mont = {
+    .n = {
+        0x62e1d1c9, 0xefb14b2c, 0xd167c647, 0xaf5c3aa7,
+        0xfa0d119d, 0x666435ec, 0xdcce681b, 0x59f81cab,
+        0xf81a2466, 0x1a1dfee8, 0xab873e93, 0x692723f3,
+        0x8217f28a, 0x31ad5fb0, 0x4cc88881, 0x5818f65e,
+        0x2bd0d308, 0x54f43ee1, 0xe0fa8237, 0x2abeafb8,
+        0xfeb8cefa, 0xa76a9df9, 0xa3aed20f, 0x1339833f,
+        0xffb7fdf3, 0xe4530d2f, 0x85d55c4a, 0x3ec80ed7,
+        0xf8656e64, 0x896924fb, 0xbe7b7221, 0xdb7773d4,
+        0x7eb7e115, 0x35ca6261, 0x4baa8d38, 0xc3776754,
+        0x7e473c94, 0xb4a9c888, 0x6fe75bba, 0xf8cf3d1e,
+        0x5c14dff2, 0xac414d9e, 0x698c2f5f, 0xb43c10e6,
+        0x2849a701, 0x4160ed15, 0x840baa77, 0x99dfe04d,
+        0x5ceeecb3, 0x080f0dbb, 0x2c44d167, 0x435e0d57,
+        0x7f10537e, 0xdb42e78c, 0xcbf3bc74, 0xf09c341b,
+        0x188019f9, 0xd35ae96d, 0xaad24b18, 0xbbee5ef9,
+        0x0da34f1f, 0xe8fbfdf7, 0x18442c18, 0xd106081a,
+    },
+    .rr = {
+        0xa46d7e40, 0x61d887b3, 0x1af6c61d, 0xa0bf6f48,
+        0xb8cec2e8, 0x6f6895e7, 0x723eaea3, 0x9f4cf49b,
+        0xc1648e24, 0x4933b156, 0xb620cc9e, 0x6a3d596a,
+        0xd7607b1c, 0xb9c7f122, 0x05a7314e, 0xfabdabfa,
+        0xb7ee0465, 0x9d9422c6, 0x7760b779, 0x7ef32296,
+        0xc25d8581, 0xa71a32cb, 0xfa31586c, 0xed49b341,
+        0x5249dd8c, 0xdae158dc, 0x936a5cd7, 0x2fb58c91,
+        0x1f617238, 0xf4c40bbe, 0xfc9ef774, 0xbb62bd84,
+        0xba88107e, 0xef1a0c45, 0x52124603, 0x6557f87a,
+        0x9c26779b, 0x05863028, 0x35875518, 0xf9b8d106,
+        0x51c66c09, 0x7941f544, 0xbcf6f070, 0x39b53706,
+        0x3166a931, 0xc97f93f7, 0x23f7bd3a, 0x5edb8506,
+        0xabe50eda, 0xfc98167d, 0xa4ca5244, 0xf93f6a95,
+        0x447cd5a9, 0x15ef7110, 0xa57c2d5e, 0x2e5d61f4,
+        0x613d3217, 0x4ff52cce, 0xafe3f5e1, 0x696f8e30,
+        0x1ef051f7, 0x006e298c, 0xb97f1d14, 0xa920a3e8,
+    },
+    .n0inv = 0x80aee787,
+};
+#endif
 #elif MCUBOOT_SIGN_RSA_LEN == 3072
 #define HAVE_KEYS
 const unsigned char root_pub_der[] = {
@@ -105,6 +147,64 @@ const unsigned char root_pub_der[] = {
     0x3b, 0x02, 0x03, 0x01, 0x00, 0x01,
 };
 const unsigned int root_pub_der_len = 398;
+#ifdef MCUBOOT_RSA_MONT
+#include <bootutil/rsa_mont.h>
+const struct bootutil_rsa_mont root_pub_mont = {
+    .n = {
+        0xe673de3b, 0x6374ac5a, 0x2daf9366, 0xb57bd3b0,
+        0x6e886591, 0x8a18cf23, 0xd99f0717, 0xb565dd01,
+        0x2b0ef881, 0xf55fafe7, 0x0162fff7, 0x060a81f3,
+        0x6d8c4374, 0xad01cab7, 0x4a05751f, 0xe69df40c,
+        0x23305736, 0x52e89637, 0xf7fa65dd, 0xa0a094c8,
+        0x1f0dd01e, 0xcf150880, 0xac2a22f4, 0x5985ee85,
+        0x5872a4b0, 0x99bfac68, 0x019ce70c, 0xb0f3f683,
+        0xb1517c12, 0x1d1bff1a, 0xd1ea1a40, 0x06eedcbe,
+        0xa77eda87, 0x6a7751eb, 0xa4094fa5, 0x768c6b94,
+        0x1122fb7f, 0xe819fd2f, 0x5b82e77a, 0x9a6fcbbb,
+        0xe7cac4f8, 0xb37cc3fb, 0x6f7babb7, 0xb2aa5a6c,
+        0x30089c4d, 0x4485cc73, 0xd473338d, 0x936cd7bf,
+        0xcea4a8ca, 0x25f88dbe, 0x8e87ee60, 0x51665e99,
+        0xada7f63a, 0x9be41ce8, 0x96edcfb3, 0x131b172e,
+        0xa8ba7a80, 0xb69acde5, 0x226c5e61, 0x671fc86e,
+        0x78e5be47, 0xd3b4cc2f, 0x2502aa00, 0x4e68b2e0,
+        0x7e9c9bba, 0xd24e570c, 0xadc2e1a5, 0x6fd1154f,
+        0xa72b1325, 0x04da8c34, 0x76dd5f54, 0x36804938,
+        0xf949db78, 0x6ecc85ed, 0xf91000d8, 0x72463f8b,
+        0x5cfd7305, 0xad870083, 0xb8a71d44, 0x7e72d37a,
+        0x574bde0f, 0x8c229e71, 0xf4ef2a8f, 0x15688c1a,
+        0x8173bf6e, 0x228b2d4e, 0xaaa68a63, 0xea7bb115,
+        0x25e5d296, 0x45c87126, 0x1a34205d, 0x3433f896,
+        0xdd082a28, 0x58997c01, 0x5810a4a7, 0xb42c0e98,
+    },
+    .rr = {
+        0xa04638d4, 0x3a879048, 0x7ca61b2d, 0xe0dd6259,
+        0x55123fc5, 0x2ef5deec, 0x9ac7688c, 0x8a5bb339,
+        0x04083dcf, 0xfba082e4, 0xf5bd5f21, 0x3bc0bb80,
+        0x0508b168, 0xd326e831, 0x1a3e396d, 0x00bf7fe1,
+        0xc536bc01, 0x42b332aa, 0xfe4cab9d, 0x7d5a6a66,
+        0x032bca90, 0xa5a3c4a7, 0xb729a6a8, 0x2d602549,
+        0xd5bc2223, 0x3187a304, 0x4af6e591, 0x9bdbafc1,
+        0xf13c6f69, 0xb9734cc0, 0x6655e882, 0x9d2fb3b0,
+        0xd3102df5, 0x33cd4027, 0x94e72bb3, 0x7c55230a,
+        0x9ab167b2, 0x1d4fedc3, 0xd8a83c6f, 0x54ec8329,
+        0xd5eeb4d1, 0xed2a7bec, 0x91db40c5, 0x16d3274a,
+        0xdc805893, 0xbbb2332b, 0x1868df5b, 0xcd0b6e0a,
+        0x798003c8, 0x84f4f932, 0xb098e8d7, 0x498fc166,
+        0xaeefc41f, 0xf000fe77, 0x93c44eee, 0x95bcfe91,
+        0x60f5867d, 0x07a09792, 0x238701a7, 0x0e499545,
+        0x3e9d92e1, 0xbb075158, 0x54715f22, 0xf7726675,
+        0x47489602, 0x4e2c2bea, 0xd14cbd50, 0xbd60e1fb,
+        0x82da2bec, 0x997052d1, 0x7e2762df, 0x85aa9f1c,
+        0xaf38710c, 0x14a5c5c5, 0xd61e9416, 0xf991dbbc,
+        0xc3d2506c, 0x9dc4db1b, 0xc77bb7fe, 0x4a34329a,
+        0x2b966e7b, 0xd30b11c5, 0xeb1328d3, 0xb239db53,
+        0x8a8295d9, 0x29598798, 0x504c872d, 0x65fa9b83,
+        0x184b19fc, 0xb1db1fcf, 0x43751595, 0x3d4338f5,
+        0x62862673, 0x0717ef99, 0xa6d2f092, 0x0b940021,
+    },
+    .n0inv = 0x8a1ab50d,
+};
+#endif
 #endif
 #elif defined(MCUBOOT_SIGN_EC256) || \
       defined(MCUBOOT_SIGN_EC384)
@@ -124,6 +224,103 @@ const unsigned char root_pub_der[] = {
     0x8b, 0x68, 0x34, 0xcc, 0x3a, 0x6a, 0xfc, 0x53,
     0x8e, 0xfa, 0xc1, };
 const unsigned int root_pub_der_len = 91;
+#ifdef MCUBOOT_ECDSA_P256_COMB
+#include <bootutil/ecdsa_comb.h>
+const struct bootutil_ecdsa_comb root_pub_comb = {
+    .points = {
+        {
+            0x953988d9, 0x245737e5, 0xcd14fb2f, 0xdbbe1937,
+            0xa91daee8, 0xa44995a1, 0xe8feed5b, 0x2acb403c,
+            0x538efac1, 0xcc3a6afc, 0x7d8b6834, 0x810ee5f0,
+            0x48b24a6a, 0x308ad6fe, 0xebd7cdd5, 0x94b9d65a,
+        },
+        {
+            0xe0de8d08, 0x37fea77a, 0x9076f87e, 0xb938819c,
+            0xa4bfdff6, 0xdd08fdc4, 0xf1c49e0c, 0x401412b1,
+            0x448d02f8, 0x75e15e4d, 0x254c59c4, 0x24873c84,
+            0xfcb34a59, 0x7b5acd96, 0x410fd69b, 0x18ffada2,
+        },
+        {
+            0x095d6404, 0xba51091c, 0x9f5254fe, 0xb685c3a2,
+            0x8b1a64a2, 0x6f8f80b3, 0xe94b8a0f, 0xff9dbd73,
+            0x87570ff8, 0x3d94ab64, 0x56e63864, 0x5e09893c,
+            0x6cf48f1f, 0xae04a2e4, 0x29b33c7c, 0x99ddb9bd,
+        },
+        {
+            0x738420b4, 0xae87634a, 0x19c0ac3d, 0x66496f5d,
+            0x809e6750, 0x05175d0d, 0x3c83bbb4, 0x47e47a7f,
+            0x3e35f56a, 0xcc4500c5, 0xb1faa36b, 0xe0631d97,
+            0xbe69873b, 0x27e5368e, 0xfd6d8809, 0x82980e0b,
+        },
+        {
+            0x924f9052, 0xa4ddec1d, 0xda3736ca, 0x1770297b,
+            0x7d33c259, 0xd98d2055, 0x8d6ce20e, 0x0e7b50af,
+            0x86bcb5ab, 0xe4057c36, 0xb8930865, 0xea27dfbb,
+            0x24602491, 0x9585c0dd, 0xfa8ea176, 0xbbae20ef,
+        },
+        {
+            0xc1f348ab, 0x641330fe, 0xe7f6cc50, 0x12776b49,
+            0x75752b58, 0x85f09c08, 0x8c2566df, 0x3e46097f,
+            0xe74cc68a, 0x9cbf86bf, 0x34716214, 0xb72114a7,
+            0xc6713faa, 0x83dc4fe4, 0x141fea38, 0x059cedb5,
+        },
+        {
+            0xbb3bf62d, 0x7ac59335, 0xdc947607, 0x32d5ddc4,
+            0xef2c11d0, 0x5118a6b3, 0x3b4f0626, 0x094ff567,
+            0x7630e5cd, 0x6fc4a673, 0x175563a8, 0xfc27a17c,
+            0x59d8bb88, 0xdbfa7418, 0x0a1aacf0, 0xd020f7d5,
+        },
+        {
+            0x0b3de029, 0xb57c5e3c, 0xcef1a94a, 0x83f53555,
+            0x10571617, 0xe199f083, 0xa2789066, 0x8a8a1e17,
+            0x9ce8d2d9, 0xa4b9b5ec, 0xa3909bdd, 0x82d50ae8,
+            0xf48e4f8c, 0x3107ec54, 0x2fde3200, 0x73fae410,
+        },
+        {
+            0x7d664d50, 0xa62b1d7f, 0x995fc672, 0xade15d2c,
+            0xd2dbcd89, 0x6217a24a, 0x2f22c327, 0xa2e40f39,
+            0xecaed1fc, 0xd19afcc0, 0x64afbea5, 0x26bc6fc0,
+            0x8843c77d, 0x88f2b5e1, 0x0303c565, 0x62f56c26,
+        },
+        {
+            0x63c4a052, 0x795af59e, 0x2afcb70b, 0xe15c86f9,
+            0xdc0601ba, 0x00b8b87b, 0x6756162c, 0x82918329,
+            0x6328eb26, 0x76e72125, 0x43094aea, 0xcb86d44c,
+            0x6b8fae89, 0xab1a49bd, 0x2024d052, 0x718e39a0,
+        },
+        {
+            0x824f1c58, 0x9d24b0b3, 0x90ec37cd, 0x3c4f9b79,
+            0x5d08a319, 0x8519e9aa, 0x7d7df977, 0x4e471200,
+            0x2c351c95, 0x9b28d1af, 0x4484edc8, 0x39e67b7b,
+            0xfad8e719, 0x59b9aed5, 0xf7a3fb4d, 0x6dbb6172,
+        },
+        {
+            0xaeca252a, 0xe072ced5, 0x00ea1d92, 0xc38d9f8e,
+            0x3faba453, 0x801d39cf, 0x27dc1291, 0x241a0481,
+            0x7e3d40e4, 0x19c52ec0, 0x46b82097, 0xd3c27146,
+            0xe3b2fcf3, 0xbead00d9, 0x8b01d225, 0x68ea1b7a,
+        },
+        {
+            0x0ccf4b2e, 0x928f760d, 0x62d5ba6c, 0x0049891c,
+            0xf486fc0e, 0xd0399977, 0x9b0a3cc0, 0xe9c70a59,
+            0x03290a89, 0xda5dae89, 0xabeaf1c4, 0xcc2047e3,
+            0xe3a86eb1, 0xd42bd16f, 0x880311c7, 0xb1834d05,
+        },
+        {
+            0x3bee9ba7, 0x0d35ebf4, 0x9d35c750, 0xbba12914,
+            0xf847e9fc, 0xc7c86617, 0x8de7f33a, 0xa5682b32,
+            0xb6c968c4, 0x63ce98fb, 0x55a1669c, 0x77101db6,
+            0xa0a0d77f, 0xe7495372, 0x9bf41445, 0x25152a50,
+        },
+        {
+            0xf01ead1e, 0xa36a7492, 0x0c8be52c, 0xa79f136c,
+            0xb781695f, 0x7b9b4df3, 0xf0326462, 0x0a92ea41,
+            0x650c8e03, 0x43822450, 0xa0bb342f, 0x13cae4e0,
+            0xa5464dbd, 0x48686a75, 0xf9443cdd, 0xf17e2cae,
+        },
+    },
+};
+#endif
 #else /* MCUBOOT_SIGN_EC384 */
 const unsigned char root_pub_der[] = {
     0x30, 0x76, 0x30, 0x10, 0x06, 0x07, 0x2a, 0x86,
@@ -162,6 +359,12 @@ const struct bootutil_key bootutil_keys[] = {
     {
         .key = root_pub_der,
         .len = &root_pub_der_len,
+#ifdef MCUBOOT_ECDSA_P256_COMB
+        .comb = &root_pub_comb,
+#endif
+#ifdef MCUBOOT_RSA_MONT
+        .mont = &root_pub_mont,
+#endif
     },
 };
 const int bootutil_key_cnt = 1;
@@ -328,3 +531,44 @@ const struct bootutil_key bootutil_enc_key = {
     .len = &enc_key_len,
 };
 #endif
+
+#if defined(MCUBOOT_SWAP_SAVE_WRAPPED_ENCKEY)
+#include <string.h>
+#include <bootutil/enc_key.h>
+
+/* Stand-in for a hardware key wrap: the key is XORed with a fixed device key
+ * after the RFC 3394 default IV, which unwrapping checks.
+ */
+static const uint8_t sim_wrap_iv[8] = {
+  0xa6, 0xa6, 0xa6, 0xa6, 0xa6, 0xa6, 0xa6, 0xa6,
+};
+
+static uint8_t sim_device_key(unsigned int i)
+{
+    return (uint8_t)(0x5c + 29 * i);
+}
+
+int boot_enc_wrap_key(const uint8_t *key, uint8_t *wrapped)
+{
+    unsigned int i;
+
+    memcpy(wrapped, sim_wrap_iv, sizeof(sim_wrap_iv));
+    for (i = 0; i < BOOT_ENC_KEY_SIZE; i++) {
+        wrapped[sizeof(sim_wrap_iv) + i] = key[i] ^ sim_device_key(i);
+    }
+    return 0;
+}
+
+int boot_enc_unwrap_key(const uint8_t *wrapped, uint8_t *key)
+{
+    unsigned int i;
+
+    if (memcmp(wrapped, sim_wrap_iv, sizeof(sim_wrap_iv)) != 0) {
+        return -1;
+    }
+    for (i = 0; i < BOOT_ENC_KEY_SIZE; i++) {
+        key[i] = wrapped[sizeof(sim_wrap_iv) + i] ^ sim_device_key(i);
+    }
+    return 0;
+}
+#endif
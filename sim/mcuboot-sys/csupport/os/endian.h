@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef H_ENDIAN_
+#define H_ENDIAN_
+
+#include <arpa/inet.h>
+
+#endif
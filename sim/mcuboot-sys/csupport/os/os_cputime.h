@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2026, NOWATCH BV
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef H_OS_CPUTIME_
+#define H_OS_CPUTIME_
+
+#include <stdint.h>
+
+/* The uart of the simulator has its own clock, delays take no time. */
+void os_cputime_delay_usecs(uint32_t usecs);
+
+#endif
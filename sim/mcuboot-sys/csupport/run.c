@@ -22,6 +22,14 @@
 #include "mbedtls/nist_kw.h"
 #endif
 
+#ifdef MCUBOOT_ENC_IMAGES
+#include "bootutil/crypto/aes_ctr.h"
+#endif
+#ifdef MCUBOOT_SERIAL
+#include "boot_serial/boot_serial.h"
+#endif
+#include "bootutil/crypto/sha.h"
+
 #define BOOT_LOG_LEVEL BOOT_LOG_LEVEL_ERROR
 #include <bootutil/bootutil_log.h>
 #include "bootutil/crypto/common.h"
@@ -43,9 +51,15 @@ extern int sim_flash_read(uint8_t flash_id, uint32_t offset, uint8_t *dest,
         uint32_t size);
 extern int sim_flash_write(uint8_t flash_id, uint32_t offset, const uint8_t *src,
         uint32_t size);
+extern void sim_flash_op_boundary(void);
 extern uint32_t sim_flash_align(uint8_t flash_id);
 extern uint8_t sim_flash_erased_val(uint8_t flash_id);
 
+#ifdef MCUBOOT_SERIAL
+extern int sim_uart_read(char *str, int cnt, int *newline);
+extern void sim_uart_write(const char *ptr, int cnt);
+#endif
+
 struct sim_context {
     int flash_counter;
     int jumped;
@@ -244,18 +258,23 @@ struct area_desc {
     uint32_t num_slots;
 };
 
-int invoke_boot_go(struct sim_context *ctx, struct area_desc *adesc,
-                   struct boot_rsp *rsp, int image_id)
+static void sim_crypto_setup(void)
 {
-    int res;
-    struct boot_loader_state *state;
-
 #if defined(MCUBOOT_SIGN_RSA) || \
     (defined(MCUBOOT_SIGN_EC256) && defined(MCUBOOT_USE_MBED_TLS)) ||\
     (defined(MCUBOOT_ENCRYPT_EC256) && defined(MCUBOOT_USE_MBED_TLS)) ||\
     (defined(MCUBOOT_ENCRYPT_X25519) && defined(MCUBOOT_USE_MBED_TLS))
     mbedtls_platform_set_calloc_free(calloc, free);
 #endif
+}
+
+int invoke_boot_go(struct sim_context *ctx, struct area_desc *adesc,
+                   struct boot_rsp *rsp, int image_id)
+{
+    int res;
+    struct boot_loader_state *state;
+
+    sim_crypto_setup();
 
     state = malloc(sizeof(struct boot_loader_state));
 
@@ -288,6 +307,298 @@ int invoke_boot_go(struct sim_context *ctx, struct area_desc *adesc,
     }
 }
 
+#ifdef MCUBOOT_SERIAL
+/*
+ * Serial recovery never returns: the run ends with a jump back to
+ * invoke_boot_serial(), through the context of the thread, either when the
+ * uart of the simulator has nothing more to receive (1) or when the host
+ * resets the device (2).
+ */
+static int sim_serial_read(char *str, int cnt, int *newline)
+{
+    int rc = sim_uart_read(str, cnt, newline);
+
+    if (rc < 0) {
+        longjmp(sim_get_context()->boot_jmpbuf, 1);
+    }
+    return rc;
+}
+
+void hal_system_reset(void)
+{
+    longjmp(sim_get_context()->boot_jmpbuf, 2);
+}
+
+void os_cputime_delay_usecs(uint32_t usecs)
+{
+    (void)usecs;
+}
+
+int invoke_boot_serial(struct sim_context *ctx, struct area_desc *adesc)
+{
+    static const struct boot_uart_funcs uart = {
+        .read = sim_serial_read,
+        .write = sim_uart_write,
+    };
+    int rc;
+
+    sim_crypto_setup();
+    sim_set_flash_areas(adesc);
+    sim_set_context(ctx);
+
+    rc = setjmp(ctx->boot_jmpbuf);
+    if (rc == 0) {
+        boot_serial_start(&uart);
+    }
+
+    sim_reset_flash_areas();
+    sim_reset_context();
+    return rc;
+}
+#endif /* MCUBOOT_SERIAL */
+
+/*
+ * Benchmark kernels: each runs a bootutil primitive `iters` times, with the
+ * crypto backend of the build, so that the simulator can time it.
+ */
+int sim_kernel_sha(const uint8_t *buf, uint32_t len, uint32_t iters)
+{
+    bootutil_sha_context sha_ctx;
+    uint8_t digest[IMAGE_HASH_SIZE];
+    uint32_t i;
+    int rc = 0;
+
+    sim_crypto_setup();
+
+    for (i = 0; rc == 0 && i < iters; i++) {
+        bootutil_sha_init(&sha_ctx);
+        rc = bootutil_sha_update(&sha_ctx, buf, len);
+        if (rc == 0) {
+            rc = bootutil_sha_finish(&sha_ctx, digest);
+        }
+        bootutil_sha_drop(&sha_ctx);
+    }
+
+    return rc;
+}
+
+int sim_kernel_aes_ctr(uint8_t *buf, uint32_t len, uint32_t iters)
+{
+#ifdef MCUBOOT_ENC_IMAGES
+    bootutil_aes_ctr_context aes_ctx;
+    uint8_t key[BOOT_ENC_KEY_SIZE];
+    uint8_t counter[BOOTUTIL_CRYPTO_AES_CTR_BLOCK_SIZE];
+    uint32_t i;
+    int rc;
+
+    memset(key, 0x5a, sizeof(key));
+
+    bootutil_aes_ctr_init(&aes_ctx);
+    rc = bootutil_aes_ctr_set_key(&aes_ctx, key);
+    for (i = 0; rc == 0 && i < iters; i++) {
+        memset(counter, 0, sizeof(counter));
+        rc = bootutil_aes_ctr_decrypt(&aes_ctx, counter, buf, len, 0, buf);
+    }
+    bootutil_aes_ctr_drop(&aes_ctx);
+
+    return rc;
+#else
+    (void)buf;
+    (void)len;
+    (void)iters;
+    return -1;
+#endif
+}
+
+/* Validates the image in the primary slot of the first image. */
+int invoke_kernel_validate(struct sim_context *ctx, struct area_desc *adesc,
+                           uint32_t iters)
+{
+    const struct flash_area *fap;
+    struct image_header hdr;
+    uint8_t tmpbuf[BOOT_TMPBUF_SZ];
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+    uint32_t i;
+    int rc;
+
+    sim_crypto_setup();
+    sim_set_flash_areas(adesc);
+    sim_set_context(ctx);
+
+    rc = flash_area_open(FLASH_AREA_IMAGE_PRIMARY(0), &fap);
+    if (rc == 0) {
+        rc = flash_area_read(fap, 0, &hdr, sizeof(hdr));
+        for (i = 0; rc == 0 && i < iters; i++) {
+            FIH_CALL(bootutil_img_validate, fih_rc, NULL, 0, &hdr, fap, tmpbuf,
+                     sizeof(tmpbuf), NULL, 0, NULL);
+            if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+                rc = -1;
+            }
+        }
+        flash_area_close(fap);
+    }
+
+    sim_reset_flash_areas();
+    sim_reset_context();
+    return rc;
+}
+
+/*
+ * Copies `len` bytes from the secondary to the primary slot of the first
+ * image.  The simulator disables the write checks of the destination, so
+ * that it does not have to be erased between iterations.
+ */
+int invoke_kernel_copy(struct sim_context *ctx, struct area_desc *adesc,
+                       uint32_t len, uint32_t iters)
+{
+    const struct flash_area *fap_src;
+    const struct flash_area *fap_dst;
+    struct boot_loader_state *state;
+    uint32_t i;
+    int rc;
+
+    state = malloc(sizeof(struct boot_loader_state));
+    boot_state_clear(state);
+    sim_set_flash_areas(adesc);
+    sim_set_context(ctx);
+
+    rc = flash_area_open(FLASH_AREA_IMAGE_SECONDARY(0), &fap_src);
+    if (rc == 0) {
+        rc = flash_area_open(FLASH_AREA_IMAGE_PRIMARY(0), &fap_dst);
+        for (i = 0; rc == 0 && i < iters; i++) {
+            rc = boot_copy_region(state, fap_src, fap_dst, 0, 0, len);
+        }
+    }
+
+    sim_reset_flash_areas();
+    sim_reset_context();
+    free(state);
+    return rc;
+}
+
+#if !defined(MCUBOOT_RAM_LOAD)
+/*
+ * Walks the TLVs of the image twice in lockstep, with the TLV index of the
+ * build, if any, and directly in flash, and aborts if the walks disagree, or
+ * if a TLV is found outside of the TLV area.
+ */
+static int sim_fuzz_tlvs(const struct image_header *hdr,
+                         const struct flash_area *fap, bool prot)
+{
+    struct image_tlv_iter it;
+    struct image_tlv_iter it_flash;
+    uint32_t off, off_flash;
+    uint16_t len, len_flash;
+    uint16_t type, type_flash;
+    int rc, rc_flash;
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_ANY, prot);
+    if (rc != 0) {
+        return 1;
+    }
+    it_flash = it;
+    it_flash.index = NULL;
+
+    do {
+        rc = bootutil_tlv_iter_next(&it, &off, &len, &type);
+        rc_flash = bootutil_tlv_iter_next(&it_flash, &off_flash, &len_flash,
+                                          &type_flash);
+        if (rc != rc_flash) {
+            abort();
+        }
+        if (rc == 0) {
+            if (off != off_flash || len != len_flash || type != type_flash) {
+                abort();
+            }
+            if (off - sizeof(struct image_tlv) >= it.tlv_end) {
+                abort();
+            }
+        }
+    } while (rc == 0);
+
+    return rc < 0;
+}
+
+/*
+ * Fuzzing entry, run on the image written by the fuzzer in the primary slot
+ * of the first image.  The header gets the checks of boot_is_header_valid()
+ * that the parsing relies on, then the TLVs of the protected and of the whole
+ * TLV area are walked by sim_fuzz_tlvs().  This does no crypto, so that it
+ * runs at the speed of the parsing, unless `validate` is set, in which case
+ * the image is then validated.
+ *
+ * Returns 0 if the image was accepted, 1 if it was rejected, -1 if the build
+ * can not be fuzzed.
+ */
+int invoke_fuzz_image(struct sim_context *ctx, struct area_desc *adesc,
+                      int validate)
+{
+    const struct flash_area *fap;
+    struct image_header hdr;
+    uint8_t tmpbuf[BOOT_TMPBUF_SZ];
+#ifdef MCUBOOT_ENC_IMAGES
+    struct enc_key_data enc_state[BOOT_NUM_SLOTS];
+#endif
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+    uint32_t size;
+    int rc;
+
+    sim_crypto_setup();
+    sim_set_flash_areas(adesc);
+    sim_set_context(ctx);
+#ifdef MCUBOOT_TLV_INDEX
+    /* The fuzzer rewrites the slot without erasing it. */
+    bootutil_tlv_index_invalidate(NULL);
+#endif
+
+    rc = flash_area_open(FLASH_AREA_IMAGE_PRIMARY(0), &fap);
+    if (rc == 0) {
+        rc = flash_area_read(fap, 0, &hdr, sizeof(hdr));
+        if (rc == 0 &&
+            (hdr.ih_magic != IMAGE_MAGIC ||
+             !boot_u32_safe_add(&size, hdr.ih_img_size, hdr.ih_hdr_size) ||
+             !boot_u32_safe_add(&size, size, hdr.ih_protect_tlv_size) ||
+             size >= flash_area_get_size(fap))) {
+            rc = 1;
+        }
+        if (rc == 0) {
+            rc = sim_fuzz_tlvs(&hdr, fap, true);
+        }
+        if (rc == 0) {
+            rc = sim_fuzz_tlvs(&hdr, fap, false);
+        }
+        if (rc == 0 && validate) {
+#ifdef MCUBOOT_ENC_IMAGES
+            memset(enc_state, 0, sizeof(enc_state));
+            FIH_CALL(bootutil_img_validate, fih_rc, enc_state, 0, &hdr, fap,
+                     tmpbuf, sizeof(tmpbuf), NULL, 0, NULL);
+#else
+            FIH_CALL(bootutil_img_validate, fih_rc, NULL, 0, &hdr, fap,
+                     tmpbuf, sizeof(tmpbuf), NULL, 0, NULL);
+#endif
+            if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+                rc = 1;
+            }
+        }
+        flash_area_close(fap);
+    }
+
+    sim_reset_flash_areas();
+    sim_reset_context();
+    return rc != 0;
+}
+#else
+/* Ram-load builds read the TLVs from where the image would be loaded. */
+int invoke_fuzz_image(struct sim_context *ctx, struct area_desc *adesc,
+                      int validate)
+{
+    (void)ctx;
+    (void)adesc;
+    (void)validate;
+    return -1;
+}
+#endif /* !MCUBOOT_RAM_LOAD */
+
 void *os_malloc(size_t size)
 {
     // printf("os_malloc 0x%x bytes\n", size);
@@ -348,6 +659,7 @@ int flash_area_write(const struct flash_area *area, uint32_t off, const void *sr
     BOOT_LOG_SIM("%s: area=%d, off=%x, len=%x", __func__,
                  area->fa_id, off, len);
     struct sim_context *ctx = sim_get_context();
+    sim_flash_op_boundary();
     if (--(ctx->flash_counter) == 0) {
         ctx->jumped++;
         longjmp(ctx->boot_jmpbuf, 1);
@@ -355,11 +667,56 @@ int flash_area_write(const struct flash_area *area, uint32_t off, const void *sr
     return sim_flash_write(area->fa_device_id, area->fa_off + off, src, len);
 }
 
+#ifdef MCUBOOT_FLASH_AREA_COPY
+/* Copies within one flash device, so that copies between devices still go
+ * through boot_copy_region()'s own buffer.
+ */
+int flash_area_copy(const struct flash_area *src, uint32_t off_src,
+                    const struct flash_area *dst, uint32_t off_dst,
+                    uint32_t len)
+{
+    uint8_t buf[256];
+    uint32_t chunk;
+    int rc;
+
+    BOOT_LOG_SIM("%s: src=%d, off=%x, dst=%d, off=%x, len=%x", __func__,
+                 src->fa_id, off_src, dst->fa_id, off_dst, len);
+    if (src->fa_device_id != dst->fa_device_id) {
+        return 1;
+    }
+
+    struct sim_context *ctx = sim_get_context();
+    sim_flash_op_boundary();
+    if (--(ctx->flash_counter) == 0) {
+        ctx->jumped++;
+        longjmp(ctx->boot_jmpbuf, 1);
+    }
+
+    while (len > 0) {
+        chunk = len < sizeof(buf) ? len : sizeof(buf);
+        rc = sim_flash_read(src->fa_device_id, src->fa_off + off_src, buf, chunk);
+        if (rc == 0) {
+            rc = sim_flash_write(dst->fa_device_id, dst->fa_off + off_dst, buf,
+                                 chunk);
+        }
+        if (rc != 0) {
+            return -1;
+        }
+        off_src += chunk;
+        off_dst += chunk;
+        len -= chunk;
+    }
+
+    return 0;
+}
+#endif
+
 int flash_area_erase(const struct flash_area *area, uint32_t off, uint32_t len)
 {
     BOOT_LOG_SIM("%s: area=%d, off=%x, len=%x", __func__,
                  area->fa_id, off, len);
     struct sim_context *ctx = sim_get_context();
+    sim_flash_op_boundary();
     if (--(ctx->flash_counter) == 0) {
         ctx->jumped++;
         longjmp(ctx->boot_jmpbuf, 1);
@@ -541,3 +898,8 @@ uint32_t boot_magic_sz(void)
 {
     return BOOT_MAGIC_ALIGN_SIZE;
 }
+
+uint32_t boot_max_img_sectors(void)
+{
+    return BOOT_MAX_IMG_SECTORS;
+}
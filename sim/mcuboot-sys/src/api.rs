@@ -8,7 +8,7 @@
 
 use crate::area::CAreaDesc;
 use log::{Level, log_enabled, warn};
-use simflash::{Result, Flash, FlashPtr};
+use simflash::{Result, Flash, FlashPtr, FlashStats};
 use std::{
     cell::RefCell,
     collections::HashMap,
@@ -165,11 +165,38 @@ impl NvCounterStorage {
     }
 }
 
+/// The uart serial recovery talks through, see `c::boot_serial`.
+pub trait SimUart {
+    /// Read the next bytes received, up to the end of a line and at most `buf.len()` of them.
+    /// Returns the number read and whether they end a line, or None when nothing will ever be
+    /// received again, which ends serial recovery.
+    fn read(&mut self, buf: &mut [u8]) -> Option<(usize, bool)>;
+
+    /// Send bytes to the host.
+    fn write(&mut self, data: &[u8]);
+}
+
+pub struct SimUartPtr {
+    pub ptr: *mut dyn SimUart,
+}
+
+/// A flash modification recorded by the journal.
+#[derive(Clone, Debug)]
+pub enum FlashOp {
+    /// The bootloader starts a flash operation, where it may be interrupted.  The operations
+    /// that follow, up to the next boundary, are what it did.
+    Boundary,
+    Write { dev_id: u8, offset: usize, data: Vec<u8> },
+    Erase { dev_id: u8, offset: usize, len: usize },
+}
+
 thread_local! {
     pub static THREAD_CTX: RefCell<FlashContext> = RefCell::new(FlashContext::new());
+    pub static JOURNAL: RefCell<Option<Vec<FlashOp>>> = RefCell::new(None);
     pub static SIM_CTX: RefCell<CSimContextPtr> = RefCell::new(CSimContextPtr::new());
     pub static RAM_CTX: RefCell<BootsimRamInfo> = RefCell::new(BootsimRamInfo::default());
     pub static NV_COUNTER_CTX: RefCell<NvCounterStorage> = RefCell::new(NvCounterStorage::new());
+    pub static UART_CTX: RefCell<Option<SimUartPtr>> = RefCell::new(None);
 }
 
 /// Set the flash device to be used by the simulation.  The pointer is unsafely stashed away.
@@ -198,6 +225,57 @@ pub fn clear_flash(dev_id: u8) {
     });
 }
 
+/// The statistics of the flash devices set for the simulation, summed over them.  A uart can
+/// use them to follow the time the bootloader spends in flash operations.
+pub fn flash_stats() -> FlashStats {
+    THREAD_CTX.with(|ctx| {
+        let mut stats = FlashStats::default();
+        for flash in ctx.borrow().flash_map.values() {
+            stats += unsafe { &*(flash.ptr) }.stats();
+        }
+        stats
+    })
+}
+
+/// Set the uart used by serial recovery.  The pointer is unsafely stashed away, as for
+/// `set_flash`.
+pub fn set_uart(uart: &mut dyn SimUart) {
+    UART_CTX.with(|ctx| {
+        unsafe {
+            let uart: &'static mut dyn SimUart = mem::transmute(uart);
+            ctx.replace(Some(SimUartPtr { ptr: uart as *mut dyn SimUart }));
+        }
+    });
+}
+
+pub fn clear_uart() {
+    UART_CTX.with(|ctx| {
+        ctx.replace(None);
+    });
+}
+
+/// Start recording the flash modifications done by the bootloader on this thread.
+pub fn start_journal() {
+    JOURNAL.with(|journal| {
+        journal.replace(Some(Vec::new()));
+    });
+}
+
+/// Stop recording, and return the modifications recorded since `start_journal`.
+pub fn take_journal() -> Vec<FlashOp> {
+    JOURNAL.with(|journal| {
+        journal.replace(None).unwrap_or_default()
+    })
+}
+
+fn record(op: FlashOp) {
+    JOURNAL.with(|journal| {
+        if let Some(ops) = journal.borrow_mut().as_mut() {
+            ops.push(op);
+        }
+    });
+}
+
 // This isn't meant to call directly, but by a wrapper.
 
 #[no_mangle]
@@ -277,6 +355,9 @@ pub extern "C" fn sim_flash_erase(dev_id: u8, offset: u32, size: u32) -> libc::c
             rc = map_err(dev.erase(offset as usize, size as usize));
         }
     });
+    if rc == 0 {
+        record(FlashOp::Erase { dev_id, offset: offset as usize, len: size as usize });
+    }
     rc
 }
 
@@ -303,9 +384,18 @@ pub extern "C" fn sim_flash_write(dev_id: u8, offset: u32, src: *const u8, size:
             rc = map_err(dev.write(offset as usize, &buf));
         }
     });
+    if rc == 0 {
+        let data = unsafe { slice::from_raw_parts(src, size as usize) }.to_vec();
+        record(FlashOp::Write { dev_id, offset: offset as usize, data });
+    }
     rc
 }
 
+#[no_mangle]
+pub extern "C" fn sim_flash_op_boundary() {
+    record(FlashOp::Boundary);
+}
+
 #[no_mangle]
 pub extern "C" fn sim_flash_align(id: u8) -> u32 {
     THREAD_CTX.with(|ctx| {
@@ -320,6 +410,36 @@ pub extern "C" fn sim_flash_erased_val(id: u8) -> u8 {
     })
 }
 
+/// Returns -1, ending serial recovery, when there is no uart or it has nothing more to receive.
+#[no_mangle]
+pub extern "C" fn sim_uart_read(str: *mut libc::c_char, cnt: libc::c_int,
+                                newline: *mut libc::c_int) -> libc::c_int {
+    let buf = unsafe { slice::from_raw_parts_mut(str as *mut u8, cnt.max(0) as usize) };
+    let result = UART_CTX.with(|ctx| {
+        ctx.borrow().as_ref().and_then(|uart| unsafe { &mut *(uart.ptr) }.read(buf))
+    });
+    match result {
+        Some((len, end)) => {
+            unsafe { *newline = end as libc::c_int };
+            len as libc::c_int
+        }
+        None => {
+            unsafe { *newline = 0 };
+            -1
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn sim_uart_write(ptr: *const libc::c_char, cnt: libc::c_int) {
+    let data = unsafe { slice::from_raw_parts(ptr as *const u8, cnt.max(0) as usize) };
+    UART_CTX.with(|ctx| {
+        if let Some(uart) = ctx.borrow().as_ref() {
+            unsafe { &mut *(uart.ptr) }.write(data);
+        }
+    });
+}
+
 fn map_err(err: Result<()>) -> libc::c_int {
     match err {
         Ok(()) => 0,
@@ -125,6 +125,12 @@ impl AreaDesc {
         None
     }
 
+    // Number of sectors of the image with the given ID, as seen by the bootloader, or None if
+    // the area is not present.
+    pub fn num_sectors(&self, id: FlashId) -> Option<usize> {
+        self.areas.get(id as usize).filter(|area| !area.is_empty()).map(|area| area.len())
+    }
+
     pub fn get_c(&self) -> Box<CAreaDesc> {
         let mut areas_box: Box<CAreaDesc> = Box::new(Default::default());
         let areas: &mut CAreaDesc = areas_box.borrow_mut();
@@ -115,6 +115,117 @@ pub fn boot_go(multiflash: &mut SimMultiFlash, areadesc: &AreaDesc,
     }
 }
 
+/// How a run of serial recovery ended.
+#[cfg(feature = "serial-recovery")]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum SerialExit {
+    /// The uart had nothing more to receive.
+    Idle,
+    /// The host reset the device.
+    Reset,
+}
+
+/// Run serial recovery on this flash device, with `uart` as its uart, until the uart has nothing
+/// more to receive or the host resets the device.
+#[cfg(feature = "serial-recovery")]
+pub fn boot_serial(multiflash: &mut SimMultiFlash, areadesc: &AreaDesc,
+                   uart: &mut dyn api::SimUart) -> SerialExit {
+    init_crypto();
+
+    for (&dev_id, flash) in multiflash.iter_mut() {
+        api::set_flash(dev_id, flash);
+    }
+    api::set_uart(uart);
+    let mut sim_ctx = api::CSimContext::default();
+    let rc = unsafe {
+        let adesc = areadesc.get_c();
+        raw::invoke_boot_serial(&mut sim_ctx as *mut _, adesc.borrow() as *const _)
+    };
+    api::clear_uart();
+    for &dev_id in multiflash.keys() {
+        api::clear_flash(dev_id);
+    }
+
+    if rc == 2 {
+        SerialExit::Reset
+    } else {
+        SerialExit::Idle
+    }
+}
+
+/// Run a benchmark kernel, which is given the simulator context, on this flash device.
+fn invoke_kernel<F>(multiflash: &mut SimMultiFlash, areadesc: &AreaDesc, kernel: F) -> bool
+    where F: FnOnce(*mut api::CSimContext, *const crate::area::CAreaDesc) -> libc::c_int
+{
+    init_crypto();
+
+    for (&dev_id, flash) in multiflash.iter_mut() {
+        api::set_flash(dev_id, flash);
+    }
+    let mut sim_ctx = api::CSimContext::default();
+    let adesc = areadesc.get_c();
+    let rc = kernel(&mut sim_ctx as *mut _, adesc.borrow() as *const _);
+    for &dev_id in multiflash.keys() {
+        api::clear_flash(dev_id);
+    }
+    rc == 0
+}
+
+/// Validate the primary image `iters` times.
+pub fn kernel_validate(multiflash: &mut SimMultiFlash, areadesc: &AreaDesc, iters: u32) -> bool {
+    invoke_kernel(multiflash, areadesc, |ctx, adesc| unsafe {
+        raw::invoke_kernel_validate(ctx, adesc, iters)
+    })
+}
+
+/// Copy `len` bytes from the secondary to the primary slot of the first image, `iters` times.
+pub fn kernel_copy(multiflash: &mut SimMultiFlash, areadesc: &AreaDesc, len: u32,
+                   iters: u32) -> bool {
+    invoke_kernel(multiflash, areadesc, |ctx, adesc| unsafe {
+        raw::invoke_kernel_copy(ctx, adesc, len, iters)
+    })
+}
+
+/// Parse the image written by a fuzzer in the primary slot of the first image, the way the
+/// bootloader does before validating it, and if `validate` is set, validate it.  Returns whether
+/// the image was accepted, or None if the build can not be fuzzed.  Inconsistent results of the
+/// parsing abort.
+pub fn fuzz_image(multiflash: &mut SimMultiFlash, areadesc: &AreaDesc,
+                  validate: bool) -> Option<bool> {
+    init_crypto();
+
+    for (&dev_id, flash) in multiflash.iter_mut() {
+        api::set_flash(dev_id, flash);
+    }
+    let mut sim_ctx = api::CSimContext::default();
+    let rc = unsafe {
+        let adesc = areadesc.get_c();
+        raw::invoke_fuzz_image(&mut sim_ctx as *mut _, adesc.borrow() as *const _,
+                               validate as libc::c_int)
+    };
+    for &dev_id in multiflash.keys() {
+        api::clear_flash(dev_id);
+    }
+    match rc {
+        0 => Some(true),
+        1 => Some(false),
+        _ => None,
+    }
+}
+
+/// Hash `buf` `iters` times with the image hash of the build.
+pub fn kernel_sha(buf: &[u8], iters: u32) -> bool {
+    init_crypto();
+    unsafe { raw::sim_kernel_sha(buf.as_ptr(), buf.len() as u32, iters) == 0 }
+}
+
+/// Decrypt `buf` in place `iters` times with AES-CTR.  Returns false if the build does not
+/// support encrypted images.
+pub fn kernel_aes_ctr(buf: &mut [u8], iters: u32) -> bool {
+    init_crypto();
+    unsafe { raw::sim_kernel_aes_ctr(buf.as_mut_ptr(), buf.len() as u32, iters) == 0 }
+}
+
 pub fn boot_trailer_sz(align: u32) -> u32 {
     unsafe { raw::boot_trailer_sz(align) }
 }
@@ -131,6 +242,10 @@ pub fn boot_max_align() -> usize {
     unsafe { raw::boot_max_align() as usize }
 }
 
+pub fn boot_max_img_sectors() -> usize {
+    unsafe { raw::boot_max_img_sectors() as usize }
+}
+
 pub fn rsa_oaep_encrypt(pubkey: &[u8], seckey: &[u8]) -> Result<[u8; 256], &'static str> {
     unsafe {
         let mut encbuf: [u8; 256] = [0; 256];
@@ -177,11 +292,24 @@ mod raw {
         pub fn invoke_boot_go(sim_ctx: *mut CSimContext, areadesc: *const CAreaDesc,
             rsp: *mut BootRsp, image_index: libc::c_int) -> libc::c_int;
 
+        pub fn invoke_kernel_validate(sim_ctx: *mut CSimContext, areadesc: *const CAreaDesc,
+            iters: u32) -> libc::c_int;
+        pub fn invoke_kernel_copy(sim_ctx: *mut CSimContext, areadesc: *const CAreaDesc,
+            len: u32, iters: u32) -> libc::c_int;
+        pub fn invoke_fuzz_image(sim_ctx: *mut CSimContext, areadesc: *const CAreaDesc,
+            validate: libc::c_int) -> libc::c_int;
+        pub fn sim_kernel_sha(buf: *const u8, len: u32, iters: u32) -> libc::c_int;
+        #[cfg(feature = "serial-recovery")]
+        pub fn invoke_boot_serial(sim_ctx: *mut CSimContext, areadesc: *const CAreaDesc)
+            -> libc::c_int;
+        pub fn sim_kernel_aes_ctr(buf: *mut u8, len: u32, iters: u32) -> libc::c_int;
+
         pub fn boot_trailer_sz(min_write_sz: u32) -> u32;
         pub fn boot_status_sz(min_write_sz: u32) -> u32;
 
         pub fn boot_magic_sz() -> u32;
         pub fn boot_max_align() -> u32;
+        pub fn boot_max_img_sectors() -> u32;
 
         pub fn rsa_oaep_encrypt_(pubkey: *const u8, pubkey_len: libc::c_uint,
                                  seckey: *const u8, seckey_len: libc::c_uint,
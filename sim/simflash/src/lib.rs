@@ -9,8 +9,10 @@
 //! These generally can be written as individual bytes, but must be erased in larger units.
 
 mod pdump;
+pub mod trace;
 
 use crate::pdump::HexDump;
+use crate::trace::{TraceEntry, TraceOp};
 use log::info;
 use rand::{
     self,
@@ -18,8 +20,10 @@ use rand::{
     Rng,
 };
 use std::{
+    cell::{Cell, RefCell},
     collections::HashMap,
     fs::File,
+    hash::{Hash, Hasher},
     io::{self, Write},
     iter::Enumerate,
     path::Path,
@@ -37,6 +41,8 @@ pub enum FlashError {
     Write(String),
     #[error("Write failed by chance: {0}")]
     SimulatedFail(String),
+    #[error("Invalid trace: {0}")]
+    Trace(String),
     #[error("{0}")]
     Io(#[from] io::Error),
 }
@@ -66,6 +72,82 @@ pub trait Flash {
 
     fn align(&self) -> usize;
     fn erased_val(&self) -> u8;
+
+    fn set_timing(&mut self, timing: FlashTiming);
+    fn stats(&self) -> FlashStats;
+    fn reset_stats(&mut self);
+
+    fn erase_counts(&self) -> &[u32];
+    fn reset_erase_counts(&mut self);
+
+    fn set_trace(&mut self, dev_id: Option<u8>);
+    fn take_trace(&mut self) -> Vec<TraceEntry>;
+}
+
+/// A model of the time taken by the operations of a flash device.  Each operation costs a fixed
+/// setup time plus a time per byte; erases are charged once per sector.  All times are in
+/// nanoseconds.  The default model is free, which leaves the simulated time at zero.
+#[derive(Clone, Copy, Debug, Default)]
+pub struct FlashTiming {
+    pub read_setup: u64,
+    pub read_byte: u64,
+    pub write_setup: u64,
+    pub write_byte: u64,
+    pub erase_sector: u64,
+    pub erase_byte: u64,
+}
+
+impl FlashTiming {
+    /// Memory mapped internal NOR flash, as found in most microcontrollers: reads are nearly
+    /// free, programming is done a word at a time and a 4 KiB page erase takes tens of ms.
+    pub fn internal() -> FlashTiming {
+        FlashTiming {
+            read_setup: 0,
+            read_byte: 15,
+            write_setup: 0,
+            write_byte: 10_000,
+            erase_sector: 0,
+            erase_byte: 21_000,
+        }
+    }
+
+    /// External NOR flash on a quad SPI bus: each read goes through a command, programming is
+    /// done per page and erases are slower than for internal flash.
+    pub fn spi() -> FlashTiming {
+        FlashTiming {
+            read_setup: 1_000,
+            read_byte: 60,
+            write_setup: 20_000,
+            write_byte: 3_000,
+            erase_sector: 0,
+            erase_byte: 10_000,
+        }
+    }
+}
+
+/// Counters of the operations done on a flash device, and of the time they took according to the
+/// device's timing model.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct FlashStats {
+    pub reads: u64,
+    pub read_bytes: u64,
+    pub writes: u64,
+    pub write_bytes: u64,
+    pub erases: u64,
+    pub erase_bytes: u64,
+    pub elapsed_ns: u64,
+}
+
+impl std::ops::AddAssign for FlashStats {
+    fn add_assign(&mut self, other: FlashStats) {
+        self.reads += other.reads;
+        self.read_bytes += other.read_bytes;
+        self.writes += other.writes;
+        self.write_bytes += other.write_bytes;
+        self.erases += other.erases;
+        self.erase_bytes += other.erase_bytes;
+        self.elapsed_ns += other.elapsed_ns;
+    }
 }
 
 fn ebounds<T: AsRef<str>>(message: T) -> FlashError {
@@ -94,6 +176,13 @@ pub struct SimFlash {
     align: usize,
     verify_writes: bool,
     erased_val: u8,
+    timing: FlashTiming,
+    // Updated by reads, which only borrow the device.
+    stats: Cell<FlashStats>,
+    // Number of times each sector has been erased.
+    erase_counts: Vec<u32>,
+    // Device id and operations recorded while tracing is enabled.
+    trace: Option<(u8, RefCell<Vec<TraceEntry>>)>,
 }
 
 impl SimFlash {
@@ -104,6 +193,7 @@ impl SimFlash {
         assert!(align & (align - 1) == 0);
 
         let total = sectors.iter().sum();
+        let erase_counts = vec![0; sectors.len()];
         SimFlash {
             data: vec![erased_val; total],
             write_safe: vec![true; total],
@@ -112,6 +202,10 @@ impl SimFlash {
             align,
             verify_writes: true,
             erased_val,
+            timing: FlashTiming::default(),
+            stats: Cell::new(FlashStats::default()),
+            erase_counts,
+            trace: None,
         }
     }
 
@@ -141,6 +235,34 @@ impl SimFlash {
         None
     }
 
+    // Count an operation, and record it when tracing.
+    fn account(&self, op: TraceOp, offset: usize, len: usize, sectors: usize) {
+        let mut stats = self.stats.get();
+        stats.account(&self.timing, op, len, sectors);
+        self.stats.set(stats);
+
+        if let Some((dev_id, trace)) = &self.trace {
+            let (seq, time_ns) = trace::tick(self.timing.cost(op, len, sectors));
+            trace.borrow_mut().push(TraceEntry {
+                seq,
+                time_ns,
+                dev_id: *dev_id,
+                op,
+                offset,
+                len,
+                sectors,
+            });
+        }
+    }
+}
+
+/// Two devices hash the same when they have the same contents, and the same locations can be
+/// written without an erase.
+impl Hash for SimFlash {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.data.hash(state);
+        self.write_safe.hash(state);
+    }
 }
 
 pub type SimMultiFlash = HashMap<u8, SimFlash>;
@@ -150,7 +272,7 @@ impl Flash for SimFlash {
     /// strict, and make sure that the passed arguments are exactly at a sector boundary, otherwise
     /// return an error.
     fn erase(&mut self, offset: usize, len: usize) -> Result<()> {
-        let (_start, slen) = self.get_sector(offset).ok_or_else(|| ebounds("start"))?;
+        let (start, slen) = self.get_sector(offset).ok_or_else(|| ebounds("start"))?;
         let (end, elen) = self.get_sector(offset + len - 1).ok_or_else(|| ebounds("end"))?;
 
         if slen != 0 {
@@ -168,6 +290,12 @@ impl Flash for SimFlash {
             *x = true;
         }
 
+        for count in &mut self.erase_counts[start ..= end] {
+            *count += 1;
+        }
+
+        self.account(TraceOp::Erase, offset, len, end - start + 1);
+
         Ok(())
     }
 
@@ -213,6 +341,9 @@ impl Flash for SimFlash {
 
         let sub = &mut self.data[offset .. offset + payload.len()];
         sub.copy_from_slice(payload);
+
+        self.account(TraceOp::Write, offset, payload.len(), 0);
+
         Ok(())
     }
 
@@ -224,6 +355,9 @@ impl Flash for SimFlash {
 
         let sub = &self.data[offset .. offset + data.len()];
         data.copy_from_slice(sub);
+
+        self.account(TraceOp::Read, offset, data.len(), 0);
+
         Ok(())
     }
 
@@ -267,6 +401,43 @@ impl Flash for SimFlash {
     fn erased_val(&self) -> u8 {
         self.erased_val
     }
+
+    fn set_timing(&mut self, timing: FlashTiming) {
+        self.timing = timing;
+    }
+
+    fn stats(&self) -> FlashStats {
+        self.stats.get()
+    }
+
+    fn reset_stats(&mut self) {
+        self.stats.set(FlashStats::default());
+    }
+
+    /// The erase count of each sector, which is not cleared by `reset_stats`.
+    fn erase_counts(&self) -> &[u32] {
+        &self.erase_counts
+    }
+
+    fn reset_erase_counts(&mut self) {
+        for count in &mut self.erase_counts {
+            *count = 0;
+        }
+    }
+
+    /// Record the operations on this device as `dev_id`, or stop recording them.  The existing
+    /// records are dropped.
+    fn set_trace(&mut self, dev_id: Option<u8>) {
+        self.trace = dev_id.map(|id| (id, RefCell::new(Vec::new())));
+    }
+
+    /// The operations recorded since tracing was enabled or the last call.
+    fn take_trace(&mut self) -> Vec<TraceEntry> {
+        match &self.trace {
+            Some((_, trace)) => trace.take(),
+            None => Vec::new(),
+        }
+    }
 }
 
 /// It is possible to iterate over the sectors in the device, each element returning this.
@@ -306,7 +477,8 @@ impl<'a> Iterator for SectorIter<'a> {
 
 #[cfg(test)]
 mod test {
-    use super::{Flash, FlashError, SimFlash, Result, Sector};
+    use super::{Flash, FlashError, FlashTiming, SimFlash, Result, Sector};
+    use super::trace::{self, TraceEntry, TraceOp};
 
     #[test]
     fn test_flash() {
@@ -360,6 +532,86 @@ mod test {
         }
     }
 
+    #[test]
+    fn test_timing() {
+        let mut flash = SimFlash::new(vec![4096usize; 4], 4, 0xff);
+        flash.set_timing(FlashTiming {
+            read_setup: 1,
+            read_byte: 2,
+            write_setup: 10,
+            write_byte: 20,
+            erase_sector: 100,
+            erase_byte: 0,
+        });
+
+        flash.erase(0, 2 * 4096).unwrap();
+        flash.write(0, &[0x55; 8]).unwrap();
+        let mut buf = [0; 16];
+        flash.read(0, &mut buf).unwrap();
+
+        let stats = flash.stats();
+        assert_eq!((stats.erases, stats.erase_bytes), (1, 2 * 4096));
+        assert_eq!((stats.writes, stats.write_bytes), (1, 8));
+        assert_eq!((stats.reads, stats.read_bytes), (1, 16));
+        assert_eq!(stats.elapsed_ns, 2 * 100 + 10 + 8 * 20 + 1 + 16 * 2);
+
+        flash.reset_stats();
+        assert_eq!(flash.stats().elapsed_ns, 0);
+    }
+
+    #[test]
+    fn test_erase_counts() {
+        let mut flash = SimFlash::new(vec![4096usize; 4], 1, 0xff);
+
+        flash.erase(0, 2 * 4096).unwrap();
+        flash.erase(4096, 3 * 4096).unwrap();
+        assert_eq!(flash.erase_counts(), &[1, 2, 1, 1]);
+
+        // Wear is not part of the per-run statistics.
+        flash.reset_stats();
+        assert_eq!(flash.erase_counts(), &[1, 2, 1, 1]);
+
+        flash.reset_erase_counts();
+        assert_eq!(flash.erase_counts(), &[0, 0, 0, 0]);
+    }
+
+    #[test]
+    fn test_trace() {
+        let timing = FlashTiming::named("w25q128").unwrap();
+        let mut flash = SimFlash::new(vec![4096usize; 4], 4, 0xff);
+        flash.set_timing(timing);
+        flash.set_trace(Some(1));
+
+        flash.erase(4096, 2 * 4096).unwrap();
+        flash.write(4096, &[0x55; 8]).unwrap();
+        let mut buf = [0; 16];
+        flash.read(4096, &mut buf).unwrap();
+
+        let entries = flash.take_trace();
+        let ops: Vec<_> = entries.iter().map(|e| (e.op, e.offset, e.len, e.sectors)).collect();
+        assert_eq!(ops, [(TraceOp::Erase, 4096, 2 * 4096, 2),
+                         (TraceOp::Write, 4096, 8, 0),
+                         (TraceOp::Read, 4096, 16, 0)]);
+        assert!(entries.windows(2).all(|w| w[0].seq + 1 == w[1].seq &&
+                                        w[1].time_ns == w[0].time_ns +
+                                        timing.cost(w[0].op, w[0].len, w[0].sectors)));
+
+        // The text form reads back as the same trace.
+        for entry in &entries {
+            assert_eq!(entry.to_string().parse::<TraceEntry>().unwrap(), *entry);
+        }
+
+        // Replaying with the model it was recorded with gives the live statistics.
+        let stats = trace::replay(&entries, |_| timing);
+        assert_eq!(stats.get(&1), Some(&flash.stats()));
+        assert!(flash.take_trace().is_empty());
+
+        let custom: FlashTiming = "write_byte=7,erase_sector=3".parse().unwrap();
+        assert_eq!(trace::replay(&entries, |_| custom)[&1].elapsed_ns, 8 * 7 + 2 * 3);
+        assert!("write_byte".parse::<FlashTiming>().is_err());
+        assert!("flash_byte=1".parse::<FlashTiming>().is_err());
+    }
+
     // Helper checks for the result type.
     trait EChecker {
         fn is_bounds(&self) -> bool;
@@ -0,0 +1,245 @@
+// Copyright (c) 2026, NOWATCH BV
+//
+// SPDX-License-Identifier: Apache-2.0
+
+//! Traces of the operations done on flash devices.
+//!
+//! A trace records every read, write and erase of the traced devices, in the order they were
+//! done.  It can be saved as text, and replayed against the timing model of another flash part to
+//! get the statistics a run on that part would have given, without running the simulation again.
+
+use crate::{FlashError, FlashStats, FlashTiming, Result};
+use std::{
+    cell::Cell,
+    collections::BTreeMap,
+    fmt,
+    fs,
+    path::Path,
+    str::FromStr,
+};
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum TraceOp {
+    Read,
+    Write,
+    Erase,
+}
+
+/// One operation of a trace.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct TraceEntry {
+    /// Position of the operation among those done by this thread on the traced devices.
+    pub seq: u64,
+    /// Simulated time at which the operation started, in nanoseconds, according to the timing
+    /// models of the devices it was recorded on.
+    pub time_ns: u64,
+    pub dev_id: u8,
+    pub op: TraceOp,
+    pub offset: usize,
+    pub len: usize,
+    /// Number of sectors erased, 0 for reads and writes.
+    pub sectors: usize,
+}
+
+thread_local! {
+    // Sequence number and simulated time of the next traced operation.  They are shared by the
+    // devices traced by a thread, so that their entries can be merged back in order.
+    static CLOCK: Cell<(u64, u64)> = Cell::new((0, 0));
+}
+
+/// Restart the numbering and the simulated time of the operations traced by this thread.
+pub fn reset_clock() {
+    CLOCK.with(|clock| clock.set((0, 0)));
+}
+
+/// Take the sequence number and start time of an operation lasting `ns`.
+pub(crate) fn tick(ns: u64) -> (u64, u64) {
+    CLOCK.with(|clock| {
+        let (seq, time) = clock.get();
+        clock.set((seq + 1, time + ns));
+        (seq, time)
+    })
+}
+
+impl FlashTiming {
+    /// The time taken by an operation according to this model.
+    pub fn cost(&self, op: TraceOp, len: usize, sectors: usize) -> u64 {
+        let len = len as u64;
+        match op {
+            TraceOp::Read => self.read_setup + len * self.read_byte,
+            TraceOp::Write => self.write_setup + len * self.write_byte,
+            TraceOp::Erase => sectors as u64 * self.erase_sector + len * self.erase_byte,
+        }
+    }
+
+    /// A model by name: `internal` and `spi` are the generic models used by the simulator, the
+    /// others use typical datasheet figures of common parts.
+    pub fn named(name: &str) -> Option<FlashTiming> {
+        Some(match name {
+            "internal" => FlashTiming::internal(),
+            "spi" => FlashTiming::spi(),
+            // nRF52840: 41 us per 32-bit word, 85 ms per 4 KiB page.
+            "nrf52840" => FlashTiming {
+                read_setup: 0,
+                read_byte: 15,
+                write_setup: 0,
+                write_byte: 10_250,
+                erase_sector: 85_000_000,
+                erase_byte: 0,
+            },
+            // STM32F4 at 3.3 V: 16 us per 32-bit word, sectors of 16 to 128 KiB at about 1 s per
+            // 128 KiB.
+            "stm32f4" => FlashTiming {
+                read_setup: 0,
+                read_byte: 6,
+                write_setup: 0,
+                write_byte: 4_000,
+                erase_sector: 0,
+                erase_byte: 8_000,
+            },
+            // W25Q128JV on a 50 MHz quad SPI bus: 0.4 ms per 256 byte page, 45 ms per 4 KiB
+            // sector.
+            "w25q128" => FlashTiming {
+                read_setup: 1_000,
+                read_byte: 40,
+                write_setup: 10_000,
+                write_byte: 1_500,
+                erase_sector: 45_000_000,
+                erase_byte: 0,
+            },
+            _ => return None,
+        })
+    }
+}
+
+/// A timing model is either given by name, see `FlashTiming::named`, or as a comma separated list
+/// of `field=ns` settings of the fields to change from a free model, such as
+/// `write_byte=2500,erase_sector=30000000`.
+impl FromStr for FlashTiming {
+    type Err = String;
+
+    fn from_str(text: &str) -> std::result::Result<FlashTiming, String> {
+        if let Some(timing) = FlashTiming::named(text) {
+            return Ok(timing);
+        }
+
+        let mut timing = FlashTiming::default();
+        for setting in text.split(',') {
+            let (field, value) = setting.split_once('=')
+                .ok_or_else(|| format!("Unknown timing model: {}", text))?;
+            let value: u64 = value.trim().parse()
+                .map_err(|_| format!("Invalid time: {}", setting))?;
+            match field.trim() {
+                "read_setup" => timing.read_setup = value,
+                "read_byte" => timing.read_byte = value,
+                "write_setup" => timing.write_setup = value,
+                "write_byte" => timing.write_byte = value,
+                "erase_sector" => timing.erase_sector = value,
+                "erase_byte" => timing.erase_byte = value,
+                field => return Err(format!("Unknown timing field: {}", field)),
+            }
+        }
+        Ok(timing)
+    }
+}
+
+impl FlashStats {
+    /// Count an operation, taking the time given by `timing`.
+    pub fn account(&mut self, timing: &FlashTiming, op: TraceOp, len: usize, sectors: usize) {
+        match op {
+            TraceOp::Read => {
+                self.reads += 1;
+                self.read_bytes += len as u64;
+            }
+            TraceOp::Write => {
+                self.writes += 1;
+                self.write_bytes += len as u64;
+            }
+            TraceOp::Erase => {
+                self.erases += 1;
+                self.erase_bytes += len as u64;
+            }
+        }
+        self.elapsed_ns += timing.cost(op, len, sectors);
+    }
+}
+
+/// Replay a trace with the timing model returned by `timing` for each device, and return the
+/// statistics of each device.
+pub fn replay<F>(trace: &[TraceEntry], timing: F) -> BTreeMap<u8, FlashStats>
+    where F: Fn(u8) -> FlashTiming
+{
+    let mut stats = BTreeMap::new();
+    for entry in trace {
+        let model = timing(entry.dev_id);
+        stats.entry(entry.dev_id)
+            .or_insert_with(FlashStats::default)
+            .account(&model, entry.op, entry.len, entry.sectors);
+    }
+    stats
+}
+
+/// An entry is written as one line: sequence number, start time, device, operation (`r`, `w` or
+/// `e`), offset in hex, length and number of sectors.
+impl fmt::Display for TraceEntry {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let op = match self.op {
+            TraceOp::Read => 'r',
+            TraceOp::Write => 'w',
+            TraceOp::Erase => 'e',
+        };
+        write!(f, "{} {} {} {} 0x{:x} {} {}",
+               self.seq, self.time_ns, self.dev_id, op, self.offset, self.len, self.sectors)
+    }
+}
+
+impl FromStr for TraceEntry {
+    type Err = String;
+
+    fn from_str(line: &str) -> std::result::Result<TraceEntry, String> {
+        let fields: Vec<&str> = line.split_whitespace().collect();
+        if fields.len() != 7 {
+            return Err(format!("Invalid trace line: {}", line));
+        }
+        let invalid = |_| format!("Invalid trace line: {}", line);
+
+        let op = match fields[3] {
+            "r" => TraceOp::Read,
+            "w" => TraceOp::Write,
+            "e" => TraceOp::Erase,
+            _ => return Err(format!("Invalid trace line: {}", line)),
+        };
+        let offset = fields[4].strip_prefix("0x").unwrap_or(fields[4]);
+
+        Ok(TraceEntry {
+            seq: fields[0].parse().map_err(invalid)?,
+            time_ns: fields[1].parse().map_err(invalid)?,
+            dev_id: fields[2].parse().map_err(invalid)?,
+            op,
+            offset: usize::from_str_radix(offset, 16).map_err(invalid)?,
+            len: fields[5].parse().map_err(invalid)?,
+            sectors: fields[6].parse().map_err(invalid)?,
+        })
+    }
+}
+
+/// Save a trace as text, one entry per line.
+pub fn write_trace<P: AsRef<Path>>(path: P, trace: &[TraceEntry]) -> Result<()> {
+    let mut text = String::from("# seq time-ns dev op offset len sectors\n");
+    for entry in trace {
+        text.push_str(&entry.to_string());
+        text.push('\n');
+    }
+    fs::write(path, text)?;
+    Ok(())
+}
+
+/// Load a trace saved by `write_trace`.  Lines starting with '#' are comments.
+pub fn read_trace<P: AsRef<Path>>(path: P) -> Result<Vec<TraceEntry>> {
+    let text = fs::read_to_string(path)?;
+    text.lines()
+        .map(|line| line.trim())
+        .filter(|line| !line.is_empty() && !line.starts_with('#'))
+        .map(|line| line.parse().map_err(FlashError::Trace))
+        .collect()
+}
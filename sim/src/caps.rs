@@ -30,6 +30,10 @@ pub enum Caps {
     DirectXip            = (1 << 17),
     HwRollbackProtection = (1 << 18),
     EcdsaP384            = (1 << 19),
+    SwapUsingOffset      = (1 << 20),
+    SwapUsingBank        = (1 << 21),
+    SwapPermDiscard      = (1 << 22),
+    OverwriteVerifyCopy  = (1 << 23),
 }
 
 impl Caps {
@@ -0,0 +1,229 @@
+// Copyright (c) 2026, NOWATCH BV
+//
+// SPDX-License-Identifier: Apache-2.0
+
+//! Fuzzing of the parsing of untrusted images by the bootloader.
+//!
+//! A `Fuzzer` writes each input into a slot of one of the simulated devices, kept in memory
+//! between the inputs, and runs a part of the bootloader on it.  It is meant to be driven by
+//! libFuzzer, through the targets in `sim/fuzz`, but also carries a simple mutator of its seed
+//! image so that the throughput of the targets can be measured without one.
+
+use mcuboot_sys::{c, AreaDesc, FlashId};
+use rand::{rngs::SmallRng, Rng, SeedableRng};
+use serde_derive::Deserialize;
+use simflash::{Flash, SimMultiFlash};
+use std::{
+    rc::Rc,
+    time::{Duration, Instant},
+};
+
+use crate::caps::Caps;
+use crate::image::{mark_upgrade, SlotInfo};
+use crate::{DeviceName, ImagesBuilder};
+
+/// Size of the payload of the seed image.  Small images keep the inputs, and the time spent
+/// hashing them, small.
+pub const FUZZ_IMAGE_SIZE: usize = 512;
+
+/// The part of the bootloader run on each input.
+#[derive(Copy, Clone, Debug, Deserialize, PartialEq, Eq)]
+pub enum FuzzTarget {
+    /// The header checks and the TLV iterator, with the TLV index of the build if it has one,
+    /// checked against a walk of the TLVs in flash.  No crypto is done.
+    Tlv,
+    /// The same parsing, then the validation of the image, hash and signature.
+    Validate,
+    /// A whole boot, with the input marked as an upgrade in the secondary slot.
+    Upgrade,
+}
+
+impl FuzzTarget {
+    pub fn name(self) -> &'static str {
+        match self {
+            FuzzTarget::Tlv => "tlv",
+            FuzzTarget::Validate => "validate",
+            FuzzTarget::Upgrade => "upgrade",
+        }
+    }
+}
+
+pub static ALL_FUZZ_TARGETS: &[FuzzTarget] = &[
+    FuzzTarget::Tlv,
+    FuzzTarget::Validate,
+    FuzzTarget::Upgrade,
+];
+
+/// Counts of a run of the mutator.
+#[derive(Clone, Copy, Debug)]
+pub struct FuzzStats {
+    pub execs: usize,
+    /// Inputs accepted by the target.
+    pub accepted: usize,
+    pub elapsed: Duration,
+}
+
+impl FuzzStats {
+    pub fn execs_per_sec(&self) -> f64 {
+        self.execs as f64 / self.elapsed.as_secs_f64()
+    }
+}
+
+pub struct Fuzzer {
+    target: FuzzTarget,
+    /// The flash the inputs are written to.  For the upgrade target, the flash before each boot,
+    /// with the secondary slot erased.
+    flash: SimMultiFlash,
+    areadesc: Rc<AreaDesc>,
+    primary: SlotInfo,
+    /// The slot the inputs are written to, and where in its device.
+    slot: SlotInfo,
+    off: usize,
+    /// Bytes written by the previous input.
+    dirty: usize,
+    seed: Vec<u8>,
+    buf: Vec<u8>,
+}
+
+impl Fuzzer {
+    /// A fuzzer of `target` on the K64F, the device the fuzz targets use.
+    pub fn new(target: FuzzTarget) -> Fuzzer {
+        Fuzzer::on_device(DeviceName::K64f, target).unwrap()
+    }
+
+    /// A fuzzer of `target` on `device`, seeded with a valid image.
+    pub fn on_device(device: DeviceName, target: FuzzTarget) -> Result<Fuzzer, String> {
+        ImagesBuilder::new(device, 1, 0xff)?
+            .make_bench_image(FUZZ_IMAGE_SIZE, false)
+            .fuzzer(target)
+    }
+
+    pub(crate) fn with_flash(target: FuzzTarget, mut flash: SimMultiFlash, areadesc: Rc<AreaDesc>,
+                             slots: &[SlotInfo], seed: Vec<u8>) -> Result<Fuzzer, String> {
+        let (slot, id) = match target {
+            FuzzTarget::Tlv | FuzzTarget::Validate => {
+                if Caps::RamLoad.present() {
+                    return Err("ram-load reads the TLVs from RAM".to_string());
+                }
+                (slots[0].clone(), FlashId::Image0)
+            }
+            FuzzTarget::Upgrade => (slots[1].clone(), FlashId::Image1),
+        };
+        let (base, len, dev_id) = areadesc.find(id).unwrap();
+        let dev = flash.get_mut(&dev_id).unwrap();
+        dev.erase(base, len).unwrap();
+        if target != FuzzTarget::Upgrade {
+            // The bootloader is never run on this flash, so the inputs can overwrite each other
+            // without erasing the slot.
+            dev.set_verify_writes(false);
+        }
+        // With swap-using-offset, an upgrade is written one sector into the secondary slot.
+        let off = if target == FuzzTarget::Upgrade && Caps::SwapUsingOffset.present() {
+            slot.base_off + dev.sector_iter().next().unwrap().size
+        } else {
+            slot.base_off
+        };
+
+        Ok(Fuzzer {
+            target,
+            flash,
+            areadesc,
+            primary: slots[0].clone(),
+            slot,
+            off,
+            dirty: 0,
+            seed,
+            buf: vec![],
+        })
+    }
+
+    pub fn target(&self) -> FuzzTarget {
+        self.target
+    }
+
+    /// A valid image, to start the corpus with.
+    pub fn seed(&self) -> &[u8] {
+        &self.seed
+    }
+
+    /// Run the target on `data`.  Returns whether the image was accepted by the parsing, or its
+    /// validation, or, for the upgrade target, installed in the primary slot.  A boot which fails
+    /// or asserts is a bug: whatever the upgrade, the primary slot still holds a valid image.
+    pub fn run(&mut self, data: &[u8]) -> bool {
+        match self.target {
+            FuzzTarget::Tlv | FuzzTarget::Validate => {
+                let dirty = self.dirty;
+                let len = self.write(data, dirty);
+                self.dirty = len;
+                c::fuzz_image(&mut self.flash, &self.areadesc,
+                              self.target == FuzzTarget::Validate).unwrap()
+            }
+            FuzzTarget::Upgrade => {
+                let pristine = self.flash.clone();
+                let len = self.write(data, 0);
+                mark_upgrade(&mut self.flash, &self.slot);
+                let result = c::boot_go(&mut self.flash, &self.areadesc, None, None, false);
+                assert!(result.success_no_asserts(), "Boot failed after an upgrade: {:?}", result);
+
+                let mut primary = vec![0u8; len];
+                let dev = &self.flash[&self.primary.dev_id];
+                let installed = len > 0 && dev.read(self.primary.base_off, &mut primary).is_ok() &&
+                    primary == data[..len];
+                self.flash = pristine;
+                installed
+            }
+        }
+    }
+
+    /// Write `data` at the start of the slot, truncated to what the slot holds before its
+    /// trailer, over the `dirty` bytes written last time.  Returns the number of bytes of `data`
+    /// written.
+    fn write(&mut self, data: &[u8], dirty: usize) -> usize {
+        let dev = self.flash.get_mut(&self.slot.dev_id).unwrap();
+        let align = dev.align();
+        let erased_val = dev.erased_val();
+        let room = match self.target {
+            FuzzTarget::Upgrade => self.slot.trailer_off - self.off,
+            _ => self.slot.len,
+        };
+        let len = data.len().min(room);
+
+        self.buf.clear();
+        self.buf.extend_from_slice(&data[..len]);
+        let total = (len.max(dirty) + align - 1) / align * align;
+        self.buf.resize(total.min(room / align * align), erased_val);
+        dev.write(self.off, &self.buf).unwrap();
+        len
+    }
+
+    /// Run the target on `execs` mutations of the seed image, a few bytes of the header or of
+    /// the TLVs changed, or the image truncated.
+    pub fn run_mutations(&mut self, execs: usize, rng_seed: u64) -> FuzzStats {
+        let mut rng = SmallRng::seed_from_u64(rng_seed);
+        let seed = self.seed.clone();
+        let tlv_start = seed.len().saturating_sub(256);
+        let mut input = Vec::with_capacity(seed.len());
+        let mut accepted = 0;
+
+        let start = Instant::now();
+        for _ in 0..execs {
+            input.clear();
+            input.extend_from_slice(&seed);
+            for _ in 0..rng.gen_range(1..=4) {
+                let pos = if rng.gen() {
+                    rng.gen_range(0..32)
+                } else {
+                    rng.gen_range(tlv_start..seed.len())
+                };
+                input[pos] = rng.gen();
+            }
+            if rng.gen_ratio(1, 8) {
+                input.truncate(rng.gen_range(0..seed.len()));
+            }
+            if self.run(&input) {
+                accepted += 1;
+            }
+        }
+        FuzzStats { execs, accepted, elapsed: start.elapsed() }
+    }
+}
@@ -19,7 +19,12 @@ use rand::{
     rngs::SmallRng,
 };
 use std::{
-    collections::{BTreeMap, HashSet}, io::{Cursor, Write}, mem, rc::Rc, slice
+    collections::{BTreeMap, HashMap, HashSet, hash_map::DefaultHasher},
+    hash::{Hash, Hasher},
+    io::{Cursor, Write}, mem, rc::Rc, slice,
+    sync::{Mutex, OnceLock},
+    thread,
+    time::{Duration, Instant},
 };
 use aes::{
     Aes128,
@@ -34,10 +39,11 @@ use cipher::{
     StreamCipher,
     };
 
-use simflash::{Flash, SimFlash, SimMultiFlash};
-use mcuboot_sys::{c, AreaDesc, FlashId, RamBlock};
+use simflash::{Flash, FlashStats, FlashTiming, SimFlash, SimMultiFlash, trace::{self, TraceEntry}};
+use mcuboot_sys::{api::{self, FlashOp}, c, AreaDesc, FlashId, RamBlock};
 use crate::{
     ALL_DEVICES,
+    LARGE_DEVICES,
     DeviceName,
 };
 use crate::caps::Caps;
@@ -50,7 +56,10 @@ use crate::depends::{
     PairDep,
     UpgradeInfo,
 };
+use crate::fuzz::{FuzzTarget, Fuzzer};
 use crate::tlv::{ManifestGen, TlvGen, TlvFlags};
+#[cfg(feature = "serial-recovery")]
+use crate::serial::{SerialHost, SerialUpload, UploadStats};
 use crate::utils::align_up;
 use typenum::{U32, U16};
 
@@ -67,8 +76,20 @@ pub struct ImagesBuilder {
     areadesc: Rc<AreaDesc>,
     slots: Vec<[SlotInfo; 2]>,
     ram: RamData,
+    // Identifies the device configuration in the image cache.
+    name: String,
 }
 
+/// The part of an `Images` kept in the image cache.  The area descriptor and RAM layout are not
+/// shareable between threads, and are taken from the builder instead.
+struct CachedImages {
+    flash: SimMultiFlash,
+    images: Vec<OneImage>,
+    total_count: Option<i32>,
+}
+
+static IMAGE_CACHE: OnceLock<Mutex<HashMap<String, CachedImages>>> = OnceLock::new();
+
 /// Images represents the state of a simulation for a given set of images.
 /// The flash holds the state of the simulated flash, whereas primaries
 /// and upgrades hold the expected contents of these images.
@@ -82,6 +103,7 @@ pub struct Images {
 
 /// When doing multi-image, there is an instance of this information for
 /// each of the images.  Single image there will be one of these.
+#[derive(Clone)]
 struct OneImage {
     slots: [SlotInfo; 2],
     primaries: ImageData,
@@ -91,6 +113,7 @@ struct OneImage {
 /// The Rust-side representation of an image.  For unencrypted images, this
 /// is just the unencrypted payload.  For encrypted images, we store both
 /// the encrypted and the plaintext.
+#[derive(Clone)]
 struct ImageData {
     size: usize,
     plain: Vec<u8>,
@@ -130,6 +153,8 @@ pub enum ImageManipulation {
     /// false to overlap by 1 byte
     OverlapImages(bool),
     CorruptHigherVersionImage,
+    /// Change the payload after its hash TLV and signature are made.
+    CorruptPayload,
 }
 
 
@@ -146,6 +171,14 @@ impl ImagesBuilder {
             }
         }
 
+        for &id in &[FlashId::Image0, FlashId::Image1, FlashId::Image2, FlashId::Image3] {
+            let sectors = areadesc.num_sectors(id).unwrap_or(0);
+            if sectors > c::boot_max_img_sectors() {
+                return Err(format!("{} sectors in {:?}, more than {}", sectors, id,
+                                   c::boot_max_img_sectors()));
+            }
+        }
+
         let num_images = Caps::get_num_images();
 
         let mut slots = Vec::with_capacity(num_images);
@@ -201,22 +234,80 @@ impl ImagesBuilder {
             areadesc,
             slots,
             ram,
+            name: format!("{}-{}-{:x}", device, align, erased_val),
         })
     }
 
+    /// Run `f` on a builder for each device, alignment and erased value.  The configurations are
+    /// run on a pool of threads; the simulator state used by the C code is thread local, so they
+    /// don't interfere.  Setting `MCUBOOT_SERIAL_TESTS` runs them one after the other, which is
+    /// always the case with the PSA crypto API, whose state is global.
     pub fn each_device<F>(f: F)
-        where F: Fn(Self)
+        where F: Fn(Self) + Sync
     {
+        // The status area sized for the large devices does not fit the small ones.
+        if cfg!(feature = "large-flash") {
+            warn!("Skipping the regular devices in a large-flash build");
+            return;
+        }
+
+        let mut configs = Vec::new();
         for &dev in ALL_DEVICES {
             for &align in test_alignments() {
                 for &erased_val in &[0, 0xff] {
-                    match Self::new(dev, align, erased_val) {
-                        Ok(run) => f(run),
-                        Err(msg) => warn!("Skipping {}: {}", dev, msg),
-                    }
+                    configs.push((dev, align, erased_val));
                 }
             }
         }
+
+        Self::each_config(configs, f);
+    }
+
+    /// Run `f` on a builder for each of the large devices.  Only two configurations of each are
+    /// run, as their images take several megabytes: the smallest alignment with a flash erased to
+    /// 0xff, and the largest one with a flash erased to 0.  Without the `large-flash` feature
+    /// they are all skipped.
+    pub fn each_large_device<F>(f: F)
+        where F: Fn(Self) + Sync
+    {
+        let aligns = test_alignments();
+        let mut configs = Vec::new();
+        for &dev in LARGE_DEVICES {
+            configs.push((dev, aligns[0], 0xff));
+            configs.push((dev, aligns[aligns.len() - 1], 0));
+        }
+
+        Self::each_config(configs, f);
+    }
+
+    fn each_config<F>(configs: Vec<(DeviceName, usize, u8)>, f: F)
+        where F: Fn(Self) + Sync
+    {
+        let workers = if cfg!(feature = "sig-ecdsa-psa") ||
+            std::env::var("MCUBOOT_SERIAL_TESTS").is_ok() {
+            1
+        } else {
+            thread::available_parallelism().map(|n| n.get()).unwrap_or(1)
+        };
+
+        let queue = Mutex::new(configs.into_iter());
+        thread::scope(|scope| {
+            for _ in 0..workers {
+                scope.spawn(|| {
+                    loop {
+                        let next = queue.lock().unwrap().next();
+                        let (dev, align, erased_val) = match next {
+                            Some(config) => config,
+                            None => break,
+                        };
+                        match Self::new(dev, align, erased_val) {
+                            Ok(run) => f(run),
+                            Err(msg) => warn!("Skipping {}: {}", dev, msg),
+                        }
+                    }
+                });
+            }
+        });
     }
 
     /// Construct an `Images` that doesn't expect an upgrade to happen.
@@ -267,7 +358,97 @@ impl ImagesBuilder {
         }
     }
 
+    /// Give each flash device a timing model: device 0 is the internal flash of the MCU, any
+    /// other device is an external SPI flash.  This only affects the statistics of the devices.
+    pub fn with_timing(mut self) -> Self {
+        for (&dev_id, dev) in self.flash.iter_mut() {
+            dev.set_timing(if dev_id == 0 { FlashTiming::internal() } else { FlashTiming::spi() });
+        }
+        self
+    }
+
+    /// Construct an `Images` for benchmarking, with a primary and a secondary image of the given
+    /// size in each slot.  If `upgrade` is set, the secondary images are marked for upgrade.
+    pub fn make_bench_image(self, size: usize, upgrade: bool) -> Images {
+        let mut flash = self.flash;
+        let ram = self.ram.clone();  // TODO: Avoid this clone.
+        let images = self.slots.into_iter().enumerate().map(|(image_num, slots)| {
+            let dep = BoringDep::new(image_num, &NO_DEPS);
+            let primaries = install_image(&mut flash, &slots[0], ImageSize::Given(size),
+                                          &ram, &dep, ImageManipulation::None, Some(0));
+            let upgrades = install_image(&mut flash, &slots[1], ImageSize::Given(size),
+                                         &ram, &dep, ImageManipulation::None, Some(0));
+            if upgrade {
+                mark_upgrade(&mut flash, &slots[1]);
+            }
+            OneImage {
+                slots,
+                primaries,
+                upgrades,
+            }}).collect();
+        install_ptable(&mut flash, &self.areadesc);
+        Images {
+            flash,
+            areadesc: self.areadesc,
+            images,
+            total_count: None,
+            ram: self.ram,
+        }
+    }
+
+    /// Construct an `Images` for the large devices, with marked upgrades filling `percent` percent
+    /// of the smallest slot, and the primary images the same size.
+    pub fn make_large_bench_image(self, percent: usize) -> Images {
+        let slot_len = self.slots.iter()
+            .flat_map(|slots| slots.iter().map(|slot| slot.len))
+            .min()
+            .unwrap();
+        self.make_bench_image(slot_len / 100 * percent, true)
+    }
+
+    /// Like `make_large_bench_image`, also counting the flash operations of a basic upgrade so
+    /// that failures can be injected, as `make_image` does.
+    pub fn make_large_image(self, percent: usize) -> Images {
+        let mut images = self.make_large_bench_image(percent);
+        if Caps::modifies_flash() {
+            match images.run_basic_upgrade(true) {
+                Some(count) => images.total_count = Some(count),
+                None => panic!("Unable to perform basic upgrade"),
+            }
+        }
+        images
+    }
+
+    /// Construct an `Images` with the upgrades marked, after checking that a basic upgrade works.
+    /// The result only depends on the device and on the arguments, so it is built once and then
+    /// shared by all the tests asking for it, unless `MCUBOOT_NO_IMAGE_CACHE` is set.
     pub fn make_image(self, deps: &DepTest, permanent: bool) -> Images {
+        if std::env::var("MCUBOOT_NO_IMAGE_CACHE").is_ok() {
+            return self.build_image(deps, permanent);
+        }
+
+        let key = format!("{}-{:?}-{}", self.name, deps, permanent);
+        let cache = IMAGE_CACHE.get_or_init(|| Mutex::new(HashMap::new()));
+        if let Some(cached) = cache.lock().unwrap().get(&key) {
+            return Images {
+                flash: cached.flash.clone(),
+                areadesc: self.areadesc,
+                images: cached.images.clone(),
+                total_count: cached.total_count,
+                ram: self.ram,
+            };
+        }
+
+        let images = self.build_image(deps, permanent);
+        cache.lock().unwrap().insert(key, CachedImages {
+            flash: images.flash.clone(),
+            images: images.images.clone(),
+            total_count: images.total_count,
+        });
+        images
+    }
+
+    fn build_image(self, deps: &DepTest, permanent: bool) -> Images {
         let mut images = self.make_no_upgrade_image(deps, ImageManipulation::None);
         for image in &images.images {
             mark_upgrade(&mut images.flash, &image.slots[1]);
@@ -294,6 +475,14 @@ impl ImagesBuilder {
     }
 
     pub fn make_bad_secondary_slot_image(self) -> Images {
+        self.make_manipulated_secondary_slot_image(ImageManipulation::BadSignature)
+    }
+
+    pub fn make_corrupt_secondary_slot_image(self) -> Images {
+        self.make_manipulated_secondary_slot_image(ImageManipulation::CorruptPayload)
+    }
+
+    fn make_manipulated_secondary_slot_image(self, img_manipulation: ImageManipulation) -> Images {
         let mut bad_flash = self.flash;
         let ram = self.ram.clone(); // TODO: Avoid this clone.
         let images = self.slots.into_iter().enumerate().map(|(image_num, slots)| {
@@ -301,7 +490,7 @@ impl ImagesBuilder {
             let primaries = install_image(&mut bad_flash, &slots[0],
                 maximal(32784), &ram, &dep, ImageManipulation::None, Some(0));
             let upgrades = install_image(&mut bad_flash, &slots[1],
-                maximal(41928), &ram, &dep, ImageManipulation::BadSignature, Some(0));
+                maximal(41928), &ram, &dep, img_manipulation, Some(0));
             OneImage {
                 slots,
                 primaries,
@@ -451,7 +640,7 @@ impl ImagesBuilder {
 
                 let mut flash = SimMultiFlash::new();
                 flash.insert(dev_id, dev);
-                (flash, Rc::new(areadesc), &[Caps::SwapUsingMove])
+                (flash, Rc::new(areadesc), &[Caps::SwapUsingMove, Caps::SwapUsingOffset])
             }
             DeviceName::K64f => {
                 // NXP style flash.  Small sectors, one small sector for scratch.
@@ -482,7 +671,7 @@ impl ImagesBuilder {
 
                 let mut flash = SimMultiFlash::new();
                 flash.insert(dev_id, dev);
-                (flash, Rc::new(areadesc), &[Caps::SwapUsingMove])
+                (flash, Rc::new(areadesc), &[Caps::SwapUsingMove, Caps::SwapUsingOffset])
             }
             DeviceName::Nrf52840 => {
                 // Simulating the flash on the nrf52840 with partitions set up so that the scratch size
@@ -530,7 +719,7 @@ impl ImagesBuilder {
                 let mut flash = SimMultiFlash::new();
                 flash.insert(0, dev0);
                 flash.insert(1, dev1);
-                (flash, Rc::new(areadesc), &[Caps::SwapUsingMove])
+                (flash, Rc::new(areadesc), &[Caps::SwapUsingMove, Caps::SwapUsingOffset])
             }
             DeviceName::K64fMulti => {
                 // NXP style flash, but larger, to support multiple images.
@@ -549,6 +738,43 @@ impl ImagesBuilder {
                 flash.insert(dev_id, dev);
                 (flash, Rc::new(areadesc), &[])
             }
+            DeviceName::Large8M => {
+                // A 16 MB QSPI style flash with 4 KB sectors, holding two 8 MB slots, so 2048
+                // sectors per slot.  The scratch area is large enough for the status area of
+                // the large-flash build.
+                let dev = SimFlash::new(vec![4096; 4192], align as usize, erased_val);
+
+                let dev_id = 0;
+                let mut areadesc = AreaDesc::new();
+                areadesc.add_flash_sectors(dev_id, &dev);
+                areadesc.add_image(0x0020000, 0x800000, FlashId::Image0, dev_id);
+                areadesc.add_image(0x0820000, 0x800000, FlashId::Image1, dev_id);
+                areadesc.add_image(0x1020000, 0x040000, FlashId::ImageScratch, dev_id);
+
+                let mut flash = SimMultiFlash::new();
+                flash.insert(dev_id, dev);
+                (flash, Rc::new(areadesc), &[])
+            }
+            DeviceName::Large16MSpiFlash => {
+                // A 16 MB primary slot with 4 KB sectors, and the secondary slot and the scratch
+                // area on an external flash with 64 KB sectors, as for an application executed in
+                // place from a large internal or memory mapped flash.
+                let dev0 = SimFlash::new(vec![4096; 4128], align as usize, erased_val);
+                let dev1 = SimFlash::new(vec![65536; 260], align as usize, erased_val);
+
+                let mut areadesc = AreaDesc::new();
+                areadesc.add_flash_sectors(0, &dev0);
+                areadesc.add_flash_sectors(1, &dev1);
+
+                areadesc.add_image(0x0020000, 0x1000000, FlashId::Image0, 0);
+                areadesc.add_image(0x0000000, 0x1000000, FlashId::Image1, 1);
+                areadesc.add_image(0x1000000, 0x0040000, FlashId::ImageScratch, 1);
+
+                let mut flash = SimMultiFlash::new();
+                flash.insert(0, dev0);
+                flash.insert(1, dev1);
+                (flash, Rc::new(areadesc), &[Caps::SwapUsingMove, Caps::SwapUsingOffset])
+            }
         }
     }
 
@@ -575,6 +801,215 @@ impl Images {
         }
     }
 
+    /// Boot once from a copy of the flash and return the flash statistics of that boot, summed
+    /// over all devices, or None if the boot failed.
+    pub fn bench_boot(&self) -> Option<FlashStats> {
+        let mut flash = self.flash.clone();
+        for dev in flash.values_mut() {
+            dev.reset_stats();
+        }
+
+        if !c::boot_go(&mut flash, &self.areadesc, None, None, false).success() {
+            return None;
+        }
+
+        let mut stats = FlashStats::default();
+        for dev in flash.values() {
+            stats += dev.stats();
+        }
+        Some(stats)
+    }
+
+    /// Boot once from a copy of the flash, recording the operations on every device, and return
+    /// them in the order they were done, or None if the boot failed.
+    pub fn trace_boot(&self) -> Option<Vec<TraceEntry>> {
+        let mut flash = self.flash.clone();
+        trace::reset_clock();
+        for (&dev_id, dev) in flash.iter_mut() {
+            dev.reset_stats();
+            dev.set_trace(Some(dev_id));
+        }
+
+        if !c::boot_go(&mut flash, &self.areadesc, None, None, false).success() {
+            return None;
+        }
+
+        let mut trace: Vec<TraceEntry> = flash.values_mut().flat_map(|dev| dev.take_trace()).collect();
+        trace.sort_by_key(|entry| entry.seq);
+        Some(trace)
+    }
+
+    /// Upload the first upgrade image into the first primary slot through serial recovery, on a
+    /// copy of the flash, and check that it was written and boots.  Returns the statistics of the
+    /// upload, or None if it failed.
+    #[cfg(feature = "serial-recovery")]
+    pub fn run_serial_upload(&self, upload: &SerialUpload) -> Option<UploadStats> {
+        let mut flash = self.flash.clone();
+        for dev in flash.values_mut() {
+            dev.reset_stats();
+        }
+
+        let image = &self.images[0];
+        let align = flash[&image.slots[0].dev_id].align();
+        let mut host = SerialHost::new(upload, &image.upgrades.plain, align);
+        let exit = c::boot_serial(&mut flash, &self.areadesc, &mut host);
+        let stats = host.finish(exit)?;
+
+        if !verify_image(&flash, &image.slots[0], &image.upgrades) {
+            warn!("Uploaded image mismatch");
+            return None;
+        }
+        if !c::boot_go(&mut flash, &self.areadesc, None, None, false).success() {
+            warn!("Uploaded image does not boot");
+            return None;
+        }
+        Some(stats)
+    }
+
+    /// A fuzzer of `target` writing its inputs into a slot of the first image, on a copy of the
+    /// flash, and seeded with the image installed in that slot.
+    pub fn fuzzer(&self, target: FuzzTarget) -> Result<Fuzzer, String> {
+        let image = &self.images[0];
+        let seed = match target {
+            FuzzTarget::Upgrade => image.upgrades.find(1),
+            FuzzTarget::Tlv | FuzzTarget::Validate => image.primaries.find(0),
+        };
+        Fuzzer::with_flash(target, self.flash.clone(), self.areadesc.clone(), &image.slots,
+                           seed.clone())
+    }
+
+    /// Check how an upgrade scales with the image size, by comparing its flash operations with
+    /// those of the upgrade of `larger`, built on the same device with images twice as large.
+    /// No count, nor the simulated time of the operations, may grow faster than the images, and
+    /// the bytes written and erased must stay within a few passes over them: more would point at
+    /// work done per sector or per status entry that does not scale to large slots.  Returns true
+    /// on failure.
+    pub fn run_scaling_check(&self, larger: &Images) -> bool {
+        let (small, large) = match (self.bench_boot(), larger.bench_boot()) {
+            (Some(small), Some(large)) => (small, large),
+            _ => {
+                error!("Upgrade failed");
+                return true;
+            }
+        };
+
+        let size: u64 = larger.images.iter().map(|image| image.upgrades.size as u64).sum();
+        let slots: u64 = larger.images.iter().map(|image| image.slots[0].len as u64).sum();
+        info!("Upgrade of {} bytes: {:?}, of {} bytes: {:?}", size / 2, small, size, large);
+
+        let mut fails = 0;
+        let counts = [
+            ("reads", small.reads, large.reads),
+            ("read bytes", small.read_bytes, large.read_bytes),
+            ("writes", small.writes, large.writes),
+            ("write bytes", small.write_bytes, large.write_bytes),
+            ("erases", small.erases, large.erases),
+            ("erase bytes", small.erase_bytes, large.erase_bytes),
+            ("simulated ns", small.elapsed_ns, large.elapsed_ns),
+        ];
+        for &(name, before, after) in &counts {
+            // Twice as much, plus some slack for the rounding of the images to the sectors.
+            if after > before * 9 / 4 + 64 {
+                error!("{} went from {} to {} with images twice as large", name, before, after);
+                fails += 1;
+            }
+        }
+
+        // The swap strategies go over each sector of the image three times, the trailers and
+        // the scratch area account for the rest.
+        for &(name, bytes) in &[("write bytes", large.write_bytes),
+                                ("erase bytes", large.erase_bytes)] {
+            if bytes > SCALING_PASSES * size + slots / 4 {
+                error!("{} {} for an image of {} bytes", bytes, name, size);
+                fails += 1;
+            }
+        }
+
+        fails > 0
+    }
+
+    /// Time `iters` validations of the first primary image, or None if the validation failed.
+    pub fn time_validate(&self, iters: u32) -> Option<Duration> {
+        let mut flash = self.flash.clone();
+        let start = Instant::now();
+        if !c::kernel_validate(&mut flash, &self.areadesc, iters) {
+            return None;
+        }
+        Some(start.elapsed())
+    }
+
+    /// Time `iters` copies of `len` bytes from the first secondary slot to the first primary slot,
+    /// or None if a copy failed.  The primary slot is not erased between the copies.
+    pub fn time_copy(&self, len: usize, iters: u32) -> Option<Duration> {
+        let mut flash = self.flash.clone();
+        let dev_id = self.images[0].slots[0].dev_id;
+        flash.get_mut(&dev_id).unwrap().set_verify_writes(false);
+        let start = Instant::now();
+        if !c::kernel_copy(&mut flash, &self.areadesc, len as u32, iters) {
+            return None;
+        }
+        Some(start.elapsed())
+    }
+
+    /// Run `cycles` upgrade cycles on a copy of the flash, and return it so the erase counts of
+    /// its sectors can be inspected.  Each cycle downloads the upgrade into the secondary slots
+    /// again, erasing them as a DFU agent would, boots to perform the upgrade and, unless the
+    /// upgrades overwrite, boots a second time to revert it.  Returns None if a boot failed.
+    pub fn run_wear_cycles(&self, cycles: usize) -> Option<SimMultiFlash> {
+        let mut flash = self.flash.clone();
+
+        // Only the programmed chunks of the download are written back, so that the trailer
+        // remains writable by the bootloader.
+        let downloads: Vec<(&SlotInfo, Vec<u8>)> = self.images.iter().map(|image| {
+            let slot = &image.slots[1];
+            let mut buf = vec![0; slot.len];
+            flash[&slot.dev_id].read(slot.base_off, &mut buf).unwrap();
+            (slot, buf)
+        }).collect();
+
+        for dev in flash.values_mut() {
+            dev.reset_erase_counts();
+        }
+
+        for _ in 0..cycles {
+            for (slot, buf) in &downloads {
+                let dev = flash.get_mut(&slot.dev_id).unwrap();
+                let align = dev.align();
+                let erased_val = dev.erased_val();
+                dev.erase(slot.base_off, slot.len).unwrap();
+                for (i, chunk) in buf.chunks(align).enumerate() {
+                    if chunk.iter().any(|&x| x != erased_val) {
+                        dev.write(slot.base_off + i * align, chunk).unwrap();
+                    }
+                }
+            }
+
+            if !c::boot_go(&mut flash, &self.areadesc, None, None, false).success() {
+                return None;
+            }
+            if !Caps::OverwriteUpgrade.present() &&
+                !c::boot_go(&mut flash, &self.areadesc, None, None, false).success() {
+                return None;
+            }
+        }
+
+        Some(flash)
+    }
+
+    /// The highest and the mean erase count of the sectors of the given flash area, or None if
+    /// the area does not exist on this device.
+    pub fn area_wear(&self, flash: &SimMultiFlash, id: FlashId) -> Option<(u32, f64)> {
+        let (base, len, dev_id) = self.areadesc.find(id)?;
+        let dev = &flash[&dev_id];
+        let counts: Vec<u32> = dev.sector_iter()
+            .filter(|sector| sector.base >= base && sector.base < base + len)
+            .map(|sector| dev.erase_counts()[sector.num])
+            .collect();
+        let max = counts.iter().copied().max()?;
+        let mean = counts.iter().map(|&x| x as f64).sum::<f64>() / counts.len() as f64;
+        Some((max, mean))
+    }
+
     pub fn run_bootstrap(&self) -> bool {
         let mut flash = self.flash.clone();
         let mut fails = 0;
@@ -653,7 +1088,13 @@ impl Images {
     }
 
     fn is_swap_upgrade(&self) -> bool {
-        Caps::SwapUsingScratch.present() || Caps::SwapUsingMove.present()
+        Caps::SwapUsingScratch.present() || Caps::SwapUsingMove.present() ||
+            Caps::SwapUsingOffset.present()
+    }
+
+    /// Does a permanent upgrade leave the previous image in the secondary slot.
+    fn keeps_perm_previous(&self) -> bool {
+        self.is_swap_upgrade() && !Caps::SwapPermDiscard.present()
     }
 
     pub fn run_basic_revert(&self) -> bool {
@@ -678,6 +1119,10 @@ impl Images {
         fails > 0
     }
 
+    /// Check the recovery from an interruption at each flash operation of a permanent upgrade.
+    /// The upgrade is run once with a journal of what it does to the flash, and the state of the
+    /// flash at each interruption point is rebuilt from that journal, rather than by replaying the
+    /// upgrade up to it.  Interruptions leaving the flash in a state already checked are skipped.
     pub fn run_perm_with_fails(&self) -> bool {
         if !Caps::modifies_flash() {
             return false;
@@ -690,13 +1135,53 @@ impl Images {
             return false;
         }
 
-        // Let's try an image halfway through.
-        for i in 1 .. total_flash_ops {
-            info!("Try interruption at {}", i);
-            let (flash, count) = self.try_upgrade(Some(i), true);
-            info!("Second boot, count={}", count);
+        let mut state = self.flash.clone();
+        self.mark_permanent_upgrades(&mut state, 1);
+
+        let mut flash = state.clone();
+        api::start_journal();
+        let result = c::boot_go(&mut flash, &self.areadesc, None, None, false);
+        let journal = api::take_journal();
+        if !result.success() {
+            warn!("Failed the uninterrupted upgrade");
+            return true;
+        }
+
+        let mut seen = HashSet::new();
+        let mut point = 0;
+        let mut checked = 0;
+        for op in &journal {
+            match op {
+                FlashOp::Write { dev_id, offset, data } => {
+                    state.get_mut(dev_id).unwrap().write(*offset, data).unwrap();
+                    continue;
+                }
+                FlashOp::Erase { dev_id, offset, len } => {
+                    state.get_mut(dev_id).unwrap().erase(*offset, *len).unwrap();
+                    continue;
+                }
+                FlashOp::Boundary => point += 1,
+            }
+
+            // `state` is now what an interruption of this operation leaves in the flash.
+            if point >= total_flash_ops {
+                continue;
+            }
+            if !seen.insert(flash_hash(&state)) {
+                continue;
+            }
+            checked += 1;
+
+            info!("Try interruption at {}", point);
+            let mut flash = state.clone();
+            if !c::boot_go(&mut flash, &self.areadesc, None, None, false).success() {
+                warn!("Failed boot after interruption at {}", point);
+                fails += 1;
+                continue;
+            }
+
             if !self.verify_images(&flash, 0, 1) {
-                warn!("FAIL at step {} of {}", i, total_flash_ops);
+                warn!("FAIL at step {} of {}", point, total_flash_ops);
                 fails += 1;
             }
 
@@ -712,13 +1197,20 @@ impl Images {
                 fails += 1;
             }
 
-            if self.is_swap_upgrade() && !self.verify_images(&flash, 1, 0) {
+            if self.keeps_perm_previous() && !self.verify_images(&flash, 1, 0) {
                 warn!("Secondary slot FAIL at step {} of {}",
-                    i, total_flash_ops);
+                    point, total_flash_ops);
                 fails += 1;
             }
         }
 
+        // The journal must account for everything the upgrade did.
+        if flash_hash(&state) != flash_hash(&flash) {
+            warn!("Flash journal does not match the upgrade");
+            fails += 1;
+        }
+
+        info!("Checked {} distinct interruption states out of {}", checked, total_flash_ops);
         if fails > 0 {
             error!("{} out of {} failed {:.2}%", fails, total_flash_ops,
                    fails as f32 * 100.0 / total_flash_ops as f32);
@@ -738,7 +1230,7 @@ impl Images {
         info!("Random interruptions at reset points={:?}", total_counts);
 
         let primary_slot_ok = self.verify_images(&flash, 0, 1);
-        let secondary_slot_ok = if self.is_swap_upgrade() {
+        let secondary_slot_ok = if self.keeps_perm_previous() {
             // TODO: This result is ignored.
             self.verify_images(&flash, 1, 0)
         } else {
@@ -1038,6 +1530,48 @@ impl Images {
         fails > 0
     }
 
+    // Tests an upgrade whose payload does not match its hash TLV, while the
+    // signature of that hash is valid.  It must never be installed.  With
+    // MCUBOOT_OVERWRITE_ONLY_VERIFY_COPY this is only found out once the
+    // primary slot has been overwritten, the one case where the primary image
+    // is lost; otherwise the primary slot must be left alone.
+    pub fn run_corrupt_upgrade(&self) -> bool {
+        let mut flash = self.flash.clone();
+        let mut fails = 0;
+
+        info!("Try upgrade image with corrupt payload");
+
+        if !Caps::modifies_flash() {
+            info!("Skipping upgrade image with corrupt payload");
+            return false;
+        }
+
+        self.mark_upgrades(&mut flash, 1);
+
+        let result = c::boot_go(&mut flash, &self.areadesc, None, None, false);
+
+        if self.verify_images(&flash, 0, 1) {
+            warn!("Corrupt image installed in the primary slot");
+            fails += 1;
+        }
+        if !Caps::OverwriteVerifyCopy.present() {
+            if !result.success() {
+                warn!("Failed first boot");
+                fails += 1;
+            }
+            if !self.verify_images(&flash, 0, 0) {
+                warn!("Failed image verification");
+                fails += 1;
+            }
+        }
+
+        if fails > 0 {
+            error!("Expected an upgrade failure when image has corrupt payload");
+        }
+
+        fails > 0
+    }
+
     // Should detect there is a leftover trailer in an otherwise erased
     // secondary slot and erase its trailer.
     pub fn run_secondary_leftover_trailer(&self) -> bool {
@@ -1738,7 +2272,7 @@ fn image_largest_trailer(dev: &dyn Flash) -> usize {
                 // This computation is incorrect, and we need to figure out the correct size.
                 // c::boot_status_sz(dev.align() as u32) as usize
                 16 + 4 * dev.align()
-            } else if Caps::SwapUsingMove.present() {
+            } else if Caps::SwapUsingMove.present() || Caps::SwapUsingOffset.present() {
                 let sector_size = dev.sector_iter().next().unwrap().size as u32;
                 align_up(c::boot_trailer_sz(dev.align() as u32), sector_size) as usize
             } else if Caps::SwapUsingScratch.present() {
@@ -1841,6 +2375,10 @@ fn install_image(flash: &mut SimMultiFlash, slot: &SlotInfo, len: ImageSize,
     // TLV signatures work over plain image
     tlv.add_bytes(&b_img);
 
+    if img_manipulation == ImageManipulation::CorruptPayload {
+        b_img[len - 1] ^= 0xff;
+    }
+
     // Generate encrypted images
     let flag = TlvFlags::ENCRYPTED_AES128 as u32 | TlvFlags::ENCRYPTED_AES256 as u32;
     let is_encrypted = (tlv.get_flags() & flag) != 0;
@@ -1929,6 +2467,12 @@ fn install_image(flash: &mut SimMultiFlash, slot: &SlotInfo, len: ImageSize,
             cipher: enc_copy,
         }
     } else {
+        // With swap-using-offset, an upgrade is written one sector into the secondary slot.
+        let offset = if Caps::SwapUsingOffset.present() {
+            offset + dev.sector_iter().next().unwrap().size
+        } else {
+            offset
+        };
 
         dev.write(offset, &buf).unwrap();
 
@@ -2046,6 +2590,17 @@ fn verify_image(flash: &SimMultiFlash, slot: &SlotInfo, images: &ImageData) -> b
     let dev = flash.get(&dev_id).unwrap();
     dev.read(offset, &mut copy).unwrap();
 
+    // The secondary slot of swap-using-offset holds its image either at the start of the slot
+    // or one sector into it, depending on which direction the last swap went.
+    if Caps::SwapUsingOffset.present() && slot.index == 1 && buf != &copy[..] {
+        let mut shifted = vec![0u8; buf.len()];
+        let sector_size = dev.sector_iter().next().unwrap().size;
+        dev.read(offset + sector_size, &mut shifted).unwrap();
+        if buf == &shifted[..] {
+            return true;
+        }
+    }
+
     if buf != &copy[..] {
         for i in 0 .. buf.len() {
             if buf[i] != copy[i] {
@@ -2290,11 +2845,15 @@ trait AsRaw : Sized {
     }
 }
 
+/// Upper bound of the number of times the bytes of an image are written, or erased, by an upgrade.
+const SCALING_PASSES: u64 = 4;
+
 /// Determine whether it makes sense to test this configuration with a maximally-sized image.
 /// Returns an ImageSize representing the best size to test, possibly just with the given size.
 fn maximal(size: usize) -> ImageSize {
     if Caps::OverwriteUpgrade.present() ||
-        Caps::SwapUsingMove.present()
+        Caps::SwapUsingMove.present() ||
+        Caps::SwapUsingOffset.present()
     {
         ImageSize::Given(size)
     } else {
@@ -2302,6 +2861,19 @@ fn maximal(size: usize) -> ImageSize {
     }
 }
 
+/// Hash the state of all the flash devices.
+fn flash_hash(flash: &SimMultiFlash) -> u64 {
+    let mut ids: Vec<&u8> = flash.keys().collect();
+    ids.sort();
+
+    let mut hasher = DefaultHasher::new();
+    for id in ids {
+        id.hash(&mut hasher);
+        flash[id].hash(&mut hasher);
+    }
+    hasher.finish()
+}
+
 pub fn show_sizes() {
     // This isn't panic safe.
     for min in &[1, 2, 4, 8] {
@@ -7,18 +7,30 @@
 use docopt::Docopt;
 use log::{warn, error};
 use std::{
+    collections::BTreeMap,
     fmt,
+    fs,
+    io,
+    path::Path,
     process,
+    time::{Duration, Instant},
 };
 use serde_derive::Deserialize;
 
 mod caps;
 mod depends;
+mod fuzz;
 mod image;
+#[cfg(feature = "serial-recovery")]
+mod serial;
 mod tlv;
 mod utils;
 pub mod testlog;
 
+use crate::caps::Caps;
+use mcuboot_sys::{c, FlashId};
+use simflash::{trace, FlashStats, FlashTiming};
+
 pub use crate::{
     depends::{
         DepTest,
@@ -27,6 +39,13 @@ pub use crate::{
         NO_DEPS,
         REV_DEPS,
     },
+    fuzz::{
+        FuzzStats,
+        FuzzTarget,
+        Fuzzer,
+        ALL_FUZZ_TARGETS,
+        FUZZ_IMAGE_SIZE,
+    },
     image::{
         ImagesBuilder,
         Images,
@@ -35,6 +54,14 @@ pub use crate::{
     },
 };
 
+#[cfg(feature = "serial-recovery")]
+pub use crate::serial::{
+    Framing,
+    SerialLink,
+    SerialUpload,
+    UploadStats,
+};
+
 const USAGE: &str = "
 Mcuboot simulator
 
@@ -42,6 +69,14 @@ Usage:
   bootsim sizes
   bootsim run --device TYPE [--align SIZE]
   bootsim runall
+  bootsim bench [--device TYPE] [--align SIZE]
+  bootsim wear [--device TYPE] [--align SIZE] [--cycles N]
+  bootsim kernels [--device TYPE]
+  bootsim compare [--device TYPE] [--align SIZE] [--save] <file>
+  bootsim trace --device TYPE [--align SIZE] [--boot] <file>
+  bootsim replay <file> [--timing MODEL] [--ext-timing MODEL]
+  bootsim serial [--device TYPE] [--align SIZE] [--baud N] [--latency US] [--loss P]
+  bootsim fuzz [--device TYPE] [--target NAME] [--execs N] [--corpus DIR]
   bootsim (--help | --version)
 
 Options:
@@ -50,21 +85,52 @@ Options:
   --device TYPE      MCU to simulate
                      Valid values: stm32f4, k64f
   --align SIZE       Flash write alignment
+  --cycles N         Number of upgrade cycles [default: 100]
+  --boot             Trace a plain boot instead of an upgrade
+  --save             Save the results of this build to <file> instead of comparing with them
+  --timing MODEL     Timing model of the internal flash [default: internal]
+  --ext-timing MODEL  Timing model of the external flash devices [default: spi]
+  --baud N           Baud rate of the serial link [default: 115200]
+  --latency US       Latency of the serial link, in microseconds [default: 1000]
+  --loss P           Probability that a frame is lost on the serial link [default: 0]
+  --target NAME      Fuzz target: tlv, validate or upgrade, all of them by default
+  --execs N          Number of inputs to fuzz each target with [default: 100000]
+  --corpus DIR       Write the seed image of each target to DIR/<target>/ instead
 ";
 
 #[derive(Debug, Deserialize)]
 struct Args {
     flag_device: Option<DeviceName>,
     flag_align: Option<AlignArg>,
+    flag_cycles: usize,
+    flag_boot: bool,
+    flag_save: bool,
+    flag_timing: String,
+    flag_ext_timing: String,
+    flag_baud: u32,
+    flag_latency: u64,
+    flag_loss: f64,
+    flag_target: Option<FuzzTarget>,
+    flag_execs: usize,
+    flag_corpus: Option<String>,
+    arg_file: Option<String>,
     cmd_sizes: bool,
     cmd_run: bool,
     cmd_runall: bool,
+    cmd_bench: bool,
+    cmd_wear: bool,
+    cmd_kernels: bool,
+    cmd_compare: bool,
+    cmd_trace: bool,
+    cmd_replay: bool,
+    cmd_serial: bool,
+    cmd_fuzz: bool,
 }
 
 #[derive(Copy, Clone, Debug, Deserialize)]
 pub enum DeviceName {
     Stm32f4, K64f, K64fBig, K64fMulti, Nrf52840, Nrf52840SpiFlash,
-    Nrf52840UnequalSlots,
+    Nrf52840UnequalSlots, Large8M, Large16MSpiFlash,
 }
 
 pub static ALL_DEVICES: &[DeviceName] = &[
@@ -77,6 +143,14 @@ pub static ALL_DEVICES: &[DeviceName] = &[
     DeviceName::Nrf52840UnequalSlots,
 ];
 
+/// Devices with slots of several megabytes, which have more sectors than a default build of the
+/// simulator supports.  They are only tested when it is built with the `large-flash` feature,
+/// and only by the scaling tests, the other tests being too slow at these sizes.
+pub static LARGE_DEVICES: &[DeviceName] = &[
+    DeviceName::Large8M,
+    DeviceName::Large16MSpiFlash,
+];
+
 impl fmt::Display for DeviceName {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         let name = match *self {
@@ -87,6 +161,8 @@ impl fmt::Display for DeviceName {
             DeviceName::Nrf52840 => "nrf52840",
             DeviceName::Nrf52840SpiFlash => "Nrf52840SpiFlash",
             DeviceName::Nrf52840UnequalSlots => "Nrf52840UnequalSlots",
+            DeviceName::Large8M => "Large8M",
+            DeviceName::Large16MSpiFlash => "Large16MSpiFlash",
         };
         f.write_str(name)
     }
@@ -136,6 +212,76 @@ pub fn main() {
         return;
     }
 
+    if args.cmd_bench {
+        let align = args.flag_align.map(|x| x.0).unwrap_or(1);
+        let devices = match args.flag_device {
+            None => ALL_DEVICES.to_vec(),
+            Some(dev) => vec![dev],
+        };
+        run_bench(&devices, align);
+        return;
+    }
+
+    if args.cmd_wear {
+        let align = args.flag_align.map(|x| x.0).unwrap_or(1);
+        let devices = match args.flag_device {
+            None => ALL_DEVICES.to_vec(),
+            Some(dev) => vec![dev],
+        };
+        run_wear(&devices, align, args.flag_cycles);
+        return;
+    }
+
+    if args.cmd_kernels {
+        run_kernels(args.flag_device.unwrap_or(DeviceName::K64f));
+        return;
+    }
+
+    if args.cmd_compare {
+        let align = args.flag_align.map(|x| x.0).unwrap_or(1);
+        let devices = match args.flag_device {
+            None => ALL_DEVICES.to_vec(),
+            Some(dev) => vec![dev],
+        };
+        let file = args.arg_file.expect("Missing results file");
+        process::exit(run_compare(&devices, align, Path::new(&file), args.flag_save));
+    }
+
+    if args.cmd_trace {
+        let align = args.flag_align.map(|x| x.0).unwrap_or(1);
+        let device = args.flag_device.expect("Missing mandatory device argument");
+        let file = args.arg_file.expect("Missing trace file");
+        process::exit(run_trace(device, align, !args.flag_boot, &file));
+    }
+
+    if args.cmd_replay {
+        let file = args.arg_file.expect("Missing trace file");
+        process::exit(run_replay(&file, &args.flag_timing, &args.flag_ext_timing));
+    }
+
+    if args.cmd_serial {
+        let align = args.flag_align.map(|x| x.0).unwrap_or(1);
+        let devices = match args.flag_device {
+            None => ALL_DEVICES.to_vec(),
+            Some(dev) => vec![dev],
+        };
+        run_serial(&devices, align, args.flag_baud, args.flag_latency, args.flag_loss);
+        return;
+    }
+
+    if args.cmd_fuzz {
+        let device = args.flag_device.unwrap_or(DeviceName::K64f);
+        let targets = match args.flag_target {
+            None => ALL_FUZZ_TARGETS.to_vec(),
+            Some(target) => vec![target],
+        };
+        match args.flag_corpus {
+            Some(dir) => process::exit(write_fuzz_corpus(device, &targets, &dir)),
+            None => run_fuzz(device, &targets, args.flag_execs),
+        }
+        return;
+    }
+
     let mut status = RunStatus::new();
     if args.cmd_run {
 
@@ -169,6 +315,576 @@ pub fn main() {
     }
 }
 
+/// Image sizes used by the benchmark.  They must fit in the smallest slot of all the devices, for
+/// all upgrade strategies.
+const BENCH_SIZES: &[usize] = &[8 * 1024, 32 * 1024, 96 * 1024];
+
+/// Report the simulated time spent in flash operations by a plain boot and by an upgrade, for
+/// each device and image size.  The upgrade strategy and the encryption are those this simulator
+/// was built with.
+fn run_bench(devices: &[DeviceName], align: usize) {
+    println!("strategy: {}, encryption: {}, align: {}", bench_strategy(), bench_encryption(), align);
+    println!("{:<24} {:>8} {:>10} {:>12} {:>8} {:>8} {:>8}",
+             "device", "size", "boot ms", "upgrade ms", "reads", "writes", "erases");
+
+    for &device in devices {
+        let builder = match ImagesBuilder::new(device, align, 0xff) {
+            Ok(builder) => builder.with_timing(),
+            Err(msg) => {
+                warn!("Skipping {}: {}", device, msg);
+                continue;
+            }
+        };
+
+        for &size in BENCH_SIZES {
+            let boot = builder.clone().make_bench_image(size, false).bench_boot();
+            let upgrade = builder.clone().make_bench_image(size, true).bench_boot();
+            match (boot, upgrade) {
+                (Some(boot), Some(upgrade)) => {
+                    println!("{:<24} {:>8} {:>10.3} {:>12.3} {:>8} {:>8} {:>8}",
+                             device.to_string(), size,
+                             boot.elapsed_ns as f64 / 1e6,
+                             upgrade.elapsed_ns as f64 / 1e6,
+                             upgrade.reads, upgrade.writes, upgrade.erases);
+                }
+                _ => error!("Boot failed on {} with an image of {} bytes", device, size),
+            }
+        }
+    }
+}
+
+/// Report the erase wear of the slots and of the scratch area after a number of upgrade cycles,
+/// with the largest benchmark image.  The count includes the erase of the secondary slot done
+/// when the upgrade is downloaded.
+fn run_wear(devices: &[DeviceName], align: usize, cycles: usize) {
+    if !Caps::modifies_flash() {
+        println!("{} does not write the flash on upgrade", bench_strategy());
+        return;
+    }
+
+    let size = BENCH_SIZES[BENCH_SIZES.len() - 1];
+    println!("strategy: {}, encryption: {}, align: {}, cycles: {}, image size: {}",
+             bench_strategy(), bench_encryption(), align, cycles, size);
+    println!("{:<24} {:<10} {:>8} {:>10} {:>12}",
+             "device", "area", "max", "mean", "max/cycle");
+
+    let areas = [
+        ("primary", FlashId::Image0),
+        ("secondary", FlashId::Image1),
+        ("scratch", FlashId::ImageScratch),
+        ("primary2", FlashId::Image2),
+        ("secondary2", FlashId::Image3),
+    ];
+
+    for &device in devices {
+        let images = match ImagesBuilder::new(device, align, 0xff) {
+            Ok(builder) => builder.make_bench_image(size, true),
+            Err(msg) => {
+                warn!("Skipping {}: {}", device, msg);
+                continue;
+            }
+        };
+
+        let flash = match images.run_wear_cycles(cycles) {
+            Some(flash) => flash,
+            None => {
+                error!("Upgrade failed on {}", device);
+                continue;
+            }
+        };
+
+        for &(name, id) in &areas {
+            if let Some((max, mean)) = images.area_wear(&flash, id) {
+                println!("{:<24} {:<10} {:>8} {:>10.1} {:>12.2}",
+                         device.to_string(), name, max, mean,
+                         max as f64 / cycles.max(1) as f64);
+            }
+        }
+    }
+}
+
+/// Record the flash operations of an upgrade, or of a plain boot, with the largest benchmark image
+/// and save them to `file`.  The trace is recorded with the timing models of `bench`.
+fn run_trace(device: DeviceName, align: usize, upgrade: bool, file: &str) -> i32 {
+    let size = BENCH_SIZES[BENCH_SIZES.len() - 1];
+    let images = match ImagesBuilder::new(device, align, 0xff) {
+        Ok(builder) => builder.with_timing().make_bench_image(size, upgrade),
+        Err(msg) => {
+            error!("Cannot trace {}: {}", device, msg);
+            return 1;
+        }
+    };
+
+    let trace = match images.trace_boot() {
+        Some(trace) => trace,
+        None => {
+            error!("Boot failed on {} with an image of {} bytes", device, size);
+            return 1;
+        }
+    };
+
+    if let Err(err) = trace::write_trace(file, &trace) {
+        error!("Cannot write {}: {}", file, err);
+        return 1;
+    }
+    println!("{} operations written to {}", trace.len(), file);
+    0
+}
+
+/// Replay a trace saved by `run_trace`, with `timing` for the internal flash (device 0) and
+/// `ext_timing` for the other devices, and print the statistics of each device.
+fn run_replay(file: &str, timing: &str, ext_timing: &str) -> i32 {
+    let (timing, ext_timing): (FlashTiming, FlashTiming) = match (timing.parse(), ext_timing.parse()) {
+        (Ok(timing), Ok(ext_timing)) => (timing, ext_timing),
+        (Err(msg), _) | (_, Err(msg)) => {
+            error!("{}", msg);
+            return 1;
+        }
+    };
+
+    let trace = match trace::read_trace(file) {
+        Ok(trace) => trace,
+        Err(err) => {
+            error!("Cannot read {}: {}", file, err);
+            return 1;
+        }
+    };
+
+    println!("{:<6} {:>12} {:>8} {:>10} {:>8} {:>10} {:>8} {:>10}",
+             "dev", "ms", "reads", "read B", "writes", "write B", "erases", "erase B");
+    let stats = trace::replay(&trace, |dev_id| if dev_id == 0 { timing } else { ext_timing });
+    let mut total = FlashStats::default();
+    for (dev_id, stats) in stats {
+        println!("{:<6} {:>12.3} {:>8} {:>10} {:>8} {:>10} {:>8} {:>10}",
+                 dev_id, stats.elapsed_ns as f64 / 1e6,
+                 stats.reads, stats.read_bytes, stats.writes, stats.write_bytes,
+                 stats.erases, stats.erase_bytes);
+        total += stats;
+    }
+    println!("{:<6} {:>12.3}", "total", total.elapsed_ns as f64 / 1e6);
+    0
+}
+
+/// Report the simulated time of a serial recovery upload of the largest benchmark image, for each
+/// device, with base64 and raw framing, and with and without an upload window.
+#[cfg(feature = "serial-recovery")]
+fn run_serial(devices: &[DeviceName], align: usize, baud: u32, latency_us: u64, loss: f64) {
+    let size = BENCH_SIZES[BENCH_SIZES.len() - 1];
+    let link = SerialLink { baud, latency_us, loss };
+    println!("baud: {}, latency: {} us, loss: {}, align: {}, image size: {}",
+             baud, latency_us, loss, align, size);
+    println!("{:<24} {:<8} {:>6} {:>6} {:>10} {:>8} {:>10} {:>8} {:>8}",
+             "device", "framing", "window", "chunk", "upload ms", "kB/s", "flash ms",
+             "requests", "resends");
+
+    for &device in devices {
+        let images = match ImagesBuilder::new(device, align, 0xff) {
+            Ok(builder) => builder.with_timing().make_bench_image(size, false),
+            Err(msg) => {
+                warn!("Skipping {}: {}", device, msg);
+                continue;
+            }
+        };
+
+        for &framing in &[Framing::Base64, Framing::Raw] {
+            for &window in &[1, 4] {
+                match images.run_serial_upload(&SerialUpload::new(framing, window, link)) {
+                    Some(stats) => {
+                        println!("{:<24} {:<8} {:>6} {:>6} {:>10.1} {:>8.2} {:>10.1} {:>8} {:>8}",
+                                 device.to_string(), framing.name(), stats.window, stats.chunk,
+                                 stats.elapsed_ns as f64 / 1e6,
+                                 size as f64 / stats.elapsed_ns as f64 * 1e6,
+                                 stats.flash_ns as f64 / 1e6,
+                                 stats.requests, stats.resends);
+                    }
+                    None => error!("Upload failed on {} with {} framing", device, framing.name()),
+                }
+            }
+        }
+    }
+}
+
+#[cfg(not(feature = "serial-recovery"))]
+fn run_serial(_devices: &[DeviceName], _align: usize, _baud: u32, _latency_us: u64, _loss: f64) {
+    println!("The simulator was built without the serial-recovery feature");
+}
+
+/// Run the mutator of the fuzzers: a boot costs a lot more than parsing an image, so the upgrade
+/// target only gets a hundredth of the inputs.
+fn run_fuzz(device: DeviceName, targets: &[FuzzTarget], execs: usize) {
+    println!("{:<10} {:>10} {:>10} {:>12}", "target", "execs", "accepted", "execs/s");
+    for &target in targets {
+        let mut fuzzer = match Fuzzer::on_device(device, target) {
+            Ok(fuzzer) => fuzzer,
+            Err(msg) => {
+                warn!("Skipping the {} target: {}", target.name(), msg);
+                continue;
+            }
+        };
+        let execs = if target == FuzzTarget::Upgrade { (execs / 100).max(1) } else { execs };
+        let stats = fuzzer.run_mutations(execs, 1);
+        println!("{:<10} {:>10} {:>10} {:>12.0}", target.name(), stats.execs, stats.accepted,
+                 stats.execs_per_sec());
+    }
+}
+
+/// Write the seed image of each target to its own directory in `dir`, where the fuzz targets
+/// of `sim/fuzz` start their corpus from.
+fn write_fuzz_corpus(device: DeviceName, targets: &[FuzzTarget], dir: &str) -> i32 {
+    for &target in targets {
+        let fuzzer = match Fuzzer::on_device(device, target) {
+            Ok(fuzzer) => fuzzer,
+            Err(msg) => {
+                warn!("Skipping the {} target: {}", target.name(), msg);
+                continue;
+            }
+        };
+        let path = Path::new(dir).join(target.name());
+        if let Err(err) = fs::create_dir_all(&path)
+            .and_then(|_| fs::write(path.join(format!("seed-{}", device)), fuzzer.seed())) {
+            error!("Can't write the corpus of {}: {}", target.name(), err);
+            return 1;
+        }
+    }
+    0
+}
+
+/// Flash operation counts of the benchmark scenarios, indexed by scenario name: reads, bytes read,
+/// writes, bytes written, erases and bytes erased.
+type Baseline = BTreeMap<String, [u64; 6]>;
+
+const BASELINE_COUNTS: [&str; 6] = [
+    "reads", "read bytes", "writes", "write bytes", "erases", "erase bytes",
+];
+
+fn stats_counts(stats: &FlashStats) -> [u64; 6] {
+    [stats.reads, stats.read_bytes, stats.writes, stats.write_bytes,
+     stats.erases, stats.erase_bytes]
+}
+
+/// Read a file of counts.  Each line holds a scenario name followed by its N counts, lines
+/// starting with '#' are comments.  A missing file is an empty one.
+fn read_counts<const N: usize>(path: &Path) -> BTreeMap<String, [u64; N]> {
+    let mut map = BTreeMap::new();
+    let text = match fs::read_to_string(path) {
+        Ok(text) => text,
+        Err(_) => return map,
+    };
+
+    for line in text.lines() {
+        let line = line.trim();
+        if line.is_empty() || line.starts_with('#') {
+            continue;
+        }
+
+        let fields: Vec<&str> = line.split_whitespace().collect();
+        let counts: Vec<u64> = fields[1..].iter().filter_map(|f| f.parse().ok()).collect();
+        if counts.len() != N {
+            warn!("Ignoring line of {}: {}", path.display(), line);
+            continue;
+        }
+        let mut entry = [0; N];
+        entry.copy_from_slice(&counts);
+        map.insert(fields[0].to_string(), entry);
+    }
+    map
+}
+
+/// Write a file of counts read by `read_counts`, starting with the comment lines of `header`.
+fn write_counts<const N: usize>(path: &Path, header: &str,
+                                map: &BTreeMap<String, [u64; N]>) -> io::Result<()> {
+    let mut text = String::from(header);
+    for (name, counts) in map {
+        let counts: Vec<String> = counts.iter().map(|c| c.to_string()).collect();
+        text.push_str(&format!("{} {}\n", name, counts.join(" ")));
+    }
+    fs::write(path, text)
+}
+
+fn read_baseline(path: &Path) -> Baseline {
+    read_counts(path)
+}
+
+fn write_baseline(path: &Path, baseline: &Baseline) -> io::Result<()> {
+    write_counts(path,
+                 "# Flash operations per simulated boot, see sim/README.rst.\n\
+                  # scenario reads read-bytes writes write-bytes erases erase-bytes\n",
+                 baseline)
+}
+
+/// Run the benchmark scenarios, a plain boot and an upgrade for each device and benchmark image
+/// size, and return their flash statistics, named `device:scenario:size`.  With `timing`, the
+/// flash devices carry the timing models of `bench`.
+fn run_scenarios(devices: &[DeviceName], align: usize, timing: bool) -> Vec<(String, FlashStats)> {
+    let mut results = Vec::new();
+
+    for &device in devices {
+        let builder = match ImagesBuilder::new(device, align, 0xff) {
+            Ok(builder) if timing => builder.with_timing(),
+            Ok(builder) => builder,
+            Err(msg) => {
+                warn!("Skipping {}: {}", device, msg);
+                continue;
+            }
+        };
+
+        for &size in BENCH_SIZES {
+            for &(scenario, upgrade) in &[("boot", false), ("upgrade", true)] {
+                let name = format!("{}:{}:{}", device, scenario, size);
+                match builder.clone().make_bench_image(size, upgrade).bench_boot() {
+                    Some(stats) => results.push((name, stats)),
+                    None => error!("Boot failed for {}", name),
+                }
+            }
+        }
+    }
+    results
+}
+
+/// Run the benchmark scenarios (a plain boot and an upgrade, for each device and benchmark image
+/// size) and compare their flash operation counts with the baseline in `path`.  Scenarios whose
+/// counts went up are reported, and make this return true.  Scenarios which are not in the
+/// baseline are reported, and make this return true with `require`, as CI sets it; with
+/// `record`, the baseline is updated with the measured counts instead.
+pub fn check_flash_baseline(path: &Path, record: bool, require: bool) -> bool {
+    let prefix = format!("{}:{}", bench_strategy(), crypto_features());
+    let measured: Baseline = run_scenarios(ALL_DEVICES, 1, false).into_iter()
+        .map(|(name, stats)| (format!("{}:{}", prefix, name), stats_counts(&stats)))
+        .collect();
+
+    let mut baseline = read_baseline(path);
+    if record {
+        baseline.extend(measured);
+        if let Err(err) = write_baseline(path, &baseline) {
+            error!("Unable to write {}: {}", path.display(), err);
+            return true;
+        }
+        return false;
+    }
+
+    let mut failed = false;
+    for (name, counts) in &measured {
+        let base = match baseline.get(name) {
+            Some(base) => base,
+            None if require => {
+                error!("No baseline for {}, record it with MCUBOOT_RECORD_BASELINE=1", name);
+                failed = true;
+                continue;
+            }
+            None => {
+                warn!("No baseline for {}", name);
+                continue;
+            }
+        };
+
+        for i in 0..counts.len() {
+            if counts[i] > base[i] {
+                error!("{}: {} went up from {} to {}", name, BASELINE_COUNTS[i], base[i], counts[i]);
+                failed = true;
+            } else if counts[i] < base[i] {
+                warn!("{}: {} went down from {} to {}, the baseline can be updated",
+                      name, BASELINE_COUNTS[i], base[i], counts[i]);
+            }
+        }
+    }
+    failed
+}
+
+/// Flash statistics of the scenarios compared by `run_compare`: the counts of `stats_counts`
+/// followed by the simulated time, in ns.
+type CompareResults = BTreeMap<String, [u64; 7]>;
+
+fn compare_counts(stats: &FlashStats) -> [u64; 7] {
+    let c = stats_counts(stats);
+    [c[0], c[1], c[2], c[3], c[4], c[5], stats.elapsed_ns]
+}
+
+/// Format the change from `old` to `new`, as a signed difference with `decimals` decimals and a
+/// percentage.
+fn delta(old: f64, new: f64, decimals: usize) -> String {
+    let diff = new - old;
+    if diff == 0.0 {
+        "=".to_string()
+    } else if old == 0.0 {
+        format!("{:+.*}", decimals, diff)
+    } else {
+        format!("{:+.*} ({:+.1}%)", decimals, diff, diff * 100.0 / old)
+    }
+}
+
+/// Run the benchmark scenarios with the timing models of `bench`.  With `save`, write their
+/// results to `path`, along with the configuration of this build.  Otherwise, compare them with
+/// the results saved in `path` by another build of the simulator, typically of the C code before
+/// a change, and print the difference in flash reads, writes, erases, bytes moved (read and
+/// written) and simulated time of each scenario.
+fn run_compare(devices: &[DeviceName], align: usize, path: &Path, save: bool) -> i32 {
+    let config = format!("strategy: {}, crypto: {}, align: {}",
+                         bench_strategy(), crypto_features(), align);
+    let results: CompareResults = run_scenarios(devices, align, true).into_iter()
+        .map(|(name, stats)| (name, compare_counts(&stats)))
+        .collect();
+
+    if save {
+        let header = format!("# {}\n\
+                              # scenario reads read-bytes writes write-bytes erases erase-bytes ns\n",
+                             config);
+        if let Err(err) = write_counts(path, &header, &results) {
+            error!("Cannot write {}: {}", path.display(), err);
+            return 1;
+        }
+        println!("{} scenarios written to {}", results.len(), path.display());
+        return 0;
+    }
+
+    let saved_config = match fs::read_to_string(path) {
+        Ok(text) => text.lines().next().unwrap_or("").trim_start_matches("# ").to_string(),
+        Err(err) => {
+            error!("Cannot read {}: {}", path.display(), err);
+            return 1;
+        }
+    };
+    let saved: CompareResults = read_counts(path);
+    println!("old: {}", saved_config);
+    println!("new: {}", config);
+    println!("{:<36} {:>16} {:>16} {:>16} {:>22} {:>22}",
+             "scenario", "reads", "writes", "erases", "bytes moved", "ms");
+
+    for (name, new) in &results {
+        let old = match saved.get(name) {
+            Some(old) => old,
+            None => {
+                println!("{:<36} not in {}", name, path.display());
+                continue;
+            }
+        };
+        let count = |i: usize| delta(old[i] as f64, new[i] as f64, 0);
+        println!("{:<36} {:>16} {:>16} {:>16} {:>22} {:>22}",
+                 name, count(0), count(2), count(4),
+                 delta((old[1] + old[3]) as f64, (new[1] + new[3]) as f64, 0),
+                 delta(old[6] as f64 / 1e6, new[6] as f64 / 1e6, 3));
+    }
+    for name in saved.keys().filter(|name| !results.contains_key(*name)) {
+        println!("{:<36} not run by this build", name);
+    }
+    0
+}
+
+/// Sizes of the buffers given to the hash, decryption and copy kernels.
+const KERNEL_SIZES: &[usize] = &[1024, 4096, 16 * 1024, 64 * 1024];
+
+/// The crypto features this simulator was built with.
+fn crypto_features() -> String {
+    let features = [
+        ("sig-rsa", cfg!(feature = "sig-rsa")),
+        ("sig-rsa3072", cfg!(feature = "sig-rsa3072")),
+        ("sig-ecdsa", cfg!(feature = "sig-ecdsa")),
+        ("sig-ecdsa-mbedtls", cfg!(feature = "sig-ecdsa-mbedtls")),
+        ("sig-ecdsa-psa", cfg!(feature = "sig-ecdsa-psa")),
+        ("sig-p384", cfg!(feature = "sig-p384")),
+        ("sig-ed25519", cfg!(feature = "sig-ed25519")),
+        ("enc-rsa", cfg!(feature = "enc-rsa")),
+        ("enc-aes256-rsa", cfg!(feature = "enc-aes256-rsa")),
+        ("enc-kw", cfg!(feature = "enc-kw")),
+        ("enc-aes256-kw", cfg!(feature = "enc-aes256-kw")),
+        ("enc-ec256", cfg!(feature = "enc-ec256")),
+        ("enc-ec256-mbedtls", cfg!(feature = "enc-ec256-mbedtls")),
+        ("enc-aes256-ec256", cfg!(feature = "enc-aes256-ec256")),
+        ("enc-x25519", cfg!(feature = "enc-x25519")),
+        ("enc-aes256-x25519", cfg!(feature = "enc-aes256-x25519")),
+    ];
+    let enabled: Vec<&str> = features.iter()
+        .filter(|(_, on)| *on)
+        .map(|(name, _)| *name)
+        .collect();
+    if enabled.is_empty() {
+        "none".to_string()
+    } else {
+        enabled.join("+")
+    }
+}
+
+/// Print one benchmark result as a line of JSON.
+fn print_kernel(kernel: &str, features: &str, size: usize, iters: u32, elapsed: Duration) {
+    let ns = elapsed.as_nanos() as f64 / iters as f64;
+    println!("{{\"kernel\": \"{}\", \"features\": \"{}\", \"size\": {}, \"iters\": {}, \
+              \"ns_per_op\": {:.0}, \"mb_per_s\": {:.2}}}",
+             kernel, features, size, iters, ns, size as f64 * 1e3 / ns);
+}
+
+/// Time the hash, image validation (hash and signature), AES-CTR decryption and region copy
+/// kernels of bootutil on the host, with the crypto backend this simulator was built with.  One
+/// line of JSON is printed per kernel and size.
+fn run_kernels(device: DeviceName) {
+    let features = crypto_features();
+
+    for &size in KERNEL_SIZES {
+        let iters = (16 * 1024 * 1024 / size) as u32;
+        let buf = vec![0xa5u8; size];
+        let start = Instant::now();
+        if c::kernel_sha(&buf, iters) {
+            print_kernel("sha", &features, size, iters, start.elapsed());
+        } else {
+            error!("Hash kernel failed");
+        }
+
+        let mut buf = buf;
+        let start = Instant::now();
+        if c::kernel_aes_ctr(&mut buf, iters) {
+            print_kernel("aes-ctr", &features, size, iters, start.elapsed());
+        }
+    }
+
+    let builder = match ImagesBuilder::new(device, 1, 0xff) {
+        Ok(builder) => builder,
+        Err(msg) => {
+            error!("Can't run the image kernels on {}: {}", device, msg);
+            return;
+        }
+    };
+
+    for &size in BENCH_SIZES {
+        let images = builder.clone().make_bench_image(size, false);
+        match images.time_validate(20) {
+            Some(elapsed) => print_kernel("validate", &features, size, 20, elapsed),
+            None => error!("Validation of a {} byte image failed", size),
+        }
+    }
+
+    let images = builder.make_bench_image(BENCH_SIZES[0], false);
+    for &size in KERNEL_SIZES {
+        let iters = (16 * 1024 * 1024 / size) as u32;
+        match images.time_copy(size, iters) {
+            Some(elapsed) => print_kernel("copy", &features, size, iters, elapsed),
+            None => error!("Copy of {} bytes failed", size),
+        }
+    }
+}
+
+fn bench_strategy() -> &'static str {
+    if Caps::OverwriteUpgrade.present() {
+        "overwrite"
+    } else if Caps::SwapUsingMove.present() {
+        "swap-move"
+    } else if Caps::SwapUsingOffset.present() {
+        "swap-offset"
+    } else if Caps::RamLoad.present() {
+        "ram-load"
+    } else if Caps::DirectXip.present() {
+        "direct-xip"
+    } else {
+        "swap-scratch"
+    }
+}
+
+fn bench_encryption() -> &'static str {
+    if Caps::EncRsa.present() || Caps::EncKw.present() ||
+        Caps::EncEc256.present() || Caps::EncX25519.present() {
+        if Caps::Aes256.present() { "aes256" } else { "aes128" }
+    } else {
+        "none"
+    }
+}
+
 #[derive(Default)]
 pub struct RunStatus {
     failures: usize,
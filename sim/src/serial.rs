@@ -0,0 +1,744 @@
+// Copyright (c) 2026, NOWATCH BV
+//
+// SPDX-License-Identifier: Apache-2.0
+
+//! Serial recovery uploads over a simulated uart.
+//!
+//! The host side of an mcumgr image upload is played against the serial recovery of the
+//! bootloader, over a link with a given baud rate, latency and frame loss.  Time is simulated: the
+//! device spends the time of its flash operations, according to the timing models of the flash
+//! devices, and the time to send its responses; the host the time to send its requests.  The
+//! processing time of either side is not accounted for, and the device is assumed to buffer all
+//! the requests the host has in flight.
+
+use log::{info, warn};
+use mcuboot_sys::{api::{self, SimUart}, c::SerialExit};
+use rand::{rngs::SmallRng, Rng, SeedableRng};
+use std::collections::VecDeque;
+
+const NMGR_OP_READ: u8 = 0;
+const NMGR_OP_WRITE: u8 = 2;
+
+const MGMT_GROUP_ID_DEFAULT: u16 = 0;
+const MGMT_GROUP_ID_IMAGE: u16 = 1;
+
+const NMGR_ID_RESET: u8 = 5;
+const NMGR_ID_MCUMGR_PARAMS: u8 = 6;
+const IMGMGR_NMGR_ID_UPLOAD: u8 = 1;
+
+/// Receive buffer of the device when it does not report its parameters.
+const DEFAULT_BUF_SIZE: usize = 512;
+
+/// Bytes of an upload request other than its data, at most: the header, and the CBOR map with
+/// its "data", "len" and "off" entries.
+const UPLOAD_OVERHEAD: usize = 8 + 1 + 5 + 3 + 4 + 5 + 4 + 5;
+
+/// Characters per line of a base64 frame, a multiple of 4 so that each line can be decoded on its
+/// own, as the mcumgr tools split them.
+const BASE64_LINE: usize = 124;
+
+/// Frame bytes per line of a raw frame, which COBS encodes in one more.
+const RAW_LINE: usize = 123;
+
+/// Timeouts in a row after which the host gives up.
+const MAX_TIMEOUTS: u32 = 20;
+
+/// The uart link between the host and the device.
+#[derive(Clone, Copy, Debug)]
+pub struct SerialLink {
+    /// Baud rate, with 10 bits per byte.
+    pub baud: u32,
+    /// Delay between the end of a frame on one side and its reception on the other, in
+    /// microseconds, such as that of an USB to serial adapter.
+    pub latency_us: u64,
+    /// Probability that a frame is lost, in either direction.
+    pub loss: f64,
+}
+
+impl Default for SerialLink {
+    fn default() -> SerialLink {
+        SerialLink {
+            baud: 115200,
+            latency_us: 1000,
+            loss: 0.0,
+        }
+    }
+}
+
+/// How the requests are framed on the uart.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Framing {
+    /// The base64 lines of the mcumgr serial transport.
+    Base64,
+    /// The COBS encoded lines of MCUBOOT_SERIAL_RAW_FRAMING.
+    Raw,
+}
+
+impl Framing {
+    pub fn name(self) -> &'static str {
+        match self {
+            Framing::Base64 => "base64",
+            Framing::Raw => "raw",
+        }
+    }
+
+    /// Bytes a frame adds to the packet it carries, before it is encoded: the length, and the
+    /// CRC of base64 frames.
+    fn overhead(self) -> usize {
+        match self {
+            Framing::Base64 => 4,
+            Framing::Raw => 2,
+        }
+    }
+
+    /// The lines of the frame carrying `pkt`, each ending with a newline.
+    fn encode(self, pkt: &[u8]) -> Vec<Vec<u8>> {
+        let mut lines = Vec::new();
+        match self {
+            Framing::Base64 => {
+                let mut frame = Vec::with_capacity(pkt.len() + 4);
+                frame.extend_from_slice(&((pkt.len() + 2) as u16).to_be_bytes());
+                frame.extend_from_slice(pkt);
+                frame.extend_from_slice(&crc16(pkt).to_be_bytes());
+                let text = base64::encode(&frame);
+                for (i, part) in text.as_bytes().chunks(BASE64_LINE).enumerate() {
+                    let mut line = if i == 0 { vec![6, 9] } else { vec![4, 20] };
+                    line.extend_from_slice(part);
+                    line.push(b'\n');
+                    lines.push(line);
+                }
+            }
+            Framing::Raw => {
+                let mut frame = Vec::with_capacity(pkt.len() + 2);
+                frame.extend_from_slice(&(pkt.len() as u16).to_be_bytes());
+                frame.extend_from_slice(pkt);
+                for (i, part) in frame.chunks(RAW_LINE).enumerate() {
+                    let mut line = if i == 0 { vec![6, 11] } else { vec![4, 11] };
+                    cobs_encode(part, &mut line);
+                    line.push(b'\n');
+                    lines.push(line);
+                }
+            }
+        }
+        lines
+    }
+}
+
+/// CRC16-CCITT over `data`, with a null initial value.
+fn crc16(data: &[u8]) -> u16 {
+    let mut crc: u16 = 0;
+    for &byte in data {
+        crc ^= (byte as u16) << 8;
+        for _ in 0..8 {
+            crc = if crc & 0x8000 != 0 { (crc << 1) ^ 0x1021 } else { crc << 1 };
+        }
+    }
+    crc
+}
+
+/// COBS encode `data` at the end of `out`, with every byte XORed with the newline.
+fn cobs_encode(data: &[u8], out: &mut Vec<u8>) {
+    let mut code_off = out.len();
+    let mut code = 1u8;
+    out.push(0);
+    for &byte in data {
+        if byte != 0 {
+            out.push(byte ^ b'\n');
+            code += 1;
+        }
+        if byte == 0 || code == 0xff {
+            out[code_off] = code ^ b'\n';
+            code_off = out.len();
+            out.push(0);
+            code = 1;
+        }
+    }
+    out[code_off] = code ^ b'\n';
+}
+
+/// Decode what `cobs_encode` produced, or None if it is malformed.
+fn cobs_decode(data: &[u8]) -> Option<Vec<u8>> {
+    let mut out = Vec::with_capacity(data.len());
+    let mut pos = 0;
+    while pos < data.len() {
+        let code = data[pos] ^ b'\n';
+        pos += 1;
+        if code == 0 || pos + code as usize - 1 > data.len() {
+            return None;
+        }
+        out.extend(data[pos..pos + code as usize - 1].iter().map(|&byte| byte ^ b'\n'));
+        pos += code as usize - 1;
+        if code != 0xff && pos < data.len() {
+            out.push(0);
+        }
+    }
+    Some(out)
+}
+
+/// Reassembles the frames sent by the device from its lines.
+#[derive(Default)]
+struct FrameReader {
+    raw: bool,
+    // Base64 text, or decoded data of raw frames, received so far.
+    buf: Vec<u8>,
+}
+
+impl FrameReader {
+    /// Take a line, without its newline, and return the packet of the frame it completes.
+    fn line(&mut self, line: &[u8]) -> Option<Vec<u8>> {
+        if line.len() < 2 {
+            return None;
+        }
+        let body = &line[2..];
+        match (line[0], line[1]) {
+            (6, 9) | (6, 11) => {
+                self.raw = line[1] == 11;
+                self.buf.clear();
+            }
+            (4, 20) | (4, 11) => (),
+            _ => return None,
+        }
+
+        let frame = if self.raw {
+            self.buf.extend(cobs_decode(body)?);
+            self.buf.clone()
+        } else {
+            self.buf.extend_from_slice(body);
+            base64::decode(&self.buf).ok()?
+        };
+
+        if frame.len() < 2 || u16::from_be_bytes([frame[0], frame[1]]) as usize != frame.len() - 2 {
+            return None;
+        }
+        if self.raw {
+            Some(frame[2..].to_vec())
+        } else if frame.len() > 4 && crc16(&frame[2..]) == 0 {
+            Some(frame[2..frame.len() - 2].to_vec())
+        } else {
+            None
+        }
+    }
+}
+
+fn cbor_head(out: &mut Vec<u8>, major: u8, val: u64) {
+    let major = major << 5;
+    if val < 24 {
+        out.push(major | val as u8);
+    } else if val < 0x100 {
+        out.push(major | 24);
+        out.push(val as u8);
+    } else if val < 0x10000 {
+        out.push(major | 25);
+        out.extend_from_slice(&(val as u16).to_be_bytes());
+    } else {
+        out.push(major | 26);
+        out.extend_from_slice(&(val as u32).to_be_bytes());
+    }
+}
+
+fn cbor_text(out: &mut Vec<u8>, text: &str) {
+    cbor_head(out, 3, text.len() as u64);
+    out.extend_from_slice(text.as_bytes());
+}
+
+/// Read an argument of a data item, or None if it is not a plain one.
+fn cbor_arg(buf: &[u8], pos: &mut usize) -> Option<u64> {
+    let info = *buf.get(*pos)? & 0x1f;
+    *pos += 1;
+    let len = match info {
+        0..=23 => return Some(info as u64),
+        24 => 1,
+        25 => 2,
+        26 => 4,
+        27 => 8,
+        _ => return None,
+    };
+    let bytes = buf.get(*pos..*pos + len)?;
+    *pos += len;
+    Some(bytes.iter().fold(0, |val, &byte| (val << 8) | byte as u64))
+}
+
+/// The integer entries of the CBOR map with text keys in `buf`, or None if it is not one.  Byte
+/// and text string values are skipped.
+fn cbor_map_ints(buf: &[u8]) -> Option<Vec<(String, i64)>> {
+    let mut pos = 0;
+    let first = *buf.first()?;
+    if first >> 5 != 5 {
+        return None;
+    }
+    let count = if first == 0xbf {
+        pos += 1;
+        None
+    } else {
+        Some(cbor_arg(buf, &mut pos)?)
+    };
+
+    let mut entries = Vec::new();
+    let mut index = 0;
+    loop {
+        match count {
+            Some(count) if index == count => break,
+            None if *buf.get(pos)? == 0xff => break,
+            _ => (),
+        }
+        index += 1;
+
+        if *buf.get(pos)? >> 5 != 3 {
+            return None;
+        }
+        let len = cbor_arg(buf, &mut pos)? as usize;
+        let key = String::from_utf8(buf.get(pos..pos + len)?.to_vec()).ok()?;
+        pos += len;
+
+        let major = *buf.get(pos)? >> 5;
+        let val = cbor_arg(buf, &mut pos)?;
+        match major {
+            0 => entries.push((key, val as i64)),
+            1 => entries.push((key, -1 - val as i64)),
+            2 | 3 => pos += val as usize,
+            _ => return None,
+        }
+    }
+    Some(entries)
+}
+
+fn cbor_get(entries: &[(String, i64)], key: &str) -> Option<i64> {
+    entries.iter().find(|(k, _)| k == key).map(|&(_, val)| val)
+}
+
+/// How a simulated upload is done.
+#[derive(Clone, Copy, Debug)]
+pub struct SerialUpload {
+    pub framing: Framing,
+    /// Requests the host may have in flight, as allowed by the parameters the device reports.
+    pub window: usize,
+    pub link: SerialLink,
+    /// Time after which the host sends again the requests it has not got a response to, in
+    /// milliseconds.
+    pub timeout_ms: u64,
+    /// Seed of the frame losses.
+    pub seed: u64,
+}
+
+impl SerialUpload {
+    pub fn new(framing: Framing, window: usize, link: SerialLink) -> SerialUpload {
+        SerialUpload {
+            framing,
+            window,
+            link,
+            timeout_ms: 20_000,
+            seed: 1,
+        }
+    }
+}
+
+/// Statistics of a simulated upload.
+#[derive(Clone, Debug, Default)]
+pub struct UploadStats {
+    /// Time from the first request of the host to the reset of the device.
+    pub elapsed_ns: u64,
+    /// Time the device spent in flash operations.
+    pub flash_ns: u64,
+    /// Requests used, and of them those which carried data sent before.
+    pub requests: u64,
+    pub resends: u64,
+    /// Frames lost, in either direction.
+    pub lost: u64,
+    /// Bytes sent by the host and by the device.
+    pub host_bytes: u64,
+    pub device_bytes: u64,
+    /// Data bytes per upload request, and requests in flight, after the parameters reported by the
+    /// device.
+    pub chunk: usize,
+    pub window: usize,
+}
+
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+enum Phase {
+    Params,
+    Upload,
+    Reset,
+    Failed,
+}
+
+/// A request waiting for its response.
+struct Pending {
+    seq: u8,
+    sent_ns: u64,
+    // Generation of the upload requests it belongs to, and range of the image it carries.
+    gen: u64,
+    end: usize,
+}
+
+/// The host side of an upload, seen by serial recovery as its uart.
+pub struct SerialHost<'a> {
+    upload: SerialUpload,
+    image: &'a [u8],
+    align: usize,
+    rng: SmallRng,
+
+    // Time of the device, and part of it spent in flash operations.
+    now: u64,
+    flash_ns: u64,
+    // Time of the last event handled by the host.
+    host_ns: u64,
+
+    // Lines on their way to the device, with the time they are received, the first one possibly
+    // partially read already.
+    to_device: VecDeque<(u64, Vec<u8>)>,
+    read_pos: usize,
+    // Time the host end of the link is free to send.
+    link_free: u64,
+
+    // Line the device is sending, and the packets it sent, with the time they are received.
+    line: Vec<u8>,
+    reader: FrameReader,
+    to_host: VecDeque<(u64, Vec<u8>)>,
+
+    phase: Phase,
+    window: usize,
+    chunk: usize,
+    seq: u8,
+    gen: u64,
+    next_off: usize,
+    acked: usize,
+    max_sent: usize,
+    pending: VecDeque<Pending>,
+    timeouts: u32,
+    stats: UploadStats,
+}
+
+impl<'a> SerialHost<'a> {
+    /// A host uploading `image` to a device whose flash writes are `align` bytes.  The statistics
+    /// of the flash devices are expected to be reset.
+    pub fn new(upload: &SerialUpload, image: &'a [u8], align: usize) -> SerialHost<'a> {
+        SerialHost {
+            upload: *upload,
+            image,
+            align: align.max(1),
+            rng: SmallRng::seed_from_u64(upload.seed),
+            now: 0,
+            flash_ns: 0,
+            host_ns: 0,
+            to_device: VecDeque::new(),
+            read_pos: 0,
+            link_free: 0,
+            line: Vec::new(),
+            reader: FrameReader::default(),
+            to_host: VecDeque::new(),
+            phase: Phase::Params,
+            window: 1,
+            chunk: 0,
+            seq: 0,
+            gen: 0,
+            next_off: 0,
+            acked: 0,
+            max_sent: 0,
+            pending: VecDeque::new(),
+            timeouts: 0,
+            stats: UploadStats::default(),
+        }
+    }
+
+    /// The statistics of the upload, once serial recovery has ended with `exit`, or None if the
+    /// upload did not complete.
+    pub fn finish(mut self, exit: SerialExit) -> Option<UploadStats> {
+        if exit != SerialExit::Reset || self.phase != Phase::Reset {
+            warn!("Upload ended with {:?} in {:?}, at offset {:#x} of {:#x}",
+                  exit, self.phase, self.acked, self.image.len());
+            return None;
+        }
+        self.stats.elapsed_ns = self.now;
+        self.stats.flash_ns = self.flash_ns;
+        self.stats.chunk = self.chunk;
+        self.stats.window = self.window;
+        Some(self.stats)
+    }
+
+    fn ns_per_byte(&self) -> u64 {
+        10_000_000_000 / self.upload.link.baud.max(1) as u64
+    }
+
+    fn latency_ns(&self) -> u64 {
+        self.upload.link.latency_us * 1000
+    }
+
+    fn lose(&mut self) -> bool {
+        if self.upload.link.loss > 0.0 && self.rng.gen::<f64>() < self.upload.link.loss {
+            self.stats.lost += 1;
+            true
+        } else {
+            false
+        }
+    }
+
+    /// Move the clock of the device past the flash operations done since the last call.
+    fn sync_flash(&mut self) {
+        let flash_ns = api::flash_stats().elapsed_ns;
+        self.now += flash_ns.saturating_sub(self.flash_ns);
+        self.flash_ns = flash_ns;
+    }
+
+    /// Send a request at the time of the host.
+    fn send(&mut self, op: u8, group: u16, id: u8, cbor: &[u8]) {
+        let seq = self.seq;
+        self.seq = self.seq.wrapping_add(1);
+
+        let mut pkt = vec![op, 0];
+        pkt.extend_from_slice(&(cbor.len() as u16).to_be_bytes());
+        pkt.extend_from_slice(&group.to_be_bytes());
+        pkt.push(seq);
+        pkt.push(id);
+        pkt.extend_from_slice(cbor);
+
+        self.pending.push_back(Pending {
+            seq,
+            sent_ns: self.host_ns,
+            gen: self.gen,
+            end: 0,
+        });
+        self.stats.requests += 1;
+
+        let lost = self.lose();
+        let mut time = self.link_free.max(self.host_ns);
+        for line in self.upload.framing.encode(&pkt) {
+            time += line.len() as u64 * self.ns_per_byte();
+            self.stats.host_bytes += line.len() as u64;
+            if !lost {
+                self.to_device.push_back((time + self.latency_ns(), line));
+            }
+        }
+        self.link_free = time;
+    }
+
+    /// Send the next upload request.
+    fn send_chunk(&mut self) {
+        let off = self.next_off;
+        let end = (off + self.chunk).min(self.image.len());
+
+        let mut cbor = Vec::with_capacity(end - off + UPLOAD_OVERHEAD);
+        cbor_head(&mut cbor, 5, if off == 0 { 3 } else { 2 });
+        cbor_text(&mut cbor, "data");
+        cbor_head(&mut cbor, 2, (end - off) as u64);
+        cbor.extend_from_slice(&self.image[off..end]);
+        if off == 0 {
+            cbor_text(&mut cbor, "len");
+            cbor_head(&mut cbor, 0, self.image.len() as u64);
+        }
+        cbor_text(&mut cbor, "off");
+        cbor_head(&mut cbor, 0, off as u64);
+
+        if off < self.max_sent {
+            self.stats.resends += 1;
+        }
+        self.max_sent = self.max_sent.max(end);
+        self.send(NMGR_OP_WRITE, MGMT_GROUP_ID_IMAGE, IMGMGR_NMGR_ID_UPLOAD, &cbor);
+        self.pending.back_mut().unwrap().end = end;
+        self.next_off = end;
+    }
+
+    /// Send the requests the host can send at its current time.
+    fn fill(&mut self) {
+        match self.phase {
+            Phase::Params if self.pending.is_empty() => {
+                self.send(NMGR_OP_READ, MGMT_GROUP_ID_DEFAULT, NMGR_ID_MCUMGR_PARAMS, &[0xa0]);
+            }
+            Phase::Upload => {
+                while self.pending.len() < self.window && self.next_off < self.image.len() {
+                    self.send_chunk();
+                }
+            }
+            Phase::Reset if self.pending.is_empty() => {
+                self.send(NMGR_OP_WRITE, MGMT_GROUP_ID_DEFAULT, NMGR_ID_RESET, &[0xa0]);
+            }
+            _ => (),
+        }
+    }
+
+    /// Handle a response packet from the device.
+    fn receive(&mut self, pkt: &[u8]) {
+        if pkt.len() < 8 {
+            return;
+        }
+        let seq = pkt[6];
+        let pending = match self.pending.iter().position(|p| p.seq == seq) {
+            Some(pos) => self.pending.remove(pos).unwrap(),
+            // Answers a request given up on.
+            None => return,
+        };
+        self.timeouts = 0;
+        let entries = cbor_map_ints(&pkt[8..]).unwrap_or_default();
+        let rc = cbor_get(&entries, "rc").unwrap_or(0);
+
+        match self.phase {
+            Phase::Params => {
+                let buf_size = match (rc, cbor_get(&entries, "buf_size")) {
+                    (0, Some(buf_size)) => {
+                        let buf_count = cbor_get(&entries, "buf_count").unwrap_or(1);
+                        self.window = self.upload.window.min(buf_count.max(1) as usize);
+                        buf_size as usize
+                    }
+                    _ => {
+                        self.window = 1;
+                        DEFAULT_BUF_SIZE
+                    }
+                };
+                // One byte is kept for the terminating NUL the device adds.
+                let room = buf_size.saturating_sub(1 + self.upload.framing.overhead() +
+                                                   UPLOAD_OVERHEAD);
+                self.chunk = (room / self.align * self.align).max(self.align);
+                info!("Uploading {} bytes by {} with a window of {}",
+                      self.image.len(), self.chunk, self.window);
+                self.phase = Phase::Upload;
+            }
+            Phase::Upload => {
+                let off = match cbor_get(&entries, "off") {
+                    Some(off) if rc == 0 => off as usize,
+                    _ => {
+                        warn!("Upload failed with {}", rc);
+                        self.phase = Phase::Failed;
+                        return;
+                    }
+                };
+                self.acked = self.acked.max(off);
+                if off >= self.image.len() {
+                    self.pending.clear();
+                    self.phase = Phase::Reset;
+                } else if pending.gen == self.gen && off != pending.end {
+                    // The device wants another offset, the requests in flight after this one
+                    // are dropped by it.
+                    self.gen += 1;
+                    self.next_off = off;
+                }
+            }
+            Phase::Reset | Phase::Failed => (),
+        }
+    }
+
+    /// The time the oldest request in flight is given up.
+    fn deadline(&self) -> Option<u64> {
+        self.pending.front().map(|p| p.sent_ns + self.upload.timeout_ms * 1_000_000)
+    }
+
+    /// Handle the events of the host up to the time of the device, in order.
+    fn run_host(&mut self) {
+        loop {
+            let response = self.to_host.front().map(|&(time, _)| time);
+            let deadline = self.deadline();
+            match (response, deadline) {
+                (Some(time), _) if time <= self.now && deadline.map_or(true, |d| time <= d) => {
+                    let (_, pkt) = self.to_host.pop_front().unwrap();
+                    self.host_ns = self.host_ns.max(time);
+                    self.receive(&pkt);
+                }
+                (_, Some(time)) if time <= self.now => {
+                    self.host_ns = self.host_ns.max(time);
+                    self.timeouts += 1;
+                    if self.timeouts > MAX_TIMEOUTS {
+                        warn!("No response from the device");
+                        self.phase = Phase::Failed;
+                    }
+                    self.pending.clear();
+                    self.gen += 1;
+                    self.next_off = self.acked;
+                }
+                _ => break,
+            }
+            self.fill();
+        }
+        if self.stats.requests == 0 {
+            self.fill();
+        }
+    }
+}
+
+impl<'a> SimUart for SerialHost<'a> {
+    fn read(&mut self, buf: &mut [u8]) -> Option<(usize, bool)> {
+        self.sync_flash();
+        self.run_host();
+        if self.phase == Phase::Failed {
+            return None;
+        }
+
+        if let Some((time, line)) = self.to_device.front() {
+            if *time <= self.now {
+                let len = (line.len() - self.read_pos).min(buf.len());
+                buf[..len].copy_from_slice(&line[self.read_pos..self.read_pos + len]);
+                self.read_pos += len;
+                if self.read_pos < line.len() {
+                    return Some((len, false));
+                }
+                self.read_pos = 0;
+                self.to_device.pop_front();
+                return Some((len, true));
+            }
+        }
+
+        // Nothing received yet, wait for the next event.
+        let next = [
+            self.to_device.front().map(|&(time, _)| time),
+            self.to_host.front().map(|&(time, _)| time),
+            self.deadline(),
+        ].iter().flatten().copied().min()?;
+        self.now = self.now.max(next);
+        Some((0, false))
+    }
+
+    fn write(&mut self, data: &[u8]) {
+        self.sync_flash();
+        self.now += data.len() as u64 * self.ns_per_byte();
+        self.stats.device_bytes += data.len() as u64;
+
+        for &byte in data {
+            if byte != b'\n' {
+                self.line.push(byte);
+                continue;
+            }
+            let line = std::mem::take(&mut self.line);
+            if let Some(pkt) = self.reader.line(&line) {
+                if !self.lose() {
+                    let time = self.now + self.latency_ns();
+                    self.to_host.push_back((time, pkt));
+                }
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn framing() {
+        let pkt: Vec<u8> = (0..400u32).map(|i| (i * 7 % 11) as u8).collect();
+        for &framing in &[Framing::Base64, Framing::Raw] {
+            let mut reader = FrameReader::default();
+            let lines = framing.encode(&pkt);
+            assert!(lines.len() > 1);
+            let mut result = None;
+            for line in &lines {
+                assert!(line.len() <= 127);
+                assert_eq!(line.iter().filter(|&&b| b == b'\n').count(), 1);
+                result = reader.line(&line[..line.len() - 1]);
+            }
+            assert_eq!(result.as_deref(), Some(&pkt[..]), "{:?}", framing);
+        }
+    }
+
+    #[test]
+    fn cbor() {
+        let mut buf = vec![0xbf];
+        cbor_text(&mut buf, "rc");
+        cbor_head(&mut buf, 0, 0);
+        cbor_text(&mut buf, "name");
+        cbor_text(&mut buf, "x");
+        cbor_text(&mut buf, "off");
+        cbor_head(&mut buf, 0, 0x12345);
+        buf.push(0xff);
+        let entries = cbor_map_ints(&buf).unwrap();
+        assert_eq!(cbor_get(&entries, "rc"), Some(0));
+        assert_eq!(cbor_get(&entries, "off"), Some(0x12345));
+        assert_eq!(cbor_get(&entries, "name"), None);
+    }
+}
@@ -10,15 +10,21 @@
 
 use bootsim::{
     DepTest, DepType, UpgradeInfo,
+    FuzzTarget,
     ImagesBuilder,
     Images,
     NO_DEPS,
     REV_DEPS,
     testlog,
-    ImageManipulation
+    ImageManipulation,
+    ALL_FUZZ_TARGETS,
+    FUZZ_IMAGE_SIZE,
 };
+#[cfg(feature = "serial-recovery")]
+use bootsim::{Framing, SerialLink, SerialUpload};
 use std::{
     env,
+    path::Path,
     sync::atomic::{AtomicUsize, Ordering},
 };
 
@@ -36,6 +42,19 @@ macro_rules! test_shell {
     }
 }
 
+/// Like test_shell, on the large devices.
+macro_rules! large_test_shell {
+    ($name:ident, $arg: ident, $body:expr) => {
+        #[test]
+        fn $name() {
+            testlog::setup();
+            ImagesBuilder::each_large_device(|$arg| {
+                $body;
+            });
+        }
+    }
+}
+
 /// A typical test calls a particular constructor, and runs a given test on
 /// that constructor.
 macro_rules! sim_test {
@@ -49,6 +68,7 @@ macro_rules! sim_test {
 }
 
 sim_test!(bad_secondary_slot, make_bad_secondary_slot_image(), run_signfail_upgrade());
+sim_test!(corrupt_secondary_slot, make_corrupt_secondary_slot_image(), run_corrupt_upgrade());
 sim_test!(secondary_trailer_leftover, make_erased_secondary_image(), run_secondary_leftover_trailer());
 sim_test!(bootstrap, make_bootstrap_image(), run_bootstrap());
 sim_test!(oversized_bootstrap, make_oversized_bootstrap_image(), run_oversized_bootstrap());
@@ -81,6 +101,77 @@ sim_test!(ram_load_overlapping_images_same_base, make_no_upgrade_image(&NO_DEPS,
 #[cfg(feature = "multiimage")]
 sim_test!(ram_load_overlapping_images_offset, make_no_upgrade_image(&NO_DEPS, ImageManipulation::OverlapImages(false)), run_ram_load_boot_with_result(false));
 
+// Check that the flash operations of the boot scenarios did not increase.  Run with
+// MCUBOOT_RECORD_BASELINE set to record the current counts.  With MCUBOOT_REQUIRE_BASELINE set,
+// as CI does, a scenario without a baseline fails too.
+#[test]
+fn flash_ops_baseline() {
+    testlog::setup();
+    let path = Path::new(env!("CARGO_MANIFEST_DIR")).join("../ci/sim_flash_baseline.txt");
+    let record = env::var("MCUBOOT_RECORD_BASELINE").is_ok();
+    let require = env::var("MCUBOOT_REQUIRE_BASELINE").is_ok();
+    assert!(!bootsim::check_flash_baseline(&path, record, require));
+}
+
+// The large devices only run with the `large-flash` feature.  The random
+// interruptions go through the recovery of the swap status of slots with
+// thousands of sectors.
+large_test_shell!(large_perm_with_random_fails, r, {
+    let image = r.make_large_image(75);
+    dump_image(&image, "large_perm_with_random_fails");
+    assert!(!image.run_perm_with_random_fails(3));
+});
+
+large_test_shell!(large_upgrade_scaling, r, {
+    let r = r.with_timing();
+    let small = r.clone().make_large_bench_image(35);
+    let large = r.make_large_bench_image(70);
+    assert!(!small.run_scaling_check(&large));
+});
+
+// Upload an image through serial recovery, with each framing, with and without a window, on a
+// clean link and on one losing frames.
+#[cfg(feature = "serial-recovery")]
+test_shell!(serial_recovery_upload, r, {
+    let image = r.with_timing().make_bench_image(32 * 1024, false);
+    for &framing in &[Framing::Base64, Framing::Raw] {
+        let mut times = Vec::new();
+        for &window in &[1, 4] {
+            let clean = SerialUpload::new(framing, window, SerialLink::default());
+            let stats = image.run_serial_upload(&clean);
+            assert!(stats.is_some(), "{:?} upload with a window of {} failed", framing, window);
+            times.push(stats.unwrap().elapsed_ns);
+
+            let lossy = SerialUpload {
+                link: SerialLink { loss: 0.05, ..SerialLink::default() },
+                ..clean
+            };
+            assert!(image.run_serial_upload(&lossy).is_some(),
+                    "{:?} upload with a window of {} failed with losses", framing, window);
+        }
+        // The window hides the latency of the responses.
+        assert!(times[1] < times[0]);
+    }
+});
+
+// Run each fuzz target on mutations of its seed image, which the parsing and the validation must
+// accept.
+test_shell!(fuzz_targets, r, {
+    let image = r.make_bench_image(FUZZ_IMAGE_SIZE, false);
+    for &target in ALL_FUZZ_TARGETS {
+        let mut fuzzer = match image.fuzzer(target) {
+            Ok(fuzzer) => fuzzer,
+            Err(_) => continue,
+        };
+        let seed = fuzzer.seed().to_vec();
+        let accepted = fuzzer.run(&seed);
+        assert!(accepted || target == FuzzTarget::Upgrade,
+                "The {} target rejected its seed", target.name());
+        let execs = if target == FuzzTarget::Upgrade { 50 } else { 5000 };
+        fuzzer.run_mutations(execs, 1);
+    }
+});
+
 // Test various combinations of incorrect dependencies.
 test_shell!(dependency_combos, r, {
     // Only test setups with two images.